@@ -161,3 +161,57 @@ int lzx_decompress(const void* lzx_data, size_t lzx_len, void* dest,
 
   return result_code;
 }
+
+// Callback-based file for lzx_decompress_stream().
+typedef struct mspack_stream_file_t {
+  lzx_read_func read_func;
+  lzx_write_func write_func;
+  void* userdata;
+} mspack_stream_file;
+static int mspack_stream_read(struct mspack_file* file, void* buffer, int chars) {
+  mspack_stream_file* sfile = (mspack_stream_file*)file;
+  return sfile->read_func(sfile->userdata, buffer, chars);
+}
+static int mspack_stream_write(struct mspack_file* file, void* buffer, int chars) {
+  mspack_stream_file* sfile = (mspack_stream_file*)file;
+  return sfile->write_func(sfile->userdata, buffer, chars);
+}
+
+int lzx_decompress_stream(lzx_read_func read_func, lzx_write_func write_func,
+                          void* userdata, size_t dest_len, size_t stop_len,
+                          uint32_t window_size) {
+  int result_code = 1;
+  uint32_t window_bits;
+
+  struct mspack_system sys;
+  mspack_stream_file sfile;
+  struct lzxd_stream* lzxd;
+
+  if (!read_func || !write_func || stop_len > dest_len) {
+    return result_code;
+  }
+  if (!bit_scan_forward(window_size, &window_bits)) {
+    return result_code;
+  }
+
+  memset(&sys, 0, sizeof(sys));
+  sys.read = mspack_stream_read;
+  sys.write = mspack_stream_write;
+  sys.alloc = mspack_memory_alloc;
+  sys.free = mspack_memory_free;
+  sys.copy = mspack_memory_copy;
+
+  sfile.read_func = read_func;
+  sfile.write_func = write_func;
+  sfile.userdata = userdata;
+
+  // NOTE: The same mspack_stream_file is used for input and output.
+  lzxd = lzxd_init(&sys, (struct mspack_file*)&sfile, (struct mspack_file*)&sfile,
+                   window_bits, 0, 0x8000, (off_t)dest_len, 0);
+  if (lzxd) {
+    result_code = lzxd_decompress(lzxd, (off_t)stop_len);
+    lzxd_free(lzxd);
+  }
+
+  return result_code;
+}
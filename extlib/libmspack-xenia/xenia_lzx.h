@@ -21,6 +21,32 @@ int lzx_decompress(const void* lzx_data, size_t lzx_len, void* dest,
                    size_t dest_len, uint32_t window_size, void* window_data,
                    size_t window_data_len);
 
+/**
+ * Streaming LZX decompression callbacks.
+ * read: Read up to size bytes of compressed data.
+ *       Returns the number of bytes read, 0 on EOF, or negative on error.
+ * write: Write decompressed data.
+ *        Returns the number of bytes written. Anything other than size is an error.
+ */
+typedef int (*lzx_read_func)(void* userdata, void* buf, int size);
+typedef int (*lzx_write_func)(void* userdata, const void* buf, int size);
+
+/**
+ * Decompress LZX data using callbacks instead of memory buffers.
+ * Decompression stops once stop_len bytes have been written,
+ * so only the window and a small input buffer are allocated.
+ * @param read_func Read callback.
+ * @param write_func Write callback.
+ * @param userdata User data for the callbacks.
+ * @param dest_len Total size of the decompressed data.
+ * @param stop_len Number of bytes to decompress. (must be <= dest_len)
+ * @param window_size LZX window size.
+ * @return 0 (MSPACK_ERR_OK) on success; non-zero on error.
+ */
+int lzx_decompress_stream(lzx_read_func read_func, lzx_write_func write_func,
+                          void* userdata, size_t dest_len, size_t stop_len,
+                          uint32_t window_size);
+
 #ifdef __cplusplus
 }
 #endif
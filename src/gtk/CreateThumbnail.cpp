@@ -373,6 +373,11 @@ G_MODULE_EXPORT int rp_create_thumbnail(const char *source_file, const char *out
 		goto cleanup;
 	}
 
+	// Thumbnails are written frequently, so use the
+	// user-selected PNG compression profile.
+	pngWriter->setCompressionProfile(static_cast<RpPngWriter::CompressionProfile>(
+		Config::instance()->thumbnailPngCompression()));
+
 	/** tEXt chunks. **/
 	// NOTE: These are written before IHDR in order to put the
 	// tEXt chunks before the IDAT chunk.
@@ -499,3 +504,13 @@ cleanup:
 	romData->unref();
 	return ret;
 }
+
+/**
+ * Get the maximum number of worker threads for rp-thumbnailer-dbus.
+ * @return Maximum number of worker threads. (0 for one per CPU)
+ */
+extern "C"
+G_MODULE_EXPORT unsigned int rp_thumbnailer_max_threads(void)
+{
+	return Config::instance()->thumbnailerMaxThreads();
+}
@@ -52,6 +52,7 @@ enum RpThumbnailerProperties {
 	PROP_CONNECTION,
 	PROP_CACHE_DIR,
 	PROP_PFN_RP_CREATE_THUMBNAIL,
+	PROP_MAX_THREADS,
 	PROP_EXPORTED,
 
 	PROP_LAST
@@ -72,7 +73,10 @@ static void	rp_thumbnailer_set_property	(GObject	*object,
 						 GParamSpec	*pspec);
 
 static gboolean	rp_thumbnailer_timeout		(RpThumbnailer	*thumbnailer);
-static gboolean	rp_thumbnailer_process		(RpThumbnailer	*thumbnailer);
+static void	rp_thumbnailer_process		(gpointer	 data,
+						 gpointer	 user_data);
+static gboolean	rp_thumbnailer_emit_started	(gpointer	 data);
+static gboolean	rp_thumbnailer_request_done	(gpointer	 data);
 
 // D-Bus methods.
 static gboolean	rp_thumbnailer_queue		(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton,
@@ -94,12 +98,31 @@ struct _RpThumbnailerClass {
 
 #define SHUTDOWN_TIMEOUT_SECONDS 30
 
+// Thumbnail request result.
+enum RequestResult {
+	REQUEST_RESULT_CANCELLED,	// Dequeued before processing started.
+	REQUEST_RESULT_READY,		// Thumbnail was created.
+	REQUEST_RESULT_ERROR,		// An error occurred.
+};
+
 // Thumbnail request information.
 struct request_info {
 	gchar *uri;
 	guint handle;
 	bool large;	// False for 'normal' (128x128); true for 'large' (256x256)
 	bool urgent;	// 'urgent' value
+
+	// Set by rp_thumbnailer_dequeue(). (atomic)
+	volatile gint cancelled;
+
+	// RpThumbnailer object. (ref()'d while the request is active)
+	RpThumbnailer *thumbnailer;
+
+	// Request result. Set by the worker thread.
+	enum RequestResult result;
+	bool error_has_uri;		// If true, send the URI with the Error signal.
+	int error_code;			// Error code for the Error signal.
+	const char *error_message;	// Error message for the Error signal. (static string)
 };
 
 static void request_info_free(gpointer data, G_GNUC_UNUSED gpointer user_data)
@@ -111,6 +134,45 @@ static void request_info_free(gpointer data, G_GNUC_UNUSED gpointer user_data)
 	}
 }
 
+/**
+ * Set an error for a thumbnail request.
+ * The Error signal will be emitted on the main thread.
+ * @param req		[in/out] Thumbnail request.
+ * @param has_uri	[in] If true, send the URI with the Error signal.
+ * @param error_code	[in] Error code.
+ * @param message	[in] Error message. (must be a static string)
+ */
+static inline void request_info_set_error(struct request_info *req,
+	bool has_uri, int error_code, const char *message)
+{
+	req->result = REQUEST_RESULT_ERROR;
+	req->error_has_uri = has_uri;
+	req->error_code = error_code;
+	req->error_message = message;
+}
+
+/**
+ * Sort function for the thread pool.
+ * Urgent requests are processed first; otherwise,
+ * requests are processed in the order they were queued.
+ * @param a Request A.
+ * @param b Request B.
+ * @param user_data (unused)
+ * @return Negative if a < b; 0 if a == b; positive if a > b.
+ */
+static gint request_info_compare(gconstpointer a, gconstpointer b, G_GNUC_UNUSED gpointer user_data)
+{
+	const struct request_info *const req_a = (const struct request_info*)a;
+	const struct request_info *const req_b = (const struct request_info*)b;
+	if (req_a->urgent != req_b->urgent) {
+		return (req_a->urgent ? -1 : 1);
+	}
+	if (req_a->handle != req_b->handle) {
+		return (req_a->handle < req_b->handle ? -1 : 1);
+	}
+	return 0;
+}
+
 struct _RpThumbnailer {
 	GObject __parent__;
 	OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton;
@@ -121,13 +183,14 @@ struct _RpThumbnailer {
 	// Shutdown timeout.
 	guint timeout_id;
 
-	// Idle function for processing.
-	guint idle_process;
+	// Worker thread pool for processing.
+	GThreadPool *thread_pool;
 
 	// Last handle value.
 	guint last_handle;
 
-	// Request queue.
+	// Active requests, i.e. requests that haven't been finished yet.
+	// NOTE: Only accessed from the main thread.
 	GQueue *request_queue;	// element is struct request_info*
 
 	/** Properties. **/
@@ -141,6 +204,9 @@ struct _RpThumbnailer {
 	// rp_create_thumbnail() function pointer.
 	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail;
 
+	// Maximum number of worker threads. (0 for one per CPU)
+	guint max_threads;
+
 	// Is the D-Bus object exported?
 	bool exported;
 };
@@ -216,6 +282,10 @@ rp_thumbnailer_class_init(gpointer g_class, gpointer class_data)
 		g_param_spec_pointer("pfn_rp_create_thumbnail", "pfn_rp_create_thumbnail",
 			"rp_create_thumbnail() function pointer.",
 			(GParamFlags)(G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY)));
+	g_object_class_install_property(gobject_class, PROP_MAX_THREADS,
+		g_param_spec_uint("max_threads", "max_threads",
+			"Maximum number of worker threads. (0 for one per CPU)",
+			0, G_MAXINT, 0, (GParamFlags)(G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY)));
 	g_object_class_install_property(gobject_class, PROP_EXPORTED,
 		g_param_spec_boolean("exported", "exported", "Is the D-Bus object exported?",
 			false, G_PARAM_READABLE));
@@ -230,7 +300,7 @@ rp_thumbnailer_init(GTypeInstance *instance, gpointer g_class)
 	thumbnailer->skeleton = NULL;
 	thumbnailer->shutdown_emitted = false;
 	thumbnailer->timeout_id = 0;
-	thumbnailer->idle_process = 0;
+	thumbnailer->thread_pool = NULL;
 	thumbnailer->last_handle = 0;
 	thumbnailer->request_queue = g_queue_new();
 
@@ -238,6 +308,7 @@ rp_thumbnailer_init(GTypeInstance *instance, gpointer g_class)
 	thumbnailer->connection = NULL;
 	thumbnailer->cache_dir = NULL;
 	thumbnailer->pfn_rp_create_thumbnail = NULL;
+	thumbnailer->max_threads = 0;
 	thumbnailer->exported = false;
 }
 
@@ -247,7 +318,28 @@ rp_thumbnailer_constructed(GObject *object)
 	g_return_if_fail(IS_RP_THUMBNAILER(object));
 	RpThumbnailer *const thumbnailer = RP_THUMBNAILER(object);
 
+	// Create the worker thread pool.
 	GError *error = NULL;
+	guint max_threads = thumbnailer->max_threads;
+	if (max_threads == 0) {
+#if GLIB_CHECK_VERSION(2,36,0)
+		max_threads = g_get_num_processors();
+#else /* !GLIB_CHECK_VERSION(2,36,0) */
+		max_threads = 2;
+#endif /* GLIB_CHECK_VERSION(2,36,0) */
+	}
+	thumbnailer->thread_pool = g_thread_pool_new(rp_thumbnailer_process,
+		thumbnailer, (gint)max_threads, FALSE, &error);
+	if (error) {
+		g_critical("Error creating the thread pool: %s", error->message);
+		g_error_free(error);
+		error = NULL;
+		thumbnailer->exported = false;
+		return;
+	}
+	g_thread_pool_set_sort_function(thumbnailer->thread_pool, request_info_compare, NULL);
+	g_debug("Using up to %u worker thread(s).", max_threads);
+
 	thumbnailer->skeleton = org_freedesktop_thumbnails_specialized_thumbnailer1_skeleton_new();
 	g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(thumbnailer->skeleton),
 		thumbnailer->connection, "/com/gerbilsoft/rom_properties/SpecializedThumbnailer1", &error);
@@ -283,10 +375,12 @@ rp_thumbnailer_dispose(GObject *object)
 		thumbnailer->timeout_id = 0;
 	}
 
-	// Unregister idle_process.
-	if (G_UNLIKELY(thumbnailer->idle_process != 0)) {
-		g_source_remove(thumbnailer->idle_process);
-		thumbnailer->idle_process = 0;
+	// Shut down the thread pool.
+	// NOTE: Each active request holds a reference to the
+	// RpThumbnailer, so the thread pool should be idle here.
+	if (thumbnailer->thread_pool) {
+		g_thread_pool_free(thumbnailer->thread_pool, TRUE, TRUE);
+		thumbnailer->thread_pool = NULL;
 	}
 
 	// Call the superclass dispose() function.
@@ -337,6 +431,9 @@ rp_thumbnailer_get_property(GObject *object,
 		case PROP_PFN_RP_CREATE_THUMBNAIL:
 			g_value_set_pointer(value, (gpointer)thumbnailer->pfn_rp_create_thumbnail);
 			break;
+		case PROP_MAX_THREADS:
+			g_value_set_uint(value, thumbnailer->max_threads);
+			break;
 		case PROP_EXPORTED:
 			g_value_set_boolean(value, thumbnailer->exported);
 			break;
@@ -386,6 +483,10 @@ rp_thumbnailer_set_property(GObject *object,
 				(PFN_RP_CREATE_THUMBNAIL)g_value_get_pointer(value);
 			break;
 
+		case PROP_MAX_THREADS:
+			thumbnailer->max_threads = g_value_get_uint(value);
+			break;
+
 		case PROP_EXPORTED:
 			// FIXME: Read-only property.
 			// Need to show some error message...
@@ -426,6 +527,12 @@ rp_thumbnailer_queue(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton,
 			G_DBUS_ERROR, G_DBUS_ERROR_NO_SERVER, "Service is shutting down.");
 		return true;
 	}
+	if (G_UNLIKELY(!thumbnailer->thread_pool)) {
+		// The thread pool could not be created.
+		g_dbus_method_invocation_return_error(invocation,
+			G_DBUS_ERROR, G_DBUS_ERROR_FAILED, "Thread pool is not available.");
+		return true;
+	}
 
 	// Stop the inactivity timeout.
 	if (G_LIKELY(thumbnailer->timeout_id != 0)) {
@@ -443,19 +550,18 @@ rp_thumbnailer_queue(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton,
 
 	// Add the URI to the queue.
 	// NOTE: Currently handling all flavors that aren't "large" as "normal".
-	struct request_info *req = g_malloc(sizeof(struct request_info));
+	struct request_info *req = g_malloc0(sizeof(struct request_info));
 	req->uri = g_strdup(uri);
 	req->handle = handle;
 	req->large = flavor && (g_ascii_strcasecmp(flavor, "large") == 0);
 	req->urgent = urgent;
-	// TODO Put 'urgent' requests at the front of the queue?
+	req->thumbnailer = g_object_ref(thumbnailer);
 	g_queue_push_tail(thumbnailer->request_queue, req);
 
-	// Make sure the idle process is started.
-	// TODO: Make it multi-threaded? (needs atomic compare and/or mutex...)
-	if (thumbnailer->idle_process == 0) {
-		thumbnailer->idle_process = g_idle_add((GSourceFunc)rp_thumbnailer_process, thumbnailer);
-	}
+	// Process the request on the thread pool.
+	// 'urgent' requests are moved to the front of the queue
+	// by request_info_compare().
+	g_thread_pool_push(thumbnailer->thread_pool, req, NULL);
 
 	org_freedesktop_thumbnails_specialized_thumbnailer1_complete_queue(skeleton, invocation, handle);
 	return true;
@@ -478,7 +584,18 @@ rp_thumbnailer_dequeue(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton
 	g_dbus_async_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), invocation, false);
 	g_dbus_async_return_val_if_fail(handle != 0, invocation, false);
 
-	// TODO
+	// Find the request.
+	// If it hasn't been started yet, the worker thread will skip it
+	// and only emit the Finished signal. Requests that are already
+	// being processed will be completed normally.
+	for (GList *iter = thumbnailer->request_queue->head; iter != NULL; iter = iter->next) {
+		struct request_info *const req = (struct request_info*)iter->data;
+		if (req->handle == handle) {
+			g_atomic_int_set(&req->cancelled, 1);
+			break;
+		}
+	}
+
 	org_freedesktop_thumbnails_specialized_thumbnailer1_complete_dequeue(skeleton, invocation);
 	return true;
 }
@@ -506,44 +623,43 @@ rp_thumbnailer_timeout(RpThumbnailer *thumbnailer)
 }
 
 /**
- * Process a thumbnail.
- * @param thumbnailer RpThumbnailer object.
+ * Process a thumbnail request.
+ * This function is run on a worker thread.
+ *
+ * NOTE: D-Bus signals must not be emitted here.
+ * Set the request result instead; the signals will
+ * be emitted on the main thread.
+ *
+ * NOTE 2: rp_create_thumbnail() is called from multiple worker
+ * threads at once. Its only shared state is RomDataFactory's
+ * lookup tables, which are initialized using pthread_once();
+ * Config, which reloads the configuration while holding a mutex;
+ * and the GIO proxy resolver, which is thread-safe.
+ *
+ * @param thumbnailer	[in] RpThumbnailer object.
+ * @param req		[in/out] Thumbnail request.
  */
-static gboolean
-rp_thumbnailer_process(RpThumbnailer *thumbnailer)
+static void
+rp_thumbnailer_process_request(RpThumbnailer *thumbnailer, struct request_info *req)
 {
-	g_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), FALSE);
-
 	GChecksum *md5 = NULL;
 	const gchar *md5_string;	// owned by md5 object
-	const struct request_info *req;	// request info from the map
 	gchar *cache_filename = NULL;	// cache filename (g_strdup_printf())
 	size_t cache_filename_sz;	// size of cache_filename
 	int pos, pos2;			// snprintf() position
 	int ret;
 
-	// Process one thumbnail.
-	req = (struct request_info*)g_queue_pop_head(thumbnailer->request_queue);
-	if (req == NULL) {
-		// Nothing in the queue.
-		goto cleanup;
-	}
-
 	// NOTE: cache_dir and pfn_rp_create_thumbnail should NOT be NULL
 	// at this point, but we're checking it anyway.
 	if (!thumbnailer->cache_dir || thumbnailer->cache_dir[0] == 0) {
 		// No cache directory...
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, "",
-			0, "Thumbnail cache directory is empty.");
-		goto finished;
+		request_info_set_error(req, false, 0, "Thumbnail cache directory is empty.");
+		goto cleanup;
 	}
 	if (!thumbnailer->pfn_rp_create_thumbnail) {
 		// No thumbnailer function.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, "",
-			0, "No thumbnailer function is available.");
-		goto finished;
+		request_info_set_error(req, false, 0, "No thumbnailer function is available.");
+		goto cleanup;
 	}
 
 	// TODO: Make sure the URI to thumbnail is not in the cache directory.
@@ -563,17 +679,13 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	// pos does NOT include the NULL terminator, so check >=.
 	if (pos < 0 || ((size_t)pos + 1 + 32 + 4) > cache_filename_sz) {
 		// Not enough memory.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot snprintf() the thumbnail cache directory name.");
-		goto finished;
+		request_info_set_error(req, true, 0, "Cannot snprintf() the thumbnail cache directory name.");
+		goto cleanup;
 	}
 
 	if (g_mkdir_with_parents(cache_filename, 0777) != 0) {
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot mkdir() the thumbnail cache directory.");
-		goto finished;
+		request_info_set_error(req, true, 0, "Cannot mkdir() the thumbnail cache directory.");
+		goto cleanup;
 	}
 
 	// Reference: https://specifications.freedesktop.org/thumbnail-spec/thumbnail-spec-latest.html
@@ -582,10 +694,8 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	if (!md5) {
 		// Cannot allocate an MD5...
 		// TODO: Test for this early.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "g_checksum_new() does not support MD5.");
-		goto finished;
+		request_info_set_error(req, true, 0, "g_checksum_new() does not support MD5.");
+		goto cleanup;
 	}
 	g_checksum_update(md5, (const guchar*)req->uri, strlen(req->uri));
 	md5_string = g_checksum_get_string(md5);
@@ -595,10 +705,8 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	// pos and pos2 do NOT include the NULL terminator, so check >=.
 	if (pos2 < 0 || ((size_t)pos + (size_t)pos2) >= cache_filename_sz) {
 		// Not enough memory.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot snprintf() the thumbnail filename.");
-		goto finished;
+		request_info_set_error(req, true, 0, "Cannot snprintf() the thumbnail filename.");
+		goto cleanup;
 	}
 
 	// Thumbnail the image.
@@ -606,40 +714,111 @@ rp_thumbnailer_process(RpThumbnailer *thumbnailer)
 	if (ret == 0) {
 		// Image thumbnailed successfully.
 		g_debug("rom-properties thumbnail: %s -> %s [OK]", req->uri, cache_filename);
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_ready(
-			thumbnailer->skeleton, req->handle, req->uri);
+		req->result = REQUEST_RESULT_READY;
 	} else {
 		// Error thumbnailing the image...
 		g_debug("rom-properties thumbnail: %s -> %s [ERR=%d]", req->uri, cache_filename, ret);
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			2, "Image thumbnailing failed... (TODO: return code)");
+		request_info_set_error(req, true, 2, "Image thumbnailing failed... (TODO: return code)");
 	}
 
-finished:
-	// Request is finished. Emit the finished signal.
-	org_freedesktop_thumbnails_specialized_thumbnailer1_emit_finished(
-		thumbnailer->skeleton, req->handle);
-
 cleanup:
 	// Free allocated things.
-	g_checksum_free(md5);
+	if (md5) {
+		g_checksum_free(md5);
+	}
 	g_free(cache_filename);
+}
 
-	// Return TRUE if we still have more thumbnails queued.
-	const bool isEmpty = g_queue_is_empty(thumbnailer->request_queue);
-	if (isEmpty) {
-		// Clear the idle process.
-		// FIXME: Atomic compare and/or mutex? (assuming multi-threaded...)
-		thumbnailer->idle_process = 0;
+/**
+ * Process a thumbnail request.
+ * This is the thread pool function.
+ * @param data		[in] struct request_info
+ * @param user_data	[in] RpThumbnailer object.
+ */
+static void
+rp_thumbnailer_process(gpointer data, gpointer user_data)
+{
+	struct request_info *const req = (struct request_info*)data;
+	RpThumbnailer *const thumbnailer = RP_THUMBNAILER(user_data);
 
+	if (g_atomic_int_get(&req->cancelled)) {
+		// Request was dequeued before it was started.
+		req->result = REQUEST_RESULT_CANCELLED;
+	} else {
+		// Emit the Started signal on the main thread.
+		// NOTE: Idle sources with the same priority are dispatched in
+		// the order they were added, so Started will always be emitted
+		// before Ready/Error and Finished.
+		g_idle_add(rp_thumbnailer_emit_started, req);
+		rp_thumbnailer_process_request(thumbnailer, req);
+	}
+
+	// Emit the result signals on the main thread.
+	g_idle_add(rp_thumbnailer_request_done, req);
+}
+
+/**
+ * Emit the Started signal for a thumbnail request.
+ * This function is run on the main thread.
+ * @param data struct request_info
+ * @return FALSE to remove the idle source.
+ */
+static gboolean
+rp_thumbnailer_emit_started(gpointer data)
+{
+	const struct request_info *const req = (const struct request_info*)data;
+	org_freedesktop_thumbnails_specialized_thumbnailer1_emit_started(
+		req->thumbnailer->skeleton, req->handle);
+	return FALSE;
+}
+
+/**
+ * A thumbnail request has been processed.
+ * Emit the result signals and free the request.
+ * This function is run on the main thread.
+ * @param data struct request_info
+ * @return FALSE to remove the idle source.
+ */
+static gboolean
+rp_thumbnailer_request_done(gpointer data)
+{
+	struct request_info *const req = (struct request_info*)data;
+	RpThumbnailer *const thumbnailer = req->thumbnailer;
+
+	switch (req->result) {
+		case REQUEST_RESULT_READY:
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_ready(
+				thumbnailer->skeleton, req->handle, req->uri);
+			break;
+		case REQUEST_RESULT_ERROR:
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
+				thumbnailer->skeleton, req->handle,
+				(req->error_has_uri ? req->uri : ""),
+				req->error_code, req->error_message);
+			break;
+		case REQUEST_RESULT_CANCELLED:
+		default:
+			// Only the Finished signal is emitted.
+			break;
+	}
+
+	// Request is finished. Emit the finished signal.
+	org_freedesktop_thumbnails_specialized_thumbnailer1_emit_finished(
+		thumbnailer->skeleton, req->handle);
+
+	g_queue_remove(thumbnailer->request_queue, req);
+	request_info_free(req, NULL);
+
+	if (g_queue_is_empty(thumbnailer->request_queue)) {
 		// Restart the inactivity timeout.
 		if (G_LIKELY(thumbnailer->timeout_id == 0)) {
 			thumbnailer->timeout_id = g_timeout_add_seconds(SHUTDOWN_TIMEOUT_SECONDS,
 				(GSourceFunc)rp_thumbnailer_timeout, thumbnailer);
 		}
 	}
-	return !isEmpty;
+
+	g_object_unref(thumbnailer);
+	return FALSE;
 }
 
 /**
@@ -647,17 +826,20 @@ cleanup:
  * @param connection			[in] GDBusConnection
  * @param cache_dir			[in] Cache directory.
  * @param pfn_rp_create_thumbnail	[in] rp_create_thumbnail() function pointer.
+ * @param max_threads			[in] Maximum number of worker threads. (0 for one per CPU)
  * @return RpThumbnailer object.
  */
 RpThumbnailer*
 rp_thumbnailer_new(GDBusConnection *connection,
 	const gchar *cache_dir,
-	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail)
+	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail,
+	guint max_threads)
 {
 	return g_object_new(TYPE_RP_THUMBNAILER,
 		"connection", connection,
 		"cache_dir", cache_dir,
 		"pfn_rp_create_thumbnail", pfn_rp_create_thumbnail,
+		"max_threads", max_threads,
 		NULL);
 }
 
@@ -37,7 +37,8 @@ GType		rp_thumbnailer_get_type			(void) G_GNUC_CONST G_GNUC_INTERNAL;
 
 RpThumbnailer	*rp_thumbnailer_new			(GDBusConnection *connection,
 							 const gchar *cache_dir,
-							 PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail)
+							 PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail,
+							 guint max_threads)
 							G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 
 gboolean	rp_thumbnailer_is_exported		(RpThumbnailer *thumbnailer);
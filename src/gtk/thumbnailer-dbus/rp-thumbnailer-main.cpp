@@ -17,6 +17,7 @@
 // C includes. (C++ namespace)
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 
 // C++ includes.
 #include <string>
@@ -25,6 +26,12 @@ using std::string;
 // dlopen()
 #include <dlfcn.h>
 
+/**
+ * rp_thumbnailer_max_threads() function pointer.
+ * @return Maximum number of worker threads. (0 for one per CPU)
+ */
+typedef unsigned int (*PFN_RP_THUMBNAILER_MAX_THREADS)(void);
+
 // Shutdown request.
 static bool stop_main_loop = false;
 
@@ -163,9 +170,20 @@ int main(int argc, char *argv[])
 
 	GMainLoop *main_loop = g_main_loop_new(nullptr, false);
 
+	// Maximum number of worker threads.
+	// This is set using the ThumbnailerMaxThreads option in
+	// rom-properties.conf. (0 for one per CPU)
+	// NOTE: Older versions of the plugin don't have this function.
+	guint max_threads = 0;
+	PFN_RP_THUMBNAILER_MAX_THREADS pfn_rp_thumbnailer_max_threads =
+		(PFN_RP_THUMBNAILER_MAX_THREADS)dlsym(pDll, "rp_thumbnailer_max_threads");
+	if (pfn_rp_thumbnailer_max_threads) {
+		max_threads = pfn_rp_thumbnailer_max_threads();
+	}
+
 	// Create the RpThumbnail service object.
 	RpThumbnailer *const thumbnailer = rp_thumbnailer_new(
-		connection, cache_dir.c_str(), pfn_rp_create_thumbnail);
+		connection, cache_dir.c_str(), pfn_rp_create_thumbnail, max_threads);
 
 	// Register the D-Bus service.
 	g_bus_own_name_on_connection(connection,
@@ -38,7 +38,9 @@ int rpt_do_security_options(void)
 		// ensures it can only be used to create threads.
 		SCMP_SYS(clone),
 		// Other multi-threading syscalls
+		// NOTE: clone3() returns ENOSYS so glibc falls back to clone().
 		SCMP_SYS(set_robust_list),
+		// NOTE: madvise() and rseq() are allowed by librpsecure.
 
 		SCMP_SYS(access),	// LibUnixCommon::isWritableDirectory()
 		SCMP_SYS(close),
@@ -0,0 +1,647 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (D-Bus Thumbnailer)                *
+ * RpThumbnailerTest.cpp: RpThumbnailer queue and worker pool test.        *
+ *                                                                         *
+ * Copyright (c) 2017-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// D-Bus thumbnailer
+#include "rp-thumbnailer-dbus.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace RpThumbnailerDBus { namespace Tests {
+
+static const char THUMBNAILER_INTERFACE[] = "org.freedesktop.thumbnails.SpecializedThumbnailer1";
+static const char THUMBNAILER_PATH[] = "/com/gerbilsoft/rom_properties/SpecializedThumbnailer1";
+
+// Maximum time to wait for the thumbnailer, in seconds.
+static const guint WAIT_TIMEOUT_SECONDS = 10;
+
+/** Fake rp_create_thumbnail() **/
+
+// Arguments passed to fake_create_thumbnail().
+struct FakeCall {
+	string uri;
+	int maximum_size;
+};
+
+// Fake thumbnailer state. Protected by fake_mutex.
+static GMutex fake_mutex;
+static GCond fake_cond;
+static vector<FakeCall> fake_calls;	// Calls, in the order they were started.
+static bool fake_blocked;		// If true, calls wait until fake_release() is called.
+static gulong fake_delay_us;		// Delay for each call, in microseconds.
+static int fake_active;			// Number of calls currently running.
+static int fake_max_active;		// Maximum number of calls that were running at once.
+
+/**
+ * Fake rp_create_thumbnail().
+ * This is called on the RpThumbnailer worker threads.
+ * URIs containing "error" fail.
+ * @param source_file Source file. (UTF-8)
+ * @param output_file Output file. (UTF-8)
+ * @param maximum_size Maximum size.
+ * @return 0 on success; non-zero on error.
+ */
+static int fake_create_thumbnail(const char *source_file, const char *output_file, int maximum_size)
+{
+	RP_UNUSED(output_file);
+
+	g_mutex_lock(&fake_mutex);
+	FakeCall call;
+	call.uri = source_file;
+	call.maximum_size = maximum_size;
+	fake_calls.push_back(call);
+	fake_active++;
+	if (fake_active > fake_max_active) {
+		fake_max_active = fake_active;
+	}
+	g_cond_broadcast(&fake_cond);
+	while (fake_blocked) {
+		g_cond_wait(&fake_cond, &fake_mutex);
+	}
+	const gulong delay_us = fake_delay_us;
+	g_mutex_unlock(&fake_mutex);
+
+	if (delay_us > 0) {
+		g_usleep(delay_us);
+	}
+
+	g_mutex_lock(&fake_mutex);
+	fake_active--;
+	g_mutex_unlock(&fake_mutex);
+	return (strstr(source_file, "error") != nullptr ? 1 : 0);
+}
+
+/**
+ * Allow blocked fake_create_thumbnail() calls to continue.
+ */
+static void fake_release(void)
+{
+	g_mutex_lock(&fake_mutex);
+	fake_blocked = false;
+	g_cond_broadcast(&fake_cond);
+	g_mutex_unlock(&fake_mutex);
+}
+
+/**
+ * Wait for fake_create_thumbnail() to be called.
+ * @param count Number of calls to wait for.
+ * @return True if the calls were made; false on timeout.
+ */
+static bool fake_wait_for_calls(size_t count)
+{
+	const gint64 end_time = g_get_monotonic_time() + WAIT_TIMEOUT_SECONDS * G_TIME_SPAN_SECOND;
+	bool ret = true;
+	g_mutex_lock(&fake_mutex);
+	while (fake_calls.size() < count) {
+		if (!g_cond_wait_until(&fake_cond, &fake_mutex, end_time)) {
+			ret = (fake_calls.size() >= count);
+			break;
+		}
+	}
+	g_mutex_unlock(&fake_mutex);
+	return ret;
+}
+
+/**
+ * Get the URIs passed to fake_create_thumbnail().
+ * @return URIs, in the order the calls were started.
+ */
+static vector<string> fake_uris(void)
+{
+	vector<string> ret;
+	g_mutex_lock(&fake_mutex);
+	for (const FakeCall &call : fake_calls) {
+		ret.push_back(call.uri);
+	}
+	g_mutex_unlock(&fake_mutex);
+	return ret;
+}
+
+/** RpThumbnailerTest **/
+
+class RpThumbnailerTest : public ::testing::Test
+{
+	protected:
+		RpThumbnailerTest()
+			: server(nullptr)
+			, client(nullptr)
+			, thumbnailer(nullptr)
+			, signal_id(0)
+			, cache_dir(nullptr)
+			, finished_count(0)
+		{ }
+
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		static void SetUpTestCase(void);
+		static void TearDownTestCase(void);
+
+		/**
+		 * Create the RpThumbnailer.
+		 * @param max_threads Maximum number of worker threads.
+		 */
+		void createThumbnailer(guint max_threads);
+
+		/**
+		 * Queue a thumbnail request.
+		 * @param uri URI.
+		 * @param flavor Flavor, e.g. "normal".
+		 * @param urgent Is this request urgent?
+		 * @return Handle, or 0 on error.
+		 */
+		guint queue(const char *uri, const char *flavor, bool urgent);
+
+		/**
+		 * Dequeue a thumbnail request.
+		 * @param handle Handle.
+		 * @return True on success; false on error.
+		 */
+		bool dequeue(guint handle);
+
+		/**
+		 * Wait for Finished signals.
+		 * @param count Number of Finished signals to wait for.
+		 * @return True if the signals were received; false on timeout.
+		 */
+		bool waitForFinished(unsigned int count);
+
+		/**
+		 * Get the signals received for a handle.
+		 * @param handle Handle.
+		 * @return Signals, e.g. "Started,Ready,Finished".
+		 */
+		string signalsFor(guint handle) const;
+
+	private:
+		/**
+		 * Call a thumbnailer method.
+		 * The main loop is run until the reply is received,
+		 * since the thumbnailer runs on the main thread.
+		 * @param method Method name.
+		 * @param parameters Parameters.
+		 * @return Reply, or nullptr on error. (caller must unref)
+		 */
+		GVariant *call(const char *method, GVariant *parameters);
+
+		static void call_ready(GObject *source_object, GAsyncResult *res, gpointer user_data);
+
+		static void signal_received(GDBusConnection *connection,
+			const gchar *sender_name, const gchar *object_path,
+			const gchar *interface_name, const gchar *signal_name,
+			GVariant *parameters, gpointer user_data);
+
+		static gboolean timeout_elapsed(gpointer user_data);
+
+	public:
+		static GTestDBus *bus;
+
+		GDBusConnection *server;	// Connection used by RpThumbnailer.
+		GDBusConnection *client;	// Connection used by the test.
+		RpThumbnailer *thumbnailer;
+		guint signal_id;
+		gchar *cache_dir;
+
+		// Signal received from the thumbnailer.
+		struct Signal {
+			guint handle;
+			string name;
+			string uri;	// Ready and Error only
+		};
+		vector<Signal> signals;
+		unsigned int finished_count;
+};
+
+GTestDBus *RpThumbnailerTest::bus = nullptr;
+
+/**
+ * Start a private D-Bus session bus.
+ */
+void RpThumbnailerTest::SetUpTestCase(void)
+{
+	bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+	g_test_dbus_up(bus);
+}
+
+/**
+ * Stop the private D-Bus session bus.
+ */
+void RpThumbnailerTest::TearDownTestCase(void)
+{
+	if (bus) {
+		g_test_dbus_down(bus);
+		g_object_unref(bus);
+		bus = nullptr;
+	}
+}
+
+void RpThumbnailerTest::SetUp(void)
+{
+	g_mutex_lock(&fake_mutex);
+	fake_calls.clear();
+	fake_blocked = false;
+	fake_delay_us = 0;
+	fake_active = 0;
+	fake_max_active = 0;
+	g_mutex_unlock(&fake_mutex);
+
+	signals.clear();
+	finished_count = 0;
+
+	GError *error = nullptr;
+	cache_dir = g_dir_make_tmp("RpThumbnailerTest.XXXXXX", &error);
+	ASSERT_TRUE(cache_dir != nullptr) << error->message;
+
+	const gchar *const address = g_test_dbus_get_bus_address(bus);
+	ASSERT_TRUE(address != nullptr);
+	const GDBusConnectionFlags flags = static_cast<GDBusConnectionFlags>(
+		G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+		G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION);
+	server = g_dbus_connection_new_for_address_sync(address, flags, nullptr, nullptr, &error);
+	ASSERT_TRUE(server != nullptr) << error->message;
+	client = g_dbus_connection_new_for_address_sync(address, flags, nullptr, nullptr, &error);
+	ASSERT_TRUE(client != nullptr) << error->message;
+
+	signal_id = g_dbus_connection_signal_subscribe(client,
+		g_dbus_connection_get_unique_name(server),
+		THUMBNAILER_INTERFACE, nullptr, THUMBNAILER_PATH, nullptr,
+		G_DBUS_SIGNAL_FLAGS_NONE, signal_received, this, nullptr);
+}
+
+void RpThumbnailerTest::TearDown(void)
+{
+	// Don't leave any worker threads blocked.
+	fake_release();
+
+	if (thumbnailer) {
+		g_object_unref(thumbnailer);
+		thumbnailer = nullptr;
+	}
+	if (client) {
+		if (signal_id != 0) {
+			g_dbus_connection_signal_unsubscribe(client, signal_id);
+			signal_id = 0;
+		}
+		g_dbus_connection_close_sync(client, nullptr, nullptr);
+		g_object_unref(client);
+		client = nullptr;
+	}
+	if (server) {
+		g_dbus_connection_close_sync(server, nullptr, nullptr);
+		g_object_unref(server);
+		server = nullptr;
+	}
+
+	// Process any remaining idle sources.
+	while (g_main_context_iteration(nullptr, FALSE)) { }
+
+	if (cache_dir) {
+		// Remove the thumbnail directories.
+		gchar *const normal_dir = g_build_filename(cache_dir, "thumbnails", "normal", nullptr);
+		gchar *const large_dir = g_build_filename(cache_dir, "thumbnails", "large", nullptr);
+		gchar *const thumbnails_dir = g_build_filename(cache_dir, "thumbnails", nullptr);
+		g_rmdir(normal_dir);
+		g_rmdir(large_dir);
+		g_rmdir(thumbnails_dir);
+		g_rmdir(cache_dir);
+		g_free(normal_dir);
+		g_free(large_dir);
+		g_free(thumbnails_dir);
+		g_free(cache_dir);
+		cache_dir = nullptr;
+	}
+}
+
+/**
+ * Create the RpThumbnailer.
+ * @param max_threads Maximum number of worker threads.
+ */
+void RpThumbnailerTest::createThumbnailer(guint max_threads)
+{
+	thumbnailer = rp_thumbnailer_new(server, cache_dir, fake_create_thumbnail, max_threads);
+	ASSERT_TRUE(thumbnailer != nullptr);
+	ASSERT_TRUE(rp_thumbnailer_is_exported(thumbnailer));
+}
+
+/**
+ * Queue a thumbnail request.
+ * @param uri URI.
+ * @param flavor Flavor, e.g. "normal".
+ * @param urgent Is this request urgent?
+ * @return Handle, or 0 on error.
+ */
+guint RpThumbnailerTest::queue(const char *uri, const char *flavor, bool urgent)
+{
+	GVariant *const reply = call("Queue",
+		g_variant_new("(sssb)", uri, "application/octet-stream", flavor, urgent));
+	if (!reply)
+		return 0;
+
+	guint handle = 0;
+	g_variant_get(reply, "(u)", &handle);
+	g_variant_unref(reply);
+	return handle;
+}
+
+/**
+ * Dequeue a thumbnail request.
+ * @param handle Handle.
+ * @return True on success; false on error.
+ */
+bool RpThumbnailerTest::dequeue(guint handle)
+{
+	GVariant *const reply = call("Dequeue", g_variant_new("(u)", handle));
+	if (!reply)
+		return false;
+	g_variant_unref(reply);
+	return true;
+}
+
+/**
+ * Call a thumbnailer method.
+ * The main loop is run until the reply is received,
+ * since the thumbnailer runs on the main thread.
+ * @param method Method name.
+ * @param parameters Parameters.
+ * @return Reply, or nullptr on error. (caller must unref)
+ */
+GVariant *RpThumbnailerTest::call(const char *method, GVariant *parameters)
+{
+	GAsyncResult *res = nullptr;
+	g_dbus_connection_call(client, g_dbus_connection_get_unique_name(server),
+		THUMBNAILER_PATH, THUMBNAILER_INTERFACE, method, parameters,
+		nullptr, G_DBUS_CALL_FLAGS_NONE, WAIT_TIMEOUT_SECONDS * 1000,
+		nullptr, call_ready, &res);
+	while (!res) {
+		g_main_context_iteration(nullptr, TRUE);
+	}
+
+	GError *error = nullptr;
+	GVariant *const reply = g_dbus_connection_call_finish(client, res, &error);
+	g_object_unref(res);
+	if (error) {
+		ADD_FAILURE() << method << "() failed: " << error->message;
+		g_error_free(error);
+	}
+	return reply;
+}
+
+void RpThumbnailerTest::call_ready(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	RP_UNUSED(source_object);
+	*static_cast<GAsyncResult**>(user_data) = G_ASYNC_RESULT(g_object_ref(res));
+}
+
+void RpThumbnailerTest::signal_received(GDBusConnection *connection,
+	const gchar *sender_name, const gchar *object_path,
+	const gchar *interface_name, const gchar *signal_name,
+	GVariant *parameters, gpointer user_data)
+{
+	RP_UNUSED(connection);
+	RP_UNUSED(sender_name);
+	RP_UNUSED(object_path);
+	RP_UNUSED(interface_name);
+	RpThumbnailerTest *const test = static_cast<RpThumbnailerTest*>(user_data);
+
+	Signal sig;
+	g_variant_get_child(parameters, 0, "u", &sig.handle);
+	sig.name = signal_name;
+	if (!strcmp(signal_name, "Ready") || !strcmp(signal_name, "Error")) {
+		const gchar *uri = nullptr;
+		g_variant_get_child(parameters, 1, "&s", &uri);
+		sig.uri = uri;
+	} else if (!strcmp(signal_name, "Finished")) {
+		test->finished_count++;
+	}
+	test->signals.push_back(sig);
+}
+
+gboolean RpThumbnailerTest::timeout_elapsed(gpointer user_data)
+{
+	*static_cast<bool*>(user_data) = true;
+	return FALSE;
+}
+
+/**
+ * Wait for Finished signals.
+ * @param count Number of Finished signals to wait for.
+ * @return True if the signals were received; false on timeout.
+ */
+bool RpThumbnailerTest::waitForFinished(unsigned int count)
+{
+	bool timed_out = false;
+	const guint timeout_id = g_timeout_add_seconds(WAIT_TIMEOUT_SECONDS, timeout_elapsed, &timed_out);
+	while (finished_count < count && !timed_out) {
+		g_main_context_iteration(nullptr, TRUE);
+	}
+	if (!timed_out) {
+		g_source_remove(timeout_id);
+	}
+	return (finished_count >= count);
+}
+
+/**
+ * Get the signals received for a handle.
+ * @param handle Handle.
+ * @return Signals, e.g. "Started,Ready,Finished".
+ */
+string RpThumbnailerTest::signalsFor(guint handle) const
+{
+	string ret;
+	for (const Signal &sig : signals) {
+		if (sig.handle != handle)
+			continue;
+		if (!ret.empty()) {
+			ret += ',';
+		}
+		ret += sig.name;
+	}
+	return ret;
+}
+
+/**
+ * Each request gets Started, Ready, and Finished, in that order,
+ * and the flavor selects the thumbnail size.
+ */
+TEST_F(RpThumbnailerTest, readySignals)
+{
+	ASSERT_NO_FATAL_FAILURE(createThumbnailer(4));
+
+	static const char *const uris[] = {
+		"file:///rom/a.bin", "file:///rom/b.bin",
+		"file:///rom/c.bin", "file:///rom/d.bin",
+	};
+	vector<guint> handles;
+	for (size_t i = 0; i < ARRAY_SIZE(uris); i++) {
+		const guint handle = queue(uris[i], (i & 1) ? "large" : "normal", false);
+		ASSERT_NE(0U, handle);
+		handles.push_back(handle);
+	}
+	ASSERT_TRUE(waitForFinished(ARRAY_SIZE(uris)));
+
+	for (size_t i = 0; i < ARRAY_SIZE(uris); i++) {
+		EXPECT_EQ("Started,Ready,Finished", signalsFor(handles[i])) << uris[i];
+	}
+	for (const Signal &sig : signals) {
+		if (sig.name == "Ready") {
+			const size_t i = std::find(handles.begin(), handles.end(), sig.handle) - handles.begin();
+			ASSERT_LT(i, handles.size());
+			EXPECT_EQ(uris[i], sig.uri);
+		}
+	}
+
+	g_mutex_lock(&fake_mutex);
+	ASSERT_EQ(ARRAY_SIZE(uris), fake_calls.size());
+	for (const FakeCall &call : fake_calls) {
+		const bool large = (call.uri == uris[1] || call.uri == uris[3]);
+		EXPECT_EQ(large ? 256 : 128, call.maximum_size) << call.uri;
+	}
+	g_mutex_unlock(&fake_mutex);
+}
+
+/**
+ * A failed thumbnail gets Started, Error, and Finished.
+ */
+TEST_F(RpThumbnailerTest, errorSignal)
+{
+	ASSERT_NO_FATAL_FAILURE(createThumbnailer(2));
+
+	const guint handle = queue("file:///rom/error.bin", "normal", false);
+	ASSERT_NE(0U, handle);
+	ASSERT_TRUE(waitForFinished(1));
+
+	EXPECT_EQ("Started,Error,Finished", signalsFor(handle));
+	for (const Signal &sig : signals) {
+		if (sig.name == "Error") {
+			EXPECT_EQ("file:///rom/error.bin", sig.uri);
+		}
+	}
+}
+
+/**
+ * Urgent requests are processed before requests that were queued earlier.
+ * Other requests are processed in the order they were queued.
+ */
+TEST_F(RpThumbnailerTest, urgentFirst)
+{
+	ASSERT_NO_FATAL_FAILURE(createThumbnailer(1));
+
+	// Keep the only worker thread busy while the other requests are queued.
+	g_mutex_lock(&fake_mutex);
+	fake_blocked = true;
+	g_mutex_unlock(&fake_mutex);
+	ASSERT_NE(0U, queue("file:///rom/busy.bin", "normal", false));
+	ASSERT_TRUE(fake_wait_for_calls(1));
+
+	ASSERT_NE(0U, queue("file:///rom/1.bin", "normal", false));
+	ASSERT_NE(0U, queue("file:///rom/2.bin", "normal", false));
+	ASSERT_NE(0U, queue("file:///rom/urgent.bin", "normal", true));
+	ASSERT_NE(0U, queue("file:///rom/3.bin", "normal", false));
+	fake_release();
+	ASSERT_TRUE(waitForFinished(5));
+
+	vector<string> expected;
+	expected.emplace_back("file:///rom/busy.bin");
+	expected.emplace_back("file:///rom/urgent.bin");
+	expected.emplace_back("file:///rom/1.bin");
+	expected.emplace_back("file:///rom/2.bin");
+	expected.emplace_back("file:///rom/3.bin");
+	EXPECT_EQ(expected, fake_uris());
+}
+
+/**
+ * Dequeue() skips requests that haven't been started yet.
+ * Only the Finished signal is emitted for them.
+ */
+TEST_F(RpThumbnailerTest, dequeuePending)
+{
+	ASSERT_NO_FATAL_FAILURE(createThumbnailer(1));
+
+	g_mutex_lock(&fake_mutex);
+	fake_blocked = true;
+	g_mutex_unlock(&fake_mutex);
+	const guint busy = queue("file:///rom/busy.bin", "normal", false);
+	ASSERT_NE(0U, busy);
+	ASSERT_TRUE(fake_wait_for_calls(1));
+
+	const guint cancelled = queue("file:///rom/cancelled.bin", "normal", false);
+	const guint kept = queue("file:///rom/kept.bin", "normal", false);
+	ASSERT_NE(0U, cancelled);
+	ASSERT_NE(0U, kept);
+	ASSERT_TRUE(dequeue(cancelled));
+
+	// Dequeueing the running request doesn't affect it.
+	ASSERT_TRUE(dequeue(busy));
+	fake_release();
+	ASSERT_TRUE(waitForFinished(3));
+
+	EXPECT_EQ("Started,Ready,Finished", signalsFor(busy));
+	EXPECT_EQ("Finished", signalsFor(cancelled));
+	EXPECT_EQ("Started,Ready,Finished", signalsFor(kept));
+
+	vector<string> expected;
+	expected.emplace_back("file:///rom/busy.bin");
+	expected.emplace_back("file:///rom/kept.bin");
+	EXPECT_EQ(expected, fake_uris());
+}
+
+/**
+ * No more than max_threads requests are processed at once.
+ */
+TEST_F(RpThumbnailerTest, maxThreads)
+{
+	ASSERT_NO_FATAL_FAILURE(createThumbnailer(2));
+
+	g_mutex_lock(&fake_mutex);
+	fake_delay_us = 50000;
+	g_mutex_unlock(&fake_mutex);
+
+	static const unsigned int count = 8;
+	for (unsigned int i = 0; i < count; i++) {
+		char uri[32];
+		snprintf(uri, sizeof(uri), "file:///rom/%u.bin", i);
+		ASSERT_NE(0U, queue(uri, "normal", false));
+	}
+	ASSERT_TRUE(waitForFinished(count));
+
+	g_mutex_lock(&fake_mutex);
+	EXPECT_EQ(static_cast<size_t>(count), fake_calls.size());
+	EXPECT_GE(2, fake_max_active);
+	EXPECT_LE(1, fake_max_active);
+	g_mutex_unlock(&fake_mutex);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "rp-thumbnailer-dbus test suite: Queue and worker pool tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -318,6 +318,11 @@ Q_DECL_EXPORT int rp_create_thumbnail(const char *source_file, const char *outpu
 		return RPCT_OUTPUT_FILE_FAILED;
 	}
 
+	// Thumbnails are written frequently, so use the
+	// user-selected PNG compression profile.
+	pngWriter->setCompressionProfile(static_cast<RpPngWriter::CompressionProfile>(
+		Config::instance()->thumbnailPngCompression()));
+
 	// Software.
 	static const char sw[] = "ROM Properties Page shell extension (" RP_KDE_UPPER QT_MAJOR_STR ")";
 	kv.emplace_back("Software", sw);
@@ -410,3 +415,13 @@ Q_DECL_EXPORT int rp_create_thumbnail(const char *source_file, const char *outpu
 	romData->unref();
 	return ret;
 }
+
+/**
+ * Get the maximum number of worker threads for rp-thumbnailer-dbus.
+ * @return Maximum number of worker threads. (0 for one per CPU)
+ */
+extern "C"
+Q_DECL_EXPORT unsigned int rp_thumbnailer_max_threads(void)
+{
+	return Config::instance()->thumbnailerMaxThreads();
+}
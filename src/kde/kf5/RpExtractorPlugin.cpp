@@ -18,11 +18,14 @@ using namespace LibRpBase;
 using LibRpFile::IRpFile;
 
 // libromdata
+#include "libromdata/RomDataCache.hpp"
 #include "libromdata/RomDataFactory.hpp"
+using LibRomData::RomDataCache;
 using LibRomData::RomDataFactory;
 
 // C++ STL classes.
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 // Qt includes.
@@ -78,29 +81,15 @@ QStringList RpExtractorPlugin::mimetypes(void) const
 	return mimeTypes;
 }
 
-void RpExtractorPlugin::extract(ExtractionResult *result)
+/**
+ * Add RomMetaData properties to an ExtractionResult.
+ * @param result ExtractionResult.
+ * @param metaData RomMetaData.
+ */
+static void addMetaData(ExtractionResult *result, const RomMetaData *metaData)
 {
-	// Attempt to open the ROM file.
-	IRpFile *const file = openQUrl(QUrl(result->inputUrl()), false);
-	if (!file) {
-		// Could not open the file.
-		return;
-	}
-
-	// Get the appropriate RomData class for this ROM.
-	// file is dup()'d by RomData.
-	RomData *const romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_METADATA);
-	file->unref();	// file is ref()'d by RomData.
-	if (!romData) {
-		// ROM is not supported.
-		return;
-	}
-
-	// Get the metadata properties.
-	const RomMetaData *const metaData = romData->metaData();
 	if (!metaData || metaData->empty()) {
 		// No metadata properties.
-		romData->unref();
 		return;
 	}
 
@@ -161,7 +150,54 @@ void RpExtractorPlugin::extract(ExtractionResult *result)
 		}
 	}
 
+}
+
+void RpExtractorPlugin::extract(ExtractionResult *result)
+{
+	const QUrl url(result->inputUrl());
+
+	// If the metadata cache is enabled, check it for local files.
+	string s_local_filename;
+	if (Config::instance()->enableMetaDataCache()) {
+		const QUrl localUrl = localizeQUrl(url);
+		if (!localUrl.isEmpty() && (localUrl.scheme().isEmpty() || localUrl.isLocalFile())) {
+			s_local_filename = localUrl.toLocalFile().toUtf8().constData();
+		}
+
+		if (!s_local_filename.empty()) {
+			unique_ptr<RomDataCache::Entry> entry(RomDataCache::lookup(s_local_filename.c_str()));
+			if (entry) {
+				// Found a valid cache entry.
+				addMetaData(result, entry->metaData);
+				return;
+			}
+		}
+	}
+
+	// Attempt to open the ROM file.
+	IRpFile *const file = openQUrl(url, false);
+	if (!file) {
+		// Could not open the file.
+		return;
+	}
+
+	// Get the appropriate RomData class for this ROM.
+	// file is dup()'d by RomData.
+	RomData *const romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_METADATA);
+	file->unref();	// file is ref()'d by RomData.
+	if (!romData) {
+		// ROM is not supported.
+		return;
+	}
+
+	if (!s_local_filename.empty()) {
+		// Save the results in the metadata cache.
+		// NOTE: Errors are ignored here.
+		RomDataCache::store(s_local_filename.c_str(), romData);
+	}
+
 	// Finished extracting metadata.
+	addMetaData(result, romData->metaData());
 	romData->unref();
 }
 
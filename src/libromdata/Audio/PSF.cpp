@@ -93,11 +93,14 @@ unordered_map<string, string> PSFPrivate::parseTags(off64_t tag_addr)
 #endif /* HAVE_UNORDERED_MAP_RESERVE */
 
 	// Read the rest of the file.
-	// NOTE: Maximum of 16 KB.
+	// NOTE: Maximum of 64 KB. Anything past that is ignored,
+	// since tags are supposed to be small.
 	off64_t data_len = file->size() - tag_addr - sizeof(tag_magic);
 	if (data_len <= 0) {
 		// Not enough data...
 		return kv;
+	} else if (data_len > 64*1024) {
+		data_len = 64*1024;
 	}
 
 	// NOTE: Values may be encoded as either cp1252/sjis or UTF-8.
@@ -23,6 +23,7 @@ using LibRpTexture::rp_image;
 using LibRpTexture::SegaPVR;
 
 // DiscReader
+#include "librpbase/disc/PartitionFile.hpp"
 #include "disc/Cdrom2352Reader.hpp"
 #include "disc/IsoPartition.hpp"
 #include "disc/GdiReader.hpp"
@@ -917,4 +918,26 @@ int Dreamcast::loadInternalImage(ImageType imageType, const rp_image **pImage)
 		d->load0GDTEX);	// func
 }
 
+/**
+ * Open the data to hash for the "Hashes" tab.
+ *
+ * For GD-ROM cuesheets, this is the disc image as read by
+ * the GdiReader, whose track files are hashed instead of
+ * the .gdi file itself.
+ *
+ * @return IRpFile*, or nullptr if there's nothing to hash. (Must be unref()'d by the caller.)
+ */
+IRpFile *Dreamcast::openHashSource(void)
+{
+	RP_D(Dreamcast);
+	if (d->discType != DreamcastPrivate::DISC_GDI) {
+		// Hash the disc image file directly.
+		return super::openHashSource();
+	} else if (!d->file || !d->gdiReader) {
+		// File isn't open.
+		return nullptr;
+	}
+	return new PartitionFile(d->gdiReader, 0, d->gdiReader->size());
+}
+
 }
@@ -23,6 +23,7 @@
 #include "librpfile/DualFile.hpp"
 #include "librpfile/RelatedFile.hpp"
 #include "librpbase/SystemRegion.hpp"
+#include "librpbase/disc/PartitionFile.hpp"
 using namespace LibRpBase;
 using namespace LibRpFile;
 using LibRpTexture::rp_image;
@@ -2174,4 +2175,24 @@ int GameCube::extURLs(ImageType imageType, vector<ExtURL> *pExtURLs, int size) c
 	return 0;
 }
 
+/**
+ * Open the data to hash for the "Hashes" tab.
+ *
+ * This is the disc image as read by the disc reader, so
+ * WBFS, CISO, and NASOS images are hashed as if they were
+ * plain disc images. Wii partitions are not decrypted,
+ * since disc dumps are hashed with encryption intact.
+ *
+ * @return IRpFile*, or nullptr if there's nothing to hash. (Must be unref()'d by the caller.)
+ */
+IRpFile *GameCube::openHashSource(void)
+{
+	RP_D(GameCube);
+	if (!d->file || !d->discReader) {
+		// File isn't open.
+		return nullptr;
+	}
+	return new PartitionFile(d->discReader, 0, d->discReader->size());
+}
+
 }
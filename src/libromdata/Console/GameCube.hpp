@@ -20,6 +20,7 @@ ROMDATA_DECL_IMGSUPPORT()
 ROMDATA_DECL_IMGPF()
 ROMDATA_DECL_IMGINT()
 ROMDATA_DECL_IMGEXT()
+ROMDATA_DECL_HASHSOURCE()
 ROMDATA_DECL_END()
 
 }
@@ -891,6 +891,7 @@ const char *const *MegaDrive::supportedFileExtensions_static(void)
 		".md",	// conflicts with Markdown
 		".bin",	// too generic
 		".iso",	// too generic
+		".cue",	// Sega CD cue sheet
 
 		nullptr
 	};
@@ -16,7 +16,7 @@
 using namespace LibRpBase;
 using LibRpFile::IRpFile;
 
-// CD-ROM reader
+// CD-ROM readers
 #include "disc/Cdrom2352Reader.hpp"
 
 // Other RomData subclasses
@@ -456,6 +456,7 @@ const char *const *SegaSaturn::supportedFileExtensions_static(void)
 	static const char *const exts[] = {
 		".iso",	// ISO-9660 (2048-byte)
 		".bin",	// Raw (2352-byte)
+		".cue",	// Cue sheet
 
 		// TODO: Add these formats?
 		//".cdi",	// DiscJuggler
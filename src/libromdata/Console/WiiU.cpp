@@ -21,6 +21,7 @@ using LibRpFile::IRpFile;
 
 // DiscReader
 #include "librpbase/disc/DiscReader.hpp"
+#include "librpbase/disc/PartitionFile.hpp"
 #include "disc/WuxReader.hpp"
 #include "disc/wux_structs.h"
 
@@ -653,4 +654,22 @@ int WiiU::extURLs(ImageType imageType, vector<ExtURL> *pExtURLs, int size) const
 	return 0;
 }
 
+/**
+ * Open the data to hash for the "Hashes" tab.
+ *
+ * This is the disc image as read by the disc reader,
+ * so WUX images are hashed as if they were WUD images.
+ *
+ * @return IRpFile*, or nullptr if there's nothing to hash. (Must be unref()'d by the caller.)
+ */
+IRpFile *WiiU::openHashSource(void)
+{
+	RP_D(WiiU);
+	if (!d->file || !d->discReader) {
+		// File isn't open.
+		return nullptr;
+	}
+	return new PartitionFile(d->discReader, 0, d->discReader->size());
+}
+
 }
@@ -30,8 +30,7 @@ using LibRpTexture::rp_image;
 #endif /* ENABLE_DECRYPTION */
 
 #ifdef ENABLE_LIBMSPACK
-# include "mspack.h"
-# include "xenia_lzx.h"
+# include "../disc/XEX_LZX_Stream.hpp"
 #endif /* ENABLE_LIBMSPACK */
 
 // C++ STL classes.
@@ -721,193 +720,28 @@ CBCReader *Xbox360_XEX_Private::initPeReader(void)
 			}
 
 			// Window size.
-			// NOTE: Technically part of XEX2_Compression_Normal_Header,
-			// but we're not using that in order to be
-			// able to swap lzx_blocks.
 			const uint8_t *p = u8_ffi.data() + sizeof(fileFormatInfo);
 			const uint32_t *const pWindowSize =
 				reinterpret_cast<const uint32_t*>(p);
 			const uint32_t window_size = be32_to_cpu(*pWindowSize);
 
 			// First block.
-			XEX2_Compression_Normal_Info first_block, lzx_blocks[2];
-			unsigned int lzx_idx = 0;
-			memcpy(&first_block, p+sizeof(window_size), sizeof(first_block));
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-			first_block.block_size = be32_to_cpu(first_block.block_size);
-#endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
-			memcpy(&lzx_blocks[0], &first_block, sizeof(first_block));
 			// First block header is stored in the XEX header.
 			// Second block header is stored at the beginning of the compressed data.
+			XEX2_Compression_Normal_Info first_block;
+			memcpy(&first_block, p+sizeof(window_size), sizeof(first_block));
+			first_block.block_size = be32_to_cpu(first_block.block_size);
 
 			// NOTE: We can't easily randomly seek within the compressed data,
 			// since the uncompressed block size isn't stored anywhere.
-			// We'll have to load the entire executable into memory,
-			// save the relevant portions, then free it.
-			// FIXME: It *might* be possible to randomly seek...
-			// Need to analyze the format more.
-			const off64_t fileSize = file->size();
-			if (fileSize > 64*1024*1024 || image_size > 64*1024*1024) {
-				// 64 MB is our compressed and uncompressed limit.
-				delete reader[0];
-				delete reader[1];
-				return nullptr;
-			}
-
-			// Compressed EXE buffer.
-			// We have to de-block the compressed data first.
-			const size_t compressed_size = static_cast<size_t>(fileSize) - xex2Header.pe_offset;
-			unique_ptr<uint8_t[]> compressed_deblock(new uint8_t[compressed_size]);
-
-			// Pointer within the deblocked compressed data.
-			uint8_t *p_dblk = compressed_deblock.get();
-			uint8_t *const p_dblk_end = p_dblk + compressed_size;
-
-			// CBCReader index.
-			// If a block size is invalid, we'll switch to the other one.
-			// If both are invalid, we have a problem.
-			unsigned int rd_idx = (reader[0] ? 0 : 1);
-			if (!reader[rd_idx]) {
-				// No readers available...
-				return nullptr;
-			}
-
-			// Start at the beginning.
-			reader[rd_idx]->rewind();
-
-			// Based on: https://github.com/xenia-project/xenia/blob/5f764fc752c82674981a9f402f1bbd96b399112a/src/xenia/cpu/xex_module.cc
-			while (lzx_blocks[lzx_idx].block_size != 0) {
-				// Read the next block header.
-				size = reader[rd_idx]->read(&lzx_blocks[!lzx_idx], sizeof(lzx_blocks[!lzx_idx]));
-				if (size != sizeof(lzx_blocks[!lzx_idx])) {
-					// Seek and/or read error.
-					delete reader[0];
-					delete reader[1];
-					return nullptr;
-				}
-
-				// Does the block size make sense?
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-				lzx_blocks[!lzx_idx].block_size = be32_to_cpu(lzx_blocks[!lzx_idx].block_size);
-#endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
-				if (lzx_blocks[!lzx_idx].block_size > 65536) {
-					// Block size is invalid.
-					// Switch to the other reader.
-					if (rd_idx == 1) {
-						// No more readers...
-						delete reader[1];
-						return nullptr;
-					}
-					delete reader[0];
-					reader[0] = nullptr;
-
-					// reader[1] might be nullptr here...
-					if (!reader[1]) {
-						// Cannot continue.
-						return nullptr;
-					}
-					rd_idx = 1;
-
-					// Restart decompression in case the first few blocks
-					// were decompressed without any "errors".
-					// TODO: Also do this for errors after reading the block size?
-					reader[1]->rewind();
-					lzx_idx = 0;
-					memcpy(&lzx_blocks[0], &first_block, sizeof(first_block));
-					p_dblk = compressed_deblock.get();
-					continue;
-				}
-
-				// Read the current block.
-				uint32_t block_size = lzx_blocks[lzx_idx].block_size;
-				assert(block_size > sizeof(lzx_blocks[!lzx_idx]));
-				if (block_size <= sizeof(lzx_blocks[!lzx_idx])) {
-					// Block is missing the "next block" header...
-					delete reader[0];
-					delete reader[1];
-					return nullptr;
-				}
-				block_size -= sizeof(lzx_blocks[!lzx_idx]);
-
-				while (block_size > 2) {
-					// Get the chunk size.
-					uint16_t chunk_size;
-					size = reader[rd_idx]->read(&chunk_size, sizeof(chunk_size));
-					if (size != sizeof(chunk_size)) {
-						// Seek and/or read error.
-						delete reader[0];
-						delete reader[1];
-						return nullptr;
-					}
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-					chunk_size = be16_to_cpu(chunk_size);
-#endif /* SYS_BYTEORDER = SYS_LIL_ENDIAN */
-					block_size -= 2;
-					if (chunk_size == 0 || chunk_size > block_size) {
-						// End of block, or not enough data is available.
-						break;
-					}
-
-					// Do we have enough space?
-					if (p_dblk + chunk_size >= p_dblk_end) {
-						// Out of memory.
-						// TODO: Error reporting.
-						delete reader[0];
-						delete reader[1];
-						return nullptr;
-					}
-
-					size = reader[rd_idx]->read(p_dblk, chunk_size);
-					if (size != chunk_size) {
-						// Seek and/or read error.
-						delete reader[0];
-						delete reader[1];
-						return nullptr;
-					}
-
-					p_dblk += chunk_size;
-					block_size -= chunk_size;
-				}
-				if (block_size > 0) {
-					// Empty data at the end of the block.
-					// TODO: Error handling.
-					// TODO: SEEK_CUR?
-					reader[rd_idx]->seek(reader[rd_idx]->tell() + block_size);
-				}
-
-				// Next block.
-				lzx_idx = !lzx_idx;
-			}
-
-			// Decompress the data.
-			unique_ptr<uint8_t[]> decompressed_exe(new uint8_t[image_size]);
-			int res = lzx_decompress(compressed_deblock.get(),
-				static_cast<size_t>(p_dblk - compressed_deblock.get()),
-				decompressed_exe.get(), image_size,
-				window_size, nullptr, 0);
-			if (res != MSPACK_ERR_OK) {
-				// Error decompressing the data.
-				delete reader[0];
-				delete reader[1];
-				return nullptr;
-			}
-
-			// Verify the MZ header.
-			uint16_t mz;
-			memcpy(&mz, decompressed_exe.get(), sizeof(mz));
-			if (mz != cpu_to_be16('MZ')) {
-				// MZ header is not valid.
-				// TODO: Other checks?
-				delete reader[0];
-				delete reader[1];
-				return nullptr;
-			}
+			// The executable is decompressed as a stream, and decompression
+			// stops once the PE header and XDBF section have been saved.
 
-			// Copy the PE header.
+			// Allocate the PE header.
 			lzx_peHeader.resize(PE_HEADER_SIZE);
-			memcpy(lzx_peHeader.data(), decompressed_exe.get(), PE_HEADER_SIZE);
 
-			// Copy the XDBF section.
+			// Allocate the XDBF section.
+			uint32_t xdbf_physaddr = 0;
 			const XEX2_Resource_Info *const pResInfo = getXdbfResInfo();
 			if (pResInfo) {
 				const uint32_t load_address = be32_to_cpu(
@@ -915,15 +749,39 @@ CBCReader *Xbox360_XEX_Private::initPeReader(void)
 						? secInfo.xex2.load_address
 						: secInfo.xex1.load_address));
 
-				const uint32_t xdbf_physaddr = pResInfo->vaddr - load_address;
-				if (xdbf_physaddr + pResInfo->size <= image_size) {
+				// NOTE: XDBF sections are limited to 16 MB.
+				xdbf_physaddr = pResInfo->vaddr - load_address;
+				if (pResInfo->size <= 16*1024*1024 &&
+				    static_cast<uint64_t>(xdbf_physaddr) + pResInfo->size <= image_size)
+				{
 					lzx_xdbfSection.resize(pResInfo->size);
-					memcpy(lzx_xdbfSection.data(),
-						decompressed_exe.get() + xdbf_physaddr,
-						pResInfo->size);
 				}
 			}
 
+			// Try each CBCReader until the PE header is decompressed correctly.
+			XEX_LZX_Stream::Range ranges[2];
+			unsigned int rangeCount = 1;
+			ranges[0].address = 0;
+			ranges[0].buf = lzx_peHeader.data();
+			ranges[0].size = lzx_peHeader.size();
+			if (!lzx_xdbfSection.empty()) {
+				ranges[1].address = xdbf_physaddr;
+				ranges[1].buf = lzx_xdbfSection.data();
+				ranges[1].size = lzx_xdbfSection.size();
+				rangeCount++;
+			}
+			const int rd_idx = XEX_LZX_Stream::decompressPE(
+				reader.data(), static_cast<unsigned int>(reader.size()),
+				first_block, ranges, rangeCount, image_size, window_size);
+			if (rd_idx < 0) {
+				// Unable to decompress the executable.
+				lzx_peHeader.clear();
+				lzx_xdbfSection.clear();
+				delete reader[0];
+				delete reader[1];
+				return nullptr;
+			}
+
 			// Save the correct reader.
 			this->peReader = reader[rd_idx];
 			reader[rd_idx] = nullptr;
@@ -304,6 +304,45 @@ void EXEPrivate::addFields_VS_VERSION_INFO(const VS_FIXEDFILEINFO *pVsFfi, const
 	fields->addField_listData("StringFileInfo", &params);
 }
 
+/**
+ * Tab loader for the "Version" tab. (NE, PE)
+ * @param fields RomFields object.
+ * @param userdata EXEPrivate.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int EXEPrivate::loadTab_Version(RomFields *fields, void *userdata)
+{
+	EXEPrivate *const d = static_cast<EXEPrivate*>(userdata);
+	assert(fields == d->fields);
+	RP_UNUSED(fields);
+
+	// Load resources.
+	int ret;
+	if (d->exeType == EXE_TYPE_NE) {
+		ret = d->loadNEResourceTable();
+	} else {
+		ret = d->loadPEResourceTypes();
+	}
+	if (ret != 0 || !d->rsrcReader) {
+		// Unable to load resources.
+		return (ret != 0 ? ret : -ENOENT);
+	}
+
+	// Load the version resource.
+	// NOTE: load_VS_VERSION_INFO loads it in host-endian.
+	VS_FIXEDFILEINFO vsffi;
+	IResourceReader::StringFileInfo vssfi;
+	ret = d->rsrcReader->load_VS_VERSION_INFO(VS_VERSION_INFO, -1, &vsffi, &vssfi);
+	if (ret != 0) {
+		// Unable to load the version resource.
+		return ret;
+	}
+
+	// Add the version fields.
+	d->addFields_VS_VERSION_INFO(&vsffi, &vssfi);
+	return 0;
+}
+
 /** MZ-specific **/
 
 /**
@@ -410,29 +410,10 @@ void EXEPrivate::addFields_NE(void)
 		fields->addField_string(C_("EXE", "Runtime DLL"), runtime_dll);
 	}
 
-	// Load resources.
-	ret = loadNEResourceTable();
-	if (ret != 0 || !rsrcReader) {
-		// Unable to load resources.
-		// We're done here.
-		return;
-	}
-
-	// Load the version resource.
-	// NOTE: load_VS_VERSION_INFO loads it in host-endian.
-	VS_FIXEDFILEINFO vsffi;
-	IResourceReader::StringFileInfo vssfi;
-	ret = rsrcReader->load_VS_VERSION_INFO(VS_VERSION_INFO, -1, &vsffi, &vssfi);
-	if (ret != 0) {
-		// Unable to load the version resource.
-		// We're done here.
-		return;
-	}
-
-	// Add the version fields.
-	fields->setTabName(1, C_("EXE", "Version"));
-	fields->setTabIndex(1);
-	addFields_VS_VERSION_INFO(&vsffi, &vssfi);
+	// Version resource.
+	// NOTE: Loading resources is expensive, so the
+	// version fields won't be added until requested.
+	fields->addTab_deferred(C_("EXE", "Version"), loadTab_Version, this);
 }
 
 }
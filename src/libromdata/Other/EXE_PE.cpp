@@ -617,34 +617,13 @@ void EXEPrivate::addFields_PE(void)
 		fields->addField_string(C_("EXE", "Runtime DLL"), runtime_dll);
 	}
 
-	// Load resources.
-	ret = loadPEResourceTypes();
-	if (ret != 0 || !rsrcReader) {
-		// Unable to load resources.
-		// We're done here.
-		return;
-	}
-
-	// Load the version resource.
-	// NOTE: load_VS_VERSION_INFO loads it in host-endian.
-	VS_FIXEDFILEINFO vsffi;
-	IResourceReader::StringFileInfo vssfi;
-	ret = rsrcReader->load_VS_VERSION_INFO(VS_VERSION_INFO, -1, &vsffi, &vssfi);
-	if (ret != 0) {
-		// Unable to load the version resource.
-		// We're done here.
-		return;
-	}
-
-	// Add the version fields.
-	fields->setTabName(1, C_("EXE", "Version"));
-	fields->setTabIndex(1);
-	addFields_VS_VERSION_INFO(&vsffi, &vssfi);
-
+	// Version resource and manifest.
+	// NOTE: Loading resources is expensive, so these
+	// tabs won't be added until requested.
+	fields->addTab_deferred(C_("EXE", "Version"), loadTab_Version, this);
 #ifdef ENABLE_XML
-	// Parse the manifest if it's present.
 	// TODO: Support external manifests, e.g. program.exe.manifest?
-	addFields_PE_Manifest();
+	fields->addTab_deferred(C_("EXE", "Manifest"), loadTab_PE_Manifest, this);
 #endif /* ENABLE_XML */
 }
 
@@ -36,8 +36,31 @@ namespace LibRomData {
 extern int DelayLoad_test_TinyXML2(void);
 #endif /* defined(_MSC_VER) && defined(XML_IS_DLL) */
 
+/**
+ * Tab loader for the "Manifest" tab. (PE)
+ * @param fields RomFields object.
+ * @param userdata EXEPrivate.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int EXEPrivate::loadTab_PE_Manifest(RomFields *fields, void *userdata)
+{
+	EXEPrivate *const d = static_cast<EXEPrivate*>(userdata);
+	assert(fields == d->fields);
+	RP_UNUSED(fields);
+
+	// Load resources.
+	int ret = d->loadPEResourceTypes();
+	if (ret != 0 || !d->rsrcReader) {
+		// Unable to load resources.
+		return (ret != 0 ? ret : -ENOENT);
+	}
+
+	return d->addFields_PE_Manifest();
+}
+
 /**
  * Add fields from the Win32 manifest resource.
+ * NOTE: The PE resources must be loaded before calling this function.
  * @return 0 on success; negative POSIX error code on error.
  */
 int EXEPrivate::addFields_PE_Manifest(void)
@@ -137,8 +160,7 @@ int EXEPrivate::addFields_PE_Manifest(void)
 	}
 
 	// Add the manifest fields.
-	fields->addTab(C_("EXE", "Manifest"));
-
+	// NOTE: The "Manifest" tab is selected by the caller.
 	// Manifest ID.
 	fields->addField_string(C_("EXE|Manifest", "Manifest ID"), resource_ids[id_idx].name);
 
@@ -86,6 +86,14 @@ class EXEPrivate : public LibRpBase::RomDataPrivate
 		 */
 		void addFields_VS_VERSION_INFO(const VS_FIXEDFILEINFO *pVsFfi, const IResourceReader::StringFileInfo *pVsSfi);
 
+		/**
+		 * Tab loader for the "Version" tab. (NE, PE)
+		 * @param fields RomFields object.
+		 * @param userdata EXEPrivate.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int loadTab_Version(LibRpBase::RomFields *fields, void *userdata);
+
 		/** MZ-specific **/
 
 		/**
@@ -175,9 +183,18 @@ class EXEPrivate : public LibRpBase::RomDataPrivate
 #ifdef ENABLE_XML
 		/**
 		 * Add fields from the Win32 manifest resource.
+		 * NOTE: The PE resources must be loaded before calling this function.
 		 * @return 0 on success; negative POSIX error code on error.
 		 */
 		int addFields_PE_Manifest(void);
+
+		/**
+		 * Tab loader for the "Manifest" tab. (PE)
+		 * @param fields RomFields object.
+		 * @param userdata EXEPrivate.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int loadTab_PE_Manifest(LibRpBase::RomFields *fields, void *userdata);
 #endif /* ENABLE_XML */
 };
 
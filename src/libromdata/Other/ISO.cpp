@@ -333,6 +333,7 @@ const char *const *ISO::supportedFileExtensions_static(void)
 		".iso9660",	// ISO (listed in shared-mime-info)
 		".bin",		// BIN (2352-byte)
 		".xiso",	// Xbox ISO image
+		".cue",		// Cue sheet
 		// TODO: More?
 
 		nullptr
@@ -356,6 +357,7 @@ const char *const *ISO::supportedMimeTypes_static(void)
 		// Unofficial MIME types from FreeDesktop.org.
 		"application/x-cd-image",
 		"application/x-iso9660-image",
+		"application/x-cue",
 
 		// TODO: BIN (2352)?
 		nullptr
@@ -345,4 +345,36 @@ int RpTextureWrapper::loadInternalImage(ImageType imageType, const rp_image **pI
 		d->texture->image);	// func
 }
 
+/**
+ * Get an internal image for a thumbnail of the requested size.
+ *
+ * If the texture has mipmaps, the smallest mipmap that's at least
+ * req_size is returned, so the full image doesn't need to be decoded.
+ *
+ * @param imageType	[in] Image type to load.
+ * @param req_size	[in] Requested size. (single dimension; assuming square image)
+ * @param pFullSize	[out,opt] Two-element array for the full image size. [width, height]
+ * @return Internal image, or nullptr if the ROM doesn't have one.
+ */
+const rp_image *RpTextureWrapper::imageForSize(ImageType imageType, int req_size, int pFullSize[2]) const
+{
+	RP_D(const RpTextureWrapper);
+	if (imageType != IMG_INT_IMAGE || !d->isValid || !d->texture || req_size <= 0) {
+		// Use the full image.
+		return super::imageForSize(imageType, req_size, pFullSize);
+	}
+
+	const rp_image *const img = d->texture->mipmapForSize(req_size);
+	if (img && pFullSize) {
+		// Full image size is the size of mipmap 0.
+		pFullSize[0] = d->texture->width();
+		pFullSize[1] = d->texture->height();
+		if (pFullSize[0] <= 0 || pFullSize[1] <= 0) {
+			pFullSize[0] = img->width();
+			pFullSize[1] = img->height();
+		}
+	}
+	return img;
+}
+
 }
@@ -0,0 +1,876 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * RomDataCache.cpp: Persistent RomData metadata cache.                    *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "config.version.h"
+#include "config.libromdata.h"
+#include "RomDataCache.hpp"
+
+// librpbase, librpfile
+#include "librpbase/RomMetaData.hpp"
+#include "librpfile/RpFile.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// librpthreads
+#include "librpthreads/Atomics.h"
+
+// C includes.
+#ifdef _WIN32
+# include "libwin32common/RpWin32_sdk.h"
+# include "librpbase/TextFuncs_wchar.hpp"
+# define RPMC_DIR_SEP_CHR '\\'
+#else /* !_WIN32 */
+# include <dirent.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# define RPMC_DIR_SEP_CHR '/'
+#endif /* _WIN32 */
+
+// C++ STL classes.
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Cache file format.
+// All integers in the header are little-endian.
+// The body uses LEB128 variable-length integers.
+#define RPMC_MAGIC		'RPMC'
+#define RPMC_VERSION		3
+
+// Header flags.
+#define RPMC_FLAG_HAS_METADATA	(1U << 0)
+
+// Maximum size of a single cache entry.
+#define RPMC_MAX_ENTRY_SIZE	(4U*1024*1024)
+
+// Cache size limits. The least-recently used entries
+// are deleted if either of these limits is exceeded.
+#define RPMC_MAX_ENTRIES	4096
+#define RPMC_MAX_TOTAL_SIZE	(32U*1024*1024)
+
+// Check the cache size limits every N calls to store().
+// The limits are also checked on the first call.
+#define RPMC_PRUNE_INTERVAL	64
+
+// Temporary files older than this many seconds were left
+// behind by a process that crashed, and are deleted by prune().
+#define RPMC_STALE_TMP_AGE	3600
+
+namespace LibRomData {
+
+#pragma pack(1)
+/**
+ * Cache file header.
+ * Followed by the source filename, the rom-properties
+ * version string, and the serialized body.
+ */
+typedef struct PACKED _RPMC_Header {
+	uint32_t magic;		// [0x000] 'RPMC'
+	uint32_t version;	// [0x004] RPMC_VERSION
+	uint32_t flags;		// [0x008] RPMC_FLAG_*
+	uint32_t body_size;	// [0x00C] Size of the serialized body.
+	uint64_t file_size;	// [0x010] Source file size.
+	int64_t mtime;		// [0x018] Source file mtime.
+	uint64_t inode;		// [0x020] Source file inode number. (0 if not available)
+	uint32_t mtime_nsec;	// [0x028] Source file mtime, nanoseconds. (0 if not available)
+	uint16_t path_len;	// [0x02C] Length of the source filename.
+	uint16_t version_len;	// [0x02E] Length of the version string.
+} RPMC_Header;
+ASSERT_STRUCT(RPMC_Header, 0x30);
+#pragma pack()
+
+class RomDataCachePrivate
+{
+	private:
+		// Static class.
+		RomDataCachePrivate();
+		~RomDataCachePrivate();
+		RP_DISABLE_COPY(RomDataCachePrivate)
+
+	public:
+		/**
+		 * Source file identity.
+		 */
+		struct FileKey {
+			uint64_t file_size;
+			int64_t mtime;
+			uint32_t mtime_nsec;
+			uint64_t inode;
+		};
+
+		/**
+		 * Get the identity of a source file.
+		 * @param filename	[in] Source filename.
+		 * @param key		[out] File key.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int getFileKey(const char *filename, FileKey &key);
+
+		/**
+		 * Get the cache directory for metadata entries.
+		 * @return Metadata cache directory, with a trailing separator, or empty string on error.
+		 */
+		static string getMetaDataCacheDir(void);
+
+		/**
+		 * Get the cache filename for a source file.
+		 * @param filename Source filename.
+		 * @return Cache filename, or empty string on error.
+		 */
+		static string getCacheFilename(const char *filename);
+
+		/**
+		 * Delete the least-recently used entries if the cache is too large.
+		 * Stale temporary files are also deleted.
+		 * @param cacheDir Metadata cache directory, with a trailing separator.
+		 */
+		static void prune(const string &cacheDir);
+
+		/**
+		 * Is a filename in the cache directory a temporary file?
+		 * @param name Filename, without the directory.
+		 * @return True if it's a temporary file created by createTempFile().
+		 */
+		static bool isTempFile(const char *name);
+
+		/**
+		 * Create an empty temporary file with a unique name.
+		 * @param cacheFilename	[in] Cache filename.
+		 * @param tmpFilename	[out] Temporary filename.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int createTempFile(const string &cacheFilename, string &tmpFilename);
+
+		/**
+		 * Rename a file, replacing the destination if it exists.
+		 * @param oldName Old filename.
+		 * @param newName New filename.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int replaceFile(const string &oldName, const string &newName);
+
+		// Number of calls to store().
+		static volatile int store_count;
+
+	public:
+		/**
+		 * Cache entry serializer.
+		 */
+		class Writer {
+			public:
+				void u8(uint8_t val)
+				{
+					buf.push_back(static_cast<char>(val));
+				}
+
+				void uv(uint64_t val)
+				{
+					// Unsigned LEB128.
+					while (val >= 0x80) {
+						buf.push_back(static_cast<char>((val & 0x7F) | 0x80));
+						val >>= 7;
+					}
+					buf.push_back(static_cast<char>(val));
+				}
+
+				void sv(int64_t val)
+				{
+					// Zigzag encoding.
+					uv((static_cast<uint64_t>(val) << 1) ^ static_cast<uint64_t>(val >> 63));
+				}
+
+				/** Nullable types. The length is stored as n+1; 0 is nullptr. **/
+
+				void str(const string *s)
+				{
+					if (!s) {
+						uv(0);
+						return;
+					}
+					uv(s->size() + 1);
+					buf.append(*s);
+				}
+
+			public:
+				string buf;
+		};
+
+		/**
+		 * Cache entry deserializer.
+		 * If the data is truncated, ok is set to false,
+		 * and all subsequent reads return 0 or empty values.
+		 */
+		class Reader {
+			public:
+				Reader(const uint8_t *p, size_t size)
+					: p(p), end(p + size), ok(true) { }
+
+				uint8_t u8(void)
+				{
+					if (p >= end) {
+						ok = false;
+						return 0;
+					}
+					return *p++;
+				}
+
+				uint64_t uv(void)
+				{
+					// Unsigned LEB128.
+					uint64_t val = 0;
+					for (unsigned int shift = 0; shift < 64; shift += 7) {
+						if (p >= end) {
+							ok = false;
+							return 0;
+						}
+						const uint8_t b = *p++;
+						val |= static_cast<uint64_t>(b & 0x7F) << shift;
+						if (!(b & 0x80)) {
+							return val;
+						}
+					}
+
+					// Too many continuation bytes.
+					ok = false;
+					return 0;
+				}
+
+				int64_t sv(void)
+				{
+					// Zigzag encoding.
+					const uint64_t val = uv();
+					return static_cast<int64_t>((val >> 1) ^ (~(val & 1) + 1));
+				}
+
+				/**
+				 * Read a count, making sure it's plausible for the remaining data.
+				 * Each element takes up at least one byte.
+				 * @return Count.
+				 */
+				size_t count(void)
+				{
+					const uint64_t n = uv();
+					if (n > static_cast<uint64_t>(end - p)) {
+						ok = false;
+						return 0;
+					}
+					return static_cast<size_t>(n);
+				}
+
+				/**
+				 * Read a nullable count. (n+1; 0 is nullptr)
+				 * @return Count.
+				 */
+				size_t countN(void)
+				{
+					const uint64_t n = uv();
+					if (n > static_cast<uint64_t>(end - p) + 1) {
+						ok = false;
+						return 0;
+					}
+					return static_cast<size_t>(n);
+				}
+
+				/** Nullable types. The length is stored as n+1; 0 is nullptr. **/
+
+				string *strN(void)
+				{
+					const size_t len = countN();
+					if (len == 0) {
+						return nullptr;
+					}
+					string *const s = new string(reinterpret_cast<const char*>(p), len - 1);
+					p += len - 1;
+					return s;
+				}
+
+			private:
+				const uint8_t *p;
+				const uint8_t *const end;
+			public:
+				bool ok;
+		};
+
+		/**
+		 * Serialize RomMetaData.
+		 * @param w	[in/out] Writer.
+		 * @param metaData	[in] RomMetaData.
+		 */
+		static void writeMetaData(Writer &w, const RomMetaData *metaData);
+
+		/**
+		 * Deserialize RomMetaData.
+		 * @param r Reader.
+		 * @return RomMetaData, or nullptr on error.
+		 */
+		static RomMetaData *readMetaData(Reader &r);
+};
+
+/** RomDataCachePrivate **/
+
+volatile int RomDataCachePrivate::store_count = 0;
+
+/**
+ * Get the identity of a source file.
+ * @param filename	[in] Source filename.
+ * @param key		[out] File key.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCachePrivate::getFileKey(const char *filename, FileKey &key)
+{
+#ifdef _WIN32
+	// TODO: Use the file index from GetFileInformationByHandle()?
+	off64_t file_size;
+	time_t mtime;
+	int ret = FileSystem::get_file_size_and_mtime(filename, &file_size, &mtime);
+	if (ret != 0) {
+		return ret;
+	}
+	key.file_size = static_cast<uint64_t>(file_size);
+	key.mtime = static_cast<int64_t>(mtime);
+	key.mtime_nsec = 0;
+	key.inode = 0;
+#else /* !_WIN32 */
+	struct stat sb;
+	if (stat(filename, &sb) != 0) {
+		return -errno;
+	} else if (!S_ISREG(sb.st_mode)) {
+		// Only regular files can be cached.
+		return -ENOTSUP;
+	}
+	key.file_size = static_cast<uint64_t>(sb.st_size);
+	key.mtime = static_cast<int64_t>(sb.st_mtime);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	// Files that are rewritten within the same second
+	// can only be distinguished by the nanoseconds.
+	key.mtime_nsec = static_cast<uint32_t>(sb.st_mtim.tv_nsec);
+#else /* !HAVE_STRUCT_STAT_ST_MTIM */
+	key.mtime_nsec = 0;
+#endif /* HAVE_STRUCT_STAT_ST_MTIM */
+	key.inode = static_cast<uint64_t>(sb.st_ino);
+#endif /* _WIN32 */
+	return 0;
+}
+
+/**
+ * Get the cache directory for metadata entries.
+ * @return Metadata cache directory, with a trailing separator, or empty string on error.
+ */
+string RomDataCachePrivate::getMetaDataCacheDir(void)
+{
+	string cacheDir = FileSystem::getCacheDirectory();
+	if (cacheDir.empty()) {
+		return cacheDir;
+	}
+	if (cacheDir.at(cacheDir.size()-1) != RPMC_DIR_SEP_CHR) {
+		cacheDir += RPMC_DIR_SEP_CHR;
+	}
+	cacheDir += "metadata";
+	cacheDir += RPMC_DIR_SEP_CHR;
+	return cacheDir;
+}
+
+/**
+ * Get the cache filename for a source file.
+ * @param filename Source filename.
+ * @return Cache filename, or empty string on error.
+ */
+string RomDataCachePrivate::getCacheFilename(const char *filename)
+{
+	string cacheFilename = getMetaDataCacheDir();
+	if (cacheFilename.empty()) {
+		return cacheFilename;
+	}
+
+	// The entry name is the 64-bit FNV-1a hash of the source filename.
+	// Hash collisions are handled by storing the full filename
+	// in the cache entry.
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (const char *p = filename; *p != '\0'; p++) {
+		hash ^= static_cast<uint8_t>(*p);
+		hash *= 0x100000001B3ULL;
+	}
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%08X%08X.bin",
+		static_cast<unsigned int>(hash >> 32),
+		static_cast<unsigned int>(hash & 0xFFFFFFFFU));
+	cacheFilename += buf;
+	return cacheFilename;
+}
+
+/**
+ * Is a filename in the cache directory a temporary file?
+ * @param name Filename, without the directory.
+ * @return True if it's a temporary file created by createTempFile().
+ */
+bool RomDataCachePrivate::isTempFile(const char *name)
+{
+	const size_t len = strlen(name);
+#ifdef _WIN32
+	// "rpm????.tmp"
+	return (len > 7 && !_strnicmp(name, "rpm", 3) && !_stricmp(&name[len-4], ".tmp"));
+#else /* !_WIN32 */
+	// "*.bin.XXXXXX"
+	return (len > 11 && !memcmp(&name[len-11], ".bin.", 5));
+#endif /* _WIN32 */
+}
+
+/**
+ * Delete the least-recently used entries if the cache is too large.
+ * Stale temporary files are also deleted.
+ * @param cacheDir Metadata cache directory, with a trailing separator.
+ */
+void RomDataCachePrivate::prune(const string &cacheDir)
+{
+	// Entry mtimes are updated on every cache hit,
+	// so the oldest mtime is the least-recently used entry.
+	struct PruneEntry {
+		string filename;
+		time_t mtime;
+		off64_t size;
+	};
+	vector<PruneEntry> entries;
+	uint64_t total_size = 0;
+	const time_t now = time(nullptr);
+
+	auto addEntry = [&](const char *name) {
+		if (isTempFile(name)) {
+			// If the process that created this temporary file
+			// crashed, it will never be renamed or deleted.
+			const string tmpFilename = cacheDir + name;
+			off64_t size;
+			time_t mtime;
+			if (FileSystem::get_file_size_and_mtime(tmpFilename, &size, &mtime) == 0 &&
+			    now - mtime > RPMC_STALE_TMP_AGE)
+			{
+				FileSystem::delete_file(tmpFilename);
+			}
+			return;
+		}
+
+		const size_t len = strlen(name);
+		if (len < 4 || strcmp(&name[len-4], ".bin") != 0) {
+			return;
+		}
+
+		PruneEntry entry;
+		entry.filename = cacheDir + name;
+		if (FileSystem::get_file_size_and_mtime(entry.filename, &entry.size, &entry.mtime) != 0) {
+			return;
+		}
+		total_size += static_cast<uint64_t>(entry.size);
+		entries.emplace_back(std::move(entry));
+	};
+
+#ifdef _WIN32
+	WIN32_FIND_DATA ffd;
+	HANDLE hFind = FindFirstFile(U82T_s(cacheDir + '*'), &ffd);
+	if (!hFind || hFind == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	do {
+		if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+			addEntry(T2U8(ffd.cFileName).c_str());
+		}
+	} while (FindNextFile(hFind, &ffd));
+	FindClose(hFind);
+#else /* !_WIN32 */
+	DIR *const dir = opendir(cacheDir.c_str());
+	if (!dir) {
+		return;
+	}
+	struct dirent *d;
+	while ((d = readdir(dir)) != nullptr) {
+		addEntry(d->d_name);
+	}
+	closedir(dir);
+#endif /* _WIN32 */
+
+	if (entries.size() <= RPMC_MAX_ENTRIES && total_size <= RPMC_MAX_TOTAL_SIZE) {
+		// Cache is within the limits.
+		return;
+	}
+
+	// Delete the oldest entries until the cache is within the limits.
+	std::sort(entries.begin(), entries.end(),
+		[](const PruneEntry &a, const PruneEntry &b) {
+			return a.mtime < b.mtime;
+		}
+	);
+	size_t count = entries.size();
+	for (const PruneEntry &entry : entries) {
+		if (count <= RPMC_MAX_ENTRIES && total_size <= RPMC_MAX_TOTAL_SIZE)
+			break;
+		if (FileSystem::delete_file(entry.filename) == 0) {
+			count--;
+			total_size -= static_cast<uint64_t>(entry.size);
+		}
+	}
+}
+
+/**
+ * Create an empty temporary file with a unique name.
+ * @param cacheFilename	[in] Cache filename.
+ * @param tmpFilename	[out] Temporary filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCachePrivate::createTempFile(const string &cacheFilename, string &tmpFilename)
+{
+	// NOTE: The temporary filename must not end with ".bin",
+	// since prune() would treat it as a cache entry.
+#ifdef _WIN32
+	// GetTempFileName() creates a file named "rpm????.tmp".
+	const size_t slash_pos = cacheFilename.rfind(RPMC_DIR_SEP_CHR);
+	assert(slash_pos != string::npos);
+	const string cacheDir = cacheFilename.substr(0, slash_pos);
+	TCHAR tmpFilenameT[MAX_PATH];
+	if (GetTempFileName(U82T_s(cacheDir), _T("rpm"), 0, tmpFilenameT) == 0) {
+		// TODO: Convert the Win32 error code.
+		return -EIO;
+	}
+	tmpFilename = T2U8(tmpFilenameT);
+#else /* !_WIN32 */
+	tmpFilename = cacheFilename;
+	tmpFilename += ".XXXXXX";
+	const int fd = mkstemp(&tmpFilename[0]);
+	if (fd < 0) {
+		const int err = errno;
+		tmpFilename.clear();
+		return -err;
+	}
+	close(fd);
+#endif /* _WIN32 */
+	return 0;
+}
+
+/**
+ * Rename a file, replacing the destination if it exists.
+ * @param oldName Old filename.
+ * @param newName New filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCachePrivate::replaceFile(const string &oldName, const string &newName)
+{
+#ifdef _WIN32
+	if (!MoveFileEx(U82T_s(oldName), U82T_s(newName), MOVEFILE_REPLACE_EXISTING)) {
+		// TODO: Convert the Win32 error code.
+		return -EIO;
+	}
+#else /* !_WIN32 */
+	if (rename(oldName.c_str(), newName.c_str()) != 0) {
+		return -errno;
+	}
+#endif /* _WIN32 */
+	return 0;
+}
+
+/**
+ * Serialize RomMetaData.
+ * @param w	[in/out] Writer.
+ * @param metaData	[in] RomMetaData.
+ */
+void RomDataCachePrivate::writeMetaData(Writer &w, const RomMetaData *metaData)
+{
+	const int count = metaData->count();
+	w.uv(count);
+	for (int i = 0; i < count; i++) {
+		const RomMetaData::MetaData *const prop = metaData->prop(i);
+		w.uv(prop->name);
+		w.u8(prop->type);
+		switch (prop->type) {
+			case PropertyType::Integer:
+				w.sv(prop->data.ivalue);
+				break;
+			case PropertyType::UnsignedInteger:
+				w.uv(prop->data.uvalue);
+				break;
+			case PropertyType::String:
+				w.str(prop->data.str);
+				break;
+			case PropertyType::Timestamp:
+				w.sv(static_cast<int64_t>(prop->data.timestamp));
+				break;
+			default:
+				// Invalid property. Store it as an empty string,
+				// which is skipped when reading.
+				assert(!"Unsupported RomMetaData PropertyType.");
+				w.str(nullptr);
+				break;
+		}
+	}
+}
+
+/**
+ * Deserialize RomMetaData.
+ * @param r Reader.
+ * @return RomMetaData, or nullptr on error.
+ */
+RomMetaData *RomDataCachePrivate::readMetaData(Reader &r)
+{
+	unique_ptr<RomMetaData> metaData(new RomMetaData());
+
+	const size_t count = r.count();
+	metaData->reserve(static_cast<int>(count));
+	for (size_t i = 0; i < count && r.ok; i++) {
+		const uint64_t name64 = r.uv();
+		const uint8_t type = r.u8();
+		if (!r.ok || name64 <= Property::FirstProperty || name64 >= Property::PropertyCount) {
+			r.ok = false;
+			break;
+		}
+		const Property::Property name = static_cast<Property::Property>(name64);
+
+		switch (type) {
+			case PropertyType::Integer:
+				metaData->addMetaData_integer(name, static_cast<int>(r.sv()));
+				break;
+			case PropertyType::UnsignedInteger:
+				metaData->addMetaData_uint(name, static_cast<unsigned int>(r.uv()));
+				break;
+			case PropertyType::String: {
+				unique_ptr<string> str(r.strN());
+				if (str) {
+					metaData->addMetaData_string(name, str->c_str());
+				}
+				break;
+			}
+			case PropertyType::Timestamp:
+				metaData->addMetaData_timestamp(name, static_cast<time_t>(r.sv()));
+				break;
+			default:
+				// Invalid property. (stored as a nullptr string)
+				r.strN();
+				break;
+		}
+	}
+
+	return (r.ok ? metaData.release() : nullptr);
+}
+
+/** RomDataCache::Entry **/
+
+RomDataCache::Entry::Entry()
+	: metaData(nullptr)
+{ }
+
+RomDataCache::Entry::~Entry()
+{
+	delete metaData;
+}
+
+/** RomDataCache **/
+
+/**
+ * Look up a file in the metadata cache.
+ * @param filename Local filename. (UTF-8)
+ * @return Cache entry, or nullptr if not found or out of date.
+ */
+RomDataCache::Entry *RomDataCache::lookup(const char *filename)
+{
+	assert(filename != nullptr);
+	assert(filename[0] != '\0');
+	if (!filename || filename[0] == '\0')
+		return nullptr;
+
+	RomDataCachePrivate::FileKey key;
+	if (RomDataCachePrivate::getFileKey(filename, key) != 0) {
+		// Unable to get the file identity.
+		return nullptr;
+	}
+
+	const string cacheFilename = RomDataCachePrivate::getCacheFilename(filename);
+	if (cacheFilename.empty()) {
+		return nullptr;
+	}
+
+	// Read the entire cache entry.
+	RpFile *const file = new RpFile(cacheFilename, RpFile::FM_OPEN_READ);
+	if (!file->isOpen()) {
+		// Not cached.
+		file->unref();
+		return nullptr;
+	}
+
+	const off64_t fileSize = file->size();
+	if (fileSize < static_cast<off64_t>(sizeof(RPMC_Header)) ||
+	    fileSize > static_cast<off64_t>(RPMC_MAX_ENTRY_SIZE))
+	{
+		// Invalid cache entry.
+		file->unref();
+		return nullptr;
+	}
+	ao::uvector<uint8_t> buf;
+	buf.resize(static_cast<size_t>(fileSize));
+	const size_t size = file->read(buf.data(), buf.size());
+	file->unref();
+	if (size != buf.size()) {
+		// Short read.
+		return nullptr;
+	}
+
+	// Verify the header.
+	RPMC_Header header;
+	memcpy(&header, buf.data(), sizeof(header));
+	const size_t path_len = le16_to_cpu(header.path_len);
+	const size_t version_len = le16_to_cpu(header.version_len);
+	const size_t body_size = le32_to_cpu(header.body_size);
+	const size_t filename_len = strlen(filename);
+	if (header.magic != cpu_to_be32(RPMC_MAGIC) ||
+	    header.version != cpu_to_le32(RPMC_VERSION) ||
+	    sizeof(header) + path_len + version_len + body_size != buf.size() ||
+	    le64_to_cpu(header.file_size) != key.file_size ||
+	    static_cast<int64_t>(le64_to_cpu(header.mtime)) != key.mtime ||
+	    le32_to_cpu(header.mtime_nsec) != key.mtime_nsec ||
+	    le64_to_cpu(header.inode) != key.inode ||
+	    path_len != filename_len ||
+	    version_len != sizeof(RP_VERSION_STRING)-1)
+	{
+		// Cache entry is invalid or out of date.
+		return nullptr;
+	}
+
+	const uint8_t *p = buf.data() + sizeof(header);
+	if (memcmp(p, filename, filename_len) != 0) {
+		// Hash collision.
+		return nullptr;
+	}
+	p += path_len;
+	if (memcmp(p, RP_VERSION_STRING, version_len) != 0) {
+		// Cache entry is from a different version of rom-properties.
+		return nullptr;
+	}
+	p += version_len;
+
+	// Deserialize the body.
+	const uint32_t flags = le32_to_cpu(header.flags);
+	RomDataCachePrivate::Reader r(p, body_size);
+	unique_ptr<Entry> entry(new Entry());
+	if (flags & RPMC_FLAG_HAS_METADATA) {
+		entry->metaData = RomDataCachePrivate::readMetaData(r);
+		if (!entry->metaData) {
+			return nullptr;
+		}
+	}
+
+	// Update the entry's mtime for LRU eviction.
+	// NOTE: Errors are ignored here.
+	FileSystem::set_mtime(cacheFilename, time(nullptr));
+	return entry.release();
+}
+
+/**
+ * Store a RomData object's metadata in the metadata cache.
+ * The RomData object's metadata will be loaded if necessary.
+ * @param filename Local filename. (UTF-8)
+ * @param romData RomData object.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataCache::store(const char *filename, const RomData *romData)
+{
+	assert(filename != nullptr);
+	assert(filename[0] != '\0');
+	assert(romData != nullptr);
+	if (!filename || filename[0] == '\0' || !romData)
+		return -EINVAL;
+
+	const size_t filename_len = strlen(filename);
+	if (filename_len > 0xFFFF) {
+		return -ENAMETOOLONG;
+	}
+
+	RomDataCachePrivate::FileKey key;
+	int ret = RomDataCachePrivate::getFileKey(filename, key);
+	if (ret != 0) {
+		return ret;
+	}
+
+	const string cacheFilename = RomDataCachePrivate::getCacheFilename(filename);
+	if (cacheFilename.empty()) {
+		return -ENOENT;
+	}
+
+	// Serialize the body.
+	RomDataCachePrivate::Writer w;
+	uint32_t flags = 0;
+	const RomMetaData *const metaData = romData->metaData();
+	if (metaData) {
+		RomDataCachePrivate::writeMetaData(w, metaData);
+		flags |= RPMC_FLAG_HAS_METADATA;
+	}
+
+	const size_t version_len = sizeof(RP_VERSION_STRING)-1;
+	const size_t total_size = sizeof(RPMC_Header) + filename_len + version_len + w.buf.size();
+	if (total_size > RPMC_MAX_ENTRY_SIZE) {
+		// Entry is too big.
+		return -E2BIG;
+	}
+
+	RPMC_Header header;
+	header.magic = cpu_to_be32(RPMC_MAGIC);
+	header.version = cpu_to_le32(RPMC_VERSION);
+	header.flags = cpu_to_le32(flags);
+	header.body_size = cpu_to_le32(static_cast<uint32_t>(w.buf.size()));
+	header.file_size = cpu_to_le64(key.file_size);
+	header.mtime = cpu_to_le64(key.mtime);
+	header.inode = cpu_to_le64(key.inode);
+	header.mtime_nsec = cpu_to_le32(key.mtime_nsec);
+	header.path_len = cpu_to_le16(static_cast<uint16_t>(filename_len));
+	header.version_len = cpu_to_le16(static_cast<uint16_t>(version_len));
+
+	string data;
+	data.reserve(total_size);
+	data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+	data.append(filename, filename_len);
+	data.append(RP_VERSION_STRING, version_len);
+	data.append(w.buf);
+
+	// Make sure the cache directory exists.
+	const string cacheDir = RomDataCachePrivate::getMetaDataCacheDir();
+	ret = FileSystem::rmkdir(cacheDir);
+	if (ret != 0) {
+		return ret;
+	}
+
+	// Write to a temporary file, then rename it.
+	// This prevents other processes from seeing a partial entry.
+	// The temporary filename is unique, since multiple processes
+	// may store the same entry at the same time.
+	string tmpFilename;
+	ret = RomDataCachePrivate::createTempFile(cacheFilename, tmpFilename);
+	if (ret != 0) {
+		return ret;
+	}
+	RpFile *const file = new RpFile(tmpFilename, RpFile::FM_CREATE_WRITE);
+	if (!file->isOpen()) {
+		ret = -file->lastError();
+		file->unref();
+		FileSystem::delete_file(tmpFilename);
+		return (ret != 0 ? ret : -EIO);
+	}
+	const size_t size = file->write(data.data(), data.size());
+	file->unref();
+	if (size != data.size()) {
+		FileSystem::delete_file(tmpFilename);
+		return -ENOSPC;
+	}
+	ret = RomDataCachePrivate::replaceFile(tmpFilename, cacheFilename);
+	if (ret != 0) {
+		FileSystem::delete_file(tmpFilename);
+		return ret;
+	}
+
+	// Check the cache size limits.
+	if (ATOMIC_INC_FETCH(&RomDataCachePrivate::store_count) % RPMC_PRUNE_INTERVAL == 1) {
+		RomDataCachePrivate::prune(cacheDir);
+	}
+	return 0;
+}
+
+}
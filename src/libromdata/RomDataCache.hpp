@@ -0,0 +1,85 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * RomDataCache.hpp: Persistent RomData metadata cache.                    *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_ROMDATACACHE_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_ROMDATACACHE_HPP__
+
+#include "common.h"
+
+namespace LibRpBase {
+	class RomData;
+	class RomMetaData;
+}
+
+namespace LibRomData {
+
+/**
+ * Persistent on-disk cache for RomData metadata.
+ *
+ * Entries are stored in the "metadata" subdirectory of the
+ * rom-properties cache directory, one file per source file.
+ * An entry is only valid if the source file's path, size,
+ * mtime (including nanoseconds and the inode number, if
+ * available) match the values
+ * that were stored with the entry.
+ *
+ * The least-recently used entries are deleted if the cache
+ * gets too large.
+ *
+ * NOTE: The cache is opt-in. Callers must check
+ * Config::enableMetaDataCache() before using it.
+ *
+ * NOTE: Only RomMetaData is cached. RomFields and thumbnails
+ * are not, so property pages and rpcli don't use the cache.
+ */
+class RomDataCache
+{
+	private:
+		RomDataCache();
+		~RomDataCache();
+	private:
+		RP_DISABLE_COPY(RomDataCache)
+
+	public:
+		/**
+		 * Cached RomData results.
+		 * Returned by lookup(); must be deleted by the caller.
+		 */
+		class Entry {
+			public:
+				Entry();
+				~Entry();
+			private:
+				RP_DISABLE_COPY(Entry)
+
+			public:
+				// ROM metadata.
+				// May be nullptr if the RomData object has no metadata.
+				LibRpBase::RomMetaData *metaData;
+		};
+
+		/**
+		 * Look up a file in the metadata cache.
+		 * @param filename Local filename. (UTF-8)
+		 * @return Cache entry, or nullptr if not found or out of date.
+		 */
+		static Entry *lookup(const char *filename);
+
+		/**
+		 * Store a RomData object's metadata in the metadata cache.
+		 * The RomData object's metadata will be loaded if necessary.
+		 * @param filename Local filename. (UTF-8)
+		 * @param romData RomData object.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int store(const char *filename, const LibRpBase::RomData *romData);
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_ROMDATACACHE_HPP__ */
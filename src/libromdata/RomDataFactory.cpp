@@ -27,6 +27,7 @@ using LibRpTexture::FileFormatFactory;
 // C++ STL classes.
 using std::string;
 using std::unordered_map;
+using std::unordered_multimap;
 using std::unordered_set;
 using std::vector;
 
@@ -96,6 +97,9 @@ using std::vector;
 // Special case for Dreamcast save files.
 #include "Console/dc_structs.h"
 
+// Special case for cue sheets.
+#include "disc/CueReader.hpp"
+
 namespace LibRomData {
 
 class RomDataFactoryPrivate
@@ -154,6 +158,8 @@ class RomDataFactoryPrivate
 		// definitely have a 32-bit magic number in the header.
 		// - address: Address of magic number within the header.
 		// - size: 32-bit magic number.
+		// NOTE: A class may have multiple entries if it
+		// supports more than one magic number.
 		static const RomDataFns romDataFns_magic[];
 
 		// RomData subclasses that use a header.
@@ -164,6 +170,11 @@ class RomDataFactoryPrivate
 		// RomData subclasses that use a footer.
 		static const RomDataFns romDataFns_footer[];
 
+		// RomData subclasses that support cue sheets.
+		// NOTE: Not included in romDataFns_tbl[], since these
+		// subclasses are already listed in romDataFns_header[].
+		static const RomDataFns romDataFns_cue[];
+
 		// Table of pointers to tables.
 		// This reduces duplication by only requiring a single loop
 		// in each function.
@@ -176,6 +187,15 @@ class RomDataFactoryPrivate
 		 */
 		static RomData *openDreamcastVMSandVMI(IRpFile *file);
 
+		/**
+		 * Open a cue sheet.
+		 * The first data track is used for RomData detection.
+		 * @param file Cue sheet.
+		 * @param attrs RomDataAttr bitfield. If set, RomData subclass must have the specified attributes.
+		 * @return RomData subclass, or nullptr if the cue sheet isn't supported.
+		 */
+		static RomData *openCueSheet(IRpFile *file, unsigned int attrs);
+
 		// Vectors for file extensions and MIME types.
 		// We want to collect them once per session instead of
 		// repeatedly collecting them, since the caller might
@@ -186,6 +206,24 @@ class RomDataFactoryPrivate
 		static pthread_once_t once_exts;
 		static pthread_once_t once_mimeTypes;
 
+		// Magic number index for romDataFns_magic[].
+		// - Key: (address << 32) | magic
+		// - Value: Index into romDataFns_magic[].
+		// This allows create() to check only the subclasses
+		// whose magic numbers actually match, instead of
+		// checking every entry in romDataFns_magic[].
+		static unordered_multimap<uint64_t, unsigned int> map_magic;
+		// Distinct magic number addresses in romDataFns_magic[].
+		static vector<uint32_t> vec_magic_addrs;
+		static pthread_once_t once_magic;
+
+		/**
+		 * Initialize the magic number index.
+		 *
+		 * Internal function; must be called using pthread_once().
+		 */
+		static void init_magicIndex(void);
+
 		/**
 		 * Initialize the vector of supported file extensions.
 		 * Used for Win32 COM registration.
@@ -215,6 +253,38 @@ class RomDataFactoryPrivate
 		 * @return Game-specific RomData subclass, or nullptr if none are supported.
 		 */
 		static RomData *checkISO(IRpFile *file);
+
+		/**
+		 * Header buffer for RomData detection.
+		 * 4,096+256 bytes should be enough to detect most systems.
+		 */
+		union DetectHeader {
+			uint8_t u8[4096+256];
+			uint32_t u32[(4096+256)/4];
+		};
+
+		/**
+		 * Read the header and get the file extension for RomData detection.
+		 * @param file		[in] ROM file.
+		 * @param info		[out] DetectInfo.
+		 * @param header	[out] Header buffer. (info.header.pData will point here)
+		 * @param file_ext	[out] Temporary storage for the file extension.
+		 * @param attrs		[in/out] RomDataAttr bitfield. (RDA_SUPPORTS_DEVICES is added for devices)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int readDetectInfo(IRpFile *file, RomData::DetectInfo &info,
+			DetectHeader &header, string &file_ext, unsigned int &attrs);
+
+		/**
+		 * Find romDataFns_magic[] entries whose magic numbers match the header.
+		 * @param info		[in] DetectInfo. (header must be at address 0)
+		 * @param header	[in] Header buffer.
+		 * @param magic_idx	[out] Indexes into romDataFns_magic[], in table order.
+		 *                        (must have room for ARRAY_SIZE(romDataFns_magic) entries)
+		 * @return Number of matching entries.
+		 */
+		static unsigned int findMagic(const RomData::DetectInfo &info,
+			const DetectHeader &header, unsigned int *magic_idx);
 };
 
 /** RomDataFactoryPrivate **/
@@ -223,6 +293,9 @@ vector<RomDataFactory::ExtInfo> RomDataFactoryPrivate::vec_exts;
 vector<const char*> RomDataFactoryPrivate::vec_mimeTypes;
 pthread_once_t RomDataFactoryPrivate::once_exts = PTHREAD_ONCE_INIT;
 pthread_once_t RomDataFactoryPrivate::once_mimeTypes = PTHREAD_ONCE_INIT;
+unordered_multimap<uint64_t, unsigned int> RomDataFactoryPrivate::map_magic;
+vector<uint32_t> RomDataFactoryPrivate::vec_magic_addrs;
+pthread_once_t RomDataFactoryPrivate::once_magic = PTHREAD_ONCE_INIT;
 
 #define ATTR_NONE		RomDataFactory::RDA_NONE
 #define ATTR_HAS_THUMBNAIL	RomDataFactory::RDA_HAS_THUMBNAIL
@@ -235,7 +308,10 @@ pthread_once_t RomDataFactoryPrivate::once_mimeTypes = PTHREAD_ONCE_INIT;
 // definitely have a 32-bit magic number in the header.
 // - address: Address of magic number within the header.
 // - size: 32-bit magic number.
-// TODO: Add support for multiple magic numbers per class.
+// NOTE: A class may have multiple entries if it
+// supports more than one magic number.
+// NOTE: If multiple entries match, they're checked
+// in the order they're listed here.
 const RomDataFactoryPrivate::RomDataFns RomDataFactoryPrivate::romDataFns_magic[] = {
 	// Consoles
 	GetRomDataFns_addr(WiiWIBN, ATTR_HAS_THUMBNAIL, 0, 'WIBN'),
@@ -258,6 +334,10 @@ const RomDataFactoryPrivate::RomDataFns RomDataFactoryPrivate::romDataFns_magic[
 	GetRomDataFns_addr(BRSTM, ATTR_HAS_METADATA, 0, 'RSTM'),
 	GetRomDataFns_addr(GBS, ATTR_HAS_METADATA, 0, 'GBS\x01'),
 	GetRomDataFns_addr(NSF, ATTR_HAS_METADATA, 0, 'NESM'),
+	GetRomDataFns_addr(SAP, ATTR_HAS_METADATA, 0, 'SAP\r'),
+	GetRomDataFns_addr(SAP, ATTR_HAS_METADATA, 0, 'SAP\n'),
+	GetRomDataFns_addr(SID, ATTR_HAS_METADATA, 0, 'PSID'),
+	GetRomDataFns_addr(SID, ATTR_HAS_METADATA, 0, 'RSID'),
 	GetRomDataFns_addr(SPC, ATTR_HAS_METADATA, 0, 'SNES'),
 	GetRomDataFns_addr(VGM, ATTR_HAS_METADATA, 0, 'Vgm '),
 
@@ -301,9 +381,7 @@ const RomDataFactoryPrivate::RomDataFns RomDataFactoryPrivate::romDataFns_header
 	GetRomDataFns(ADX, ATTR_HAS_METADATA),
 	GetRomDataFns(BCSTM, ATTR_HAS_METADATA),
 	GetRomDataFns(PSF, ATTR_HAS_METADATA),
-	GetRomDataFns(SAP, ATTR_HAS_METADATA),	// "SAP\r\n", "SAP\n"; maybe move to _magic[]?
 	GetRomDataFns(SNDH, ATTR_HAS_METADATA),	// "SNDH", or "ICE!" or "Ice!" if packed.
-	GetRomDataFns(SID, ATTR_HAS_METADATA),	// PSID/RSID; maybe move to _magic[]?
 
 	// Other
 	GetRomDataFns(Amiibo, ATTR_HAS_THUMBNAIL),
@@ -342,6 +420,19 @@ const RomDataFactoryPrivate::RomDataFns RomDataFactoryPrivate::romDataFns_footer
 	{nullptr, nullptr, nullptr, nullptr, ATTR_NONE, 0, 0}
 };
 
+// RomData subclasses that support cue sheets.
+// The header is read from the first data track
+// using 2048-byte sectors.
+const RomDataFactoryPrivate::RomDataFns RomDataFactoryPrivate::romDataFns_cue[] = {
+	GetRomDataFns(MegaDrive, ATTR_SUPPORTS_DEVICES),	// Sega CD
+	GetRomDataFns(SegaSaturn, ATTR_NONE | ATTR_HAS_METADATA | ATTR_SUPPORTS_DEVICES),
+
+	// Last chance: ISO-9660 disc images.
+	GetRomDataFns(ISO, ATTR_HAS_THUMBNAIL | ATTR_SUPPORTS_DEVICES),
+
+	{nullptr, nullptr, nullptr, nullptr, ATTR_NONE, 0, 0}
+};
+
 // Table of pointers to tables.
 // This reduces duplication by only requiring a single loop
 // in each function.
@@ -418,6 +509,63 @@ RomData *RomDataFactoryPrivate::openDreamcastVMSandVMI(IRpFile *file)
 	return dcSave;
 }
 
+/**
+ * Open a cue sheet.
+ * The first data track is used for RomData detection.
+ * @param file Cue sheet.
+ * @param attrs RomDataAttr bitfield. If set, RomData subclass must have the specified attributes.
+ * @return RomData subclass, or nullptr if the cue sheet isn't supported.
+ */
+RomData *RomDataFactoryPrivate::openCueSheet(IRpFile *file, unsigned int attrs)
+{
+	// Open the first data track.
+	// The track file is passed to the RomData subclass,
+	// so the cue sheet is only parsed once.
+	IRpFile *const trackFile = CueReader::openFirstDataTrack(file);
+	if (!trackFile) {
+		// Unable to open the first data track.
+		return nullptr;
+	}
+
+	RomData::DetectInfo info;
+	DetectHeader header;
+	info.header.addr = 0;
+	info.header.pData = header.u8;
+	info.header.size = static_cast<uint32_t>(trackFile->seekAndRead(0, header.u8, sizeof(header.u8)));
+	info.ext = ".cue";
+	info.szFile = trackFile->size();
+	if (info.header.size == 0) {
+		// Read error.
+		trackFile->unref();
+		return nullptr;
+	}
+
+	const RomDataFns *fns = &romDataFns_cue[0];
+	for (; fns->supportedFileExtensions != nullptr; fns++) {
+		if ((fns->attrs & attrs) != attrs) {
+			// This RomData subclass doesn't have the
+			// required attributes.
+			continue;
+		}
+
+		if (fns->isRomSupported(&info) >= 0) {
+			RomData *const romData = fns->newRomData(trackFile);
+			if (romData->isValid()) {
+				// RomData subclass obtained.
+				trackFile->unref();
+				return romData;
+			}
+
+			// Not actually supported.
+			romData->unref();
+		}
+	}
+
+	// Not supported.
+	trackFile->unref();
+	return nullptr;
+}
+
 /**
  * Check an ISO-9660 disc image for a game-specific file system.
  *
@@ -473,47 +621,59 @@ RomData *RomDataFactoryPrivate::checkISO(IRpFile *file)
 	return new ISO(file);
 }
 
-/** RomDataFactory **/
-
 /**
- * Create a RomData subclass for the specified ROM file.
- *
- * NOTE: RomData::isValid() is checked before returning a
- * created RomData instance, so returned objects can be
- * assumed to be valid as long as they aren't nullptr.
+ * Initialize the magic number index.
  *
- * If imgbf is non-zero, at least one of the specified image
- * types must be supported by the RomData subclass in order to
- * be returned.
- *
- * @param file ROM file.
- * @param attrs RomDataAttr bitfield. If set, RomData subclass must have the specified attributes.
- * @return RomData subclass, or nullptr if the ROM isn't supported.
+ * Internal function; must be called using pthread_once().
  */
-RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
+void RomDataFactoryPrivate::init_magicIndex(void)
 {
-	RomData::DetectInfo info;
+	static const size_t count = ARRAY_SIZE(romDataFns_magic) - 1;
+#ifdef HAVE_UNORDERED_MAP_RESERVE
+	map_magic.reserve(count);
+#endif /* HAVE_UNORDERED_MAP_RESERVE */
 
+	for (unsigned int i = 0; i < count; i++) {
+		const RomDataFns *const fns = &romDataFns_magic[i];
+		assert(fns->address % 4 == 0);
+		assert(fns->address + sizeof(uint32_t) <= 4096+256);
+
+		const uint64_t key = (static_cast<uint64_t>(fns->address) << 32) | fns->size;
+		map_magic.insert(std::make_pair(key, i));
+
+		if (std::find(vec_magic_addrs.cbegin(), vec_magic_addrs.cend(), fns->address) == vec_magic_addrs.cend()) {
+			vec_magic_addrs.emplace_back(fns->address);
+		}
+	}
+}
+
+/**
+ * Read the header and get the file extension for RomData detection.
+ * @param file		[in] ROM file.
+ * @param info		[out] DetectInfo.
+ * @param header	[out] Header buffer. (info.header.pData will point here)
+ * @param file_ext	[out] Temporary storage for the file extension.
+ * @param attrs		[in/out] RomDataAttr bitfield. (RDA_SUPPORTS_DEVICES is added for devices)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataFactoryPrivate::readDetectInfo(IRpFile *file, RomData::DetectInfo &info,
+	DetectHeader &header, string &file_ext, unsigned int &attrs)
+{
 	// Get the file size.
 	info.szFile = file->size();
 
 	// Read 4,096+256 bytes from the ROM header.
 	// This should be enough to detect most systems.
-	union {
-		uint8_t u8[4096+256];
-		uint32_t u32[(4096+256)/4];
-	} header;
 	file->rewind();
 	info.header.addr = 0;
 	info.header.pData = header.u8;
 	info.header.size = static_cast<uint32_t>(file->read(header.u8, sizeof(header.u8)));
 	if (info.header.size == 0) {
 		// Read error.
-		return nullptr;
+		return -EIO;
 	}
 
 	// File extension.
-	string file_ext;	// temporary storage
 	info.ext = nullptr;
 	if (file->isDevice()) {
 		// Device file. Assume it's a CD-ROM.
@@ -532,6 +692,76 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 		}
 	}
 
+	return 0;
+}
+
+/**
+ * Find romDataFns_magic[] entries whose magic numbers match the header.
+ * @param info		[in] DetectInfo. (header must be at address 0)
+ * @param header	[in] Header buffer.
+ * @param magic_idx	[out] Indexes into romDataFns_magic[], in table order.
+ *                        (must have room for ARRAY_SIZE(romDataFns_magic) entries)
+ * @return Number of matching entries.
+ */
+unsigned int RomDataFactoryPrivate::findMagic(const RomData::DetectInfo &info,
+	const DetectHeader &header, unsigned int *magic_idx)
+{
+	assert(info.header.addr == 0);
+	pthread_once(&once_magic, init_magicIndex);
+
+	unsigned int magic_count = 0;
+	for (auto addr_iter = vec_magic_addrs.cbegin();
+	     addr_iter != vec_magic_addrs.cend(); ++addr_iter)
+	{
+		const uint32_t address = *addr_iter;
+		if (address + sizeof(uint32_t) > info.header.size) {
+			// Header is too small for this magic number.
+			continue;
+		}
+
+		const uint64_t key = (static_cast<uint64_t>(address) << 32) |
+			be32_to_cpu(header.u32[address/4]);
+		auto range = map_magic.equal_range(key);
+		for (auto iter = range.first; iter != range.second; ++iter) {
+			assert(magic_count < ARRAY_SIZE(romDataFns_magic));
+			magic_idx[magic_count++] = iter->second;
+		}
+	}
+	if (magic_count > 1) {
+		// Check matching subclasses in table order.
+		std::sort(&magic_idx[0], &magic_idx[magic_count]);
+	}
+
+	return magic_count;
+}
+
+/** RomDataFactory **/
+
+/**
+ * Create a RomData subclass for the specified ROM file.
+ *
+ * NOTE: RomData::isValid() is checked before returning a
+ * created RomData instance, so returned objects can be
+ * assumed to be valid as long as they aren't nullptr.
+ *
+ * If imgbf is non-zero, at least one of the specified image
+ * types must be supported by the RomData subclass in order to
+ * be returned.
+ *
+ * @param file ROM file.
+ * @param attrs RomDataAttr bitfield. If set, RomData subclass must have the specified attributes.
+ * @return RomData subclass, or nullptr if the ROM isn't supported.
+ */
+RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
+{
+	RomData::DetectInfo info;
+	RomDataFactoryPrivate::DetectHeader header;
+	string file_ext;	// temporary storage
+	if (RomDataFactoryPrivate::readDetectInfo(file, info, header, file_ext, attrs) != 0) {
+		// Read error.
+		return nullptr;
+	}
+
 	// Special handling for Dreamcast .VMI+.VMS pairs.
 	if (info.ext != nullptr &&
 	    (!strcasecmp(info.ext, ".vms") ||
@@ -552,34 +782,40 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 		// Not a .VMI+.VMS pair.
 	}
 
+	// Special handling for cue sheets.
+	// Nothing else can be detected in a cue sheet,
+	// so the regular checks are skipped.
+	if (info.ext != nullptr && !strcasecmp(info.ext, ".cue") &&
+	    CueReader::isDiscSupported_static(info.header.pData, info.header.size) >= 0)
+	{
+		return RomDataFactoryPrivate::openCueSheet(file, attrs);
+	}
+
 	// Check RomData subclasses that take a header at 0
 	// and definitely have a 32-bit magic number in the header.
-	const RomDataFactoryPrivate::RomDataFns *fns =
-		&RomDataFactoryPrivate::romDataFns_magic[0];
-	for (; fns->supportedFileExtensions != nullptr; fns++) {
+	// Only subclasses with a matching magic number are checked.
+	unsigned int magic_idx[ARRAY_SIZE(RomDataFactoryPrivate::romDataFns_magic)];
+	const unsigned int magic_count = RomDataFactoryPrivate::findMagic(info, header, magic_idx);
+
+	const RomDataFactoryPrivate::RomDataFns *fns;
+	for (unsigned int i = 0; i < magic_count; i++) {
+		fns = &RomDataFactoryPrivate::romDataFns_magic[magic_idx[i]];
 		if ((fns->attrs & attrs) != attrs) {
 			// This RomData subclass doesn't have the
 			// required attributes.
 			continue;
 		}
 
-		// Check the magic number.
-		// TODO: Verify alignment restrictions.
-		assert(fns->address % 4 == 0);
-		assert(fns->address + sizeof(uint32_t) <= sizeof(header.u32));
-		uint32_t magic = header.u32[fns->address/4];
-		if (be32_to_cpu(magic) == fns->size) {
-			// Found a matching magic number.
-			if (fns->isRomSupported(&info) >= 0) {
-				RomData *const romData = fns->newRomData(file);
-				if (romData->isValid()) {
-					// RomData subclass obtained.
-					return romData;
-				}
-
-				// Not actually supported.
-				romData->unref();
+		// Found a matching magic number.
+		if (fns->isRomSupported(&info) >= 0) {
+			RomData *const romData = fns->newRomData(file);
+			if (romData->isValid()) {
+				// RomData subclass obtained.
+				return romData;
 			}
+
+			// Not actually supported.
+			romData->unref();
 		}
 	}
 
@@ -749,6 +985,93 @@ RomData *RomDataFactory::create(IRpFile *file, unsigned int attrs)
 	return nullptr;
 }
 
+/**
+ * Detect the RomData subclass for the specified ROM file
+ * without creating a RomData object.
+ *
+ * Only the 4,096+256-byte header at the start of the file is read.
+ * This is much cheaper than create() for disc images, since it
+ * doesn't open partitions, decrypt anything, or load file systems.
+ *
+ * NOTE: Only the header check is done, so a file detected here
+ * may still be rejected by create(). In addition, formats that
+ * can't be detected using the header at address 0 (e.g. ISO-9660,
+ * cue sheets, Sega 8-bit, Virtual Boy, and Dreamcast .VMI+.VMS pairs)
+ * are not detected.
+ *
+ * @param file		[in] ROM file.
+ * @param result	[out] Detection result.
+ * @param attrs		[in] RomDataAttr bitfield. If set, RomData subclass must have the specified attributes.
+ * @return True if a RomData subclass was detected; false if not.
+ */
+bool RomDataFactory::detect(IRpFile *file, DetectResult &result, unsigned int attrs)
+{
+	RomData::DetectInfo info;
+	RomDataFactoryPrivate::DetectHeader header;
+	string file_ext;	// temporary storage
+	if (RomDataFactoryPrivate::readDetectInfo(file, info, header, file_ext, attrs) != 0) {
+		// Read error.
+		return false;
+	}
+
+	// Check RomData subclasses that take a header at 0
+	// and definitely have a 32-bit magic number in the header.
+	unsigned int magic_idx[ARRAY_SIZE(RomDataFactoryPrivate::romDataFns_magic)];
+	const unsigned int magic_count = RomDataFactoryPrivate::findMagic(info, header, magic_idx);
+
+	const RomDataFactoryPrivate::RomDataFns *fns;
+	for (unsigned int i = 0; i < magic_count; i++) {
+		fns = &RomDataFactoryPrivate::romDataFns_magic[magic_idx[i]];
+		if ((fns->attrs & attrs) != attrs)
+			continue;
+
+		const int romType = fns->isRomSupported(&info);
+		if (romType >= 0) {
+			result.mimeTypes = fns->supportedMimeTypes();
+			result.fileExtensions = fns->supportedFileExtensions();
+			result.attrs = fns->attrs;
+			result.romType = romType;
+			return true;
+		}
+	}
+
+	// Check for supported textures.
+	// NOTE: Same attributes as in init_supportedFileExtensions().
+	static const unsigned int FFF_ATTRS = ATTR_HAS_THUMBNAIL | ATTR_HAS_METADATA;
+	if (!file->isDevice() && (FFF_ATTRS & attrs) == attrs) {
+		if (FileFormatFactory::detect(header.u8, info.header.size,
+			&result.mimeTypes, &result.fileExtensions))
+		{
+			result.attrs = FFF_ATTRS;
+			result.romType = 0;
+			return true;
+		}
+	}
+
+	// Check other RomData subclasses that take a header at 0.
+	// Headers at other addresses would require additional reads,
+	// so they aren't checked.
+	fns = &RomDataFactoryPrivate::romDataFns_header[0];
+	for (; fns->supportedFileExtensions != nullptr; fns++) {
+		if (fns->address != 0)
+			break;
+		if ((fns->attrs & attrs) != attrs)
+			continue;
+
+		const int romType = fns->isRomSupported(&info);
+		if (romType >= 0) {
+			result.mimeTypes = fns->supportedMimeTypes();
+			result.fileExtensions = fns->supportedFileExtensions();
+			result.attrs = fns->attrs;
+			result.romType = romType;
+			return true;
+		}
+	}
+
+	// Not detected.
+	return false;
+}
+
 /**
  * Initialize the vector of supported file extensions.
  * Used for Win32 COM registration.
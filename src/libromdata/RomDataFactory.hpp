@@ -75,6 +75,37 @@ class RomDataFactory
 		 */
 		static LibRpBase::RomData *create(LibRpFile::IRpFile *file, unsigned int attrs = 0);
 
+		/**
+		 * RomData subclass detection result.
+		 */
+		struct DetectResult {
+			const char *const *mimeTypes;		// Supported MIME types. (NULL-terminated; may be nullptr)
+			const char *const *fileExtensions;	// Supported file extensions. (NULL-terminated; may be nullptr)
+			unsigned int attrs;			// RomDataAttr bitfield.
+			int romType;				// Class-specific system ID.
+		};
+
+		/**
+		 * Detect the RomData subclass for the specified ROM file
+		 * without creating a RomData object.
+		 *
+		 * Only the 4,096+256-byte header at the start of the file is read.
+		 * This is much cheaper than create() for disc images, since it
+		 * doesn't open partitions, decrypt anything, or load file systems.
+		 *
+		 * NOTE: Only the header check is done, so a file detected here
+		 * may still be rejected by create(). In addition, formats that
+		 * can't be detected using the header at address 0 (e.g. ISO-9660,
+		 * Sega 8-bit, Virtual Boy, and Dreamcast .VMI+.VMS pairs) are
+		 * not detected.
+		 *
+		 * @param file		[in] ROM file.
+		 * @param result	[out] Detection result.
+		 * @param attrs		[in] RomDataAttr bitfield. If set, RomData subclass must have the specified attributes.
+		 * @return True if a RomData subclass was detected; false if not.
+		 */
+		static bool detect(LibRpFile::IRpFile *file, DetectResult &result, unsigned int attrs = 0);
+
 		struct ExtInfo {
 			const char *ext;
 			unsigned int attrs;
@@ -16,6 +16,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include "common.h"
 
 #ifdef __cplusplus
@@ -87,6 +88,34 @@ typedef struct PACKED _CDROM_2352_Sector_t {
 } CDROM_2352_Sector_t;
 ASSERT_STRUCT(CDROM_2352_Sector_t, 2352);
 
+/**
+ * Get a pointer to the 2048-byte user data in a 2352-byte sector.
+ * - Mode 1: User data starts at byte 16.
+ * - Mode 2 (XA): User data starts at byte 24, after the subheader.
+ *   NOTE: Form 2 sectors have 2324 bytes of user data, but only
+ *   the first 2048 bytes are used here.
+ * @param sector 2352-byte sector.
+ * @return Pointer to the user data.
+ */
+static FORCEINLINE const uint8_t *cdrom_sector_user_data(const CDROM_2352_Sector_t *sector)
+{
+	return (sector->mode == 2 ? sector->m2xa_f1.data : sector->m1.data);
+}
+
+/**
+ * Copy the 2048-byte user data from multiple 2352-byte sectors.
+ * Each sector's mode is checked individually.
+ * @param dest Destination buffer. (Must be at least count * 2048 bytes!)
+ * @param sectors 2352-byte sectors.
+ * @param count Number of sectors.
+ */
+static inline void cdrom_copy_user_data(uint8_t *dest, const CDROM_2352_Sector_t *sectors, unsigned int count)
+{
+	for (; count > 0; count--, sectors++, dest += 2048) {
+		memcpy(dest, cdrom_sector_user_data(sectors), 2048);
+	}
+}
+
 #pragma pack()
 
 #ifdef __cplusplus
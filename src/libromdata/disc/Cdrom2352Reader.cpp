@@ -16,6 +16,7 @@
 #include "Cdrom2352Reader.hpp"
 #include "librpbase/disc/SparseDiscReader_p.hpp"
 #include "../cdrom_structs.h"
+#include "CdromSectorBuffer.hpp"
 
 // librpbase, librpfile
 using namespace LibRpBase;
@@ -40,6 +41,9 @@ class Cdrom2352ReaderPrivate : public SparseDiscReaderPrivate {
 
 		// Number of 2352-byte blocks.
 		unsigned int blockCount;
+
+		// Raw sector buffer for readBlocks().
+		CdromSectorBuffer sectorBuf;
 };
 
 /** Cdrom2352ReaderPrivate **/
@@ -51,7 +55,11 @@ const uint8_t Cdrom2352ReaderPrivate::CDROM_2352_MAGIC[12] =
 Cdrom2352ReaderPrivate::Cdrom2352ReaderPrivate(Cdrom2352Reader *q)
 	: super(q)
 	, blockCount(0)
-{ }
+{
+	// Cdrom2352Reader overrides readBlock(), so SparseDiscReader
+	// can't read blocks using getPhysBlockAddr().
+	canCoalesce = false;
+}
 
 /** Cdrom2352Reader **/
 
@@ -140,9 +148,87 @@ off64_t Cdrom2352Reader::getPhysBlockAddr(uint32_t blockIdx) const
 	}
 
 	// Convert to a physical block address and return.
-	// FIXME: Currently only supports Mode 1.
-	// Check for Mode 2 and handle it correctly.
+	// NOTE: This is the Mode 1 user data address.
+	// readBlock() checks the sector mode.
 	return (static_cast<off64_t>(blockIdx) * d->physBlockSize) + 16;
 }
 
+/**
+ * Read the specified block.
+ *
+ * This can read either a full block or a partial block.
+ * For a full block, set pos = 0 and size = block_size.
+ *
+ * @param blockIdx	[in] Block index.
+ * @param ptr		[out] Output data buffer.
+ * @param pos		[in] Starting position. (Must be >= 0 and <= the block size!)
+ * @param size		[in] Amount of data to read, in bytes. (Must be <= the block size!)
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int Cdrom2352Reader::readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size)
+{
+	// Read 'size' bytes of block 'blockIdx', starting at 'pos'.
+	// NOTE: This can only be called by SparseDiscReader,
+	// so the main assertions are already checked there.
+	RP_D(Cdrom2352Reader);
+	assert(pos >= 0 && pos < (int)d->block_size);
+	assert(size <= d->block_size);
+	assert(blockIdx < d->blockCount);
+	// TODO: Make sure overflow doesn't occur.
+	assert(static_cast<off64_t>(pos + size) <= static_cast<off64_t>(d->block_size));
+	if (pos < 0 || static_cast<off64_t>(pos + size) > static_cast<off64_t>(d->block_size) ||
+	    blockIdx >= d->blockCount)
+	{
+		// pos+size is out of range.
+		return -1;
+	}
+
+	if (unlikely(size == 0)) {
+		// Nothing to read.
+		return 0;
+	}
+
+	// Read the whole sector so we can determine the sector mode.
+	CDROM_2352_Sector_t sector;
+	size_t sz_read = m_file->seekAndRead(static_cast<off64_t>(blockIdx) * d->physBlockSize,
+		&sector, sizeof(sector));
+	m_lastError = m_file->lastError();
+	if (sz_read != sizeof(sector)) {
+		// Seek and/or read error.
+		return -1;
+	}
+
+	memcpy(ptr, cdrom_sector_user_data(&sector) + pos, size);
+	return static_cast<int>(size);
+}
+
+/**
+ * Read multiple full blocks.
+ * Raw sectors are read in batches, and the user data is
+ * copied from each sector.
+ *
+ * @param blockIdx	[in] First block index.
+ * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+ * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int Cdrom2352Reader::readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount)
+{
+	RP_D(Cdrom2352Reader);
+	assert(blockIdx < d->blockCount);
+	assert(blockCount >= 1);
+	if (blockIdx >= d->blockCount) {
+		// Out of range.
+		return -1;
+	}
+	if (blockCount > d->blockCount - blockIdx) {
+		blockCount = d->blockCount - blockIdx;
+	}
+
+	const size_t sz_read = d->sectorBuf.readUserData(m_file,
+		static_cast<off64_t>(blockIdx) * d->physBlockSize, ptr, blockCount);
+	m_lastError = m_file->lastError();
+	return static_cast<int>(sz_read);
+}
+
 }
@@ -60,6 +60,32 @@ class Cdrom2352Reader : public LibRpBase::SparseDiscReader
 		 * @return Physical address. (0 == empty block; -1 == invalid block index)
 		 */
 		off64_t getPhysBlockAddr(uint32_t blockIdx) const final;
+
+		/**
+		 * Read the specified block.
+		 *
+		 * This can read either a full block or a partial block.
+		 * For a full block, set pos = 0 and size = block_size.
+		 *
+		 * @param blockIdx	[in] Block index.
+		 * @param ptr		[out] Output data buffer.
+		 * @param pos		[in] Starting position. (Must be >= 0 and <= the block size!)
+		 * @param size		[in] Amount of data to read, in bytes. (Must be <= the block size!)
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		int readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size) final;
+
+		/**
+		 * Read multiple full blocks.
+		 * Raw sectors are read in batches, and the user data is
+		 * copied from each sector.
+		 *
+		 * @param blockIdx	[in] First block index.
+		 * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+		 * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		int readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount) final;
 };
 
 }
@@ -0,0 +1,60 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CdromSectorBuffer.cpp: Batched reads of 2352-byte CD-ROM sectors.       *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "CdromSectorBuffer.hpp"
+
+// librpfile
+using LibRpFile::IRpFile;
+
+namespace LibRomData {
+
+/**
+ * Read the 2048-byte user data from multiple 2352-byte sectors.
+ * Raw sectors are read in batches, and the user data is
+ * copied from each sector.
+ *
+ * @param file		[in] File to read from.
+ * @param phys_pos	[in] Physical address of the first sector.
+ * @param ptr		[out] Output data buffer. (Must be at least sectorCount * 2048 bytes!)
+ * @param sectorCount	[in] Number of sectors to read.
+ * @return Number of bytes of user data read. (Check file->lastError() on short reads.)
+ */
+size_t CdromSectorBuffer::readUserData(IRpFile *file, off64_t phys_pos,
+	void *ptr, unsigned int sectorCount)
+{
+	if (m_sectorBuf.empty()) {
+		m_sectorBuf.resize(SECTOR_BATCH_COUNT);
+	}
+
+	uint8_t *ptr8 = static_cast<uint8_t*>(ptr);
+	size_t ret = 0;
+	while (sectorCount > 0) {
+		const unsigned int count = (sectorCount < SECTOR_BATCH_COUNT
+			? sectorCount : SECTOR_BATCH_COUNT);
+		const size_t read_sz = count * sizeof(CDROM_2352_Sector_t);
+		size_t sz_read = file->seekAndRead(phys_pos, m_sectorBuf.data(), read_sz);
+
+		// Copy the user data from the sectors that were read.
+		const unsigned int sectorsRead = static_cast<unsigned int>(sz_read / sizeof(CDROM_2352_Sector_t));
+		cdrom_copy_user_data(ptr8, m_sectorBuf.data(), sectorsRead);
+		ptr8 += sectorsRead * 2048;
+		ret += sectorsRead * 2048;
+		if (sz_read != read_sz) {
+			// Seek and/or read error.
+			break;
+		}
+
+		phys_pos += read_sz;
+		sectorCount -= count;
+	}
+
+	return ret;
+}
+
+}
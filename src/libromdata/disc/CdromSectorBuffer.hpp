@@ -0,0 +1,59 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CdromSectorBuffer.hpp: Batched reads of 2352-byte CD-ROM sectors.       *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_DISC_CDROMSECTORBUFFER_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_DISC_CDROMSECTORBUFFER_HPP__
+
+#include "common.h"
+#include "../cdrom_structs.h"
+
+// librpbase, librpfile
+#include "librpbase/uvector.h"
+#include "librpfile/IRpFile.hpp"
+
+namespace LibRomData {
+
+/**
+ * Raw sector buffer for reading the user data
+ * from multiple 2352-byte sectors.
+ * Used by the readBlocks() functions of the CD-ROM readers.
+ */
+class CdromSectorBuffer
+{
+	public:
+		CdromSectorBuffer() { }
+
+	private:
+		RP_DISABLE_COPY(CdromSectorBuffer)
+
+	public:
+		/**
+		 * Read the 2048-byte user data from multiple 2352-byte sectors.
+		 * Raw sectors are read in batches, and the user data is
+		 * copied from each sector.
+		 *
+		 * @param file		[in] File to read from.
+		 * @param phys_pos	[in] Physical address of the first sector.
+		 * @param ptr		[out] Output data buffer. (Must be at least sectorCount * 2048 bytes!)
+		 * @param sectorCount	[in] Number of sectors to read.
+		 * @return Number of bytes of user data read. (Check file->lastError() on short reads.)
+		 */
+		size_t readUserData(LibRpFile::IRpFile *file, off64_t phys_pos,
+			void *ptr, unsigned int sectorCount);
+
+	private:
+		// Number of sectors to read at once.
+		static const unsigned int SECTOR_BATCH_COUNT = 64;
+
+		// Raw sector buffer. Allocated on first use.
+		ao::uvector<CDROM_2352_Sector_t> m_sectorBuf;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_DISC_CDROMSECTORBUFFER_HPP__ */
@@ -0,0 +1,1154 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CueReader.cpp: CD-ROM reader for CUE+BIN disc images.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "CueReader.hpp"
+#include "librpbase/disc/SparseDiscReader_p.hpp"
+
+#include "../cdrom_structs.h"
+#include "CdromSectorBuffer.hpp"
+
+// librpbase, librpfile, librpthreads
+#include "librpfile/FileSystem.hpp"
+#include "librpfile/RelatedFile.hpp"
+#include "librpthreads/Atomics.h"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// C++ STL classes.
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace LibRomData {
+
+class CueReaderPrivate : public SparseDiscReaderPrivate {
+	public:
+		CueReaderPrivate(CueReader *q);
+		virtual ~CueReaderPrivate();
+
+	private:
+		typedef SparseDiscReaderPrivate super;
+		RP_DISABLE_COPY(CueReaderPrivate)
+
+	public:
+		// Reference count.
+		volatile int refCnt;
+
+		// Cue sheet filename.
+		string filename;
+
+		// Number of logical 2048-byte blocks.
+		// Determined by the highest data track.
+		unsigned int blockCount;
+
+		// Files referenced by the cue sheet.
+		// Files are opened when one of their tracks is loaded.
+		struct TrackFile {
+			string filename;		// Relative to the .cue file.
+			IRpFile *file;			// nullptr if the file hasn't been opened yet
+			unsigned int lbaStart;		// First LBA. (valid if file != nullptr)
+			unsigned int frameCount;	// Number of frames. (valid if file != nullptr)
+			bool isBinary;			// True for BINARY and MOTOROLA; false for audio formats.
+		};
+		vector<TrackFile> trackFiles;
+
+		// Tracks, in cue sheet order.
+		// NOTE: Audio tracks are included, since they're
+		// needed to calculate the file offsets.
+		struct Track {
+			off64_t physOffset;		// INDEX 01 byte offset within the file.
+			unsigned int index01;		// INDEX 01 frame offset within the file.
+			unsigned int pregap;		// Total PREGAP frames, up to and including this track.
+			unsigned int blockStart;	// First LBA. (valid if loaded)
+			unsigned int blockEnd;		// Last LBA. (inclusive) (valid if loaded)
+			unsigned int fileIdx;		// Index into trackFiles.
+			uint16_t sectorSize;		// 2048, 2336, 2352, or 2448
+			uint8_t trackNumber;		// 01 through 99
+			bool isData;			// True for MODE1/2048, MODE1/2352, and MODE2/2352.
+			bool loaded;
+		};
+		vector<Track> tracks;
+
+		// Raw sector buffer for readBlocks().
+		CdromSectorBuffer sectorBuf;
+
+		/**
+		 * Close all opened files.
+		 */
+		void close(void);
+
+		/**
+		 * Parse an MSF timestamp. (mm:ss:ff)
+		 * @param str	[in] String.
+		 * @param frames	[out] Frame count.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int parseMSF(const char *str, unsigned int &frames);
+
+		/**
+		 * Parse a cue sheet.
+		 * @param cuebuf NULL-terminated string containing the cue sheet. (Must be writable!)
+		 * NOTE: cuebuf is modified by strtok_r().
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int parseCueSheet(char *cuebuf);
+
+		/**
+		 * Get the index of the specified track number.
+		 * @param trackNumber Track number. (1-based)
+		 * @return Index into tracks, or -1 if not found.
+		 */
+		int trackIndex(int trackNumber) const;
+
+		/**
+		 * Open a track file's underlying file.
+		 * This doesn't check the file type or update trackFiles.
+		 * @param fileIdx Index into trackFiles.
+		 * @return IRpFile*, or nullptr on error.
+		 */
+		IRpFile *openRelatedFile(unsigned int fileIdx) const;
+
+		/**
+		 * Open a track file.
+		 * Previous files are opened if necessary in order
+		 * to determine the starting LBA.
+		 * @param fileIdx Index into trackFiles.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int openFile(unsigned int fileIdx);
+
+		/**
+		 * Load a track's block range.
+		 * The track's file is opened if necessary.
+		 * @param trackIdx Index into tracks.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int loadTrack(unsigned int trackIdx);
+
+		/**
+		 * Find the data track containing the specified block.
+		 * Tracks are loaded if necessary.
+		 * @param blockIdx Block index.
+		 * @return Track, or nullptr if not found.
+		 */
+		const Track *findTrack(uint32_t blockIdx);
+};
+
+/** CueReaderPrivate **/
+
+CueReaderPrivate::CueReaderPrivate(CueReader *q)
+	: super(q)
+	, refCnt(1)
+	, blockCount(0)
+{
+	// CueReader overrides readBlock(), so SparseDiscReader
+	// can't read blocks using getPhysBlockAddr().
+	canCoalesce = false;
+}
+
+CueReaderPrivate::~CueReaderPrivate()
+{
+	close();
+}
+
+/**
+ * Close all opened files.
+ */
+void CueReaderPrivate::close(void)
+{
+	std::for_each(trackFiles.begin(), trackFiles.end(),
+		[](TrackFile &trackFile) {
+			if (trackFile.file) {
+				trackFile.file->unref();
+			}
+		}
+	);
+	trackFiles.clear();
+	tracks.clear();
+
+	// Cue sheet.
+	RP_Q(CueReader);
+	if (q->m_file) {
+		q->m_file->unref();
+		q->m_file = nullptr;
+	}
+}
+
+/**
+ * Parse an MSF timestamp. (mm:ss:ff)
+ * @param str	[in] String.
+ * @param frames	[out] Frame count.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CueReaderPrivate::parseMSF(const char *str, unsigned int &frames)
+{
+	unsigned int mm, ss, ff;
+	char c;
+	int count = sscanf(str, "%u:%u:%u%c", &mm, &ss, &ff, &c);
+	if (count < 3 || (count == 4 && !ISSPACE(c))) {
+		// Invalid timestamp.
+		return -EIO;
+	}
+
+	// 75 frames per second.
+	// 2097152 frames == 4 GB if using 2048-byte sectors.
+	if (mm > 999 || ss >= 60 || ff >= 75) {
+		// Out of range.
+		return -EIO;
+	}
+	frames = (((mm * 60) + ss) * 75) + ff;
+	return 0;
+}
+
+/**
+ * Parse a cue sheet.
+ * @param cuebuf NULL-terminated string containing the cue sheet. (Must be writable!)
+ * NOTE: cuebuf is modified by strtok_r().
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CueReaderPrivate::parseCueSheet(char *cuebuf)
+{
+	assert(trackFiles.empty());
+	assert(tracks.empty());
+	if (!trackFiles.empty() || !tracks.empty()) {
+		// Cue sheet is already loaded...
+		return -EEXIST;
+	}
+
+	// Skip the UTF-8 BOM, if present.
+	// If the BOM is present, filenames are UTF-8.
+	bool isUtf8 = false;
+	if (!memcmp(cuebuf, "\xEF\xBB\xBF", 3)) {
+		cuebuf += 3;
+		isUtf8 = true;
+	}
+
+	// Supported track modes.
+	// Sector sizes are needed for all modes in order to
+	// calculate file offsets, but only some modes
+	// can be read as data tracks.
+	static const struct {
+		char mode[11];
+		uint16_t sectorSize;
+		bool isData;
+	} trackModes[] = {
+		{"AUDIO",	2352, false},
+		{"CDG",		2448, false},
+		{"MODE1/2048",	2048, true},
+		{"MODE1/2352",	2352, true},
+		{"MODE2/2336",	2336, false},
+		{"MODE2/2352",	2352, true},
+		{"CDI/2336",	2336, false},
+		{"CDI/2352",	2352, false},
+	};
+
+	// Format: KEYWORD args...
+	// Only FILE, TRACK, INDEX 01, and PREGAP are used.
+	// Other keywords, e.g. REM and TITLE, are ignored.
+	Track *track = nullptr;
+	bool hasIndex01 = false;
+	char *linesaveptr = nullptr;
+	for (char *line = strtok_r(cuebuf, "\n", &linesaveptr);
+	     line != nullptr; line = strtok_r(nullptr, "\n", &linesaveptr))
+	{
+		// Remove trailing whitespace, including '\r'.
+		size_t len = strlen(line);
+		while (len > 0 && ISSPACE(line[len-1])) {
+			line[--len] = 0;
+		}
+		// Skip leading whitespace.
+		while (ISSPACE(*line)) {
+			line++;
+		}
+		if (*line == 0) {
+			// Empty line.
+			continue;
+		}
+
+		// Get the keyword.
+		char *args = line;
+		while (*args != 0 && !ISSPACE(*args)) {
+			args++;
+		}
+		if (*args != 0) {
+			*args++ = 0;
+			while (ISSPACE(*args)) {
+				args++;
+			}
+		}
+
+		if (!strcasecmp(line, "FILE")) {
+			// FILE "filename" TYPE
+			// The filename might not be quoted.
+			if (track && !hasIndex01) {
+				// Previous track doesn't have INDEX 01.
+				return -EIO;
+			}
+			char *type;
+			if (*args == '"') {
+				args++;
+				type = strchr(args, '"');
+				if (!type) {
+					// Missing closing quote.
+					return -EIO;
+				}
+				*type++ = 0;
+			} else {
+				type = strrchr(args, ' ');
+				if (!type) {
+					type = strrchr(args, '\t');
+				}
+				if (!type) {
+					// Missing file type.
+					return -EIO;
+				}
+				*type++ = 0;
+			}
+			while (ISSPACE(*type)) {
+				type++;
+			}
+			if (args[0] == 0 || trackFiles.size() >= 99) {
+				// Empty filename, or too many files.
+				return -EIO;
+			}
+
+			TrackFile trackFile;
+			// FIXME: UTF-8 or Latin-1 if there's no BOM?
+			trackFile.filename = (isUtf8 ? string(args) : latin1_to_utf8(args, -1));
+			trackFile.file = nullptr;
+			trackFile.lbaStart = 0;
+			trackFile.frameCount = 0;
+			// NOTE: MOTOROLA is big-endian audio data.
+			// Data tracks are the same as BINARY.
+			trackFile.isBinary = (!strcasecmp(type, "BINARY") || !strcasecmp(type, "MOTOROLA"));
+			trackFiles.push_back(std::move(trackFile));
+			track = nullptr;
+		} else if (!strcasecmp(line, "TRACK")) {
+			// TRACK nn MODE
+			if (trackFiles.empty() || (track && !hasIndex01)) {
+				// No FILE, or the previous track doesn't have INDEX 01.
+				return -EIO;
+			}
+			char *endptr = nullptr;
+			const long trackNumber = strtol(args, &endptr, 10);
+			if (trackNumber <= 0 || trackNumber > 99 || !ISSPACE(*endptr) ||
+			    (!tracks.empty() && trackNumber <= tracks.back().trackNumber))
+			{
+				// Track number is invalid or out of order.
+				return -EIO;
+			}
+			while (ISSPACE(*endptr)) {
+				endptr++;
+			}
+
+			unsigned int i;
+			for (i = 0; i < ARRAY_SIZE(trackModes); i++) {
+				if (!strcasecmp(endptr, trackModes[i].mode))
+					break;
+			}
+			if (i >= ARRAY_SIZE(trackModes)) {
+				// Unsupported track mode.
+				return -EIO;
+			}
+
+			const size_t idx = tracks.size();
+			tracks.resize(idx+1);
+			track = &tracks[idx];
+			track->physOffset = 0;
+			track->index01 = 0;
+			track->pregap = 0;
+			track->blockStart = 0;
+			track->blockEnd = 0;
+			track->fileIdx = static_cast<unsigned int>(trackFiles.size() - 1);
+			track->sectorSize = trackModes[i].sectorSize;
+			track->trackNumber = static_cast<uint8_t>(trackNumber);
+			// Data tracks must be in binary files.
+			track->isData = (trackModes[i].isData && trackFiles.back().isBinary);
+			track->loaded = false;
+			hasIndex01 = false;
+		} else if (!strcasecmp(line, "INDEX")) {
+			// INDEX nn mm:ss:ff
+			if (!track) {
+				// No TRACK.
+				return -EIO;
+			}
+			char *endptr = nullptr;
+			const long indexNumber = strtol(args, &endptr, 10);
+			if (indexNumber < 0 || indexNumber > 99 || !ISSPACE(*endptr)) {
+				// Invalid index number.
+				return -EIO;
+			}
+			if (indexNumber != 1) {
+				// Only INDEX 01 is needed.
+				continue;
+			}
+
+			unsigned int frames;
+			if (hasIndex01 || parseMSF(endptr + 1, frames) != 0) {
+				// Duplicate INDEX 01, or invalid timestamp.
+				return -EIO;
+			}
+			track->index01 = frames;
+			hasIndex01 = true;
+		} else if (!strcasecmp(line, "PREGAP")) {
+			// PREGAP mm:ss:ff
+			// This gap isn't stored in the file.
+			unsigned int frames;
+			if (!track || hasIndex01 || parseMSF(args, frames) != 0) {
+				// PREGAP must be between TRACK and INDEX 01.
+				return -EIO;
+			}
+			track->pregap = frames;
+		}
+	}
+
+	if (tracks.empty() || !hasIndex01) {
+		// No tracks, or the last track doesn't have INDEX 01.
+		return -EIO;
+	}
+
+	// Calculate the file offsets and total PREGAP frames.
+	unsigned int pregap = 0;
+	for (size_t i = 0; i < tracks.size(); i++) {
+		Track &cur = tracks[i];
+		pregap += cur.pregap;
+		cur.pregap = pregap;
+
+		if (i == 0 || tracks[i-1].fileIdx != cur.fileIdx) {
+			// First track in this file.
+			// NOTE: Frames before INDEX 01 use this track's sector size.
+			cur.physOffset = static_cast<off64_t>(cur.index01) * cur.sectorSize;
+		} else {
+			// Additional track in this file.
+			const Track &prev = tracks[i-1];
+			if (cur.index01 <= prev.index01) {
+				// Tracks overlap.
+				return -EIO;
+			}
+			cur.physOffset = prev.physOffset +
+				(static_cast<off64_t>(cur.index01 - prev.index01) * prev.sectorSize);
+		}
+	}
+
+	// Every file must have at least one track.
+	for (size_t i = 0; i < trackFiles.size(); i++) {
+		if (std::none_of(tracks.cbegin(), tracks.cend(),
+			[i](const Track &track) { return track.fileIdx == i; }))
+		{
+			// No tracks in this file.
+			return -EIO;
+		}
+	}
+
+	// Done parsing the cue sheet.
+	return 0;
+}
+
+/**
+ * Get the index of the specified track number.
+ * @param trackNumber Track number. (1-based)
+ * @return Index into tracks, or -1 if not found.
+ */
+int CueReaderPrivate::trackIndex(int trackNumber) const
+{
+	if (trackNumber <= 0 || trackNumber > 99) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < tracks.size(); i++) {
+		if (tracks[i].trackNumber == trackNumber) {
+			return static_cast<int>(i);
+		}
+	}
+
+	// Track not found.
+	return -1;
+}
+
+/**
+ * Open a track file's underlying file.
+ * This doesn't check the file type or update trackFiles.
+ * @param fileIdx Index into trackFiles.
+ * @return IRpFile*, or nullptr on error.
+ */
+IRpFile *CueReaderPrivate::openRelatedFile(unsigned int fileIdx) const
+{
+	assert(fileIdx < trackFiles.size());
+	if (fileIdx >= trackFiles.size()) {
+		return nullptr;
+	}
+
+	// Separate the file extension.
+	string basename = trackFiles[fileIdx].filename;
+	string ext;
+	size_t dotpos = basename.find_last_of('.');
+	if (dotpos != string::npos) {
+		ext = basename.substr(dotpos);
+		basename.resize(dotpos);
+	}
+
+	// Open the related file.
+	IRpFile *file = FileSystem::openRelatedFile(filename.c_str(), basename.c_str(), ext.c_str());
+	if (!file && trackFiles.size() == 1) {
+		// The image may have been renamed without updating
+		// the cue sheet. Try the cue sheet's basename.
+		file = FileSystem::openRelatedFile(filename.c_str(), nullptr, ".bin");
+	}
+	return file;
+}
+
+/**
+ * Open a track file.
+ * Previous files are opened if necessary in order
+ * to determine the starting LBA.
+ * @param fileIdx Index into trackFiles.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CueReaderPrivate::openFile(unsigned int fileIdx)
+{
+	assert(fileIdx < trackFiles.size());
+	if (fileIdx >= trackFiles.size()) {
+		return -EINVAL;
+	}
+
+	TrackFile &trackFile = trackFiles[fileIdx];
+	if (trackFile.file) {
+		// File is already open.
+		return 0;
+	} else if (!trackFile.isBinary) {
+		// Audio file formats aren't supported, so the
+		// number of frames can't be determined.
+		return -ENOTSUP;
+	}
+
+	// The starting LBA depends on the length of the previous file.
+	unsigned int lbaStart = 0;
+	if (fileIdx > 0) {
+		int ret = openFile(fileIdx - 1);
+		if (ret != 0) {
+			// Unable to open the previous file.
+			return ret;
+		}
+		const TrackFile &prevFile = trackFiles[fileIdx - 1];
+		lbaStart = prevFile.lbaStart + prevFile.frameCount;
+	}
+
+	// Open the related file.
+	IRpFile *const file = openRelatedFile(fileIdx);
+	if (!file) {
+		// Unable to open the file.
+		// TODO: Return the actual error.
+		return -ENOENT;
+	}
+
+	// Find the last track in this file.
+	auto lastTrack = std::find_if(tracks.crbegin(), tracks.crend(),
+		[fileIdx](const Track &track) { return track.fileIdx == fileIdx; });
+	assert(lastTrack != tracks.crend());
+
+	// Calculate the number of frames using the last track's sector size.
+	const off64_t fileSize = file->size();
+	if (fileSize <= lastTrack->physOffset) {
+		// File is too small.
+		file->unref();
+		return -EIO;
+	}
+
+	// File opened.
+	trackFile.file = file;
+	trackFile.lbaStart = lbaStart;
+	trackFile.frameCount = lastTrack->index01 +
+		static_cast<unsigned int>((fileSize - lastTrack->physOffset) / lastTrack->sectorSize);
+	return 0;
+}
+
+/**
+ * Load a track's block range.
+ * The track's file is opened if necessary.
+ * @param trackIdx Index into tracks.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CueReaderPrivate::loadTrack(unsigned int trackIdx)
+{
+	assert(trackIdx < tracks.size());
+	if (trackIdx >= tracks.size()) {
+		return -EINVAL;
+	}
+
+	Track &track = tracks[trackIdx];
+	if (track.loaded) {
+		// Track is already loaded.
+		return 0;
+	}
+
+	int ret = openFile(track.fileIdx);
+	if (ret != 0) {
+		// Unable to open the file.
+		return ret;
+	}
+
+	// The track ends at the next track in the same file,
+	// or at the end of the file.
+	const TrackFile &trackFile = trackFiles[track.fileIdx];
+	unsigned int endFrame = trackFile.frameCount;
+	if (trackIdx + 1 < tracks.size() && tracks[trackIdx + 1].fileIdx == track.fileIdx) {
+		endFrame = tracks[trackIdx + 1].index01;
+	}
+	if (endFrame <= track.index01) {
+		// Empty track.
+		return -EIO;
+	}
+
+	track.blockStart = trackFile.lbaStart + track.pregap + track.index01;
+	track.blockEnd = track.blockStart + (endFrame - track.index01) - 1;
+	track.loaded = true;
+	return 0;
+}
+
+/**
+ * Find the data track containing the specified block.
+ * Tracks are loaded if necessary.
+ * @param blockIdx Block index.
+ * @return Track, or nullptr if not found.
+ */
+const CueReaderPrivate::Track *CueReaderPrivate::findTrack(uint32_t blockIdx)
+{
+	for (size_t i = 0; i < tracks.size(); i++) {
+		const Track &track = tracks[i];
+		if (!track.isData) {
+			// Not a data track.
+			continue;
+		}
+
+		if (!track.loaded && loadTrack(static_cast<unsigned int>(i)) != 0) {
+			// Unable to load the track.
+			// Skip for now.
+			continue;
+		}
+
+		if (blockIdx >= track.blockStart && blockIdx <= track.blockEnd) {
+			// Found the track.
+			assert(trackFiles[track.fileIdx].file != nullptr);
+			return &track;
+		}
+	}
+
+	// Not found in any data track.
+	return nullptr;
+}
+
+/** CueTrackFile **/
+
+/**
+ * Data track file.
+ * The CueReader is ref()'d, so it stays alive
+ * as long as the file is open.
+ */
+class CueTrackFile : public PartitionFile
+{
+	public:
+		CueTrackFile(CueReader *cueReader, off64_t offset, off64_t size)
+			: super(cueReader, offset, size)
+			, m_cueReader(cueReader->ref())
+		{ }
+	protected:
+		virtual ~CueTrackFile()
+		{
+			m_cueReader->unref();
+		}
+
+	private:
+		typedef PartitionFile super;
+		RP_DISABLE_COPY(CueTrackFile)
+
+	private:
+		CueReader *const m_cueReader;
+};
+
+/** CueReader **/
+
+CueReader::CueReader(IRpFile *file)
+	: super(new CueReaderPrivate(this), file)
+{
+	if (!m_file) {
+		// File could not be ref()'d.
+		return;
+	}
+
+	// Save the filename for later.
+	RP_D(CueReader);
+	d->filename = m_file->filename();
+
+	// Cue sheets should be 64 KB or less.
+	const off64_t fileSize = m_file->size();
+	if (fileSize <= 0 || fileSize > 65536) {
+		// Invalid cue sheet size.
+		m_file->unref();
+		m_file = nullptr;
+		m_lastError = EIO;
+		return;
+	}
+
+	// Read the cue sheet and parse the track information.
+	const unsigned int cuesize = static_cast<unsigned int>(fileSize);
+	unique_ptr<char[]> cuebuf(new char[cuesize+1]);
+	size_t size = m_file->seekAndRead(0, cuebuf.get(), cuesize);
+	if (size != cuesize) {
+		// Read error.
+		m_file->unref();
+		m_file = nullptr;
+		m_lastError = EIO;
+		return;
+	}
+
+	// Make sure the string is NULL-terminated.
+	cuebuf[cuesize] = 0;
+
+	// Parse the cue sheet.
+	int ret = d->parseCueSheet(cuebuf.get());
+	if (ret != 0) {
+		// Error parsing the cue sheet.
+		d->close();
+		m_lastError = EIO;
+		return;
+	}
+
+	// The last data track that can be loaded determines the disc size.
+	// NOTE: Only the files up to and including this track are opened.
+	// Other files are opened on demand.
+	const CueReaderPrivate::Track *lastTrack = nullptr;
+	ret = -ENOENT;
+	for (int i = static_cast<int>(d->tracks.size()) - 1; i >= 0; i--) {
+		if (!d->tracks[i].isData)
+			continue;
+
+		ret = d->loadTrack(static_cast<unsigned int>(i));
+		if (ret == 0) {
+			lastTrack = &d->tracks[i];
+			break;
+		}
+	}
+	if (!lastTrack) {
+		// No data tracks could be loaded.
+		d->close();
+		m_lastError = -ret;
+		return;
+	}
+
+	// Disc parameters.
+	d->block_size = 2048;
+	d->blockCount = lastTrack->blockEnd + 1;
+	d->disc_size = static_cast<off64_t>(d->blockCount) * 2048;
+
+	// Reset the disc position.
+	d->pos = 0;
+}
+
+/**
+ * Take a reference to this CueReader* object.
+ * @return this
+ */
+CueReader *CueReader::ref(void)
+{
+	RP_D(CueReader);
+	ATOMIC_INC_FETCH(&d->refCnt);
+	return this;
+}
+
+/**
+ * Unreference this CueReader* object.
+ * If the reference count reaches 0, the CueReader* object is deleted.
+ */
+void CueReader::unref(void)
+{
+	RP_D(CueReader);
+	assert(d->refCnt > 0);
+	if (ATOMIC_DEC_FETCH(&d->refCnt) <= 0) {
+		// All references removed.
+		delete this;
+	}
+}
+
+/**
+ * Is a disc image supported by this class?
+ * @param pHeader Disc image header.
+ * @param szHeader Size of header.
+ * @return Class-specific disc format ID (>= 0) if supported; -1 if not.
+ */
+int CueReader::isDiscSupported_static(const uint8_t *pHeader, size_t szHeader)
+{
+	// NOTE: There's no magic number, so we'll check if the
+	// first few lines contain valid cue sheet commands.
+	// A FILE command must be present before the first TRACK.
+	static const char *const otherKeywords[] = {
+		"REM", "CATALOG", "CDTEXTFILE", "PERFORMER", "SONGWRITER", "TITLE",
+	};
+
+	const char *p = reinterpret_cast<const char*>(pHeader);
+	const char *const p_end = p + szHeader;
+	if (szHeader >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3)) {
+		// Skip the UTF-8 BOM.
+		p += 3;
+	}
+
+	bool hasFile = false;
+	while (p < p_end) {
+		const char *const eol = static_cast<const char*>(memchr(p, '\n', p_end - p));
+		if (!eol) {
+			// Incomplete line.
+			break;
+		}
+
+		// Skip leading whitespace.
+		while (p < eol && ISSPACE(*p)) {
+			p++;
+		}
+		if (p == eol) {
+			// Empty line.
+			p = eol + 1;
+			continue;
+		}
+
+		// Get the keyword. It must be followed by whitespace.
+		const char *kw_end = p;
+		while (kw_end < eol && ISALPHA(*kw_end)) {
+			kw_end++;
+		}
+		const size_t kw_len = kw_end - p;
+		if (kw_len == 0 || !ISSPACE(*kw_end)) {
+			// Not a keyword.
+			return -1;
+		}
+
+		if (kw_len == 4 && !strncasecmp(p, "FILE", 4)) {
+			hasFile = true;
+		} else if (kw_len == 5 && !strncasecmp(p, "TRACK", 5)) {
+			// Found a TRACK command.
+			return (hasFile ? 0 : -1);
+		} else {
+			bool found = false;
+			for (const char *const keyword : otherKeywords) {
+				if (kw_len == strlen(keyword) && !strncasecmp(p, keyword, kw_len)) {
+					found = true;
+					break;
+				}
+			}
+			if (!found) {
+				// Unknown keyword.
+				return -1;
+			}
+		}
+
+		p = eol + 1;
+	}
+
+	// No TRACK command found.
+	return -1;
+}
+
+/**
+ * Is a disc image supported by this object?
+ * @param pHeader Disc image header.
+ * @param szHeader Size of header.
+ * @return Class-specific system ID (>= 0) if supported; -1 if not.
+ */
+int CueReader::isDiscSupported(const uint8_t *pHeader, size_t szHeader) const
+{
+	return isDiscSupported_static(pHeader, szHeader);
+}
+
+/**
+ * Is the specified file a cue sheet?
+ * This checks both the file extension and the contents.
+ * @param file File to check.
+ * @return True if this is a cue sheet; false if not.
+ */
+bool CueReader::isCueSheet(IRpFile *file)
+{
+	if (!file || file->isDevice()) {
+		// Devices can't be cue sheets.
+		return false;
+	}
+
+	// Check the file extension.
+	const string filename = file->filename();
+	const char *const ext = FileSystem::file_ext(filename);
+	if (!ext || strcasecmp(ext, ".cue") != 0) {
+		// Not a cue sheet.
+		return false;
+	}
+
+	// Check the contents.
+	uint8_t header[4096];
+	size_t size = file->seekAndRead(0, header, sizeof(header));
+	return (isDiscSupported_static(header, size) >= 0);
+}
+
+/** SparseDiscReader functions. **/
+
+/**
+ * Get the physical address of the specified logical block index.
+ *
+ * NOTE: Not implemented in this subclass.
+ *
+ * @param blockIdx	[in] Block index.
+ * @return Physical block address. (-1 due to not being implemented)
+ */
+off64_t CueReader::getPhysBlockAddr(uint32_t blockIdx) const
+{
+	RP_UNUSED(blockIdx);
+	assert(!"CueReader::getPhysBlockAddr() is not implemented.");
+	return -1;
+}
+
+/**
+ * Read the specified block.
+ *
+ * This can read either a full block or a partial block.
+ * For a full block, set pos = 0 and size = block_size.
+ *
+ * @param blockIdx	[in] Block index.
+ * @param ptr		[out] Output data buffer.
+ * @param pos		[in] Starting position. (Must be >= 0 and <= the block size!)
+ * @param size		[in] Amount of data to read, in bytes. (Must be <= the block size!)
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int CueReader::readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size)
+{
+	// Read 'size' bytes of block 'blockIdx', starting at 'pos'.
+	// NOTE: This can only be called by SparseDiscReader,
+	// so the main assertions are already checked there.
+	RP_D(CueReader);
+	assert(pos >= 0 && pos < (int)d->block_size);
+	assert(size <= d->block_size);
+	assert(blockIdx < d->blockCount);
+	if (pos < 0 || pos >= static_cast<int>(d->block_size) ||
+		size > d->block_size ||
+		static_cast<off64_t>(pos + size) > static_cast<off64_t>(d->block_size) ||
+	    blockIdx >= d->blockCount)
+	{
+		// pos+size is out of range.
+		return -1;
+	}
+
+	if (unlikely(size == 0)) {
+		// Nothing to read.
+		return 0;
+	}
+
+	// Find the block.
+	const CueReaderPrivate::Track *const track = d->findTrack(blockIdx);
+	if (!track) {
+		// Not found in any data track.
+		return 0;
+	}
+
+	// Go to the block.
+	IRpFile *const file = d->trackFiles[track->fileIdx].file;
+	const off64_t phys_pos = track->physOffset +
+		(static_cast<off64_t>(blockIdx - track->blockStart) * track->sectorSize);
+	if (track->sectorSize == 2352) {
+		// Read the whole sector so we can determine the sector mode.
+		CDROM_2352_Sector_t sector;
+		size_t sz_read = file->seekAndRead(phys_pos, &sector, sizeof(sector));
+		m_lastError = file->lastError();
+		if (sz_read != sizeof(sector)) {
+			// Seek and/or read error.
+			return -1;
+		}
+		memcpy(ptr, cdrom_sector_user_data(&sector) + pos, size);
+		return static_cast<int>(size);
+	}
+
+	size_t sz_read = file->seekAndRead(phys_pos + pos, ptr, size);
+	m_lastError = file->lastError();
+	return (sz_read > 0 ? (int)sz_read : -1);
+}
+
+/**
+ * Read multiple full blocks.
+ * Blocks are read from a single track. For 2352-byte tracks,
+ * raw sectors are read in batches, and the user data is
+ * copied from each sector.
+ *
+ * @param blockIdx	[in] First block index.
+ * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+ * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int CueReader::readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount)
+{
+	RP_D(CueReader);
+	assert(blockIdx < d->blockCount);
+	assert(blockCount >= 1);
+	if (blockIdx >= d->blockCount) {
+		// Out of range.
+		return -1;
+	}
+
+	// Find the block.
+	const CueReaderPrivate::Track *const track = d->findTrack(blockIdx);
+	if (!track) {
+		// Not found in any data track.
+		return 0;
+	}
+
+	// Only read blocks within this track.
+	if (blockCount > track->blockEnd - blockIdx + 1) {
+		blockCount = track->blockEnd - blockIdx + 1;
+	}
+
+	IRpFile *const file = d->trackFiles[track->fileIdx].file;
+	const off64_t phys_pos = track->physOffset +
+		(static_cast<off64_t>(blockIdx - track->blockStart) * track->sectorSize);
+	if (track->sectorSize != 2352) {
+		// 2048-byte sectors. Read the blocks directly.
+		size_t sz_read = file->seekAndRead(phys_pos, ptr, static_cast<size_t>(blockCount) * 2048);
+		m_lastError = file->lastError();
+		return static_cast<int>(sz_read);
+	}
+
+	// 2352-byte sectors.
+	const size_t sz_read = d->sectorBuf.readUserData(file, phys_pos, ptr, blockCount);
+	m_lastError = file->lastError();
+	return static_cast<int>(sz_read);
+}
+
+/** Hashing functions **/
+
+/**
+ * Open the image files that make up this disc image.
+ * These are the track files, including audio tracks,
+ * in cue sheet order.
+ *
+ * @param files	[out] Image files, in disc order. (Must be unref()'d by the caller.)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CueReader::openImageFiles(vector<IRpFile*> &files)
+{
+	RP_D(const CueReader);
+	if (d->trackFiles.empty()) {
+		// No track files.
+		return -EBADF;
+	}
+
+	vector<IRpFile*> v_files;
+	v_files.reserve(d->trackFiles.size());
+	for (unsigned int i = 0; i < static_cast<unsigned int>(d->trackFiles.size()); i++) {
+		const CueReaderPrivate::TrackFile &trackFile = d->trackFiles[i];
+		IRpFile *const file = (trackFile.file
+			? trackFile.file->ref()
+			: d->openRelatedFile(i));
+		if (!file) {
+			// Unable to open the file.
+			std::for_each(v_files.begin(), v_files.end(),
+				[](IRpFile *pFile) { pFile->unref(); });
+			return -ENOENT;
+		}
+		v_files.push_back(file);
+	}
+
+	files.insert(files.end(), v_files.begin(), v_files.end());
+	return 0;
+}
+
+/** CUE-specific functions. **/
+
+/**
+ * Get the track count.
+ * @return Track count.
+ */
+int CueReader::trackCount(void) const
+{
+	RP_D(const CueReader);
+	return static_cast<int>(d->tracks.size());
+}
+
+/**
+ * Get the track number of the first data track.
+ * @return Track number (1-based), or -1 if there are no data tracks.
+ */
+int CueReader::firstDataTrack(void) const
+{
+	RP_D(const CueReader);
+	auto iter = std::find_if(d->tracks.cbegin(), d->tracks.cend(),
+		[](const CueReaderPrivate::Track &track) { return track.isData; });
+	return (iter != d->tracks.cend() ? iter->trackNumber : -1);
+}
+
+/**
+ * Get the starting LBA of the specified track number.
+ * The track is opened if necessary.
+ * @param trackNumber Track number. (1-based)
+ * @return Starting LBA, or -1 if the track number is invalid.
+ */
+int CueReader::startingLBA(int trackNumber)
+{
+	assert(trackNumber > 0);
+	assert(trackNumber <= 99);
+
+	RP_D(CueReader);
+	const int idx = d->trackIndex(trackNumber);
+	if (idx < 0 || d->loadTrack(static_cast<unsigned int>(idx)) != 0)
+		return -1;
+
+	return static_cast<int>(d->tracks[idx].blockStart);
+}
+
+/**
+ * Open a data track as a file with 2048-byte sectors.
+ *
+ * NOTE: The returned file takes a reference to this
+ * CueReader, so the caller can unref() the CueReader
+ * while the file is still open.
+ *
+ * @param trackNumber Track number. (1-based)
+ * @return IRpFile*, or nullptr on error.
+ */
+IRpFile *CueReader::openTrackFile(int trackNumber)
+{
+	RP_D(CueReader);
+	const int idx = d->trackIndex(trackNumber);
+	if (idx < 0 || !d->tracks[idx].isData ||
+	    d->loadTrack(static_cast<unsigned int>(idx)) != 0)
+	{
+		// Invalid track number, or not a data track.
+		return nullptr;
+	}
+
+	const CueReaderPrivate::Track &track = d->tracks[idx];
+	if (track.blockEnd >= d->blockCount) {
+		// Track is past the end of the disc.
+		// This can happen if a later data track couldn't be
+		// loaded when the disc size was determined.
+		return nullptr;
+	}
+
+	return new CueTrackFile(this,
+		static_cast<off64_t>(track.blockStart) * 2048,
+		static_cast<off64_t>(track.blockEnd - track.blockStart + 1) * 2048);
+}
+
+/**
+ * Open the first data track of a cue sheet as a file with 2048-byte sectors.
+ * The returned file keeps its CueReader alive.
+ * @param file Cue sheet.
+ * @return IRpFile*, or nullptr on error.
+ */
+IRpFile *CueReader::openFirstDataTrack(IRpFile *file)
+{
+	CueReader *const cueReader = new CueReader(file);
+	IRpFile *const trackFile = (cueReader->isOpen()
+		? cueReader->openTrackFile(cueReader->firstDataTrack())
+		: nullptr);
+	cueReader->unref();
+	return trackFile;
+}
+
+}
@@ -0,0 +1,179 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * CueReader.hpp: CD-ROM reader for CUE+BIN disc images.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_DISC_CUEREADER_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_DISC_CUEREADER_HPP__
+
+#include "librpbase/disc/SparseDiscReader.hpp"
+
+namespace LibRomData {
+
+class CueReaderPrivate;
+class CueReader : public LibRpBase::SparseDiscReader
+{
+	public:
+		/**
+		 * Construct a CueReader with the specified file.
+		 * The file is ref()'d, so the original file can be
+		 * unref()'d by the caller afterwards.
+		 *
+		 * Track files are opened when their tracks are
+		 * first accessed.
+		 *
+		 * @param file Cue sheet to read from.
+		 */
+		explicit CueReader(LibRpFile::IRpFile *file);
+	protected:
+		virtual ~CueReader() { }	// call unref() instead
+
+	private:
+		typedef SparseDiscReader super;
+		RP_DISABLE_COPY(CueReader)
+	private:
+		friend class CueReaderPrivate;
+
+	public:
+		/**
+		 * Take a reference to this CueReader* object.
+		 * @return this
+		 */
+		CueReader *ref(void);
+
+		/**
+		 * Unreference this CueReader* object.
+		 * If the reference count reaches 0, the CueReader* object is deleted.
+		 */
+		void unref(void);
+
+	public:
+		/** Disc image detection functions. **/
+
+		/**
+		 * Is a disc image supported by this class?
+		 * @param pHeader Disc image header.
+		 * @param szHeader Size of header.
+		 * @return Class-specific disc format ID (>= 0) if supported; -1 if not.
+		 */
+		static int isDiscSupported_static(const uint8_t *pHeader, size_t szHeader);
+
+		/**
+		 * Is a disc image supported by this object?
+		 * @param pHeader Disc image header.
+		 * @param szHeader Size of header.
+		 * @return Class-specific disc format ID (>= 0) if supported; -1 if not.
+		 */
+		int isDiscSupported(const uint8_t *pHeader, size_t szHeader) const final;
+
+		/**
+		 * Is the specified file a cue sheet?
+		 * This checks both the file extension and the contents.
+		 * @param file File to check.
+		 * @return True if this is a cue sheet; false if not.
+		 */
+		static bool isCueSheet(LibRpFile::IRpFile *file);
+
+	protected:
+		/** SparseDiscReader functions. **/
+
+		/**
+		 * Get the physical address of the specified logical block index.
+		 *
+		 * NOTE: Not implemented in this subclass.
+		 *
+		 * @param blockIdx	[in] Block index.
+		 * @return Physical block address. (-1 due to not being implemented)
+		 */
+		off64_t getPhysBlockAddr(uint32_t blockIdx) const final;
+
+		/**
+		 * Read the specified block.
+		 *
+		 * This can read either a full block or a partial block.
+		 * For a full block, set pos = 0 and size = block_size.
+		 *
+		 * @param blockIdx	[in] Block index.
+		 * @param ptr		[out] Output data buffer.
+		 * @param pos		[in] Starting position. (Must be >= 0 and <= the block size!)
+		 * @param size		[in] Amount of data to read, in bytes. (Must be <= the block size!)
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		int readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size) final;
+
+		/**
+		 * Read multiple full blocks.
+		 * Blocks are read from a single track. For 2352-byte tracks,
+		 * raw sectors are read in batches, and the user data is
+		 * copied from each sector.
+		 *
+		 * @param blockIdx	[in] First block index.
+		 * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+		 * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		int readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount) final;
+
+	public:
+		/** Hashing functions **/
+
+		/**
+		 * Open the image files that make up this disc image.
+		 * These are the track files, including audio tracks,
+		 * in cue sheet order.
+		 *
+		 * @param files	[out] Image files, in disc order. (Must be unref()'d by the caller.)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int openImageFiles(std::vector<LibRpFile::IRpFile*> &files) final;
+
+	public:
+		/** CUE-specific functions. **/
+
+		/**
+		 * Get the track count.
+		 * @return Track count.
+		 */
+		int trackCount(void) const;
+
+		/**
+		 * Get the track number of the first data track.
+		 * @return Track number (1-based), or -1 if there are no data tracks.
+		 */
+		int firstDataTrack(void) const;
+
+		/**
+		 * Get the starting LBA of the specified track number.
+		 * The track is opened if necessary.
+		 * @param trackNumber Track number. (1-based)
+		 * @return Starting LBA, or -1 if the track number is invalid.
+		 */
+		int startingLBA(int trackNumber);
+
+		/**
+		 * Open a data track as a file with 2048-byte sectors.
+		 *
+		 * NOTE: The returned file takes a reference to this
+		 * CueReader, so the caller can unref() the CueReader
+		 * while the file is still open.
+		 *
+		 * @param trackNumber Track number. (1-based)
+		 * @return IRpFile*, or nullptr on error.
+		 */
+		LibRpFile::IRpFile *openTrackFile(int trackNumber);
+
+		/**
+		 * Open the first data track of a cue sheet as a file with 2048-byte sectors.
+		 * The returned file keeps its CueReader alive.
+		 * @param file Cue sheet.
+		 * @return IRpFile*, or nullptr on error.
+		 */
+		static LibRpFile::IRpFile *openFirstDataTrack(LibRpFile::IRpFile *file);
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_DISC_CUEREADER_HPP__ */
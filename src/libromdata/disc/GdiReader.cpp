@@ -11,6 +11,7 @@
 #include "librpbase/disc/SparseDiscReader_p.hpp"
 
 #include "../cdrom_structs.h"
+#include "CdromSectorBuffer.hpp"
 #include "IsoPartition.hpp"
 
 // librpbase, librpfile
@@ -65,11 +66,29 @@ class GdiReaderPrivate : public SparseDiscReaderPrivate {
 		// Value = pointer to BlockRange in blockRanges.
 		vector<BlockRange*> trackMappings;
 
+		// All track files, including audio tracks, in GDI order.
+		struct TrackFile {
+			string filename;		// Relative to the .gdi file.
+			uint16_t sectorSize;		// 2048 or 2352
+		};
+		vector<TrackFile> trackFiles;
+
+		// Raw sector buffer for readBlocks().
+		CdromSectorBuffer sectorBuf;
+
 		/**
 		 * Close all opened files.
 		 */
 		void close(void);
 
+		/**
+		 * Open a track file's underlying file.
+		 * @param trackFilename Track filename, relative to the .gdi file.
+		 * @param sectorSize Sector size. (used if the filename has no extension)
+		 * @return IRpFile*, or nullptr on error.
+		 */
+		IRpFile *openRelatedFile(const string &trackFilename, unsigned int sectorSize) const;
+
 		/**
 		 * Parse a GDI file.
 		 * @param gdibuf NULL-terminated string containing the GDI file. (Must be writable!)
@@ -84,6 +103,14 @@ class GdiReaderPrivate : public SparseDiscReaderPrivate {
 		 * @return 0 on success; negative POSIX error code on error.
 		 */
 		int openTrack(int trackNumber);
+
+		/**
+		 * Find the track containing the specified block.
+		 * The track is opened if necessary.
+		 * @param blockIdx Block index.
+		 * @return BlockRange, or nullptr if not found.
+		 */
+		const BlockRange *findBlockRange(uint32_t blockIdx);
 };
 
 /** GdiReaderPrivate **/
@@ -91,7 +118,11 @@ class GdiReaderPrivate : public SparseDiscReaderPrivate {
 GdiReaderPrivate::GdiReaderPrivate(GdiReader *q)
 	: super(q)
 	, blockCount(0)
-{ }
+{
+	// GdiReader overrides readBlock(), so SparseDiscReader
+	// can't read blocks using getPhysBlockAddr().
+	canCoalesce = false;
+}
 
 GdiReaderPrivate::~GdiReaderPrivate()
 {
@@ -112,6 +143,7 @@ void GdiReaderPrivate::close(void)
 	);
 	blockRanges.clear();
 	trackMappings.clear();
+	trackFiles.clear();
 
 	// GDI file.
 	RP_Q(GdiReader);
@@ -121,6 +153,30 @@ void GdiReaderPrivate::close(void)
 	}
 }
 
+/**
+ * Open a track file's underlying file.
+ * @param trackFilename Track filename, relative to the .gdi file.
+ * @param sectorSize Sector size. (used if the filename has no extension)
+ * @return IRpFile*, or nullptr on error.
+ */
+IRpFile *GdiReaderPrivate::openRelatedFile(const string &trackFilename, unsigned int sectorSize) const
+{
+	// Separate the file extension.
+	string basename = trackFilename;
+	string ext;
+	size_t dotpos = basename.find_last_of('.');
+	if (dotpos != string::npos) {
+		ext = basename.substr(dotpos);
+		basename.resize(dotpos);
+	} else {
+		// No extension. Add one based on sector size.
+		ext = (sectorSize == 2048 ? ".iso" : ".bin");
+	}
+
+	// Open the related file.
+	return FileSystem::openRelatedFile(filename.c_str(), basename.c_str(), ext.c_str());
+}
+
 /**
  * Parse a GDI file.
  * @param gdibuf NULL-terminated string containing the GDI file. (Must be writable!)
@@ -188,6 +244,13 @@ int GdiReaderPrivate::parseGdiFile(char *gdibuf)
 			return -EIO;
 		}
 
+		// Save the track file, including audio tracks.
+		// FIXME: UTF-8 or Latin-1?
+		TrackFile trackFile;
+		trackFile.filename = latin1_to_utf8(filename, -1);
+		trackFile.sectorSize = static_cast<uint16_t>(sectorSize);
+		trackFiles.push_back(std::move(trackFile));
+
 		// Check the track type.
 		if (type == 0) {
 			// Audio track.
@@ -219,9 +282,7 @@ int GdiReaderPrivate::parseGdiFile(char *gdibuf)
 		blockRange.sectorSize = static_cast<uint16_t>(sectorSize);
 		blockRange.trackNumber = static_cast<uint8_t>(trackNumber);
 		blockRange.reserved = 0;
-		// FIXME: UTF-8 or Latin-1?
-		filename[sizeof(filename)-1] = 0;
-		blockRange.filename = latin1_to_utf8(filename, -1);
+		blockRange.filename = trackFiles.back().filename;
 		blockRange.file = nullptr;
 
 		// Save the track mapping.
@@ -265,20 +326,8 @@ int GdiReaderPrivate::openTrack(int trackNumber)
 		return 0;
 	}
 
-	// Separate the file extension.
-	string basename = blockRange->filename;
-	string ext;
-	size_t dotpos = basename.find_last_of('.');
-	if (dotpos != string::npos) {
-		ext = basename.substr(dotpos);
-		basename.resize(dotpos);
-	} else {
-		// No extension. Add one based on sector size.
-		ext = (blockRange->sectorSize == 2048 ? ".iso" : ".bin");
-	}
-
 	// Open the related file.
-	IRpFile *file = FileSystem::openRelatedFile(filename.c_str(), basename.c_str(), ext.c_str());
+	IRpFile *const file = openRelatedFile(blockRange->filename, blockRange->sectorSize);
 	if (!file) {
 		// Unable to open the file.
 		// TODO: Return the actual error.
@@ -306,6 +355,56 @@ int GdiReaderPrivate::openTrack(int trackNumber)
 	return 0;
 }
 
+/**
+ * Find the track containing the specified block.
+ * The track is opened if necessary.
+ * @param blockIdx Block index.
+ * @return BlockRange, or nullptr if not found.
+ */
+const GdiReaderPrivate::BlockRange *GdiReaderPrivate::findBlockRange(uint32_t blockIdx)
+{
+	// TODO: Cache this lookup somewhere or something.
+	const BlockRange *blockRange = nullptr;
+	for (auto iter = blockRanges.cbegin(); iter != blockRanges.cend(); ++iter) {
+		// NOTE: Using volatile because it can change in openTrack().
+		const volatile BlockRange *const vbr = &(*iter);
+		if (blockIdx < vbr->blockStart) {
+			// Not in this track.
+			continue;
+		}
+
+		// Is the track loaded?
+		if (vbr->blockEnd == 0) {
+			// Track isn't loaded. Load it.
+			int ret = openTrack(vbr->trackNumber);
+			if (ret != 0) {
+				// Unable to load the track.
+				// Skip for now.
+				continue;
+			}
+		}
+
+		// Check the end block.
+		if (vbr->blockEnd != 0 && blockIdx <= vbr->blockEnd) {
+			// Found the track.
+			blockRange = (const BlockRange*)vbr;
+			break;
+		}
+	}
+
+	if (!blockRange) {
+		// Not found in any block range.
+		return nullptr;
+	}
+
+	assert(blockRange->file != nullptr);
+	if (!blockRange->file) {
+		// File *still* isn't open...
+		return nullptr;
+	}
+	return blockRange;
+}
+
 /** GdiReader **/
 
 GdiReader::GdiReader(IRpFile *file)
@@ -513,56 +612,113 @@ int GdiReader::readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size)
 	}
 
 	// Find the block.
-	// TODO: Cache this lookup somewhere or something.
-	const GdiReaderPrivate::BlockRange *blockRange = nullptr;
-	for (auto iter = d->blockRanges.cbegin(); iter != d->blockRanges.cend(); ++iter) {
-		// NOTE: Using volatile because it can change in d->openTrack().
-		const volatile GdiReaderPrivate::BlockRange *const vbr = &(*iter);
-		if (blockIdx < vbr->blockStart) {
-			// Not in this track.
-			continue;
-		}
+	const GdiReaderPrivate::BlockRange *const blockRange = d->findBlockRange(blockIdx);
+	if (!blockRange) {
+		// Not found in any block range.
+		return 0;
+	}
 
-		// Is the track loaded?
-		if (vbr->blockEnd == 0) {
-			// Track isn't loaded. Load it.
-			int ret = d->openTrack(vbr->trackNumber);
-			if (ret != 0) {
-				// Unable to load the track.
-				// Skip for now.
-				continue;
-			}
+	// Go to the block.
+	const off64_t phys_pos = static_cast<off64_t>(blockIdx - blockRange->blockStart) * blockRange->sectorSize;
+	if (blockRange->sectorSize == 2352) {
+		// Read the whole sector so we can determine the sector mode.
+		CDROM_2352_Sector_t sector;
+		size_t sz_read = blockRange->file->seekAndRead(phys_pos, &sector, sizeof(sector));
+		m_lastError = blockRange->file->lastError();
+		if (sz_read != sizeof(sector)) {
+			// Seek and/or read error.
+			return -1;
 		}
+		memcpy(ptr, cdrom_sector_user_data(&sector) + pos, size);
+		return static_cast<int>(size);
+	}
 
-		// Check the end block.
-		if (vbr->blockEnd != 0 && blockIdx <= vbr->blockEnd) {
-			// Found the track.
-			blockRange = (const GdiReaderPrivate::BlockRange*)vbr;
-			break;
-		}
+	size_t sz_read = blockRange->file->seekAndRead(phys_pos + pos, ptr, size);
+	m_lastError = blockRange->file->lastError();
+	return (sz_read > 0 ? (int)sz_read : -1);
+}
+
+/**
+ * Read multiple full blocks.
+ * Blocks are read from a single track. For 2352-byte tracks,
+ * raw sectors are read in batches, and the user data is
+ * copied from each sector.
+ *
+ * @param blockIdx	[in] First block index.
+ * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+ * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int GdiReader::readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount)
+{
+	RP_D(GdiReader);
+	assert(blockIdx < d->blockCount);
+	assert(blockCount >= 1);
+	if (blockIdx >= d->blockCount) {
+		// Out of range.
+		return -1;
 	}
 
+	// Find the block.
+	const GdiReaderPrivate::BlockRange *const blockRange = d->findBlockRange(blockIdx);
 	if (!blockRange) {
 		// Not found in any block range.
 		return 0;
 	}
 
-	assert(blockRange->file != nullptr);
-	if (!blockRange->file) {
-		// File *still* isn't open...
-		return 0;
+	// Only read blocks within this track.
+	if (blockCount > blockRange->blockEnd - blockIdx + 1) {
+		blockCount = blockRange->blockEnd - blockIdx + 1;
 	}
 
-	// Go to the block.
-	off64_t phys_pos = (static_cast<off64_t>(blockIdx - blockRange->blockStart) * blockRange->sectorSize) + pos;
-	if (blockRange->sectorSize == 2352) {
-		// FIXME: Read the whole block so we can determine if this is Mode 1 or Mode 2.
-		// Mode 1 data starts at byte 16; Mode 2 data starts at byte 24.
-		phys_pos += 16;
+	IRpFile *const file = blockRange->file;
+	const off64_t phys_pos = static_cast<off64_t>(blockIdx - blockRange->blockStart) * blockRange->sectorSize;
+	if (blockRange->sectorSize != 2352) {
+		// 2048-byte sectors. Read the blocks directly.
+		size_t sz_read = file->seekAndRead(phys_pos, ptr, static_cast<size_t>(blockCount) * 2048);
+		m_lastError = file->lastError();
+		return static_cast<int>(sz_read);
 	}
-	size_t sz_read = blockRange->file->seekAndRead(phys_pos, ptr, size);
-	m_lastError = blockRange->file->lastError();
-	return (sz_read > 0 ? (int)sz_read : -1);
+
+	// 2352-byte sectors.
+	const size_t sz_read = d->sectorBuf.readUserData(file, phys_pos, ptr, blockCount);
+	m_lastError = file->lastError();
+	return static_cast<int>(sz_read);
+}
+
+/** Hashing functions **/
+
+/**
+ * Open the image files that make up this disc image.
+ * These are the track files, including audio tracks,
+ * in GDI order.
+ *
+ * @param files	[out] Image files, in disc order. (Must be unref()'d by the caller.)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GdiReader::openImageFiles(vector<IRpFile*> &files)
+{
+	RP_D(const GdiReader);
+	if (d->trackFiles.empty()) {
+		// No track files.
+		return -EBADF;
+	}
+
+	vector<IRpFile*> v_files;
+	v_files.reserve(d->trackFiles.size());
+	for (const GdiReaderPrivate::TrackFile &trackFile : d->trackFiles) {
+		IRpFile *const file = d->openRelatedFile(trackFile.filename, trackFile.sectorSize);
+		if (!file) {
+			// Unable to open the file.
+			std::for_each(v_files.begin(), v_files.end(),
+				[](IRpFile *pFile) { pFile->unref(); });
+			return -ENOENT;
+		}
+		v_files.push_back(file);
+	}
+
+	files.insert(files.end(), v_files.begin(), v_files.end());
+	return 0;
 }
 
 /** GDI-specific functions. **/
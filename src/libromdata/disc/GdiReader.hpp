@@ -80,6 +80,32 @@ class GdiReader : public LibRpBase::SparseDiscReader
 		 */
 		int readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size) final;
 
+		/**
+		 * Read multiple full blocks.
+		 * Blocks are read from a single track. For 2352-byte tracks,
+		 * raw sectors are read in batches, and the user data is
+		 * copied from each sector.
+		 *
+		 * @param blockIdx	[in] First block index.
+		 * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+		 * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		int readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount) final;
+
+	public:
+		/** Hashing functions **/
+
+		/**
+		 * Open the image files that make up this disc image.
+		 * These are the track files, including audio tracks,
+		 * in GDI order.
+		 *
+		 * @param files	[out] Image files, in disc order. (Must be unref()'d by the caller.)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int openImageFiles(std::vector<LibRpFile::IRpFile*> &files) final;
+
 	public:
 		/** GDI-specific functions. **/
 
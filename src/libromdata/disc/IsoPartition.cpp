@@ -15,7 +15,10 @@ using namespace LibRpBase;
 using LibRpFile::IRpFile;
 
 // C++ STL classes.
+using std::array;
 using std::string;
+using std::unordered_map;
+using std::vector;
 
 namespace LibRomData {
 
@@ -43,16 +46,70 @@ class IsoPartitionPrivate
 		// ISO primary volume descriptor.
 		ISO_Primary_Volume_Descriptor pvd;
 
-		// Root directory.
-		// NOTE: Directory entries are variable-length, so this
-		// is a byte array, not an ISO_DirEntry array.
-		ao::uvector<uint8_t> rootDir_data;
+		// Joliet root directory entry.
+		// Copied from the Joliet supplementary volume descriptor.
+		// If Joliet isn't present, entry_length is 0.
+		ISO_DirEntry jolietRootDir;
+
+		// Directory trees.
+		enum DirTree {
+			TREE_PRIMARY	= 0,	// ISO-9660 filenames (cp1252)
+			TREE_JOLIET	= 1,	// Joliet filenames (UCS-2)
+
+			TREE_MAX
+		};
+
+		// Directory index entry.
+		struct IndexEntry {
+			uint32_t block;		// Starting block
+			uint32_t size;		// Size, in bytes
+			uint8_t flags;		// Flags (See ISO_File_Flags_t.)
+			bool loaded;		// Directories only: true if the directory's entries have been indexed.
+		};
+
+		// Directory index for each directory tree.
+		// Directories are loaded on demand as paths are looked up.
+		// - Key: Normalized path, without leading slashes. ("" for the root directory)
+		// - Value: IndexEntry
+		// NOTE: References to unordered_map values remain valid after rehashing.
+		array<unordered_map<string, IndexEntry>, TREE_MAX> dirIndex;
+
+		/**
+		 * Normalize a filename for the directory index.
+		 * - ASCII letters are converted to lowercase.
+		 * - File version suffixes (";1") are removed.
+		 * - Trailing dots are removed. ("FILE." -> "file")
+		 * @param name Filename. (UTF-8)
+		 * @param len Length of filename.
+		 * @return Normalized filename.
+		 */
+		static string normalizeName(const char *name, size_t len);
 
 		/**
 		 * Load the root directory.
+		 * This adds the root directory entries to the directory index
+		 * and loads the root directory of the primary directory tree.
 		 * @return 0 on success; negative POSIX error code on error.
 		 */
 		int loadRootDirectory(void);
+
+		/**
+		 * Load a directory and add its entries to the directory index.
+		 * @param tree Directory tree.
+		 * @param path Normalized directory path. ("" for the root directory)
+		 * @param entry Directory's index entry.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int loadDirectory(DirTree tree, const string &path, IndexEntry &entry);
+
+		/**
+		 * Look up a file or directory.
+		 * Directories are loaded as needed.
+		 * The primary directory tree is checked first, then Joliet.
+		 * @param filename Full path. (UTF-8)
+		 * @return IndexEntry, or nullptr if not found.
+		 */
+		const IndexEntry *lookup(const char *filename);
 };
 
 /** IsoPartitionPrivate **/
@@ -64,8 +121,9 @@ IsoPartitionPrivate::IsoPartitionPrivate(IsoPartition *q,
 	, partition_size(0)
 	, iso_start_offset(iso_start_offset)
 {
-	// Clear the PVD struct.
+	// Clear the PVD struct and the Joliet root directory entry.
 	memset(&pvd, 0, sizeof(pvd));
+	memset(&jolietRootDir, 0, sizeof(jolietRootDir));
 
 	if (!q->m_discReader) {
 		q->m_lastError = EIO;
@@ -85,7 +143,7 @@ IsoPartitionPrivate::IsoPartitionPrivate(IsoPartition *q,
 	// Load the primary volume descriptor.
 	// TODO: Assuming this is the first one.
 	// Check for multiple?
-	size_t size = q->m_discReader->seekAndRead(partition_offset + 0x8000, &pvd, sizeof(pvd));
+	size_t size = q->m_discReader->seekAndRead(partition_offset + ISO_PVD_ADDRESS_2048, &pvd, sizeof(pvd));
 	if (size != sizeof(pvd)) {
 		// Seek and/or read error.
 		q->m_discReader = nullptr;
@@ -102,6 +160,31 @@ IsoPartitionPrivate::IsoPartitionPrivate(IsoPartition *q,
 		return;
 	}
 
+	// Check for a Joliet supplementary volume descriptor.
+	// NOTE: Only checking up to 16 volume descriptors.
+	for (unsigned int i = 1; i < 16; i++) {
+		ISO_Primary_Volume_Descriptor svd;
+		size = q->m_discReader->seekAndRead(partition_offset + ISO_PVD_ADDRESS_2048 +
+			(i * ISO_SECTOR_SIZE_MODE1_COOKED), &svd, sizeof(svd));
+		if (size != sizeof(svd) ||
+		    svd.header.type == ISO_VDT_TERMINATOR ||
+		    memcmp(svd.header.identifier, ISO_VD_MAGIC, sizeof(svd.header.identifier)) != 0)
+		{
+			// End of the volume descriptors.
+			break;
+		}
+
+		if (svd.header.type == ISO_VDT_SUPPLEMENTARY &&
+		    (!memcmp(svd.reserved3, ISO_JOLIET_ESCAPE_LEVEL1, 3) ||
+		     !memcmp(svd.reserved3, ISO_JOLIET_ESCAPE_LEVEL2, 3) ||
+		     !memcmp(svd.reserved3, ISO_JOLIET_ESCAPE_LEVEL3, 3)))
+		{
+			// Found the Joliet SVD.
+			memcpy(&jolietRootDir, &svd.dir_entry_root, sizeof(jolietRootDir));
+			break;
+		}
+	}
+
 	// Load the root directory.
 	loadRootDirectory();
 }
@@ -109,14 +192,51 @@ IsoPartitionPrivate::IsoPartitionPrivate(IsoPartition *q,
 IsoPartitionPrivate::~IsoPartitionPrivate()
 { }
 
+/**
+ * Normalize a filename for the directory index.
+ * - ASCII letters are converted to lowercase.
+ * - File version suffixes (";1") are removed.
+ * - Trailing dots are removed. ("FILE." -> "file")
+ * @param name Filename. (UTF-8)
+ * @param len Length of filename.
+ * @return Normalized filename.
+ */
+string IsoPartitionPrivate::normalizeName(const char *name, size_t len)
+{
+	// Remove the file version suffix.
+	const char *const semicolon = static_cast<const char*>(memchr(name, ';', len));
+	if (semicolon) {
+		len = semicolon - name;
+	}
+
+	// Remove trailing dots.
+	while (len > 0 && name[len-1] == '.') {
+		len--;
+	}
+
+	// Convert ASCII letters to lowercase.
+	// NOTE: Using generic ASCII handling instead of
+	// locale-specific case folding.
+	string s_name(name, len);
+	for (char &chr : s_name) {
+		if (chr >= 'A' && chr <= 'Z') {
+			chr |= 0x20;
+		}
+	}
+	return s_name;
+}
+
 /**
  * Load the root directory.
+ * This adds the root directory entries to the directory index
+ * and loads the root directory of the primary directory tree.
  * @return 0 on success; negative POSIX error code on error.
  */
 int IsoPartitionPrivate::loadRootDirectory(void)
 {
 	RP_Q(IsoPartition);
-	if (unlikely(!rootDir_data.empty())) {
+	auto iter = dirIndex[TREE_PRIMARY].find(string());
+	if (unlikely(iter != dirIndex[TREE_PRIMARY].end() && iter->second.loaded)) {
 		// Root directory is already loaded.
 		return 0;
 	} else if (unlikely(!q->m_discReader)) {
@@ -129,18 +249,8 @@ int IsoPartitionPrivate::loadRootDirectory(void)
 		return -q->m_lastError;
 	}
 
-	// Block size.
-	// Should be 2048, but other values are possible.
-	const unsigned int block_size = pvd.logical_block_size.he;
-
 	// Check the root directory entry.
 	const ISO_DirEntry *const rootdir = &pvd.dir_entry_root;
-	if (rootdir->size.he > 16*1024*1024) {
-		// Root directory is too big.
-		q->m_lastError = EIO;
-		return -q->m_lastError;
-	}
-
 	if (iso_start_offset >= 0) {
 		// ISO start address was already determined.
 		if (rootdir->block.he < ((unsigned int)iso_start_offset + 2)) {
@@ -162,16 +272,66 @@ int IsoPartitionPrivate::loadRootDirectory(void)
 		iso_start_offset = static_cast<int>(rootdir->block.he - 20);
 	}
 
-	// Load the root directory.
+	// Add the root directory entries.
+	IndexEntry root;
+	root.block = rootdir->block.he;
+	root.size = rootdir->size.he;
+	root.flags = ISO_FLAG_DIRECTORY;
+	root.loaded = false;
+	IndexEntry &primaryRoot = dirIndex[TREE_PRIMARY][string()];
+	primaryRoot = root;
+
+	if (jolietRootDir.entry_length != 0) {
+		root.block = jolietRootDir.block.he;
+		root.size = jolietRootDir.size.he;
+		dirIndex[TREE_JOLIET][string()] = root;
+	}
+
+	// Load the primary root directory.
+	return loadDirectory(TREE_PRIMARY, string(), primaryRoot);
+}
+
+/**
+ * Load a directory and add its entries to the directory index.
+ * @param tree Directory tree.
+ * @param path Normalized directory path. ("" for the root directory)
+ * @param entry Directory's index entry.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int IsoPartitionPrivate::loadDirectory(DirTree tree, const string &path, IndexEntry &entry)
+{
+	RP_Q(IsoPartition);
+	if (entry.loaded) {
+		// Directory is already loaded.
+		return 0;
+	} else if (unlikely(!q->m_discReader)) {
+		// DiscReader isn't open.
+		q->m_lastError = EIO;
+		return -q->m_lastError;
+	}
+
+	// Block size.
+	// Should be 2048, but other values are possible.
+	const unsigned int block_size = pvd.logical_block_size.he;
+
+	// Directories should be less than 16 MB.
+	if (block_size == 0 || entry.size > 16*1024*1024 ||
+	    iso_start_offset < 0 || entry.block < (unsigned int)iso_start_offset)
+	{
+		// Directory is invalid.
+		q->m_lastError = EIO;
+		return -q->m_lastError;
+	}
+
+	// Load the directory.
 	// NOTE: Due to variable-length entries, we need to load
-	// the entire root directory all at once.
-	rootDir_data.resize(rootdir->size.he);
-	const off64_t rootDir_addr = partition_offset +
-		static_cast<off64_t>(rootdir->block.he - iso_start_offset) * block_size;
-	size_t size = q->m_discReader->seekAndRead(rootDir_addr, rootDir_data.data(), rootDir_data.size());
-	if (size != rootDir_data.size()) {
+	// the entire directory all at once.
+	ao::uvector<uint8_t> dir_data(entry.size);
+	const off64_t dir_addr = partition_offset +
+		static_cast<off64_t>(entry.block - iso_start_offset) * block_size;
+	size_t size = q->m_discReader->seekAndRead(dir_addr, dir_data.data(), dir_data.size());
+	if (size != dir_data.size()) {
 		// Seek and/or read error.
-		rootDir_data.clear();
 		q->m_lastError = q->m_discReader->lastError();
 		if (q->m_lastError == 0) {
 			q->m_lastError = EIO;
@@ -179,10 +339,157 @@ int IsoPartitionPrivate::loadRootDirectory(void)
 		return -q->m_lastError;
 	}
 
-	// Root directory loaded.
+	// Add the directory entries to the index.
+	unordered_map<string, IndexEntry> &index = dirIndex[tree];
+	const uint8_t *p = dir_data.data();
+	const uint8_t *const p_end = p + dir_data.size();
+	while (p < p_end) {
+		const ISO_DirEntry *dirEntry = reinterpret_cast<const ISO_DirEntry*>(p);
+		if (dirEntry->entry_length == 0) {
+			// Directory entries can't cross block boundaries.
+			// The rest of this block is padding.
+			const size_t next_block = ((p - dir_data.data()) / block_size) + 1;
+			p = dir_data.data() + (next_block * block_size);
+			continue;
+		} else if (dirEntry->entry_length < sizeof(*dirEntry) ||
+			   p + dirEntry->entry_length > p_end ||
+			   sizeof(*dirEntry) + dirEntry->filename_length > dirEntry->entry_length)
+		{
+			// Directory entry and/or filename is out of bounds.
+			break;
+		}
+
+		const char *const entry_filename = reinterpret_cast<const char*>(p) + sizeof(*dirEntry);
+		if (dirEntry->filename_length == 1 && static_cast<uint8_t>(entry_filename[0]) <= 1) {
+			// "." or "..". Skip it.
+			p += dirEntry->entry_length;
+			continue;
+		}
+
+		// Convert the filename to UTF-8.
+		string s_name;
+		if (tree == TREE_JOLIET) {
+			// Joliet: UCS-2 (big-endian)
+			// NOTE: Copying to a temporary buffer for alignment.
+			char16_t u16_name[128];
+			const unsigned int u16_len = dirEntry->filename_length / 2;
+			memcpy(u16_name, entry_filename, u16_len * sizeof(char16_t));
+			s_name = utf16be_to_utf8(u16_name, u16_len);
+		} else {
+			// ISO-9660: Assuming cp1252.
+			s_name = cp1252_to_utf8(entry_filename, dirEntry->filename_length);
+		}
+		s_name = normalizeName(s_name.data(), s_name.size());
+
+		if (!s_name.empty()) {
+			IndexEntry newEntry;
+			newEntry.block = dirEntry->block.he;
+			newEntry.size = dirEntry->size.he;
+			newEntry.flags = dirEntry->flags;
+			newEntry.loaded = false;
+
+			// NOTE: If a filename is present more than once, e.g. for
+			// multi-extent files or multiple file versions, only the
+			// first entry is used.
+			index.emplace(path.empty() ? s_name : path + '/' + s_name, newEntry);
+		}
+
+		// Next entry.
+		p += dirEntry->entry_length;
+	}
+
+	// Directory loaded.
+	entry.loaded = true;
 	return 0;
 }
 
+/**
+ * Look up a file or directory.
+ * Directories are loaded as needed.
+ * The primary directory tree is checked first, then Joliet.
+ * @param filename Full path. (UTF-8)
+ * @return IndexEntry, or nullptr if not found.
+ */
+const IsoPartitionPrivate::IndexEntry *IsoPartitionPrivate::lookup(const char *filename)
+{
+	RP_Q(IsoPartition);
+
+	// Normalize the path.
+	vector<string> components;
+	string path;
+	for (const char *p = filename; *p != '\0'; ) {
+		const char *const slash = strchr(p, '/');
+		const size_t len = (slash ? static_cast<size_t>(slash - p) : strlen(p));
+		string s_name = normalizeName(p, len);
+		if (!s_name.empty()) {
+			if (!path.empty()) {
+				path += '/';
+			}
+			path += s_name;
+			components.push_back(std::move(s_name));
+		}
+		if (!slash)
+			break;
+		p = slash + 1;
+	}
+
+	int err = ENOENT;
+	for (size_t tree = 0; tree < dirIndex.size(); tree++) {
+		unordered_map<string, IndexEntry> &index = dirIndex[tree];
+
+		// If the parent directory has already been loaded,
+		// the entry can be found directly.
+		auto iter = index.find(path);
+		if (iter != index.end()) {
+			return &(iter->second);
+		}
+
+		// Load each directory in the path.
+		iter = index.find(string());
+		if (iter == index.end()) {
+			// Directory tree isn't available.
+			continue;
+		}
+		IndexEntry *entry = &(iter->second);
+		string dir_path;
+		for (const string &component : components) {
+			if (!(entry->flags & ISO_FLAG_DIRECTORY)) {
+				// Not a directory.
+				err = ENOTDIR;
+				entry = nullptr;
+				break;
+			}
+			if (loadDirectory(static_cast<DirTree>(tree), dir_path, *entry) != 0) {
+				// Error loading the directory.
+				err = EIO;
+				entry = nullptr;
+				break;
+			}
+
+			if (!dir_path.empty()) {
+				dir_path += '/';
+			}
+			dir_path += component;
+			iter = index.find(dir_path);
+			if (iter == index.end()) {
+				// Not found.
+				entry = nullptr;
+				break;
+			}
+			entry = &(iter->second);
+		}
+
+		if (entry) {
+			// Found the entry.
+			return entry;
+		}
+	}
+
+	// Not found.
+	q->m_lastError = err;
+	return nullptr;
+}
+
 /** IsoPartition **/
 
 /**
@@ -379,7 +686,13 @@ int IsoPartition::closedir(IFst::Dir *dirp)
 
 /**
  * Open a file. (read-only)
- * @param filename Filename.
+ *
+ * Filenames are case-insensitive, and the ";1" version suffix
+ * is optional. Subdirectories are supported. If the disc has
+ * Joliet filenames, they're checked if the ISO-9660 filename
+ * isn't found.
+ *
+ * @param filename Filename, including the full path.
  * @return IRpFile*, or nullptr on error.
  */
 IRpFile *IsoPartition::open(const char *filename)
@@ -395,8 +708,6 @@ IRpFile *IsoPartition::open(const char *filename)
 	// TODO: File reference counter.
 	// This might be difficult to do because PartitionFile is a separate class.
 
-	// TODO: Support subdirectories.
-
 	if (!filename || filename[0] == 0) {
 		// No filename.
 		m_lastError = EINVAL;
@@ -404,19 +715,13 @@ IRpFile *IsoPartition::open(const char *filename)
 	}
 
 	// Remove leading slashes.
+	// NOTE: If there's nothing but slashes, lookup() will
+	// find the root directory, which can't be opened.
 	while (*filename == '/') {
 		filename++;
 	}
-	if (filename[0] == 0) {
-		// Nothing but slashes...
-		return nullptr;
-	}
 
-	// TODO: Which encoding?
-	// Assuming cp1252...
-	string s_filename = utf8_to_cp1252(filename, -1);
-
-	if (d->rootDir_data.empty()) {
+	if (d->dirIndex[IsoPartitionPrivate::TREE_PRIMARY].empty()) {
 		// Root directory isn't loaded.
 		if (d->loadRootDirectory() != 0) {
 			// Root directory load failed.
@@ -425,57 +730,13 @@ IRpFile *IsoPartition::open(const char *filename)
 		}
 	}
 
-	// Find the file in the root directory.
+	// Find the file.
 	// NOTE: Filenames are case-insensitive.
 	// NOTE: File might have a ";1" suffix.
-	const unsigned int filename_len = static_cast<unsigned int>(s_filename.size());
-	const ISO_DirEntry *dirEntry_found = nullptr;
-	const uint8_t *p = d->rootDir_data.data();
-	const uint8_t *const p_end = p + d->rootDir_data.size();
-	while (p < p_end) {
-		const ISO_DirEntry *dirEntry = reinterpret_cast<const ISO_DirEntry*>(p);
-		if (dirEntry->entry_length < sizeof(*dirEntry)) {
-			// End of directory.
-			break;
-		}
-
-		const char *entry_filename = reinterpret_cast<const char*>(p) + sizeof(*dirEntry);
-		if (entry_filename + dirEntry->filename_length > reinterpret_cast<const char*>(p_end)) {
-			// Filename is out of bounds.
-			break;
-		}
-
-		// Check the filename.
-		// 1990s and early 2000s CD-ROM games usually have
-		// ";1" filenames, so check for that first.
-		if (dirEntry->filename_length == filename_len + 2) {
-			// +2 length match.
-			// This might have ";1".
-			if (!strncasecmp(entry_filename, s_filename.c_str(), filename_len)) {
-				// Check for ";1".
-				if (entry_filename[filename_len]   == ';' &&
-				    entry_filename[filename_len+1] == '1')
-				{
-					// Found it!
-					dirEntry_found = dirEntry;
-					break;
-				}
-			}
-		} else if (dirEntry->filename_length == filename_len) {
-			// Exact length match.
-			if (!strncasecmp(entry_filename, s_filename.c_str(), filename_len)) {
-				// Found it!
-				dirEntry_found = dirEntry;
-				break;
-			}
-		}
-
-		// Next entry.
-		p += dirEntry->entry_length;
-	}
-
+	const IsoPartitionPrivate::IndexEntry *const dirEntry_found = d->lookup(filename);
 	if (!dirEntry_found) {
 		// Not found.
+		// lookup() has already set m_lastError.
 		return nullptr;
 	}
 
@@ -492,9 +753,9 @@ IRpFile *IsoPartition::open(const char *filename)
 	const unsigned int block_size = d->pvd.logical_block_size.he;
 
 	// Make sure the file is in bounds.
-	const off64_t file_addr = (static_cast<off64_t>(dirEntry_found->block.he) - d->iso_start_offset) * block_size;
+	const off64_t file_addr = (static_cast<off64_t>(dirEntry_found->block) - d->iso_start_offset) * block_size;
 	if (file_addr >= d->partition_size + d->partition_offset ||
-	    file_addr > d->partition_size + d->partition_offset - dirEntry_found->size.he)
+	    file_addr > d->partition_size + d->partition_offset - dirEntry_found->size)
 	{
 		// File is out of bounds.
 		m_lastError = EIO;
@@ -505,7 +766,7 @@ IRpFile *IsoPartition::open(const char *filename)
 	// This is an IRpFile implementation that uses an
 	// IPartition as the reader and takes an offset
 	// and size as the file parameters.
-	return new PartitionFile(this, file_addr, dirEntry_found->size.he);
+	return new PartitionFile(this, file_addr, dirEntry_found->size);
 }
 
 }
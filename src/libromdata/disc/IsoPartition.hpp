@@ -129,7 +129,13 @@ class IsoPartition : public LibRpBase::IPartition
 
 		/**
 		 * Open a file. (read-only)
-		 * @param filename Filename.
+		 *
+		 * Filenames are case-insensitive, and the ";1" version suffix
+		 * is optional. Subdirectories are supported. If the disc has
+		 * Joliet filenames, they're checked if the ISO-9660 filename
+		 * isn't found.
+		 *
+		 * @param filename Filename, including the full path.
 		 * @return IRpFile*, or nullptr on error.
 		 */
 		LibRpFile::IRpFile *open(const char *filename);
@@ -187,12 +187,24 @@ int PEResourceReaderPrivate::loadResDir(uint32_t addr, rsrc_dir_t &dir)
 {
 	RP_Q(PEResourceReader);
 
+	// If the file's data is directly accessible (e.g. memory-mapped),
+	// the directory is parsed in place. Otherwise, it's read into
+	// a temporary buffer.
+	// NOTE: The directory address comes from the file, so the data
+	// might not be aligned. The header is always copied, and the
+	// entries are only used in place if they're 32-bit aligned.
+	const off64_t dir_pos = static_cast<off64_t>(rsrc_addr) + addr;
 	IMAGE_RESOURCE_DIRECTORY root;
-	size_t size = q->m_file->seekAndRead(rsrc_addr + addr, &root, sizeof(root));
-	if (size != sizeof(root)) {
-		// Seek and/or read error.
-		q->m_lastError = q->m_file->lastError();
-		return q->m_lastError;
+	const uint8_t *const pRoot = q->m_file->dataPtr(dir_pos, sizeof(root));
+	if (pRoot) {
+		memcpy(&root, pRoot, sizeof(root));
+	} else {
+		size_t size = q->m_file->seekAndRead(dir_pos, &root, sizeof(root));
+		if (size != sizeof(root)) {
+			// Seek and/or read error.
+			q->m_lastError = q->m_file->lastError();
+			return q->m_lastError;
+		}
 	}
 
 	// Total number of entries.
@@ -202,18 +214,32 @@ int PEResourceReaderPrivate::loadResDir(uint32_t addr, rsrc_dir_t &dir)
 		// Sanity check; constrain to 64 entries.
 		entryCount = 64;
 	}
-	uint32_t szToRead = static_cast<uint32_t>(entryCount * sizeof(IMAGE_RESOURCE_DIRECTORY_ENTRY));
-	unique_ptr<IMAGE_RESOURCE_DIRECTORY_ENTRY[]> irdEntries(new IMAGE_RESOURCE_DIRECTORY_ENTRY[entryCount]);
-	size = q->m_file->read(irdEntries.get(), szToRead);
-	if (size != szToRead) {
-		// Read error.
-		q->m_lastError = q->m_file->lastError();
-		return q->m_lastError;
+	const uint32_t szToRead = static_cast<uint32_t>(entryCount * sizeof(IMAGE_RESOURCE_DIRECTORY_ENTRY));
+	const off64_t entries_pos = dir_pos + sizeof(IMAGE_RESOURCE_DIRECTORY);
+	unique_ptr<IMAGE_RESOURCE_DIRECTORY_ENTRY[]> irdEntries;
+	const IMAGE_RESOURCE_DIRECTORY_ENTRY *irdEntry;
+	const uint8_t *const pEntries = q->m_file->dataPtr(entries_pos, szToRead);
+	if (pEntries && (reinterpret_cast<uintptr_t>(pEntries) & 3) == 0) {
+		// Entries are aligned. Parse them in place.
+		irdEntry = reinterpret_cast<const IMAGE_RESOURCE_DIRECTORY_ENTRY*>(pEntries);
+	} else {
+		irdEntries.reset(new IMAGE_RESOURCE_DIRECTORY_ENTRY[entryCount]);
+		if (pEntries) {
+			// Misaligned data. Copy it.
+			memcpy(irdEntries.get(), pEntries, szToRead);
+		} else {
+			size_t size = q->m_file->seekAndRead(entries_pos, irdEntries.get(), szToRead);
+			if (size != szToRead) {
+				// Read error.
+				q->m_lastError = q->m_file->lastError();
+				return q->m_lastError;
+			}
+		}
+		irdEntry = irdEntries.get();
 	}
 
 	// Read each directory header.
 	dir.resize(entryCount);
-	const IMAGE_RESOURCE_DIRECTORY_ENTRY *irdEntry = irdEntries.get();
 	unsigned int entriesRead = 0;
 	for (unsigned int i = 0; i < entryCount; i++, irdEntry++) {
 		// Skipping any root directory entry that isn't an ID.
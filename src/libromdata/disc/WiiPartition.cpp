@@ -13,6 +13,7 @@
 #include "Console/wii_structs.h"
 
 // librpbase, librpfile
+#include "librpbase/aligned_malloc.h"
 #include "librpbase/crypto/KeyManager.hpp"
 #ifdef ENABLE_DECRYPTION
 # include "librpbase/crypto/IAesCipher.hpp"
@@ -31,6 +32,10 @@ namespace LibRomData {
 #define SECTOR_SIZE_DECRYPTED 0x7C00
 #define SECTOR_SIZE_DECRYPTED_OFFSET 0x400
 
+// Maximum number of sectors to read ahead when
+// sequential access is detected.
+#define SECTOR_READAHEAD_COUNT 4
+
 class WiiPartitionPrivate : public GcnPartitionPrivate
 {
 	public:
@@ -69,20 +74,47 @@ class WiiPartitionPrivate : public GcnPartitionPrivate
 		// NOTE: Actual read position if ((cryptoMethod & CM_MASK_SECTOR) == CM_32K).
 		off64_t pos_7C00;
 
-		// Decrypted sector cache.
-		// NOTE: Actual data starts at 0x400.
+		// Decrypted sector cache. (LRU)
+		// NOTE: Actual data starts at 0x400 in each sector.
 		// Hashes and the sector IV are stored first.
-		uint32_t sector_num;				// Sector number.
-		uint8_t sector_buf[SECTOR_SIZE_ENCRYPTED];	// Decrypted sector data.
+		struct SectorCacheEntry {
+			uint32_t sector_num;	// Sector number. (~0 if unused)
+			uint32_t lru;		// LRU stamp. (higher is more recent)
+		};
+		SectorCacheEntry *sector_cache;		// Cache entries.
+		uint8_t *sector_cache_buf;		// Decrypted sector data. (sector_cache_count * 32 KiB)
+		unsigned int sector_cache_count;	// Number of cache entries.
+		uint32_t sector_cache_lru;		// Most recent LRU stamp.
+
+		// Read-ahead buffer for batched sector reads.
+		// Allocated on demand; holds up to sector_cache_count/2 sectors.
+		uint8_t *readahead_buf;
+		// Last sector read from the underlying disc reader.
+		// Used to detect sequential access.
+		uint32_t last_sector_read;
+
+		/**
+		 * Free the sector cache.
+		 * It will be reallocated by readSector() if needed.
+		 */
+		void freeSectorCache(void);
 
 		/**
 		 * Read and decrypt a sector.
-		 * The decrypted sector is stored in sector_buf.
+		 *
+		 * If the sector isn't cached, up to (count - 1) following
+		 * sectors are read in the same batch and cached, so
+		 * sequential reads only hit the underlying disc reader
+		 * once per batch.
+		 *
+		 * NOTE: The returned pointer is only valid until
+		 * the next call to readSector().
 		 *
 		 * @param sector_num Sector number. (address / 0x7C00)
-		 * @return 0 on success; negative POSIX error code on error.
+		 * @param count Number of sectors the caller expects to read, starting at sector_num.
+		 * @return Decrypted sector data, or nullptr on error.
 		 */
-		int readSector(uint32_t sector_num);
+		const uint8_t *readSector(uint32_t sector_num, unsigned int count = 1);
 
 #ifdef ENABLE_DECRYPTION
 	public:
@@ -164,7 +196,12 @@ WiiPartitionPrivate::WiiPartitionPrivate(WiiPartition *q,
 	, encKeyReal(WiiPartition::ENCKEY_UNKNOWN)
 	, cryptoMethod(cryptoMethod)
 	, pos_7C00(-1)
-	, sector_num(~0)
+	, sector_cache(nullptr)
+	, sector_cache_buf(nullptr)
+	, sector_cache_count(WiiPartition::DEFAULT_SECTOR_CACHE_COUNT)
+	, sector_cache_lru(0)
+	, readahead_buf(nullptr)
+	, last_sector_read(~0)
 	, aes_title(nullptr)
 #else /* !ENABLE_DECRYPTION */
 	, verifyResult(KeyManager::VERIFY_NO_SUPPORT)
@@ -172,7 +209,12 @@ WiiPartitionPrivate::WiiPartitionPrivate(WiiPartition *q,
 	, encKeyReal(WiiPartition::ENCKEY_UNKNOWN)
 	, cryptoMethod(cryptoMethod)
 	, pos_7C00(-1)
-	, sector_num(~0)
+	, sector_cache(nullptr)
+	, sector_cache_buf(nullptr)
+	, sector_cache_count(WiiPartition::DEFAULT_SECTOR_CACHE_COUNT)
+	, sector_cache_lru(0)
+	, readahead_buf(nullptr)
+	, last_sector_read(~0)
 #endif /* ENABLE_DECRYPTION */
 {
 	// NOTE: The discReader parameter is needed because
@@ -351,7 +393,8 @@ KeyManager::VerifyResult WiiPartitionPrivate::initDecryption(void)
 
 	// Read sector 0, which contains a disc header.
 	// NOTE: readSector() doesn't check verifyResult.
-	if (readSector(0) != 0) {
+	const uint8_t *const sector_buf = readSector(0);
+	if (!sector_buf) {
 		// Error reading sector 0.
 		delete aes_title;
 		aes_title = nullptr;
@@ -377,35 +420,130 @@ KeyManager::VerifyResult WiiPartitionPrivate::initDecryption(void)
 
 WiiPartitionPrivate::~WiiPartitionPrivate()
 {
+	freeSectorCache();
 #ifdef ENABLE_DECRYPTION
 	delete aes_title;
 #endif /* ENABLE_DECRYPTION */
 }
 
+/**
+ * Free the sector cache.
+ * It will be reallocated by readSector() if needed.
+ */
+void WiiPartitionPrivate::freeSectorCache(void)
+{
+	delete[] sector_cache;
+	sector_cache = nullptr;
+	aligned_free(sector_cache_buf);
+	sector_cache_buf = nullptr;
+	aligned_free(readahead_buf);
+	readahead_buf = nullptr;
+	sector_cache_lru = 0;
+	last_sector_read = ~0;
+}
+
 /**
  * Read and decrypt a sector.
- * The decrypted sector is stored in sector_buf.
+ *
+ * If the sector isn't cached, up to (count - 1) following
+ * sectors are read in the same batch and cached, so
+ * sequential reads only hit the underlying disc reader
+ * once per batch.
+ *
+ * NOTE: The returned pointer is only valid until
+ * the next call to readSector().
  *
  * @param sector_num Sector number. (address / 0x7C00)
- * @return 0 on success; negative POSIX error code on error.
+ * @param count Number of sectors the caller expects to read, starting at sector_num.
+ * @return Decrypted sector data, or nullptr on error.
  */
-int WiiPartitionPrivate::readSector(uint32_t sector_num)
+const uint8_t *WiiPartitionPrivate::readSector(uint32_t sector_num, unsigned int count)
 {
-	if (this->sector_num == sector_num) {
-		// Sector is already in memory.
-		return 0;
+	RP_Q(WiiPartition);
+	if (!sector_cache) {
+		// Allocate the sector cache.
+		assert(sector_cache_count > 0);
+		sector_cache_buf = static_cast<uint8_t*>(aligned_malloc(16,
+			static_cast<size_t>(sector_cache_count) * SECTOR_SIZE_ENCRYPTED));
+		if (!sector_cache_buf && sector_cache_count > 1) {
+			// Couldn't allocate the full cache.
+			// Fall back to caching a single sector.
+			sector_cache_count = 1;
+			sector_cache_buf = static_cast<uint8_t*>(aligned_malloc(16, SECTOR_SIZE_ENCRYPTED));
+		}
+		if (!sector_cache_buf) {
+			q->m_lastError = ENOMEM;
+			return nullptr;
+		}
+
+		sector_cache = new SectorCacheEntry[sector_cache_count];
+		for (unsigned int i = 0; i < sector_cache_count; i++) {
+			sector_cache[i].sector_num = ~0;
+			sector_cache[i].lru = 0;
+		}
+	}
+
+	// Check if the sector is already cached.
+	for (unsigned int i = 0; i < sector_cache_count; i++) {
+		if (sector_cache[i].sector_num == sector_num) {
+			// Sector is already in memory.
+			sector_cache[i].lru = ++sector_cache_lru;
+			return &sector_cache_buf[i * SECTOR_SIZE_ENCRYPTED];
+		}
 	}
 
-	RP_Q(WiiPartition);
 	const bool isCrypted = ((cryptoMethod & WiiPartition::CM_MASK_ENCRYPTED) == WiiPartition::CM_ENCRYPTED);
 #ifndef ENABLE_DECRYPTION
 	if (isCrypted) {
 		// Decryption is disabled.
 		q->m_lastError = EIO;
-		return -1;
+		return nullptr;
 	}
 #endif /* !ENABLE_DECRYPTION */
 
+	// If the previous read ended right before this sector,
+	// this is probably a sequential read. Read ahead.
+	// NOTE: last_sector_read is ~0 if nothing was read yet,
+	// which would otherwise match sector 0.
+	if (last_sector_read != ~0U && sector_num == last_sector_read + 1 &&
+	    count < SECTOR_READAHEAD_COUNT)
+	{
+		count = SECTOR_READAHEAD_COUNT;
+	}
+
+	// Don't let a single batch evict more than half of the cache.
+	const unsigned int max_batch = (sector_cache_count > 1 ? sector_cache_count / 2 : 1);
+	if (count > max_batch) {
+		count = max_batch;
+	} else if (count == 0) {
+		count = 1;
+	}
+
+	// Don't read past the end of the partition.
+	// NOTE: data_size is the physical size, and each physical sector
+	// is 0x8000 bytes regardless of the sector layout.
+	const off64_t sector_total = (data_size + SECTOR_SIZE_ENCRYPTED - 1) / SECTOR_SIZE_ENCRYPTED;
+	if (static_cast<off64_t>(sector_num) + count > sector_total) {
+		count = (static_cast<off64_t>(sector_num) < sector_total
+			? static_cast<unsigned int>(sector_total - sector_num)
+			: 1);
+	}
+
+	// Stop the batch at the first sector that's already cached.
+	for (unsigned int j = 1; j < count; j++) {
+		bool isCached = false;
+		for (unsigned int i = 0; i < sector_cache_count; i++) {
+			if (sector_cache[i].sector_num == sector_num + j) {
+				isCached = true;
+				break;
+			}
+		}
+		if (isCached) {
+			count = j;
+			break;
+		}
+	}
+
 	// NOTE: This function doesn't check verifyResult,
 	// since it's called by initDecryption() before
 	// verifyResult is set.
@@ -415,34 +553,93 @@ int WiiPartitionPrivate::readSector(uint32_t sector_num)
 	int ret = q->m_discReader->seek(sector_addr);
 	if (ret != 0) {
 		q->m_lastError = q->m_discReader->lastError();
-		return ret;
+		return nullptr;
+	}
+
+	// Find the least-recently used cache entry.
+	// Entries filled by this batch have the highest LRU stamps,
+	// and a batch is at most half of the cache, so they won't
+	// be selected again.
+	auto findLRU = [this]() -> unsigned int {
+		unsigned int idx = 0;
+		for (unsigned int i = 1; i < sector_cache_count; i++) {
+			if (sector_cache[i].lru < sector_cache[idx].lru) {
+				idx = i;
+			}
+		}
+		return idx;
+	};
+
+	if (count > 1 && !readahead_buf) {
+		readahead_buf = static_cast<uint8_t*>(aligned_malloc(16,
+			static_cast<size_t>(max_batch) * SECTOR_SIZE_ENCRYPTED));
+		if (!readahead_buf) {
+			// Couldn't allocate the read-ahead buffer.
+			// Read a single sector instead.
+			count = 1;
+		}
+	}
+
+	const unsigned int first_idx = findLRU();
+	uint8_t *const first_buf = &sector_cache_buf[first_idx * SECTOR_SIZE_ENCRYPTED];
+	uint8_t *src_buf;
+	size_t sz;
+	if (count == 1) {
+		// Single sector. Read it directly into the cache.
+		src_buf = first_buf;
+		sz = q->m_discReader->read(src_buf, SECTOR_SIZE_ENCRYPTED);
+	} else {
+		// Multiple sectors. Read them all at once.
+		src_buf = readahead_buf;
+		sz = q->m_discReader->read(src_buf, static_cast<size_t>(count) * SECTOR_SIZE_ENCRYPTED);
 	}
 
-	size_t sz = q->m_discReader->read(sector_buf, sizeof(sector_buf));
-	if (sz != SECTOR_SIZE_ENCRYPTED) {
-		// sector_buf may be invalid.
-		this->sector_num = ~0;
+	// Only full sectors can be used.
+	const unsigned int sectors_read = static_cast<unsigned int>(sz / SECTOR_SIZE_ENCRYPTED);
+	if (sectors_read == 0) {
+		// The cache entry may be invalid.
+		sector_cache[first_idx].sector_num = ~0;
+		sector_cache[first_idx].lru = 0;
+		last_sector_read = ~0;
 		q->m_lastError = EIO;
-		return -1;
+		return nullptr;
 	}
 
+	// Decrypt each sector into the cache.
+	for (unsigned int j = 0; j < sectors_read; j++) {
+		const unsigned int idx = (j == 0 ? first_idx : findLRU());
+		uint8_t *const sector_buf = &sector_cache_buf[idx * SECTOR_SIZE_ENCRYPTED];
+		if (sector_buf != src_buf) {
+			memcpy(sector_buf, &src_buf[j * SECTOR_SIZE_ENCRYPTED], SECTOR_SIZE_ENCRYPTED);
+		}
+
 #ifdef ENABLE_DECRYPTION
-	if (isCrypted) {
-		// Decrypt the sector.
-		if (aes_title->decrypt(&sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET], SECTOR_SIZE_DECRYPTED,
-		    &sector_buf[0x3D0], 16) != SECTOR_SIZE_DECRYPTED)
-		{
-			// sector_buf may be invalid.
-			this->sector_num = ~0;
-			q->m_lastError = EIO;
-			return -1;
+		if (isCrypted) {
+			// Decrypt the sector.
+			if (aes_title->decrypt(&sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET], SECTOR_SIZE_DECRYPTED,
+			    &sector_buf[0x3D0], 16) != SECTOR_SIZE_DECRYPTED)
+			{
+				// The cache entry may be invalid.
+				sector_cache[idx].sector_num = ~0;
+				sector_cache[idx].lru = 0;
+				last_sector_read = ~0;
+				if (j == 0) {
+					// Requested sector couldn't be decrypted.
+					q->m_lastError = EIO;
+					return nullptr;
+				}
+				break;
+			}
 		}
-	}
 #endif /* ENABLE_DECRYPTION */
 
-	// Sector read and decrypted.
-	this->sector_num = sector_num;
-	return 0;
+		// Sector read and decrypted.
+		sector_cache[idx].sector_num = sector_num + j;
+		sector_cache[idx].lru = ++sector_cache_lru;
+		last_sector_read = sector_num + j;
+	}
+
+	return first_buf;
 }
 
 /** WiiPartition **/
@@ -501,9 +698,7 @@ WiiPartition::WiiPartition(IDiscReader *discReader, off64_t partition_offset,
 	}
 
 	d->partition_size = d->data_size + d->data_offset;
-#ifdef ENABLE_DECRYPTION
 	d->pos_7C00 = 0;
-#endif /* ENABLE_DECRYPTION */
 
 	// Encryption will not be initialized until
 	// read() is called.
@@ -530,7 +725,6 @@ size_t WiiPartition::read(void *ptr, size_t size)
 		return 0;
 	}
 
-	// TODO: Consolidate this code and optimize it.
 	size_t ret = 0;
 	uint8_t *ptr8 = static_cast<uint8_t*>(ptr);
 
@@ -544,64 +738,16 @@ size_t WiiPartition::read(void *ptr, size_t size)
 		size = static_cast<size_t>(d->data_size - d->pos_7C00);
 	}
 
+	uint32_t sector_data_size, sector_data_offset;
 	if ((d->cryptoMethod & CM_MASK_SECTOR) == CM_32K) {
 		// Full 32K sectors. (implies no encryption)
-
-		// Check if we're not starting on a block boundary.
-		const uint32_t blockStartOffset = d->pos_7C00 % SECTOR_SIZE_ENCRYPTED;
-		if (blockStartOffset != 0) {
-			// Not a block boundary.
-			// Read the end of the block.
-			uint32_t read_sz = SECTOR_SIZE_ENCRYPTED - blockStartOffset;
-			if (size < static_cast<size_t>(read_sz)) {
-				read_sz = static_cast<uint32_t>(size);
-			}
-
-			// Read and decrypt the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_ENCRYPTED);
-			d->readSector(blockStart);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[blockStartOffset], read_sz);
-
-			// Starting block read.
-			size -= read_sz;
-			ptr8 += read_sz;
-			ret += read_sz;
-			d->pos_7C00 += read_sz;
-		}
-
-		// Read entire blocks.
-		for (; size >= SECTOR_SIZE_ENCRYPTED;
-		     size -= SECTOR_SIZE_ENCRYPTED, ptr8 += SECTOR_SIZE_ENCRYPTED,
-		     ret += SECTOR_SIZE_ENCRYPTED, d->pos_7C00 += SECTOR_SIZE_ENCRYPTED)
-		{
-			assert(d->pos_7C00 % SECTOR_SIZE_ENCRYPTED == 0);
-
-			// Read the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_ENCRYPTED);
-			d->readSector(blockStart);
-
-			// Copy data from the sector.
-			memcpy(ptr8, d->sector_buf, SECTOR_SIZE_ENCRYPTED);
-		}
-
-		// Check if we still have data left. (not a full block)
-		if (size > 0) {
-			// Not a full block.
-
-			// Read the sector.
-			assert(d->pos_7C00 % SECTOR_SIZE_ENCRYPTED == 0);
-			const uint32_t blockEnd = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_ENCRYPTED);
-			d->readSector(blockEnd);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[blockStartOffset], size);
-
-			ret += size;
-			d->pos_7C00 += size;
-		}
+		sector_data_size = SECTOR_SIZE_ENCRYPTED;
+		sector_data_offset = 0;
 	} else {
+		// 1K hashes, 31K data.
+		sector_data_size = SECTOR_SIZE_DECRYPTED;
+		sector_data_offset = SECTOR_SIZE_DECRYPTED_OFFSET;
+
 		if ((d->cryptoMethod & CM_MASK_ENCRYPTED) == CM_ENCRYPTED) {
 #ifdef ENABLE_DECRYPTION
 			// Make sure decryption is initialized.
@@ -629,64 +775,37 @@ size_t WiiPartition::read(void *ptr, size_t size)
 #else /* !ENABLE_DECRYPTION */
 			// Decryption is not enabled.
 			m_lastError = EIO;
-			ret = 0;
+			return 0;
 #endif /* ENABLE_DECRYPTION */
 		}
+	}
 
-		// Check if we're not starting on a block boundary.
-		const uint32_t blockStartOffset = d->pos_7C00 % SECTOR_SIZE_DECRYPTED;
-		if (blockStartOffset != 0) {
-			// Not a block boundary.
-			// Read the end of the block.
-			uint32_t read_sz = SECTOR_SIZE_DECRYPTED - blockStartOffset;
-			if (size < static_cast<size_t>(read_sz)) {
-				read_sz = static_cast<uint32_t>(size);
-			}
-
-			// Read and decrypt the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_DECRYPTED);
-			d->readSector(blockStart);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET + blockStartOffset], read_sz);
-
-			// Starting block read.
-			size -= read_sz;
-			ptr8 += read_sz;
-			ret += read_sz;
-			d->pos_7C00 += read_sz;
+	while (size > 0) {
+		const uint32_t sector_num = static_cast<uint32_t>(d->pos_7C00 / sector_data_size);
+		const uint32_t sector_offset = static_cast<uint32_t>(d->pos_7C00 % sector_data_size);
+		uint32_t read_sz = sector_data_size - sector_offset;
+		if (size < static_cast<size_t>(read_sz)) {
+			read_sz = static_cast<uint32_t>(size);
 		}
 
-		// Read entire blocks.
-		for (; size >= SECTOR_SIZE_DECRYPTED;
-		size -= SECTOR_SIZE_DECRYPTED, ptr8 += SECTOR_SIZE_DECRYPTED,
-		ret += SECTOR_SIZE_DECRYPTED, d->pos_7C00 += SECTOR_SIZE_DECRYPTED)
-		{
-			assert(d->pos_7C00 % SECTOR_SIZE_DECRYPTED == 0);
-
-			// Read and decrypt the sector.
-			const uint32_t blockStart = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_DECRYPTED);
-			d->readSector(blockStart);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET], SECTOR_SIZE_DECRYPTED);
+		// Number of sectors left in this request, including this one.
+		// readSector() uses this to batch the underlying reads.
+		const size_t sectors_left = (sector_offset + size + sector_data_size - 1) / sector_data_size;
+		const uint8_t *const sector_buf = d->readSector(sector_num,
+			static_cast<unsigned int>(std::min<size_t>(sectors_left, 0xFFFFU)));
+		if (!sector_buf) {
+			// Read error.
+			// m_lastError has already been set.
+			break;
 		}
 
-		// Check if we still have data left. (not a full block)
-		if (size > 0) {
-			// Not a full block.
+		// Copy data from the sector.
+		memcpy(ptr8, &sector_buf[sector_data_offset + sector_offset], read_sz);
 
-			// Read and decrypt the sector.
-			assert(d->pos_7C00 % SECTOR_SIZE_DECRYPTED == 0);
-			const uint32_t blockEnd = static_cast<uint32_t>(d->pos_7C00 / SECTOR_SIZE_DECRYPTED);
-			d->readSector(blockEnd);
-
-			// Copy data from the sector.
-			memcpy(ptr8, &d->sector_buf[SECTOR_SIZE_DECRYPTED_OFFSET], size);
-
-			ret += size;
-			d->pos_7C00 += size;
-		}
+		size -= read_sz;
+		ptr8 += read_sz;
+		ret += read_sz;
+		d->pos_7C00 += read_sz;
 	}
 
 	// Finished reading the data.
@@ -832,6 +951,42 @@ const RVL_TMD_Header *WiiPartition::tmdHeader(void) const
 		: nullptr);
 }
 
+/**
+ * Set the number of decrypted sectors to cache.
+ *
+ * Each cached sector uses 32 KiB of memory. Up to half of
+ * the cache may be used for read-ahead, so a value of at
+ * least 2 is needed to enable batched reads.
+ *
+ * Any sectors that are currently cached will be discarded.
+ * If the cache can't be allocated, a single sector will be
+ * cached instead, and sectorCacheCount() will return 1.
+ *
+ * @param count Number of sectors to cache. (0 for the default)
+ */
+void WiiPartition::setSectorCacheCount(unsigned int count)
+{
+	RP_D(WiiPartition);
+	if (count == 0) {
+		count = DEFAULT_SECTOR_CACHE_COUNT;
+	}
+	if (count == d->sector_cache_count)
+		return;
+
+	d->freeSectorCache();
+	d->sector_cache_count = count;
+}
+
+/**
+ * Get the number of decrypted sectors to cache.
+ * @return Number of sectors to cache.
+ */
+unsigned int WiiPartition::sectorCacheCount(void) const
+{
+	RP_D(const WiiPartition);
+	return d->sector_cache_count;
+}
+
 #ifdef ENABLE_DECRYPTION
 /** Encryption keys. **/
 
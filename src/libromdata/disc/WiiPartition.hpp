@@ -141,6 +141,31 @@ class WiiPartition : public GcnPartition
 		 */
 		const RVL_TMD_Header *tmdHeader(void) const;
 
+	public:
+		// Default number of decrypted sectors to cache. (256 KiB)
+		static const unsigned int DEFAULT_SECTOR_CACHE_COUNT = 8;
+
+		/**
+		 * Set the number of decrypted sectors to cache.
+		 *
+		 * Each cached sector uses 32 KiB of memory. Up to half of
+		 * the cache may be used for read-ahead, so a value of at
+		 * least 2 is needed to enable batched reads.
+		 *
+		 * Any sectors that are currently cached will be discarded.
+		 * If the cache can't be allocated, a single sector will be
+		 * cached instead, and sectorCacheCount() will return 1.
+		 *
+		 * @param count Number of sectors to cache. (0 for the default)
+		 */
+		void setSectorCacheCount(unsigned int count);
+
+		/**
+		 * Get the number of decrypted sectors to cache.
+		 * @return Number of sectors to cache.
+		 */
+		unsigned int sectorCacheCount(void) const;
+
 	public:
 		// Encryption key indexes.
 		enum EncryptionKeys {
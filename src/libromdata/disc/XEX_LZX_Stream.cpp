@@ -0,0 +1,251 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * XEX_LZX_Stream.cpp: Streaming LZX decompressor for Xbox 360             *
+ * executables.                                                            *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "XEX_LZX_Stream.hpp"
+
+// librpbase
+#include "librpbase/disc/CBCReader.hpp"
+using LibRpBase::CBCReader;
+
+// libmspack-xenia
+#include "mspack.h"
+#include "xenia_lzx.h"
+
+namespace LibRomData {
+
+/**
+ * Initialize the LZX stream.
+ * @param reader CBCReader, positioned at the start of the compressed data.
+ * @param first_block First block information. (byteswapped)
+ */
+XEX_LZX_Stream::XEX_LZX_Stream(CBCReader *reader, const XEX2_Compression_Normal_Info &first_block)
+	: reader(reader)
+	, lzx_idx(0)
+	, block_remain(0)
+	, chunk_remain(0)
+	, in_block(false)
+	, pos(0)
+{
+	memcpy(&lzx_blocks[0], &first_block, sizeof(first_block));
+	memset(&lzx_blocks[1], 0, sizeof(lzx_blocks[1]));
+}
+
+/**
+ * Add a range of decompressed data to save.
+ * @param address Address in the decompressed executable.
+ * @param buf Destination buffer.
+ * @param size Size of the range.
+ */
+void XEX_LZX_Stream::addRange(size_t address, uint8_t *buf, size_t size)
+{
+	Range range;
+	range.address = address;
+	range.buf = buf;
+	range.size = size;
+	ranges.push_back(range);
+}
+
+/**
+ * Decompress the executable until all ranges have been saved.
+ * @param image_size Size of the decompressed executable.
+ * @param window_size LZX window size.
+ * @return MSPACK_ERR_OK on success; non-zero on error.
+ */
+int XEX_LZX_Stream::decompress(size_t image_size, uint32_t window_size)
+{
+	size_t stop_len = 0;
+	for (const Range &range : ranges) {
+		stop_len = std::max(stop_len, range.address + range.size);
+	}
+	if (stop_len > image_size) {
+		return MSPACK_ERR_ARGS;
+	}
+	return lzx_decompress_stream(read_cb, write_cb, this,
+		image_size, stop_len, window_size);
+}
+
+/**
+ * Decompress the executable using the first CBCReader
+ * that produces a valid MZ header.
+ *
+ * If a block size is invalid, decompression fails, or the
+ * MZ header is incorrect, the wrong decryption key is
+ * probably being used, so the next CBCReader is tried.
+ *
+ * @param reader CBCReaders to try, in order. (nullptr entries are skipped)
+ * @param readerCount Number of CBCReaders.
+ * @param first_block First block information. (byteswapped)
+ * @param ranges Ranges to save. ranges[0] must be the PE header at address 0.
+ * @param rangeCount Number of ranges.
+ * @param image_size Size of the decompressed executable.
+ * @param window_size LZX window size.
+ * @return Index of the CBCReader that was used, or -1 on error.
+ */
+int XEX_LZX_Stream::decompressPE(CBCReader *const *reader, unsigned int readerCount,
+	const XEX2_Compression_Normal_Info &first_block,
+	const Range *ranges, unsigned int rangeCount,
+	size_t image_size, uint32_t window_size)
+{
+	assert(rangeCount >= 1);
+	assert(ranges[0].address == 0);
+	assert(ranges[0].size >= 2);
+	if (rangeCount < 1 || ranges[0].address != 0 || ranges[0].size < 2) {
+		// The PE header must be the first range.
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < readerCount; i++) {
+		if (!reader[i])
+			continue;
+
+		// Start at the beginning.
+		reader[i]->rewind();
+
+		XEX_LZX_Stream lzxStream(reader[i], first_block);
+		for (unsigned int j = 0; j < rangeCount; j++) {
+			lzxStream.addRange(ranges[j].address, ranges[j].buf, ranges[j].size);
+		}
+		if (lzxStream.decompress(image_size, window_size) != MSPACK_ERR_OK) {
+			// Error decompressing the data.
+			continue;
+		}
+
+		// Verify the MZ header.
+		// TODO: Other checks?
+		uint16_t mz;
+		memcpy(&mz, ranges[0].buf, sizeof(mz));
+		if (mz == cpu_to_be16('MZ')) {
+			// MZ header is valid.
+			return static_cast<int>(i);
+		}
+	}
+
+	// Unable to decompress the executable.
+	return -1;
+}
+
+/**
+ * Read de-blocked compressed data.
+ * @param buf Buffer.
+ * @param size Size of buffer.
+ * @return Number of bytes read, 0 on EOF, or negative POSIX error code on error.
+ */
+int XEX_LZX_Stream::read(uint8_t *buf, int size)
+{
+	// Based on: https://github.com/xenia-project/xenia/blob/5f764fc752c82674981a9f402f1bbd96b399112a/src/xenia/cpu/xex_module.cc
+	int total = 0;
+	while (total < size) {
+		if (chunk_remain > 0) {
+			// Read from the current chunk.
+			const uint32_t len = std::min(chunk_remain, static_cast<uint32_t>(size - total));
+			if (reader->read(&buf[total], len) != len) {
+				// Seek and/or read error.
+				return -EIO;
+			}
+			total += static_cast<int>(len);
+			chunk_remain -= len;
+			continue;
+		}
+
+		if (in_block) {
+			// Get the next chunk size.
+			if (block_remain > 2) {
+				uint16_t chunk_size;
+				if (reader->read(&chunk_size, sizeof(chunk_size)) != sizeof(chunk_size)) {
+					// Seek and/or read error.
+					return -EIO;
+				}
+				chunk_size = be16_to_cpu(chunk_size);
+				block_remain -= 2;
+				if (chunk_size != 0 && chunk_size <= block_remain) {
+					chunk_remain = chunk_size;
+					block_remain -= chunk_size;
+					continue;
+				}
+				// End of block, or not enough data is available.
+			}
+			if (block_remain > 0) {
+				// Empty data at the end of the block.
+				// TODO: SEEK_CUR?
+				if (reader->seek(reader->tell() + block_remain) != 0) {
+					// Seek error.
+					return -EIO;
+				}
+				block_remain = 0;
+			}
+
+			// Next block.
+			lzx_idx = !lzx_idx;
+			in_block = false;
+			continue;
+		}
+
+		if (lzx_blocks[lzx_idx].block_size == 0) {
+			// End of the compressed data.
+			break;
+		}
+
+		// Read the next block header.
+		XEX2_Compression_Normal_Info &next_block = lzx_blocks[!lzx_idx];
+		if (reader->read(&next_block, sizeof(next_block)) != sizeof(next_block)) {
+			// Seek and/or read error.
+			return -EIO;
+		}
+
+		// Does the block size make sense?
+		next_block.block_size = be32_to_cpu(next_block.block_size);
+		if (next_block.block_size > 65536) {
+			// Block size is invalid.
+			// The wrong decryption key is probably being used.
+			return -EIO;
+		}
+
+		// Start the current block.
+		const uint32_t block_size = lzx_blocks[lzx_idx].block_size;
+		assert(block_size > sizeof(next_block));
+		if (block_size <= sizeof(next_block)) {
+			// Block is missing the "next block" header...
+			return -EIO;
+		}
+		block_remain = block_size - sizeof(next_block);
+		in_block = true;
+	}
+
+	return total;
+}
+
+/**
+ * Write decompressed data.
+ * Only data within the specified ranges is saved.
+ * @param buf Decompressed data.
+ * @param size Size of decompressed data.
+ * @return Number of bytes written.
+ */
+int XEX_LZX_Stream::write(const uint8_t *buf, int size)
+{
+	const size_t start = pos;
+	const size_t end = pos + size;
+	for (const Range &range : ranges) {
+		const size_t range_end = range.address + range.size;
+		if (end <= range.address || start >= range_end)
+			continue;
+
+		// Copy the overlapping data.
+		const size_t copy_start = std::max(start, range.address);
+		const size_t copy_end = std::min(end, range_end);
+		memcpy(&range.buf[copy_start - range.address],
+			&buf[copy_start - start], copy_end - copy_start);
+	}
+
+	pos = end;
+	return size;
+}
+
+}
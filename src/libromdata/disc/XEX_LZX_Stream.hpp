@@ -0,0 +1,141 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * XEX_LZX_Stream.hpp: Streaming LZX decompressor for Xbox 360             *
+ * executables.                                                            *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_DISC_XEX_LZX_STREAM_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_DISC_XEX_LZX_STREAM_HPP__
+
+#include "common.h"
+#include "../Console/xbox360_xex_structs.h"
+
+// C++ includes.
+#include <vector>
+
+namespace LibRpBase {
+	class CBCReader;
+}
+
+namespace LibRomData {
+
+/**
+ * Streaming LZX decompressor for XEX2_COMPRESSION_TYPE_NORMAL.
+ *
+ * Compressed data is de-blocked from the CBCReader as the LZX
+ * decompressor requests it, and only the specified ranges of the
+ * decompressed executable are saved. Decompression stops once the
+ * last range has been written, so memory usage depends on the LZX
+ * window size instead of the size of the executable.
+ */
+class XEX_LZX_Stream
+{
+	public:
+		/**
+		 * Initialize the LZX stream.
+		 * @param reader CBCReader, positioned at the start of the compressed data.
+		 * @param first_block First block information. (byteswapped)
+		 */
+		XEX_LZX_Stream(LibRpBase::CBCReader *reader, const XEX2_Compression_Normal_Info &first_block);
+
+	private:
+		RP_DISABLE_COPY(XEX_LZX_Stream)
+
+	public:
+		// Range of decompressed data to save.
+		struct Range {
+			size_t address;		// Address in the decompressed executable.
+			uint8_t *buf;		// Destination buffer.
+			size_t size;		// Size of the range.
+		};
+
+		/**
+		 * Add a range of decompressed data to save.
+		 * @param address Address in the decompressed executable.
+		 * @param buf Destination buffer.
+		 * @param size Size of the range.
+		 */
+		void addRange(size_t address, uint8_t *buf, size_t size);
+
+		/**
+		 * Decompress the executable until all ranges have been saved.
+		 * @param image_size Size of the decompressed executable.
+		 * @param window_size LZX window size.
+		 * @return MSPACK_ERR_OK on success; non-zero on error.
+		 */
+		int decompress(size_t image_size, uint32_t window_size);
+
+		/**
+		 * Decompress the executable using the first CBCReader
+		 * that produces a valid MZ header.
+		 *
+		 * If a block size is invalid, decompression fails, or the
+		 * MZ header is incorrect, the wrong decryption key is
+		 * probably being used, so the next CBCReader is tried.
+		 *
+		 * @param reader CBCReaders to try, in order. (nullptr entries are skipped)
+		 * @param readerCount Number of CBCReaders.
+		 * @param first_block First block information. (byteswapped)
+		 * @param ranges Ranges to save. ranges[0] must be the PE header at address 0.
+		 * @param rangeCount Number of ranges.
+		 * @param image_size Size of the decompressed executable.
+		 * @param window_size LZX window size.
+		 * @return Index of the CBCReader that was used, or -1 on error.
+		 */
+		static int decompressPE(LibRpBase::CBCReader *const *reader, unsigned int readerCount,
+			const XEX2_Compression_Normal_Info &first_block,
+			const Range *ranges, unsigned int rangeCount,
+			size_t image_size, uint32_t window_size);
+
+	private:
+		/**
+		 * Read de-blocked compressed data.
+		 * @param buf Buffer.
+		 * @param size Size of buffer.
+		 * @return Number of bytes read, 0 on EOF, or negative POSIX error code on error.
+		 */
+		int read(uint8_t *buf, int size);
+
+		/**
+		 * Write decompressed data.
+		 * Only data within the specified ranges is saved.
+		 * @param buf Decompressed data.
+		 * @param size Size of decompressed data.
+		 * @return Number of bytes written.
+		 */
+		int write(const uint8_t *buf, int size);
+
+		static int read_cb(void *userdata, void *buf, int size)
+		{
+			return static_cast<XEX_LZX_Stream*>(userdata)->read(static_cast<uint8_t*>(buf), size);
+		}
+
+		static int write_cb(void *userdata, const void *buf, int size)
+		{
+			return static_cast<XEX_LZX_Stream*>(userdata)->write(static_cast<const uint8_t*>(buf), size);
+		}
+
+	private:
+		LibRpBase::CBCReader *const reader;
+
+		// Block information.
+		// First block header is stored in the XEX header.
+		// Subsequent block headers are stored at the beginning
+		// of the previous block's compressed data.
+		XEX2_Compression_Normal_Info lzx_blocks[2];
+		unsigned int lzx_idx;		// Current block.
+		uint32_t block_remain;		// Bytes remaining in the current block.
+		uint32_t chunk_remain;		// Bytes remaining in the current chunk.
+		bool in_block;			// True if a block is being read.
+
+		// Decompressed data ranges.
+		std::vector<Range> ranges;
+		size_t pos;			// Current position in the decompressed data.
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_DISC_XEX_LZX_STREAM_HPP__ */
@@ -12,6 +12,7 @@
 
 // librpbase, librpfile
 #include "librpbase/TextFuncs.hpp"
+#include "librpbase/config/Config.hpp"
 #include "librpfile/RpFile.hpp"
 #include "librpfile/FileSystem.hpp"
 using namespace LibRpBase;
@@ -20,6 +21,9 @@ using namespace LibRpFile;
 // libcachecommon
 #include "libcachecommon/CacheKeys.hpp"
 
+// librpthreads
+#include "librpthreads/pthread_once.h"
+
 // OS-specific includes.
 #ifdef _WIN32
 # include "libwin32common/RpWin32_sdk.h"
@@ -37,8 +41,10 @@ using namespace LibRpFile;
 #include <ctime>
 
 // C++ includes.
+#include <memory>
 #include <string>
 using std::string;
+using std::unique_ptr;
 #ifdef _WIN32
 using std::wstring;
 #endif /* _WIN32 */
@@ -46,9 +52,31 @@ using std::wstring;
 namespace LibRomData {
 
 // Semaphore used to limit the number of simultaneous downloads.
-// TODO: Determine the best number of simultaneous downloads.
+// The count is set from Config::maxConcurrentDownloads() on first use.
 // TODO: Test this on XP with IEIFLAG_ASYNC.
-Semaphore CacheManager::m_dlsem(2);
+static pthread_once_t dlsem_once_control = PTHREAD_ONCE_INIT;
+static unique_ptr<Semaphore> dlsem_ptr;
+
+/**
+ * Initialize the download semaphore.
+ * Called by pthread_once().
+ */
+static void initDlSem(void)
+{
+	dlsem_ptr.reset(new Semaphore(Config::instance()->maxConcurrentDownloads()));
+}
+
+/**
+ * Get the download semaphore.
+ * This limits the number of simultaneous downloads
+ * to Config::maxConcurrentDownloads().
+ * @return Download semaphore.
+ */
+Semaphore &CacheManager::dlsem(void)
+{
+	pthread_once(&dlsem_once_control, initDlSem);
+	return *dlsem_ptr;
+}
 
 /** Proxy server functions. **/
 // NOTE: This is only useful for downloaders that
@@ -115,42 +143,30 @@ string CacheManager::download(const string &cache_key)
 		return string();
 	}
 
+	// Check the cache before locking the semaphore so cached files
+	// and negative cache entries don't wait for other downloads.
+	switch (cacheFileState(cache_filename)) {
+		case CS_CACHED:
+			return cache_filename;
+		case CS_MISSING:
+			break;
+		default:
+			return string();
+	}
+
 	// Lock the semaphore to make sure we don't
 	// download too many files at once.
-	SemaphoreLocker locker(m_dlsem);
+	SemaphoreLocker locker(dlsem());
 
-	// Check if the file already exists.
-	off64_t filesize = 0;
-	time_t filemtime = 0;
-	int ret = FileSystem::get_file_size_and_mtime(cache_filename.c_str(), &filesize, &filemtime);
-	if (ret == 0) {
-		// Check if the file is 0 bytes.
-		// TODO: How should we handle errors?
-		if (filesize == 0) {
-			// File is 0 bytes, which indicates it didn't exist
-			// on the server. If the file is older than a week,
-			// try to redownload it.
-			// TODO: Configurable time.
-			const time_t systime = time(nullptr);
-			if ((systime - filemtime) < (86400*7)) {
-				// Less than a week old.
-				return string();
-			}
-
-			// More than a week old.
-			// Delete the cache file and try to download it again.
-			if (FileSystem::delete_file(cache_filename) != 0) {
-				// Unable to delete the cache file.
-				return string();
-			}
-		} else if (filesize > 0) {
-			// File is larger than 0 bytes, which indicates
-			// it was cached successfully.
+	// Check the cache again, since another thread
+	// may have downloaded the file while we were waiting.
+	switch (cacheFileState(cache_filename)) {
+		case CS_CACHED:
 			return cache_filename;
-		}
-	} else if (ret != -ENOENT) {
-		// Some error other than "file not found" occurred.
-		return string();
+		case CS_MISSING:
+			break;
+		default:
+			return string();
 	}
 
 	// TODO: Add an option for "offline only".
@@ -165,7 +181,7 @@ string CacheManager::download(const string &cache_key)
 	// NOTE: Using the unfiltered cache key, since filtering it
 	// results in slashes being changed to backslashes on Windows.
 	// rp-download will filter the key itself.
-	ret = execRpDownload(cache_key);
+	const int ret = execRpDownload(cache_key);
 	if (ret != 0) {
 		// rp-download failed for some reason.
 		return string();
@@ -175,6 +191,72 @@ string CacheManager::download(const string &cache_key)
 	return cache_filename;
 }
 
+/**
+ * Check the state of a file in the cache.
+ * If a negative cache entry has expired, it will be deleted.
+ * @param cache_filename Filename in the cache.
+ * @return CacheState
+ */
+CacheManager::CacheState CacheManager::cacheFileState(const string &cache_filename)
+{
+	off64_t filesize = 0;
+	time_t filemtime = 0;
+	int ret = FileSystem::get_file_size_and_mtime(cache_filename.c_str(), &filesize, &filemtime);
+	if (ret == -ENOENT) {
+		// File not found.
+		return CS_MISSING;
+	} else if (ret != 0) {
+		// Some error other than "file not found" occurred.
+		return CS_ERROR;
+	}
+
+	if (filesize > 0) {
+		// File is larger than 0 bytes, which indicates
+		// it was cached successfully.
+		return CS_CACHED;
+	}
+
+	// File is 0 bytes, which indicates it didn't exist
+	// on the server. If the file is older than a week,
+	// try to redownload it.
+	// TODO: Configurable time.
+	const time_t systime = time(nullptr);
+	if ((systime - filemtime) < (86400*7)) {
+		// Less than a week old.
+		return CS_NEGATIVE;
+	}
+
+	// More than a week old.
+	// Delete the cache file so it can be downloaded again.
+	if (FileSystem::delete_file(cache_filename) != 0) {
+		// Unable to delete the cache file.
+		return CS_ERROR;
+	}
+	return CS_MISSING;
+}
+
+/**
+ * Check the state of a file in the cache.
+ * This does not download anything.
+ * @param cache_key		[in] Cache key.
+ * @param pCacheFilename	[out,opt] Filename in the cache.
+ * @return CacheState
+ */
+CacheManager::CacheState CacheManager::cacheState(const string &cache_key, string *pCacheFilename)
+{
+	string cache_filename = LibCacheCommon::getCacheFilename(cache_key);
+	if (cache_filename.empty()) {
+		// Error obtaining the cache key filename.
+		return CS_ERROR;
+	}
+
+	const CacheState state = cacheFileState(cache_filename);
+	if (pCacheFilename) {
+		*pCacheFilename = std::move(cache_filename);
+	}
+	return state;
+}
+
 /**
  * Check if a file has already been cached.
  * @param cache_key Cache key.
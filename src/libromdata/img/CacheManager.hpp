@@ -77,6 +77,38 @@ class CacheManager
 		 */
 		std::string findInCache(const std::string &cache_key);
 
+		enum CacheState {
+			CS_MISSING,	// Not in the cache, or negative cache entry has expired.
+			CS_CACHED,	// File is in the cache.
+			CS_NEGATIVE,	// File was not found on the server. (zero-byte file)
+			CS_ERROR,	// Error checking the cache.
+		};
+
+		/**
+		 * Check the state of a file in the cache.
+		 * This does not download anything.
+		 * @param cache_key		[in] Cache key.
+		 * @param pCacheFilename	[out,opt] Filename in the cache.
+		 * @return CacheState
+		 */
+		static CacheState cacheState(const std::string &cache_key, std::string *pCacheFilename = nullptr);
+
+	protected:
+		/**
+		 * Check the state of a file in the cache.
+		 * @param cache_filename Filename in the cache.
+		 * @return CacheState
+		 */
+		static CacheState cacheFileState(const std::string &cache_filename);
+
+		/**
+		 * Get the download semaphore.
+		 * This limits the number of simultaneous downloads
+		 * to Config::maxConcurrentDownloads().
+		 * @return Download semaphore.
+		 */
+		static LibRpBase::Semaphore &dlsem(void);
+
 	protected:
 		/**
 		 * Execute rp-download.
@@ -85,11 +117,19 @@ class CacheManager
 		 */
 		int execRpDownload(const std::string &filtered_cache_key);
 
+#ifndef _WIN32
+		/**
+		 * Override the rp-download executable and response timeout.
+		 * This is used by the test suite to run a fake rp-download.
+		 * NOTE: Running rp-download processes are not restarted.
+		 * @param exe Executable, or nullptr for the default.
+		 * @param timeout_ms Response timeout, in milliseconds. (0 for the default)
+		 */
+		static void setRpDownloadExe(const char *exe, int timeout_ms);
+#endif /* !_WIN32 */
+
 	protected:
 		std::string m_proxyUrl;
-
-		// Semaphore used to limit the number of simultaneous downloads.
-		static LibRpBase::Semaphore m_dlsem;
 };
 
 }
@@ -26,4 +26,15 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 	return -ENOSYS;
 }
 
+/**
+ * Override the rp-download executable and response timeout. (Dummy version)
+ * @param exe Executable, or nullptr for the default.
+ * @param timeout_ms Response timeout, in milliseconds. (0 for the default)
+ */
+void CacheManager::setRpDownloadExe(const char *exe, int timeout_ms)
+{
+	RP_UNUSED(exe);
+	RP_UNUSED(timeout_ms);
+}
+
 }
@@ -10,10 +10,23 @@
 #include "config.libromdata.h"
 #include "CacheManager.hpp"
 
+// librpbase
+#include "librpbase/config/Config.hpp"
+using LibRpBase::Config;
+
+// librpthreads
+#include "librpthreads/Mutex.hpp"
+using LibRpBase::Mutex;
+using LibRpBase::MutexLocker;
+
 // OS-specific includes.
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 #ifdef HAVE_POSIX_SPAWN
 # include <spawn.h>
@@ -23,25 +36,334 @@
 #include <string>
 using std::string;
 
+#ifndef MSG_NOSIGNAL
+// Mac OS X: SO_NOSIGPIPE is set on the socket instead.
+# define MSG_NOSIGNAL 0
+#endif
+
 namespace LibRomData {
 
 /**
- * Execute rp-download. (POSIX version)
- * @param filteredCacheKey Filtered cache key.
+ * rp-download process running in server mode.
+ *
+ * Cache keys are sent over a socket connected to the process's
+ * stdin and stdout, and the exit status for each key is read back.
+ * The process is kept running so its HTTP connections and TLS
+ * sessions can be reused for subsequent downloads.
+ */
+class RpDownloadHelper
+{
+	public:
+		RpDownloadHelper()
+			: pid(-1)
+			, fd(-1)
+			, busy(false)
+		{ }
+
+		~RpDownloadHelper()
+		{
+			stop(true);
+		}
+
+	private:
+		RP_DISABLE_COPY(RpDownloadHelper)
+
+	public:
+		/**
+		 * Start the rp-download process.
+		 * @param envp Environment.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int start(const char *const *envp);
+
+		/**
+		 * Stop the rp-download process.
+		 * @param terminate If true, send SIGTERM before waiting for the process to exit.
+		 */
+		void stop(bool terminate);
+
+		/**
+		 * Is the rp-download process running?
+		 * @return True if it's running; false if not.
+		 */
+		inline bool isRunning(void) const
+		{
+			return (pid > 0);
+		}
+
+		/**
+		 * Send a cache key to the rp-download process and wait for the result.
+		 * @param cache_key Cache key.
+		 * @return 0 on success; negative POSIX error code on error. (-EPIPE if the process went away before responding)
+		 */
+		int request(const string &cache_key);
+
+	public:
+		pid_t pid;	// rp-download process ID
+		int fd;		// Socket connected to rp-download's stdin and stdout
+		bool busy;	// Set if a request is in progress. (protected by helperMutex)
+		string s_env;	// Environment used to start the process
+};
+
+// rp-download processes.
+// NOTE: CacheManager's download semaphore allows up to
+// Config::maxConcurrentDownloads() simultaneous downloads,
+// so one process is needed for each download slot.
+static Mutex helperMutex;
+static RpDownloadHelper helpers[Config::MAX_CONCURRENT_DOWNLOADS];
+
+// TODO: Mac OS X path. (bundle?)
+static const char rp_download_exe_default[] = DIR_INSTALL_LIBEXEC "/rp-download";
+static const char *rp_download_exe = rp_download_exe_default;
+
+// Response timeout, in milliseconds.
+// TODO: User-configurable timeout?
+static const int rp_download_timeout_ms_default = 10000;
+static int rp_download_timeout_ms = rp_download_timeout_ms_default;
+
+/**
+ * Start the rp-download process.
+ * @param envp Environment.
  * @return 0 on success; negative POSIX error code on error.
  */
-int CacheManager::execRpDownload(const string &filteredCacheKey)
+int RpDownloadHelper::start(const char *const *envp)
 {
-	// TODO: Mac OS X path. (bundle?)
- 	static const char rp_download_exe[] = DIR_INSTALL_LIBEXEC "/rp-download";
+	assert(!isRunning());
 
 	// Parameters.
 	const char *const argv[3] = {
 		rp_download_exe,
-		filteredCacheKey.c_str(),
+		"--server",
 		nullptr
 	};
 
+	// Create a socket pair for communicating with rp-download.
+	// A socket is used instead of pipes so we can use MSG_NOSIGNAL
+	// to prevent SIGPIPE if rp-download exits unexpectedly.
+	// fds[0] is used by us; fds[1] is used as rp-download's stdin and stdout.
+	int fds[2];
+#ifdef SOCK_CLOEXEC
+	int ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+#else /* !SOCK_CLOEXEC */
+	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+#endif /* SOCK_CLOEXEC */
+	if (ret != 0) {
+		int err = errno;
+		if (err == 0) {
+			err = EIO;
+		}
+		return -err;
+	}
+#ifndef SOCK_CLOEXEC
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif /* !SOCK_CLOEXEC */
+#ifdef SO_NOSIGPIPE
+	int one = 1;
+	setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif /* SO_NOSIGPIPE */
+
+#ifdef HAVE_POSIX_SPAWN
+	// posix_spawn()
+	// NOTE: dup2() clears FD_CLOEXEC on the new file descriptors.
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	posix_spawn_file_actions_adddup2(&file_actions, fds[1], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&file_actions, fds[1], STDOUT_FILENO);
+
+	errno = 0;
+	ret = posix_spawn(&pid, rp_download_exe,
+		&file_actions,
+		nullptr,	// attrp
+		(char *const *)argv, (char *const *)envp);
+	posix_spawn_file_actions_destroy(&file_actions);
+	if (ret != 0) {
+		// Error creating the child process.
+		// NOTE: posix_spawn() returns the error code.
+		pid = -1;
+		close(fds[0]);
+		close(fds[1]);
+		return -ret;
+	}
+#else /* !HAVE_POSIX_SPAWN */
+	// fork()/execve().
+	errno = 0;
+	pid = fork();
+	if (pid == 0) {
+		// Child process.
+		dup2(fds[1], STDIN_FILENO);
+		dup2(fds[1], STDOUT_FILENO);
+		ret = execve(rp_download_exe, (char *const *)argv, (char *const *)envp);
+		if (ret != 0) {
+			// execve() failed.
+			_exit(EXIT_FAILURE);
+		}
+		assert(!"Shouldn't get here...");
+		_exit(EXIT_FAILURE);
+	} else if (pid == -1) {
+		// fork() failed.
+		int err = errno;
+		if (err == 0) {
+			err = EIO;
+		}
+		close(fds[0]);
+		close(fds[1]);
+		return -err;
+	}
+#endif /* HAVE_POSIX_SPAWN */
+
+	// Parent process.
+	close(fds[1]);
+	fd = fds[0];
+	return 0;
+}
+
+/**
+ * Stop the rp-download process.
+ * @param terminate If true, send SIGTERM before waiting for the process to exit.
+ */
+void RpDownloadHelper::stop(bool terminate)
+{
+	if (fd >= 0) {
+		// Closing the socket causes rp-download to exit
+		// once it finishes its current request.
+		close(fd);
+		fd = -1;
+	}
+	if (pid > 0) {
+		if (terminate) {
+			kill(pid, SIGTERM);
+		}
+		waitpid(pid, nullptr, 0);
+		pid = -1;
+	}
+}
+
+/**
+ * Send a cache key to the rp-download process and wait for the result.
+ * @param cache_key Cache key.
+ * @return 0 on success; negative POSIX error code on error. (-EPIPE if the process went away before responding)
+ */
+int RpDownloadHelper::request(const string &cache_key)
+{
+	assert(isRunning());
+
+	// Send the request.
+	string req;
+	req.reserve(cache_key.size() + 1);
+	req = cache_key;
+	req += '\n';
+	const char *p = req.data();
+	size_t size = req.size();
+	while (size > 0) {
+		const ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			// rp-download probably exited.
+			return -EPIPE;
+		}
+		p += n;
+		size -= n;
+	}
+
+	// Wait for the response. (default is 10 seconds)
+	struct timespec ts_end;
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	ts_end.tv_sec += rp_download_timeout_ms / 1000;
+	ts_end.tv_nsec += (rp_download_timeout_ms % 1000) * 1000000;
+	if (ts_end.tv_nsec >= 1000000000) {
+		ts_end.tv_sec++;
+		ts_end.tv_nsec -= 1000000000;
+	}
+
+	char resp[16];
+	size_t len = 0;
+	while (true) {
+		struct timespec ts_now;
+		clock_gettime(CLOCK_MONOTONIC, &ts_now);
+		const long ms_left = ((ts_end.tv_sec - ts_now.tv_sec) * 1000) +
+		                     ((ts_end.tv_nsec - ts_now.tv_nsec) / 1000000);
+		if (ms_left <= 0) {
+			// Timed out.
+			return -ETIMEDOUT;
+		}
+
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int ret = poll(&pfd, 1, static_cast<int>(ms_left));
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			int err = errno;
+			if (err == 0) {
+				err = EIO;
+			}
+			return -err;
+		} else if (ret == 0) {
+			// Timed out.
+			return -ETIMEDOUT;
+		}
+
+		const ssize_t n = read(fd, &resp[len], sizeof(resp) - 1 - len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -EPIPE;
+		} else if (n == 0) {
+			// rp-download exited.
+			// If we didn't get any response, the request
+			// can be retried with a new process.
+			return (len == 0 ? -EPIPE : -EIO);
+		}
+		len += n;
+		resp[len] = '\0';
+
+		if (memchr(resp, '\n', len) != nullptr) {
+			// Received the exit status.
+			break;
+		} else if (len == sizeof(resp) - 1) {
+			// Response is too long.
+			return -EIO;
+		}
+	}
+
+	// If the exit status is non-zero, the download failed.
+	// TODO: Better error code?
+	return (strtol(resp, nullptr, 10) == 0 ? 0 : -EIO);
+}
+
+/**
+ * Override the rp-download executable and response timeout.
+ * This is used by the test suite to run a fake rp-download.
+ * NOTE: Running rp-download processes are not restarted.
+ * @param exe Executable, or nullptr for the default.
+ * @param timeout_ms Response timeout, in milliseconds. (0 for the default)
+ */
+void CacheManager::setRpDownloadExe(const char *exe, int timeout_ms)
+{
+	MutexLocker locker(helperMutex);
+	rp_download_exe = (exe ? exe : rp_download_exe_default);
+	rp_download_timeout_ms = (timeout_ms > 0 ? timeout_ms : rp_download_timeout_ms_default);
+}
+
+/**
+ * Execute rp-download. (POSIX version)
+ * @param filteredCacheKey Filtered cache key.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheManager::execRpDownload(const string &filteredCacheKey)
+{
+	// Requests are separated by newlines, so the cache key
+	// must not contain any newlines or NULL characters.
+	if (filteredCacheKey.empty() ||
+	    filteredCacheKey.find_first_of("\n\0", 0, 2) != string::npos)
+	{
+		return -EINVAL;
+	}
+
 	// Define a minimal environment for cURL.
 	// This will include http_proxy and https_proxy if the proxy URL is set.
 	// TODO: Separate proxies for http and https?
@@ -88,8 +410,10 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 		// Proxy URL is set. Use it.
 		pos[count++] = static_cast<int>(s_env.size());
 		s_env += "http_proxy=" + m_proxyUrl;
+		s_env += '\0';
 		pos[count++] = static_cast<int>(s_env.size());
 		s_env += "https_proxy=" + m_proxyUrl;
+		s_env += '\0';
 	}
 
 	// Build envp.
@@ -101,95 +425,63 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 		}
 	}
 
-	// TODO: Maybe we should close file handles...
-#ifdef HAVE_POSIX_SPAWN
-	// posix_spawn()
-	errno = 0;
-	pid_t pid;
-	int ret = posix_spawn(&pid, rp_download_exe,
-		nullptr,	// file_actions
-		nullptr,	// attrp
-		(char *const *)argv, (char *const *)envp);
-	if (ret != 0) {
-		// Error creating the child process.
-		int err = errno;
-		if (err == 0) {
-			err = EIO;
+	// Find an idle rp-download process.
+	RpDownloadHelper *helper = nullptr;
+	{
+		MutexLocker locker(helperMutex);
+		for (RpDownloadHelper &h : helpers) {
+			if (!h.busy) {
+				helper = &h;
+				helper->busy = true;
+				break;
+			}
 		}
-		return -err;
 	}
-#else /* !HAVE_POSIX_SPAWN */
-	// fork()/execve().
-	errno = 0;
-	pid_t pid = fork();
-	if (pid == 0) {
-		// Child process.
-		int ret = execve(rp_download_exe, (char *const *)argv, (char *const *)envp);
-		if (ret != 0) {
-			// execve() failed.
-			exit(EXIT_FAILURE);
-		}
-		assert(!"Shouldn't get here...");
-		exit(EXIT_FAILURE);
-	} else if (pid == -1) {
-		// fork() failed.
-		int err = errno;
-		if (err == 0) {
-			err = EIO;
-		}
-		return -err;
+	assert(helper != nullptr);
+	if (!helper) {
+		// Shouldn't happen: dlsem() limits the number of simultaneous downloads.
+		return -EBUSY;
 	}
-#endif /* HAVE_POSIX_SPAWN */
 
-	// Parent process.
-	// Wait up to 10 seconds for the process to exit.
-	// TODO: User-configurable timeout?
-	// TODO: Report errors somewhere.
-	bool ok = false;	// rp-download terminated successfully.
-	bool waited = false;	// waitpid() was successful.
-	int wstatus = 0;
-	for (unsigned int i = 10*4; i > 0; i--) {
-		pid_t wpid = waitpid(pid, &wstatus, WNOHANG);
-		if (wpid == pid) {
-			// Process has changed state.
-			if (WIFEXITED(wstatus)) {
-				// Child process has exited.
-				// If the return status is non-zero, it failed.
-				if (WEXITSTATUS(wstatus) != 0) {
-					// Failure.
-					break;
-				}
-				// Success!
-				ok = true;
-				waited = true;
-				break;
-			} else if (WIFSIGNALED(wstatus)) {
-				// Child process terminated abnormally.
-				waited = true;
+	// If the environment has changed, e.g. due to a new proxy URL,
+	// the process needs to be restarted.
+	if (helper->isRunning() && helper->s_env != s_env) {
+		helper->stop(false);
+	}
+
+	// Send the request.
+	// If the process went away before responding, e.g. if it
+	// crashed or was killed, restart it and try again once.
+	int ret = -EPIPE;
+	for (unsigned int attempt = 0; attempt < 2 && ret == -EPIPE; attempt++) {
+		if (!helper->isRunning()) {
+			ret = helper->start(envp);
+			if (ret != 0) {
 				break;
 			}
+			helper->s_env = s_env;
 		}
 
-		// Wait 250ms before checking again.
-		usleep(250*1000);
+		ret = helper->request(filteredCacheKey);
+		if (ret == -EPIPE || ret == -ETIMEDOUT) {
+			// Process did not complete the request.
+			helper->stop(true);
+		}
 	}
 
-	if (!waited) {
-		// Process did not complete.
-		// TODO: Prevent race conditions by using waitid() instead of waitpid()?
-		// TODO: Better error code?
-		kill(pid, SIGTERM);
-		return -ECHILD;
+	{
+		MutexLocker locker(helperMutex);
+		helper->busy = false;
 	}
 
-	if (!ok) {
-		// rp-download failed for some reason.
+	if (ret == -ETIMEDOUT || ret == -EPIPE) {
+		// Process did not complete.
 		// TODO: Better error code?
-		return -EIO;
+		return -ECHILD;
 	}
 
-	// rp-download has successfully downloaded the file.
-	return 0;
+	// 0 if rp-download has successfully downloaded the file.
+	return ret;
 }
 
 }
@@ -0,0 +1,425 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * ExtImageFetcher.cpp: External image fetcher.                            *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ExtImageFetcher.hpp"
+#include "CacheManager.hpp"
+
+// librpbase, librpfile, librptexture
+#include "librpbase/config/Config.hpp"
+#include "librpbase/img/RpImageLoader.hpp"
+#include "librpfile/RpFile.hpp"
+#include "librptexture/img/rp_image.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+using LibRpTexture::rp_image;
+
+// librpthreads
+#include "librpthreads/Atomics.h"
+#include "librpthreads/Mutex.hpp"
+#include "librpthreads/Semaphore.hpp"
+#include "librpthreads/Thread.hpp"
+using LibRpBase::Mutex;
+using LibRpBase::MutexLocker;
+using LibRpBase::Semaphore;
+
+// C++ includes.
+#include <memory>
+#include <string>
+#include <vector>
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace LibRomData {
+
+/**
+ * Concurrent fetch of multiple candidates.
+ *
+ * The job is reference-counted, since worker threads that are
+ * still fetching lower-priority candidates when the result is
+ * known are left running in the background.
+ */
+class ExtImageFetchJob
+{
+	public:
+		ExtImageFetchJob(const vector<ExtImageFetcher::Candidate> &candidates, unsigned int first)
+			: candidates(candidates)
+			, images(candidates.size())
+			, done(candidates.size())
+			, first(static_cast<int>(first))
+			, nextIdx(static_cast<int>(first))
+			, bestIdx(static_cast<int>(candidates.size()))
+			, cancelled(false)
+			, doneSem(0)
+			, ref_cnt(1)
+		{ }
+
+	private:
+		~ExtImageFetchJob()	// call unref() instead
+		{
+			for (rp_image *img : images) {
+				delete img;
+			}
+		}
+
+	private:
+		RP_DISABLE_COPY(ExtImageFetchJob)
+
+	public:
+		/**
+		 * Take a reference to this job.
+		 * @return this
+		 */
+		inline ExtImageFetchJob *ref(void)
+		{
+			ATOMIC_INC_FETCH(&ref_cnt);
+			return this;
+		}
+
+		/**
+		 * Unreference this job.
+		 * If the reference count reaches 0, the job is deleted.
+		 */
+		inline void unref(void)
+		{
+			assert(ref_cnt > 0);
+			if (ATOMIC_DEC_FETCH(&ref_cnt) <= 0) {
+				// All references removed.
+				delete this;
+			}
+		}
+
+	public:
+		/**
+		 * Load an image from the cache.
+		 * @param cache_filename Filename in the cache.
+		 * @return Image, or nullptr if it couldn't be loaded.
+		 */
+		static rp_image *loadCachedImage(const string &cache_filename);
+
+		/**
+		 * Fetch a single candidate.
+		 * @param candidate Candidate.
+		 * @return Image, or nullptr if it couldn't be fetched.
+		 */
+		static rp_image *fetch(const ExtImageFetcher::Candidate &candidate);
+
+		/**
+		 * Worker thread function.
+		 * @param param ExtImageFetchJob. (unref()'d when done)
+		 */
+		static void workerProc(void *param);
+
+		/**
+		 * Start worker threads.
+		 * The threads are detached, and each one holds a reference to the job.
+		 * @param threadCount Number of threads to start.
+		 * @return Number of threads that were started.
+		 */
+		unsigned int startWorkers(unsigned int threadCount);
+
+		/**
+		 * Fetch candidates until there are no candidates left
+		 * that could be better than the best one found so far,
+		 * or until the job is cancelled.
+		 */
+		void run(void);
+
+		/**
+		 * Wait until the best candidate is known.
+		 * This is as soon as every candidate before the best
+		 * successful candidate has failed. The job is then cancelled;
+		 * lower-priority candidates that are still being fetched
+		 * are left to finish in the background.
+		 * @param pIndex [out] Index of the best candidate, or -1 if none.
+		 * @return Image, or nullptr if no candidates could be loaded. (Caller must delete it.)
+		 */
+		rp_image *waitForResult(int *pIndex);
+
+	private:
+		/**
+		 * Is the best candidate known?
+		 * NOTE: mutex must be locked by the caller.
+		 * @return True if every candidate before bestIdx is done.
+		 */
+		bool isBestKnown(void) const;
+
+	private:
+		const vector<ExtImageFetcher::Candidate> candidates;
+		vector<rp_image*> images;	// Loaded images. [index is candidate index] (protected by mutex)
+		vector<uint8_t> done;		// Set once a candidate was fetched. (protected by mutex)
+		const int first;		// First candidate to fetch.
+		volatile int nextIdx;		// Next candidate to fetch.
+		volatile int bestIdx;		// Lowest index of a successful candidate. (written with mutex locked)
+		volatile bool cancelled;	// Set once the result is known.
+
+		Mutex mutex;
+		Semaphore doneSem;		// Released each time a candidate is done.
+		unique_ptr<LibRpBase::Thread[]> threads;
+		volatile int ref_cnt;
+};
+
+/**
+ * Load an image from the cache.
+ * @param cache_filename Filename in the cache.
+ * @return Image, or nullptr if it couldn't be loaded.
+ */
+rp_image *ExtImageFetchJob::loadCachedImage(const string &cache_filename)
+{
+	unique_IRpFile<RpFile> file(new RpFile(cache_filename, RpFile::FM_OPEN_READ));
+	if (!file->isOpen()) {
+		return nullptr;
+	}
+
+	rp_image *const img = RpImageLoader::load(file.get());
+	if (img && !img->isValid()) {
+		delete img;
+		return nullptr;
+	}
+	return img;
+}
+
+/**
+ * Fetch a single candidate.
+ * @param candidate Candidate.
+ * @return Image, or nullptr if it couldn't be fetched.
+ */
+rp_image *ExtImageFetchJob::fetch(const ExtImageFetcher::Candidate &candidate)
+{
+	CacheManager cache;
+	cache.setProxyUrl(candidate.proxyUrl);
+
+	// TODO: Have download() return the actual data and/or load the cached file.
+	string cache_filename;
+	if (candidate.download) {
+		// Attempt to download the image if it isn't already
+		// present in the rom-properties cache.
+		cache_filename = cache.download(candidate.cache_key);
+	} else {
+		// Don't attempt to download the image.
+		// Only check the rom-properties cache.
+		cache_filename = cache.findInCache(candidate.cache_key);
+	}
+	if (cache_filename.empty()) {
+		return nullptr;
+	}
+
+	return loadCachedImage(cache_filename);
+}
+
+/**
+ * Worker thread function.
+ * @param param ExtImageFetchJob. (unref()'d when done)
+ */
+void ExtImageFetchJob::workerProc(void *param)
+{
+	ExtImageFetchJob *const job = static_cast<ExtImageFetchJob*>(param);
+	job->run();
+	job->unref();
+}
+
+/**
+ * Start worker threads.
+ * The threads are detached, and each one holds a reference to the job.
+ * @param threadCount Number of threads to start.
+ * @return Number of threads that were started.
+ */
+unsigned int ExtImageFetchJob::startWorkers(unsigned int threadCount)
+{
+	assert(!threads);
+	threads.reset(new LibRpBase::Thread[threadCount]);
+	unsigned int started = 0;
+	for (; started < threadCount; started++) {
+		ref();
+		if (threads[started].start(workerProc, this) != 0) {
+			// Unable to start the thread.
+			// The threads that were started will handle it.
+			unref();
+			break;
+		}
+		threads[started].detach();
+	}
+	return started;
+}
+
+/**
+ * Fetch candidates until there are no candidates left
+ * that could be better than the best one found so far,
+ * or until the job is cancelled.
+ */
+void ExtImageFetchJob::run(void)
+{
+	while (!cancelled) {
+		const int idx = ATOMIC_INC_FETCH(&nextIdx) - 1;
+		if (idx >= bestIdx) {
+			// Either there are no candidates left, or a
+			// higher-priority candidate has already succeeded.
+			break;
+		}
+
+		rp_image *const img = fetch(candidates[idx]);
+		{
+			MutexLocker locker(mutex);
+			images[idx] = img;
+			done[idx] = 1;
+			if (img && idx < bestIdx) {
+				// This candidate has a higher priority.
+				bestIdx = idx;
+			}
+		}
+		doneSem.release();
+	}
+}
+
+/**
+ * Is the best candidate known?
+ * NOTE: mutex must be locked by the caller.
+ * @return True if every candidate before bestIdx is done.
+ */
+bool ExtImageFetchJob::isBestKnown(void) const
+{
+	for (int i = first; i < bestIdx; i++) {
+		if (!done[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Wait until the best candidate is known.
+ * This is as soon as every candidate before the best
+ * successful candidate has failed. The job is then cancelled;
+ * lower-priority candidates that are still being fetched
+ * are left to finish in the background.
+ * @param pIndex [out] Index of the best candidate, or -1 if none.
+ * @return Image, or nullptr if no candidates could be loaded. (Caller must delete it.)
+ */
+rp_image *ExtImageFetchJob::waitForResult(int *pIndex)
+{
+	while (true) {
+		{
+			MutexLocker locker(mutex);
+			if (isBestKnown()) {
+				cancelled = true;
+				const int best = bestIdx;
+				if (best >= static_cast<int>(candidates.size())) {
+					// No candidates could be loaded.
+					*pIndex = -1;
+					return nullptr;
+				}
+				*pIndex = best;
+				rp_image *const img = images[best];
+				images[best] = nullptr;
+				return img;
+			}
+		}
+
+		// Wait for another candidate to finish.
+		doneSem.obtain();
+	}
+}
+
+/**
+ * Maximum number of candidates that are fetched concurrently.
+ * (Default is Config::maxConcurrentDownloads().)
+ * @return Maximum number of concurrent fetches.
+ */
+unsigned int ExtImageFetcher::maxThreads(void) const
+{
+	if (m_maxThreads > 0) {
+		return m_maxThreads;
+	}
+	return Config::instance()->maxConcurrentDownloads();
+}
+
+/**
+ * Set the maximum number of candidates that are fetched concurrently.
+ * @param maxThreads Maximum number of concurrent fetches. (0 for default)
+ */
+void ExtImageFetcher::setMaxThreads(unsigned int maxThreads)
+{
+	m_maxThreads = maxThreads;
+}
+
+/**
+ * Fetch the first available image from a list of candidates.
+ *
+ * The result is the same as trying each candidate in order:
+ * the first candidate that can be loaded as a valid image is
+ * returned. Candidates that are already in the cache, or that
+ * have a negative cache entry, are checked first without
+ * downloading anything. The remaining candidates are then
+ * downloaded concurrently. Once a candidate succeeds, candidates
+ * after it that haven't been started yet are skipped, and this
+ * function returns as soon as all candidates before it have
+ * failed. Lower-priority downloads that are still in progress
+ * aren't waited for; they finish in the background.
+ *
+ * @param candidates	[in] Candidates, in priority order.
+ * @param pIndex	[out,opt] Index of the candidate that was loaded.
+ * @return Image, or nullptr if no candidates could be loaded. (Caller must delete it.)
+ */
+rp_image *ExtImageFetcher::fetchFirst(const vector<Candidate> &candidates, int *pIndex) const
+{
+	if (pIndex) {
+		*pIndex = -1;
+	}
+
+	// Check the cache first, in priority order.
+	// If a candidate is cached, we don't need to download anything.
+	// Stop at the first candidate that needs to be downloaded.
+	const unsigned int count = static_cast<unsigned int>(candidates.size());
+	unsigned int first = 0;
+	for (; first < count; first++) {
+		const Candidate &candidate = candidates[first];
+		string cache_filename;
+		const CacheManager::CacheState state =
+			CacheManager::cacheState(candidate.cache_key, &cache_filename);
+		if (state == CacheManager::CS_CACHED) {
+			rp_image *const img = ExtImageFetchJob::loadCachedImage(cache_filename);
+			if (img) {
+				if (pIndex) {
+					*pIndex = static_cast<int>(first);
+				}
+				return img;
+			}
+		} else if (state == CacheManager::CS_MISSING && candidate.download) {
+			// This candidate needs to be downloaded.
+			break;
+		}
+	}
+	if (first >= count) {
+		// No candidates are available.
+		return nullptr;
+	}
+
+	// Download the remaining candidates concurrently.
+	// fetchFirst() returns as soon as the best candidate is known.
+	ExtImageFetchJob *const job = new ExtImageFetchJob(candidates, first);
+	unsigned int threadCount = maxThreads();
+	if (threadCount > count - first) {
+		threadCount = count - first;
+	}
+	if (job->startWorkers(threadCount) == 0) {
+		// Unable to start any threads.
+		// Fetch the candidates on the calling thread.
+		job->run();
+	}
+
+	int best = -1;
+	rp_image *const img = job->waitForResult(&best);
+	job->unref();
+	if (pIndex) {
+		*pIndex = best;
+	}
+	return img;
+}
+
+}
@@ -0,0 +1,81 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * ExtImageFetcher.hpp: External image fetcher.                            *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_IMG_EXTIMAGEFETCHER_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_IMG_EXTIMAGEFETCHER_HPP__
+
+#include "common.h"
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+namespace LibRpTexture {
+	class rp_image;
+}
+
+namespace LibRomData {
+
+class ExtImageFetcher
+{
+	public:
+		ExtImageFetcher()
+			: m_maxThreads(0)
+		{ }
+		~ExtImageFetcher() { }
+
+	private:
+		RP_DISABLE_COPY(ExtImageFetcher)
+
+	public:
+		struct Candidate {
+			std::string cache_key;	// Cache key
+			std::string proxyUrl;	// Proxy URL (empty for default)
+			bool download;		// If false, only check the cache.
+		};
+
+		/**
+		 * Maximum number of candidates that are fetched concurrently.
+		 * (Default is Config::maxConcurrentDownloads().)
+		 * @return Maximum number of concurrent fetches.
+		 */
+		unsigned int maxThreads(void) const;
+
+		/**
+		 * Set the maximum number of candidates that are fetched concurrently.
+		 * @param maxThreads Maximum number of concurrent fetches. (0 for default)
+		 */
+		void setMaxThreads(unsigned int maxThreads);
+
+		/**
+		 * Fetch the first available image from a list of candidates.
+		 *
+		 * The result is the same as trying each candidate in order:
+		 * the first candidate that can be loaded as a valid image is
+		 * returned. Candidates that are already in the cache, or that
+		 * have a negative cache entry, are checked first without
+		 * downloading anything. The remaining candidates are then
+		 * downloaded concurrently. Once a candidate succeeds, candidates
+		 * after it that haven't been started yet are skipped, and this
+		 * function returns as soon as all candidates before it have
+		 * failed. Lower-priority downloads that are still in progress
+		 * aren't waited for; they finish in the background.
+		 *
+		 * @param candidates	[in] Candidates, in priority order.
+		 * @param pIndex	[out,opt] Index of the candidate that was loaded.
+		 * @return Image, or nullptr if no candidates could be loaded. (Caller must delete it.)
+		 */
+		LibRpTexture::rp_image *fetchFirst(const std::vector<Candidate> &candidates, int *pIndex = nullptr) const;
+
+	private:
+		unsigned int m_maxThreads;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_IMG_EXTIMAGEFETCHER_HPP__ */
@@ -12,18 +12,18 @@
 #include "TCreateThumbnail.hpp"
 
 // Cache Manager
-#include "CacheManager.hpp"
+#include "ExtImageFetcher.hpp"
 
 // librpbase, librpfile
 #include "librpbase/RomData.hpp"
 #include "librpbase/config/Config.hpp"
-#include "librpbase/img/RpImageLoader.hpp"
 #include "librpfile/RpFile.hpp"
 using namespace LibRpBase;
 using namespace LibRpFile;
 
 // librptexture
 #include "librptexture/img/rp_image.hpp"
+#include "librptexture/img/ImageScaler.hpp"
 using LibRpTexture::rp_image;
 
 // libromdata
@@ -51,7 +51,8 @@ TCreateThumbnail<ImgClass>::~TCreateThumbnail()
  * Get an internal image.
  * @param romData	[in] RomData object.
  * @param imageType	[in] Image type.
- * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+ * @param req_size	[in] Requested image size. Larger images are downscaled. (0 to disable)
+ * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's original size.
  * @param sBIT		[out,opt] sBIT metadata.
  * @return Internal image, or null ImgClass on error.
  */
@@ -59,7 +60,7 @@ template<typename ImgClass>
 ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 	const RomData *romData,
 	RomData::ImageType imageType,
-	ImgSize *pOutSize,
+	int req_size, ImgSize *pOutSize,
 	rp_image::sBIT_t *sBIT)
 {
 	assert(imageType >= RomData::IMG_INT_MIN && imageType <= RomData::IMG_INT_MAX);
@@ -71,7 +72,10 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 		return getNullImgClass();
 	}
 
-	const rp_image *image = romData->image(imageType);
+	// NOTE: If the image has mipmaps, a smaller mipmap may be returned.
+	// fullSize always contains the full image size.
+	int fullSize[2] = {0, 0};
+	const rp_image *image = romData->imageForSize(imageType, req_size, fullSize);
 	if (!image) {
 		// No image.
 		if (sBIT) {
@@ -80,17 +84,30 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 		return getNullImgClass();
 	}
 
+	// Downscale the image if it's larger than the requested size.
+	const bool nearest = !!(romData->imgpf(imageType) & RomData::IMGPF_RESCALE_NEAREST);
+	unique_ptr<rp_image> scaled_img(downscaleRpImage(image, req_size, nearest));
+
 	// Convert the rp_image to ImgClass.
-	ImgClass ret_img = rpImageToImgClass(image);
+	ImgClass ret_img = rpImageToImgClass(scaled_img ? scaled_img.get() : image);
 	if (isImgClassValid(ret_img)) {
 		// Image converted successfully.
 		if (pOutSize) {
-			// Get the image size.
-			// NOTE: The image may have been resized on Windows,
-			// since Windows has issues with non-square images.
-			// Hence, we have to get the size from ret_img.
-			// TODO: Check for errors?
-			getImgClassSize(ret_img, pOutSize);
+			if (scaled_img ||
+			    fullSize[0] != image->width() || fullSize[1] != image->height())
+			{
+				// Image was downscaled, or a mipmap was used.
+				// Use the original size.
+				pOutSize->width = fullSize[0];
+				pOutSize->height = fullSize[1];
+			} else {
+				// Get the image size.
+				// NOTE: The image may have been resized on Windows,
+				// since Windows has issues with non-square images.
+				// Hence, we have to get the size from ret_img.
+				// TODO: Check for errors?
+				getImgClassSize(ret_img, pOutSize);
+			}
 		}
 		if (sBIT) {
 			// Get the sBIT metadata.
@@ -108,8 +125,8 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
  * Get an external image.
  * @param romData	[in] RomData object.
  * @param imageType	[in] Image type.
- * @param req_size	[in] Requested image size.
- * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+ * @param req_size	[in] Requested image size. Larger images are downscaled.
+ * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's original size.
  * @param sBIT		[out,opt] sBIT metadata.
  * @return External image, or null ImgClass on error.
  */
@@ -128,7 +145,7 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 		return getNullImgClass();
 	}
 
-	// Synchronously download from the source URLs.
+	// Download from the source URLs.
 	// TODO: Image size selection.
 	std::vector<RomData::ExtURL> extURLs;
 	int ret = romData->extURLs(imageType, &extURLs, req_size);
@@ -145,63 +162,57 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 	const bool extImgDownloadEnabled = config->extImgDownloadEnabled();
 	const bool downloadHighResScans = config->downloadHighResScans();
 
-	CacheManager cache;
+	// Build the list of candidates.
+	// NOTE: proxyForUrl() is called here, since it might not be
+	// thread-safe in some UI frontends.
+	std::vector<ExtImageFetcher::Candidate> candidates;
+	candidates.reserve(extURLs.size());
 	for (auto iter = extURLs.cbegin(); iter != extURLs.cend(); ++iter) {
 		const RomData::ExtURL &extURL = *iter;
-		std::string proxy = proxyForUrl(extURL.url);
-		cache.setProxyUrl(!proxy.empty() ? proxy.c_str() : nullptr);
+
+		ExtImageFetcher::Candidate candidate;
+		candidate.cache_key = extURL.cache_key;
+		candidate.proxyUrl = proxyForUrl(extURL.url);
 
 		// Should we attempt to download the image,
 		// or just use the local cache?
 		// TODO: Verify that this works correctly.
-		bool download = extImgDownloadEnabled;
+		candidate.download = extImgDownloadEnabled;
 		if (!downloadHighResScans && extURL.high_res) {
 			// Don't download high-resolution images, but
 			// use them if they've already been downloaded.
-			download = false;
+			candidate.download = false;
 		}
 
-		// TODO: Have download() return the actual data and/or load the cached file.
-		std::string cache_filename;
-		if (download) {
-			// Attempt to download the image if it isn't already
-			// present in the rom-properties cache.
-			cache_filename = cache.download(extURL.cache_key);
-		} else {
-			// Don't attempt to download the image.
-			// Only check the rom-properties cache.
-			cache_filename = cache.findInCache(extURL.cache_key);
-		}
-		if (cache_filename.empty())
-			continue;
+		candidates.push_back(std::move(candidate));
+	}
 
-		// Attempt to load the image.
-		unique_IRpFile<RpFile> file(new RpFile(cache_filename, RpFile::FM_OPEN_READ));
-		if (file->isOpen()) {
-			unique_ptr<rp_image> dl_img(RpImageLoader::load(file.get()));
-			if (dl_img && dl_img->isValid()) {
-				// Image loaded successfully.
-				file->close();
-				ImgClass ret_img = rpImageToImgClass(dl_img.get());
-				if (isImgClassValid(ret_img)) {
-					// Image converted successfully.
-					if (pOutSize) {
-						// Get the image size.
-						pOutSize->width = dl_img->width();
-						pOutSize->height = dl_img->height();
-					}
-					// Get the sBIT metadata.
-					if (sBIT) {
-						if (dl_img->get_sBIT(sBIT) != 0) {
-							// No sBIT metadata.
-							// Clear the struct.
-							memset(sBIT, 0, sizeof(*sBIT));
-						}
-					}
-					// TODO: Transparency processing?
-					return ret_img;
+	// Get the first available image.
+	// Candidates that aren't cached are downloaded concurrently.
+	ExtImageFetcher fetcher;
+	unique_ptr<rp_image> dl_img(fetcher.fetchFirst(candidates));
+	if (dl_img) {
+		// Downscale the image if it's larger than the requested size.
+		const bool nearest = !!(romData->imgpf(imageType) & RomData::IMGPF_RESCALE_NEAREST);
+		unique_ptr<rp_image> scaled_img(downscaleRpImage(dl_img.get(), req_size, nearest));
+		ImgClass ret_img = rpImageToImgClass(scaled_img ? scaled_img.get() : dl_img.get());
+		if (isImgClassValid(ret_img)) {
+			// Image converted successfully.
+			if (pOutSize) {
+				// Get the image size.
+				pOutSize->width = dl_img->width();
+				pOutSize->height = dl_img->height();
+			}
+			// Get the sBIT metadata.
+			if (sBIT) {
+				if (dl_img->get_sBIT(sBIT) != 0) {
+					// No sBIT metadata.
+					// Clear the struct.
+					memset(sBIT, 0, sizeof(*sBIT));
 				}
 			}
+			// TODO: Transparency processing?
+			return ret_img;
 		}
 	}
 
@@ -240,6 +251,44 @@ inline void TCreateThumbnail<ImgClass>::rescale_aspect(ImgSize &rs_size, const I
 	}
 }
 
+/**
+ * Downscale an rp_image to fit within the requested size.
+ * The aspect ratio is maintained.
+ * @param img		[in] rp_image
+ * @param req_size	[in] Requested image size. (single dimension; assuming square image)
+ * @param nearest	[in] If true, use nearest-neighbor sampling instead of area averaging.
+ * @return Downscaled rp_image, or nullptr if the image doesn't need to be downscaled.
+ */
+template<typename ImgClass>
+rp_image *TCreateThumbnail<ImgClass>::downscaleRpImage(const rp_image *img, int req_size, bool nearest)
+{
+	ImgSize sz = {img->width(), img->height()};
+	if (req_size <= 0 || (sz.width <= req_size && sz.height <= req_size)) {
+		// No downscaling is needed.
+		return nullptr;
+	}
+
+	// Calculate the closest size while maintaining the aspect ratio.
+	const ImgSize tgt_sz = {req_size, req_size};
+	rescale_aspect(sz, tgt_sz);
+	if (sz.width <= 0) {
+		sz.width = 1;
+	}
+	if (sz.height <= 0) {
+		sz.height = 1;
+	}
+
+	// Downscale the image using area averaging, or nearest-neighbor
+	// sampling for pixel art, which shouldn't be blurred.
+	// NOTE: This is done here instead of in the UI frontend
+	// so the full-size image doesn't have to be converted to
+	// ImgClass first.
+	if (nearest) {
+		return LibRpTexture::ImageScaler::downscale_nearest(img, sz.width, sz.height);
+	}
+	return LibRpTexture::ImageScaler::downscale(img, sz.width, sz.height);
+}
+
 /**
  * Create a thumbnail for the specified ROM file.
  * @param romData	[in] RomData object.
@@ -294,7 +343,7 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 		// Check for an icon first.
 		// TODO: Define "small sizes" somewhere. (DPI independence?)
 		if (imgbf & RomData::IMGBF_INT_ICON) {
-			pOutParams->retImg = getInternalImage(romData, RomData::IMG_INT_ICON, &pOutParams->fullSize, &pOutParams->sBIT);
+			pOutParams->retImg = getInternalImage(romData, RomData::IMG_INT_ICON, reqSize, &pOutParams->fullSize, &pOutParams->sBIT);
 			imgpf = romData->imgpf(RomData::IMG_INT_ICON);
 			imgbf &= ~RomData::IMGBF_INT_ICON;
 
@@ -326,7 +375,7 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 		// This image may be present.
 		if (imgType <= RomData::IMG_INT_MAX) {
 			// Internal image.
-			pOutParams->retImg = getInternalImage(romData, imgType, &pOutParams->fullSize, &pOutParams->sBIT);
+			pOutParams->retImg = getInternalImage(romData, imgType, reqSize, &pOutParams->fullSize, &pOutParams->sBIT);
 			imgpf = romData->imgpf(imgType);
 		} else {
 			// External image.
@@ -358,8 +407,17 @@ skip_image_check:
 		return RPCT_SOURCE_FILE_ERROR;
 	}
 
-	// TODO: If image is larger than req_size, resize down.
-	if (imgpf & RomData::IMGPF_RESCALE_NEAREST) {
+	if (pOutParams->fullSize.width > reqSize || pOutParams->fullSize.height > reqSize) {
+		// Image was downscaled by getInternalImage() or getExternalImage().
+		// NOTE: IMGPF_RESCALE_NEAREST was handled by downscaleRpImage().
+		// Get the actual thumbnail size from the ImgClass.
+		if (getImgClassSize(pOutParams->retImg, &pOutParams->thumbSize) != 0) {
+			// Unable to get the image size.
+			freeImgClass(pOutParams->retImg);
+			pOutParams->retImg = getNullImgClass();
+			return RPCT_SOURCE_FILE_ERROR;
+		}
+	} else if (imgpf & RomData::IMGPF_RESCALE_NEAREST) {
 		// TODO: User configuration.
 		ResizeNearestUpPolicy resize_up = RESIZE_UP_HALF;
 		bool needs_resize_up = false;
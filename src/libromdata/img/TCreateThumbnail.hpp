@@ -106,21 +106,22 @@ class TCreateThumbnail
 		 * Get an internal image.
 		 * @param romData	[in] RomData object.
 		 * @param imageType	[in] Image type.
-		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+		 * @param req_size	[in] Requested image size. Larger images are downscaled. (0 to disable)
+		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's original size.
 		 * @param sBIT		[out,opt] sBIT metadata.
 		 * @return Internal image, or null ImgClass on error.
 		 */
 		ImgClass getInternalImage(const LibRpBase::RomData *romData,
 			LibRpBase::RomData::ImageType imageType,
-			ImgSize *pOutSize = nullptr,
+			int req_size = 0, ImgSize *pOutSize = nullptr,
 			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr);
 
 		/**
 		 * Get an external image.
 		 * @param romData	[in] RomData object.
 		 * @param imageType	[in] Image type.
-		 * @param req_size	[in] Requested image size.
-		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
+		 * @param req_size	[in] Requested image size. Larger images are downscaled.
+		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's original size.
 		 * @param sBIT		[out,opt] sBIT metadata.
 		 * @return External image, or null ImgClass on error.
 		 */
@@ -175,6 +176,16 @@ class TCreateThumbnail
 		 */
 		static inline void rescale_aspect(ImgSize &rs_size, const ImgSize &tgt_size);
 
+		/**
+		 * Downscale an rp_image to fit within the requested size.
+		 * The aspect ratio is maintained.
+		 * @param img		[in] rp_image
+		 * @param req_size	[in] Requested image size. (single dimension; assuming square image)
+		 * @param nearest	[in] If true, use nearest-neighbor sampling instead of area averaging.
+		 * @return Downscaled rp_image, or nullptr if the image doesn't need to be downscaled.
+		 */
+		static LibRpTexture::rp_image *downscaleRpImage(const LibRpTexture::rp_image *img, int req_size, bool nearest);
+
 	protected:
 		/** Pure virtual functions. **/
 
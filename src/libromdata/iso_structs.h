@@ -188,7 +188,7 @@ typedef struct PACKED _ISO_Primary_Volume_Descriptor {
 	char volID[32];				// [0x028] (strD) Volume identifier.
 	uint8_t reserved2[8];			// [0x048] All zeroes.
 	uint32_lsb_msb_t volume_space_size;	// [0x050] Size of volume, in blocks.
-	uint8_t reserved3[32];			// [0x058] All zeroes.
+	uint8_t reserved3[32];			// [0x058] All zeroes. (SVD: Escape sequences)
 	uint16_lsb_msb_t volume_set_size;	// [0x078] Size of the logical volume. (number of discs)
 	uint16_lsb_msb_t volume_seq_number;	// [0x07C] Disc number in the volume set.
 	uint16_lsb_msb_t logical_block_size;	// [0x080] Logical block size. (usually 2048)
@@ -252,6 +252,17 @@ typedef union PACKED _ISO_Volume_Descriptor {
 } ISO_Volume_Descriptor;
 ASSERT_STRUCT(ISO_Volume_Descriptor, ISO_SECTOR_SIZE_MODE1_COOKED);
 
+/**
+ * Joliet escape sequences.
+ * Stored in a supplementary volume descriptor's reserved3 field.
+ * (The SVD uses the same layout as the PVD.)
+ *
+ * Joliet filenames are encoded as UCS-2 (big-endian).
+ */
+#define ISO_JOLIET_ESCAPE_LEVEL1 "%/@"
+#define ISO_JOLIET_ESCAPE_LEVEL2 "%/C"
+#define ISO_JOLIET_ESCAPE_LEVEL3 "%/E"
+
 /**
  * Volume descriptor type.
  */
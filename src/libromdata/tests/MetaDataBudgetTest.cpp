@@ -0,0 +1,643 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * MetaDataBudgetTest.cpp: Metadata extraction read budget test.           *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpbase/RomData.hpp"
+#include "librpbase/RomMetaData.hpp"
+#include "librpcpu/byteswap.h"
+#include "librpfile/IRpFile.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// RomData subclasses.
+#include "Audio/GBS.hpp"
+#include "Audio/NSF.hpp"
+#include "Audio/PSF.hpp"
+#include "Audio/SID.hpp"
+#include "Audio/VGM.hpp"
+#include "Console/GameCube.hpp"
+#include "Console/N64.hpp"
+#include "Handheld/Nintendo3DS.hpp"
+#include "Handheld/NintendoDS.hpp"
+#include "Audio/gbs_structs.h"
+#include "Audio/nsf_structs.h"
+#include "Audio/psf_structs.h"
+#include "Audio/sid_structs.h"
+#include "Audio/vgm_structs.h"
+#include "Console/gcn_banner.h"
+#include "Console/gcn_structs.h"
+#include "Console/n64_structs.h"
+#include "Console/wii_structs.h"
+#include "Handheld/n3ds_structs.h"
+#include "Handheld/nds_structs.h"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+/**
+ * Memory-backed file that counts the number of bytes read.
+ */
+class CountingFile : public IRpFile
+{
+	public:
+		explicit CountingFile(const vector<uint8_t> &data)
+			: m_data(data)
+			, m_pos(0)
+			, m_bytesRead(0)
+		{ }
+	protected:
+		virtual ~CountingFile() { }	// call unref() instead
+
+	private:
+		typedef IRpFile super;
+		RP_DISABLE_COPY(CountingFile)
+
+	public:
+		bool isOpen(void) const final
+		{
+			return true;
+		}
+
+		void close(void) final
+		{ }
+
+		size_t read(void *ptr, size_t size) final
+		{
+			if (m_pos >= m_data.size())
+				return 0;
+			if (size > m_data.size() - m_pos) {
+				size = m_data.size() - m_pos;
+			}
+			memcpy(ptr, &m_data[m_pos], size);
+			m_pos += size;
+			m_bytesRead += size;
+			return size;
+		}
+
+		size_t write(const void *ptr, size_t size) final
+		{
+			RP_UNUSED(ptr);
+			RP_UNUSED(size);
+			m_lastError = EBADF;
+			return 0;
+		}
+
+		int seek(off64_t pos) final
+		{
+			if (pos < 0) {
+				m_lastError = EINVAL;
+				return -1;
+			}
+			m_pos = static_cast<size_t>(pos);
+			return 0;
+		}
+
+		off64_t tell(void) final
+		{
+			return static_cast<off64_t>(m_pos);
+		}
+
+		int truncate(off64_t size = 0) final
+		{
+			RP_UNUSED(size);
+			m_lastError = ENOTSUP;
+			return -1;
+		}
+
+		off64_t size(void) final
+		{
+			return static_cast<off64_t>(m_data.size());
+		}
+
+		string filename(void) const final
+		{
+			return string();
+		}
+
+	public:
+		/**
+		 * Get the number of bytes read so far.
+		 * @return Number of bytes read.
+		 */
+		size_t bytesRead(void) const
+		{
+			return m_bytesRead;
+		}
+
+	private:
+		const vector<uint8_t> &m_data;
+		size_t m_pos;
+		size_t m_bytesRead;
+};
+
+// Padding added to the end of each image.
+// If a RomData subclass reads the whole file to get
+// the metadata, it will be well over the budget.
+static const size_t PADDING_SIZE = 4*1024*1024;
+
+// Maximum number of bytes the constructor may read.
+static const size_t CTOR_BUDGET = 64*1024;
+
+class MetaDataBudgetTest : public ::testing::Test
+{
+	protected:
+		MetaDataBudgetTest()
+			: file(nullptr)
+		{ }
+
+		void TearDown(void) override
+		{
+			if (file) {
+				file->unref();
+				file = nullptr;
+			}
+		}
+
+	public:
+		/**
+		 * Create an image with the specified header.
+		 * The image is padded with PADDING_SIZE bytes.
+		 * @param header Header data.
+		 * @param size Size of the header data.
+		 * @return Offset of the padding.
+		 */
+		size_t initImage(const void *header, size_t size)
+		{
+			const uint8_t *const p = static_cast<const uint8_t*>(header);
+			data.assign(p, p + size);
+			data.resize(size + PADDING_SIZE);
+			return size;
+		}
+
+		/**
+		 * Open the image and check the metadata read budget.
+		 * @param RomDataType RomData subclass.
+		 * @param budget Maximum number of bytes metaData() may read.
+		 * @param title Expected title, or nullptr if metadata isn't available.
+		 */
+		template<typename RomDataType>
+		void checkMetaData(size_t budget, const char *title)
+		{
+			checkMetaData([](IRpFile *f) -> RomData* {
+				return new RomDataType(f);
+			}, budget, title);
+		}
+
+		/**
+		 * Open the image and check the metadata read budget.
+		 * @param newRomData Function to create the RomData object.
+		 * @param budget Maximum number of bytes metaData() may read.
+		 * @param title Expected title, or nullptr if metadata isn't available.
+		 */
+		void checkMetaData(RomData *(*newRomData)(IRpFile*), size_t budget, const char *title)
+		{
+			ASSERT_TRUE(file == nullptr);
+			file = new CountingFile(data);
+			RomData *const romData = newRomData(file);
+			ASSERT_TRUE(romData->isValid());
+
+			const size_t ctorBytes = file->bytesRead();
+			EXPECT_LE(ctorBytes, CTOR_BUDGET) << "Constructor read too much data.";
+
+			const RomMetaData *const metaData = romData->metaData();
+			const size_t metaDataBytes = file->bytesRead() - ctorBytes;
+			EXPECT_LE(metaDataBytes, budget) << "metaData() read too much data.";
+
+			if (!title) {
+				// Metadata isn't available, e.g. due to encryption.
+				// Only the read budget is checked.
+				romData->unref();
+				return;
+			}
+
+			ASSERT_TRUE(metaData != nullptr);
+			bool foundTitle = false;
+			for (int i = 0; i < metaData->count(); i++) {
+				const RomMetaData::MetaData *const prop = metaData->prop(i);
+				if (prop->name == Property::Title) {
+					ASSERT_EQ(PropertyType::String, prop->type);
+					ASSERT_TRUE(prop->data.str != nullptr);
+					EXPECT_EQ(string(title), *prop->data.str);
+					foundTitle = true;
+				}
+			}
+			EXPECT_TRUE(foundTitle);
+
+			romData->unref();
+		}
+
+		/**
+		 * Copy a struct into the header data.
+		 * @param header Header data.
+		 * @param offset Offset.
+		 * @param src Struct.
+		 */
+		template<typename T>
+		static void putStruct(vector<uint8_t> &header, size_t offset, const T &src)
+		{
+			ASSERT_LE(offset + sizeof(src), header.size());
+			memcpy(&header[offset], &src, sizeof(src));
+		}
+
+		/**
+		 * Create an SMDH section with the specified title.
+		 * @param title Title. (ASCII)
+		 * @return SMDH section.
+		 */
+		static vector<uint8_t> makeSMDH(const char *title)
+		{
+			N3DS_SMDH_Header_t smdhHeader;
+			memset(&smdhHeader, 0, sizeof(smdhHeader));
+			smdhHeader.magic = cpu_to_be32(N3DS_SMDH_HEADER_MAGIC);
+			for (N3DS_SMDH_Title_t &smdhTitle : smdhHeader.titles) {
+				for (size_t i = 0; title[i] != '\0' && i < ARRAY_SIZE(smdhTitle.desc_long) - 1; i++) {
+					smdhTitle.desc_short[i] = cpu_to_le16(title[i]);
+					smdhTitle.desc_long[i] = cpu_to_le16(title[i]);
+				}
+			}
+
+			vector<uint8_t> smdh(sizeof(N3DS_SMDH_Header_t) + sizeof(N3DS_SMDH_Icon_t));
+			memcpy(smdh.data(), &smdhHeader, sizeof(smdhHeader));
+			return smdh;
+		}
+
+		/**
+		 * Create a CCI image with an "icon" file in the ExeFS.
+		 * @param noCrypto If true, the NCCH is unencrypted.
+		 * @param title Title. (ASCII)
+		 * @return CCI image header.
+		 */
+		static vector<uint8_t> makeCCI(bool noCrypto, const char *title)
+		{
+			// Media unit size is 512 bytes.
+			static const uint32_t ncch_offset = 0x4000;
+			static const uint32_t exefs_offset = 0x200;	// relative to the NCCH
+			const vector<uint8_t> smdh = makeSMDH(title);
+			vector<uint8_t> header(ncch_offset + exefs_offset + sizeof(N3DS_ExeFS_Header_t) + smdh.size());
+
+			N3DS_NCSD_Header_NoSig_t ncsdHeader;
+			memset(&ncsdHeader, 0, sizeof(ncsdHeader));
+			ncsdHeader.magic = cpu_to_be32(N3DS_NCSD_HEADER_MAGIC);
+			ncsdHeader.image_size = cpu_to_le32(static_cast<uint32_t>((header.size() + PADDING_SIZE) >> 9));
+			ncsdHeader.partitions[0].offset = cpu_to_le32(ncch_offset >> 9);
+			ncsdHeader.partitions[0].length = cpu_to_le32(static_cast<uint32_t>((header.size() - ncch_offset + 511) >> 9));
+			putStruct(header, N3DS_NCSD_NOSIG_HEADER_ADDRESS, ncsdHeader);
+
+			N3DS_NCCH_Header_t ncchHeader;
+			memset(&ncchHeader, 0, sizeof(ncchHeader));
+			ncchHeader.hdr.magic = cpu_to_be32(N3DS_NCCH_HEADER_MAGIC);
+			ncchHeader.hdr.content_size = ncsdHeader.partitions[0].length;
+			if (noCrypto) {
+				ncchHeader.hdr.flags[N3DS_NCCH_FLAG_BIT_MASKS] = N3DS_NCCH_BIT_MASK_NoCrypto;
+			}
+			ncchHeader.hdr.exefs_offset = cpu_to_le32(exefs_offset >> 9);
+			ncchHeader.hdr.exefs_size = cpu_to_le32(static_cast<uint32_t>(
+				(sizeof(N3DS_ExeFS_Header_t) + smdh.size() + 511) >> 9));
+			putStruct(header, ncch_offset, ncchHeader);
+
+			N3DS_ExeFS_Header_t exefsHeader;
+			memset(&exefsHeader, 0, sizeof(exefsHeader));
+			strcpy(exefsHeader.files[0].name, "icon");
+			exefsHeader.files[0].offset = cpu_to_le32(0);
+			exefsHeader.files[0].size = cpu_to_le32(static_cast<uint32_t>(smdh.size()));
+			putStruct(header, ncch_offset + exefs_offset, exefsHeader);
+
+			memcpy(&header[ncch_offset + exefs_offset + sizeof(exefsHeader)], smdh.data(), smdh.size());
+			return header;
+		}
+
+	public:
+		vector<uint8_t> data;	// Image data.
+		CountingFile *file;	// Counting file.
+};
+
+/**
+ * SID: Metadata is in the header.
+ */
+TEST_F(MetaDataBudgetTest, SID)
+{
+	SID_Header sidHeader;
+	memset(&sidHeader, 0, sizeof(sidHeader));
+	sidHeader.magic = cpu_to_be32(PSID_MAGIC);
+	sidHeader.version = cpu_to_be16(2);
+	sidHeader.dataOffset = cpu_to_be16(sizeof(sidHeader));
+	sidHeader.songs = cpu_to_be16(1);
+	sidHeader.startSong = cpu_to_be16(1);
+	strcpy(sidHeader.name, "SID Title");
+	initImage(&sidHeader, sizeof(sidHeader));
+
+	checkMetaData<SID>(0, "SID Title");
+}
+
+/**
+ * NSF: Metadata is in the header.
+ */
+TEST_F(MetaDataBudgetTest, NSF)
+{
+	NSF_Header nsfHeader;
+	memset(&nsfHeader, 0, sizeof(nsfHeader));
+	memcpy(nsfHeader.magic, NSF_MAGIC, sizeof(nsfHeader.magic));
+	nsfHeader.track_count = 1;
+	nsfHeader.default_track = 1;
+	nsfHeader.load_address = cpu_to_le16(0x8000);
+	nsfHeader.init_address = cpu_to_le16(0x8000);
+	nsfHeader.play_address = cpu_to_le16(0x8000);
+	strcpy(nsfHeader.title, "NSF Title");
+	initImage(&nsfHeader, sizeof(nsfHeader));
+
+	checkMetaData<NSF>(0, "NSF Title");
+}
+
+/**
+ * GBS: Metadata is in the header.
+ */
+TEST_F(MetaDataBudgetTest, GBS)
+{
+	GBS_Header gbsHeader;
+	memset(&gbsHeader, 0, sizeof(gbsHeader));
+	gbsHeader.magic = cpu_to_be32(GBS_MAGIC);
+	gbsHeader.track_count = 1;
+	gbsHeader.default_track = 1;
+	gbsHeader.load_address = cpu_to_le16(0x0400);
+	gbsHeader.init_address = cpu_to_le16(0x0400);
+	gbsHeader.play_address = cpu_to_le16(0x0400);
+	strcpy(gbsHeader.title, "GBS Title");
+	initImage(&gbsHeader, sizeof(gbsHeader));
+
+	checkMetaData<GBS>(0, "GBS Title");
+}
+
+/**
+ * N64: Metadata is in the header.
+ */
+TEST_F(MetaDataBudgetTest, N64)
+{
+	N64_RomHeader romHeader;
+	memset(&romHeader, 0, sizeof(romHeader));
+	romHeader.magic64 = cpu_to_be64(N64_Z64_MAGIC);
+	memset(romHeader.title, ' ', sizeof(romHeader.title));
+	memcpy(romHeader.title, "N64 TITLE", 9);
+	memcpy(romHeader.id4, "NTTE", 4);
+	initImage(&romHeader, sizeof(romHeader));
+
+	checkMetaData<N64>(0, "N64 TITLE");
+}
+
+/**
+ * VGM: Metadata is in the GD3 tag block.
+ */
+TEST_F(MetaDataBudgetTest, VGM)
+{
+	// UTF-16LE GD3 strings: Track name (EN), then 10 empty strings.
+	static const char track_name[] = "VGM Title";
+	vector<uint8_t> gd3_data;
+	for (const char *p = track_name; *p != '\0'; p++) {
+		gd3_data.push_back(static_cast<uint8_t>(*p));
+		gd3_data.push_back(0);
+	}
+	gd3_data.resize(gd3_data.size() + (11 * 2), 0);
+
+	VGM_Header vgmHeader;
+	memset(&vgmHeader, 0, sizeof(vgmHeader));
+	vgmHeader.magic = cpu_to_be32(VGM_MAGIC);
+	vgmHeader.version = cpu_to_le32(0x0171);
+	vgmHeader.gd3_offset = cpu_to_le32(sizeof(vgmHeader) - offsetof(VGM_Header, gd3_offset));
+
+	GD3_Header gd3Header;
+	gd3Header.magic = cpu_to_be32(GD3_MAGIC);
+	gd3Header.version = cpu_to_le32(0x0100);
+	gd3Header.length = cpu_to_le32(static_cast<uint32_t>(gd3_data.size()));
+
+	vector<uint8_t> header(sizeof(vgmHeader) + sizeof(gd3Header) + gd3_data.size());
+	memcpy(&header[0], &vgmHeader, sizeof(vgmHeader));
+	memcpy(&header[sizeof(vgmHeader)], &gd3Header, sizeof(gd3Header));
+	memcpy(&header[sizeof(vgmHeader) + sizeof(gd3Header)], gd3_data.data(), gd3_data.size());
+	initImage(header.data(), header.size());
+
+	// GD3 tags are limited to 16 KB.
+	checkMetaData<VGM>(sizeof(GD3_Header) + (16*1024), "VGM Title");
+}
+
+/**
+ * PSF: Metadata is in the tag section at the end of the file.
+ * The padding ends up in the tag section, so it must not be
+ * read in its entirety.
+ */
+TEST_F(MetaDataBudgetTest, PSF)
+{
+	static const char tags[] = PSF_TAG_MAGIC "title=PSF Title\n";
+
+	PSF_Header psfHeader;
+	memset(&psfHeader, 0, sizeof(psfHeader));
+	memcpy(psfHeader.magic, PSF_MAGIC, sizeof(psfHeader.magic));
+	psfHeader.version = PSF_VERSION_PLAYSTATION;
+
+	vector<uint8_t> header(sizeof(psfHeader) + sizeof(tags) - 1);
+	memcpy(&header[0], &psfHeader, sizeof(psfHeader));
+	memcpy(&header[sizeof(psfHeader)], tags, sizeof(tags) - 1);
+	initImage(header.data(), header.size());
+
+	// Tags are limited to 64 KB.
+	checkMetaData<PSF>(sizeof(PSF_TAG_MAGIC) - 1 + (64*1024), "PSF Title");
+}
+
+
+/**
+ * GameCube: Metadata is in opening.bnr.
+ * Only the boot block, FST, and opening.bnr may be read.
+ */
+TEST_F(MetaDataBudgetTest, GameCube)
+{
+	static const uint32_t fst_offset = 0x2000;
+	static const uint32_t bnr_offset = 0x3000;
+	static const char fst_strings[] = "opening.bnr";
+	static const uint32_t fst_size = (2 * sizeof(GCN_FST_Entry)) + sizeof(fst_strings);
+	vector<uint8_t> header(bnr_offset + sizeof(gcn_banner_bnr1_t));
+
+	GCN_DiscHeader discHeader;
+	memset(&discHeader, 0, sizeof(discHeader));
+	memcpy(discHeader.id6, "GTTE01", 6);
+	discHeader.magic_gcn = cpu_to_be32(GCN_MAGIC);
+	strcpy(discHeader.game_title, "GCN Disc Title");
+	putStruct(header, 0, discHeader);
+
+	GCN_Boot_Block bootBlock;
+	memset(&bootBlock, 0, sizeof(bootBlock));
+	bootBlock.dol_offset = cpu_to_be32(bnr_offset + sizeof(gcn_banner_bnr1_t));
+	bootBlock.fst_offset = cpu_to_be32(fst_offset);
+	bootBlock.fst_size = cpu_to_be32(fst_size);
+	bootBlock.fst_max_size = cpu_to_be32(fst_size);
+	putStruct(header, GCN_Boot_Block_ADDRESS, bootBlock);
+
+	GCN_Boot_Info bootInfo;
+	memset(&bootInfo, 0, sizeof(bootInfo));
+	bootInfo.region_code = cpu_to_be32(GCN_REGION_USA);
+	putStruct(header, GCN_Boot_Info_ADDRESS, bootInfo);
+
+	// FST: Root directory and "opening.bnr".
+	GCN_FST_Entry fst[2];
+	memset(fst, 0, sizeof(fst));
+	fst[0].file_type_name_offset = cpu_to_be32(0x01000000);
+	fst[0].root_dir.file_count = cpu_to_be32(2);
+	fst[1].file_type_name_offset = cpu_to_be32(0);
+	fst[1].file.offset = cpu_to_be32(bnr_offset);
+	fst[1].file.size = cpu_to_be32(sizeof(gcn_banner_bnr1_t));
+	putStruct(header, fst_offset, fst);
+	memcpy(&header[fst_offset + sizeof(fst)], fst_strings, sizeof(fst_strings));
+
+	gcn_banner_bnr1_t *const bnr = reinterpret_cast<gcn_banner_bnr1_t*>(&header[bnr_offset]);
+	bnr->magic = cpu_to_be32(GCN_BANNER_MAGIC_BNR1);
+	strcpy(bnr->comment.gamename_full, "GCN Banner Title");
+	strcpy(bnr->comment.company_full, "GCN Banner Company");
+	initImage(header.data(), header.size());
+
+	checkMetaData<GameCube>(sizeof(bootBlock) + sizeof(bootInfo) + fst_size + sizeof(gcn_banner_bnr1_t),
+		"GCN Banner Title");
+}
+
+/**
+ * Wii: Metadata is in the disc header.
+ * The encrypted game partition must not be read.
+ */
+TEST_F(MetaDataBudgetTest, Wii)
+{
+	static const uint32_t pt_offset = RVL_VolumeGroupTable_ADDRESS + sizeof(RVL_VolumeGroupTable);
+	static const uint32_t game_offset = 0x50000;
+	vector<uint8_t> header(game_offset + 0x8000);
+
+	GCN_DiscHeader discHeader;
+	memset(&discHeader, 0, sizeof(discHeader));
+	memcpy(discHeader.id6, "RTTE01", 6);
+	discHeader.magic_wii = cpu_to_be32(WII_MAGIC);
+	strcpy(discHeader.game_title, "Wii Disc Title");
+	putStruct(header, 0, discHeader);
+
+	RVL_VolumeGroupTable vgTbl;
+	memset(&vgTbl, 0, sizeof(vgTbl));
+	vgTbl.vg[0].count = cpu_to_be32(1);
+	vgTbl.vg[0].addr = cpu_to_be32(pt_offset >> 2);
+	putStruct(header, RVL_VolumeGroupTable_ADDRESS, vgTbl);
+
+	RVL_PartitionTableEntry ptEntry;
+	ptEntry.addr = cpu_to_be32(game_offset >> 2);
+	ptEntry.type = cpu_to_be32(RVL_PT_GAME);
+	putStruct(header, pt_offset, ptEntry);
+
+	RVL_RegionSetting regionSetting;
+	memset(&regionSetting, 0, sizeof(regionSetting));
+	regionSetting.region_code = cpu_to_be32(GCN_REGION_USA);
+	putStruct(header, RVL_RegionSetting_ADDRESS, regionSetting);
+
+	// Game partition: Garbage data instead of a ticket and encrypted data.
+	memset(&header[game_offset], 0xA5, header.size() - game_offset);
+	initImage(header.data(), header.size());
+
+	checkMetaData<GameCube>(0, "Wii Disc Title");
+}
+
+/**
+ * Nintendo DS: Metadata is in the header.
+ */
+TEST_F(MetaDataBudgetTest, NintendoDS)
+{
+	static const uint8_t nintendo_gba_logo[16] = {
+		0x24, 0xFF, 0xAE, 0x51, 0x69, 0x9A, 0xA2, 0x21,
+		0x3D, 0x84, 0x82, 0x0A, 0x84, 0xE4, 0x09, 0xAD
+	};
+
+	NDS_RomHeader romHeader;
+	memset(&romHeader, 0, sizeof(romHeader));
+	memcpy(romHeader.title, "NDS TITLE", 9);
+	memcpy(romHeader.id6, "NTTE01", 6);
+	memcpy(romHeader.nintendo_logo, nintendo_gba_logo, sizeof(nintendo_gba_logo));
+	romHeader.nintendo_logo_checksum = cpu_to_le16(0xCF56);
+	initImage(&romHeader, sizeof(romHeader));
+
+	checkMetaData([](IRpFile *f) -> RomData* {
+		return new NintendoDS(f, false);
+	}, 0, "NDS TITLE");
+}
+
+/**
+ * Nintendo 3DS (3DSX): Metadata is in the SMDH section.
+ */
+TEST_F(MetaDataBudgetTest, Nintendo3DS_3DSX)
+{
+	const vector<uint8_t> smdh = makeSMDH("3DSX Title");
+	static const uint32_t smdh_offset = 0x4000;
+	vector<uint8_t> header(smdh_offset + smdh.size());
+
+	N3DS_3DSX_Header_t hb3dsxHeader;
+	memset(&hb3dsxHeader, 0, sizeof(hb3dsxHeader));
+	hb3dsxHeader.magic = cpu_to_be32(N3DS_3DSX_HEADER_MAGIC);
+	hb3dsxHeader.header_size = cpu_to_le16(N3DS_3DSX_EXTENDED_HEADER_SIZE);
+	hb3dsxHeader.smdh_offset = cpu_to_le32(smdh_offset);
+	hb3dsxHeader.smdh_size = cpu_to_le32(static_cast<uint32_t>(smdh.size()));
+	putStruct(header, 0, hb3dsxHeader);
+	memcpy(&header[smdh_offset], smdh.data(), smdh.size());
+	initImage(header.data(), header.size());
+
+	checkMetaData<Nintendo3DS>(smdh.size(), "3DSX Title");
+}
+
+/**
+ * Nintendo 3DS (CCI): Metadata is in "exefs:/icon".
+ * Only the NCCH header, ExeFS header, and SMDH may be read.
+ */
+TEST_F(MetaDataBudgetTest, Nintendo3DS_CCI)
+{
+	const vector<uint8_t> header = makeCCI(true, "CCI Title");
+	initImage(header.data(), header.size());
+
+	checkMetaData<Nintendo3DS>(sizeof(N3DS_NCCH_Header_t) + sizeof(N3DS_ExeFS_Header_t) +
+		sizeof(N3DS_SMDH_Header_t) + sizeof(N3DS_SMDH_Icon_t), "CCI Title");
+}
+
+/**
+ * Nintendo 3DS (CCI): Encrypted NCCH.
+ * Metadata can't be loaded without the encryption keys, but
+ * the read budget still applies, with or without the keys.
+ */
+TEST_F(MetaDataBudgetTest, Nintendo3DS_CCI_encrypted)
+{
+	const vector<uint8_t> header = makeCCI(false, "CCI Title");
+	initImage(header.data(), header.size());
+
+	checkMetaData<Nintendo3DS>(sizeof(N3DS_NCCH_Header_t) + sizeof(N3DS_ExeFS_Header_t) +
+		sizeof(N3DS_SMDH_Header_t) + sizeof(N3DS_SMDH_Icon_t), nullptr);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: Metadata read budget tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
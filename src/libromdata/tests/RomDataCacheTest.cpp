@@ -0,0 +1,384 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * RomDataCacheTest.cpp: Persistent metadata cache test.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile, librpthreads
+#include "common.h"
+#include "librpbase/RomData.hpp"
+#include "librpbase/RomMetaData.hpp"
+#include "librpcpu/byteswap.h"
+#include "librpfile/RpFile.hpp"
+#include "librpthreads/Thread.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// libromdata
+#include "libromdata/config.libromdata.h"
+#include "RomDataCache.hpp"
+#include "Audio/SID.hpp"
+#include "Audio/sid_structs.h"
+
+// C includes.
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <memory>
+#include <string>
+#include <vector>
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+class RomDataCacheTest : public ::testing::Test
+{
+	protected:
+		RomDataCacheTest()
+			: romData(nullptr)
+		{ }
+
+		void SetUp(void) final
+		{
+			ASSERT_FALSE(tmpDir.empty()) << "Unable to create the temporary cache directory.";
+			clearCache();
+
+			// Create a SID file.
+			srcFilename = tmpDir + "/test.sid";
+			writeSID("SID Title");
+			openSID();
+		}
+
+		void TearDown(void) final
+		{
+			if (romData) {
+				romData->unref();
+			}
+			unlink(srcFilename.c_str());
+		}
+
+	public:
+		/**
+		 * Create the temporary directory and use it as the cache directory.
+		 * This must be done before the cache directory is first used.
+		 */
+		static void SetUpTestCase(void)
+		{
+			char buf[] = "/tmp/RomDataCacheTest.XXXXXX";
+			if (!mkdtemp(buf)) {
+				return;
+			}
+			tmpDir = buf;
+			setenv("XDG_CACHE_HOME", buf, 1);
+		}
+
+		/**
+		 * Delete the temporary directory.
+		 */
+		static void TearDownTestCase(void)
+		{
+			if (tmpDir.empty())
+				return;
+
+			clearCache();
+			rmdir((tmpDir + "/rom-properties/metadata").c_str());
+			rmdir((tmpDir + "/rom-properties").c_str());
+			rmdir(tmpDir.c_str());
+		}
+
+		/**
+		 * Delete all entries from the metadata cache.
+		 */
+		static void clearCache(void)
+		{
+			const string cacheDir = tmpDir + "/rom-properties/metadata/";
+			for (const string &name : listDir(cacheDir)) {
+				unlink((cacheDir + name).c_str());
+			}
+		}
+
+		/**
+		 * List the files in a directory.
+		 * @param dirName Directory name.
+		 * @return Filenames, excluding "." and "..".
+		 */
+		static vector<string> listDir(const string &dirName)
+		{
+			vector<string> names;
+			DIR *const dir = opendir(dirName.c_str());
+			if (!dir)
+				return names;
+
+			struct dirent *d;
+			while ((d = readdir(dir)) != nullptr) {
+				if (strcmp(d->d_name, ".") != 0 && strcmp(d->d_name, "..") != 0) {
+					names.emplace_back(d->d_name);
+				}
+			}
+			closedir(dir);
+			return names;
+		}
+
+		/**
+		 * Write the SID file.
+		 * @param title Title.
+		 */
+		void writeSID(const char *title)
+		{
+			SID_Header sidHeader;
+			memset(&sidHeader, 0, sizeof(sidHeader));
+			sidHeader.magic = cpu_to_be32(PSID_MAGIC);
+			sidHeader.version = cpu_to_be16(2);
+			sidHeader.dataOffset = cpu_to_be16(sizeof(sidHeader));
+			sidHeader.songs = cpu_to_be16(1);
+			sidHeader.startSong = cpu_to_be16(1);
+			strncpy(sidHeader.name, title, sizeof(sidHeader.name) - 1);
+
+			FILE *const f = fopen(srcFilename.c_str(), "wb");
+			ASSERT_TRUE(f != nullptr);
+			EXPECT_EQ(1U, fwrite(&sidHeader, sizeof(sidHeader), 1, f));
+			fclose(f);
+		}
+
+		/**
+		 * Open the SID file as a RomData object.
+		 */
+		void openSID(void)
+		{
+			if (romData) {
+				romData->unref();
+				romData = nullptr;
+			}
+			RpFile *const file = new RpFile(srcFilename, RpFile::FM_OPEN_READ);
+			ASSERT_TRUE(file->isOpen());
+			romData = new SID(file);
+			file->unref();
+			ASSERT_TRUE(romData->isValid());
+		}
+
+		/**
+		 * Get the title from a metadata cache entry.
+		 * @param entry Cache entry.
+		 * @return Title, or empty string if not found.
+		 */
+		static string getTitle(const RomDataCache::Entry *entry)
+		{
+			if (!entry || !entry->metaData)
+				return string();
+
+			const RomMetaData *const metaData = entry->metaData;
+			for (int i = 0; i < metaData->count(); i++) {
+				const RomMetaData::MetaData *const prop = metaData->prop(i);
+				if (prop->name == Property::Title && prop->type == PropertyType::String && prop->data.str) {
+					return *prop->data.str;
+				}
+			}
+			return string();
+		}
+
+	public:
+		static string tmpDir;	// Temporary directory.
+		string srcFilename;	// Source filename.
+		RomData *romData;	// RomData object.
+};
+
+string RomDataCacheTest::tmpDir;
+
+/**
+ * Store an entry and look it up.
+ */
+TEST_F(RomDataCacheTest, storeAndLookup)
+{
+	unique_ptr<RomDataCache::Entry> entry(RomDataCache::lookup(srcFilename.c_str()));
+	EXPECT_TRUE(entry == nullptr) << "Entry was found before it was stored.";
+
+	ASSERT_EQ(0, RomDataCache::store(srcFilename.c_str(), romData));
+	entry.reset(RomDataCache::lookup(srcFilename.c_str()));
+	ASSERT_TRUE(entry != nullptr);
+	ASSERT_TRUE(entry->metaData != nullptr);
+	EXPECT_EQ(romData->metaData()->count(), entry->metaData->count());
+	EXPECT_EQ("SID Title", getTitle(entry.get()));
+
+	// No temporary files should be left over.
+	const vector<string> names = listDir(tmpDir + "/rom-properties/metadata/");
+	ASSERT_EQ(1U, names.size());
+	EXPECT_EQ(".bin", names[0].substr(names[0].size() - 4));
+}
+
+/**
+ * Modifying the source file invalidates the entry.
+ */
+TEST_F(RomDataCacheTest, modifiedFile)
+{
+	ASSERT_EQ(0, RomDataCache::store(srcFilename.c_str(), romData));
+
+	// Same size, but a different title.
+	// Set an old mtime in case the file is rewritten
+	// within the file system's timestamp granularity.
+	writeSID("New Title");
+	openSID();
+	struct timespec ts[2];
+	ts[0].tv_sec = 1000000000;
+	ts[0].tv_nsec = 0;
+	ts[1] = ts[0];
+	ASSERT_EQ(0, utimensat(AT_FDCWD, srcFilename.c_str(), ts, 0));
+	unique_ptr<RomDataCache::Entry> entry(RomDataCache::lookup(srcFilename.c_str()));
+	EXPECT_TRUE(entry == nullptr) << "Entry is valid after the file was modified.";
+
+	ASSERT_EQ(0, RomDataCache::store(srcFilename.c_str(), romData));
+	entry.reset(RomDataCache::lookup(srcFilename.c_str()));
+	ASSERT_TRUE(entry != nullptr);
+	EXPECT_EQ("New Title", getTitle(entry.get()));
+}
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+/**
+ * The mtime's nanoseconds are part of the cache key.
+ */
+TEST_F(RomDataCacheTest, mtimeNanoseconds)
+{
+	struct timespec ts[2];
+	ts[0].tv_sec = 1000000000;
+	ts[0].tv_nsec = 100;
+	ts[1] = ts[0];
+	ASSERT_EQ(0, utimensat(AT_FDCWD, srcFilename.c_str(), ts, 0));
+
+	struct stat sb;
+	ASSERT_EQ(0, stat(srcFilename.c_str(), &sb));
+	if (sb.st_mtim.tv_nsec != 100) {
+		fprintf(stderr, "*** File system doesn't support nanosecond mtimes. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_EQ(0, RomDataCache::store(srcFilename.c_str(), romData));
+	unique_ptr<RomDataCache::Entry> entry(RomDataCache::lookup(srcFilename.c_str()));
+	EXPECT_TRUE(entry != nullptr);
+
+	ts[0].tv_nsec = 200;
+	ts[1] = ts[0];
+	ASSERT_EQ(0, utimensat(AT_FDCWD, srcFilename.c_str(), ts, 0));
+	entry.reset(RomDataCache::lookup(srcFilename.c_str()));
+	EXPECT_TRUE(entry == nullptr) << "Entry is valid after the mtime's nanoseconds changed.";
+}
+#endif /* HAVE_STRUCT_STAT_ST_MTIM */
+
+/**
+ * Stale temporary files left behind by a crashed process
+ * are deleted when the cache is pruned. Recent temporary
+ * files may still be in use, so they're kept.
+ */
+TEST_F(RomDataCacheTest, staleTempFiles)
+{
+	// Store an entry to create the cache directory.
+	ASSERT_EQ(0, RomDataCache::store(srcFilename.c_str(), romData));
+
+	const string cacheDir = tmpDir + "/rom-properties/metadata/";
+	const string staleTmp = cacheDir + "0123456789ABCDEF.bin.stale0";
+	const string recentTmp = cacheDir + "0123456789ABCDEF.bin.recnt0";
+	for (const string *const filename : {&staleTmp, &recentTmp}) {
+		FILE *const f = fopen(filename->c_str(), "wb");
+		ASSERT_TRUE(f != nullptr);
+		fclose(f);
+	}
+	struct timespec ts[2];
+	ts[0].tv_sec = time(nullptr) - 2*60*60;
+	ts[0].tv_nsec = 0;
+	ts[1] = ts[0];
+	ASSERT_EQ(0, utimensat(AT_FDCWD, staleTmp.c_str(), ts, 0));
+
+	// The cache is pruned at least once every 64 calls to store().
+	for (int i = 0; i < 64; i++) {
+		ASSERT_EQ(0, RomDataCache::store(srcFilename.c_str(), romData));
+	}
+
+	EXPECT_NE(0, access(staleTmp.c_str(), F_OK)) << "Stale temporary file was not deleted.";
+	EXPECT_EQ(0, access(recentTmp.c_str(), F_OK)) << "Recent temporary file was deleted.";
+	unlink(recentTmp.c_str());
+}
+
+/**
+ * Store the same entry from multiple threads at the same time.
+ * Each store() must use its own temporary file.
+ */
+TEST_F(RomDataCacheTest, concurrentStore)
+{
+	// Load the metadata first, since RomData isn't thread-safe.
+	ASSERT_TRUE(romData->metaData() != nullptr);
+
+	static const unsigned int THREAD_COUNT = 8;
+	static const unsigned int STORE_COUNT = 16;
+	struct StoreParam {
+		const char *filename;
+		const RomData *romData;
+		int ret[THREAD_COUNT];
+	} param;
+	param.filename = srcFilename.c_str();
+	param.romData = romData;
+
+	struct ThreadParam {
+		StoreParam *param;
+		unsigned int idx;
+	} threadParams[THREAD_COUNT];
+	LibRpBase::Thread threads[THREAD_COUNT];
+	for (unsigned int i = 0; i < THREAD_COUNT; i++) {
+		threadParams[i].param = &param;
+		threadParams[i].idx = i;
+		param.ret[i] = -1;
+		ASSERT_EQ(0, threads[i].start([](void *p) {
+			ThreadParam *const tp = static_cast<ThreadParam*>(p);
+			for (unsigned int j = 0; j < STORE_COUNT; j++) {
+				const int ret = RomDataCache::store(tp->param->filename, tp->param->romData);
+				if (ret != 0) {
+					tp->param->ret[tp->idx] = ret;
+					return;
+				}
+			}
+			tp->param->ret[tp->idx] = 0;
+		}, &threadParams[i]));
+	}
+	for (unsigned int i = 0; i < THREAD_COUNT; i++) {
+		threads[i].join();
+		EXPECT_EQ(0, param.ret[i]) << "Thread " << i << " failed.";
+	}
+
+	unique_ptr<RomDataCache::Entry> entry(RomDataCache::lookup(srcFilename.c_str()));
+	ASSERT_TRUE(entry != nullptr);
+	EXPECT_EQ("SID Title", getTitle(entry.get()));
+
+	// No temporary files should be left over.
+	for (const string &name : listDir(tmpDir + "/rom-properties/metadata/")) {
+		EXPECT_EQ(".bin", name.substr(name.size() - 4)) << name;
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: RomDataCache tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * Cdrom2352ReaderTest.cpp: CD-ROM 2352-byte sector reader test.           *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpfile/RpMemFile.hpp"
+using namespace LibRpFile;
+
+// libromdata
+#include "disc/Cdrom2352Reader.hpp"
+#include "cdrom_structs.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+// Number of sectors in the test image.
+// This is more than one read batch.
+static const unsigned int SECTOR_COUNT = 150;
+
+class Cdrom2352ReaderTest : public ::testing::Test
+{
+	protected:
+		Cdrom2352ReaderTest()
+			: reader(nullptr)
+		{ }
+
+		void SetUp(void) override;
+		void TearDown(void) override;
+
+	public:
+		/**
+		 * Get the expected user data byte.
+		 * @param pos Position in the user data.
+		 * @return Expected byte.
+		 */
+		static uint8_t expected(size_t pos)
+		{
+			return static_cast<uint8_t>((pos / 2048) ^ (pos * 7));
+		}
+
+	public:
+		vector<CDROM_2352_Sector_t> sectors;
+		Cdrom2352Reader *reader;
+};
+
+void Cdrom2352ReaderTest::SetUp(void)
+{
+	static const uint8_t sync[12] =
+		{0x00,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00};
+
+	// Every third sector is Mode 2 Form 1.
+	// The rest are Mode 1.
+	sectors.resize(SECTOR_COUNT);
+	for (unsigned int i = 0; i < SECTOR_COUNT; i++) {
+		CDROM_2352_Sector_t *const sector = &sectors[i];
+		memset(sector, 0xAA, sizeof(*sector));
+		memcpy(sector->sync, sync, sizeof(sync));
+
+		uint8_t *data;
+		if (i % 3 == 2) {
+			sector->mode = 2;
+			memset(sector->m2xa_f1.sub, 0, sizeof(sector->m2xa_f1.sub));
+			data = sector->m2xa_f1.data;
+		} else {
+			sector->mode = 1;
+			data = sector->m1.data;
+		}
+		for (unsigned int j = 0; j < 2048; j++) {
+			data[j] = expected((i * 2048) + j);
+		}
+	}
+
+	RpMemFile *const memFile = new RpMemFile(sectors.data(), sectors.size() * sizeof(CDROM_2352_Sector_t));
+	reader = new Cdrom2352Reader(memFile);
+	memFile->unref();
+	ASSERT_TRUE(reader->isOpen());
+	ASSERT_EQ(static_cast<off64_t>(SECTOR_COUNT) * 2048, reader->size());
+}
+
+void Cdrom2352ReaderTest::TearDown(void)
+{
+	delete reader;
+	reader = nullptr;
+}
+
+/**
+ * Read the entire disc with a single read request.
+ */
+TEST_F(Cdrom2352ReaderTest, readAll)
+{
+	vector<uint8_t> buf(SECTOR_COUNT * 2048);
+	ASSERT_EQ(buf.size(), reader->seekAndRead(0, buf.data(), buf.size()));
+	for (size_t i = 0; i < buf.size(); i++) {
+		ASSERT_EQ(expected(i), buf[i]) << "pos == " << i;
+	}
+}
+
+/**
+ * Read unaligned ranges, including partial blocks.
+ */
+TEST_F(Cdrom2352ReaderTest, readUnaligned)
+{
+	static const struct {
+		size_t pos;
+		size_t size;
+	} ranges[] = {
+		{0, 1},
+		{100, 2048},
+		{(2*2048) + 5, 2000},
+		{(2*2048) - 10, (70*2048) + 30},
+		{(SECTOR_COUNT-1) * 2048, 2048},
+	};
+
+	for (const auto &range : ranges) {
+		vector<uint8_t> buf(range.size);
+		ASSERT_EQ(buf.size(), reader->seekAndRead(range.pos, buf.data(), buf.size()));
+		for (size_t i = 0; i < buf.size(); i++) {
+			ASSERT_EQ(expected(range.pos + i), buf[i]) << "pos == " << (range.pos + i);
+		}
+	}
+}
+
+/**
+ * Read past the end of the disc.
+ */
+TEST_F(Cdrom2352ReaderTest, readPastEnd)
+{
+	vector<uint8_t> buf(4096);
+	const size_t pos = (SECTOR_COUNT * 2048) - 1024;
+	ASSERT_EQ(1024U, reader->seekAndRead(pos, buf.data(), buf.size()));
+	for (size_t i = 0; i < 1024; i++) {
+		ASSERT_EQ(expected(pos + i), buf[i]) << "pos == " << (pos + i);
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: Cdrom2352Reader tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
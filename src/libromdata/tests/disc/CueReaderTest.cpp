@@ -0,0 +1,452 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * CueReaderTest.cpp: CUE+BIN disc image reader test.                      *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpfile/FileSystem.hpp"
+#include "librpfile/RpFile.hpp"
+using namespace LibRpFile;
+
+// libromdata
+#include "disc/CueReader.hpp"
+#include "cdrom_structs.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+class CueReaderTest : public ::testing::Test
+{
+	protected:
+		CueReaderTest() = default;
+
+		void TearDown(void) override;
+
+	public:
+		/**
+		 * Get the expected user data byte.
+		 * @param seed Track-specific seed.
+		 * @param pos Position in the user data.
+		 * @return Expected byte.
+		 */
+		static uint8_t expected(unsigned int seed, size_t pos)
+		{
+			return static_cast<uint8_t>((pos / 2048) ^ (pos * 7) ^ seed);
+		}
+
+		/**
+		 * Write a file for this test.
+		 * The file will be deleted in TearDown().
+		 * @param filename Filename.
+		 * @param data Data.
+		 * @param size Size of data.
+		 */
+		void writeFile(const char *filename, const void *data, size_t size);
+
+		/**
+		 * Write a cue sheet for this test.
+		 * @param filename Filename.
+		 * @param cue Cue sheet text.
+		 */
+		void writeCueSheet(const char *filename, const char *cue)
+		{
+			writeFile(filename, cue, strlen(cue));
+		}
+
+		/**
+		 * Write a track file with 2352-byte sectors.
+		 * Every third sector is Mode 2 Form 1; the rest are Mode 1.
+		 * @param filename Filename.
+		 * @param seed Track-specific seed.
+		 * @param count Number of sectors.
+		 */
+		void writeTrack2352(const char *filename, unsigned int seed, unsigned int count);
+
+		/**
+		 * Write a track file with 2048-byte sectors.
+		 * @param filename Filename.
+		 * @param seed Track-specific seed.
+		 * @param count Number of sectors.
+		 */
+		void writeTrack2048(const char *filename, unsigned int seed, unsigned int count);
+
+		/**
+		 * Verify data read from a track.
+		 * @param buf Data.
+		 * @param size Size of data.
+		 * @param seed Track-specific seed.
+		 * @param pos Starting position within the track.
+		 */
+		static void verifyData(const uint8_t *buf, size_t size, unsigned int seed, size_t pos);
+
+	public:
+		vector<string> filenames;
+};
+
+void CueReaderTest::TearDown(void)
+{
+	for (const string &filename : filenames) {
+		FileSystem::delete_file(filename);
+	}
+	filenames.clear();
+}
+
+/**
+ * Write a file for this test.
+ * The file will be deleted in TearDown().
+ * @param filename Filename.
+ * @param data Data.
+ * @param size Size of data.
+ */
+void CueReaderTest::writeFile(const char *filename, const void *data, size_t size)
+{
+	filenames.emplace_back(filename);
+	RpFile *const file = new RpFile(filename, RpFile::FM_CREATE_WRITE);
+	ASSERT_TRUE(file->isOpen());
+	ASSERT_EQ(size, file->write(data, size));
+	file->unref();
+}
+
+/**
+ * Write a track file with 2352-byte sectors.
+ * Every third sector is Mode 2 Form 1; the rest are Mode 1.
+ * @param filename Filename.
+ * @param seed Track-specific seed.
+ * @param count Number of sectors.
+ */
+void CueReaderTest::writeTrack2352(const char *filename, unsigned int seed, unsigned int count)
+{
+	static const uint8_t sync[12] =
+		{0x00,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x00};
+
+	vector<CDROM_2352_Sector_t> sectors(count);
+	for (unsigned int i = 0; i < count; i++) {
+		CDROM_2352_Sector_t *const sector = &sectors[i];
+		memset(sector, 0xAA, sizeof(*sector));
+		memcpy(sector->sync, sync, sizeof(sync));
+
+		uint8_t *data;
+		if (i % 3 == 2) {
+			sector->mode = 2;
+			memset(sector->m2xa_f1.sub, 0, sizeof(sector->m2xa_f1.sub));
+			data = sector->m2xa_f1.data;
+		} else {
+			sector->mode = 1;
+			data = sector->m1.data;
+		}
+		for (unsigned int j = 0; j < 2048; j++) {
+			data[j] = expected(seed, (i * 2048) + j);
+		}
+	}
+
+	writeFile(filename, sectors.data(), sectors.size() * sizeof(CDROM_2352_Sector_t));
+}
+
+/**
+ * Write a track file with 2048-byte sectors.
+ * @param filename Filename.
+ * @param seed Track-specific seed.
+ * @param count Number of sectors.
+ */
+void CueReaderTest::writeTrack2048(const char *filename, unsigned int seed, unsigned int count)
+{
+	vector<uint8_t> data(count * 2048);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = expected(seed, i);
+	}
+	writeFile(filename, data.data(), data.size());
+}
+
+/**
+ * Verify data read from a track.
+ * @param buf Data.
+ * @param size Size of data.
+ * @param seed Track-specific seed.
+ * @param pos Starting position within the track.
+ */
+void CueReaderTest::verifyData(const uint8_t *buf, size_t size, unsigned int seed, size_t pos)
+{
+	for (size_t i = 0; i < size; i++) {
+		ASSERT_EQ(expected(seed, pos + i), buf[i]) << "pos == " << (pos + i);
+	}
+}
+
+/**
+ * Check cue sheet detection.
+ */
+TEST_F(CueReaderTest, isDiscSupported)
+{
+	static const char *const good[] = {
+		"FILE \"game.bin\" BINARY\r\n  TRACK 01 MODE1/2352\r\n    INDEX 01 00:00:00\r\n",
+		"\xEF\xBB\xBFREM GENRE Game\nTITLE \"Game\"\nFILE game.bin BINARY\nTRACK 01 MODE2/2352\n",
+		"\n\nfile \"game.iso\" binary\n\ttrack 01 mode1/2048\n",
+	};
+	static const char *const bad[] = {
+		"TRACK 01 MODE1/2352\nFILE \"game.bin\" BINARY\n",
+		"FILE \"game.bin\" BINARY\n",
+		"3\n1 0 4 2352 track01.bin 0\n",
+		"SEGA SEGASATURN \n",
+	};
+
+	for (const char *const cue : good) {
+		EXPECT_EQ(0, CueReader::isDiscSupported_static(
+			reinterpret_cast<const uint8_t*>(cue), strlen(cue))) << cue;
+	}
+	for (const char *const cue : bad) {
+		EXPECT_EQ(-1, CueReader::isDiscSupported_static(
+			reinterpret_cast<const uint8_t*>(cue), strlen(cue))) << cue;
+	}
+}
+
+/**
+ * Read a disc image with multiple FILE entries.
+ */
+TEST_F(CueReaderTest, multipleFiles)
+{
+	writeTrack2352("CueReaderTest_multi_01.bin", 0x11, 100);
+	vector<uint8_t> audio(300 * 2352, 0x55);
+	writeFile("CueReaderTest_multi_02.bin", audio.data(), audio.size());
+	writeTrack2048("CueReaderTest_multi_03.iso", 0x33, 50);
+	writeCueSheet("CueReaderTest_multi.cue",
+		"REM Multiple files\n"
+		"FILE \"CueReaderTest_multi_01.bin\" BINARY\n"
+		"  TRACK 01 MODE1/2352\n"
+		"    INDEX 01 00:00:00\n"
+		"FILE \"CueReaderTest_multi_02.bin\" MOTOROLA\n"
+		"  TRACK 02 AUDIO\n"
+		"    INDEX 00 00:00:00\n"
+		"    INDEX 01 00:02:00\n"
+		"FILE \"CueReaderTest_multi_03.iso\" BINARY\n"
+		"  TRACK 03 MODE1/2048\n"
+		"    INDEX 01 00:00:00\n");
+
+	RpFile *const cueFile = new RpFile("CueReaderTest_multi.cue", RpFile::FM_OPEN_READ);
+	ASSERT_TRUE(cueFile->isOpen());
+	EXPECT_TRUE(CueReader::isCueSheet(cueFile));
+	CueReader *const reader = new CueReader(cueFile);
+	cueFile->unref();
+	ASSERT_TRUE(reader->isOpen());
+
+	// Track 03 starts after the first two files.
+	EXPECT_EQ(3, reader->trackCount());
+	EXPECT_EQ(1, reader->firstDataTrack());
+	EXPECT_EQ(0, reader->startingLBA(1));
+	EXPECT_EQ(250, reader->startingLBA(2));
+	EXPECT_EQ(400, reader->startingLBA(3));
+	EXPECT_EQ(450LL * 2048, reader->size());
+
+	// Track 01: Read across sector and batch boundaries.
+	vector<uint8_t> buf(100 * 2048);
+	ASSERT_EQ(buf.size(), reader->seekAndRead(0, buf.data(), buf.size()));
+	verifyData(buf.data(), buf.size(), 0x11, 0);
+	ASSERT_EQ(3000U, reader->seekAndRead(1000, buf.data(), 3000));
+	verifyData(buf.data(), 3000, 0x11, 1000);
+
+	// Track 03
+	ASSERT_EQ(50U * 2048, reader->seekAndRead(400 * 2048, buf.data(), 50 * 2048));
+	verifyData(buf.data(), 50 * 2048, 0x33, 0);
+
+	// Track 02 is an audio track, so it can't be read.
+	EXPECT_EQ(0U, reader->seekAndRead(250 * 2048, buf.data(), 2048));
+
+	// Data tracks can be opened as files; audio tracks can't.
+	IRpFile *const trackFile = reader->openTrackFile(3);
+	ASSERT_TRUE(trackFile != nullptr);
+	EXPECT_EQ(50LL * 2048, trackFile->size());
+	ASSERT_EQ(2048U, trackFile->seekAndRead(2048, buf.data(), 2048));
+	verifyData(buf.data(), 2048, 0x33, 2048);
+	trackFile->unref();
+	EXPECT_TRUE(reader->openTrackFile(2) == nullptr);
+
+	reader->unref();
+}
+
+/**
+ * Read a disc image with multiple tracks in a single FILE,
+ * including a PREGAP that isn't stored in the file.
+ */
+TEST_F(CueReaderTest, singleFilePregap)
+{
+	writeTrack2352("CueReaderTest_single.bin", 0x22, 100);
+	writeCueSheet("CueReaderTest_single.cue",
+		"FILE \"CueReaderTest_single.bin\" BINARY\r\n"
+		"  TRACK 01 MODE2/2352\r\n"
+		"    INDEX 01 00:00:00\r\n"
+		"  TRACK 02 MODE1/2352\r\n"
+		"    PREGAP 00:02:00\r\n"
+		"    INDEX 01 00:01:00\r\n");
+
+	RpFile *const cueFile = new RpFile("CueReaderTest_single.cue", RpFile::FM_OPEN_READ);
+	ASSERT_TRUE(cueFile->isOpen());
+	CueReader *const reader = new CueReader(cueFile);
+	cueFile->unref();
+	ASSERT_TRUE(reader->isOpen());
+
+	// Track 02 starts at frame 75 in the file,
+	// plus 150 frames of PREGAP.
+	EXPECT_EQ(2, reader->trackCount());
+	EXPECT_EQ(0, reader->startingLBA(1));
+	EXPECT_EQ(225, reader->startingLBA(2));
+	EXPECT_EQ(250LL * 2048, reader->size());
+
+	vector<uint8_t> buf(25 * 2048);
+	ASSERT_EQ(buf.size(), reader->seekAndRead(225 * 2048, buf.data(), buf.size()));
+	verifyData(buf.data(), buf.size(), 0x22, 75 * 2048);
+	ASSERT_EQ(100U, reader->seekAndRead((74 * 2048) + 100, buf.data(), 100));
+	verifyData(buf.data(), 100, 0x22, (74 * 2048) + 100);
+
+	reader->unref();
+}
+
+/**
+ * Track files keep their CueReader alive.
+ */
+TEST_F(CueReaderTest, trackFileRef)
+{
+	writeTrack2352("CueReaderTest_ref.bin", 0x55, 20);
+	writeCueSheet("CueReaderTest_ref.cue",
+		"FILE \"CueReaderTest_ref.bin\" BINARY\n"
+		"  TRACK 01 MODE1/2352\n"
+		"    INDEX 01 00:00:00\n");
+
+	RpFile *const cueFile = new RpFile("CueReaderTest_ref.cue", RpFile::FM_OPEN_READ);
+	ASSERT_TRUE(cueFile->isOpen());
+
+	// The CueReader is unref()'d before the track file is read.
+	CueReader *const reader = new CueReader(cueFile);
+	IRpFile *trackFile = reader->openTrackFile(1);
+	reader->unref();
+	ASSERT_TRUE(trackFile != nullptr);
+	vector<uint8_t> buf(20 * 2048);
+	ASSERT_EQ(buf.size(), trackFile->seekAndRead(0, buf.data(), buf.size()));
+	verifyData(buf.data(), buf.size(), 0x55, 0);
+	trackFile->unref();
+
+	// openFirstDataTrack() doesn't return the CueReader at all.
+	trackFile = CueReader::openFirstDataTrack(cueFile);
+	cueFile->unref();
+	ASSERT_TRUE(trackFile != nullptr);
+	EXPECT_EQ(static_cast<off64_t>(buf.size()), trackFile->size());
+	ASSERT_EQ(buf.size(), trackFile->seekAndRead(0, buf.data(), buf.size()));
+	verifyData(buf.data(), buf.size(), 0x55, 0);
+	trackFile->unref();
+}
+
+/**
+ * The original track files are opened for hashing,
+ * including audio tracks and files that weren't loaded yet.
+ */
+TEST_F(CueReaderTest, openImageFiles)
+{
+	writeTrack2352("CueReaderTest_image_01.bin", 0x66, 20);
+	vector<uint8_t> audio(30 * 2352, 0x77);
+	writeFile("CueReaderTest_image_02.wav", audio.data(), audio.size());
+	writeCueSheet("CueReaderTest_image.cue",
+		"FILE \"CueReaderTest_image_01.bin\" BINARY\n"
+		"  TRACK 01 MODE1/2352\n"
+		"    INDEX 01 00:00:00\n"
+		"FILE \"CueReaderTest_image_02.wav\" WAVE\n"
+		"  TRACK 02 AUDIO\n"
+		"    INDEX 01 00:00:00\n");
+
+	RpFile *const cueFile = new RpFile("CueReaderTest_image.cue", RpFile::FM_OPEN_READ);
+	ASSERT_TRUE(cueFile->isOpen());
+	CueReader *const reader = new CueReader(cueFile);
+	cueFile->unref();
+	ASSERT_TRUE(reader->isOpen());
+
+	vector<IRpFile*> files;
+	ASSERT_EQ(0, reader->openImageFiles(files));
+	ASSERT_EQ(2U, files.size());
+	EXPECT_EQ(20LL * 2352, files[0]->size());
+	EXPECT_EQ(static_cast<off64_t>(audio.size()), files[1]->size());
+	for (IRpFile *file : files) {
+		file->unref();
+	}
+
+	// A missing track file is an error.
+	FileSystem::delete_file("CueReaderTest_image_02.wav");
+	files.clear();
+	EXPECT_EQ(-ENOENT, reader->openImageFiles(files));
+	EXPECT_TRUE(files.empty());
+
+	reader->unref();
+}
+
+/**
+ * Invalid cue sheets.
+ */
+TEST_F(CueReaderTest, invalid)
+{
+	writeTrack2048("CueReaderTest_invalid.iso", 0x44, 4);
+
+	static const char *const cues[] = {
+		// Unsupported track mode.
+		"FILE \"CueReaderTest_invalid.iso\" BINARY\n"
+		"  TRACK 01 MODE3/2048\n"
+		"    INDEX 01 00:00:00\n",
+
+		// Missing INDEX 01.
+		"FILE \"CueReaderTest_invalid.iso\" BINARY\n"
+		"  TRACK 01 MODE1/2048\n"
+		"    INDEX 00 00:00:00\n",
+
+		// Missing file.
+		"FILE \"CueReaderTest_missing.iso\" BINARY\n"
+		"  TRACK 01 MODE1/2048\n"
+		"    INDEX 01 00:00:00\n"
+		"FILE \"CueReaderTest_invalid.iso\" BINARY\n"
+		"  TRACK 02 AUDIO\n"
+		"    INDEX 01 00:00:00\n",
+
+		// Tracks out of order.
+		"FILE \"CueReaderTest_invalid.iso\" BINARY\n"
+		"  TRACK 02 MODE1/2048\n"
+		"    INDEX 01 00:00:00\n"
+		"  TRACK 01 MODE1/2048\n"
+		"    INDEX 01 00:00:02\n",
+	};
+
+	for (const char *const cue : cues) {
+		writeCueSheet("CueReaderTest_invalid.cue", cue);
+		RpFile *const cueFile = new RpFile("CueReaderTest_invalid.cue", RpFile::FM_OPEN_READ);
+		ASSERT_TRUE(cueFile->isOpen());
+		CueReader *const reader = new CueReader(cueFile);
+		EXPECT_FALSE(reader->isOpen()) << cue;
+		reader->unref();
+		EXPECT_TRUE(CueReader::openFirstDataTrack(cueFile) == nullptr) << cue;
+		cueFile->unref();
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: CueReader tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
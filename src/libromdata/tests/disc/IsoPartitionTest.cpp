@@ -0,0 +1,394 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * IsoPartitionTest.cpp: ISO-9660 partition reader test.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpbase/disc/DiscReader.hpp"
+#include "librpcpu/byteswap.h"
+#include "librpfile/RpMemFile.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// libromdata
+#include "disc/IsoPartition.hpp"
+#include "iso_structs.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+// Block size.
+static const unsigned int BLOCK_SIZE = ISO_SECTOR_SIZE_MODE1_COOKED;
+
+// Block addresses.
+enum {
+	LBA_PVD			= ISO_PVD_LBA,
+	LBA_JOLIET_SVD		= ISO_PVD_LBA + 1,
+	LBA_TERMINATOR		= ISO_PVD_LBA + 2,
+
+	LBA_PRI_ROOT		= 20,	// 2 blocks
+	LBA_PRI_SUBDIR		= 22,
+	LBA_PRI_DEEP		= 23,
+	LBA_JOLIET_ROOT		= 24,
+	LBA_JOLIET_SUBDIR	= 25,
+
+	LBA_SYSTEM_CNF		= 30,
+	LBA_BOOT_BIN		= 31,
+	LBA_SECOND_TXT		= 32,
+	LBA_LONG_NAME		= 33,
+
+	LBA_COUNT		= 34
+};
+
+// File contents.
+static const char system_cnf_data[] = "BOOT = cdrom:\\SUBDIR\\DEEP\\BOOT.BIN;1\r\n";
+static const char boot_bin_data[] = "boot executable";
+static const char second_txt_data[] = "second block";
+static const char long_name_data[] = "Joliet only";
+
+class IsoPartitionTest : public ::testing::Test
+{
+	protected:
+		IsoPartitionTest()
+			: discReader(nullptr)
+			, isoPartition(nullptr)
+		{ }
+
+		void SetUp(void) override;
+		void TearDown(void) override;
+
+	public:
+		/**
+		 * Get a pointer to a block in the image.
+		 * @param lba Block address.
+		 * @return Pointer to the block.
+		 */
+		uint8_t *block(unsigned int lba)
+		{
+			return &data[lba * BLOCK_SIZE];
+		}
+
+		/**
+		 * Append a directory entry.
+		 * @param dir Directory data.
+		 * @param lba Block address.
+		 * @param size Size.
+		 * @param flags Flags.
+		 * @param name Filename.
+		 * @param name_len Length of filename.
+		 */
+		static void addDirEntry(vector<uint8_t> &dir, uint32_t lba, uint32_t size,
+			uint8_t flags, const char *name, uint8_t name_len);
+
+		/**
+		 * Append a directory entry with an ASCII filename.
+		 * @param dir Directory data.
+		 * @param lba Block address.
+		 * @param size Size.
+		 * @param flags Flags.
+		 * @param name Filename. (ASCII)
+		 */
+		static void addDirEntry(vector<uint8_t> &dir, uint32_t lba, uint32_t size,
+			uint8_t flags, const char *name)
+		{
+			addDirEntry(dir, lba, size, flags, name, static_cast<uint8_t>(strlen(name)));
+		}
+
+		/**
+		 * Append a directory entry with a Joliet filename.
+		 * @param dir Directory data.
+		 * @param lba Block address.
+		 * @param size Size.
+		 * @param flags Flags.
+		 * @param name Filename. (ASCII; converted to UCS-2 BE)
+		 */
+		static void addJolietDirEntry(vector<uint8_t> &dir, uint32_t lba, uint32_t size,
+			uint8_t flags, const char *name)
+		{
+			string u16_name;
+			for (; *name != '\0'; name++) {
+				u16_name += '\0';
+				u16_name += *name;
+			}
+			addDirEntry(dir, lba, size, flags, u16_name.data(), static_cast<uint8_t>(u16_name.size()));
+		}
+
+		/**
+		 * Initialize a directory's "." and ".." entries.
+		 * @param dir Directory data.
+		 * @param lba This directory's block address.
+		 * @param parent_lba Parent directory's block address.
+		 */
+		static void initDir(vector<uint8_t> &dir, uint32_t lba, uint32_t parent_lba)
+		{
+			dir.clear();
+			addDirEntry(dir, lba, BLOCK_SIZE, ISO_FLAG_DIRECTORY, "\x00", 1);
+			addDirEntry(dir, parent_lba, BLOCK_SIZE, ISO_FLAG_DIRECTORY, "\x01", 1);
+		}
+
+		/**
+		 * Initialize a volume descriptor.
+		 * @param lba Block address.
+		 * @param type Volume descriptor type.
+		 * @param root_lba Root directory block address.
+		 * @param root_size Root directory size.
+		 * @return Volume descriptor.
+		 */
+		ISO_Primary_Volume_Descriptor *initVD(unsigned int lba, uint8_t type,
+			uint32_t root_lba, uint32_t root_size);
+
+		/**
+		 * Read a file from the ISO partition.
+		 * @param filename Filename.
+		 * @return File contents, or "(null)" if the file couldn't be opened.
+		 */
+		string readFile(const char *filename);
+
+	public:
+		vector<uint8_t> data;
+		IDiscReader *discReader;
+		IsoPartition *isoPartition;
+};
+
+/**
+ * Append a directory entry.
+ * @param dir Directory data.
+ * @param lba Block address.
+ * @param size Size.
+ * @param flags Flags.
+ * @param name Filename.
+ * @param name_len Length of filename.
+ */
+void IsoPartitionTest::addDirEntry(vector<uint8_t> &dir, uint32_t lba, uint32_t size,
+	uint8_t flags, const char *name, uint8_t name_len)
+{
+	ISO_DirEntry dirEntry;
+	memset(&dirEntry, 0, sizeof(dirEntry));
+	// Directory entries must have an even length.
+	dirEntry.entry_length = static_cast<uint8_t>((sizeof(dirEntry) + name_len + 1) & ~1);
+	dirEntry.block.le = cpu_to_le32(lba);
+	dirEntry.block.be = cpu_to_be32(lba);
+	dirEntry.size.le = cpu_to_le32(size);
+	dirEntry.size.be = cpu_to_be32(size);
+	dirEntry.flags = flags;
+	dirEntry.filename_length = name_len;
+
+	const size_t pos = dir.size();
+	dir.resize(pos + dirEntry.entry_length);
+	memcpy(&dir[pos], &dirEntry, sizeof(dirEntry));
+	memcpy(&dir[pos + sizeof(dirEntry)], name, name_len);
+}
+
+/**
+ * Initialize a volume descriptor.
+ * @param lba Block address.
+ * @param type Volume descriptor type.
+ * @param root_lba Root directory block address.
+ * @param root_size Root directory size.
+ * @return Volume descriptor.
+ */
+ISO_Primary_Volume_Descriptor *IsoPartitionTest::initVD(unsigned int lba, uint8_t type,
+	uint32_t root_lba, uint32_t root_size)
+{
+	ISO_Primary_Volume_Descriptor *const vd =
+		reinterpret_cast<ISO_Primary_Volume_Descriptor*>(block(lba));
+	vd->header.type = type;
+	memcpy(vd->header.identifier, ISO_VD_MAGIC, sizeof(vd->header.identifier));
+	vd->header.version = ISO_VD_VERSION;
+	vd->logical_block_size.le = cpu_to_le16(BLOCK_SIZE);
+	vd->logical_block_size.be = cpu_to_be16(BLOCK_SIZE);
+
+	ISO_DirEntry *const root = &vd->dir_entry_root;
+	root->entry_length = sizeof(*root) + 1;
+	root->block.le = cpu_to_le32(root_lba);
+	root->block.be = cpu_to_be32(root_lba);
+	root->size.le = cpu_to_le32(root_size);
+	root->size.be = cpu_to_be32(root_size);
+	root->flags = ISO_FLAG_DIRECTORY;
+	root->filename_length = 1;
+	return vd;
+}
+
+void IsoPartitionTest::SetUp(void)
+{
+	data.assign(LBA_COUNT * BLOCK_SIZE, 0);
+
+	// Volume descriptors.
+	initVD(LBA_PVD, ISO_VDT_PRIMARY, LBA_PRI_ROOT, BLOCK_SIZE * 2);
+	ISO_Primary_Volume_Descriptor *const svd =
+		initVD(LBA_JOLIET_SVD, ISO_VDT_SUPPLEMENTARY, LBA_JOLIET_ROOT, BLOCK_SIZE);
+	memcpy(svd->reserved3, ISO_JOLIET_ESCAPE_LEVEL3, 3);
+	ISO_Volume_Descriptor_Header *const term =
+		reinterpret_cast<ISO_Volume_Descriptor_Header*>(block(LBA_TERMINATOR));
+	term->type = ISO_VDT_TERMINATOR;
+	memcpy(term->identifier, ISO_VD_MAGIC, sizeof(term->identifier));
+	term->version = ISO_VD_VERSION;
+
+	// Primary root directory.
+	// The second block has an entry, and the rest of
+	// the first block is padding.
+	vector<uint8_t> dir;
+	initDir(dir, LBA_PRI_ROOT, LBA_PRI_ROOT);
+	addDirEntry(dir, LBA_PRI_SUBDIR, BLOCK_SIZE, ISO_FLAG_DIRECTORY, "SUBDIR");
+	addDirEntry(dir, LBA_SYSTEM_CNF, sizeof(system_cnf_data)-1, 0, "SYSTEM.CNF;1");
+	memcpy(block(LBA_PRI_ROOT), dir.data(), dir.size());
+	dir.clear();
+	addDirEntry(dir, LBA_SECOND_TXT, sizeof(second_txt_data)-1, 0, "SECOND.TXT;1");
+	memcpy(block(LBA_PRI_ROOT + 1), dir.data(), dir.size());
+
+	// Primary subdirectories.
+	initDir(dir, LBA_PRI_SUBDIR, LBA_PRI_ROOT);
+	addDirEntry(dir, LBA_PRI_DEEP, BLOCK_SIZE, ISO_FLAG_DIRECTORY, "DEEP");
+	memcpy(block(LBA_PRI_SUBDIR), dir.data(), dir.size());
+	initDir(dir, LBA_PRI_DEEP, LBA_PRI_SUBDIR);
+	addDirEntry(dir, LBA_BOOT_BIN, sizeof(boot_bin_data)-1, 0, "BOOT.BIN;1");
+	memcpy(block(LBA_PRI_DEEP), dir.data(), dir.size());
+
+	// Joliet root directory.
+	initDir(dir, LBA_JOLIET_ROOT, LBA_JOLIET_ROOT);
+	addJolietDirEntry(dir, LBA_JOLIET_SUBDIR, BLOCK_SIZE, ISO_FLAG_DIRECTORY, "Long Directory Name");
+	addJolietDirEntry(dir, LBA_SYSTEM_CNF, sizeof(system_cnf_data)-1, 0, "SYSTEM.CNF;1");
+	memcpy(block(LBA_JOLIET_ROOT), dir.data(), dir.size());
+
+	// Joliet subdirectory.
+	initDir(dir, LBA_JOLIET_SUBDIR, LBA_JOLIET_ROOT);
+	addJolietDirEntry(dir, LBA_LONG_NAME, sizeof(long_name_data)-1, 0, "Long File Name.txt;1");
+	memcpy(block(LBA_JOLIET_SUBDIR), dir.data(), dir.size());
+
+	// File contents.
+	memcpy(block(LBA_SYSTEM_CNF), system_cnf_data, sizeof(system_cnf_data)-1);
+	memcpy(block(LBA_BOOT_BIN), boot_bin_data, sizeof(boot_bin_data)-1);
+	memcpy(block(LBA_SECOND_TXT), second_txt_data, sizeof(second_txt_data)-1);
+	memcpy(block(LBA_LONG_NAME), long_name_data, sizeof(long_name_data)-1);
+
+	RpMemFile *const memFile = new RpMemFile(data.data(), data.size());
+	discReader = new DiscReader(memFile);
+	memFile->unref();
+	isoPartition = new IsoPartition(discReader, 0, 0);
+	ASSERT_TRUE(isoPartition->isOpen());
+}
+
+void IsoPartitionTest::TearDown(void)
+{
+	delete isoPartition;
+	isoPartition = nullptr;
+	delete discReader;
+	discReader = nullptr;
+}
+
+/**
+ * Read a file from the ISO partition.
+ * @param filename Filename.
+ * @return File contents, or "(null)" if the file couldn't be opened.
+ */
+string IsoPartitionTest::readFile(const char *filename)
+{
+	IRpFile *const file = isoPartition->open(filename);
+	if (!file) {
+		return "(null)";
+	}
+
+	string buf(static_cast<size_t>(file->size()), '\0');
+	const size_t size = file->read(&buf[0], buf.size());
+	file->unref();
+	if (size != buf.size()) {
+		return "(read error)";
+	}
+	return buf;
+}
+
+/**
+ * Open files in the root directory.
+ * Filenames are case-insensitive, and the ";1" suffix is optional.
+ */
+TEST_F(IsoPartitionTest, rootDirectory)
+{
+	EXPECT_EQ(system_cnf_data, readFile("SYSTEM.CNF"));
+	EXPECT_EQ(system_cnf_data, readFile("/system.cnf"));
+	EXPECT_EQ(system_cnf_data, readFile("SYSTEM.CNF;1"));
+
+	// This file is in the second block of the root directory.
+	EXPECT_EQ(second_txt_data, readFile("/SECOND.TXT"));
+}
+
+/**
+ * Open files in subdirectories.
+ */
+TEST_F(IsoPartitionTest, subdirectories)
+{
+	EXPECT_EQ(boot_bin_data, readFile("/SUBDIR/DEEP/BOOT.BIN"));
+	EXPECT_EQ(boot_bin_data, readFile("subdir/deep/boot.bin;1"));
+	EXPECT_EQ(boot_bin_data, readFile("//SUBDIR//DEEP/BOOT.BIN"));
+}
+
+/**
+ * Open files that only have Joliet filenames.
+ */
+TEST_F(IsoPartitionTest, joliet)
+{
+	EXPECT_EQ(long_name_data, readFile("/Long Directory Name/Long File Name.txt"));
+	EXPECT_EQ(long_name_data, readFile("/LONG DIRECTORY NAME/long file name.TXT"));
+}
+
+/**
+ * Files that can't be opened.
+ */
+TEST_F(IsoPartitionTest, notFound)
+{
+	EXPECT_EQ("(null)", readFile("/NOTFOUND.BIN"));
+	EXPECT_EQ(ENOENT, isoPartition->lastError());
+	EXPECT_EQ("(null)", readFile("/SUBDIR/NOTFOUND.BIN"));
+	EXPECT_EQ(ENOENT, isoPartition->lastError());
+
+	// Directories can't be opened as files.
+	EXPECT_EQ("(null)", readFile("/SUBDIR/DEEP"));
+	EXPECT_EQ(EISDIR, isoPartition->lastError());
+	EXPECT_EQ("(null)", readFile("/SUBDIR/DEEP/"));
+	EXPECT_EQ(EISDIR, isoPartition->lastError());
+	EXPECT_EQ("(null)", readFile("/Long Directory Name"));
+	EXPECT_EQ(EISDIR, isoPartition->lastError());
+
+	// The root directory can't be opened either.
+	isoPartition->clearError();
+	EXPECT_EQ("(null)", readFile("/"));
+	EXPECT_EQ(EISDIR, isoPartition->lastError());
+	isoPartition->clearError();
+	EXPECT_EQ("(null)", readFile("//"));
+	EXPECT_EQ(EISDIR, isoPartition->lastError());
+
+	// Files can't be used as directories.
+	EXPECT_EQ("(null)", readFile("/SYSTEM.CNF/BOOT.BIN"));
+	EXPECT_EQ(ENOTDIR, isoPartition->lastError());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: IsoPartition tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
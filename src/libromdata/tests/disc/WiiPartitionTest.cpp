@@ -0,0 +1,256 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * WiiPartitionTest.cpp: WiiPartition sector cache test.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpbase/disc/DiscReader.hpp"
+#include "librpcpu/byteswap.h"
+#include "librpfile/RpMemFile.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// libromdata
+#include "disc/WiiPartition.hpp"
+#include "Console/wii_structs.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+// Physical sector size.
+static const unsigned int SECTOR_SIZE = 0x8000;
+
+// Number of sectors in the partition's data area.
+static const unsigned int DATA_SECTORS = 6;
+
+// Number of sectors after the data area.
+// These must never be read by the partition.
+static const unsigned int EXTRA_SECTORS = 4;
+
+/**
+ * DiscReader that records the size of each read.
+ */
+class CountingDiscReader : public DiscReader
+{
+	public:
+		explicit CountingDiscReader(IRpFile *file)
+			: super(file)
+		{ }
+
+	private:
+		typedef DiscReader super;
+		RP_DISABLE_COPY(CountingDiscReader)
+
+	public:
+		size_t read(void *ptr, size_t size) final
+		{
+			reads.push_back(size);
+			return super::read(ptr, size);
+		}
+
+	public:
+		vector<size_t> reads;	// Size of each read.
+};
+
+class WiiPartitionTest : public ::testing::Test
+{
+	protected:
+		WiiPartitionTest()
+			: discReader(nullptr)
+			, partition(nullptr)
+		{ }
+
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		/**
+		 * Read a data sector from the partition and check its contents.
+		 * @param sector_num Sector number.
+		 */
+		void checkSector(unsigned int sector_num);
+
+	public:
+		vector<uint8_t> data;
+		CountingDiscReader *discReader;
+		WiiPartition *partition;
+};
+
+void WiiPartitionTest::SetUp(void)
+{
+	// Partition header, followed by the data sectors
+	// and some sectors that aren't part of the partition.
+	// Each data sector is filled with its sector number plus one.
+	data.resize(sizeof(RVL_PartitionHeader) + (DATA_SECTORS + EXTRA_SECTORS) * SECTOR_SIZE);
+	RVL_PartitionHeader *const header = reinterpret_cast<RVL_PartitionHeader*>(data.data());
+	header->ticket.signature_type = cpu_to_be32(RVL_SIGNATURE_TYPE_RSA2048);
+	header->data_offset = cpu_to_be32(sizeof(RVL_PartitionHeader) >> 2);
+	header->data_size = cpu_to_be32((DATA_SECTORS * SECTOR_SIZE) >> 2);
+	for (unsigned int i = 0; i < DATA_SECTORS + EXTRA_SECTORS; i++) {
+		memset(&data[sizeof(RVL_PartitionHeader) + i * SECTOR_SIZE],
+			static_cast<uint8_t>(i + 1), SECTOR_SIZE);
+	}
+
+	RpMemFile *const memFile = new RpMemFile(data.data(), data.size());
+	discReader = new CountingDiscReader(memFile);
+	memFile->unref();
+	ASSERT_TRUE(discReader->isOpen());
+
+	// Unencrypted 32 KiB sectors, so no keys are needed.
+	partition = new WiiPartition(discReader, 0, data.size(), WiiPartition::CM_RVTH);
+	ASSERT_TRUE(partition->isOpen());
+	ASSERT_EQ(static_cast<off64_t>(DATA_SECTORS * SECTOR_SIZE), partition->size());
+
+	// Don't count the partition header.
+	discReader->reads.clear();
+}
+
+void WiiPartitionTest::TearDown(void)
+{
+	delete partition;
+	partition = nullptr;
+	delete discReader;
+	discReader = nullptr;
+}
+
+/**
+ * Read a data sector from the partition and check its contents.
+ * @param sector_num Sector number.
+ */
+void WiiPartitionTest::checkSector(unsigned int sector_num)
+{
+	vector<uint8_t> buf(SECTOR_SIZE);
+	ASSERT_EQ(static_cast<size_t>(SECTOR_SIZE),
+		partition->seekAndRead(static_cast<off64_t>(sector_num) * SECTOR_SIZE, buf.data(), buf.size()));
+	const uint8_t expected = static_cast<uint8_t>(sector_num + 1);
+	EXPECT_EQ(expected, buf[0]) << "sector " << sector_num;
+	EXPECT_EQ(expected, buf[SECTOR_SIZE - 1]) << "sector " << sector_num;
+}
+
+/**
+ * Reading a cached sector again doesn't hit the disc reader.
+ */
+TEST_F(WiiPartitionTest, cacheHit)
+{
+	ASSERT_NO_FATAL_FAILURE(checkSector(2));
+	ASSERT_EQ(1U, discReader->reads.size());
+	EXPECT_EQ(static_cast<size_t>(SECTOR_SIZE), discReader->reads[0]);
+
+	ASSERT_NO_FATAL_FAILURE(checkSector(2));
+	EXPECT_EQ(1U, discReader->reads.size());
+}
+
+/**
+ * The least-recently used sector is evicted when the cache is full.
+ */
+TEST_F(WiiPartitionTest, lruEviction)
+{
+	// Two entries, so batches are limited to a single sector.
+	partition->setSectorCacheCount(2);
+	ASSERT_EQ(2U, partition->sectorCacheCount());
+
+	// Cache sectors 0 and 3, then use sector 0 again.
+	ASSERT_NO_FATAL_FAILURE(checkSector(0));
+	ASSERT_NO_FATAL_FAILURE(checkSector(3));
+	ASSERT_NO_FATAL_FAILURE(checkSector(0));
+	EXPECT_EQ(2U, discReader->reads.size());
+
+	// Sector 3 is the least-recently used, so it's evicted.
+	ASSERT_NO_FATAL_FAILURE(checkSector(5));
+	EXPECT_EQ(3U, discReader->reads.size());
+	ASSERT_NO_FATAL_FAILURE(checkSector(0));
+	EXPECT_EQ(3U, discReader->reads.size());
+	ASSERT_NO_FATAL_FAILURE(checkSector(3));
+	EXPECT_EQ(4U, discReader->reads.size());
+
+	// Each read is a single sector.
+	for (size_t sz : discReader->reads) {
+		EXPECT_EQ(static_cast<size_t>(SECTOR_SIZE), sz);
+	}
+}
+
+/**
+ * Sequential reads are batched, and the following
+ * sectors are served from the cache.
+ */
+TEST_F(WiiPartitionTest, readAhead)
+{
+	ASSERT_NO_FATAL_FAILURE(checkSector(0));
+	ASSERT_NO_FATAL_FAILURE(checkSector(1));
+	ASSERT_EQ(2U, discReader->reads.size());
+	EXPECT_EQ(static_cast<size_t>(SECTOR_SIZE), discReader->reads[0]);
+	// Read-ahead is limited to half of the default cache.
+	EXPECT_EQ(static_cast<size_t>(4 * SECTOR_SIZE), discReader->reads[1]);
+
+	// Sectors 2-4 were read ahead.
+	ASSERT_NO_FATAL_FAILURE(checkSector(2));
+	ASSERT_NO_FATAL_FAILURE(checkSector(3));
+	ASSERT_NO_FATAL_FAILURE(checkSector(4));
+	EXPECT_EQ(2U, discReader->reads.size());
+}
+
+/**
+ * Read-ahead doesn't go past the end of the partition.
+ */
+TEST_F(WiiPartitionTest, readAheadClampedAtEnd)
+{
+	// Sequential access starting at sector 4 would read
+	// ahead four sectors, but only sectors 4 and 5 are
+	// part of the partition.
+	ASSERT_NO_FATAL_FAILURE(checkSector(3));
+	ASSERT_NO_FATAL_FAILURE(checkSector(4));
+	ASSERT_EQ(2U, discReader->reads.size());
+	EXPECT_EQ(static_cast<size_t>(2 * SECTOR_SIZE), discReader->reads[1]);
+
+	ASSERT_NO_FATAL_FAILURE(checkSector(5));
+	EXPECT_EQ(2U, discReader->reads.size());
+
+	// Nothing past the last sector can be read.
+	uint8_t buf[16];
+	EXPECT_EQ(0U, partition->seekAndRead(static_cast<off64_t>(DATA_SECTORS) * SECTOR_SIZE, buf, sizeof(buf)));
+	EXPECT_EQ(2U, discReader->reads.size());
+}
+
+/**
+ * A multi-sector read of the last sector isn't
+ * extended past the end of the partition.
+ */
+TEST_F(WiiPartitionTest, lastSectorBatch)
+{
+	vector<uint8_t> buf(2 * SECTOR_SIZE);
+	ASSERT_EQ(buf.size(), partition->seekAndRead(static_cast<off64_t>(DATA_SECTORS - 2) * SECTOR_SIZE, buf.data(), buf.size()));
+	EXPECT_EQ(static_cast<uint8_t>(DATA_SECTORS - 1), buf[0]);
+	EXPECT_EQ(static_cast<uint8_t>(DATA_SECTORS), buf[buf.size() - 1]);
+	ASSERT_EQ(1U, discReader->reads.size());
+	EXPECT_EQ(static_cast<size_t>(2 * SECTOR_SIZE), discReader->reads[0]);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: WiiPartition sector cache tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
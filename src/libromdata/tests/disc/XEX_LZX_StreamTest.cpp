@@ -0,0 +1,494 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * XEX_LZX_StreamTest.cpp: Streaming LZX decompression tests.              *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpbase/disc/CBCReader.hpp"
+#include "librpcpu/byteswap.h"
+#include "librpfile/RpMemFile.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// libromdata
+#include "disc/XEX_LZX_Stream.hpp"
+
+// libmspack-xenia
+#include "mspack.h"
+#include "xenia_lzx.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+// Size of the decompressed test data.
+// This spans multiple 32 KB LZX frames, and the last frame is partial.
+static const size_t IMAGE_SIZE = 100000;
+
+// LZX window size.
+static const uint32_t WINDOW_SIZE = 0x10000;
+
+// Uncompressed LZX block length.
+// This is odd, so the blocks require padding.
+static const unsigned int LZX_BLOCK_LEN = 40001;
+
+// PE header size.
+static const size_t PE_HEADER_SIZE = 8192;
+
+/**
+ * LZX bitstream writer.
+ * Bits are stored MSB-first in 16-bit little-endian words.
+ */
+class LzxBitWriter
+{
+	public:
+		explicit LzxBitWriter(vector<uint8_t> &out)
+			: out(out)
+			, word(0)
+			, bits(0)
+		{ }
+
+	private:
+		RP_DISABLE_COPY(LzxBitWriter)
+
+	public:
+		/**
+		 * Write bits.
+		 * @param value Value.
+		 * @param nbits Number of bits.
+		 */
+		void write(uint32_t value, unsigned int nbits)
+		{
+			while (nbits > 0) {
+				nbits--;
+				word = (word << 1) | ((value >> nbits) & 1);
+				if (++bits == 16) {
+					out.push_back(word & 0xFF);
+					out.push_back(word >> 8);
+					word = 0;
+					bits = 0;
+				}
+			}
+		}
+
+		/**
+		 * Pad the current word with zero bits.
+		 */
+		void flush(void)
+		{
+			if (bits > 0) {
+				write(0, 16 - bits);
+			}
+		}
+
+	private:
+		vector<uint8_t> &out;
+		uint16_t word;
+		unsigned int bits;
+};
+
+/**
+ * Create an LZX stream using uncompressed blocks.
+ * @param data Uncompressed data.
+ * @return LZX stream.
+ */
+static vector<uint8_t> makeLzx(const vector<uint8_t> &data)
+{
+	vector<uint8_t> lzx;
+	LzxBitWriter bw(lzx);
+
+	// No Intel E8 translation.
+	bw.write(0, 1);
+
+	for (size_t pos = 0; pos < data.size(); pos += LZX_BLOCK_LEN) {
+		const unsigned int len = static_cast<unsigned int>(
+			std::min(data.size() - pos, static_cast<size_t>(LZX_BLOCK_LEN)));
+
+		// Block type 3 (uncompressed) and 24-bit length,
+		// then realign to 16 bits.
+		bw.write(3, 3);
+		bw.write(len, 24);
+		bw.flush();
+
+		// R0, R1, R2
+		static const uint8_t r012[12] = {1,0,0,0, 1,0,0,0, 1,0,0,0};
+		lzx.insert(lzx.end(), r012, r012 + sizeof(r012));
+
+		// Block data, padded to 16 bits.
+		lzx.insert(lzx.end(), data.begin() + pos, data.begin() + pos + len);
+		if (len & 1) {
+			lzx.push_back(0);
+		}
+	}
+
+	return lzx;
+}
+
+/**
+ * Split an LZX stream into XEX2 compression blocks.
+ * @param lzx		[in] LZX stream.
+ * @param first_block	[out] First block information. (byteswapped)
+ * @return Compressed XEX data.
+ */
+static vector<uint8_t> makeXexBlocks(const vector<uint8_t> &lzx, XEX2_Compression_Normal_Info &first_block)
+{
+	// Use small chunks and blocks so the stream
+	// has to handle several of each.
+	static const size_t CHUNK_SIZE = 0x1234;
+	static const unsigned int CHUNKS_PER_BLOCK = 3;
+	static const size_t BLOCK_PADDING = 6;
+
+	// Compressed data for each block, not including the next block header.
+	vector<vector<uint8_t> > blocks;
+	for (size_t pos = 0; pos < lzx.size(); ) {
+		vector<uint8_t> block;
+		for (unsigned int i = 0; i < CHUNKS_PER_BLOCK && pos < lzx.size(); i++) {
+			const size_t len = std::min(lzx.size() - pos, CHUNK_SIZE);
+			block.push_back(static_cast<uint8_t>(len >> 8));
+			block.push_back(static_cast<uint8_t>(len & 0xFF));
+			block.insert(block.end(), lzx.begin() + pos, lzx.begin() + pos + len);
+			pos += len;
+		}
+
+		// End of the block, followed by unused data.
+		block.resize(block.size() + 2 + BLOCK_PADDING, 0);
+		blocks.push_back(block);
+	}
+
+	memset(&first_block, 0, sizeof(first_block));
+	first_block.block_size = static_cast<uint32_t>(sizeof(first_block) + blocks[0].size());
+
+	vector<uint8_t> xex;
+	for (size_t i = 0; i < blocks.size(); i++) {
+		XEX2_Compression_Normal_Info next_block;
+		memset(&next_block, 0, sizeof(next_block));
+		if (i + 1 < blocks.size()) {
+			next_block.block_size = cpu_to_be32(static_cast<uint32_t>(
+				sizeof(next_block) + blocks[i + 1].size()));
+		}
+		const uint8_t *const p = reinterpret_cast<const uint8_t*>(&next_block);
+		xex.insert(xex.end(), p, p + sizeof(next_block));
+		xex.insert(xex.end(), blocks[i].begin(), blocks[i].end());
+	}
+	return xex;
+}
+
+/**
+ * Memory stream for lzx_decompress_stream().
+ */
+struct MemStream {
+	const vector<uint8_t> *in;	// Compressed data.
+	size_t in_pos;			// Input position.
+	size_t maxRead;			// Maximum number of bytes per read.
+	size_t failAt;			// Reads fail at or after this position.
+	vector<uint8_t> out;		// Decompressed data.
+
+	MemStream(const vector<uint8_t> *in, size_t maxRead)
+		: in(in)
+		, in_pos(0)
+		, maxRead(maxRead)
+		, failAt(~static_cast<size_t>(0))
+	{ }
+
+	static int read(void *userdata, void *buf, int size)
+	{
+		MemStream *const ms = static_cast<MemStream*>(userdata);
+		if (ms->in_pos >= ms->failAt) {
+			return -1;
+		}
+		size_t len = std::min(static_cast<size_t>(size), ms->maxRead);
+		len = std::min(len, ms->in->size() - ms->in_pos);
+		memcpy(buf, &(*ms->in)[ms->in_pos], len);
+		ms->in_pos += len;
+		return static_cast<int>(len);
+	}
+
+	static int write(void *userdata, const void *buf, int size)
+	{
+		MemStream *const ms = static_cast<MemStream*>(userdata);
+		const uint8_t *const p = static_cast<const uint8_t*>(buf);
+		ms->out.insert(ms->out.end(), p, p + size);
+		return size;
+	}
+};
+
+class XEX_LZX_StreamTest : public ::testing::Test
+{
+	protected:
+		XEX_LZX_StreamTest()
+		{ }
+
+		void SetUp(void) final
+		{
+			// Pseudo-random data with an MZ header.
+			data.resize(IMAGE_SIZE);
+			uint32_t seed = 0x12345678;
+			for (size_t i = 0; i < data.size(); i++) {
+				seed = seed * 1103515245U + 12345U;
+				data[i] = static_cast<uint8_t>(seed >> 16);
+			}
+			data[0] = 'M';
+			data[1] = 'Z';
+			lzx = makeLzx(data);
+			xex = makeXexBlocks(lzx, first_block);
+		}
+
+	public:
+		/**
+		 * Create a CBCReader for compressed XEX data.
+		 * @param xex Compressed XEX data. (must remain valid)
+		 * @return CBCReader without encryption.
+		 */
+		static CBCReader *createReader(const vector<uint8_t> &xex)
+		{
+			RpMemFile *const memFile = new RpMemFile(xex.data(), xex.size());
+			CBCReader *const reader = new CBCReader(memFile, 0, xex.size(), nullptr, nullptr);
+			memFile->unref();
+			return reader;
+		}
+
+		/**
+		 * Decompress the PE header using XEX_LZX_Stream::decompressPE().
+		 * @param reader0 First CBCReader.
+		 * @param reader1 Second CBCReader.
+		 * @param peHeader [out] PE header.
+		 * @return Index of the CBCReader that was used, or -1 on error.
+		 */
+		int decompressPE(CBCReader *reader0, CBCReader *reader1, vector<uint8_t> &peHeader)
+		{
+			CBCReader *const reader[2] = {reader0, reader1};
+			peHeader.assign(PE_HEADER_SIZE, 0);
+			XEX_LZX_Stream::Range range;
+			range.address = 0;
+			range.buf = peHeader.data();
+			range.size = peHeader.size();
+			return XEX_LZX_Stream::decompressPE(reader, 2, first_block,
+				&range, 1, IMAGE_SIZE, WINDOW_SIZE);
+		}
+
+		/**
+		 * Check the decompressed PE header.
+		 * @param peHeader PE header.
+		 */
+		void checkPeHeader(const vector<uint8_t> &peHeader)
+		{
+			ASSERT_EQ(PE_HEADER_SIZE, peHeader.size());
+			EXPECT_EQ(0, memcmp(data.data(), peHeader.data(), PE_HEADER_SIZE));
+		}
+
+	public:
+		vector<uint8_t> data;	// Uncompressed data.
+		vector<uint8_t> lzx;	// LZX stream.
+		vector<uint8_t> xex;	// Compressed XEX data.
+		XEX2_Compression_Normal_Info first_block;
+};
+
+/**
+ * lzx_decompress_stream() produces the same output as lzx_decompress().
+ */
+TEST_F(XEX_LZX_StreamTest, streamMatchesOneShot)
+{
+	vector<uint8_t> oneShot(IMAGE_SIZE);
+	ASSERT_EQ(MSPACK_ERR_OK, lzx_decompress(lzx.data(), lzx.size(),
+		oneShot.data(), oneShot.size(), WINDOW_SIZE, nullptr, 0));
+	ASSERT_TRUE(oneShot == data);
+
+	// Short reads shouldn't make a difference.
+	static const size_t maxReads[] = {0x8000, 1000, 7, 1};
+	for (size_t i = 0; i < sizeof(maxReads)/sizeof(maxReads[0]); i++) {
+		SCOPED_TRACE(testing::Message() << "maxRead == " << maxReads[i]);
+		MemStream ms(&lzx, maxReads[i]);
+		ASSERT_EQ(MSPACK_ERR_OK, lzx_decompress_stream(MemStream::read, MemStream::write,
+			&ms, IMAGE_SIZE, IMAGE_SIZE, WINDOW_SIZE));
+		EXPECT_TRUE(ms.out == oneShot);
+	}
+}
+
+/**
+ * lzx_decompress_stream() stops after stop_len bytes.
+ */
+TEST_F(XEX_LZX_StreamTest, streamStopsEarly)
+{
+	static const size_t stop_len = 5000;
+	MemStream ms(&lzx, 1000);
+	ASSERT_EQ(MSPACK_ERR_OK, lzx_decompress_stream(MemStream::read, MemStream::write,
+		&ms, IMAGE_SIZE, stop_len, WINDOW_SIZE));
+	ASSERT_EQ(stop_len, ms.out.size());
+	EXPECT_EQ(0, memcmp(data.data(), ms.out.data(), stop_len));
+
+	// The rest of the compressed data wasn't read.
+	EXPECT_LT(ms.in_pos, lzx.size() / 2);
+}
+
+/**
+ * lzx_decompress_stream() error handling.
+ */
+TEST_F(XEX_LZX_StreamTest, streamErrors)
+{
+	// Read error.
+	MemStream ms(&lzx, 0x8000);
+	ms.failAt = 0x8000;
+	EXPECT_NE(MSPACK_ERR_OK, lzx_decompress_stream(MemStream::read, MemStream::write,
+		&ms, IMAGE_SIZE, IMAGE_SIZE, WINDOW_SIZE));
+
+	// stop_len > dest_len
+	MemStream ms2(&lzx, 0x8000);
+	EXPECT_NE(MSPACK_ERR_OK, lzx_decompress_stream(MemStream::read, MemStream::write,
+		&ms2, IMAGE_SIZE, IMAGE_SIZE + 1, WINDOW_SIZE));
+	EXPECT_TRUE(ms2.out.empty());
+
+	// Invalid window size.
+	MemStream ms3(&lzx, 0x8000);
+	EXPECT_NE(MSPACK_ERR_OK, lzx_decompress_stream(MemStream::read, MemStream::write,
+		&ms3, IMAGE_SIZE, IMAGE_SIZE, 0));
+}
+
+/**
+ * XEX_LZX_Stream de-blocks the compressed data and
+ * only saves the requested ranges.
+ */
+TEST_F(XEX_LZX_StreamTest, xexRanges)
+{
+	CBCReader *const reader = createReader(xex);
+	ASSERT_TRUE(reader->isOpen());
+
+	// The second range crosses an LZX frame boundary
+	// and several XEX blocks.
+	vector<uint8_t> peHeader(PE_HEADER_SIZE);
+	vector<uint8_t> section(40000);
+	static const size_t section_addr = 0x7000;
+	vector<uint8_t> tail(IMAGE_SIZE - 90000);
+
+	XEX_LZX_Stream lzxStream(reader, first_block);
+	lzxStream.addRange(0, peHeader.data(), peHeader.size());
+	lzxStream.addRange(section_addr, section.data(), section.size());
+	lzxStream.addRange(90000, tail.data(), tail.size());
+	ASSERT_EQ(MSPACK_ERR_OK, lzxStream.decompress(IMAGE_SIZE, WINDOW_SIZE));
+
+	EXPECT_EQ(0, memcmp(&data[0], peHeader.data(), peHeader.size()));
+	EXPECT_EQ(0, memcmp(&data[section_addr], section.data(), section.size()));
+	EXPECT_EQ(0, memcmp(&data[90000], tail.data(), tail.size()));
+
+	// Ranges past the end of the image are rejected.
+	reader->rewind();
+	XEX_LZX_Stream badStream(reader, first_block);
+	badStream.addRange(IMAGE_SIZE - 10, tail.data(), 20);
+	EXPECT_NE(MSPACK_ERR_OK, badStream.decompress(IMAGE_SIZE, WINDOW_SIZE));
+
+	delete reader;
+}
+
+/**
+ * decompressPE() uses the first CBCReader that works.
+ */
+TEST_F(XEX_LZX_StreamTest, decompressPE_firstReader)
+{
+	CBCReader *const reader = createReader(xex);
+	vector<uint8_t> peHeader;
+	EXPECT_EQ(0, decompressPE(reader, reader, peHeader));
+	ASSERT_NO_FATAL_FAILURE(checkPeHeader(peHeader));
+
+	// nullptr readers are skipped.
+	EXPECT_EQ(1, decompressPE(nullptr, reader, peHeader));
+	ASSERT_NO_FATAL_FAILURE(checkPeHeader(peHeader));
+	delete reader;
+}
+
+/**
+ * decompressPE() tries the next CBCReader if a block size is invalid.
+ */
+TEST_F(XEX_LZX_StreamTest, decompressPE_invalidBlockSize)
+{
+	// Wrong key: The next block header is garbage.
+	vector<uint8_t> badXex(xex);
+	memset(badXex.data(), 0xFF, sizeof(XEX2_Compression_Normal_Info));
+
+	CBCReader *const badReader = createReader(badXex);
+	CBCReader *const goodReader = createReader(xex);
+	vector<uint8_t> peHeader;
+	EXPECT_EQ(1, decompressPE(badReader, goodReader, peHeader));
+	ASSERT_NO_FATAL_FAILURE(checkPeHeader(peHeader));
+
+	// Neither reader works.
+	EXPECT_EQ(-1, decompressPE(badReader, nullptr, peHeader));
+	delete badReader;
+	delete goodReader;
+}
+
+/**
+ * decompressPE() tries the next CBCReader if LZX decompression fails.
+ */
+TEST_F(XEX_LZX_StreamTest, decompressPE_decompressionFailed)
+{
+	// Wrong key: The XEX blocks are valid, but the first
+	// LZX block has an invalid block type.
+	vector<uint8_t> badLzx(lzx);
+	badLzx[1] &= 0x8F;
+	XEX2_Compression_Normal_Info bad_first_block;
+	const vector<uint8_t> badXex = makeXexBlocks(badLzx, bad_first_block);
+	ASSERT_EQ(first_block.block_size, bad_first_block.block_size);
+
+	CBCReader *const badReader = createReader(badXex);
+	CBCReader *const goodReader = createReader(xex);
+	vector<uint8_t> peHeader;
+	EXPECT_EQ(1, decompressPE(badReader, goodReader, peHeader));
+	ASSERT_NO_FATAL_FAILURE(checkPeHeader(peHeader));
+
+	// Neither reader works.
+	EXPECT_EQ(-1, decompressPE(badReader, nullptr, peHeader));
+	delete badReader;
+	delete goodReader;
+}
+
+/**
+ * decompressPE() tries the next CBCReader if the MZ header is invalid.
+ */
+TEST_F(XEX_LZX_StreamTest, decompressPE_invalidMZ)
+{
+	// Wrong key: Decompression works, but the data is wrong.
+	vector<uint8_t> badData(data);
+	badData[0] = 'X';
+	XEX2_Compression_Normal_Info bad_first_block;
+	const vector<uint8_t> badXex = makeXexBlocks(makeLzx(badData), bad_first_block);
+	ASSERT_EQ(first_block.block_size, bad_first_block.block_size);
+
+	CBCReader *const badReader = createReader(badXex);
+	CBCReader *const goodReader = createReader(xex);
+	vector<uint8_t> peHeader;
+	EXPECT_EQ(1, decompressPE(badReader, goodReader, peHeader));
+	ASSERT_NO_FATAL_FAILURE(checkPeHeader(peHeader));
+
+	EXPECT_EQ(-1, decompressPE(badReader, badReader, peHeader));
+	delete badReader;
+	delete goodReader;
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: XEX LZX stream tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,262 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * ExecRpDownloadTest.cpp: rp-download helper process test.                *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// libromdata
+#include "common.h"
+#include "FakeRpDownload.hpp"
+
+// C includes.
+#include <signal.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+class ExecRpDownloadTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) final
+		{
+			ASSERT_FALSE(tmpDir.empty()) << "Unable to create the fake rp-download.";
+
+			// Each test uses its own home directory.
+			// NOTE: Changing $HOME restarts the rp-download process.
+			homeDir = tmpDir + '/' +
+				::testing::UnitTest::GetInstance()->current_test_info()->name();
+			ASSERT_EQ(0, mkdir(homeDir.c_str(), 0700));
+			setenv("HOME", homeDir.c_str(), 1);
+
+			// Files that can be downloaded.
+			static const char *const keys[] = {
+				"ok", "ok1", "ok2", "ok3", "ok4", "crash-once"
+			};
+			for (const char *key : keys) {
+				ASSERT_EQ(0, FakeRpDownload::addToServer(homeDir, key, "data", 4));
+			}
+		}
+
+		void TearDown(void) final
+		{
+			FakeRpDownload::removeTree(homeDir);
+		}
+
+	public:
+		// Response timeout for the tests, in milliseconds.
+		static const int TIMEOUT_MS = 1000;
+
+		/**
+		 * Create the fake rp-download.
+		 */
+		static void SetUpTestCase(void)
+		{
+			tmpDir = FakeRpDownload::create("ExecRpDownloadTest", TIMEOUT_MS);
+		}
+
+		/**
+		 * Delete the fake rp-download.
+		 */
+		static void TearDownTestCase(void)
+		{
+			FakeRpDownload::destroy(tmpDir);
+		}
+
+		typedef FakeRpDownload::Request Request;
+
+		/**
+		 * Get the requests received by the fake rp-download.
+		 * @return Requests.
+		 */
+		vector<Request> requests(void) const
+		{
+			return FakeRpDownload::requests(homeDir);
+		}
+
+	public:
+		static string tmpDir;		// Temporary directory.
+		string homeDir;			// $HOME for this test.
+		TestCacheManager cache;
+};
+
+string ExecRpDownloadTest::tmpDir;
+
+/**
+ * Invalid cache keys are rejected without starting rp-download.
+ */
+TEST_F(ExecRpDownloadTest, invalidCacheKey)
+{
+	EXPECT_EQ(-EINVAL, cache.execRpDownload(string()));
+	EXPECT_EQ(-EINVAL, cache.execRpDownload("ok\nok"));
+	EXPECT_EQ(-EINVAL, cache.execRpDownload(string("ok\0ok", 5)));
+	EXPECT_TRUE(requests().empty());
+}
+
+/**
+ * The rp-download process is reused for subsequent requests,
+ * including after a failed download.
+ */
+TEST_F(ExecRpDownloadTest, processReused)
+{
+	EXPECT_EQ(0, cache.execRpDownload("ok1"));
+	EXPECT_EQ(-EIO, cache.execRpDownload("fail"));
+	EXPECT_EQ(0, cache.execRpDownload("ok2"));
+
+	const vector<Request> reqs = requests();
+	ASSERT_EQ(3U, reqs.size());
+	EXPECT_EQ("ok1", reqs[0].key);
+	EXPECT_EQ("fail", reqs[1].key);
+	EXPECT_EQ("ok2", reqs[2].key);
+	EXPECT_EQ(reqs[0].pid, reqs[1].pid);
+	EXPECT_EQ(reqs[0].pid, reqs[2].pid);
+}
+
+/**
+ * If rp-download crashes during a request, it's restarted
+ * and the request is retried once.
+ */
+TEST_F(ExecRpDownloadTest, restartAfterCrash)
+{
+	EXPECT_EQ(0, cache.execRpDownload("crash-once"));
+
+	vector<Request> reqs = requests();
+	ASSERT_EQ(2U, reqs.size());
+	EXPECT_EQ("crash-once", reqs[0].key);
+	EXPECT_EQ("crash-once", reqs[1].key);
+	EXPECT_NE(reqs[0].pid, reqs[1].pid);
+
+	// The restarted process is reused.
+	EXPECT_EQ(0, cache.execRpDownload("ok"));
+	reqs = requests();
+	ASSERT_EQ(3U, reqs.size());
+	EXPECT_EQ(reqs[1].pid, reqs[2].pid);
+}
+
+/**
+ * If rp-download crashes again after being restarted,
+ * the request fails instead of being retried indefinitely.
+ */
+TEST_F(ExecRpDownloadTest, crashAfterRestart)
+{
+	EXPECT_EQ(-ECHILD, cache.execRpDownload("crash"));
+
+	vector<Request> reqs = requests();
+	ASSERT_EQ(2U, reqs.size());
+	EXPECT_NE(reqs[0].pid, reqs[1].pid);
+
+	// The next request starts a new process.
+	EXPECT_EQ(0, cache.execRpDownload("ok"));
+	reqs = requests();
+	ASSERT_EQ(3U, reqs.size());
+	EXPECT_NE(reqs[1].pid, reqs[2].pid);
+}
+
+/**
+ * If rp-download is killed between requests,
+ * it's restarted for the next request.
+ */
+TEST_F(ExecRpDownloadTest, killedBetweenRequests)
+{
+	EXPECT_EQ(0, cache.execRpDownload("ok1"));
+	vector<Request> reqs = requests();
+	ASSERT_EQ(1U, reqs.size());
+	ASSERT_GT(reqs[0].pid, 0);
+	ASSERT_EQ(0, kill(reqs[0].pid, SIGKILL));
+
+	EXPECT_EQ(0, cache.execRpDownload("ok2"));
+	reqs = requests();
+	ASSERT_EQ(2U, reqs.size());
+	EXPECT_EQ("ok2", reqs[1].key);
+	EXPECT_NE(reqs[0].pid, reqs[1].pid);
+}
+
+/**
+ * If rp-download doesn't respond within the timeout, it's
+ * terminated, and the request is not retried.
+ * NOTE: The timeout is shortened from 10 seconds for this test.
+ */
+TEST_F(ExecRpDownloadTest, responseTimeout)
+{
+	struct timespec ts_start, ts_end;
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+	EXPECT_EQ(-ECHILD, cache.execRpDownload("hang"));
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+
+	const long ms = ((ts_end.tv_sec - ts_start.tv_sec) * 1000) +
+	                ((ts_end.tv_nsec - ts_start.tv_nsec) / 1000000);
+	EXPECT_GE(ms, TIMEOUT_MS - 10);
+	EXPECT_LT(ms, TIMEOUT_MS * 5);
+
+	vector<Request> reqs = requests();
+	ASSERT_EQ(1U, reqs.size());
+
+	// The next request starts a new process.
+	EXPECT_EQ(0, cache.execRpDownload("ok"));
+	reqs = requests();
+	ASSERT_EQ(2U, reqs.size());
+	EXPECT_NE(reqs[0].pid, reqs[1].pid);
+}
+
+/**
+ * Changing the environment, e.g. the proxy URL,
+ * restarts the rp-download process.
+ */
+TEST_F(ExecRpDownloadTest, environmentChange)
+{
+	cache.setProxyUrl("http://proxy1.example.com:8080");
+	EXPECT_EQ(0, cache.execRpDownload("ok1"));
+	EXPECT_EQ(0, cache.execRpDownload("ok2"));
+	cache.setProxyUrl("http://proxy2.example.com:8080");
+	EXPECT_EQ(0, cache.execRpDownload("ok3"));
+	cache.setProxyUrl(nullptr);
+	EXPECT_EQ(0, cache.execRpDownload("ok4"));
+
+	const vector<Request> reqs = requests();
+	ASSERT_EQ(4U, reqs.size());
+	EXPECT_EQ("http://proxy1.example.com:8080", reqs[0].proxy);
+	EXPECT_EQ("http://proxy1.example.com:8080", reqs[1].proxy);
+	EXPECT_EQ("http://proxy2.example.com:8080", reqs[2].proxy);
+	EXPECT_EQ("", reqs[3].proxy);
+
+	// Same environment: Process is reused.
+	EXPECT_EQ(reqs[0].pid, reqs[1].pid);
+	// Different environment: Process is restarted.
+	EXPECT_NE(reqs[1].pid, reqs[2].pid);
+	EXPECT_NE(reqs[2].pid, reqs[3].pid);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: rp-download helper process tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,420 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * ExtImageFetcherTest.cpp: External image fetcher test.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile, librptexture
+#include "common.h"
+#include "librpbase/img/RpPngWriter.hpp"
+#include "librpfile/FileSystem.hpp"
+#include "librptexture/img/rp_image.hpp"
+using namespace LibRpBase;
+using namespace LibRpFile;
+using LibRpTexture::rp_image;
+
+// libromdata
+#include "img/ExtImageFetcher.hpp"
+#include "FakeRpDownload.hpp"
+
+// C includes.
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+class ExtImageFetcherTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) final
+		{
+			ASSERT_FALSE(tmpDir.empty()) << "Unable to create the fake rp-download.";
+			unlink((tmpDir + "/requests.log").c_str());
+
+			// Each test uses its own cache key prefix.
+			prefix = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+			prefix += '/';
+		}
+
+	public:
+		/**
+		 * Create the fake rp-download and use the temporary
+		 * directory as the home directory.
+		 * This must be done before the cache directory is first used.
+		 */
+		static void SetUpTestCase(void)
+		{
+			tmpDir = FakeRpDownload::create("ExtImageFetcherTest", 0);
+		}
+
+		/**
+		 * Delete the temporary directory.
+		 */
+		static void TearDownTestCase(void)
+		{
+			FakeRpDownload::destroy(tmpDir);
+		}
+
+		/**
+		 * Write a PNG image.
+		 * The image width identifies the candidate.
+		 * @param filename Filename.
+		 * @param width Image width.
+		 */
+		static void writePng(const string &filename, int width)
+		{
+			ASSERT_EQ(0, FileSystem::rmkdir(filename));
+			rp_image img(width, 8, rp_image::FORMAT_ARGB32);
+			ASSERT_TRUE(img.isValid());
+			for (int y = 0; y < img.height(); y++) {
+				uint32_t *const row = static_cast<uint32_t*>(img.scanLine(y));
+				std::fill(row, row + img.width(), 0xFF336699U);
+			}
+
+			RpPngWriter png(filename.c_str(), &img);
+			ASSERT_TRUE(png.isOpen());
+			ASSERT_EQ(0, png.write_IHDR());
+			ASSERT_EQ(0, png.write_IDAT());
+		}
+
+		/**
+		 * Write a file.
+		 * @param filename Filename.
+		 * @param data Data.
+		 */
+		static void writeFile(const string &filename, const char *data)
+		{
+			ASSERT_EQ(0, FileSystem::rmkdir(filename));
+			FILE *const f = fopen(filename.c_str(), "wb");
+			ASSERT_TRUE(f != nullptr);
+			fwrite(data, 1, strlen(data), f);
+			fclose(f);
+		}
+
+		/**
+		 * Get a cache key for this test.
+		 * @param name Name.
+		 * @return Cache key.
+		 */
+		string key(const char *name) const
+		{
+			return prefix + name + ".png";
+		}
+
+		/**
+		 * Add an image to the fake server.
+		 * @param name Name.
+		 * @param width Image width.
+		 */
+		void addToServer(const char *name, int width)
+		{
+			writePng(tmpDir + "/server/" + key(name), width);
+		}
+
+		/**
+		 * Add an image to the cache.
+		 * @param name Name.
+		 * @param width Image width.
+		 */
+		void addToCache(const char *name, int width)
+		{
+			writePng(tmpDir + "/.cache/rom-properties/" + key(name), width);
+		}
+
+		/**
+		 * Add a negative entry to the cache.
+		 * @param name Name.
+		 */
+		void addNegativeToCache(const char *name)
+		{
+			writeFile(tmpDir + "/.cache/rom-properties/" + key(name), "");
+		}
+
+		/**
+		 * Create a download candidate.
+		 * @param name Name.
+		 * @param download If false, only check the cache.
+		 * @return Candidate.
+		 */
+		ExtImageFetcher::Candidate candidate(const char *name, bool download = true) const
+		{
+			ExtImageFetcher::Candidate c;
+			c.cache_key = key(name);
+			c.download = download;
+			return c;
+		}
+
+		/**
+		 * Get the cache keys requested from the fake rp-download.
+		 * @return Cache keys, sorted.
+		 */
+		static vector<string> requests(void)
+		{
+			vector<string> ret;
+			for (const FakeRpDownload::Request &req : FakeRpDownload::requests(tmpDir)) {
+				ret.push_back(req.key);
+			}
+			std::sort(ret.begin(), ret.end());
+			return ret;
+		}
+
+	public:
+		static string tmpDir;		// Temporary directory. (also $HOME)
+		string prefix;			// Cache key prefix for this test.
+		ExtImageFetcher fetcher;
+};
+
+string ExtImageFetcherTest::tmpDir;
+
+/**
+ * The first candidate is in the cache.
+ * Nothing is downloaded.
+ */
+TEST_F(ExtImageFetcherTest, cachedFirstCandidate)
+{
+	addToCache("a", 10);
+	addToCache("b", 11);
+	addToServer("a", 20);
+
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a"));
+	candidates.push_back(candidate("b"));
+
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	ASSERT_TRUE(img != nullptr);
+	EXPECT_EQ(0, idx);
+	EXPECT_EQ(10, img->width());
+	EXPECT_TRUE(requests().empty());
+}
+
+/**
+ * Negative cache entries and cache-only candidates that
+ * aren't cached are skipped without downloading anything.
+ */
+TEST_F(ExtImageFetcherTest, cachedSkipsUnavailable)
+{
+	addNegativeToCache("a");
+	addToServer("a", 20);
+	addToServer("b", 21);
+	addToCache("c", 12);
+
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a"));
+	candidates.push_back(candidate("b", false));
+	candidates.push_back(candidate("c"));
+
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	ASSERT_TRUE(img != nullptr);
+	EXPECT_EQ(2, idx);
+	EXPECT_EQ(12, img->width());
+	EXPECT_TRUE(requests().empty());
+}
+
+/**
+ * A higher-priority candidate that needs to be downloaded
+ * takes precedence over a lower-priority cached candidate.
+ */
+TEST_F(ExtImageFetcherTest, downloadBeforeCached)
+{
+	addToServer("a", 20);
+	addToCache("b", 11);
+
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a"));
+	candidates.push_back(candidate("b"));
+
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	ASSERT_TRUE(img != nullptr);
+	EXPECT_EQ(0, idx);
+	EXPECT_EQ(20, img->width());
+
+	const vector<string> reqs = requests();
+	ASSERT_EQ(1U, reqs.size());
+	EXPECT_EQ(key("a"), reqs[0]);
+}
+
+/**
+ * The highest-priority successful candidate is returned,
+ * even if a lower-priority candidate finishes first.
+ */
+TEST_F(ExtImageFetcherTest, bestIndex)
+{
+	addToServer("b-slow", 21);
+	addToServer("c", 22);
+	addToServer("d", 23);
+
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a"));		// not on the server
+	candidates.push_back(candidate("b-slow"));
+	candidates.push_back(candidate("c"));
+	candidates.push_back(candidate("d"));
+
+	fetcher.setMaxThreads(4);
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	ASSERT_TRUE(img != nullptr);
+	EXPECT_EQ(1, idx);
+	EXPECT_EQ(21, img->width());
+
+	// "c" was downloaded while "b-slow" was still in progress.
+	// NOTE: "d" may be skipped if "c" finishes before it's started.
+	const vector<string> reqs = requests();
+	ASSERT_GE(reqs.size(), 3U);
+	EXPECT_EQ(key("a"), reqs[0]);
+	EXPECT_EQ(key("b-slow"), reqs[1]);
+	EXPECT_EQ(key("c"), reqs[2]);
+}
+
+/**
+ * With one thread, candidates after the first
+ * successful candidate are not downloaded.
+ */
+TEST_F(ExtImageFetcherTest, bestIndexSingleThread)
+{
+	addToServer("b", 21);
+	addToServer("c", 22);
+
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a"));		// not on the server
+	candidates.push_back(candidate("b"));
+	candidates.push_back(candidate("c"));
+
+	fetcher.setMaxThreads(1);
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	ASSERT_TRUE(img != nullptr);
+	EXPECT_EQ(1, idx);
+	EXPECT_EQ(21, img->width());
+
+	const vector<string> reqs = requests();
+	ASSERT_EQ(2U, reqs.size());
+	EXPECT_EQ(key("a"), reqs[0]);
+	EXPECT_EQ(key("b"), reqs[1]);
+}
+
+/**
+ * fetchFirst() returns as soon as the first candidate succeeds,
+ * without waiting for lower-priority downloads that are still
+ * in progress. Those downloads finish in the background.
+ */
+TEST_F(ExtImageFetcherTest, noWaitForLowerPriority)
+{
+	addToServer("a-short", 20);
+	addToServer("b-hang", 21);
+
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a-short"));
+	candidates.push_back(candidate("b-hang"));
+
+	fetcher.setMaxThreads(2);
+	struct timespec ts_start, ts_end;
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	ASSERT_TRUE(img != nullptr);
+	EXPECT_EQ(0, idx);
+	EXPECT_EQ(20, img->width());
+
+	const long ms = ((ts_end.tv_sec - ts_start.tv_sec) * 1000) +
+	                ((ts_end.tv_nsec - ts_start.tv_nsec) / 1000000);
+	EXPECT_LT(ms, 2000) << "fetchFirst() waited for the lower-priority download.";
+
+	// Wait for the lower-priority download to finish in the background.
+	for (int i = 0; i < 100; i++) {
+		if (CacheManager::cacheState(key("b-hang")) == CacheManager::CS_CACHED)
+			break;
+		usleep(100000);
+	}
+	EXPECT_EQ(CacheManager::CS_CACHED, CacheManager::cacheState(key("b-hang")));
+}
+
+/**
+ * Candidates that fail to download, or that download
+ * successfully but aren't valid images, are skipped.
+ */
+TEST_F(ExtImageFetcherTest, failedCandidate)
+{
+	writeFile(tmpDir + "/server/" + key("b"), "This is not a PNG image.");
+	addToServer("c", 22);
+
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a"));		// not on the server
+	candidates.push_back(candidate("b"));		// invalid image
+	candidates.push_back(candidate("c"));
+
+	fetcher.setMaxThreads(2);
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	ASSERT_TRUE(img != nullptr);
+	EXPECT_EQ(2, idx);
+	EXPECT_EQ(22, img->width());
+
+	// The missing candidate now has a negative cache entry.
+	EXPECT_EQ(CacheManager::CS_NEGATIVE, CacheManager::cacheState(key("a")));
+}
+
+/**
+ * If no candidates can be loaded, nullptr is returned.
+ */
+TEST_F(ExtImageFetcherTest, allCandidatesFailed)
+{
+	vector<ExtImageFetcher::Candidate> candidates;
+	candidates.push_back(candidate("a"));
+	candidates.push_back(candidate("b"));
+	candidates.push_back(candidate("c", false));
+
+	int idx = -2;
+	unique_ptr<rp_image> img(fetcher.fetchFirst(candidates, &idx));
+	EXPECT_TRUE(img == nullptr);
+	EXPECT_EQ(-1, idx);
+	EXPECT_EQ(2U, requests().size());
+
+	// Negative cache entries prevent the candidates
+	// from being downloaded again.
+	unlink((tmpDir + "/requests.log").c_str());
+	img.reset(fetcher.fetchFirst(candidates, &idx));
+	EXPECT_TRUE(img == nullptr);
+	EXPECT_EQ(-1, idx);
+	EXPECT_TRUE(requests().empty());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: ExtImageFetcher tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
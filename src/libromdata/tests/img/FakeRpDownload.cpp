@@ -0,0 +1,176 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * FakeRpDownload.cpp: Fake rp-download for the CacheManager tests.        *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "common.h"
+#include "FakeRpDownload.hpp"
+
+// librpfile
+#include "librpfile/FileSystem.hpp"
+using namespace LibRpFile;
+
+// C includes.
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+// C++ includes.
+#include <fstream>
+#include <sstream>
+using std::string;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+// Fake rp-download script.
+// See FakeRpDownload.hpp for a description.
+static const char fake_rp_download[] =
+	"#!/bin/sh\n"
+	"while read -r key; do\n"
+	"\techo \"$$ $key $http_proxy\" >> \"$HOME/requests.log\"\n"
+	"\tcase \"$key\" in\n"
+	"\t\tcrash-once)\n"
+	"\t\t\tif [ ! -e \"$HOME/crashed\" ]; then\n"
+	"\t\t\t\t: > \"$HOME/crashed\"\n"
+	"\t\t\t\tkill -9 $$\n"
+	"\t\t\tfi\n"
+	"\t\t\t;;\n"
+	"\t\tcrash) kill -9 $$ ;;\n"
+	"\t\thang) exec sleep 60 ;;\n"
+	"\t\t*short*) sleep 0.3 ;;\n"
+	"\t\t*slow*) sleep 1 ;;\n"
+	"\t\t*hang*) sleep 3 ;;\n"
+	"\tesac\n"
+	"\tdest=\"$HOME/.cache/rom-properties/$key\"\n"
+	"\tmkdir -p \"${dest%/*}\"\n"
+	"\tif [ -f \"$HOME/server/$key\" ]; then\n"
+	"\t\tcp \"$HOME/server/$key\" \"$dest\"\n"
+	"\t\techo 0\n"
+	"\telse\n"
+	"\t\t: > \"$dest\"\n"
+	"\t\techo 1\n"
+	"\tfi\n"
+	"done\n";
+
+// Fake rp-download executable.
+// NOTE: CacheManager doesn't copy the filename.
+static string rpDownloadExe;
+
+/**
+ * Create a temporary directory with the fake rp-download
+ * and tell CacheManager to use it.
+ *
+ * $HOME is set to the temporary directory, and the
+ * XDG cache and proxy environment variables are unset.
+ *
+ * @param name Name prefix for the temporary directory.
+ * @param timeout_ms Response timeout, in milliseconds. (0 for the default)
+ * @return Temporary directory, or empty string on error.
+ */
+string FakeRpDownload::create(const char *name, int timeout_ms)
+{
+	string tmpl = string("/tmp/") + name + ".XXXXXX";
+	if (!mkdtemp(&tmpl[0])) {
+		return string();
+	}
+	setenv("HOME", tmpl.c_str(), 1);
+	unsetenv("XDG_CACHE_HOME");
+	unsetenv("http_proxy");
+	unsetenv("https_proxy");
+
+	rpDownloadExe = tmpl + "/rp-download";
+	FILE *const f = fopen(rpDownloadExe.c_str(), "w");
+	if (!f) {
+		rmdir(tmpl.c_str());
+		return string();
+	}
+	fwrite(fake_rp_download, 1, sizeof(fake_rp_download) - 1, f);
+	fclose(f);
+	chmod(rpDownloadExe.c_str(), 0755);
+
+	TestCacheManager::setRpDownloadExe(rpDownloadExe.c_str(), timeout_ms);
+	return tmpl;
+}
+
+/**
+ * Restore the default rp-download and delete a directory tree.
+ * @param tmpDir Temporary directory from create().
+ */
+void FakeRpDownload::destroy(const string &tmpDir)
+{
+	if (tmpDir.empty())
+		return;
+
+	TestCacheManager::setRpDownloadExe(nullptr, 0);
+	rpDownloadExe.clear();
+	removeTree(tmpDir);
+}
+
+/**
+ * Delete a directory tree.
+ * @param path Directory.
+ */
+void FakeRpDownload::removeTree(const string &path)
+{
+	nftw(path.c_str(), [](const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf) -> int {
+		RP_UNUSED(sb);
+		RP_UNUSED(typeflag);
+		RP_UNUSED(ftwbuf);
+		return remove(fpath);
+	}, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/**
+ * Add a file to the fake server.
+ * @param homeDir $HOME used by rp-download.
+ * @param cache_key Cache key.
+ * @param data File contents.
+ * @param size Size of data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int FakeRpDownload::addToServer(const string &homeDir, const string &cache_key,
+	const void *data, size_t size)
+{
+	const string filename = homeDir + "/server/" + cache_key;
+	int ret = FileSystem::rmkdir(filename);
+	if (ret != 0)
+		return ret;
+
+	FILE *const f = fopen(filename.c_str(), "wb");
+	if (!f)
+		return -errno;
+	const size_t written = fwrite(data, 1, size, f);
+	fclose(f);
+	return (written == size ? 0 : -EIO);
+}
+
+/**
+ * Get the requests received by the fake rp-download.
+ * @param homeDir $HOME used by rp-download.
+ * @return Requests, in the order they were received.
+ */
+vector<FakeRpDownload::Request> FakeRpDownload::requests(const string &homeDir)
+{
+	vector<Request> ret;
+	std::ifstream log(homeDir + "/requests.log");
+	string line;
+	while (std::getline(log, line)) {
+		std::istringstream iss(line);
+		Request req;
+		req.pid = -1;
+		iss >> req.pid >> req.key >> req.proxy;
+		ret.push_back(req);
+	}
+	return ret;
+}
+
+} }
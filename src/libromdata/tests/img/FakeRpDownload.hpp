@@ -0,0 +1,111 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * FakeRpDownload.hpp: Fake rp-download for the CacheManager tests.        *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_TESTS_IMG_FAKERPDOWNLOAD_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_TESTS_IMG_FAKERPDOWNLOAD_HPP__
+
+#include "common.h"
+
+// libromdata
+#include "img/CacheManager.hpp"
+
+// C includes.
+#include <sys/types.h>
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+namespace LibRomData { namespace Tests {
+
+/**
+ * CacheManager with access to the rp-download helper functions.
+ */
+class TestCacheManager : public CacheManager
+{
+	public:
+		using CacheManager::execRpDownload;
+		using CacheManager::setRpDownloadExe;
+};
+
+/**
+ * Fake rp-download.
+ *
+ * Each request is logged to $HOME/requests.log as "pid key http_proxy".
+ * Files are "downloaded" from $HOME/server/ into the cache. If the file
+ * isn't present, a negative cache entry is created and the download fails.
+ *
+ * Some cache keys change the behavior:
+ * - "crash-once": Crash the first time; download normally after a restart.
+ * - "crash": Always crash without responding.
+ * - "hang": Never respond.
+ * - Keys containing "short", "slow", or "hang" take 0.3, 1, or
+ *   3 seconds to download.
+ */
+class FakeRpDownload
+{
+	private:
+		// FakeRpDownload is a static class.
+		FakeRpDownload();
+		~FakeRpDownload();
+		RP_DISABLE_COPY(FakeRpDownload)
+
+	public:
+		/**
+		 * Create a temporary directory with the fake rp-download
+		 * and tell CacheManager to use it.
+		 *
+		 * $HOME is set to the temporary directory, and the
+		 * XDG cache and proxy environment variables are unset.
+		 *
+		 * @param name Name prefix for the temporary directory.
+		 * @param timeout_ms Response timeout, in milliseconds. (0 for the default)
+		 * @return Temporary directory, or empty string on error.
+		 */
+		static std::string create(const char *name, int timeout_ms);
+
+		/**
+		 * Restore the default rp-download and delete a directory tree.
+		 * @param tmpDir Temporary directory from create().
+		 */
+		static void destroy(const std::string &tmpDir);
+
+		/**
+		 * Delete a directory tree.
+		 * @param path Directory.
+		 */
+		static void removeTree(const std::string &path);
+
+		/**
+		 * Add a file to the fake server.
+		 * @param homeDir $HOME used by rp-download.
+		 * @param cache_key Cache key.
+		 * @param data File contents.
+		 * @param size Size of data.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int addToServer(const std::string &homeDir, const std::string &cache_key,
+			const void *data, size_t size);
+
+		struct Request {
+			pid_t pid;
+			std::string key;
+			std::string proxy;
+		};
+
+		/**
+		 * Get the requests received by the fake rp-download.
+		 * @param homeDir $HOME used by rp-download.
+		 * @return Requests, in the order they were received.
+		 */
+		static std::vector<Request> requests(const std::string &homeDir);
+};
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_TESTS_IMG_FAKERPDOWNLOAD_HPP__ */
@@ -0,0 +1,302 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * ImageForSizeTest.cpp: Mipmap selection for thumbnails.                  *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase, librpfile, librptexture
+#include "common.h"
+#include "librpbase/RomData.hpp"
+#include "librpcpu/byteswap.h"
+#include "librpfile/RpMemFile.hpp"
+#include "librptexture/img/rp_image.hpp"
+#include "librptexture/fileformat/DirectDrawSurface.hpp"
+#include "librptexture/fileformat/dds_structs.h"
+#include "librptexture/fileformat/PowerVR3.hpp"
+#include "librptexture/fileformat/pvr3_structs.h"
+using namespace LibRpBase;
+using namespace LibRpFile;
+using namespace LibRpTexture;
+
+// libromdata
+#include "Other/RpTextureWrapper.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+class ImageForSizeTest : public ::testing::Test
+{
+	protected:
+		ImageForSizeTest()
+			: m_file(nullptr)
+		{ }
+
+		void SetUp(void) final
+		{
+			makeDDS(256, 128, MIPMAP_COUNT);
+			m_file = new RpMemFile(m_dds.data(), m_dds.size());
+		}
+
+		void TearDown(void) final
+		{
+			if (m_file) {
+				m_file->unref();
+				m_file = nullptr;
+			}
+		}
+
+	public:
+		// Number of mipmaps in the test texture:
+		// 256x128, 128x64, 64x32, 32x16, 16x8, 8x4, 4x2, 2x1, 1x1
+		static const int MIPMAP_COUNT = 9;
+
+		/**
+		 * Get the color used for a mipmap level.
+		 * @param mip Mipmap level.
+		 * @return ARGB32 color.
+		 */
+		static inline uint32_t mipColor(int mip)
+		{
+			return 0xFF000000U | (static_cast<uint32_t>(mip) * 0x1D1D1DU);
+		}
+
+		/**
+		 * Create an uncompressed ARGB32 DDS texture.
+		 * Each mipmap level is filled with mipColor(mip).
+		 * @param width Width.
+		 * @param height Height.
+		 * @param mipmapCount Number of mipmaps.
+		 */
+		void makeDDS(int width, int height, int mipmapCount)
+		{
+			DDS_HEADER ddsHeader;
+			memset(&ddsHeader, 0, sizeof(ddsHeader));
+			ddsHeader.dwSize = cpu_to_le32(sizeof(ddsHeader));
+			ddsHeader.dwFlags = cpu_to_le32(DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH |
+				DDSD_PITCH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT);
+			ddsHeader.dwHeight = cpu_to_le32(height);
+			ddsHeader.dwWidth = cpu_to_le32(width);
+			ddsHeader.dwPitchOrLinearSize = cpu_to_le32(width * 4);
+			ddsHeader.dwMipMapCount = cpu_to_le32(mipmapCount);
+			ddsHeader.ddspf.dwSize = cpu_to_le32(sizeof(ddsHeader.ddspf));
+			ddsHeader.ddspf.dwFlags = cpu_to_le32(DDPF_RGB | DDPF_ALPHAPIXELS);
+			ddsHeader.ddspf.dwRGBBitCount = cpu_to_le32(32);
+			ddsHeader.ddspf.dwRBitMask = cpu_to_le32(0x00FF0000);
+			ddsHeader.ddspf.dwGBitMask = cpu_to_le32(0x0000FF00);
+			ddsHeader.ddspf.dwBBitMask = cpu_to_le32(0x000000FF);
+			ddsHeader.ddspf.dwABitMask = cpu_to_le32(0xFF000000);
+			ddsHeader.dwCaps = cpu_to_le32(DDSCAPS_COMPLEX | DDSCAPS_MIPMAP | DDSCAPS_TEXTURE);
+
+			const uint32_t magic = cpu_to_be32(DDS_MAGIC);
+			m_dds.resize(sizeof(magic) + sizeof(ddsHeader));
+			memcpy(m_dds.data(), &magic, sizeof(magic));
+			memcpy(&m_dds[sizeof(magic)], &ddsHeader, sizeof(ddsHeader));
+
+			for (int mip = 0; mip < mipmapCount; mip++) {
+				const int mip_w = std::max(width >> mip, 1);
+				const int mip_h = std::max(height >> mip, 1);
+				const uint32_t color = cpu_to_le32(mipColor(mip));
+				for (int i = 0; i < mip_w * mip_h; i++) {
+					const uint8_t *const p = reinterpret_cast<const uint8_t*>(&color);
+					m_dds.insert(m_dds.end(), p, p + sizeof(color));
+				}
+			}
+		}
+
+		/**
+		 * Create an uncompressed ABGR8888 PowerVR 3.0 texture.
+		 * Each mipmap level is filled with mipColor(mip).
+		 * @param pvr3 Output buffer.
+		 * @param width Width.
+		 * @param height Height.
+		 * @param mipmapCount Number of mipmaps.
+		 */
+		static void makePVR3(vector<uint8_t> &pvr3, int width, int height, int mipmapCount)
+		{
+			PowerVR3_Header pvr3Header;
+			memset(&pvr3Header, 0, sizeof(pvr3Header));
+			pvr3Header.version = cpu_to_le32(PVR3_VERSION_HOST);
+			pvr3Header.pixel_format = cpu_to_le32('abgr');
+			pvr3Header.channel_depth = cpu_to_le32(0x08080808);
+			pvr3Header.channel_type = cpu_to_le32(PVR3_CHTYPE_UBYTE_NORM);
+			pvr3Header.height = cpu_to_le32(height);
+			pvr3Header.width = cpu_to_le32(width);
+			pvr3Header.depth = cpu_to_le32(1);
+			pvr3Header.num_surfaces = cpu_to_le32(1);
+			pvr3Header.num_faces = cpu_to_le32(1);
+			pvr3Header.mipmap_count = cpu_to_le32(mipmapCount);
+
+			const uint8_t *const p = reinterpret_cast<const uint8_t*>(&pvr3Header);
+			pvr3.assign(p, p + sizeof(pvr3Header));
+
+			// The mipmap colors are gray, so the channel order
+			// doesn't matter as long as alpha is in the high byte.
+			for (int mip = 0; mip < mipmapCount; mip++) {
+				const int mip_w = std::max(width >> mip, 1);
+				const int mip_h = std::max(height >> mip, 1);
+				const uint32_t color = cpu_to_le32(mipColor(mip));
+				for (int i = 0; i < mip_w * mip_h; i++) {
+					const uint8_t *const pc = reinterpret_cast<const uint8_t*>(&color);
+					pvr3.insert(pvr3.end(), pc, pc + sizeof(color));
+				}
+			}
+		}
+
+		/**
+		 * Check that an image is the specified mipmap.
+		 * @param img Image.
+		 * @param mip Expected mipmap level.
+		 */
+		static void checkMipmap(const rp_image *img, int mip)
+		{
+			ASSERT_TRUE(img != nullptr);
+			EXPECT_EQ(std::max(256 >> mip, 1), img->width());
+			EXPECT_EQ(std::max(128 >> mip, 1), img->height());
+			ASSERT_EQ(rp_image::FORMAT_ARGB32, img->format());
+			EXPECT_EQ(mipColor(mip), *static_cast<const uint32_t*>(img->bits()));
+		}
+
+	public:
+		vector<uint8_t> m_dds;	// DDS texture.
+		RpMemFile *m_file;	// DDS texture file.
+};
+
+/**
+ * FileFormat::mipmapForSize(): Mipmap selection.
+ */
+TEST_F(ImageForSizeTest, mipmapForSize)
+{
+	DirectDrawSurface *const dds = new DirectDrawSurface(m_file);
+	ASSERT_TRUE(dds->isValid());
+	const int expectedMipmapCount = MIPMAP_COUNT;
+	ASSERT_EQ(expectedMipmapCount, dds->mipmapCount());
+
+	// Exact match: The largest dimension is the requested size.
+	checkMipmap(dds->mipmapForSize(256), 0);
+	checkMipmap(dds->mipmapForSize(64), 2);
+	checkMipmap(dds->mipmapForSize(1), 8);
+
+	// Smallest mipmap that's larger than the requested size.
+	checkMipmap(dds->mipmapForSize(255), 0);
+	checkMipmap(dds->mipmapForSize(100), 1);
+	checkMipmap(dds->mipmapForSize(33), 2);
+	checkMipmap(dds->mipmapForSize(3), 6);
+
+	// Larger than mipmap 0.
+	checkMipmap(dds->mipmapForSize(257), 0);
+	checkMipmap(dds->mipmapForSize(4096), 0);
+
+	// Invalid sizes return the full image.
+	checkMipmap(dds->mipmapForSize(0), 0);
+	checkMipmap(dds->mipmapForSize(-1), 0);
+
+	dds->unref();
+}
+
+/**
+ * FileFormat::mipmapForSize(): Textures without mipmaps.
+ */
+TEST_F(ImageForSizeTest, mipmapForSize_noMipmaps)
+{
+	m_file->unref();
+	makeDDS(256, 128, 1);
+	m_file = new RpMemFile(m_dds.data(), m_dds.size());
+
+	DirectDrawSurface *const dds = new DirectDrawSurface(m_file);
+	ASSERT_TRUE(dds->isValid());
+	checkMipmap(dds->mipmapForSize(64), 0);
+	checkMipmap(dds->mipmapForSize(512), 0);
+	dds->unref();
+}
+
+/**
+ * FileFormat::mipmapForSize(): PowerVR 3.0 textures.
+ * Loading a mipmap must not replace the full image.
+ */
+TEST_F(ImageForSizeTest, mipmapForSize_PowerVR3)
+{
+	// PowerVR3 can't halve a 1-pixel dimension, so stop at 2x1.
+	static const int pvr3MipmapCount = MIPMAP_COUNT - 1;
+	vector<uint8_t> pvr3;
+	makePVR3(pvr3, 256, 128, pvr3MipmapCount);
+	RpMemFile *const pvr3File = new RpMemFile(pvr3.data(), pvr3.size());
+
+	PowerVR3 *const pvr = new PowerVR3(pvr3File);
+	pvr3File->unref();
+	ASSERT_TRUE(pvr->isValid());
+	ASSERT_EQ(pvr3MipmapCount, pvr->mipmapCount());
+
+	checkMipmap(pvr->mipmapForSize(64), 2);
+	checkMipmap(pvr->mipmapForSize(5), 5);
+	checkMipmap(pvr->mipmapForSize(2), 7);
+	checkMipmap(pvr->image(), 0);
+	checkMipmap(pvr->mipmapForSize(64), 2);
+	checkMipmap(pvr->mipmap(7), 7);
+
+	pvr->unref();
+}
+
+/**
+ * RomData::imageForSize(): The full size is always the size of mipmap 0.
+ */
+TEST_F(ImageForSizeTest, imageForSize)
+{
+	RomData *const romData = new RpTextureWrapper(m_file);
+	ASSERT_TRUE(romData->isValid());
+
+	static const struct {
+		int req_size;
+		int mip;
+	} sizes[] = {
+		{256, 0},	// exact match (mipmap 0)
+		{32, 3},	// exact match
+		{100, 1},	// smallest larger mipmap
+		{5, 5},		// smallest larger mipmap
+		{1000, 0},	// larger than mipmap 0
+	};
+
+	for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+		SCOPED_TRACE(testing::Message() << "req_size == " << sizes[i].req_size);
+		int fullSize[2] = {0, 0};
+		const rp_image *const img = romData->imageForSize(RomData::IMG_INT_IMAGE, sizes[i].req_size, fullSize);
+		checkMipmap(img, sizes[i].mip);
+		EXPECT_EQ(256, fullSize[0]);
+		EXPECT_EQ(128, fullSize[1]);
+	}
+
+	// Unsupported image types.
+	int fullSize[2] = {0, 0};
+	EXPECT_TRUE(romData->imageForSize(RomData::IMG_INT_ICON, 64, fullSize) == nullptr);
+
+	romData->unref();
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: imageForSize() tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -11,10 +11,17 @@
 #include "RomData_p.hpp"
 
 #include "libi18n/i18n.h"
+#include "config/Config.hpp"
+#include "hash/MultiHash.hpp"
+#include "disc/IDiscReader.hpp"
+#include "disc/PartitionFile.hpp"
 
 // librpthreads
 #include "librpthreads/Atomics.h"
 
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+
 // C++ STL classes.
 using std::string;
 using std::vector;
@@ -43,6 +50,8 @@ RomDataPrivate::RomDataPrivate(RomData *q, IRpFile *file)
 	, className(nullptr)
 	, mimeType(nullptr)
 	, fileType(RomData::FTYPE_ROM_IMAGE)
+	, hashesTab(false)
+	, hashesTabAdded(false)
 {
 	// Initialize i18n.
 	rp_i18n_init();
@@ -64,6 +73,154 @@ RomDataPrivate::~RomDataPrivate()
 	}
 }
 
+/** "Hashes" tab **/
+
+/**
+ * Add the "Hashes" tab to the fields.
+ * The fields must have been loaded already.
+ */
+void RomDataPrivate::addHashesTab(void)
+{
+	if (hashesTabAdded)
+		return;
+	hashesTabAdded = true;
+
+	if (fields->tabCount() == 1 && !fields->tabName(0)) {
+		// The ROM's fields are in a single unnamed tab.
+		// Name it after the system so it's still shown.
+		fields->setTabName(0, q_ptr->systemName(
+			RomData::SYSNAME_TYPE_LONG | RomData::SYSNAME_REGION_GENERIC));
+	}
+	fields->addTab_deferred(C_("RomData", "Hashes"), loadTab_Hashes, q_ptr);
+}
+
+/**
+ * Load the "Hashes" tab.
+ * @param fields RomFields object.
+ * @param userdata RomData object.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataPrivate::loadTab_Hashes(RomFields *fields, void *userdata)
+{
+	RomData *const romData = static_cast<RomData*>(userdata);
+	IRpFile *const file = romData->openHashSource();
+	if (!file) {
+		// Nothing to hash.
+		return -EBADF;
+	}
+
+	// Disc images that are split into multiple image files,
+	// e.g. cue sheets, are hashed using the image files.
+	vector<IRpFile*> imageFiles;
+	PartitionFile *const partFile = dynamic_cast<PartitionFile*>(file);
+	IDiscReader *const partition = (partFile ? partFile->partition() : nullptr);
+	int ret = (partition ? partition->openImageFiles(imageFiles) : -ENOTSUP);
+	if (ret == -ENOTSUP) {
+		// Hash the data directly.
+		ret = addFields_hashes(fields, file);
+		file->unref();
+		return ret;
+	}
+	file->unref();
+
+	if (ret != 0) {
+		// The image files couldn't be opened.
+		// Hashing the disc image data wouldn't match
+		// the original files, so show an error instead.
+		fields->addField_string(C_("RomData", "Warning"),
+			C_("RomData", "Unable to open all of the disc image's track files."),
+			RomFields::STRF_WARNING);
+		return 0;
+	}
+
+	if (imageFiles.size() == 1) {
+		// Single image file.
+		ret = addFields_hashes(fields, imageFiles[0]);
+		imageFiles[0]->unref();
+		return ret;
+	}
+
+	// Multiple image files. Show a table.
+	auto *const vv_hashes = new RomFields::ListData_t();
+	vv_hashes->reserve(imageFiles.size());
+	ret = 0;
+	for (IRpFile *imageFile : imageFiles) {
+		if (ret == 0) {
+			MultiHash hash;
+			ret = hash.hashFile(imageFile);
+			if (ret == 0) {
+				// Show the filename without the directory.
+				string filename = imageFile->filename();
+#ifdef _WIN32
+				const size_t slash_pos = filename.find_last_of("\\/");
+#else /* !_WIN32 */
+				const size_t slash_pos = filename.find_last_of('/');
+#endif /* _WIN32 */
+				if (slash_pos != string::npos) {
+					filename.erase(0, slash_pos + 1);
+				}
+
+				vv_hashes->resize(vv_hashes->size()+1);
+				auto &data_row = vv_hashes->at(vv_hashes->size()-1);
+				data_row.reserve(5);
+				data_row.emplace_back(std::move(filename));
+				data_row.emplace_back(formatFileSize(static_cast<off64_t>(hash.dataSize())));
+				data_row.emplace_back(hash.crc32String());
+				data_row.emplace_back(hash.md5String());
+				data_row.emplace_back(hash.sha1String());
+			}
+		}
+		imageFile->unref();
+	}
+	if (ret != 0) {
+		// Read error.
+		delete vv_hashes;
+		return ret;
+	}
+
+	static const char *const hashes_headers[] = {
+		NOP_C_("RomData|Hashes", "File"),
+		NOP_C_("RomData|Hashes", "Size"),
+		"CRC32",
+		"MD5",
+		"SHA-1",
+	};
+	vector<string> *const v_hashes_headers = RomFields::strArrayToVector_i18n(
+		"RomData|Hashes", hashes_headers, ARRAY_SIZE(hashes_headers));
+
+	RomFields::AFLD_PARAMS params;
+	params.headers = v_hashes_headers;
+	params.data.single = vv_hashes;
+	fields->addField_listData(C_("RomData", "Track Files"), &params);
+	return 0;
+}
+
+/**
+ * Hash a file and add its hash fields.
+ * @param fields RomFields object.
+ * @param file File to hash.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomDataPrivate::addFields_hashes(RomFields *fields, IRpFile *file)
+{
+	MultiHash hash;
+	int ret = hash.hashFile(file);
+	if (ret != 0) {
+		// Read error.
+		return ret;
+	}
+
+	const uint64_t dataSize = hash.dataSize();
+	fields->addField_string(C_("RomData", "Data Size"),
+		rp_sprintf_p(C_("RomData", "%1$s (%2$llu bytes)"),
+			formatFileSize(static_cast<off64_t>(dataSize)).c_str(),
+			static_cast<unsigned long long>(dataSize)));
+	fields->addField_string("CRC32", hash.crc32String(), RomFields::STRF_MONOSPACE);
+	fields->addField_string("MD5", hash.md5String(), RomFields::STRF_MONOSPACE);
+	fields->addField_string("SHA-1", hash.sha1String(), RomFields::STRF_MONOSPACE);
+	return 0;
+}
+
 /** Convenience functions. **/
 
 /**
@@ -718,6 +875,25 @@ int RomData::loadMetaData(void)
  * @return ROM Fields object.
  */
 const RomFields *RomData::fields(void) const
+{
+	return fields(~0U);
+}
+
+/**
+ * Get the ROM Fields object, loading only the specified tabs.
+ *
+ * Some tabs may be expensive to load. If only some of the tabs
+ * are needed, this function can be used to skip loading the
+ * other tabs. Tabs that weren't requested might be empty.
+ * Calling fields() afterwards will load the remaining tabs.
+ *
+ * NOTE: Tab indexes may change once all tabs have been loaded,
+ * since deferred tabs that don't have any fields are removed.
+ *
+ * @param tabMask Bitfield of tab indexes to load. (bit 0 == tab 0)
+ * @return ROM Fields object.
+ */
+const RomFields *RomData::fields(uint32_t tabMask) const
 {
 	RP_D(const RomData);
 	if (d->fields->empty()) {
@@ -726,6 +902,15 @@ const RomFields *RomData::fields(void) const
 		int ret = const_cast<RomData*>(this)->loadFieldData();
 		if (ret < 0)
 			return nullptr;
+
+		if (d->hashesTab || Config::instance()->showHashesTab()) {
+			// Add the "Hashes" tab.
+			const_cast<RomDataPrivate*>(d)->addHashesTab();
+		}
+	}
+	if (d->fields->hasDeferredTabs()) {
+		// Load the requested deferred tabs.
+		d->fields->loadTabs(tabMask);
 	}
 	return d->fields;
 }
@@ -787,6 +972,33 @@ const rp_image *RomData::image(ImageType imageType) const
 	return (ret == 0 ? img : nullptr);
 }
 
+/**
+ * Get an internal image for a thumbnail of the requested size.
+ *
+ * Subclasses that have multiple sizes of the same image,
+ * e.g. textures with mipmaps, can return the smallest one
+ * that's at least req_size instead of the full image.
+ * The default implementation returns image().
+ *
+ * NOTE: The rp_image is owned by this object.
+ * Do NOT delete this object until you're done using this rp_image.
+ *
+ * @param imageType	[in] Image type to load.
+ * @param req_size	[in] Requested size. (single dimension; assuming square image)
+ * @param pFullSize	[out,opt] Two-element array for the full image size. [width, height]
+ * @return Internal image, or nullptr if the ROM doesn't have one.
+ */
+const rp_image *RomData::imageForSize(ImageType imageType, int req_size, int pFullSize[2]) const
+{
+	RP_UNUSED(req_size);
+	const rp_image *const img = this->image(imageType);
+	if (img && pFullSize) {
+		pFullSize[0] = img->width();
+		pFullSize[1] = img->height();
+	}
+	return img;
+}
+
 /**
  * Get a list of URLs for an external image type.
  *
@@ -905,4 +1117,44 @@ bool RomData::hasDangerousPermissions(void) const
 	return false;
 }
 
+/** Hashes **/
+
+/**
+ * Open the data to hash for the "Hashes" tab.
+ *
+ * This is usually the ROM file itself. Subclasses that
+ * read from sparse or compressed disc images return the
+ * expanded disc image instead, so the hashes match the
+ * original disc.
+ *
+ * NOTE: The returned file may reference internal objects,
+ * so it must be unref()'d before this object is closed.
+ *
+ * @return IRpFile*, or nullptr if there's nothing to hash. (Must be unref()'d by the caller.)
+ */
+IRpFile *RomData::openHashSource(void)
+{
+	RP_D(RomData);
+	return (d->file ? d->file->ref() : nullptr);
+}
+
+/**
+ * Enable the "Hashes" tab.
+ *
+ * The tab shows the CRC32, MD5, and SHA-1 of the data
+ * returned by openHashSource(). Hashing reads all of the
+ * data, so the tab is only added if this function is called,
+ * or if the ShowHashesTab option is enabled. It's loaded
+ * as a deferred tab.
+ */
+void RomData::enableHashesTab(void)
+{
+	RP_D(RomData);
+	d->hashesTab = true;
+	if (!d->fields->empty()) {
+		// Fields were already loaded.
+		d->addHashesTab();
+	}
+}
+
 }
@@ -392,6 +392,10 @@ class RomData
 		/**
 		 * Load field data.
 		 * Called by RomData::fields() if the field data hasn't been loaded yet.
+		 *
+		 * Expensive tabs can be added using RomFields::addTab_deferred().
+		 * Deferred tabs are loaded by RomData::fields() when requested.
+		 *
 		 * @return 0 on success; negative POSIX error code on error.
 		 */
 		virtual int loadFieldData(void) = 0;
@@ -399,6 +403,13 @@ class RomData
 		/**
 		 * Load metadata properties.
 		 * Called by RomData::metaData() if the field data hasn't been loaded yet.
+		 *
+		 * Metadata is used by file indexers, so this must be cheap:
+		 * - Don't call loadFieldData() or fields().
+		 * - Only use data that was read by the constructor, plus
+		 *   small, bounded reads. (e.g. a tag block or banner)
+		 * - Never read the whole file.
+		 *
 		 * @return Number of metadata properties read on success; negative POSIX error code on error.
 		 */
 		virtual int loadMetaData(void);
@@ -422,6 +433,22 @@ class RomData
 		 */
 		const RomFields *fields(void) const;
 
+		/**
+		 * Get the ROM Fields object, loading only the specified tabs.
+		 *
+		 * Some tabs may be expensive to load. If only some of the tabs
+		 * are needed, this function can be used to skip loading the
+		 * other tabs. Tabs that weren't requested might be empty.
+		 * Calling fields() afterwards will load the remaining tabs.
+		 *
+		 * NOTE: Tab indexes may change once all tabs have been loaded,
+		 * since deferred tabs that don't have any fields are removed.
+		 *
+		 * @param tabMask Bitfield of tab indexes to load. (bit 0 == tab 0)
+		 * @return ROM Fields object.
+		 */
+		const RomFields *fields(uint32_t tabMask) const;
+
 		/**
 		 * Get the ROM Metadata object.
 		 * @return ROM Metadata object.
@@ -448,6 +475,24 @@ class RomData
 		 */
 		const LibRpTexture::rp_image *image(ImageType imageType) const;
 
+		/**
+		 * Get an internal image for a thumbnail of the requested size.
+		 *
+		 * Subclasses that have multiple sizes of the same image,
+		 * e.g. textures with mipmaps, can return the smallest one
+		 * that's at least req_size instead of the full image.
+		 * The default implementation returns image().
+		 *
+		 * NOTE: The rp_image is owned by this object.
+		 * Do NOT delete this object until you're done using this rp_image.
+		 *
+		 * @param imageType	[in] Image type to load.
+		 * @param req_size	[in] Requested size. (single dimension; assuming square image)
+		 * @param pFullSize	[out,opt] Two-element array for the full image size. [width, height]
+		 * @return Internal image, or nullptr if the ROM doesn't have one.
+		 */
+		virtual const LibRpTexture::rp_image *imageForSize(ImageType imageType, int req_size, int pFullSize[2] = nullptr) const;
+
 		/**
 		 * External URLs for a media type.
 		 * Includes URL and "cache key" for local caching,
@@ -534,6 +579,35 @@ class RomData
 		 * @return True if the ROM image has "dangerous" permissions; false if not.
 		 */
 		virtual bool hasDangerousPermissions(void) const;
+
+	public:
+		/** Hashes **/
+
+		/**
+		 * Open the data to hash for the "Hashes" tab.
+		 *
+		 * This is usually the ROM file itself. Subclasses that
+		 * read from sparse or compressed disc images return the
+		 * expanded disc image instead, so the hashes match the
+		 * original disc.
+		 *
+		 * NOTE: The returned file may reference internal objects,
+		 * so it must be unref()'d before this object is closed.
+		 *
+		 * @return IRpFile*, or nullptr if there's nothing to hash. (Must be unref()'d by the caller.)
+		 */
+		virtual LibRpFile::IRpFile *openHashSource(void);
+
+		/**
+		 * Enable the "Hashes" tab.
+		 *
+		 * The tab shows the CRC32, MD5, and SHA-1 of the data
+		 * returned by openHashSource(). Hashing reads all of the
+		 * data, so the tab is only added if this function is called,
+		 * or if the ShowHashesTab option is enabled. It's loaded
+		 * as a deferred tab.
+		 */
+		void enableHashesTab(void);
 };
 
 }
@@ -204,6 +204,21 @@ class klass : public LibRpBase::RomData { \
 		 */ \
 		int loadInternalImage(ImageType imageType, const LibRpTexture::rp_image **pImage) final;
 
+/**
+ * RomData subclass function declaration for getting internal images
+ * for a requested thumbnail size, e.g. using mipmaps.
+ */
+#define ROMDATA_DECL_IMGFORSIZE() \
+	public: \
+		/** \
+		 * Get an internal image for a thumbnail of the requested size. \
+		 * @param imageType	[in] Image type to load. \
+		 * @param req_size	[in] Requested size. (single dimension; assuming square image) \
+		 * @param pFullSize	[out,opt] Two-element array for the full image size. [width, height] \
+		 * @return Internal image, or nullptr if the ROM doesn't have one. \
+		 */ \
+		const LibRpTexture::rp_image *imageForSize(ImageType imageType, int req_size, int pFullSize[2] = nullptr) const final;
+
 /**
  * RomData subclass function declaration for obtaining URLs for external images.
  */
@@ -253,6 +268,18 @@ class klass : public LibRpBase::RomData { \
 		 */ \
 		bool hasDangerousPermissions(void) const final;
 
+/**
+ * RomData subclass function declaration for hashing a different data source.
+ * Only needed if the hashed data isn't the ROM file itself.
+ */
+#define ROMDATA_DECL_HASHSOURCE() \
+	public: \
+		/** \
+		 * Open the data to hash for the "Hashes" tab. \
+		 * @return IRpFile*, or nullptr if there's nothing to hash. (Must be unref()'d by the caller.) \
+		 */ \
+		LibRpFile::IRpFile *openHashSource(void) final;
+
 /**
  * RomData subclass function declaration for closing the internal file handle.
  * Only needed if extra handling is needed, e.g. if multiple files are opened.
@@ -65,6 +65,33 @@ class RomDataPrivate
 		const char *mimeType;		// MIME type. (ASCII) (default is nullptr)
 		RomData::FileType fileType;	// File type. (default is FTYPE_ROM_IMAGE)
 
+	public:
+		/** "Hashes" tab **/
+		bool hashesTab;			// Set by RomData::enableHashesTab().
+		bool hashesTabAdded;		// True if the "Hashes" tab was added to the fields.
+
+		/**
+		 * Add the "Hashes" tab to the fields.
+		 * The fields must have been loaded already.
+		 */
+		void addHashesTab(void);
+
+		/**
+		 * Load the "Hashes" tab.
+		 * @param fields RomFields object.
+		 * @param userdata RomData object.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int loadTab_Hashes(RomFields *fields, void *userdata);
+
+		/**
+		 * Hash a file and add its hash fields.
+		 * @param fields RomFields object.
+		 * @param file File to hash.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int addFields_hashes(RomFields *fields, LibRpFile::IRpFile *file);
+
 	public:
 		/** Convenience functions. **/
 
@@ -42,6 +42,18 @@ class RomFieldsPrivate
 		// Tab names.
 		vector<string> tabNames;
 
+		// Deferred tabs that haven't been loaded yet.
+		struct DeferredTab {
+			RomFields::TabLoader_t loader;
+			void *userdata;
+			uint8_t tabIdx;
+		};
+		vector<DeferredTab> deferredTabs;
+
+		// Deferred tabs that didn't have any fields.
+		// These tabs will be removed once all deferred tabs are loaded.
+		vector<uint8_t> emptyDeferredTabs;
+
 		// Default language code.
 		// Set by the first call to addField_string_multi()
 		// and/or addField_listData with RFT_LISTDATA_MULTI.
@@ -52,6 +64,13 @@ class RomFieldsPrivate
 		 * The vector will be cleared afterwards.
 		 */
 		void delete_data(void);
+
+		/**
+		 * Remove deferred tabs that didn't have any fields.
+		 * Other tabs are never removed, even if they're empty.
+		 * Fields in the remaining tabs are renumbered.
+		 */
+		void removeEmptyTabs(void);
 };
 
 /** RomFieldsPrivate **/
@@ -122,6 +141,67 @@ void RomFieldsPrivate::delete_data(void)
 	this->fields.clear();
 }
 
+/**
+ * Remove deferred tabs that didn't have any fields.
+ * Other tabs are never removed, even if they're empty.
+ * Fields in the remaining tabs are renumbered.
+ */
+void RomFieldsPrivate::removeEmptyTabs(void)
+{
+	const int count = static_cast<int>(tabNames.size());
+	if (count <= 1 || emptyDeferredTabs.empty()) {
+		// Nothing to remove.
+		emptyDeferredTabs.clear();
+		return;
+	}
+
+	// Determine which tabs can be removed.
+	// NOTE: Another tab's loader might have added fields
+	// to an empty deferred tab, so check the field count.
+	vector<bool> canRemove(count);
+	for (uint8_t emptyTabIdx : emptyDeferredTabs) {
+		if (emptyTabIdx < count) {
+			canRemove[emptyTabIdx] = true;
+		}
+	}
+	emptyDeferredTabs.clear();
+	for (const RomFields::Field &field : fields) {
+		if (field.tabIdx < count) {
+			canRemove[field.tabIdx] = false;
+		}
+	}
+
+	// Remove the empty tabs and determine the new tab indexes.
+	vector<uint8_t> newTabIdx(count);
+	int dest = 0;
+	for (int i = 0; i < count; i++) {
+		newTabIdx[i] = static_cast<uint8_t>(dest);
+		if (canRemove[i]) {
+			// Empty deferred tab.
+			continue;
+		}
+		if (dest != i) {
+			tabNames[dest] = std::move(tabNames[i]);
+		}
+		dest++;
+	}
+	if (dest == count) {
+		// No tabs were removed.
+		return;
+	}
+	tabNames.resize(dest);
+
+	// Renumber the fields.
+	for (RomFields::Field &field : fields) {
+		if (field.tabIdx < count) {
+			field.tabIdx = newTabIdx[field.tabIdx];
+		}
+	}
+	if (tabIdx < count) {
+		tabIdx = newTabIdx[tabIdx];
+	}
+}
+
 /** RomFields **/
 
 /**
@@ -584,6 +664,110 @@ const char *RomFields::tabName(int tabIdx) const
 	return d->tabNames[tabIdx].c_str();
 }
 
+/** Deferred tabs **/
+
+/**
+ * Add a deferred tab to the end.
+ *
+ * The tab's fields won't be added until the tab is
+ * requested using loadTabs(). If the tab loader doesn't
+ * add any fields, the tab will be hidden.
+ *
+ * NOTE: The current tab index is not changed.
+ *
+ * @param name Tab name.
+ * @param loader Tab loader function.
+ * @param userdata User data for the tab loader function.
+ * @return Tab index.
+ */
+int RomFields::addTab_deferred(const char *name, TabLoader_t loader, void *userdata)
+{
+	assert(loader != nullptr);
+	RP_D(RomFields);
+	d->tabNames.emplace_back(name ? name : "");
+	const int tabIdx = static_cast<int>(d->tabNames.size() - 1);
+
+	RomFieldsPrivate::DeferredTab dtab;
+	dtab.loader = loader;
+	dtab.userdata = userdata;
+	dtab.tabIdx = static_cast<uint8_t>(tabIdx);
+	d->deferredTabs.push_back(dtab);
+	return tabIdx;
+}
+
+/**
+ * Are there any deferred tabs that haven't been loaded yet?
+ * @return True if there are; false if not.
+ */
+bool RomFields::hasDeferredTabs(void) const
+{
+	RP_D(const RomFields);
+	return !d->deferredTabs.empty();
+}
+
+/**
+ * Load deferred tabs.
+ *
+ * Fields in newly-loaded tabs are kept in tab order.
+ * Once all deferred tabs have been loaded, deferred
+ * tabs that didn't have any fields are removed, and
+ * the remaining tabs are renumbered.
+ *
+ * @param tabMask Bitfield of tab indexes to load. (bit 0 == tab 0; ~0U for all tabs)
+ * @return Number of tabs loaded.
+ */
+int RomFields::loadTabs(uint32_t tabMask)
+{
+	RP_D(RomFields);
+	if (d->deferredTabs.empty()) {
+		// No deferred tabs.
+		return 0;
+	}
+
+	const uint8_t prevTabIdx = d->tabIdx;
+	int loaded = 0;
+	for (size_t i = 0; i < d->deferredTabs.size(); ) {
+		const RomFieldsPrivate::DeferredTab dtab = d->deferredTabs[i];
+		if (tabMask != ~0U && (dtab.tabIdx >= 32 || !(tabMask & (1U << dtab.tabIdx)))) {
+			// Tab was not requested.
+			i++;
+			continue;
+		}
+
+		// Remove the tab from the deferred list before loading it
+		// in case the loader requests more tabs.
+		d->deferredTabs.erase(d->deferredTabs.begin() + i);
+
+		const size_t prevCount = d->fields.size();
+		d->tabIdx = dtab.tabIdx;
+		dtab.loader(this, dtab.userdata);
+		if (d->fields.size() == prevCount) {
+			// No fields were added. Hide the tab.
+			d->tabNames[dtab.tabIdx].clear();
+			d->emptyDeferredTabs.push_back(dtab.tabIdx);
+		}
+		loaded++;
+	}
+	d->tabIdx = prevTabIdx;
+
+	if (loaded > 0) {
+		// Fields from deferred tabs were added to the end.
+		// Sort the fields by tab index. The original order
+		// within each tab is retained.
+		std::stable_sort(d->fields.begin(), d->fields.end(),
+			[](const Field &a, const Field &b) {
+				return (a.tabIdx < b.tabIdx);
+			});
+	}
+
+	if (d->deferredTabs.empty() && !d->emptyDeferredTabs.empty()) {
+		// All deferred tabs have been loaded.
+		// Remove the empty ones.
+		d->removeEmptyTabs();
+	}
+	return loaded;
+}
+
 /**
  * Get the default language code for RFT_STRING_MULTI and RFT_LISTDATA_MULTI.
  * @return Default language code, or 0 if not set.
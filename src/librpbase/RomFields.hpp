@@ -424,6 +424,54 @@ class RomFields
 		 */
 		const char *tabName(int tabIdx) const;
 
+		/** Deferred tabs **/
+
+		/**
+		 * Tab loader function.
+		 * Called by loadTabs() to add fields to a deferred tab.
+		 * The deferred tab is selected as the current tab before
+		 * the loader is called.
+		 * @param fields RomFields object.
+		 * @param userdata User data specified in addTab_deferred().
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		typedef int (*TabLoader_t)(RomFields *fields, void *userdata);
+
+		/**
+		 * Add a deferred tab to the end.
+		 *
+		 * The tab's fields won't be added until the tab is
+		 * requested using loadTabs(). If the tab loader doesn't
+		 * add any fields, the tab will be hidden.
+		 *
+		 * NOTE: The current tab index is not changed.
+		 *
+		 * @param name Tab name.
+		 * @param loader Tab loader function.
+		 * @param userdata User data for the tab loader function.
+		 * @return Tab index.
+		 */
+		int addTab_deferred(const char *name, TabLoader_t loader, void *userdata);
+
+		/**
+		 * Are there any deferred tabs that haven't been loaded yet?
+		 * @return True if there are; false if not.
+		 */
+		bool hasDeferredTabs(void) const;
+
+		/**
+		 * Load deferred tabs.
+		 *
+		 * Fields in newly-loaded tabs are kept in tab order.
+		 * Once all deferred tabs have been loaded, deferred
+		 * tabs that didn't have any fields are removed, and
+		 * the remaining tabs are renumbered.
+		 *
+		 * @param tabMask Bitfield of tab indexes to load. (bit 0 == tab 0; ~0U for all tabs)
+		 * @return Number of tabs loaded.
+		 */
+		int loadTabs(uint32_t tabMask);
+
 		/**
 		 * Get the default language code for RFT_STRING_MULTI and RFT_LISTDATA_MULTI.
 		 * @return Default language code, or 0 if not set.
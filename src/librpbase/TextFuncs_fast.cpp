@@ -0,0 +1,377 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_fast.cpp: Text encoding functions. (built-in converters)      *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "TextFuncs.hpp"
+#include "TextFuncs_fast.hpp"
+#include "TextFuncs_cp932_tbl.hpp"
+
+// librpcpu
+#include "librpcpu/cpu_dispatch.h"
+#ifdef RP_CPU_AMD64
+// amd64 CPUs all support SSE2 as a minimum,
+// so the SSE2 ASCII check is always used.
+# include <emmintrin.h>
+#endif /* RP_CPU_AMD64 */
+
+// C++ STL classes.
+using std::string;
+using std::u16string;
+
+// Most strings in ROM headers are either pure ASCII or use one of
+// a handful of code pages, so they're decoded here instead of going
+// through the OS text conversion functions.
+
+namespace LibRpBase {
+
+/**
+ * Get the length of the pure ASCII prefix of a string.
+ * @param str	[in] 8-bit text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes before the first non-ASCII byte. (len if the entire string is ASCII)
+ */
+size_t ascii_prefix_len(const char *str, size_t len)
+{
+	const char *p = str;
+	const char *const end = str + len;
+
+#ifdef RP_CPU_AMD64
+	// Check 16 bytes at a time.
+	for (; end - p >= 16; p += 16) {
+		const __m128i xmm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if (_mm_movemask_epi8(xmm) != 0) {
+			// Found a non-ASCII byte.
+			break;
+		}
+	}
+#else /* !RP_CPU_AMD64 */
+	// Check 8 bytes at a time.
+	for (; end - p >= 8; p += 8) {
+		uint64_t qword;
+		memcpy(&qword, p, sizeof(qword));
+		if (qword & 0x8080808080808080ULL) {
+			// Found a non-ASCII byte.
+			break;
+		}
+	}
+#endif /* RP_CPU_AMD64 */
+
+	// Find the exact position of the first non-ASCII byte.
+	for (; p < end; p++) {
+		if (static_cast<uint8_t>(*p) & 0x80)
+			break;
+	}
+	return static_cast<size_t>(p - str);
+}
+
+/** Output helpers **/
+
+/**
+ * Append ASCII text to a UTF-8 string.
+ * @param ret	[in/out] UTF-8 string.
+ * @param str	[in] ASCII text.
+ * @param len	[in] Length of str, in bytes.
+ */
+static inline void append_ascii(string &ret, const char *str, size_t len)
+{
+	ret.append(str, len);
+}
+
+/**
+ * Append ASCII text to a UTF-16 string.
+ * @param ret	[in/out] UTF-16 string.
+ * @param str	[in] ASCII text.
+ * @param len	[in] Length of str, in bytes.
+ */
+static inline void append_ascii(u16string &ret, const char *str, size_t len)
+{
+	const size_t pos = ret.size();
+	ret.resize(pos + len);
+	char16_t *dest = &ret[pos];
+	for (; len > 0; len--) {
+		*dest++ = static_cast<char16_t>(*str++);
+	}
+}
+
+/**
+ * Append a Unicode BMP code point to a UTF-8 string.
+ * @param ret	[in/out] UTF-8 string.
+ * @param ch16	[in] Code point.
+ */
+static inline void append_ch16(string &ret, char16_t ch16)
+{
+	if (ch16 < 0x0080) {
+		ret += static_cast<char>(ch16);
+	} else if (ch16 < 0x0800) {
+		ret += static_cast<char>(0xC0 | (ch16 >> 6));
+		ret += static_cast<char>(0x80 | (ch16 & 0x3F));
+	} else {
+		ret += static_cast<char>(0xE0 | (ch16 >> 12));
+		ret += static_cast<char>(0x80 | ((ch16 >> 6) & 0x3F));
+		ret += static_cast<char>(0x80 | (ch16 & 0x3F));
+	}
+}
+
+/**
+ * Append a Unicode BMP code point to a UTF-16 string.
+ * @param ret	[in/out] UTF-16 string.
+ * @param ch16	[in] Code point.
+ */
+static inline void append_ch16(u16string &ret, char16_t ch16)
+{
+	ret += ch16;
+}
+
+/** Decoders **/
+// NOTE: These functions start decoding at the first non-ASCII
+// byte, so ASCII is handled inline where it's still possible.
+
+/**
+ * Decode Latin-1 text.
+ * @param ret	[in/out] Output string.
+ * @param p	[in] Latin-1 text.
+ * @param end	[in] End of the text.
+ */
+template<typename StrT>
+static void decode_latin1(StrT &ret, const uint8_t *p, const uint8_t *const end)
+{
+	for (; p < end; p++) {
+		append_ch16(ret, *p);
+	}
+}
+
+/**
+ * Decode cp1252 text.
+ * @param ret	[in/out] Output string.
+ * @param p	[in] cp1252 text.
+ * @param end	[in] End of the text.
+ * @return True on success; false if an undefined character was found.
+ */
+template<typename StrT>
+static bool decode_cp1252(StrT &ret, const uint8_t *p, const uint8_t *const end)
+{
+	// cp1252 is identical to Latin-1, except for 0x80-0x9F.
+	// 0 == undefined
+	static const char16_t cp1252_80_9F[32] = {
+		// 0x80
+		0x20AC, 0x0000, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+		0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x0000, 0x017D, 0x0000,
+		// 0x90
+		0x0000, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+		0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x0000, 0x017E, 0x0178,
+	};
+
+	for (; p < end; p++) {
+		char16_t ch16 = *p;
+		if ((ch16 & 0xE0) == 0x80) {
+			ch16 = cp1252_80_9F[ch16 & 0x1F];
+			if (ch16 == 0) {
+				// Undefined character.
+				return false;
+			}
+		}
+		append_ch16(ret, ch16);
+	}
+	return true;
+}
+
+/**
+ * Decode cp932 text.
+ * @param ret	[in/out] Output string.
+ * @param p	[in] cp932 text.
+ * @param end	[in] End of the text.
+ * @return True on success; false if an invalid or unmapped sequence was found.
+ */
+template<typename StrT>
+static bool decode_cp932(StrT &ret, const uint8_t *p, const uint8_t *const end)
+{
+	while (p < end) {
+		const uint8_t lead = *p++;
+		if (lead < 0x80) {
+			// ASCII
+			append_ch16(ret, lead);
+			continue;
+		} else if (lead >= 0xA1 && lead <= 0xDF) {
+			// Half-width katakana
+			append_ch16(ret, 0xFF61 + (lead - 0xA1));
+			continue;
+		}
+
+		// Double-byte character.
+		if (lead == 0x80 || lead == 0xA0 || lead >= 0xFD) {
+			// Not a valid lead byte.
+			return false;
+		} else if (p >= end) {
+			// Incomplete sequence.
+			return false;
+		}
+		const uint8_t trail = *p++;
+		if (trail < CP932_TRAIL_FIRST || trail > CP932_TRAIL_LAST) {
+			// Not a valid trail byte.
+			return false;
+		}
+		const char16_t ch16 = cp932_dbcs_tbl[CP932_LEAD_IDX(lead)][trail - CP932_TRAIL_FIRST];
+		if (ch16 == 0) {
+			// Unmapped character.
+			return false;
+		}
+		append_ch16(ret, ch16);
+	}
+	return true;
+}
+
+/**
+ * Convert 8-bit text using the built-in conversion tables.
+ * @param ret	[out] Output string.
+ * @param cp	[in] Code page number.
+ * @param str	[in] 8-bit text.
+ * @param len	[in] Length of str, in bytes.
+ * @return True if the text was converted; false if the caller needs to use the OS functions.
+ */
+template<typename StrT>
+static bool fast_cpN_decode(StrT &ret, unsigned int cp, const char *str, int len)
+{
+	switch (cp) {
+		case CP_ACP:	// TODO: Get the system code page. (Assuming cp1252.)
+		case 1252:
+		case CP_LATIN1:
+		case CP_SJIS:
+		case CP_UTF8:
+			break;
+		default:
+			// Not supported.
+			return false;
+	}
+
+	ret.clear();
+	if (len <= 0) {
+		// Empty string.
+		return true;
+	}
+
+	// All of the supported code pages are ASCII supersets,
+	// so the ASCII prefix doesn't need to be converted.
+	const size_t prefix = ascii_prefix_len(str, static_cast<size_t>(len));
+	if (prefix == static_cast<size_t>(len)) {
+		// Pure ASCII.
+		append_ascii(ret, str, prefix);
+		return true;
+	} else if (cp == CP_UTF8) {
+		// Only pure ASCII is handled for UTF-8.
+		return false;
+	}
+
+	ret.reserve(len + ((len - prefix) / 2));
+	append_ascii(ret, str, prefix);
+	const uint8_t *const p = reinterpret_cast<const uint8_t*>(str) + prefix;
+	const uint8_t *const end = reinterpret_cast<const uint8_t*>(str) + len;
+
+	// Fallback order matches the iconv() code path:
+	// cp932 -> cp1252 -> Latin-1
+	switch (cp) {
+		case CP_SJIS:
+			if (decode_cp932(ret, p, end))
+				break;
+			ret.resize(prefix);
+			// fall through
+		case CP_ACP:
+		case 1252:
+			if (decode_cp1252(ret, p, end))
+				break;
+			ret.resize(prefix);
+			// fall through
+		case CP_LATIN1:
+		default:
+			decode_latin1(ret, p, end);
+			break;
+	}
+	return true;
+}
+
+/**
+ * Convert 8-bit text to UTF-8 using the built-in conversion tables.
+ *
+ * cp1252, Latin-1, and cp932 are decoded using built-in tables.
+ * Pure ASCII text is handled for UTF-8 as well.
+ *
+ * Invalid sequences are handled the same way as the iconv() code path:
+ * - cp932: If invalid, the entire string is decoded as cp1252.
+ * - cp1252: If invalid, the entire string is decoded as Latin-1.
+ *
+ * @param ret	[out] UTF-8 string.
+ * @param cp	[in] Code page number.
+ * @param str	[in] 8-bit text. (NULL terminator must already be trimmed.)
+ * @param len	[in] Length of str, in bytes.
+ * @return True if the text was converted; false if the caller needs to use the OS functions.
+ */
+bool fast_cpN_to_utf8(string &ret, unsigned int cp, const char *str, int len)
+{
+	return fast_cpN_decode(ret, cp, str, len);
+}
+
+/**
+ * Convert 8-bit text to UTF-16 using the built-in conversion tables.
+ *
+ * cp1252, Latin-1, and cp932 are decoded using built-in tables.
+ * Pure ASCII text is handled for UTF-8 as well.
+ *
+ * Invalid sequences are handled the same way as the iconv() code path:
+ * - cp932: If invalid, the entire string is decoded as cp1252.
+ * - cp1252: If invalid, the entire string is decoded as Latin-1.
+ *
+ * @param ret	[out] UTF-16 string.
+ * @param cp	[in] Code page number.
+ * @param str	[in] 8-bit text. (NULL terminator must already be trimmed.)
+ * @param len	[in] Length of str, in bytes.
+ * @return True if the text was converted; false if the caller needs to use the OS functions.
+ */
+bool fast_cpN_to_utf16(u16string &ret, unsigned int cp, const char *str, int len)
+{
+	return fast_cpN_decode(ret, cp, str, len);
+}
+
+/**
+ * Convert UTF-8 to 8-bit text using the built-in fast path.
+ *
+ * Only pure ASCII text is handled, since it's identical
+ * in UTF-8 and all of the supported 8-bit code pages.
+ *
+ * @param ret	[out] 8-bit text.
+ * @param cp	[in] Code page number.
+ * @param str	[in] UTF-8 text. (NULL terminator must already be trimmed.)
+ * @param len	[in] Length of str, in bytes.
+ * @return True if the text was converted; false if the caller needs to use the OS functions.
+ */
+bool fast_utf8_to_cpN(string &ret, unsigned int cp, const char *str, int len)
+{
+	switch (cp) {
+		case CP_ACP:
+		case 1252:
+		case CP_LATIN1:
+		case CP_SJIS:
+		case CP_UTF8:
+			break;
+		default:
+			// Not supported.
+			return false;
+	}
+
+	if (len <= 0) {
+		// Empty string.
+		ret.clear();
+		return true;
+	} else if (ascii_prefix_len(str, static_cast<size_t>(len)) != static_cast<size_t>(len)) {
+		// Not pure ASCII.
+		return false;
+	}
+
+	ret.assign(str, len);
+	return true;
+}
+
+}
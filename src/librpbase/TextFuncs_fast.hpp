@@ -0,0 +1,83 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * TextFuncs_fast.hpp: Text encoding functions. (built-in converters)      *
+ *                                                                         *
+ * Copyright (c) 2009-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_FAST_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_FAST_HPP__
+
+// NOTE: These functions are used internally by the OS-specific
+// text conversion functions. They should not be used directly.
+
+// C includes. (C++ namespace)
+#include <cstddef>
+
+// C++ includes.
+#include <string>
+
+namespace LibRpBase {
+
+/**
+ * Get the length of the pure ASCII prefix of a string.
+ * @param str	[in] 8-bit text.
+ * @param len	[in] Length of str, in bytes.
+ * @return Number of bytes before the first non-ASCII byte. (len if the entire string is ASCII)
+ */
+size_t ascii_prefix_len(const char *str, size_t len);
+
+/**
+ * Convert 8-bit text to UTF-8 using the built-in conversion tables.
+ *
+ * cp1252, Latin-1, and cp932 are decoded using built-in tables.
+ * Pure ASCII text is handled for UTF-8 as well.
+ *
+ * Invalid sequences are handled the same way as the iconv() code path:
+ * - cp932: If invalid, the entire string is decoded as cp1252.
+ * - cp1252: If invalid, the entire string is decoded as Latin-1.
+ *
+ * @param ret	[out] UTF-8 string.
+ * @param cp	[in] Code page number.
+ * @param str	[in] 8-bit text. (NULL terminator must already be trimmed.)
+ * @param len	[in] Length of str, in bytes.
+ * @return True if the text was converted; false if the caller needs to use the OS functions.
+ */
+bool fast_cpN_to_utf8(std::string &ret, unsigned int cp, const char *str, int len);
+
+/**
+ * Convert 8-bit text to UTF-16 using the built-in conversion tables.
+ *
+ * cp1252, Latin-1, and cp932 are decoded using built-in tables.
+ * Pure ASCII text is handled for UTF-8 as well.
+ *
+ * Invalid sequences are handled the same way as the iconv() code path:
+ * - cp932: If invalid, the entire string is decoded as cp1252.
+ * - cp1252: If invalid, the entire string is decoded as Latin-1.
+ *
+ * @param ret	[out] UTF-16 string.
+ * @param cp	[in] Code page number.
+ * @param str	[in] 8-bit text. (NULL terminator must already be trimmed.)
+ * @param len	[in] Length of str, in bytes.
+ * @return True if the text was converted; false if the caller needs to use the OS functions.
+ */
+bool fast_cpN_to_utf16(std::u16string &ret, unsigned int cp, const char *str, int len);
+
+/**
+ * Convert UTF-8 to 8-bit text using the built-in fast path.
+ *
+ * Only pure ASCII text is handled, since it's identical
+ * in UTF-8 and all of the supported 8-bit code pages.
+ *
+ * @param ret	[out] 8-bit text.
+ * @param cp	[in] Code page number.
+ * @param str	[in] UTF-8 text. (NULL terminator must already be trimmed.)
+ * @param len	[in] Length of str, in bytes.
+ * @return True if the text was converted; false if the caller needs to use the OS functions.
+ */
+bool fast_utf8_to_cpN(std::string &ret, unsigned int cp, const char *str, int len);
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_TEXTFUNCS_FAST_HPP__ */
@@ -10,6 +10,7 @@
 #include "config.librpbase.h"
 #include "TextFuncs.hpp"
 #include "TextFuncs_NULL.hpp"
+#include "TextFuncs_fast.hpp"
 
 #if defined(_WIN32)
 # error TextFuncs_iconv.cpp is not supported on Windows.
@@ -44,6 +45,133 @@ using std::u16string;
 
 namespace LibRpBase {
 
+/** iconv descriptor cache. **/
+
+/**
+ * Per-thread iconv descriptor cache.
+ *
+ * iconv_open() is expensive, and RomData subclasses convert
+ * lots of short strings, so descriptors are kept open and
+ * reused. Each thread has its own cache, since an iconv
+ * descriptor can't be used by multiple threads at once.
+ */
+class IconvCache
+{
+	public:
+		IconvCache()
+			: next(0)
+		{
+			memset(slots, 0, sizeof(slots));
+		}
+
+		~IconvCache()
+		{
+			for (auto &slot : slots) {
+				if (slot.src_charset[0] != '\0') {
+					iconv_close(slot.cd);
+				}
+			}
+		}
+
+	private:
+		RP_DISABLE_COPY(IconvCache)
+
+	public:
+		/**
+		 * Get an iconv descriptor.
+		 * The descriptor's conversion state is reset.
+		 * @param src_charset	[in] Source character set.
+		 * @param dest_charset	[in] Destination character set.
+		 * @param ignoreErr	[in] If true, ignore errors. ("//IGNORE" on glibc/libiconv)
+		 * @return iconv descriptor, or (iconv_t)(-1) on error. (Owned by the cache; don't close it!)
+		 */
+		iconv_t get(const char *src_charset, const char *dest_charset, bool ignoreErr);
+
+	private:
+		struct slot_t {
+			char src_charset[24];	// empty if the slot is unused
+			char dest_charset[24];
+			bool ignoreErr;
+			iconv_t cd;
+		};
+
+		// Enough for every conversion used by a single RomData subclass.
+		static const unsigned int SLOT_COUNT = 8;
+		slot_t slots[SLOT_COUNT];
+		unsigned int next;	// next slot to replace
+};
+
+/**
+ * Get an iconv descriptor.
+ * The descriptor's conversion state is reset.
+ * @param src_charset	[in] Source character set.
+ * @param dest_charset	[in] Destination character set.
+ * @param ignoreErr	[in] If true, ignore errors. ("//IGNORE" on glibc/libiconv)
+ * @return iconv descriptor, or (iconv_t)(-1) on error. (Owned by the cache; don't close it!)
+ */
+iconv_t IconvCache::get(const char *src_charset, const char *dest_charset, bool ignoreErr)
+{
+	for (auto &slot : slots) {
+		if (slot.src_charset[0] != '\0' &&
+		    slot.ignoreErr == ignoreErr &&
+		    !strcmp(slot.src_charset, src_charset) &&
+		    !strcmp(slot.dest_charset, dest_charset))
+		{
+			// Found a cached descriptor.
+			// Reset its conversion state.
+			iconv(slot.cd, nullptr, nullptr, nullptr, nullptr);
+			return slot.cd;
+		}
+	}
+
+	// Not cached. Open a new iconv descriptor.
+	iconv_t cd;
+#if defined(__linux__) || defined(HAVE_ICONV_LIBICONV)
+	// glibc/libiconv: Append "//IGNORE" to the source character set
+	// if ignoreErr == true.
+	// TODO: Destination, not source?
+	if (ignoreErr) {
+		char tmpsrc[32];
+		snprintf(tmpsrc, sizeof(tmpsrc), "%s//IGNORE", src_charset);
+		cd = iconv_open(dest_charset, tmpsrc);
+	} else {
+		// Not ignoring errors.
+		cd = iconv_open(dest_charset, src_charset);
+	}
+#else
+	cd = iconv_open(dest_charset, src_charset);
+#endif
+
+	if (cd == (iconv_t)(-1)) {
+		// Error opening iconv.
+		return cd;
+	}
+
+	if (strlen(src_charset) >= sizeof(slots[0].src_charset) ||
+	    strlen(dest_charset) >= sizeof(slots[0].dest_charset))
+	{
+		// Character set names are too long to cache.
+		// This shouldn't happen with the names used here.
+		assert(!"Character set name is too long.");
+		iconv_close(cd);
+		return (iconv_t)(-1);
+	}
+
+	// Replace the oldest slot.
+	slot_t &slot = slots[next];
+	next = (next + 1) % SLOT_COUNT;
+	if (slot.src_charset[0] != '\0') {
+		iconv_close(slot.cd);
+	}
+	strcpy(slot.src_charset, src_charset);
+	strcpy(slot.dest_charset, dest_charset);
+	slot.ignoreErr = ignoreErr;
+	slot.cd = cd;
+	return cd;
+}
+
+static thread_local IconvCache iconvCache;
+
 /** OS-specific text conversion functions. **/
 
 /**
@@ -75,24 +203,8 @@ static char *rp_iconv(const char *src, int len,
 	// * http://www.delorie.com/gnu/docs/glibc/libc_101.html
 	// * http://www.codase.com/search/call?name=iconv
 
-	// Open an iconv descriptor.
-	iconv_t cd;
-#if defined(__linux__) || defined(HAVE_ICONV_LIBICONV)
-	// glibc/libiconv: Append "//IGNORE" to the source character set
-	// if ignoreErr == true.
-	// TODO: Destination, not source?
-	if (ignoreErr) {
-		char tmpsrc[32];
-		snprintf(tmpsrc, sizeof(tmpsrc), "%s//IGNORE", src_charset);
-		cd = iconv_open(dest_charset, tmpsrc);
-	} else {
-		// Not ignoring errors.
-		cd = iconv_open(dest_charset, src_charset);
-	}
-#else
-	cd = iconv_open(dest_charset, src_charset);
-#endif
-
+	// Get an iconv descriptor.
+	iconv_t cd = iconvCache.get(src_charset, dest_charset, ignoreErr);
 	if (cd == (iconv_t)(-1)) {
 		// Error opening iconv.
 		return nullptr;
@@ -137,9 +249,6 @@ static char *rp_iconv(const char *src, int len,
 		}
 	}
 
-	// Close the iconv descriptor.
-	iconv_close(cd);
-
 	if (success) {
 		// The string was converted successfully.
 
@@ -203,6 +312,12 @@ string cpN_to_utf8(unsigned int cp, const char *str, int len, unsigned int flags
 {
 	len = check_NULL_terminator(str, len);
 
+	// Check the built-in conversion tables first.
+	string ret;
+	if (fast_cpN_to_utf8(ret, cp, str, len)) {
+		return ret;
+	}
+
 	// Get the encoding name for the primary code page.
 	char cp_name[20];
 	codePageToEncName(cp_name, sizeof(cp_name), cp);
@@ -214,7 +329,6 @@ string cpN_to_utf8(unsigned int cp, const char *str, int len, unsigned int flags
 	// Attempt to convert the text to UTF-8.
 	// NOTE: "//IGNORE" sometimes doesn't work, so we won't
 	// check for TEXTCONV_FLAG_CP1252_FALLBACK here.
-	string ret;
 	char *mbs = reinterpret_cast<char*>(rp_iconv((char*)str, len*sizeof(*str), cp_name, "UTF-8", ignoreErr));
 	if (!mbs /*&& (flags & TEXTCONV_FLAG_CP1252_FALLBACK)*/) {
 		// Try cp1252 fallback.
@@ -233,22 +347,6 @@ string cpN_to_utf8(unsigned int cp, const char *str, int len, unsigned int flags
 	if (mbs) {
 		ret.assign(mbs);
 		free(mbs);
-
-#ifdef HAVE_ICONV_LIBICONV
-		if (cp == CP_SJIS) {
-			// libiconv's cp932 maps Shift-JIS 8160 to U+301C. This is expected
-			// behavior for Shift-JIS, but cp932 should map it to U+FF5E.
-			for (auto p = ret.begin(); p != ret.end(); ++p) {
-				if ((uint8_t)p[0] == 0xE3 && (uint8_t)p[1] == 0x80 && (uint8_t)p[2] == 0x9C) {
-					// Found a wave dash.
-					p[0] = (uint8_t)0xEF;
-					p[1] = (uint8_t)0xBD;
-					p[2] = (uint8_t)0x9E;
-					p += 2;
-				}
-			}
-		}
-#endif /* HAVE_ICONV_LIBICONV */
 	}
 	return ret;
 }
@@ -269,6 +367,12 @@ u16string cpN_to_utf16(unsigned int cp, const char *str, int len, unsigned int f
 {
 	len = check_NULL_terminator(str, len);
 
+	// Check the built-in conversion tables first.
+	u16string ret;
+	if (fast_cpN_to_utf16(ret, cp, str, len)) {
+		return ret;
+	}
+
 	// Get the encoding name for the primary code page.
 	char cp_name[20];
 	codePageToEncName(cp_name, sizeof(cp_name), cp);
@@ -280,7 +384,6 @@ u16string cpN_to_utf16(unsigned int cp, const char *str, int len, unsigned int f
 	// Attempt to convert the text to UTF-16.
 	// NOTE: "//IGNORE" sometimes doesn't work, so we won't
 	// check for TEXTCONV_FLAG_CP1252_FALLBACK here.
-	u16string ret;
 	char16_t *wcs = reinterpret_cast<char16_t*>(rp_iconv((char*)str, len*sizeof(*str), cp_name, RP_ICONV_UTF16_ENCODING, ignoreErr));
 	if (!wcs /*&& (flags & TEXTCONV_FLAG_CP1252_FALLBACK)*/) {
 		// Try cp1252 fallback.
@@ -299,19 +402,6 @@ u16string cpN_to_utf16(unsigned int cp, const char *str, int len, unsigned int f
 	if (wcs) {
 		ret.assign(wcs);
 		free(wcs);
-
-#ifdef HAVE_ICONV_LIBICONV
-		if (cp == CP_SJIS) {
-			// libiconv's cp932 maps Shift-JIS 8160 to U+301C. This is expected
-			// behavior for Shift-JIS, but cp932 should map it to U+FF5E.
-			std::for_each(ret.begin(), ret.end(), [](char16_t &p) {
-				if (p == 0x301C) {
-					// Found a wave dash.
-					p = (char16_t)0xFF5E;
-				}
-			});
-		}
-#endif /* HAVE_ICONV_LIBICONV */
 	}
 	return ret;
 }
@@ -332,12 +422,17 @@ string utf8_to_cpN(unsigned int cp, const char *str, int len)
 {
 	len = check_NULL_terminator(str, len);
 
+	// Pure ASCII text doesn't need to be converted.
+	string ret;
+	if (fast_utf8_to_cpN(ret, cp, str, len)) {
+		return ret;
+	}
+
 	// Get the encoding name for the primary code page.
 	char cp_name[20];
 	codePageToEncName(cp_name, sizeof(cp_name), cp);
 
 	// Attempt to convert the text from UTF-8.
-	string ret;
 	char *mbs = reinterpret_cast<char*>(rp_iconv((char*)str, len*sizeof(*str), "UTF-8", cp_name, true));
 	if (mbs) {
 		ret.assign(mbs);
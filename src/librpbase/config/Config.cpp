@@ -18,6 +18,7 @@ using std::unique_ptr;
 using std::unordered_map;
 
 #include "RomData.hpp"
+#include "img/RpPngWriter.hpp"
 
 namespace LibRpBase {
 
@@ -82,6 +83,7 @@ class ConfigPrivate : public ConfReaderPrivate
 		bool useIntIconForSmallSizes;
 		bool downloadHighResScans;
 		bool storeFileOriginInfo;
+		uint8_t maxConcurrentDownloads;
 
 		// DMG title screen mode. [index is ROM type]
 		Config::DMG_TitleScreen_Mode dmgTSMode[Config::DMG_TitleScreen_Mode::DMG_TS_MAX];
@@ -89,6 +91,14 @@ class ConfigPrivate : public ConfReaderPrivate
 		// Other options.
 		bool showDangerousPermissionsOverlayIcon;
 		bool enableThumbnailOnNetworkFS;
+		bool enableMetaDataCache;
+		bool showHashesTab;
+
+		// PNG compression profile for thumbnails.
+		Config::PngCompression thumbnailPngCompression;
+
+		// Maximum number of D-Bus thumbnailer worker threads.
+		uint8_t thumbnailerMaxThreads;
 };
 
 /** ConfigPrivate **/
@@ -123,10 +133,19 @@ ConfigPrivate::ConfigPrivate()
 	, useIntIconForSmallSizes(true)
 	, downloadHighResScans(true)
 	, storeFileOriginInfo(true)
+	, maxConcurrentDownloads(4)
 	/* Overlay icon */
 	, showDangerousPermissionsOverlayIcon(true)
 	/* Enable thumbnailing and metadata on network FS */
 	, enableThumbnailOnNetworkFS(false)
+	/* Persistent metadata cache */
+	, enableMetaDataCache(false)
+	/* "Hashes" tab */
+	, showHashesTab(false)
+	/* PNG compression profile for thumbnails */
+	, thumbnailPngCompression(Config::PngCompression::PNG_COMPRESSION_FAST)
+	/* D-Bus thumbnailer worker threads */
+	, thumbnailerMaxThreads(0)
 {
 	// NOTE: Configuration is also initialized in the reset() function.
 	memset(dmgTSMode, 0, sizeof(dmgTSMode));
@@ -153,6 +172,7 @@ void ConfigPrivate::reset(void)
 	useIntIconForSmallSizes = true;
 	downloadHighResScans = true;
 	storeFileOriginInfo = true;
+	maxConcurrentDownloads = 4;
 
 	// DMG title screen mode.
 	dmgTSMode[Config::DMG_TitleScreen_Mode::DMG_TS_DMG] = Config::DMG_TitleScreen_Mode::DMG_TS_DMG;
@@ -163,6 +183,14 @@ void ConfigPrivate::reset(void)
 	showDangerousPermissionsOverlayIcon = true;
 	// Enable thumbnail and metadata on network FS
 	enableThumbnailOnNetworkFS = false;
+	// Persistent metadata cache
+	enableMetaDataCache = false;
+	// "Hashes" tab
+	showHashesTab = false;
+	// PNG compression profile for thumbnails
+	thumbnailPngCompression = Config::PngCompression::PNG_COMPRESSION_FAST;
+	// D-Bus thumbnailer worker threads (0 for one per CPU)
+	thumbnailerMaxThreads = 0;
 }
 
 /**
@@ -189,7 +217,26 @@ int ConfigPrivate::processConfigLine(const char *section, const char *name, cons
 
 	// Which section are we in?
 	if (!strcasecmp(section, "Downloads")) {
-		// Downloads. Check for one of the three boolean options.
+		if (!strcasecmp(name, "MaxConcurrentDownloads")) {
+			// Maximum number of simultaneous downloads.
+			// Values outside of [1, MAX_CONCURRENT_DOWNLOADS] are clamped.
+			char *endptr = nullptr;
+			const long val = strtol(value, &endptr, 10);
+			if (endptr == value || (*endptr != '\0' && !ISSPACE(*endptr))) {
+				// Invalid value.
+				return 1;
+			}
+			if (val < 1) {
+				maxConcurrentDownloads = 1;
+			} else if (val > static_cast<long>(Config::MAX_CONCURRENT_DOWNLOADS)) {
+				maxConcurrentDownloads = Config::MAX_CONCURRENT_DOWNLOADS;
+			} else {
+				maxConcurrentDownloads = static_cast<uint8_t>(val);
+			}
+			return 1;
+		}
+
+		// Check for one of the boolean options.
 		bool *param;
 		if (!strcasecmp(name, "ExtImageDownload")) {
 			param = &extImgDownloadEnabled;
@@ -244,11 +291,46 @@ int ConfigPrivate::processConfigLine(const char *section, const char *name, cons
 		dmgTSMode[dmg_key] = dmg_value;
 	} else if (!strcasecmp(section, "Options")) {
 		// Options.
+		if (!strcasecmp(name, "ThumbnailPngCompression")) {
+			// PNG compression profile.
+			// Acceptable values are "Default", "Fast", and "Small".
+			if (!strcasecmp(value, "Default")) {
+				thumbnailPngCompression = Config::PngCompression::PNG_COMPRESSION_DEFAULT;
+			} else if (!strcasecmp(value, "Fast")) {
+				thumbnailPngCompression = Config::PngCompression::PNG_COMPRESSION_FAST;
+			} else if (!strcasecmp(value, "Small")) {
+				thumbnailPngCompression = Config::PngCompression::PNG_COMPRESSION_SMALL;
+			} else {
+				// TODO: Show a warning or something?
+			}
+			return 1;
+		} else if (!strcasecmp(name, "ThumbnailerMaxThreads")) {
+			// Maximum number of D-Bus thumbnailer worker threads.
+			// 0 uses one thread per CPU. Values larger than
+			// MAX_THUMBNAILER_THREADS are clamped.
+			char *endptr = nullptr;
+			const long val = strtol(value, &endptr, 10);
+			if (endptr == value || (*endptr != '\0' && !ISSPACE(*endptr)) || val < 0) {
+				// Invalid value.
+				return 1;
+			}
+			if (val > static_cast<long>(Config::MAX_THUMBNAILER_THREADS)) {
+				thumbnailerMaxThreads = Config::MAX_THUMBNAILER_THREADS;
+			} else {
+				thumbnailerMaxThreads = static_cast<uint8_t>(val);
+			}
+			return 1;
+		}
+
 		bool *param;
 		if (!strcasecmp(name, "ShowDangerousPermissionsOverlayIcon")) {
 			param = &showDangerousPermissionsOverlayIcon;
 		} else if (!strcasecmp(name, "EnableThumbnailOnNetworkFS")) {
 			param = &enableThumbnailOnNetworkFS;
+		} else if (!strcasecmp(name, "MetaDataCache")) {
+			param = &enableMetaDataCache;
+		} else if (!strcasecmp(name, "ShowHashesTab")) {
+			param = &showHashesTab;
 		} else {
 			// Invalid option.
 			return 1;
@@ -555,6 +637,19 @@ bool Config::storeFileOriginInfo(void) const
 	return d->storeFileOriginInfo;
 }
 
+/**
+ * Maximum number of simultaneous downloads.
+ * This is also used as the maximum number of external
+ * image URLs that are checked concurrently.
+ * NOTE: Call load() before using this function.
+ * @return Maximum number of simultaneous downloads. [1, MAX_CONCURRENT_DOWNLOADS]
+ */
+unsigned int Config::maxConcurrentDownloads(void) const
+{
+	RP_D(const Config);
+	return d->maxConcurrentDownloads;
+}
+
 /** DMG title screen mode **/
 
 /**
@@ -601,4 +696,55 @@ bool Config::enableThumbnailOnNetworkFS(void) const
 	return d->enableThumbnailOnNetworkFS;
 }
 
+/**
+ * Enable the persistent metadata cache?
+ * NOTE: Call load() before using this function.
+ * @return True if we should enable; false if not.
+ */
+bool Config::enableMetaDataCache(void) const
+{
+	RP_D(const Config);
+	return d->enableMetaDataCache;
+}
+
+/**
+ * Show the "Hashes" tab with CRC32, MD5, and SHA-1?
+ * NOTE: Call load() before using this function.
+ * @return True if we should show the tab; false if not.
+ */
+bool Config::showHashesTab(void) const
+{
+	RP_D(const Config);
+	return d->showHashesTab;
+}
+
+/**
+ * PNG compression profile for thumbnails.
+ * NOTE: Call load() before using this function.
+ * @return PNG compression profile.
+ */
+Config::PngCompression Config::thumbnailPngCompression(void) const
+{
+	static_assert(static_cast<int>(PNG_COMPRESSION_DEFAULT) == static_cast<int>(RpPngWriter::CP_DEFAULT),
+		"PNG_COMPRESSION_DEFAULT != RpPngWriter::CP_DEFAULT");
+	static_assert(static_cast<int>(PNG_COMPRESSION_FAST) == static_cast<int>(RpPngWriter::CP_FAST),
+		"PNG_COMPRESSION_FAST != RpPngWriter::CP_FAST");
+	static_assert(static_cast<int>(PNG_COMPRESSION_SMALL) == static_cast<int>(RpPngWriter::CP_SMALL),
+		"PNG_COMPRESSION_SMALL != RpPngWriter::CP_SMALL");
+
+	RP_D(const Config);
+	return d->thumbnailPngCompression;
+}
+
+/**
+ * Maximum number of D-Bus thumbnailer worker threads.
+ * NOTE: Call load() before using this function.
+ * @return Maximum number of worker threads. [0, MAX_THUMBNAILER_THREADS] (0 for one per CPU)
+ */
+unsigned int Config::thumbnailerMaxThreads(void) const
+{
+	RP_D(const Config);
+	return d->thumbnailerMaxThreads;
+}
+
 }
@@ -115,6 +115,18 @@ class Config : public ConfReader
 		 */
 		bool storeFileOriginInfo(void) const;
 
+		/**
+		 * Maximum number of simultaneous downloads.
+		 * This is also used as the maximum number of external
+		 * image URLs that are checked concurrently.
+		 * NOTE: Call load() before using this function.
+		 * @return Maximum number of simultaneous downloads. [1, MAX_CONCURRENT_DOWNLOADS]
+		 */
+		unsigned int maxConcurrentDownloads(void) const;
+
+		// Upper limit for maxConcurrentDownloads().
+		static const unsigned int MAX_CONCURRENT_DOWNLOADS = 8;
+
 		/** DMG title screen mode **/
 
 		enum DMG_TitleScreen_Mode : uint8_t {
@@ -147,6 +159,48 @@ class Config : public ConfReader
 		 * @return True if we should enable; false if not.
 		 */
 		bool enableThumbnailOnNetworkFS(void) const;
+
+		/**
+		 * Enable the persistent metadata cache?
+		 * NOTE: Call load() before using this function.
+		 * @return True if we should enable; false if not.
+		 */
+		bool enableMetaDataCache(void) const;
+
+		/**
+		 * Show the "Hashes" tab with CRC32, MD5, and SHA-1?
+		 * NOTE: Call load() before using this function.
+		 * @return True if we should show the tab; false if not.
+		 */
+		bool showHashesTab(void) const;
+
+		/** PNG compression **/
+
+		// NOTE: Values match RpPngWriter::CompressionProfile.
+		enum PngCompression : uint8_t {
+			PNG_COMPRESSION_DEFAULT,	// zlib default level; no filtering.
+			PNG_COMPRESSION_FAST,		// zlib level 1; SUB filter.
+			PNG_COMPRESSION_SMALL,		// zlib level 9; adaptive filtering.
+
+			PNG_COMPRESSION_MAX
+		};
+
+		/**
+		 * PNG compression profile for thumbnails.
+		 * NOTE: Call load() before using this function.
+		 * @return PNG compression profile.
+		 */
+		PngCompression thumbnailPngCompression(void) const;
+
+		/**
+		 * Maximum number of D-Bus thumbnailer worker threads.
+		 * NOTE: Call load() before using this function.
+		 * @return Maximum number of worker threads. [0, MAX_THUMBNAILER_THREADS] (0 for one per CPU)
+		 */
+		unsigned int thumbnailerMaxThreads(void) const;
+
+		// Upper limit for thumbnailerMaxThreads().
+		static const unsigned int MAX_THUMBNAILER_THREADS = 64;
 };
 
 }
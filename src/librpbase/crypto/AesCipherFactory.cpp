@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librpbase)                        *
  * AesCipherFactory.cpp: IAesCipher factory class.                         *
  *                                                                         *
- * Copyright (c) 2016-2019 by David Korth.                                 *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -11,7 +11,13 @@
 
 #include "AesCipherFactory.hpp"
 
+// librpcpu
+#include "librpcpu/cpu_dispatch.h"
+
 // IAesCipher implementations.
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+# include "AesNI.hpp"
+#endif
 #if defined(_WIN32)
 # include "AesCAPI.hpp"
 # include "AesCAPI_NG.hpp"
@@ -32,6 +38,15 @@ namespace LibRpBase {
  */
 IAesCipher *AesCipherFactory::create(void)
 {
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+	// x86: Use AES-NI if it's supported by the CPU.
+	// This is much faster than the OS implementations,
+	// since multiple blocks are decrypted at once.
+	if (AesNI::isUsable()) {
+		return new AesNI();
+	}
+#endif /* RP_CPU_I386 || RP_CPU_AMD64 */
+
 #if defined(_WIN32)
 	// Windows: Use CryptoAPI NG if available.
 	// If not, fall back to CryptoAPI.
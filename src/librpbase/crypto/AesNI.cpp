@@ -0,0 +1,214 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * AesNI.cpp: AES decryption class using Intel AES-NI instructions.        *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "AesNI.hpp"
+#include "AesNI_p.hpp"
+
+// librpcpu
+#include "librpcpu/cpuflags_x86.h"
+
+namespace LibRpBase {
+
+/** AesNIPrivate **/
+
+AesNIPrivate::AesNIPrivate()
+	: rounds(0)
+	, chainingMode(IAesCipher::CM_ECB)
+#ifdef HAVE_AESNI_VAES
+	, use_vaes(RP_CPU_HasVAES() != 0)
+#endif /* HAVE_AESNI_VAES */
+{
+	// Clear the keys.
+	memset(enc_keys, 0, sizeof(enc_keys));
+	memset(dec_keys, 0, sizeof(dec_keys));
+	memset(iv, 0, sizeof(iv));
+}
+
+AesNIPrivate::~AesNIPrivate()
+{
+	// Don't leave the round keys in memory.
+	memset(enc_keys, 0, sizeof(enc_keys));
+	memset(dec_keys, 0, sizeof(dec_keys));
+}
+
+/** AesNI **/
+
+AesNI::AesNI()
+	: d_ptr(new AesNIPrivate())
+{ }
+
+AesNI::~AesNI()
+{
+	delete d_ptr;
+}
+
+/**
+ * Is AES-NI usable on this system?
+ * @return True if the CPU supports AES-NI.
+ */
+bool AesNI::isUsable(void)
+{
+	return (RP_CPU_HasAES() != 0);
+}
+
+/**
+ * Get the name of the AesCipher implementation.
+ * @return Name.
+ */
+const char *AesNI::name(void) const
+{
+#ifdef HAVE_AESNI_VAES
+	RP_D(const AesNI);
+	if (d->use_vaes) {
+		return "AES-NI (VAES)";
+	}
+#endif /* HAVE_AESNI_VAES */
+	return "AES-NI";
+}
+
+/**
+ * Has the cipher been initialized properly?
+ * @return True if initialized; false if not.
+ */
+bool AesNI::isInit(void) const
+{
+	// AES-NI works if the CPU supports it.
+	return isUsable();
+}
+
+/**
+ * Set the encryption key.
+ * @param pKey	[in] Key data.
+ * @param size	[in] Size of pKey, in bytes.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AesNI::setKey(const uint8_t *RESTRICT pKey, size_t size)
+{
+	// Acceptable key lengths:
+	// - 16 (AES-128)
+	// - 24 (AES-192)
+	// - 32 (AES-256)
+	if (!pKey || !(size == 16 || size == 24 || size == 32)) {
+		return -EINVAL;
+	} else if (!isUsable()) {
+		return -ENOTSUP;
+	}
+
+	// Expand the key.
+	// Both the encryption and decryption key schedules
+	// are generated, so changing the chaining mode
+	// doesn't require another key expansion.
+	RP_D(AesNI);
+	d->expandKey_aesni(pKey, size);
+	d->rounds = static_cast<unsigned int>(size / 4) + 6;
+	return 0;
+}
+
+/**
+ * Set the cipher chaining mode.
+ *
+ * Note that the IV/counter must be set *after* setting
+ * the chaining mode; otherwise, setIV() will fail.
+ *
+ * @param mode Cipher chaining mode.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AesNI::setChainingMode(ChainingMode mode)
+{
+	if (mode < CM_ECB || mode > CM_CTR) {
+		return -EINVAL;
+	}
+
+	RP_D(AesNI);
+	d->chainingMode = mode;
+	return 0;
+}
+
+/**
+ * Set the IV (CBC mode) or counter (CTR mode).
+ * @param pIV	[in] IV/counter data.
+ * @param size	[in] Size of pIV, in bytes.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AesNI::setIV(const uint8_t *RESTRICT pIV, size_t size)
+{
+	RP_D(AesNI);
+	if (!pIV || size != AesNIPrivate::AES_BLOCK_SIZE ||
+	    d->chainingMode < CM_CBC || d->chainingMode > CM_CTR)
+	{
+		// Invalid parameters and/or chaining mode.
+		return -EINVAL;
+	}
+
+	// Set the IV/counter.
+	memcpy(d->iv, pIV, AesNIPrivate::AES_BLOCK_SIZE);
+	return 0;
+}
+
+/**
+ * Decrypt a block of data.
+ * @param pData	[in/out] Data block.
+ * @param size	[in] Length of data block. (Must be a multiple of 16.)
+ * @return Number of bytes decrypted on success; 0 on error.
+ */
+size_t AesNI::decrypt(uint8_t *RESTRICT pData, size_t size)
+{
+	if (!pData || size == 0 || (size % AesNIPrivate::AES_BLOCK_SIZE != 0)) {
+		// Invalid parameters.
+		return 0;
+	}
+
+	RP_D(AesNI);
+	if (d->rounds == 0) {
+		// Key hasn't been set.
+		return 0;
+	}
+
+#ifdef HAVE_AESNI_VAES
+	// VAES only helps if there's more than one block.
+	if (d->use_vaes && size > AesNIPrivate::AES_BLOCK_SIZE) {
+		switch (d->chainingMode) {
+			case CM_ECB:
+				d->decryptECB_vaes(pData, size);
+				break;
+			case CM_CBC:
+				// IV is automatically updated for the next block.
+				d->decryptCBC_vaes(pData, size);
+				break;
+			case CM_CTR:
+				// ctr is automatically updated for the next block.
+				d->decryptCTR_vaes(pData, size);
+				break;
+			default:
+				return 0;
+		}
+		return size;
+	}
+#endif /* HAVE_AESNI_VAES */
+
+	switch (d->chainingMode) {
+		case CM_ECB:
+			d->decryptECB_aesni(pData, size);
+			break;
+		case CM_CBC:
+			// IV is automatically updated for the next block.
+			d->decryptCBC_aesni(pData, size);
+			break;
+		case CM_CTR:
+			// ctr is automatically updated for the next block.
+			d->decryptCTR_aesni(pData, size);
+			break;
+		default:
+			return 0;
+	}
+
+	return size;
+}
+
+}
@@ -0,0 +1,443 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * AesNI_aesni.cpp: AES decryption class using Intel AES-NI instructions.  *
+ * 128-bit AES-NI version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "AesNI_p.hpp"
+
+// librpcpu
+#include "librpcpu/byteswap.h"
+
+// AES-NI intrinsics.
+#include <wmmintrin.h>
+
+// Number of blocks to decrypt at once.
+// AES-NI instructions have a latency of several cycles, but
+// a throughput of one instruction per cycle, so multiple
+// independent blocks have to be in flight to keep the
+// pipeline busy. i386 only has 8 XMM registers, so fewer
+// blocks are processed at once there.
+#if defined(__amd64__) || defined(__x86_64__) || defined(_M_X64)
+# define AESNI_PIPELINE_BLOCKS 8
+#else
+# define AESNI_PIPELINE_BLOCKS 4
+#endif
+
+namespace LibRpBase {
+
+/** Key expansion **/
+// Reference: Intel Advanced Encryption Standard (AES) New Instructions Set
+// https://www.intel.com/content/dam/doc/white-paper/advanced-encryption-standard-new-instructions-set-paper.pdf
+
+/**
+ * Shift a round key left by one word and XOR it with itself three times.
+ * This propagates each word into the following words.
+ * @param key Round key.
+ * @return Propagated round key.
+ */
+static FORCEINLINE __m128i aes_key_propagate(__m128i key)
+{
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+	return _mm_xor_si128(key, _mm_slli_si128(key, 4));
+}
+
+// AES-128: Generate round key i from round key i-1.
+#define AES128_EXPAND(i, rcon) \
+	k[i] = _mm_xor_si128(aes_key_propagate(k[(i)-1]), \
+		_mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[(i)-1], (rcon)), 0xFF))
+
+/**
+ * Expand an AES-128 key.
+ * @param k	[out] Round keys. (11)
+ * @param pKey	[in] Key data. (16 bytes)
+ */
+static void aes128_expand_key(__m128i *k, const uint8_t *pKey)
+{
+	k[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pKey));
+	AES128_EXPAND( 1, 0x01);
+	AES128_EXPAND( 2, 0x02);
+	AES128_EXPAND( 3, 0x04);
+	AES128_EXPAND( 4, 0x08);
+	AES128_EXPAND( 5, 0x10);
+	AES128_EXPAND( 6, 0x20);
+	AES128_EXPAND( 7, 0x40);
+	AES128_EXPAND( 8, 0x80);
+	AES128_EXPAND( 9, 0x1B);
+	AES128_EXPAND(10, 0x36);
+}
+
+/**
+ * AES-192 key expansion helper.
+ * @param t1	[in/out] Words 0-3 of the current key block.
+ * @param t2	[in] Output of aeskeygenassist(t3).
+ * @param t3	[in/out] Words 4-5 of the current key block.
+ */
+static FORCEINLINE void aes192_assist(__m128i &t1, __m128i t2, __m128i &t3)
+{
+	t1 = _mm_xor_si128(aes_key_propagate(t1), _mm_shuffle_epi32(t2, 0x55));
+	t2 = _mm_shuffle_epi32(t1, 0xFF);
+	t3 = _mm_xor_si128(t3, _mm_slli_si128(t3, 4));
+	t3 = _mm_xor_si128(t3, t2);
+}
+
+// AES-192: Combine the low half of a with the low half of b.
+#define AES192_SHUF_LO(a, b) \
+	_mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b), 0))
+// AES-192: Combine the high half of a with the low half of b.
+#define AES192_SHUF_HI(a, b) \
+	_mm_castpd_si128(_mm_shuffle_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b), 1))
+
+/**
+ * Expand an AES-192 key.
+ * @param k	[out] Round keys. (13)
+ * @param pKey	[in] Key data. (24 bytes)
+ */
+static void aes192_expand_key(__m128i *k, const uint8_t *pKey)
+{
+	// AES-192 generates 1.5 round keys per iteration.
+	__m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pKey));
+	__m128i t3 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pKey + 16));
+	k[0] = t1;
+	k[1] = t3;
+
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x01), t3);
+	k[1] = AES192_SHUF_LO(k[1], t1);
+	k[2] = AES192_SHUF_HI(t1, t3);
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x02), t3);
+	k[3] = t1;
+	k[4] = t3;
+
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x04), t3);
+	k[4] = AES192_SHUF_LO(k[4], t1);
+	k[5] = AES192_SHUF_HI(t1, t3);
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x08), t3);
+	k[6] = t1;
+	k[7] = t3;
+
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x10), t3);
+	k[7] = AES192_SHUF_LO(k[7], t1);
+	k[8] = AES192_SHUF_HI(t1, t3);
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x20), t3);
+	k[9] = t1;
+	k[10] = t3;
+
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x40), t3);
+	k[10] = AES192_SHUF_LO(k[10], t1);
+	k[11] = AES192_SHUF_HI(t1, t3);
+	aes192_assist(t1, _mm_aeskeygenassist_si128(t3, 0x80), t3);
+	k[12] = t1;
+}
+
+// AES-256: Generate round keys i and i+1 from round keys i-2 and i-1.
+#define AES256_EXPAND(i, rcon) do { \
+	k[i] = _mm_xor_si128(aes_key_propagate(k[(i)-2]), \
+		_mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[(i)-1], (rcon)), 0xFF)); \
+	if ((i) < 14) { \
+		k[(i)+1] = _mm_xor_si128(aes_key_propagate(k[(i)-1]), \
+			_mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[i], 0x00), 0xAA)); \
+	} \
+} while (0)
+
+/**
+ * Expand an AES-256 key.
+ * @param k	[out] Round keys. (15)
+ * @param pKey	[in] Key data. (32 bytes)
+ */
+static void aes256_expand_key(__m128i *k, const uint8_t *pKey)
+{
+	k[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pKey));
+	k[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pKey + 16));
+	AES256_EXPAND( 2, 0x01);
+	AES256_EXPAND( 4, 0x02);
+	AES256_EXPAND( 6, 0x04);
+	AES256_EXPAND( 8, 0x08);
+	AES256_EXPAND(10, 0x10);
+	AES256_EXPAND(12, 0x20);
+	AES256_EXPAND(14, 0x40);
+}
+
+/**
+ * Expand a key into enc_keys[] and dec_keys[].
+ * @param pKey	[in] Key data.
+ * @param size	[in] Size of pKey, in bytes. (16, 24, or 32)
+ */
+void AesNIPrivate::expandKey_aesni(const uint8_t *RESTRICT pKey, size_t size)
+{
+	__m128i k[AES_MAX_ROUNDS + 1];
+	unsigned int nr;
+	switch (size) {
+		case 16:
+			aes128_expand_key(k, pKey);
+			nr = 10;
+			break;
+		case 24:
+			aes192_expand_key(k, pKey);
+			nr = 12;
+			break;
+		case 32:
+			aes256_expand_key(k, pKey);
+			nr = 14;
+			break;
+		default:
+			assert(!"Invalid key size.");
+			return;
+	}
+
+	// Decryption uses the Equivalent Inverse Cipher, which
+	// needs the round keys in reverse order, with InvMixColumns
+	// applied to all except the first and last round keys.
+	__m128i *const pEnc = reinterpret_cast<__m128i*>(enc_keys);
+	__m128i *const pDec = reinterpret_cast<__m128i*>(dec_keys);
+	_mm_storeu_si128(&pEnc[0], k[0]);
+	_mm_storeu_si128(&pDec[0], k[nr]);
+	for (unsigned int i = 1; i < nr; i++) {
+		_mm_storeu_si128(&pEnc[i], k[i]);
+		_mm_storeu_si128(&pDec[i], _mm_aesimc_si128(k[nr - i]));
+	}
+	_mm_storeu_si128(&pEnc[nr], k[nr]);
+	_mm_storeu_si128(&pDec[nr], k[0]);
+}
+
+/** Block functions **/
+
+/**
+ * Load round keys.
+ * @param rk	[out] Round keys.
+ * @param keys	[in] Round keys. (unaligned)
+ * @param rounds [in] Number of rounds.
+ */
+static FORCEINLINE void load_round_keys(__m128i *rk, const uint8_t *keys, unsigned int rounds)
+{
+	const __m128i *const pKeys = reinterpret_cast<const __m128i*>(keys);
+	for (unsigned int i = 0; i <= rounds; i++) {
+		rk[i] = _mm_loadu_si128(&pKeys[i]);
+	}
+}
+
+// Apply an operation to each block in the pipeline.
+// NOTE: Explicitly unrolled so the blocks stay in registers.
+#if AESNI_PIPELINE_BLOCKS == 8
+# define AESNI_FOR_EACH_BLOCK(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7)
+#else
+# define AESNI_FOR_EACH_BLOCK(X) X(0) X(1) X(2) X(3)
+#endif
+
+/**
+ * Decrypt a single block.
+ * @param b	[in] Block.
+ * @param rk	[in] Decryption round keys.
+ * @param rounds [in] Number of rounds.
+ * @return Decrypted block.
+ */
+static FORCEINLINE __m128i aesni_decrypt_block(__m128i b, const __m128i *rk, unsigned int rounds)
+{
+	b = _mm_xor_si128(b, rk[0]);
+	for (unsigned int r = 1; r < rounds; r++) {
+		b = _mm_aesdec_si128(b, rk[r]);
+	}
+	return _mm_aesdeclast_si128(b, rk[rounds]);
+}
+
+/**
+ * Encrypt a single block.
+ * @param b	[in] Block.
+ * @param rk	[in] Encryption round keys.
+ * @param rounds [in] Number of rounds.
+ * @return Encrypted block.
+ */
+static FORCEINLINE __m128i aesni_encrypt_block(__m128i b, const __m128i *rk, unsigned int rounds)
+{
+	b = _mm_xor_si128(b, rk[0]);
+	for (unsigned int r = 1; r < rounds; r++) {
+		b = _mm_aesenc_si128(b, rk[r]);
+	}
+	return _mm_aesenclast_si128(b, rk[rounds]);
+}
+
+/**
+ * Decrypt AESNI_PIPELINE_BLOCKS independent blocks.
+ * @param b	[in/out] Blocks.
+ * @param rk	[in] Decryption round keys.
+ * @param rounds [in] Number of rounds.
+ */
+static FORCEINLINE void aesni_decrypt_pipeline(__m128i *b, const __m128i *rk, unsigned int rounds)
+{
+#define AESNI_XOR(i) b[i] = _mm_xor_si128(b[i], key);
+#define AESNI_DEC(i) b[i] = _mm_aesdec_si128(b[i], key);
+#define AESNI_DECLAST(i) b[i] = _mm_aesdeclast_si128(b[i], key);
+	__m128i key = rk[0];
+	AESNI_FOR_EACH_BLOCK(AESNI_XOR)
+	for (unsigned int r = 1; r < rounds; r++) {
+		key = rk[r];
+		AESNI_FOR_EACH_BLOCK(AESNI_DEC)
+	}
+	key = rk[rounds];
+	AESNI_FOR_EACH_BLOCK(AESNI_DECLAST)
+#undef AESNI_XOR
+#undef AESNI_DEC
+#undef AESNI_DECLAST
+}
+
+/**
+ * Encrypt AESNI_PIPELINE_BLOCKS independent blocks.
+ * @param b	[in/out] Blocks.
+ * @param rk	[in] Encryption round keys.
+ * @param rounds [in] Number of rounds.
+ */
+static FORCEINLINE void aesni_encrypt_pipeline(__m128i *b, const __m128i *rk, unsigned int rounds)
+{
+#define AESNI_XOR(i) b[i] = _mm_xor_si128(b[i], key);
+#define AESNI_ENC(i) b[i] = _mm_aesenc_si128(b[i], key);
+#define AESNI_ENCLAST(i) b[i] = _mm_aesenclast_si128(b[i], key);
+	__m128i key = rk[0];
+	AESNI_FOR_EACH_BLOCK(AESNI_XOR)
+	for (unsigned int r = 1; r < rounds; r++) {
+		key = rk[r];
+		AESNI_FOR_EACH_BLOCK(AESNI_ENC)
+	}
+	key = rk[rounds];
+	AESNI_FOR_EACH_BLOCK(AESNI_ENCLAST)
+#undef AESNI_XOR
+#undef AESNI_ENC
+#undef AESNI_ENCLAST
+}
+
+/**
+ * Decrypt data using ECB.
+ * @param pData	[in/out] Data.
+ * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+ */
+void AesNIPrivate::decryptECB_aesni(uint8_t *RESTRICT pData, size_t size) const
+{
+	__m128i rk[AES_MAX_ROUNDS + 1];
+	load_round_keys(rk, dec_keys, rounds);
+
+	__m128i *p = reinterpret_cast<__m128i*>(pData);
+	for (; size >= AESNI_PIPELINE_BLOCKS * AES_BLOCK_SIZE;
+	     size -= AESNI_PIPELINE_BLOCKS * AES_BLOCK_SIZE, p += AESNI_PIPELINE_BLOCKS)
+	{
+		__m128i b[AESNI_PIPELINE_BLOCKS];
+#define AESNI_LOAD(i) b[i] = _mm_loadu_si128(&p[i]);
+#define AESNI_STORE(i) _mm_storeu_si128(&p[i], b[i]);
+		AESNI_FOR_EACH_BLOCK(AESNI_LOAD)
+		aesni_decrypt_pipeline(b, rk, rounds);
+		AESNI_FOR_EACH_BLOCK(AESNI_STORE)
+#undef AESNI_LOAD
+#undef AESNI_STORE
+	}
+
+	// Remaining blocks.
+	for (; size > 0; size -= AES_BLOCK_SIZE, p++) {
+		_mm_storeu_si128(p, aesni_decrypt_block(_mm_loadu_si128(p), rk, rounds));
+	}
+}
+
+/**
+ * Decrypt data using CBC.
+ * The IV is updated for the next block.
+ * @param pData	[in/out] Data.
+ * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+ */
+void AesNIPrivate::decryptCBC_aesni(uint8_t *RESTRICT pData, size_t size)
+{
+	__m128i rk[AES_MAX_ROUNDS + 1];
+	load_round_keys(rk, dec_keys, rounds);
+
+	// CBC decryption doesn't depend on the previous plaintext,
+	// so multiple blocks can be decrypted at once.
+	__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+	__m128i *p = reinterpret_cast<__m128i*>(pData);
+	for (; size >= AESNI_PIPELINE_BLOCKS * AES_BLOCK_SIZE;
+	     size -= AESNI_PIPELINE_BLOCKS * AES_BLOCK_SIZE, p += AESNI_PIPELINE_BLOCKS)
+	{
+		// Each plaintext block is XORed with the previous
+		// ciphertext block, so the ciphertext needs to be
+		// kept around until the blocks are decrypted.
+		__m128i c[AESNI_PIPELINE_BLOCKS + 1], b[AESNI_PIPELINE_BLOCKS];
+		c[0] = prev;
+#define AESNI_LOAD(i) c[(i)+1] = _mm_loadu_si128(&p[i]); b[i] = c[(i)+1];
+#define AESNI_STORE(i) _mm_storeu_si128(&p[i], _mm_xor_si128(b[i], c[i]));
+		AESNI_FOR_EACH_BLOCK(AESNI_LOAD)
+		aesni_decrypt_pipeline(b, rk, rounds);
+		AESNI_FOR_EACH_BLOCK(AESNI_STORE)
+#undef AESNI_LOAD
+#undef AESNI_STORE
+		prev = c[AESNI_PIPELINE_BLOCKS];
+	}
+
+	// Remaining blocks.
+	for (; size > 0; size -= AES_BLOCK_SIZE, p++) {
+		const __m128i c = _mm_loadu_si128(p);
+		_mm_storeu_si128(p, _mm_xor_si128(aesni_decrypt_block(c, rk, rounds), prev));
+		prev = c;
+	}
+
+	// Save the IV for the next block.
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(iv), prev);
+}
+
+/**
+ * Create a CTR counter block.
+ * @param hi High 64 bits of the counter.
+ * @param lo Low 64 bits of the counter.
+ * @return Counter block. (128-bit big-endian)
+ */
+static FORCEINLINE __m128i ctr_block(uint64_t hi, uint64_t lo)
+{
+	return _mm_set_epi64x(static_cast<int64_t>(cpu_to_be64(lo)),
+	                      static_cast<int64_t>(cpu_to_be64(hi)));
+}
+
+/**
+ * Decrypt data using CTR.
+ * The counter is updated for the next block.
+ * @param pData	[in/out] Data.
+ * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+ */
+void AesNIPrivate::decryptCTR_aesni(uint8_t *RESTRICT pData, size_t size)
+{
+	__m128i rk[AES_MAX_ROUNDS + 1];
+	load_round_keys(rk, enc_keys, rounds);
+
+	// The counter is a 128-bit big-endian value.
+	uint64_t ctr[2];
+	memcpy(ctr, iv, sizeof(ctr));
+	uint64_t ctr_hi = be64_to_cpu(ctr[0]);
+	uint64_t ctr_lo = be64_to_cpu(ctr[1]);
+
+	__m128i *p = reinterpret_cast<__m128i*>(pData);
+	for (; size >= AESNI_PIPELINE_BLOCKS * AES_BLOCK_SIZE;
+	     size -= AESNI_PIPELINE_BLOCKS * AES_BLOCK_SIZE, p += AESNI_PIPELINE_BLOCKS)
+	{
+		__m128i b[AESNI_PIPELINE_BLOCKS];
+#define AESNI_CTR(i) b[i] = ctr_block(ctr_hi, ctr_lo); if (++ctr_lo == 0) { ctr_hi++; }
+#define AESNI_STORE(i) _mm_storeu_si128(&p[i], _mm_xor_si128(b[i], _mm_loadu_si128(&p[i])));
+		AESNI_FOR_EACH_BLOCK(AESNI_CTR)
+		aesni_encrypt_pipeline(b, rk, rounds);
+		AESNI_FOR_EACH_BLOCK(AESNI_STORE)
+#undef AESNI_CTR
+#undef AESNI_STORE
+	}
+
+	// Remaining blocks.
+	for (; size > 0; size -= AES_BLOCK_SIZE, p++) {
+		const __m128i b = aesni_encrypt_block(ctr_block(ctr_hi, ctr_lo), rk, rounds);
+		if (++ctr_lo == 0) {
+			ctr_hi++;
+		}
+		_mm_storeu_si128(p, _mm_xor_si128(b, _mm_loadu_si128(p)));
+	}
+
+	// Save the counter for the next block.
+	ctr[0] = cpu_to_be64(ctr_hi);
+	ctr[1] = cpu_to_be64(ctr_lo);
+	memcpy(iv, ctr, sizeof(ctr));
+}
+
+}
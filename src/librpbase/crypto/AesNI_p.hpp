@@ -0,0 +1,118 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * AesNI_p.hpp: AES decryption class using Intel AES-NI instructions.      *
+ * (PRIVATE CLASS)                                                         *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_CRYPTO_AESNI_P_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_CRYPTO_AESNI_P_HPP__
+
+#include "config.librpbase.h"
+#include "IAesCipher.hpp"
+
+namespace LibRpBase {
+
+class AesNIPrivate
+{
+	public:
+		AesNIPrivate();
+		~AesNIPrivate();
+
+	private:
+		RP_DISABLE_COPY(AesNIPrivate)
+
+	public:
+		// AES block size.
+		static const unsigned int AES_BLOCK_SIZE = 16;
+		// Maximum number of rounds. (AES-256)
+		static const unsigned int AES_MAX_ROUNDS = 14;
+
+		// Expanded round keys.
+		// enc_keys is used for CTR; dec_keys is used for ECB and CBC.
+		// NOTE: Stored as byte arrays, since the private class
+		// might not be allocated with 16-byte alignment.
+		uint8_t enc_keys[(AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE];
+		uint8_t dec_keys[(AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE];
+
+		// Number of rounds: 10, 12, or 14.
+		// 0 if the key hasn't been set.
+		unsigned int rounds;
+
+		// CBC: Initialization vector.
+		// CTR: Counter.
+		uint8_t iv[AES_BLOCK_SIZE];
+
+		IAesCipher::ChainingMode chainingMode;
+
+#ifdef HAVE_AESNI_VAES
+		// Use VAES for multi-block operations?
+		bool use_vaes;
+#endif /* HAVE_AESNI_VAES */
+
+	public:
+		/** AES-NI functions. (AesNI_aesni.cpp) **/
+
+		/**
+		 * Expand a key into enc_keys[] and dec_keys[].
+		 * @param pKey	[in] Key data.
+		 * @param size	[in] Size of pKey, in bytes. (16, 24, or 32)
+		 */
+		void expandKey_aesni(const uint8_t *RESTRICT pKey, size_t size);
+
+		/**
+		 * Decrypt data using ECB.
+		 * @param pData	[in/out] Data.
+		 * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+		 */
+		void decryptECB_aesni(uint8_t *RESTRICT pData, size_t size) const;
+
+		/**
+		 * Decrypt data using CBC.
+		 * The IV is updated for the next block.
+		 * @param pData	[in/out] Data.
+		 * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+		 */
+		void decryptCBC_aesni(uint8_t *RESTRICT pData, size_t size);
+
+		/**
+		 * Decrypt data using CTR.
+		 * The counter is updated for the next block.
+		 * @param pData	[in/out] Data.
+		 * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+		 */
+		void decryptCTR_aesni(uint8_t *RESTRICT pData, size_t size);
+
+#ifdef HAVE_AESNI_VAES
+		/** VAES functions. (AesNI_vaes.cpp) **/
+
+		/**
+		 * Decrypt data using ECB.
+		 * @param pData	[in/out] Data.
+		 * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+		 */
+		void decryptECB_vaes(uint8_t *RESTRICT pData, size_t size) const;
+
+		/**
+		 * Decrypt data using CBC.
+		 * The IV is updated for the next block.
+		 * @param pData	[in/out] Data.
+		 * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+		 */
+		void decryptCBC_vaes(uint8_t *RESTRICT pData, size_t size);
+
+		/**
+		 * Decrypt data using CTR.
+		 * The counter is updated for the next block.
+		 * @param pData	[in/out] Data.
+		 * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+		 */
+		void decryptCTR_vaes(uint8_t *RESTRICT pData, size_t size);
+#endif /* HAVE_AESNI_VAES */
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_CRYPTO_AESNI_P_HPP__ */
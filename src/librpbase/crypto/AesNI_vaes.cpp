@@ -0,0 +1,229 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * AesNI_vaes.cpp: AES decryption class using Intel AES-NI instructions.   *
+ * 256-bit VAES version.                                                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "AesNI_p.hpp"
+
+// librpcpu
+#include "librpcpu/byteswap.h"
+
+// VAES and AVX2 intrinsics.
+#include <immintrin.h>
+
+// Number of 256-bit registers to process at once.
+// Each register holds two blocks.
+#define VAES_PIPELINE_REGS 4
+#define VAES_PIPELINE_BLOCKS (VAES_PIPELINE_REGS * 2)
+
+namespace LibRpBase {
+
+/**
+ * Load round keys and broadcast them to both 128-bit lanes.
+ * @param rk	[out] Round keys.
+ * @param keys	[in] Round keys. (unaligned)
+ * @param rounds [in] Number of rounds.
+ */
+static FORCEINLINE void load_round_keys_vaes(__m256i *rk, const uint8_t *keys, unsigned int rounds)
+{
+	const __m128i *const pKeys = reinterpret_cast<const __m128i*>(keys);
+	for (unsigned int i = 0; i <= rounds; i++) {
+		rk[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128(&pKeys[i]));
+	}
+}
+
+// Apply an operation to each register in the pipeline.
+// NOTE: Explicitly unrolled so the blocks stay in registers.
+#define VAES_FOR_EACH_REG(X) X(0) X(1) X(2) X(3)
+
+/**
+ * Decrypt VAES_PIPELINE_BLOCKS independent blocks.
+ * @param b	[in/out] Blocks. (two per register)
+ * @param rk	[in] Decryption round keys.
+ * @param rounds [in] Number of rounds.
+ */
+static FORCEINLINE void vaes_decrypt_pipeline(__m256i *b, const __m256i *rk, unsigned int rounds)
+{
+#define VAES_XOR(i) b[i] = _mm256_xor_si256(b[i], key);
+#define VAES_DEC(i) b[i] = _mm256_aesdec_epi128(b[i], key);
+#define VAES_DECLAST(i) b[i] = _mm256_aesdeclast_epi128(b[i], key);
+	__m256i key = rk[0];
+	VAES_FOR_EACH_REG(VAES_XOR)
+	for (unsigned int r = 1; r < rounds; r++) {
+		key = rk[r];
+		VAES_FOR_EACH_REG(VAES_DEC)
+	}
+	key = rk[rounds];
+	VAES_FOR_EACH_REG(VAES_DECLAST)
+#undef VAES_XOR
+#undef VAES_DEC
+#undef VAES_DECLAST
+}
+
+/**
+ * Encrypt VAES_PIPELINE_BLOCKS independent blocks.
+ * @param b	[in/out] Blocks. (two per register)
+ * @param rk	[in] Encryption round keys.
+ * @param rounds [in] Number of rounds.
+ */
+static FORCEINLINE void vaes_encrypt_pipeline(__m256i *b, const __m256i *rk, unsigned int rounds)
+{
+#define VAES_XOR(i) b[i] = _mm256_xor_si256(b[i], key);
+#define VAES_ENC(i) b[i] = _mm256_aesenc_epi128(b[i], key);
+#define VAES_ENCLAST(i) b[i] = _mm256_aesenclast_epi128(b[i], key);
+	__m256i key = rk[0];
+	VAES_FOR_EACH_REG(VAES_XOR)
+	for (unsigned int r = 1; r < rounds; r++) {
+		key = rk[r];
+		VAES_FOR_EACH_REG(VAES_ENC)
+	}
+	key = rk[rounds];
+	VAES_FOR_EACH_REG(VAES_ENCLAST)
+#undef VAES_XOR
+#undef VAES_ENC
+#undef VAES_ENCLAST
+}
+
+/**
+ * Decrypt data using ECB.
+ * @param pData	[in/out] Data.
+ * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+ */
+void AesNIPrivate::decryptECB_vaes(uint8_t *RESTRICT pData, size_t size) const
+{
+	__m256i rk[AES_MAX_ROUNDS + 1];
+	load_round_keys_vaes(rk, dec_keys, rounds);
+
+	__m256i *p = reinterpret_cast<__m256i*>(pData);
+	for (; size >= VAES_PIPELINE_BLOCKS * AES_BLOCK_SIZE;
+	     size -= VAES_PIPELINE_BLOCKS * AES_BLOCK_SIZE, p += VAES_PIPELINE_REGS)
+	{
+		__m256i b[VAES_PIPELINE_REGS];
+#define VAES_LOAD(i) b[i] = _mm256_loadu_si256(&p[i]);
+#define VAES_STORE(i) _mm256_storeu_si256(&p[i], b[i]);
+		VAES_FOR_EACH_REG(VAES_LOAD)
+		vaes_decrypt_pipeline(b, rk, rounds);
+		VAES_FOR_EACH_REG(VAES_STORE)
+#undef VAES_LOAD
+#undef VAES_STORE
+	}
+
+	// Avoid AVX-SSE transition penalties.
+	_mm256_zeroupper();
+
+	if (size > 0) {
+		// Decrypt the remaining blocks using 128-bit AES-NI.
+		decryptECB_aesni(reinterpret_cast<uint8_t*>(p), size);
+	}
+}
+
+/**
+ * Decrypt data using CBC.
+ * The IV is updated for the next block.
+ * @param pData	[in/out] Data.
+ * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+ */
+void AesNIPrivate::decryptCBC_vaes(uint8_t *RESTRICT pData, size_t size)
+{
+	__m256i rk[AES_MAX_ROUNDS + 1];
+	load_round_keys_vaes(rk, dec_keys, rounds);
+
+	__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+	uint8_t *p = pData;
+	for (; size >= VAES_PIPELINE_BLOCKS * AES_BLOCK_SIZE;
+	     size -= VAES_PIPELINE_BLOCKS * AES_BLOCK_SIZE, p += VAES_PIPELINE_BLOCKS * AES_BLOCK_SIZE)
+	{
+		// Each plaintext block is XORed with the previous ciphertext
+		// block, so the XOR operands are the ciphertext shifted by
+		// one block, with the IV in front.
+		__m256i b[VAES_PIPELINE_REGS], x[VAES_PIPELINE_REGS];
+#define VAES_LOAD(i) b[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&p[(i) * 32]));
+#define VAES_LOAD_PREV(i) x[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&p[((i) * 32) - 16]));
+#define VAES_STORE(i) _mm256_storeu_si256(reinterpret_cast<__m256i*>(&p[(i) * 32]), _mm256_xor_si256(b[i], x[i]));
+		VAES_FOR_EACH_REG(VAES_LOAD)
+		x[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(prev),
+			_mm256_castsi256_si128(b[0]), 1);
+		VAES_LOAD_PREV(1) VAES_LOAD_PREV(2) VAES_LOAD_PREV(3)
+		prev = _mm256_extracti128_si256(b[VAES_PIPELINE_REGS-1], 1);
+
+		vaes_decrypt_pipeline(b, rk, rounds);
+		VAES_FOR_EACH_REG(VAES_STORE)
+#undef VAES_LOAD
+#undef VAES_LOAD_PREV
+#undef VAES_STORE
+	}
+
+	// Save the IV for the next block.
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(iv), prev);
+
+	// Avoid AVX-SSE transition penalties.
+	_mm256_zeroupper();
+
+	if (size > 0) {
+		// Decrypt the remaining blocks using 128-bit AES-NI.
+		decryptCBC_aesni(p, size);
+	}
+}
+
+/**
+ * Decrypt data using CTR.
+ * The counter is updated for the next block.
+ * @param pData	[in/out] Data.
+ * @param size	[in] Size of pData, in bytes. (Must be a multiple of 16.)
+ */
+void AesNIPrivate::decryptCTR_vaes(uint8_t *RESTRICT pData, size_t size)
+{
+	__m256i rk[AES_MAX_ROUNDS + 1];
+	load_round_keys_vaes(rk, enc_keys, rounds);
+
+	// The counter is a 128-bit big-endian value.
+	uint64_t ctr[2];
+	memcpy(ctr, iv, sizeof(ctr));
+	uint64_t ctr_hi = be64_to_cpu(ctr[0]);
+	uint64_t ctr_lo = be64_to_cpu(ctr[1]);
+
+	__m256i *p = reinterpret_cast<__m256i*>(pData);
+	for (; size >= VAES_PIPELINE_BLOCKS * AES_BLOCK_SIZE;
+	     size -= VAES_PIPELINE_BLOCKS * AES_BLOCK_SIZE, p += VAES_PIPELINE_REGS)
+	{
+		__m256i b[VAES_PIPELINE_REGS];
+		for (unsigned int i = 0; i < VAES_PIPELINE_REGS; i++) {
+			const uint64_t hi0 = ctr_hi, lo0 = ctr_lo;
+			if (++ctr_lo == 0) {
+				ctr_hi++;
+			}
+			b[i] = _mm256_set_epi64x(
+				static_cast<int64_t>(cpu_to_be64(ctr_lo)),
+				static_cast<int64_t>(cpu_to_be64(ctr_hi)),
+				static_cast<int64_t>(cpu_to_be64(lo0)),
+				static_cast<int64_t>(cpu_to_be64(hi0)));
+			if (++ctr_lo == 0) {
+				ctr_hi++;
+			}
+		}
+#define VAES_STORE(i) _mm256_storeu_si256(&p[i], _mm256_xor_si256(b[i], _mm256_loadu_si256(&p[i])));
+		vaes_encrypt_pipeline(b, rk, rounds);
+		VAES_FOR_EACH_REG(VAES_STORE)
+#undef VAES_STORE
+	}
+
+	// Save the counter for the next block.
+	ctr[0] = cpu_to_be64(ctr_hi);
+	ctr[1] = cpu_to_be64(ctr_lo);
+	memcpy(iv, ctr, sizeof(ctr));
+
+	// Avoid AVX-SSE transition penalties.
+	_mm256_zeroupper();
+
+	if (size > 0) {
+		// Decrypt the remaining blocks using 128-bit AES-NI.
+		decryptCTR_aesni(reinterpret_cast<uint8_t*>(p), size);
+	}
+}
+
+}
@@ -88,4 +88,24 @@ bool IDiscReader::isDevice(void) const
 	}
 }
 
+/** Hashing functions **/
+
+/**
+ * Open the image files that make up this disc image.
+ *
+ * This is used by the "Hashes" tab for disc images that
+ * are split into multiple files, e.g. a cue sheet and its
+ * track files, since the track files are hashed instead
+ * of the disc image data.
+ *
+ * @param files	[out] Image files, in disc order. (Must be unref()'d by the caller.)
+ * @return 0 on success; -ENOTSUP if the disc image isn't split into image files; other negative POSIX error code on error.
+ */
+int IDiscReader::openImageFiles(std::vector<IRpFile*> &files)
+{
+	// Default implementation: The disc image is a single file.
+	RP_UNUSED(files);
+	return -ENOTSUP;
+}
+
 }
@@ -17,6 +17,9 @@
 // C includes. (C++ namespace)
 #include <cstddef>
 
+// C++ includes.
+#include <vector>
+
 namespace LibRpFile {
 	class IRpFile;
 }
@@ -127,6 +130,22 @@ class IDiscReader
 		 */
 		bool isDevice(void) const;
 
+	public:
+		/** Hashing functions **/
+
+		/**
+		 * Open the image files that make up this disc image.
+		 *
+		 * This is used by the "Hashes" tab for disc images that
+		 * are split into multiple files, e.g. a cue sheet and its
+		 * track files, since the track files are hashed instead
+		 * of the disc image data.
+		 *
+		 * @param files	[out] Image files, in disc order. (Must be unref()'d by the caller.)
+		 * @return 0 on success; -ENOTSUP if the disc image isn't split into image files; other negative POSIX error code on error.
+		 */
+		virtual int openImageFiles(std::vector<LibRpFile::IRpFile*> &files);
+
 	protected:
 		// Subclasses may have an underlying file, or may
 		// stack another IDiscReader object.
@@ -98,6 +98,18 @@ class PartitionFile : public LibRpFile::IRpFile
 		 */
 		std::string filename(void) const final;
 
+	public:
+		/** PartitionFile functions **/
+
+		/**
+		 * Get the partition this file reads from.
+		 * @return Partition.
+		 */
+		inline IDiscReader *partition(void) const
+		{
+			return m_partition;
+		}
+
 	protected:
 		IDiscReader *m_partition;
 		off64_t m_offset;	// File starting offset.
@@ -11,11 +11,23 @@
 #include "SparseDiscReader.hpp"
 #include "SparseDiscReader_p.hpp"
 
+// C includes. (C++ namespace)
+#include <climits>
+
 // librpfile
 using LibRpFile::IRpFile;
 
 namespace LibRpBase {
 
+// Maximum total size of the block cache.
+#define BLOCK_CACHE_MAX_SIZE (256U*1024U)
+// Maximum number of block cache entries.
+#define BLOCK_CACHE_MAX_COUNT 16U
+// Maximum block size for the block cache.
+// Larger blocks (e.g. WBFS) aren't cached, since
+// reading a full block for a small read is too expensive.
+#define BLOCK_CACHE_MAX_BLOCK_SIZE (64U*1024U)
+
 /** SparseDiscReaderPrivate **/
 
 SparseDiscReaderPrivate::SparseDiscReaderPrivate(SparseDiscReader *q)
@@ -23,6 +35,11 @@ SparseDiscReaderPrivate::SparseDiscReaderPrivate(SparseDiscReader *q)
 	, disc_size(0)
 	, pos(-1)
 	, block_size(0)
+	, canCoalesce(true)
+	, block_cache(nullptr)
+	, block_cache_buf(nullptr)
+	, block_cache_count(0)
+	, block_cache_lru(0)
 {
 	// NOTE: Can't check q->m_file here.
 
@@ -30,6 +47,101 @@ SparseDiscReaderPrivate::SparseDiscReaderPrivate(SparseDiscReader *q)
 	// set by the subclass.
 }
 
+SparseDiscReaderPrivate::~SparseDiscReaderPrivate()
+{
+	delete[] block_cache;
+	delete[] block_cache_buf;
+}
+
+/**
+ * Get a block from the block cache.
+ * @param blockIdx Block index.
+ * @return Cached block data, or nullptr if the block isn't cached.
+ */
+const uint8_t *SparseDiscReaderPrivate::getCachedBlock(uint32_t blockIdx)
+{
+	for (unsigned int i = 0; i < block_cache_count; i++) {
+		if (block_cache[i].blockIdx == blockIdx) {
+			block_cache[i].lru = ++block_cache_lru;
+			return &block_cache_buf[i * block_size];
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Read part of a block using the block cache.
+ * If the block isn't cached, the full block is read and cached.
+ * If the block size is too large for the cache, this is
+ * the same as calling readBlock() directly.
+ *
+ * @param blockIdx	[in] Block index.
+ * @param ptr		[out] Output data buffer.
+ * @param pos		[in] Starting position. (Must be >= 0 and <= the block size!)
+ * @param size		[in] Amount of data to read, in bytes. (Must be <= the block size!)
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int SparseDiscReaderPrivate::readBlockCached(uint32_t blockIdx, void *ptr, int pos, size_t size)
+{
+	RP_Q(SparseDiscReader);
+	if (block_size > BLOCK_CACHE_MAX_BLOCK_SIZE) {
+		// Block is too big to cache.
+		return q->readBlock(blockIdx, ptr, pos, size);
+	}
+
+	assert(pos >= 0 && pos < static_cast<int>(block_size));
+	assert(static_cast<off64_t>(pos + size) <= static_cast<off64_t>(block_size));
+	if (pos < 0 || static_cast<off64_t>(pos + size) > static_cast<off64_t>(block_size)) {
+		// pos+size is out of range.
+		return -1;
+	}
+
+	if (!block_cache) {
+		// Allocate the block cache.
+		block_cache_count = BLOCK_CACHE_MAX_SIZE / block_size;
+		if (block_cache_count > BLOCK_CACHE_MAX_COUNT) {
+			block_cache_count = BLOCK_CACHE_MAX_COUNT;
+		} else if (block_cache_count == 0) {
+			block_cache_count = 1;
+		}
+		block_cache = new BlockCacheEntry[block_cache_count];
+		for (unsigned int i = 0; i < block_cache_count; i++) {
+			block_cache[i].blockIdx = ~0U;
+			block_cache[i].lru = 0;
+		}
+		block_cache_buf = new uint8_t[block_cache_count * block_size];
+	}
+
+	const uint8_t *blockData = getCachedBlock(blockIdx);
+	if (!blockData) {
+		// Block isn't cached.
+		// Replace the least-recently used entry.
+		unsigned int idx = 0;
+		for (unsigned int i = 1; i < block_cache_count; i++) {
+			if (block_cache[i].lru < block_cache[idx].lru) {
+				idx = i;
+			}
+		}
+
+		uint8_t *const buf = &block_cache_buf[idx * block_size];
+		int rd = q->readBlock(blockIdx, buf, 0, block_size);
+		if (rd != static_cast<int>(block_size)) {
+			// Short read, e.g. the last block in a truncated image.
+			// Don't cache it; read the requested data directly.
+			block_cache[idx].blockIdx = ~0U;
+			block_cache[idx].lru = 0;
+			return q->readBlock(blockIdx, ptr, pos, size);
+		}
+
+		block_cache[idx].blockIdx = blockIdx;
+		block_cache[idx].lru = ++block_cache_lru;
+		blockData = buf;
+	}
+
+	memcpy(ptr, &blockData[pos], size);
+	return static_cast<int>(size);
+}
+
 /** SparseDiscReader **/
 
 SparseDiscReader::SparseDiscReader(SparseDiscReaderPrivate *d, IRpFile *file)
@@ -90,7 +202,7 @@ size_t SparseDiscReader::read(void *ptr, size_t size)
 		}
 
 		const unsigned int blockIdx = static_cast<unsigned int>(d->pos / block_size);
-		int rd = this->readBlock(blockIdx, ptr8, blockStartOffset, read_sz);
+		int rd = d->readBlockCached(blockIdx, ptr8, blockStartOffset, read_sz);
 		if (rd < 0 || rd != static_cast<int>(read_sz)) {
 			// Error reading the data.
 			return (rd > 0 ? rd : 0);
@@ -104,17 +216,64 @@ size_t SparseDiscReader::read(void *ptr, size_t size)
 	}
 
 	// Read entire blocks.
-	for (; size >= block_size;
-	    size -= block_size, ptr8 += block_size,
-	    ret += block_size, d->pos += block_size)
-	{
+	while (size >= block_size) {
 		assert(d->pos % block_size == 0);
 		const unsigned int blockIdx = static_cast<unsigned int>(d->pos / block_size);
-		int rd = this->readBlock(blockIdx, ptr8, 0, block_size);
-		if (rd < 0 || rd != static_cast<int>(block_size)) {
+
+		// Check the block cache first.
+		const uint8_t *const blockData = d->getCachedBlock(blockIdx);
+		if (blockData) {
+			memcpy(ptr8, blockData, block_size);
+			size -= block_size;
+			ptr8 += block_size;
+			ret += block_size;
+			d->pos += block_size;
+			continue;
+		}
+
+		// Find a run of physically contiguous blocks
+		// so they can be read with a single read request.
+		const off64_t physBlockAddr = (d->canCoalesce ? getPhysBlockAddr(blockIdx) : 0);
+		if (physBlockAddr > 0) {
+			const size_t maxBlocks = size / block_size;
+			size_t blockCount = 1;
+			for (; blockCount < maxBlocks; blockCount++) {
+				const off64_t nextAddr = getPhysBlockAddr(static_cast<uint32_t>(blockIdx + blockCount));
+				if (nextAddr != physBlockAddr + static_cast<off64_t>(blockCount * block_size)) {
+					// Not contiguous.
+					break;
+				}
+			}
+
+			const size_t read_sz = blockCount * block_size;
+			size_t sz_read = m_file->seekAndRead(physBlockAddr, ptr8, read_sz);
+			m_lastError = m_file->lastError();
+			if (sz_read != read_sz) {
+				// Error reading the data.
+				return ret + sz_read;
+			}
+
+			size -= read_sz;
+			ptr8 += read_sz;
+			ret += read_sz;
+			d->pos += read_sz;
+			continue;
+		}
+
+		// Empty block, invalid block, or readBlock() is overridden.
+		// NOTE: Limiting the block count so the number of bytes fits in an int.
+		const unsigned int maxBlocks = static_cast<unsigned int>(
+			std::min(size / block_size, static_cast<size_t>(INT_MAX / block_size)));
+		int rd = this->readBlocks(blockIdx, ptr8, maxBlocks);
+		if (rd < static_cast<int>(block_size) || rd % block_size != 0) {
 			// Error reading the data.
 			return ret + (rd > 0 ? rd : 0);
 		}
+
+		size -= rd;
+		ptr8 += rd;
+		ret += rd;
+		d->pos += rd;
 	}
 
 	// Check if we still have data left. (not a full block)
@@ -124,7 +283,7 @@ size_t SparseDiscReader::read(void *ptr, size_t size)
 
 		// Read the start of the block.
 		const unsigned int blockIdx = static_cast<unsigned int>(d->pos / block_size);
-		int rd = this->readBlock(blockIdx, ptr8, 0, size);
+		int rd = d->readBlockCached(blockIdx, ptr8, 0, size);
 		if (rd < 0 || rd != static_cast<int>(size)) {
 			// Error reading the data.
 			return ret + (rd > 0 ? rd : 0);
@@ -263,4 +422,26 @@ int SparseDiscReader::readBlock(uint32_t blockIdx, void *ptr, int pos, size_t si
 	return (sz_read > 0 ? (int)sz_read : -1);
 }
 
+/**
+ * Read multiple full blocks.
+ *
+ * This is used by read() for blocks that can't be read
+ * directly using getPhysBlockAddr(), e.g. if readBlock()
+ * is overridden. The default implementation reads a single
+ * block using readBlock(). Subclasses that can read multiple
+ * blocks with a single read request should override this.
+ *
+ * @param blockIdx	[in] First block index.
+ * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+ * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+ * @return Number of bytes read, or -1 if the block index is invalid.
+ */
+int SparseDiscReader::readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount)
+{
+	RP_D(SparseDiscReader);
+	assert(blockCount >= 1);
+	RP_UNUSED(blockCount);
+	return this->readBlock(blockIdx, ptr, 0, d->block_size);
+}
+
 }
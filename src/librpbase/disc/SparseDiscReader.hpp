@@ -83,7 +83,8 @@ class SparseDiscReader : public IDiscReader
 		 *
 		 * This function can be overridden by subclasses if necessary,
 		 * though usually it isn't needed. Override getPhysBlockAddr()
-		 * instead.
+		 * instead. If this function is overridden, the subclass must
+		 * set SparseDiscReaderPrivate::canCoalesce to false.
 		 *
 		 * @param blockIdx	[in] Block index.
 		 * @param ptr		[out] Output data buffer.
@@ -92,6 +93,22 @@ class SparseDiscReader : public IDiscReader
 		 * @return Number of bytes read, or -1 if the block index is invalid.
 		 */
 		virtual int readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size);
+
+		/**
+		 * Read multiple full blocks.
+		 *
+		 * This is used by read() for blocks that can't be read
+		 * directly using getPhysBlockAddr(), e.g. if readBlock()
+		 * is overridden. The default implementation reads a single
+		 * block using readBlock(). Subclasses that can read multiple
+		 * blocks with a single read request should override this.
+		 *
+		 * @param blockIdx	[in] First block index.
+		 * @param ptr		[out] Output data buffer. (Must be at least blockCount * block_size bytes!)
+		 * @param blockCount	[in] Maximum number of blocks to read. (Must be at least 1!)
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		virtual int readBlocks(uint32_t blockIdx, void *ptr, unsigned int blockCount);
 };
 
 }
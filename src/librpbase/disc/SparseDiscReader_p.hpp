@@ -22,7 +22,7 @@ class SparseDiscReaderPrivate
 	protected:
 		SparseDiscReaderPrivate(SparseDiscReader *q);
 	public:
-		virtual ~SparseDiscReaderPrivate() { };
+		virtual ~SparseDiscReaderPrivate();
 
 	private:
 		RP_DISABLE_COPY(SparseDiscReaderPrivate)
@@ -34,6 +34,45 @@ class SparseDiscReaderPrivate
 		off64_t disc_size;		// Virtual disc image size.
 		off64_t pos;			// Read position.
 		unsigned int block_size;	// Block size.
+
+		// If true, read() may bypass readBlock() and read runs of
+		// physically contiguous blocks directly, using getPhysBlockAddr().
+		// Subclasses that override readBlock() must set this to false.
+		bool canCoalesce;
+
+	public:
+		// Block cache. (LRU)
+		// Only used for partial block reads, and only if
+		// the block size is BLOCK_CACHE_MAX_BLOCK_SIZE or less.
+		struct BlockCacheEntry {
+			uint32_t blockIdx;	// Block index. (~0 if unused)
+			uint32_t lru;		// LRU stamp. (higher is more recent)
+		};
+		BlockCacheEntry *block_cache;		// Cache entries.
+		uint8_t *block_cache_buf;		// Cached block data. (block_cache_count * block_size)
+		unsigned int block_cache_count;		// Number of cache entries.
+		uint32_t block_cache_lru;		// Most recent LRU stamp.
+
+		/**
+		 * Get a block from the block cache.
+		 * @param blockIdx Block index.
+		 * @return Cached block data, or nullptr if the block isn't cached.
+		 */
+		const uint8_t *getCachedBlock(uint32_t blockIdx);
+
+		/**
+		 * Read part of a block using the block cache.
+		 * If the block isn't cached, the full block is read and cached.
+		 * If the block size is too large for the cache, this is
+		 * the same as calling readBlock() directly.
+		 *
+		 * @param blockIdx	[in] Block index.
+		 * @param ptr		[out] Output data buffer.
+		 * @param pos		[in] Starting position. (Must be >= 0 and <= the block size!)
+		 * @param size		[in] Amount of data to read, in bytes. (Must be <= the block size!)
+		 * @return Number of bytes read, or -1 if the block index is invalid.
+		 */
+		int readBlockCached(uint32_t blockIdx, void *ptr, int pos, size_t size);
 };
 
 }
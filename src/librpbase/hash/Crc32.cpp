@@ -0,0 +1,94 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * Crc32.cpp: CRC-32 checksum calculation.                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "Crc32.hpp"
+
+// librpcpu
+#include "librpcpu/byteswap.h"
+
+// librpthreads
+#include "librpthreads/pthread_once.h"
+
+namespace LibRpBase {
+
+// Reflected CRC-32 polynomial.
+#define CRC32_POLY 0xEDB88320U
+
+// Slicing-by-8 tables.
+// crc32_table[0] is the standard byte-at-a-time table.
+static uint32_t crc32_table[8][256];
+static pthread_once_t crc32_once_control = PTHREAD_ONCE_INIT;
+
+/**
+ * Initialize the CRC-32 tables.
+ * Called by pthread_once().
+ */
+static void initCrc32Table(void)
+{
+	for (unsigned int i = 0; i < 256; i++) {
+		uint32_t crc = i;
+		for (unsigned int j = 8; j > 0; j--) {
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLY : 0);
+		}
+		crc32_table[0][i] = crc;
+	}
+
+	for (unsigned int i = 0; i < 256; i++) {
+		uint32_t crc = crc32_table[0][i];
+		for (unsigned int t = 1; t < 8; t++) {
+			crc = crc32_table[0][crc & 0xFF] ^ (crc >> 8);
+			crc32_table[t][i] = crc;
+		}
+	}
+}
+
+/**
+ * Calculate a CRC-32. (Standard version)
+ * @param crc Previous CRC-32 value. (0 for the first block)
+ * @param buf Data buffer.
+ * @param size Size of data buffer.
+ * @return New CRC-32 value.
+ */
+uint32_t Crc32::calc_cpp(uint32_t crc, const void *buf, size_t size)
+{
+	pthread_once(&crc32_once_control, initCrc32Table);
+
+	const uint8_t *p = static_cast<const uint8_t*>(buf);
+	crc = ~crc;
+
+	// Process single bytes until the buffer is 32-bit aligned.
+	for (; size > 0 && (reinterpret_cast<uintptr_t>(p) & 3); size--, p++) {
+		crc = crc32_table[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+	}
+
+	// Process 8 bytes at a time.
+	const uint32_t *p32 = reinterpret_cast<const uint32_t*>(p);
+	for (; size >= 8; size -= 8, p32 += 2) {
+		const uint32_t lo = le32_to_cpu(p32[0]) ^ crc;
+		const uint32_t hi = le32_to_cpu(p32[1]);
+		crc = crc32_table[7][ lo        & 0xFF] ^
+		      crc32_table[6][(lo >>  8) & 0xFF] ^
+		      crc32_table[5][(lo >> 16) & 0xFF] ^
+		      crc32_table[4][ lo >> 24        ] ^
+		      crc32_table[3][ hi        & 0xFF] ^
+		      crc32_table[2][(hi >>  8) & 0xFF] ^
+		      crc32_table[1][(hi >> 16) & 0xFF] ^
+		      crc32_table[0][ hi >> 24        ];
+	}
+	p = reinterpret_cast<const uint8_t*>(p32);
+
+	// Process the remaining bytes.
+	for (; size > 0; size--, p++) {
+		crc = crc32_table[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+}
@@ -0,0 +1,115 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * Crc32.hpp: CRC-32 checksum calculation.                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_HASH_CRC32_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_HASH_CRC32_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stddef.h>	/* size_t */
+#include <stdint.h>
+
+#include "librpcpu/cpu_dispatch.h"
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+# include "librpcpu/cpuflags_x86.h"
+# define CRC32_HAS_PCLMUL 1
+#endif
+
+namespace LibRpBase {
+
+/**
+ * CRC-32 checksum. (ISO 3309, as used by zlib and DAT files)
+ *
+ * The CRC value is compatible with zlib's crc32():
+ * start with 0, and pass the previous value to continue.
+ */
+class Crc32
+{
+	public:
+		Crc32()
+			: m_crc(0)
+		{ }
+
+	public:
+		/**
+		 * Reset the CRC to the initial value.
+		 */
+		inline void reset(void)
+		{
+			m_crc = 0;
+		}
+
+		/**
+		 * Add data to the CRC.
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 */
+		inline void update(const void *buf, size_t size)
+		{
+			m_crc = calc(m_crc, buf, size);
+		}
+
+		/**
+		 * Get the current CRC value.
+		 * @return CRC-32.
+		 */
+		inline uint32_t value(void) const
+		{
+			return m_crc;
+		}
+
+	public:
+		/**
+		 * Calculate a CRC-32. (Standard version)
+		 * @param crc Previous CRC-32 value. (0 for the first block)
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 * @return New CRC-32 value.
+		 */
+		static uint32_t calc_cpp(uint32_t crc, const void *buf, size_t size);
+
+#ifdef CRC32_HAS_PCLMUL
+		/**
+		 * Calculate a CRC-32. (PCLMULQDQ-optimized version)
+		 * Requires PCLMULQDQ and SSE4.1.
+		 * @param crc Previous CRC-32 value. (0 for the first block)
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 * @return New CRC-32 value.
+		 */
+		static uint32_t calc_pclmul(uint32_t crc, const void *buf, size_t size);
+#endif /* CRC32_HAS_PCLMUL */
+
+		/**
+		 * Calculate a CRC-32.
+		 * The best implementation for this CPU is used.
+		 * @param crc Previous CRC-32 value. (0 for the first block)
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 * @return New CRC-32 value.
+		 */
+		static inline uint32_t calc(uint32_t crc, const void *buf, size_t size)
+		{
+#ifdef CRC32_HAS_PCLMUL
+			if (RP_CPU_HasPCLMULQDQ()) {
+				return calc_pclmul(crc, buf, size);
+			} else
+#endif /* CRC32_HAS_PCLMUL */
+			{
+				return calc_cpp(crc, buf, size);
+			}
+		}
+
+	private:
+		uint32_t m_crc;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_HASH_CRC32_HPP__ */
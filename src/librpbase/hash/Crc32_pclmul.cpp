@@ -0,0 +1,148 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * Crc32_pclmul.cpp: CRC-32 checksum calculation.                          *
+ * PCLMULQDQ-optimized version.                                            *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "Crc32.hpp"
+
+// SSE4.1 and PCLMULQDQ intrinsics.
+#include <smmintrin.h>
+#include <wmmintrin.h>
+
+namespace LibRpBase {
+
+// Reference: Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction
+// https://www.intel.com/content/dam/www/public/us/en/documents/white-papers/fast-crc-computation-generic-polynomials-pclmulqdq-paper.pdf
+
+// Folding constants for the bit-reflected CRC-32 polynomial.
+// k1/k2 fold 512 bits; k3/k4 fold 128 bits; k5 folds 64 bits.
+static const ALIGNED_VAR(16, uint64_t k1k2[2]) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+static const ALIGNED_VAR(16, uint64_t k3k4[2]) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+static const ALIGNED_VAR(16, uint64_t k5k0[2]) = { 0x0163cd6124ULL, 0x0000000000ULL };
+// Barrett reduction constants: P(x) and u = floor(x^64 / P(x)).
+static const ALIGNED_VAR(16, uint64_t poly[2]) = { 0x01db710641ULL, 0x01f7011641ULL };
+
+/**
+ * Fold a buffer into a CRC-32 using PCLMULQDQ.
+ * @param buf Data buffer.
+ * @param size Size of data buffer. (Must be a multiple of 16, and at least 64.)
+ * @param crc Previous CRC-32 value, inverted.
+ * @return New CRC-32 value, inverted.
+ */
+static uint32_t crc32_fold_pclmul(const uint8_t *buf, size_t size, uint32_t crc)
+{
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	// Load the first 64 bytes.
+	x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00));
+	x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10));
+	x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20));
+	x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+	buf += 64;
+	size -= 64;
+
+	// Fold 64 bytes at a time using four independent accumulators.
+	x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+	for (; size >= 64; buf += 64, size -= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30)));
+	}
+
+	// Fold the four accumulators into one.
+	x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// Fold the remaining 16-byte blocks.
+	for (; size >= 16; buf += 16, size -= 16) {
+		x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	}
+
+	// Fold 128 bits to 64 bits.
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits.
+	x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+/**
+ * Calculate a CRC-32. (PCLMULQDQ-optimized version)
+ * Requires PCLMULQDQ and SSE4.1.
+ * @param crc Previous CRC-32 value. (0 for the first block)
+ * @param buf Data buffer.
+ * @param size Size of data buffer.
+ * @return New CRC-32 value.
+ */
+uint32_t Crc32::calc_pclmul(uint32_t crc, const void *buf, size_t size)
+{
+	const uint8_t *p = static_cast<const uint8_t*>(buf);
+	if (size >= 64) {
+		// Fold as many 16-byte blocks as possible.
+		const size_t fold_size = size & ~static_cast<size_t>(15);
+		crc = ~crc32_fold_pclmul(p, fold_size, ~crc);
+		p += fold_size;
+		size -= fold_size;
+	}
+
+	// Handle the remaining bytes using the standard version.
+	if (size > 0) {
+		crc = calc_cpp(crc, p, size);
+	}
+	return crc;
+}
+
+}
@@ -0,0 +1,201 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * Md5.cpp: MD5 message digest. (RFC 1321)                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "Md5.hpp"
+
+// librpcpu
+#include "librpcpu/byteswap.h"
+
+namespace LibRpBase {
+
+// Round functions.
+#define MD5_F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z)	((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z)	((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z)	((y) ^ ((x) | ~(z)))
+
+#define ROTL32(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+#define MD5_STEP(f, a, b, c, d, x, t, s) do { \
+	(a) += f((b), (c), (d)) + (x) + (t); \
+	(a) = ROTL32((a), (s)) + (b); \
+} while (0)
+
+Md5::Md5()
+{
+	reset();
+}
+
+/**
+ * Reset the hash state.
+ */
+void Md5::reset(void)
+{
+	m_state[0] = 0x67452301;
+	m_state[1] = 0xEFCDAB89;
+	m_state[2] = 0x98BADCFE;
+	m_state[3] = 0x10325476;
+	m_count = 0;
+}
+
+/**
+ * Process a single 64-byte block.
+ * @param block Block.
+ */
+void Md5::processBlock(const uint8_t *block)
+{
+	uint32_t x[16];
+	memcpy(x, block, sizeof(x));
+#if SYS_BYTEORDER == SYS_BIG_ENDIAN
+	for (unsigned int i = 0; i < 16; i++) {
+		x[i] = le32_to_cpu(x[i]);
+	}
+#endif /* SYS_BYTEORDER == SYS_BIG_ENDIAN */
+
+	uint32_t a = m_state[0];
+	uint32_t b = m_state[1];
+	uint32_t c = m_state[2];
+	uint32_t d = m_state[3];
+
+	// Round 1
+	MD5_STEP(MD5_F, a, b, c, d, x[ 0], 0xD76AA478,  7);
+	MD5_STEP(MD5_F, d, a, b, c, x[ 1], 0xE8C7B756, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[ 2], 0x242070DB, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[ 3], 0xC1BDCEEE, 22);
+	MD5_STEP(MD5_F, a, b, c, d, x[ 4], 0xF57C0FAF,  7);
+	MD5_STEP(MD5_F, d, a, b, c, x[ 5], 0x4787C62A, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[ 6], 0xA8304613, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[ 7], 0xFD469501, 22);
+	MD5_STEP(MD5_F, a, b, c, d, x[ 8], 0x698098D8,  7);
+	MD5_STEP(MD5_F, d, a, b, c, x[ 9], 0x8B44F7AF, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[10], 0xFFFF5BB1, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[11], 0x895CD7BE, 22);
+	MD5_STEP(MD5_F, a, b, c, d, x[12], 0x6B901122,  7);
+	MD5_STEP(MD5_F, d, a, b, c, x[13], 0xFD987193, 12);
+	MD5_STEP(MD5_F, c, d, a, b, x[14], 0xA679438E, 17);
+	MD5_STEP(MD5_F, b, c, d, a, x[15], 0x49B40821, 22);
+
+	// Round 2
+	MD5_STEP(MD5_G, a, b, c, d, x[ 1], 0xF61E2562,  5);
+	MD5_STEP(MD5_G, d, a, b, c, x[ 6], 0xC040B340,  9);
+	MD5_STEP(MD5_G, c, d, a, b, x[11], 0x265E5A51, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[ 0], 0xE9B6C7AA, 20);
+	MD5_STEP(MD5_G, a, b, c, d, x[ 5], 0xD62F105D,  5);
+	MD5_STEP(MD5_G, d, a, b, c, x[10], 0x02441453,  9);
+	MD5_STEP(MD5_G, c, d, a, b, x[15], 0xD8A1E681, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[ 4], 0xE7D3FBC8, 20);
+	MD5_STEP(MD5_G, a, b, c, d, x[ 9], 0x21E1CDE6,  5);
+	MD5_STEP(MD5_G, d, a, b, c, x[14], 0xC33707D6,  9);
+	MD5_STEP(MD5_G, c, d, a, b, x[ 3], 0xF4D50D87, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[ 8], 0x455A14ED, 20);
+	MD5_STEP(MD5_G, a, b, c, d, x[13], 0xA9E3E905,  5);
+	MD5_STEP(MD5_G, d, a, b, c, x[ 2], 0xFCEFA3F8,  9);
+	MD5_STEP(MD5_G, c, d, a, b, x[ 7], 0x676F02D9, 14);
+	MD5_STEP(MD5_G, b, c, d, a, x[12], 0x8D2A4C8A, 20);
+
+	// Round 3
+	MD5_STEP(MD5_H, a, b, c, d, x[ 5], 0xFFFA3942,  4);
+	MD5_STEP(MD5_H, d, a, b, c, x[ 8], 0x8771F681, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[11], 0x6D9D6122, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[14], 0xFDE5380C, 23);
+	MD5_STEP(MD5_H, a, b, c, d, x[ 1], 0xA4BEEA44,  4);
+	MD5_STEP(MD5_H, d, a, b, c, x[ 4], 0x4BDECFA9, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[ 7], 0xF6BB4B60, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[10], 0xBEBFBC70, 23);
+	MD5_STEP(MD5_H, a, b, c, d, x[13], 0x289B7EC6,  4);
+	MD5_STEP(MD5_H, d, a, b, c, x[ 0], 0xEAA127FA, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[ 3], 0xD4EF3085, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[ 6], 0x04881D05, 23);
+	MD5_STEP(MD5_H, a, b, c, d, x[ 9], 0xD9D4D039,  4);
+	MD5_STEP(MD5_H, d, a, b, c, x[12], 0xE6DB99E5, 11);
+	MD5_STEP(MD5_H, c, d, a, b, x[15], 0x1FA27CF8, 16);
+	MD5_STEP(MD5_H, b, c, d, a, x[ 2], 0xC4AC5665, 23);
+
+	// Round 4
+	MD5_STEP(MD5_I, a, b, c, d, x[ 0], 0xF4292244,  6);
+	MD5_STEP(MD5_I, d, a, b, c, x[ 7], 0x432AFF97, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[14], 0xAB9423A7, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[ 5], 0xFC93A039, 21);
+	MD5_STEP(MD5_I, a, b, c, d, x[12], 0x655B59C3,  6);
+	MD5_STEP(MD5_I, d, a, b, c, x[ 3], 0x8F0CCC92, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[10], 0xFFEFF47D, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[ 1], 0x85845DD1, 21);
+	MD5_STEP(MD5_I, a, b, c, d, x[ 8], 0x6FA87E4F,  6);
+	MD5_STEP(MD5_I, d, a, b, c, x[15], 0xFE2CE6E0, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[ 6], 0xA3014314, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[13], 0x4E0811A1, 21);
+	MD5_STEP(MD5_I, a, b, c, d, x[ 4], 0xF7537E82,  6);
+	MD5_STEP(MD5_I, d, a, b, c, x[11], 0xBD3AF235, 10);
+	MD5_STEP(MD5_I, c, d, a, b, x[ 2], 0x2AD7D2BB, 15);
+	MD5_STEP(MD5_I, b, c, d, a, x[ 9], 0xEB86D391, 21);
+
+	m_state[0] += a;
+	m_state[1] += b;
+	m_state[2] += c;
+	m_state[3] += d;
+}
+
+/**
+ * Add data to the hash.
+ * @param buf Data buffer.
+ * @param size Size of data buffer.
+ */
+void Md5::update(const void *buf, size_t size)
+{
+	const uint8_t *p = static_cast<const uint8_t*>(buf);
+	unsigned int bufPos = static_cast<unsigned int>(m_count & 63);
+	m_count += size;
+
+	if (bufPos > 0) {
+		// Fill the partial block first.
+		const size_t fill = 64 - bufPos;
+		if (size < fill) {
+			memcpy(&m_buf[bufPos], p, size);
+			return;
+		}
+		memcpy(&m_buf[bufPos], p, fill);
+		processBlock(m_buf);
+		p += fill;
+		size -= fill;
+	}
+
+	// Process full blocks directly from the input buffer.
+	for (; size >= 64; p += 64, size -= 64) {
+		processBlock(p);
+	}
+
+	// Save the remaining data.
+	if (size > 0) {
+		memcpy(m_buf, p, size);
+	}
+}
+
+/**
+ * Finish the hash and get the digest.
+ * The hash must be reset before it can be reused.
+ * @param digest Output buffer for the digest. (DIGEST_SIZE bytes)
+ */
+void Md5::finish(uint8_t *digest)
+{
+	// Message length in bits, little-endian.
+	const uint64_t bitCount = cpu_to_le64(m_count << 3);
+
+	// Pad to 56 mod 64, then append the length.
+	static const uint8_t padding[64] = {0x80};
+	const unsigned int bufPos = static_cast<unsigned int>(m_count & 63);
+	update(padding, (bufPos < 56) ? (56 - bufPos) : (120 - bufPos));
+	update(&bitCount, sizeof(bitCount));
+
+	for (unsigned int i = 0; i < 4; i++) {
+		const uint32_t s = cpu_to_le32(m_state[i]);
+		memcpy(&digest[i * 4], &s, sizeof(s));
+	}
+}
+
+}
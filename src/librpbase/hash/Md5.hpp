@@ -0,0 +1,63 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * Md5.hpp: MD5 message digest. (RFC 1321)                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_HASH_MD5_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_HASH_MD5_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stddef.h>	/* size_t */
+#include <stdint.h>
+
+namespace LibRpBase {
+
+class Md5
+{
+	public:
+		Md5();
+
+	public:
+		// Digest size, in bytes.
+		static const unsigned int DIGEST_SIZE = 16;
+
+		/**
+		 * Reset the hash state.
+		 */
+		void reset(void);
+
+		/**
+		 * Add data to the hash.
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 */
+		void update(const void *buf, size_t size);
+
+		/**
+		 * Finish the hash and get the digest.
+		 * The hash must be reset before it can be reused.
+		 * @param digest Output buffer for the digest. (DIGEST_SIZE bytes)
+		 */
+		void finish(uint8_t *digest);
+
+	private:
+		/**
+		 * Process a single 64-byte block.
+		 * @param block Block.
+		 */
+		void processBlock(const uint8_t *block);
+
+	private:
+		uint32_t m_state[4];
+		uint64_t m_count;	// Total number of bytes processed.
+		uint8_t m_buf[64];	// Partial block.
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_HASH_MD5_HPP__ */
@@ -0,0 +1,587 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * MultiHash.cpp: Streaming CRC32/MD5/SHA-1 calculation.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "MultiHash.hpp"
+
+#include "Crc32.hpp"
+#include "Md5.hpp"
+#include "Sha1.hpp"
+#include "../aligned_malloc.h"
+#include "../disc/IDiscReader.hpp"
+
+// librpfile
+#include "librpfile/IRpFile.hpp"
+using LibRpFile::IRpFile;
+
+// librpthreads
+#include "librpthreads/Atomics.h"
+#include "librpthreads/Semaphore.hpp"
+#include "librpthreads/Thread.hpp"
+
+// C++ STL classes.
+using std::string;
+
+namespace LibRpBase {
+
+class MultiHashPrivate
+{
+	public:
+		MultiHashPrivate();
+
+	private:
+		RP_DISABLE_COPY(MultiHashPrivate)
+
+	public:
+		// Hash algorithms. (bitfield)
+		enum HashAlgo_e {
+			HASH_CRC32	= (1U << 0),
+			HASH_MD5	= (1U << 1),
+			HASH_SHA1	= (1U << 2),
+
+			HASH_ALL	= HASH_CRC32 | HASH_MD5 | HASH_SHA1,
+		};
+
+		/**
+		 * Add data to the specified hashes.
+		 * @param algos Bitfield of HashAlgo_e.
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 */
+		void update(unsigned int algos, const void *buf, size_t size);
+
+		/**
+		 * Hash an entire IRpFile or IDiscReader.
+		 * @param src Source.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		template<typename T>
+		int hashStream(T *src);
+
+	public:
+		Crc32 crc32;
+		Md5 md5;
+		Sha1 sha1;
+		uint64_t dataSize;
+		bool finished;
+
+		uint8_t md5Digest[Md5::DIGEST_SIZE];
+		uint8_t sha1Digest[Sha1::DIGEST_SIZE];
+};
+
+/**
+ * Double-buffered hashing pipeline.
+ *
+ * Buffers are filled on the calling thread and hashed on
+ * worker threads. MD5 and SHA-1 are serial algorithms, so
+ * if enough CPUs are available, SHA-1 is calculated on its
+ * own worker thread, and CRC-32 and MD5 on another.
+ *
+ * A buffer is returned to the reader once all workers
+ * have hashed it. An empty buffer tells the workers
+ * to exit.
+ */
+class HashPipeline
+{
+	public:
+		explicit HashPipeline(MultiHashPrivate *d);
+		~HashPipeline();
+
+	private:
+		RP_DISABLE_COPY(HashPipeline)
+
+	public:
+		// Number of buffers.
+		static const unsigned int BUFFER_COUNT = 2;
+		// Size of each buffer.
+		static const size_t BUFFER_SIZE = 4U*1024U*1024U;
+
+		/**
+		 * Is the pipeline usable?
+		 * @return True if the buffers were allocated.
+		 */
+		inline bool isUsable(void) const
+		{
+			return m_isUsable;
+		}
+
+		/**
+		 * Get an empty buffer.
+		 * This blocks until a buffer is available.
+		 * @return Buffer. (BUFFER_SIZE bytes)
+		 */
+		uint8_t *getBuffer(void);
+
+		/**
+		 * Send a filled buffer to the workers.
+		 * @param size Amount of data in the buffer. (0 to stop the workers)
+		 */
+		void submitBuffer(size_t size);
+
+	private:
+		/**
+		 * Worker thread function.
+		 * @param param Worker.
+		 */
+		static void workerProc(void *param);
+
+	private:
+		MultiHashPrivate *const d;
+
+		struct Worker {
+			HashPipeline *pipeline;
+			unsigned int algos;	// MultiHashPrivate::HashAlgo_e
+			Semaphore semFilled;	// Released once per filled buffer.
+			Thread thread;
+
+			Worker()
+				: pipeline(nullptr)
+				, algos(0)
+				, semFilled(0)
+			{ }
+		};
+		Worker m_workers[2];
+		unsigned int m_workerCount;
+
+		Semaphore m_semFree;	// Number of empty buffers.
+		uint8_t *m_buf[BUFFER_COUNT];
+		size_t m_bufSize[BUFFER_COUNT];
+		volatile int m_pending[BUFFER_COUNT];	// Workers that haven't hashed the buffer yet.
+		unsigned int m_readIdx;	// Next buffer to fill.
+		bool m_isUsable;
+};
+
+/** MultiHashPrivate **/
+
+MultiHashPrivate::MultiHashPrivate()
+	: dataSize(0)
+	, finished(false)
+{
+	memset(md5Digest, 0, sizeof(md5Digest));
+	memset(sha1Digest, 0, sizeof(sha1Digest));
+}
+
+/**
+ * Add data to the specified hashes.
+ * @param algos Bitfield of HashAlgo_e.
+ * @param buf Data buffer.
+ * @param size Size of data buffer.
+ */
+void MultiHashPrivate::update(unsigned int algos, const void *buf, size_t size)
+{
+	if (algos & HASH_CRC32) {
+		crc32.update(buf, size);
+	}
+	if (algos & HASH_MD5) {
+		md5.update(buf, size);
+	}
+	if (algos & HASH_SHA1) {
+		sha1.update(buf, size);
+	}
+}
+
+/**
+ * Hash an entire IRpFile or IDiscReader.
+ * @param src Source.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+template<typename T>
+int MultiHashPrivate::hashStream(T *src)
+{
+	assert(src != nullptr);
+	if (!src)
+		return -EINVAL;
+
+	// Reset the hashes.
+	crc32.reset();
+	md5.reset();
+	sha1.reset();
+	dataSize = 0;
+	finished = false;
+
+	const off64_t totalSize = src->size();
+	if (totalSize < 0) {
+		int err = src->lastError();
+		return (err != 0 ? -err : -EIO);
+	}
+	if (src->seek(0) != 0) {
+		int err = src->lastError();
+		return (err != 0 ? -err : -EIO);
+	}
+
+	HashPipeline pipeline(this);
+	if (!pipeline.isUsable()) {
+		return -ENOMEM;
+	}
+
+	// Read the data in large blocks.
+	// An empty block stops the workers.
+	const size_t bufferSize = HashPipeline::BUFFER_SIZE;
+	int ret = 0;
+	off64_t remain = totalSize;
+	size_t size;
+	do {
+		uint8_t *const buf = pipeline.getBuffer();
+		size = 0;
+		if (remain > 0) {
+			const size_t toRead = (remain > static_cast<off64_t>(bufferSize)
+				? bufferSize
+				: static_cast<size_t>(remain));
+			size = src->read(buf, toRead);
+			if (size == 0) {
+				// Read error.
+				ret = -src->lastError();
+				if (ret == 0) {
+					ret = -EIO;
+				}
+			}
+		}
+
+		pipeline.submitBuffer(size);
+		dataSize += size;
+		remain -= size;
+	} while (size > 0);
+
+	return ret;
+}
+
+/** HashPipeline **/
+
+HashPipeline::HashPipeline(MultiHashPrivate *d)
+	: d(d)
+	, m_workerCount(0)
+	, m_semFree(BUFFER_COUNT)
+	, m_readIdx(0)
+	, m_isUsable(false)
+{
+	for (unsigned int i = 0; i < BUFFER_COUNT; i++) {
+		m_buf[i] = static_cast<uint8_t*>(aligned_malloc(16, BUFFER_SIZE));
+		m_bufSize[i] = 0;
+		m_pending[i] = 0;
+	}
+	for (unsigned int i = 0; i < BUFFER_COUNT; i++) {
+		if (!m_buf[i]) {
+			// Allocation failed.
+			return;
+		}
+	}
+	m_isUsable = true;
+
+	// Split the hashes between two workers if
+	// there are enough CPUs for the reader and
+	// both workers.
+	if (Thread::cpuCount() >= 3) {
+		m_workers[0].algos = MultiHashPrivate::HASH_CRC32 | MultiHashPrivate::HASH_MD5;
+		m_workers[1].algos = MultiHashPrivate::HASH_SHA1;
+		m_workerCount = 2;
+	} else {
+		m_workers[0].algos = MultiHashPrivate::HASH_ALL;
+		m_workerCount = 1;
+	}
+
+	for (unsigned int i = 0; i < m_workerCount; i++) {
+		m_workers[i].pipeline = this;
+		if (m_workers[i].thread.start(workerProc, &m_workers[i]) != 0) {
+			// Couldn't start the thread.
+			// The remaining hashes will be calculated by
+			// the previous worker, or by submitBuffer() if
+			// no workers could be started.
+			if (i > 0) {
+				m_workers[i-1].algos |= m_workers[i].algos;
+			}
+			m_workerCount = i;
+			break;
+		}
+	}
+}
+
+HashPipeline::~HashPipeline()
+{
+	for (unsigned int i = 0; i < m_workerCount; i++) {
+		m_workers[i].thread.join();
+	}
+	for (unsigned int i = 0; i < BUFFER_COUNT; i++) {
+		aligned_free(m_buf[i]);
+	}
+}
+
+/**
+ * Worker thread function.
+ * @param param Worker.
+ */
+void HashPipeline::workerProc(void *param)
+{
+	Worker *const worker = static_cast<Worker*>(param);
+	HashPipeline *const pipeline = worker->pipeline;
+
+	for (unsigned int idx = 0;; idx = (idx + 1) % BUFFER_COUNT) {
+		worker->semFilled.obtain();
+		const size_t size = pipeline->m_bufSize[idx];
+		if (size == 0) {
+			// No more data.
+			break;
+		}
+
+		pipeline->d->update(worker->algos, pipeline->m_buf[idx], size);
+
+		if (ATOMIC_DEC_FETCH(&pipeline->m_pending[idx]) == 0) {
+			// All workers are done with this buffer.
+			pipeline->m_semFree.release();
+		}
+	}
+}
+
+/**
+ * Get an empty buffer.
+ * This blocks until a buffer is available.
+ * @return Buffer. (BUFFER_SIZE bytes)
+ */
+uint8_t *HashPipeline::getBuffer(void)
+{
+	m_semFree.obtain();
+	return m_buf[m_readIdx];
+}
+
+/**
+ * Send a filled buffer to the workers.
+ * @param size Amount of data in the buffer. (0 to stop the workers)
+ */
+void HashPipeline::submitBuffer(size_t size)
+{
+	const unsigned int idx = m_readIdx;
+	m_bufSize[idx] = size;
+	m_pending[idx] = static_cast<int>(m_workerCount);
+	m_readIdx = (m_readIdx + 1) % BUFFER_COUNT;
+
+	if (m_workerCount == 0) {
+		// No worker threads. Hash the data here.
+		if (size > 0) {
+			d->update(MultiHashPrivate::HASH_ALL, m_buf[idx], size);
+		}
+		m_semFree.release();
+		return;
+	}
+
+	for (unsigned int i = 0; i < m_workerCount; i++) {
+		m_workers[i].semFilled.release();
+	}
+}
+
+/** MultiHash **/
+
+MultiHash::MultiHash()
+	: d_ptr(new MultiHashPrivate())
+{ }
+
+MultiHash::~MultiHash()
+{
+	delete d_ptr;
+}
+
+/**
+ * Reset all hashes.
+ */
+void MultiHash::reset(void)
+{
+	RP_D(MultiHash);
+	d->crc32.reset();
+	d->md5.reset();
+	d->sha1.reset();
+	d->dataSize = 0;
+	d->finished = false;
+	memset(d->md5Digest, 0, sizeof(d->md5Digest));
+	memset(d->sha1Digest, 0, sizeof(d->sha1Digest));
+}
+
+/**
+ * Add data to all hashes.
+ * This runs on the calling thread.
+ * @param buf Data buffer.
+ * @param size Size of data buffer.
+ */
+void MultiHash::update(const void *buf, size_t size)
+{
+	RP_D(MultiHash);
+	assert(!d->finished);
+	d->update(MultiHashPrivate::HASH_ALL, buf, size);
+	d->dataSize += size;
+}
+
+/**
+ * Finish all hashes.
+ * The digests are available after this function is called.
+ */
+void MultiHash::finish(void)
+{
+	RP_D(MultiHash);
+	if (d->finished)
+		return;
+
+	d->md5.finish(d->md5Digest);
+	d->sha1.finish(d->sha1Digest);
+	d->finished = true;
+}
+
+/**
+ * Have the hashes been finished?
+ * @return True if finish() was called.
+ */
+bool MultiHash::isFinished(void) const
+{
+	RP_D(const MultiHash);
+	return d->finished;
+}
+
+/**
+ * Hash an entire file.
+ *
+ * Data is read on the calling thread using large buffers,
+ * while the hashes are calculated on worker threads.
+ * The hashes are reset first and finished afterwards.
+ *
+ * @param file File to hash.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int MultiHash::hashFile(IRpFile *file)
+{
+	RP_D(MultiHash);
+	int ret = d->hashStream(file);
+	if (ret == 0) {
+		finish();
+	}
+	return ret;
+}
+
+/**
+ * Hash an entire disc image.
+ *
+ * This hashes the data returned by the disc reader,
+ * so sparse and compressed disc images are hashed
+ * as if they were uncompressed.
+ *
+ * Data is read on the calling thread using large buffers,
+ * while the hashes are calculated on worker threads.
+ * The hashes are reset first and finished afterwards.
+ *
+ * @param discReader Disc reader to hash.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int MultiHash::hashDiscReader(IDiscReader *discReader)
+{
+	RP_D(MultiHash);
+	int ret = d->hashStream(discReader);
+	if (ret == 0) {
+		finish();
+	}
+	return ret;
+}
+
+/**
+ * Get the number of bytes that were hashed.
+ * @return Number of bytes.
+ */
+uint64_t MultiHash::dataSize(void) const
+{
+	RP_D(const MultiHash);
+	return d->dataSize;
+}
+
+/**
+ * Get the CRC-32.
+ * @return CRC-32.
+ */
+uint32_t MultiHash::crc32(void) const
+{
+	RP_D(const MultiHash);
+	return d->crc32.value();
+}
+
+/**
+ * Get the MD5 digest.
+ * NOTE: Only valid after finish() is called.
+ * @return MD5 digest. (16 bytes)
+ */
+const uint8_t *MultiHash::md5(void) const
+{
+	RP_D(const MultiHash);
+	return d->md5Digest;
+}
+
+/**
+ * Get the SHA-1 digest.
+ * NOTE: Only valid after finish() is called.
+ * @return SHA-1 digest. (20 bytes)
+ */
+const uint8_t *MultiHash::sha1(void) const
+{
+	RP_D(const MultiHash);
+	return d->sha1Digest;
+}
+
+/**
+ * Convert a digest to a hexadecimal string.
+ * @param digest Digest.
+ * @param size Size of digest.
+ * @return Hexadecimal string. (lowercase)
+ */
+static string digestToHex(const uint8_t *digest, size_t size)
+{
+	static const char hex_lookup[16] = {
+		'0','1','2','3','4','5','6','7',
+		'8','9','a','b','c','d','e','f',
+	};
+
+	string s;
+	s.resize(size * 2);
+	for (size_t i = 0; i < size; i++) {
+		s[i*2] = hex_lookup[digest[i] >> 4];
+		s[i*2+1] = hex_lookup[digest[i] & 0x0F];
+	}
+	return s;
+}
+
+/**
+ * Get the CRC-32 as a hexadecimal string.
+ * @return CRC-32 string. (8 lowercase hex digits)
+ */
+string MultiHash::crc32String(void) const
+{
+	RP_D(const MultiHash);
+	const uint32_t crc = d->crc32.value();
+	const uint8_t crc_be[4] = {
+		static_cast<uint8_t>(crc >> 24),
+		static_cast<uint8_t>(crc >> 16),
+		static_cast<uint8_t>(crc >> 8),
+		static_cast<uint8_t>(crc),
+	};
+	return digestToHex(crc_be, sizeof(crc_be));
+}
+
+/**
+ * Get the MD5 digest as a hexadecimal string.
+ * NOTE: Only valid after finish() is called.
+ * @return MD5 string. (32 lowercase hex digits)
+ */
+string MultiHash::md5String(void) const
+{
+	RP_D(const MultiHash);
+	return digestToHex(d->md5Digest, sizeof(d->md5Digest));
+}
+
+/**
+ * Get the SHA-1 digest as a hexadecimal string.
+ * NOTE: Only valid after finish() is called.
+ * @return SHA-1 string. (40 lowercase hex digits)
+ */
+string MultiHash::sha1String(void) const
+{
+	RP_D(const MultiHash);
+	return digestToHex(d->sha1Digest, sizeof(d->sha1Digest));
+}
+
+}
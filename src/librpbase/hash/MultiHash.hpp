@@ -0,0 +1,147 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * MultiHash.hpp: Streaming CRC32/MD5/SHA-1 calculation.                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPBASE_HASH_MULTIHASH_HPP__
+#define __ROMPROPERTIES_LIBRPBASE_HASH_MULTIHASH_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stddef.h>	/* size_t */
+#include <stdint.h>
+
+// C++ includes.
+#include <string>
+
+namespace LibRpFile {
+	class IRpFile;
+}
+
+namespace LibRpBase {
+
+class IDiscReader;
+
+class MultiHashPrivate;
+class MultiHash
+{
+	public:
+		MultiHash();
+		~MultiHash();
+
+	private:
+		RP_DISABLE_COPY(MultiHash)
+	private:
+		friend class MultiHashPrivate;
+		MultiHashPrivate *const d_ptr;
+
+	public:
+		/**
+		 * Reset all hashes.
+		 */
+		void reset(void);
+
+		/**
+		 * Add data to all hashes.
+		 * This runs on the calling thread.
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 */
+		void update(const void *buf, size_t size);
+
+		/**
+		 * Finish all hashes.
+		 * The digests are available after this function is called.
+		 */
+		void finish(void);
+
+		/**
+		 * Have the hashes been finished?
+		 * @return True if finish() was called.
+		 */
+		bool isFinished(void) const;
+
+	public:
+		/**
+		 * Hash an entire file.
+		 *
+		 * Data is read on the calling thread using large buffers,
+		 * while the hashes are calculated on worker threads.
+		 * The hashes are reset first and finished afterwards.
+		 *
+		 * @param file File to hash.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int hashFile(LibRpFile::IRpFile *file);
+
+		/**
+		 * Hash an entire disc image.
+		 *
+		 * This hashes the data returned by the disc reader,
+		 * so sparse and compressed disc images are hashed
+		 * as if they were uncompressed.
+		 *
+		 * Data is read on the calling thread using large buffers,
+		 * while the hashes are calculated on worker threads.
+		 * The hashes are reset first and finished afterwards.
+		 *
+		 * @param discReader Disc reader to hash.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int hashDiscReader(IDiscReader *discReader);
+
+	public:
+		/**
+		 * Get the number of bytes that were hashed.
+		 * @return Number of bytes.
+		 */
+		uint64_t dataSize(void) const;
+
+		/**
+		 * Get the CRC-32.
+		 * @return CRC-32.
+		 */
+		uint32_t crc32(void) const;
+
+		/**
+		 * Get the MD5 digest.
+		 * NOTE: Only valid after finish() is called.
+		 * @return MD5 digest. (16 bytes)
+		 */
+		const uint8_t *md5(void) const;
+
+		/**
+		 * Get the SHA-1 digest.
+		 * NOTE: Only valid after finish() is called.
+		 * @return SHA-1 digest. (20 bytes)
+		 */
+		const uint8_t *sha1(void) const;
+
+		/**
+		 * Get the CRC-32 as a hexadecimal string.
+		 * @return CRC-32 string. (8 lowercase hex digits)
+		 */
+		std::string crc32String(void) const;
+
+		/**
+		 * Get the MD5 digest as a hexadecimal string.
+		 * NOTE: Only valid after finish() is called.
+		 * @return MD5 string. (32 lowercase hex digits)
+		 */
+		std::string md5String(void) const;
+
+		/**
+		 * Get the SHA-1 digest as a hexadecimal string.
+		 * NOTE: Only valid after finish() is called.
+		 * @return SHA-1 string. (40 lowercase hex digits)
+		 */
+		std::string sha1String(void) const;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPBASE_HASH_MULTIHASH_HPP__ */
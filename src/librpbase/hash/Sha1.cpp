@@ -0,0 +1,156 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase)                        *
+ * Sha1.cpp: SHA-1 message digest. (FIPS 180-4)                            *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "Sha1.hpp"
+
+// librpcpu
+#include "librpcpu/byteswap.h"
+
+namespace LibRpBase {
+
+#define ROTL32(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+Sha1::Sha1()
+{
+	reset();
+}
+
+/**
+ * Reset the hash state.
+ */
+void Sha1::reset(void)
+{
+	m_state[0] = 0x67452301;
+	m_state[1] = 0xEFCDAB89;
+	m_state[2] = 0x98BADCFE;
+	m_state[3] = 0x10325476;
+	m_state[4] = 0xC3D2E1F0;
+	m_count = 0;
+}
+
+/**
+ * Process a single 64-byte block.
+ * @param block Block.
+ */
+void Sha1::processBlock(const uint8_t *block)
+{
+	// Message schedule.
+	// Only 16 words are kept; W[t] is calculated in place.
+	uint32_t w[16];
+	memcpy(w, block, sizeof(w));
+#if SYS_BYTEORDER == SYS_LIL_ENDIAN
+	for (unsigned int i = 0; i < 16; i++) {
+		w[i] = be32_to_cpu(w[i]);
+	}
+#endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
+
+	uint32_t a = m_state[0];
+	uint32_t b = m_state[1];
+	uint32_t c = m_state[2];
+	uint32_t d = m_state[3];
+	uint32_t e = m_state[4];
+
+	for (unsigned int t = 0; t < 80; t++) {
+		uint32_t wt;
+		if (t < 16) {
+			wt = w[t];
+		} else {
+			wt = w[(t + 13) & 15] ^ w[(t + 8) & 15] ^ w[(t + 2) & 15] ^ w[t & 15];
+			wt = ROTL32(wt, 1);
+			w[t & 15] = wt;
+		}
+
+		uint32_t f, k;
+		if (t < 20) {
+			f = d ^ (b & (c ^ d));
+			k = 0x5A827999;
+		} else if (t < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		} else if (t < 60) {
+			f = (b & c) | (d & (b | c));
+			k = 0x8F1BBCDC;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+
+		const uint32_t tmp = ROTL32(a, 5) + f + e + k + wt;
+		e = d;
+		d = c;
+		c = ROTL32(b, 30);
+		b = a;
+		a = tmp;
+	}
+
+	m_state[0] += a;
+	m_state[1] += b;
+	m_state[2] += c;
+	m_state[3] += d;
+	m_state[4] += e;
+}
+
+/**
+ * Add data to the hash.
+ * @param buf Data buffer.
+ * @param size Size of data buffer.
+ */
+void Sha1::update(const void *buf, size_t size)
+{
+	const uint8_t *p = static_cast<const uint8_t*>(buf);
+	unsigned int bufPos = static_cast<unsigned int>(m_count & 63);
+	m_count += size;
+
+	if (bufPos > 0) {
+		// Fill the partial block first.
+		const size_t fill = 64 - bufPos;
+		if (size < fill) {
+			memcpy(&m_buf[bufPos], p, size);
+			return;
+		}
+		memcpy(&m_buf[bufPos], p, fill);
+		processBlock(m_buf);
+		p += fill;
+		size -= fill;
+	}
+
+	// Process full blocks directly from the input buffer.
+	for (; size >= 64; p += 64, size -= 64) {
+		processBlock(p);
+	}
+
+	// Save the remaining data.
+	if (size > 0) {
+		memcpy(m_buf, p, size);
+	}
+}
+
+/**
+ * Finish the hash and get the digest.
+ * The hash must be reset before it can be reused.
+ * @param digest Output buffer for the digest. (DIGEST_SIZE bytes)
+ */
+void Sha1::finish(uint8_t *digest)
+{
+	// Message length in bits, big-endian.
+	const uint64_t bitCount = cpu_to_be64(m_count << 3);
+
+	// Pad to 56 mod 64, then append the length.
+	static const uint8_t padding[64] = {0x80};
+	const unsigned int bufPos = static_cast<unsigned int>(m_count & 63);
+	update(padding, (bufPos < 56) ? (56 - bufPos) : (120 - bufPos));
+	update(&bitCount, sizeof(bitCount));
+
+	for (unsigned int i = 0; i < 5; i++) {
+		const uint32_t s = cpu_to_be32(m_state[i]);
+		memcpy(&digest[i * 4], &s, sizeof(s));
+	}
+}
+
+}
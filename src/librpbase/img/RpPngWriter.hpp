@@ -154,6 +154,33 @@ class RpPngWriter
 		RpPngWriterPrivate *const d_ptr;
 		RP_DISABLE_COPY(RpPngWriter)
 
+	public:
+		/**
+		 * Compression profile.
+		 * This controls the zlib compression level and
+		 * the PNG row filters used when writing IDAT.
+		 */
+		enum CompressionProfile {
+			CP_DEFAULT	= 0,	// zlib default level; no filtering.
+			CP_FAST		= 1,	// zlib level 1; SUB filter. (fastest)
+			CP_SMALL	= 2,	// zlib level 9; adaptive filtering. (smallest)
+
+			CP_MAX
+		};
+
+		/**
+		 * Set the compression profile.
+		 * This must be called before write_IHDR().
+		 * @param profile Compression profile.
+		 */
+		void setCompressionProfile(CompressionProfile profile);
+
+		/**
+		 * Get the compression profile.
+		 * @return Compression profile.
+		 */
+		CompressionProfile compressionProfile(void) const;
+
 	public:
 		/**
 		 * Is the PNG file open?
@@ -18,6 +18,10 @@
 #else /* !_WIN32 */
 # include "../crypto/AesNettle.hpp"
 #endif /* _WIN32 */
+#include "librpcpu/cpu_dispatch.h"
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+# include "../crypto/AesNI.hpp"
+#endif /* RP_CPU_I386 || RP_CPU_AMD64 */
 
 // C includes. (C++ namespace)
 #include <cstdio>
@@ -572,6 +576,69 @@ AesDecryptTestSet(CAPI_NG, false)
 #else /* !_WIN32 */
 AesDecryptTestSet(Nettle, true)
 #endif /* _WIN32 */
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+AesDecryptTestSet(NI, false)
+
+/**
+ * Compare AesNI to the OS implementation using a larger buffer.
+ * The test vectors above are only four blocks, which doesn't
+ * exercise the multi-block code paths. The data is decrypted
+ * in two unevenly-sized parts to test IV/counter chaining.
+ */
+TEST(AesNITest, compareToOSImplementation)
+{
+	if (!AesNI::isUsable()) {
+		printf("AES-NI is not supported on this system; skipping test.\n");
+		return;
+	}
+
+	// 37 blocks of pseudorandom data.
+	vector<uint8_t> cipherText(37 * 16);
+	uint32_t lcg = 0x12345678;
+	for (uint8_t &b : cipherText) {
+		lcg = (lcg * 1103515245U) + 12345U;
+		b = static_cast<uint8_t>(lcg >> 16);
+	}
+
+	// The CTR counter wraps around the low 64 bits.
+	static const uint8_t iv[16] = {
+		0x01,0x23,0x45,0x67,0x89,0xAB,0xCD,0xEF,
+		0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xF6
+	};
+
+	static const IAesCipher::ChainingMode modes[] = {
+		IAesCipher::CM_ECB, IAesCipher::CM_CBC, IAesCipher::CM_CTR
+	};
+	for (IAesCipher::ChainingMode mode : modes) {
+		for (size_t key_len = 16; key_len <= 32; key_len += 8) {
+#ifdef _WIN32
+			IAesCipher *const osCipher = new AesCAPI();
+#else /* !_WIN32 */
+			IAesCipher *const osCipher = new AesNettle();
+#endif /* _WIN32 */
+			IAesCipher *const niCipher = new AesNI();
+			IAesCipher *const ciphers[2] = {osCipher, niCipher};
+			for (IAesCipher *cipher : ciphers) {
+				ASSERT_EQ(0, cipher->setChainingMode(mode));
+				ASSERT_EQ(0, cipher->setKey(AesCipherTest::aes_key, key_len));
+				if (mode != IAesCipher::CM_ECB) {
+					ASSERT_EQ(0, cipher->setIV(iv, sizeof(iv)));
+				}
+			}
+
+			vector<uint8_t> expected(cipherText);
+			EXPECT_EQ(expected.size(), osCipher->decrypt(expected.data(), expected.size()));
+			vector<uint8_t> actual(cipherText);
+			EXPECT_EQ(19U * 16U, niCipher->decrypt(&actual[0], 19 * 16));
+			EXPECT_EQ(18U * 16U, niCipher->decrypt(&actual[19 * 16], 18 * 16));
+
+			EXPECT_EQ(expected, actual) << "AES-" << (key_len * 8) << ", chaining mode " << mode;
+			delete osCipher;
+			delete niCipher;
+		}
+	}
+}
+#endif /* RP_CPU_I386 || RP_CPU_AMD64 */
 
 } }
 
@@ -0,0 +1,240 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase/tests)                  *
+ * HashTest.cpp: CRC32/MD5/SHA-1 tests.                                    *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase
+#include "../hash/Crc32.hpp"
+#include "../hash/Md5.hpp"
+#include "../hash/Sha1.hpp"
+#include "../hash/MultiHash.hpp"
+
+// librpfile
+#include "librpfile/RpMemFile.hpp"
+#include "librpfile/RpVectorFile.hpp"
+using LibRpFile::RpMemFile;
+using LibRpFile::RpVectorFile;
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRpBase { namespace Tests {
+
+class HashTest : public ::testing::Test
+{
+	public:
+		/**
+		 * Convert a digest to a hexadecimal string.
+		 * @param digest Digest.
+		 * @param size Size of digest.
+		 * @return Hexadecimal string. (lowercase)
+		 */
+		static string toHex(const uint8_t *digest, size_t size)
+		{
+			string s;
+			char buf[4];
+			for (size_t i = 0; i < size; i++) {
+				snprintf(buf, sizeof(buf), "%02x", digest[i]);
+				s += buf;
+			}
+			return s;
+		}
+
+		/**
+		 * Calculate an MD5 digest.
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 * @return MD5 digest, as a hexadecimal string.
+		 */
+		static string md5(const void *buf, size_t size)
+		{
+			Md5 md5;
+			md5.update(buf, size);
+			uint8_t digest[Md5::DIGEST_SIZE];
+			md5.finish(digest);
+			return toHex(digest, sizeof(digest));
+		}
+
+		/**
+		 * Calculate a SHA-1 digest.
+		 * @param buf Data buffer.
+		 * @param size Size of data buffer.
+		 * @return SHA-1 digest, as a hexadecimal string.
+		 */
+		static string sha1(const void *buf, size_t size)
+		{
+			Sha1 sha1;
+			sha1.update(buf, size);
+			uint8_t digest[Sha1::DIGEST_SIZE];
+			sha1.finish(digest);
+			return toHex(digest, sizeof(digest));
+		}
+
+		/**
+		 * Fill a buffer with pseudo-random data.
+		 * @param buf Buffer.
+		 */
+		static void fillBuffer(vector<uint8_t> &buf)
+		{
+			uint32_t seed = 0x12345678;
+			for (size_t i = 0; i < buf.size(); i++) {
+				seed = seed * 1103515245 + 12345;
+				buf[i] = static_cast<uint8_t>(seed >> 16);
+			}
+		}
+};
+
+/**
+ * CRC-32 check value.
+ */
+TEST_F(HashTest, crc32_checkValue)
+{
+	static const char data[] = "123456789";
+	EXPECT_EQ(0xCBF43926U, Crc32::calc_cpp(0, data, sizeof(data)-1));
+	EXPECT_EQ(0xCBF43926U, Crc32::calc(0, data, sizeof(data)-1));
+	EXPECT_EQ(0U, Crc32::calc(0, data, 0));
+
+	// Incremental CRC.
+	Crc32 crc;
+	crc.update(data, 4);
+	crc.update(&data[4], 5);
+	EXPECT_EQ(0xCBF43926U, crc.value());
+}
+
+/**
+ * Compare the optimized CRC-32 with the standard version,
+ * using various sizes and alignments.
+ */
+TEST_F(HashTest, crc32_optimized)
+{
+	vector<uint8_t> buf(65536 + 64);
+	fillBuffer(buf);
+
+	static const size_t sizes[] = {0, 1, 15, 16, 63, 64, 65, 127, 128, 129, 1000, 4096, 65535, 65536};
+	for (size_t offset = 0; offset < 4; offset++) {
+		for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+			const uint32_t expected = Crc32::calc_cpp(0x11223344, &buf[offset], sizes[i]);
+			EXPECT_EQ(expected, Crc32::calc(0x11223344, &buf[offset], sizes[i])) <<
+				"offset == " << offset << ", size == " << sizes[i];
+#ifdef CRC32_HAS_PCLMUL
+			if (RP_CPU_HasPCLMULQDQ()) {
+				EXPECT_EQ(expected, Crc32::calc_pclmul(0x11223344, &buf[offset], sizes[i])) <<
+					"offset == " << offset << ", size == " << sizes[i];
+			}
+#endif /* CRC32_HAS_PCLMUL */
+		}
+	}
+}
+
+/**
+ * MD5 test vectors from RFC 1321.
+ */
+TEST_F(HashTest, md5_testVectors)
+{
+	EXPECT_EQ(string("d41d8cd98f00b204e9800998ecf8427e"), md5("", 0));
+	EXPECT_EQ(string("0cc175b9c0f1b6a831c399e269772661"), md5("a", 1));
+	EXPECT_EQ(string("900150983cd24fb0d6963f7d28e17f72"), md5("abc", 3));
+	EXPECT_EQ(string("f96b697d7cb7938d525a2f31aaf161d0"), md5("message digest", 14));
+
+	static const char digits[] = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+	EXPECT_EQ(string("57edf4a22be3c955ac49da2e2107b67a"), md5(digits, sizeof(digits)-1));
+}
+
+/**
+ * SHA-1 test vectors from FIPS 180.
+ */
+TEST_F(HashTest, sha1_testVectors)
+{
+	EXPECT_EQ(string("da39a3ee5e6b4b0d3255bfef95601890afd80709"), sha1("", 0));
+	EXPECT_EQ(string("a9993e364706816aba3e25717850c26c9cd0d89d"), sha1("abc", 3));
+
+	static const char two_block[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	EXPECT_EQ(string("84983e441c3bd26ebaae4aa1f95129e5e54670f1"), sha1(two_block, sizeof(two_block)-1));
+
+	// One million 'a's, added in uneven chunks.
+	vector<uint8_t> a(1000000, 'a');
+	Sha1 sha1;
+	for (size_t pos = 0; pos < a.size(); pos += 777) {
+		sha1.update(&a[pos], std::min<size_t>(777, a.size() - pos));
+	}
+	uint8_t digest[Sha1::DIGEST_SIZE];
+	sha1.finish(digest);
+	EXPECT_EQ(string("34aa973cd4c4daa4f61eeb2bdbad27316534016f"), toHex(digest, sizeof(digest)));
+}
+
+/**
+ * Hash a file using the threaded pipeline, and compare
+ * the results with hashing the data directly.
+ */
+TEST_F(HashTest, multiHash_file)
+{
+	// Larger than two pipeline buffers, and not a multiple of 64.
+	vector<uint8_t> buf(9*1024*1024 + 123);
+	fillBuffer(buf);
+
+	MultiHash expected;
+	expected.update(buf.data(), buf.size());
+	expected.finish();
+	EXPECT_TRUE(expected.isFinished());
+	EXPECT_EQ(Crc32::calc_cpp(0, buf.data(), buf.size()), expected.crc32());
+	EXPECT_EQ(md5(buf.data(), buf.size()), expected.md5String());
+	EXPECT_EQ(sha1(buf.data(), buf.size()), expected.sha1String());
+
+	RpMemFile *const file = new RpMemFile(buf.data(), buf.size());
+	MultiHash hash;
+	EXPECT_EQ(0, hash.hashFile(file));
+	file->unref();
+
+	EXPECT_TRUE(hash.isFinished());
+	EXPECT_EQ(static_cast<uint64_t>(buf.size()), hash.dataSize());
+	EXPECT_EQ(expected.crc32(), hash.crc32());
+	EXPECT_EQ(0, memcmp(expected.md5(), hash.md5(), Md5::DIGEST_SIZE));
+	EXPECT_EQ(0, memcmp(expected.sha1(), hash.sha1(), Sha1::DIGEST_SIZE));
+	EXPECT_EQ(expected.crc32String(), hash.crc32String());
+	EXPECT_EQ(8U, hash.crc32String().size());
+}
+
+/**
+ * Hash an empty file.
+ */
+TEST_F(HashTest, multiHash_emptyFile)
+{
+	RpVectorFile *const file = new RpVectorFile();
+	MultiHash hash;
+	EXPECT_EQ(0, hash.hashFile(file));
+	file->unref();
+
+	EXPECT_EQ(0U, hash.dataSize());
+	EXPECT_EQ(string("00000000"), hash.crc32String());
+	EXPECT_EQ(string("d41d8cd98f00b204e9800998ecf8427e"), hash.md5String());
+	EXPECT_EQ(string("da39a3ee5e6b4b0d3255bfef95601890afd80709"), hash.sha1String());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpBase test suite: Hash tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,203 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase/tests)                  *
+ * RomFieldsTest.cpp: RomFields deferred tab tests.                        *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase
+#include "../RomFields.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+
+// C++ includes.
+#include <string>
+using std::string;
+
+namespace LibRpBase { namespace Tests {
+
+class RomFieldsTest : public ::testing::Test
+{
+	protected:
+		RomFieldsTest()
+			: loadCount(0)
+		{ }
+
+	public:
+		/**
+		 * Tab loader that adds two fields.
+		 * @param fields RomFields object.
+		 * @param userdata RomFieldsTest.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int loadTab_twoFields(RomFields *fields, void *userdata)
+		{
+			static_cast<RomFieldsTest*>(userdata)->loadCount++;
+			fields->addField_string("Deferred 1", "one");
+			fields->addField_string("Deferred 2", "two");
+			return 0;
+		}
+
+		/**
+		 * Tab loader that doesn't add any fields.
+		 * @param fields RomFields object.
+		 * @param userdata RomFieldsTest.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int loadTab_empty(RomFields *fields, void *userdata)
+		{
+			RP_UNUSED(fields);
+			static_cast<RomFieldsTest*>(userdata)->loadCount++;
+			return -ENOENT;
+		}
+
+		/**
+		 * Verify that the fields are sorted by tab index.
+		 * @param fields RomFields object.
+		 */
+		static void checkTabOrder(const RomFields &fields)
+		{
+			int prevTabIdx = 0;
+			const auto iter_end = fields.cend();
+			for (auto iter = fields.cbegin(); iter != iter_end; ++iter) {
+				EXPECT_LE(prevTabIdx, iter->tabIdx);
+				prevTabIdx = iter->tabIdx;
+			}
+		}
+
+	public:
+		int loadCount;	// Number of times a tab loader was called.
+};
+
+/**
+ * Deferred tabs are only loaded when requested.
+ */
+TEST_F(RomFieldsTest, loadRequestedTabs)
+{
+	RomFields fields;
+	fields.setTabName(0, "First");
+	fields.setTabIndex(0);
+	fields.addField_string("Field 0", "zero");
+	EXPECT_EQ(1, fields.addTab_deferred("Deferred", loadTab_twoFields, this));
+	EXPECT_EQ(2, fields.addTab("Last"));
+	fields.addField_string("Field 2", "two");
+
+	EXPECT_TRUE(fields.hasDeferredTabs());
+	EXPECT_EQ(3, fields.tabCount());
+	EXPECT_EQ(2, fields.count());
+
+	// Loading tab 0 doesn't call the loader.
+	EXPECT_EQ(0, fields.loadTabs(1U << 0));
+	EXPECT_EQ(0, loadCount);
+	EXPECT_TRUE(fields.hasDeferredTabs());
+
+	// Loading tab 1 calls the loader.
+	EXPECT_EQ(1, fields.loadTabs(1U << 1));
+	EXPECT_EQ(1, loadCount);
+	EXPECT_FALSE(fields.hasDeferredTabs());
+	ASSERT_EQ(4, fields.count());
+
+	// Fields must be in tab order, and the deferred
+	// fields must be in the order they were added.
+	checkTabOrder(fields);
+	EXPECT_EQ(string("Deferred 1"), fields.at(1)->name);
+	EXPECT_EQ(1, fields.at(1)->tabIdx);
+	EXPECT_EQ(string("Deferred 2"), fields.at(2)->name);
+	EXPECT_EQ(string("Field 2"), fields.at(3)->name);
+	EXPECT_EQ(2, fields.at(3)->tabIdx);
+
+	// The loader isn't called again.
+	EXPECT_EQ(0, fields.loadTabs(~0U));
+	EXPECT_EQ(1, loadCount);
+}
+
+/**
+ * Deferred tabs without any fields are removed
+ * once all deferred tabs have been loaded.
+ */
+TEST_F(RomFieldsTest, removeEmptyTabs)
+{
+	RomFields fields;
+	fields.setTabName(0, "First");
+	fields.setTabIndex(0);
+	fields.addField_string("Field 0", "zero");
+	EXPECT_EQ(1, fields.addTab_deferred("Empty", loadTab_empty, this));
+	EXPECT_EQ(2, fields.addTab_deferred("Deferred", loadTab_twoFields, this));
+	EXPECT_EQ(3, fields.addTab("Last"));
+	fields.addField_string("Field 3", "three");
+
+	// Load the empty tab. It's hidden, but not removed yet.
+	EXPECT_EQ(1, fields.loadTabs(1U << 1));
+	EXPECT_EQ(4, fields.tabCount());
+	EXPECT_EQ(nullptr, fields.tabName(1));
+	EXPECT_TRUE(fields.hasDeferredTabs());
+
+	// Load the remaining tabs. The empty tab is removed.
+	EXPECT_EQ(1, fields.loadTabs(~0U));
+	EXPECT_EQ(2, loadCount);
+	EXPECT_FALSE(fields.hasDeferredTabs());
+	ASSERT_EQ(3, fields.tabCount());
+	EXPECT_EQ(string("First"), fields.tabName(0));
+	EXPECT_EQ(string("Deferred"), fields.tabName(1));
+	EXPECT_EQ(string("Last"), fields.tabName(2));
+
+	ASSERT_EQ(4, fields.count());
+	checkTabOrder(fields);
+	EXPECT_EQ(1, fields.at(1)->tabIdx);
+	EXPECT_EQ(1, fields.at(2)->tabIdx);
+	EXPECT_EQ(string("Field 3"), fields.at(3)->name);
+	EXPECT_EQ(2, fields.at(3)->tabIdx);
+}
+
+/**
+ * Hidden tabs without any fields are only removed
+ * if they were empty deferred tabs.
+ */
+TEST_F(RomFieldsTest, removeEmptyTabs_hiddenTab)
+{
+	RomFields fields;
+	fields.setTabName(0, "First");
+	fields.setTabIndex(0);
+	fields.addField_string("Field 0", "zero");
+	EXPECT_EQ(1, fields.addTab(""));
+	EXPECT_EQ(2, fields.addTab_deferred("Empty", loadTab_empty, this));
+	EXPECT_EQ(3, fields.addTab("Last"));
+	fields.addField_string("Field 3", "three");
+
+	// Load the empty tab. The hidden tab is kept.
+	EXPECT_EQ(1, fields.loadTabs(~0U));
+	EXPECT_EQ(1, loadCount);
+	EXPECT_FALSE(fields.hasDeferredTabs());
+	ASSERT_EQ(3, fields.tabCount());
+	EXPECT_EQ(string("First"), fields.tabName(0));
+	EXPECT_EQ(nullptr, fields.tabName(1));
+	EXPECT_EQ(string("Last"), fields.tabName(2));
+
+	ASSERT_EQ(2, fields.count());
+	checkTabOrder(fields);
+	EXPECT_EQ(0, fields.at(0)->tabIdx);
+	EXPECT_EQ(string("Field 3"), fields.at(1)->name);
+	EXPECT_EQ(2, fields.at(1)->tabIdx);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpBase test suite: RomFields tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,437 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase/tests)                  *
+ * SparseDiscReaderTest.cpp: SparseDiscReader block coalescing and         *
+ * block cache tests.                                                      *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpbase
+#include "../disc/SparseDiscReader.hpp"
+#include "../disc/SparseDiscReader_p.hpp"
+
+// librpfile
+#include "librpfile/IRpFile.hpp"
+using LibRpFile::IRpFile;
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRpBase { namespace Tests {
+
+// Logical block size.
+static const unsigned int BLOCK_SIZE = 0x1000;
+
+// Number of logical blocks.
+// This is more than the block cache can hold.
+static const unsigned int DISC_BLOCKS = 20;
+
+// Sparse (empty) block.
+static const unsigned int HOLE_BLOCK = 2;
+
+// Blocks after this one are stored after a one-block gap
+// in the container, so they aren't contiguous with it.
+static const unsigned int GAP_AFTER_BLOCK = 4;
+
+/**
+ * Memory-backed IRpFile that records each read.
+ */
+class CountingFile : public IRpFile
+{
+	public:
+		explicit CountingFile(const vector<uint8_t> &data)
+			: m_data(data)
+			, m_pos(0)
+		{ }
+
+	private:
+		typedef IRpFile super;
+		RP_DISABLE_COPY(CountingFile)
+
+	public:
+		bool isOpen(void) const final
+		{
+			return true;
+		}
+
+		void close(void) final
+		{ }
+
+		size_t read(void *ptr, size_t size) final
+		{
+			reads.push_back(size);
+			if (m_pos >= static_cast<off64_t>(m_data.size())) {
+				return 0;
+			}
+			if (m_pos + static_cast<off64_t>(size) > static_cast<off64_t>(m_data.size())) {
+				size = static_cast<size_t>(m_data.size() - m_pos);
+			}
+			memcpy(ptr, &m_data[static_cast<size_t>(m_pos)], size);
+			m_pos += size;
+			return size;
+		}
+
+		size_t write(const void *ptr, size_t size) final
+		{
+			RP_UNUSED(ptr);
+			RP_UNUSED(size);
+			m_lastError = EBADF;
+			return 0;
+		}
+
+		int seek(off64_t pos) final
+		{
+			if (pos < 0) {
+				m_lastError = EINVAL;
+				return -1;
+			}
+			m_pos = pos;
+			return 0;
+		}
+
+		off64_t tell(void) final
+		{
+			return m_pos;
+		}
+
+		int truncate(off64_t size) final
+		{
+			RP_UNUSED(size);
+			m_lastError = EBADF;
+			return -1;
+		}
+
+		off64_t size(void) final
+		{
+			return static_cast<off64_t>(m_data.size());
+		}
+
+		string filename(void) const final
+		{
+			return string();
+		}
+
+	private:
+		const vector<uint8_t> &m_data;
+		off64_t m_pos;
+
+	public:
+		vector<size_t> reads;	// Size of each read.
+};
+
+class TestSparseDiscReaderPrivate : public SparseDiscReaderPrivate
+{
+	public:
+		explicit TestSparseDiscReaderPrivate(SparseDiscReader *q)
+			: super(q)
+		{ }
+
+	private:
+		typedef SparseDiscReaderPrivate super;
+		RP_DISABLE_COPY(TestSparseDiscReaderPrivate)
+};
+
+/**
+ * SparseDiscReader using a block address table.
+ */
+class TestSparseDiscReader : public SparseDiscReader
+{
+	public:
+		/**
+		 * Create a TestSparseDiscReader.
+		 * @param file File.
+		 * @param blockMap Physical block addresses.
+		 * @param overrideReadBlock If true, readBlock() is overridden and coalescing is disabled.
+		 */
+		TestSparseDiscReader(IRpFile *file, const vector<off64_t> &blockMap, bool overrideReadBlock)
+			: super(new TestSparseDiscReaderPrivate(this), file)
+			, readBlockCount(0)
+			, m_blockMap(blockMap)
+			, m_overrideReadBlock(overrideReadBlock)
+		{
+			RP_D(SparseDiscReader);
+			d->disc_size = static_cast<off64_t>(blockMap.size()) * BLOCK_SIZE;
+			d->pos = 0;
+			d->block_size = BLOCK_SIZE;
+			d->canCoalesce = !overrideReadBlock;
+		}
+
+	private:
+		typedef SparseDiscReader super;
+		RP_DISABLE_COPY(TestSparseDiscReader)
+
+	public:
+		int isDiscSupported(const uint8_t *pHeader, size_t szHeader) const final
+		{
+			RP_UNUSED(pHeader);
+			RP_UNUSED(szHeader);
+			return 0;
+		}
+
+	protected:
+		off64_t getPhysBlockAddr(uint32_t blockIdx) const final
+		{
+			if (blockIdx >= m_blockMap.size()) {
+				return -1;
+			}
+			return m_blockMap[blockIdx];
+		}
+
+		int readBlock(uint32_t blockIdx, void *ptr, int pos, size_t size) final
+		{
+			if (m_overrideReadBlock) {
+				readBlockCount++;
+			}
+			return super::readBlock(blockIdx, ptr, pos, size);
+		}
+
+	public:
+		unsigned int readBlockCount;	// Number of readBlock() calls. (if overridden)
+
+	private:
+		const vector<off64_t> &m_blockMap;
+		bool m_overrideReadBlock;
+};
+
+class SparseDiscReaderTest : public ::testing::Test
+{
+	protected:
+		SparseDiscReaderTest()
+			: file(nullptr)
+			, reader(nullptr)
+		{ }
+
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		/**
+		 * Create the disc reader.
+		 * @param overrideReadBlock If true, readBlock() is overridden and coalescing is disabled.
+		 */
+		void createReader(bool overrideReadBlock);
+
+		/**
+		 * Read data from the disc reader and check its contents.
+		 * @param pos Starting position.
+		 * @param size Size.
+		 */
+		void checkRead(off64_t pos, size_t size);
+
+		/**
+		 * Get the expected value of every byte in a logical block.
+		 * @param blockIdx Block index.
+		 * @return Expected value.
+		 */
+		static inline uint8_t blockValue(unsigned int blockIdx)
+		{
+			return (blockIdx == HOLE_BLOCK ? 0 : static_cast<uint8_t>(blockIdx + 1));
+		}
+
+	public:
+		vector<uint8_t> data;		// Container data.
+		vector<off64_t> blockMap;	// Physical block addresses.
+		CountingFile *file;
+		TestSparseDiscReader *reader;
+};
+
+void SparseDiscReaderTest::SetUp(void)
+{
+	// Container layout:
+	// - 0x0000: Header (not part of the disc)
+	// - Blocks 0 through GAP_AFTER_BLOCK, except for HOLE_BLOCK
+	// - Gap (not part of the disc)
+	// - Remaining blocks
+	data.assign(BLOCK_SIZE, 0xFF);
+	blockMap.resize(DISC_BLOCKS);
+	for (unsigned int i = 0; i < DISC_BLOCKS; i++) {
+		if (i == HOLE_BLOCK) {
+			blockMap[i] = 0;
+			continue;
+		}
+		if (i == GAP_AFTER_BLOCK + 1) {
+			data.resize(data.size() + BLOCK_SIZE, 0xFF);
+		}
+		blockMap[i] = static_cast<off64_t>(data.size());
+		data.resize(data.size() + BLOCK_SIZE, blockValue(i));
+	}
+
+	file = new CountingFile(data);
+}
+
+void SparseDiscReaderTest::TearDown(void)
+{
+	delete reader;
+	reader = nullptr;
+	if (file) {
+		file->unref();
+		file = nullptr;
+	}
+}
+
+/**
+ * Create the disc reader.
+ * @param overrideReadBlock If true, readBlock() is overridden and coalescing is disabled.
+ */
+void SparseDiscReaderTest::createReader(bool overrideReadBlock)
+{
+	reader = new TestSparseDiscReader(file, blockMap, overrideReadBlock);
+	ASSERT_TRUE(reader->isOpen());
+	ASSERT_EQ(static_cast<off64_t>(DISC_BLOCKS) * BLOCK_SIZE, reader->size());
+}
+
+/**
+ * Read data from the disc reader and check its contents.
+ * @param pos Starting position.
+ * @param size Size.
+ */
+void SparseDiscReaderTest::checkRead(off64_t pos, size_t size)
+{
+	vector<uint8_t> buf(size);
+	ASSERT_EQ(size, reader->seekAndRead(pos, buf.data(), size));
+	for (size_t i = 0; i < size; i++) {
+		const unsigned int blockIdx = static_cast<unsigned int>((pos + i) / BLOCK_SIZE);
+		ASSERT_EQ(blockValue(blockIdx), buf[i]) << "disc offset " << (pos + i);
+	}
+}
+
+/**
+ * Contiguous blocks are read with a single read request,
+ * and sparse blocks and gaps split the runs.
+ */
+TEST_F(SparseDiscReaderTest, coalesceAcrossHole)
+{
+	ASSERT_NO_FATAL_FAILURE(createReader(false));
+	ASSERT_NO_FATAL_FAILURE(checkRead(0, DISC_BLOCKS * BLOCK_SIZE));
+
+	// Blocks 0-1, the hole (no read), blocks 3-4, then everything after the gap.
+	ASSERT_EQ(3U, file->reads.size());
+	EXPECT_EQ(static_cast<size_t>(2 * BLOCK_SIZE), file->reads[0]);
+	EXPECT_EQ(static_cast<size_t>(2 * BLOCK_SIZE), file->reads[1]);
+	EXPECT_EQ(static_cast<size_t>((DISC_BLOCKS - GAP_AFTER_BLOCK - 1) * BLOCK_SIZE), file->reads[2]);
+}
+
+/**
+ * Unaligned reads are split into partial blocks, which
+ * use the block cache, and coalesced full blocks.
+ */
+TEST_F(SparseDiscReaderTest, coalesceUnaligned)
+{
+	ASSERT_NO_FATAL_FAILURE(createReader(false));
+	ASSERT_NO_FATAL_FAILURE(checkRead(6 * BLOCK_SIZE + 0x10, 4 * BLOCK_SIZE));
+
+	// Block 6 (cached), blocks 7-9, block 10 (cached)
+	ASSERT_EQ(3U, file->reads.size());
+	EXPECT_EQ(static_cast<size_t>(BLOCK_SIZE), file->reads[0]);
+	EXPECT_EQ(static_cast<size_t>(3 * BLOCK_SIZE), file->reads[1]);
+	EXPECT_EQ(static_cast<size_t>(BLOCK_SIZE), file->reads[2]);
+
+	// Both partial blocks are now cached.
+	ASSERT_NO_FATAL_FAILURE(checkRead(6 * BLOCK_SIZE + 0x100, 0x20));
+	ASSERT_NO_FATAL_FAILURE(checkRead(10 * BLOCK_SIZE + 0x200, 0x20));
+	EXPECT_EQ(3U, file->reads.size());
+}
+
+/**
+ * Partial block reads are served from the block cache,
+ * and cached blocks are used for full block reads.
+ */
+TEST_F(SparseDiscReaderTest, blockCacheHit)
+{
+	ASSERT_NO_FATAL_FAILURE(createReader(false));
+
+	// The full block is read and cached.
+	ASSERT_NO_FATAL_FAILURE(checkRead(3 * BLOCK_SIZE + 0x10, 0x20));
+	ASSERT_EQ(1U, file->reads.size());
+	EXPECT_EQ(static_cast<size_t>(BLOCK_SIZE), file->reads[0]);
+
+	// Same block, different offset.
+	ASSERT_NO_FATAL_FAILURE(checkRead(3 * BLOCK_SIZE + 0x800, 0x20));
+	EXPECT_EQ(1U, file->reads.size());
+
+	// Full block read of a cached block.
+	ASSERT_NO_FATAL_FAILURE(checkRead(3 * BLOCK_SIZE, BLOCK_SIZE));
+	EXPECT_EQ(1U, file->reads.size());
+
+	// Sparse blocks are cached without reading the file.
+	ASSERT_NO_FATAL_FAILURE(checkRead(HOLE_BLOCK * BLOCK_SIZE + 0x10, 0x20));
+	EXPECT_EQ(1U, file->reads.size());
+}
+
+/**
+ * The least-recently used block is evicted when the block cache is full.
+ */
+TEST_F(SparseDiscReaderTest, blockCacheEviction)
+{
+	ASSERT_NO_FATAL_FAILURE(createReader(false));
+
+	// Fill the cache. (16 entries)
+	static const unsigned int cacheCount = 16;
+	for (unsigned int i = 0; i < cacheCount; i++) {
+		ASSERT_NO_FATAL_FAILURE(checkRead(i * BLOCK_SIZE + 0x10, 0x20));
+	}
+	// The sparse block doesn't read the file.
+	ASSERT_EQ(cacheCount - 1, file->reads.size());
+
+	// Use block 0 again, so block 1 is the least-recently used.
+	ASSERT_NO_FATAL_FAILURE(checkRead(0x10, 0x20));
+	ASSERT_EQ(cacheCount - 1, file->reads.size());
+
+	// Block 1 is evicted.
+	ASSERT_NO_FATAL_FAILURE(checkRead(cacheCount * BLOCK_SIZE + 0x10, 0x20));
+	ASSERT_EQ(static_cast<size_t>(cacheCount), file->reads.size());
+	ASSERT_NO_FATAL_FAILURE(checkRead(0x10, 0x20));
+	EXPECT_EQ(static_cast<size_t>(cacheCount), file->reads.size());
+	ASSERT_NO_FATAL_FAILURE(checkRead(BLOCK_SIZE + 0x10, 0x20));
+	EXPECT_EQ(static_cast<size_t>(cacheCount + 1), file->reads.size());
+}
+
+/**
+ * Subclasses that override readBlock() don't use coalescing,
+ * but partial block reads still use the block cache.
+ */
+TEST_F(SparseDiscReaderTest, noCoalesce)
+{
+	ASSERT_NO_FATAL_FAILURE(createReader(true));
+	ASSERT_NO_FATAL_FAILURE(checkRead(0, 2 * BLOCK_SIZE));
+
+	// Each block is read separately using readBlock().
+	EXPECT_EQ(2U, reader->readBlockCount);
+	ASSERT_EQ(2U, file->reads.size());
+	EXPECT_EQ(static_cast<size_t>(BLOCK_SIZE), file->reads[0]);
+	EXPECT_EQ(static_cast<size_t>(BLOCK_SIZE), file->reads[1]);
+
+	// Partial block reads use the block cache.
+	ASSERT_NO_FATAL_FAILURE(checkRead(7 * BLOCK_SIZE + 0x10, 0x20));
+	ASSERT_NO_FATAL_FAILURE(checkRead(7 * BLOCK_SIZE + 0x100, 0x20));
+	EXPECT_EQ(3U, reader->readBlockCount);
+	EXPECT_EQ(3U, file->reads.size());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpBase test suite: SparseDiscReader tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -473,6 +473,32 @@ TEST_F(TextFuncsTest, cp1252_sjis_to_utf16_japanese)
 	EXPECT_EQ(sjis_utf16_data, str);
 }
 
+/**
+ * Test cp1252_sjis_to_utf8() with half-width katakana and
+ * invalid sequences after a long ASCII prefix.
+ */
+TEST_F(TextFuncsTest, cp1252_sjis_to_utf8_partial)
+{
+	// Half-width katakana. (single-byte)
+	string str = cp1252_sjis_to_utf8("ABCDEFGHIJKLMNOPQRSTUVWXYZ \xB1\xB2\xB3", -1);
+	EXPECT_EQ("ABCDEFGHIJKLMNOPQRSTUVWXYZ \xEF\xBD\xB1\xEF\xBD\xB2\xEF\xBD\xB3", str);
+
+	// Incomplete double-byte sequence.
+	// The entire string should be decoded as cp1252.
+	str = cp1252_sjis_to_utf8("ABCDEFGHIJKLMNOPQRSTUVWXYZ \x82\xA0\x82", -1);
+	EXPECT_EQ("ABCDEFGHIJKLMNOPQRSTUVWXYZ \xE2\x80\x9A\xC2\xA0\xE2\x80\x9A", str);
+
+	// Unmapped double-byte sequence. (0x8540)
+	// The entire string should be decoded as cp1252.
+	str = cp1252_sjis_to_utf8("ABCDEFGHIJKLMNOPQRSTUVWXYZ \x82\xA0\x85\x40", -1);
+	EXPECT_EQ("ABCDEFGHIJKLMNOPQRSTUVWXYZ \xE2\x80\x9A\xC2\xA0\xE2\x80\xA6@", str);
+
+	// Undefined cp1252 character. (0x81)
+	// The entire string should be decoded as Latin-1.
+	str = cp1252_sjis_to_utf8("ABCDEFGHIJKLMNOPQRSTUVWXYZ \x80\x81", -1);
+	EXPECT_EQ("ABCDEFGHIJKLMNOPQRSTUVWXYZ \xC2\x80\xC2\x81", str);
+}
+
 /** UTF-8 to UTF-16 and vice-versa **/
 
 /**
@@ -43,9 +43,11 @@
 
 // Flags stored in the %ecx register.
 #define CPUFLAG_IA32_ECX_SSE3		((uint32_t)(1U << 0))
+#define CPUFLAG_IA32_ECX_PCLMULQDQ	((uint32_t)(1U << 1))
 #define CPUFLAG_IA32_ECX_SSSE3		((uint32_t)(1U << 9))
 #define CPUFLAG_IA32_ECX_SSE41		((uint32_t)(1U << 19))
 #define CPUFLAG_IA32_ECX_SSE42		((uint32_t)(1U << 20))
+#define CPUFLAG_IA32_ECX_AES		((uint32_t)(1U << 25))
 #define CPUFLAG_IA32_ECX_XSAVE		((uint32_t)(1U << 26))
 #define CPUFLAG_IA32_ECX_OSXSAVE	((uint32_t)(1U << 27))
 #define CPUFLAG_IA32_ECX_AVX		((uint32_t)(1U << 28))
@@ -56,6 +58,9 @@
 // Flags stored in the %ebx register.
 #define CPUFLAG_IA32_FN7_EBX_AVX2	((uint32_t)(1U << 5))
 
+// Flags stored in the %ecx register.
+#define CPUFLAG_IA32_FN7_ECX_VAES	((uint32_t)(1U << 9))
+
 // CPUID function 0x80000001: Extended Processor Info and Feature Bits
 
 // Flags stored in the %edx register.
@@ -185,6 +190,79 @@ static FORCEINLINE void cpuid(unsigned int level, unsigned int regs[4])
 #endif
 }
 
+/**
+ * Run the `cpuid` instruction with a subleaf.
+ * @param level
+ * @param count Subleaf.
+ * @param regs Registers. (%eax, %ebx, %ecx, %edx)
+ * @return 0 on success; non-zero if not supported by this compiler.
+ */
+static FORCEINLINE int cpuid_count(unsigned int level, unsigned int count, unsigned int regs[4])
+{
+#if defined(__GNUC__)
+	// CPUID macro with PIC support.
+# ifdef ASM_RESERVE_EBX
+	__asm__ (
+		"xchgl	%%ebx, %1\n"
+		"cpuid\n"
+		"xchgl	%%ebx, %1\n"
+		: "=a" (regs[0]), "=r" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+		: "0" (level), "2" (count)
+		);
+# else /* !ASM_RESERVE_EBX */
+	__asm__ (
+		"cpuid\n"
+		: "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+		: "0" (level), "2" (count)
+		);
+# endif
+	return 0;
+#elif defined(_MSC_VER) && _MSC_VER >= 1500
+	// CPUID with subleaf for MSVC 2008+
+	// Uses the __cpuidex() intrinsic.
+	__cpuidex((int*)regs, level, count);
+	return 0;
+#else
+	// Not supported.
+	((void)level);
+	((void)count);
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	return -1;
+#endif
+}
+
+/**
+ * Get the value of an extended control register.
+ * This requires OSXSAVE.
+ * @param xcr Extended control register index.
+ * @return XCR value, or 0 if not supported by this compiler.
+ */
+static FORCEINLINE uint64_t xgetbv(unsigned int xcr)
+{
+#if defined(__GNUC__)
+	// NOTE: Using the opcode directly, since older
+	// assemblers don't support the xgetbv mnemonic.
+	unsigned int __eax, __edx;
+	__asm__ (
+		".byte 0x0f, 0x01, 0xd0\n"	// xgetbv
+		: "=a" (__eax), "=d" (__edx)
+		: "c" (xcr)
+		);
+	return ((uint64_t)__edx << 32) | __eax;
+#elif defined(_MSC_FULL_VER) && _MSC_FULL_VER >= 160040219
+	// xgetbv for MSVC 2010 SP1+
+	return _xgetbv(xcr);
+#else
+	// Not supported.
+	((void)xcr);
+	return 0;
+#endif
+}
+
+// XCR0 bits: XMM and YMM state are enabled by the OS.
+#define XCR0_SSE_STATE		((uint64_t)(1U << 1))
+#define XCR0_AVX_STATE		((uint64_t)(1U << 2))
+
 // Register indexes.
 #define REG_EAX 0
 #define REG_EBX 1
@@ -308,6 +386,55 @@ static void RP_CPU_InitCPUFlags_int(void)
 		if (regs[REG_ECX] & CPUFLAG_IA32_ECX_SSE42)
 			RP_CPU_Flags |= RP_CPUFLAG_X86_SSE42;
 #endif /* defined(__i386__) || defined(_M_IX86) */
+
+		// Check for AES-NI.
+		// This uses the XMM registers, so SSE2 is required.
+		if ((RP_CPU_Flags & RP_CPUFLAG_X86_SSE2) &&
+		    (regs[REG_ECX] & CPUFLAG_IA32_ECX_AES))
+		{
+			RP_CPU_Flags |= RP_CPUFLAG_X86_AES;
+		}
+
+		// Check for PCLMULQDQ.
+		// Our CRC32 folding code also uses SSE4.1 instructions.
+		if ((RP_CPU_Flags & RP_CPUFLAG_X86_SSE41) &&
+		    (regs[REG_ECX] & CPUFLAG_IA32_ECX_PCLMULQDQ))
+		{
+			RP_CPU_Flags |= RP_CPUFLAG_X86_PCLMULQDQ;
+		}
+
+		// Check for AVX.
+		// The OS must support saving the YMM registers,
+		// which is checked using XCR0.
+		if ((RP_CPU_Flags & RP_CPUFLAG_X86_SSE2) &&
+		    (regs[REG_ECX] & (CPUFLAG_IA32_ECX_OSXSAVE | CPUFLAG_IA32_ECX_AVX)) ==
+		     (CPUFLAG_IA32_ECX_OSXSAVE | CPUFLAG_IA32_ECX_AVX))
+		{
+			const uint64_t xcr0 = xgetbv(0);
+			if ((xcr0 & (XCR0_SSE_STATE | XCR0_AVX_STATE)) ==
+			     (XCR0_SSE_STATE | XCR0_AVX_STATE))
+			{
+				RP_CPU_Flags |= RP_CPUFLAG_X86_AVX;
+
+				// Check for AVX2.
+				if (maxFunc >= CPUID_EXT_FEATURES &&
+				    cpuid_count(CPUID_EXT_FEATURES, 0, regs) == 0)
+				{
+					if (regs[REG_EBX] & CPUFLAG_IA32_FN7_EBX_AVX2)
+						RP_CPU_Flags |= RP_CPUFLAG_X86_AVX2;
+
+					// Check for VAES.
+					// We're only using VAES with 256-bit
+					// registers, so AVX2 is required.
+					if ((RP_CPU_Flags & (RP_CPUFLAG_X86_AVX2 | RP_CPUFLAG_X86_AES)) ==
+					     (RP_CPUFLAG_X86_AVX2 | RP_CPUFLAG_X86_AES) &&
+					    (regs[REG_ECX] & CPUFLAG_IA32_FN7_ECX_VAES))
+					{
+						RP_CPU_Flags |= RP_CPUFLAG_X86_VAES;
+					}
+				}
+			}
+		}
 	}
 
 	// CPU flags initialized.
@@ -29,6 +29,11 @@ extern "C" {
 #define RP_CPUFLAG_X86_SSSE3		((uint32_t)(1U << 4))
 #define RP_CPUFLAG_X86_SSE41		((uint32_t)(1U << 5))
 #define RP_CPUFLAG_X86_SSE42		((uint32_t)(1U << 6))
+#define RP_CPUFLAG_X86_AVX		((uint32_t)(1U << 7))
+#define RP_CPUFLAG_X86_AVX2		((uint32_t)(1U << 8))
+#define RP_CPUFLAG_X86_AES		((uint32_t)(1U << 9))
+#define RP_CPUFLAG_X86_VAES		((uint32_t)(1U << 10))
+#define RP_CPUFLAG_X86_PCLMULQDQ	((uint32_t)(1U << 11))
 
 #endif /* defined(__i386__) || defined(__amd64__) || defined(__x86_64__) */
 
@@ -99,6 +104,57 @@ static FORCEINLINE int RP_CPU_HasSSE41(void)
 	return (RP_CPU_Flags & RP_CPUFLAG_X86_SSE41);
 }
 
+/**
+ * Check if the CPU supports AVX2.
+ * This also checks if the OS supports AVX.
+ * @return Non-zero if AVX2 is supported; 0 if not.
+ */
+static FORCEINLINE int RP_CPU_HasAVX2(void)
+{
+	if (unlikely(!RP_CPU_Flags_Init)) {
+		RP_CPU_InitCPUFlags();
+	}
+	return (RP_CPU_Flags & RP_CPUFLAG_X86_AVX2);
+}
+
+/**
+ * Check if the CPU supports AES-NI.
+ * @return Non-zero if AES-NI is supported; 0 if not.
+ */
+static FORCEINLINE int RP_CPU_HasAES(void)
+{
+	if (unlikely(!RP_CPU_Flags_Init)) {
+		RP_CPU_InitCPUFlags();
+	}
+	return (RP_CPU_Flags & RP_CPUFLAG_X86_AES);
+}
+
+/**
+ * Check if the CPU supports VAES. (256-bit AES-NI)
+ * This is only reported if AVX2 is also supported.
+ * @return Non-zero if VAES is supported; 0 if not.
+ */
+static FORCEINLINE int RP_CPU_HasVAES(void)
+{
+	if (unlikely(!RP_CPU_Flags_Init)) {
+		RP_CPU_InitCPUFlags();
+	}
+	return (RP_CPU_Flags & RP_CPUFLAG_X86_VAES);
+}
+
+/**
+ * Check if the CPU supports PCLMULQDQ. (carry-less multiplication)
+ * This is only reported if SSE4.1 is also supported.
+ * @return Non-zero if PCLMULQDQ is supported; 0 if not.
+ */
+static FORCEINLINE int RP_CPU_HasPCLMULQDQ(void)
+{
+	if (unlikely(!RP_CPU_Flags_Init)) {
+		RP_CPU_InitCPUFlags();
+	}
+	return (RP_CPU_Flags & RP_CPUFLAG_X86_PCLMULQDQ);
+}
+
 #ifdef __cplusplus
 }
 #endif
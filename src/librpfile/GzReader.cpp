@@ -0,0 +1,369 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpfile)                        *
+ * GzReader.cpp: gzip decompressor with random access support.             *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "GzReader.hpp"
+
+namespace LibRpFile {
+
+// zlib window bits for gzip decoding. (32 KiB window, gzip header)
+#define GZ_WINDOW_BITS (15+16)
+// zlib window bits for raw deflate decoding. (32 KiB window, no header)
+#define RAW_WINDOW_BITS (-15)
+// Size of the history window.
+#define WINDOW_SIZE 32768U
+// Size of the compressed input buffer.
+#define INBUF_SIZE 65536U
+
+/**
+ * Create a GzReader for a gzipped file.
+ * The FILE* must remain valid while the GzReader is in use.
+ * @param file Gzipped file.
+ * @param span Initial span between access points.
+ */
+GzReader::GzReader(FILE *file, unsigned int span)
+	: m_file(file)
+	, m_isInit(false)
+	, m_isRaw(false)
+	, m_isEOF(false)
+	, m_lastError(0)
+	, m_pos(0)
+	, m_out(0)
+	, m_in(0)
+	, m_span(span)
+{
+	assert(span > 0);
+	memset(&m_strm, 0, sizeof(m_strm));
+	if (inflateInit2(&m_strm, GZ_WINDOW_BITS) != Z_OK) {
+		// Error initializing zlib.
+		m_lastError = ENOMEM;
+		return;
+	}
+	m_inbuf.resize(INBUF_SIZE);
+	m_isInit = true;
+}
+
+GzReader::~GzReader()
+{
+	if (m_isInit) {
+		inflateEnd(&m_strm);
+	}
+}
+
+/**
+ * Read uncompressed data.
+ * @param ptr Output data buffer.
+ * @param size Amount of data to read, in bytes.
+ * @return Number of bytes read.
+ */
+size_t GzReader::read(void *ptr, size_t size)
+{
+	if (!m_isInit) {
+		m_lastError = EBADF;
+		return 0;
+	}
+	m_lastError = 0;
+
+	if (m_pos != m_out) {
+		// Seek to the requested position.
+		int ret = reposition();
+		if (ret != 0 || m_pos != m_out) {
+			// Error or EOF.
+			return 0;
+		}
+	}
+
+	uint8_t *ptr8 = static_cast<uint8_t*>(ptr);
+	size_t total = 0;
+	while (size > 0) {
+		const size_t sz = inflateSome(ptr8, size);
+		if (sz == 0) {
+			// EOF or error.
+			break;
+		}
+		ptr8 += sz;
+		size -= sz;
+		total += sz;
+	}
+
+	m_pos += total;
+	return total;
+}
+
+/**
+ * Set the uncompressed position.
+ * The actual seek is deferred until the next read().
+ * @param pos Uncompressed position.
+ * @return 0 on success; -1 on error.
+ */
+int GzReader::seek(off64_t pos)
+{
+	if (!m_isInit) {
+		m_lastError = EBADF;
+		return -1;
+	} else if (pos < 0) {
+		m_lastError = EINVAL;
+		return -1;
+	}
+
+	m_pos = pos;
+	return 0;
+}
+
+/**
+ * Move the decompressor to the requested position.
+ * An access point is used if one is available.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzReader::reposition(void)
+{
+	// Find the last access point at or before the requested position.
+	const off64_t pos = m_pos;
+	auto iter = std::upper_bound(m_points.cbegin(), m_points.cend(), pos,
+		[](off64_t pos, const AccessPoint &pt) -> bool {
+			return (pos < pt.out);
+		});
+	const bool hasPoint = (iter != m_points.cbegin());
+	const size_t idx = (hasPoint ? (iter - m_points.cbegin() - 1) : 0);
+
+	// Restart if seeking backwards, or if there's an access point
+	// between the current position and the requested position.
+	int ret = 0;
+	if (pos < m_out) {
+		ret = (hasPoint ? restartAt(idx) : restart());
+	} else if (hasPoint && m_points[idx].out > m_out) {
+		ret = restartAt(idx);
+	}
+	if (ret != 0) {
+		m_lastError = -ret;
+		return ret;
+	}
+
+	// Skip data until we reach the requested position.
+	if (m_out < pos && m_skipbuf.empty()) {
+		m_skipbuf.resize(WINDOW_SIZE);
+	}
+	while (m_out < pos) {
+		size_t sz = m_skipbuf.size();
+		if (static_cast<off64_t>(sz) > pos - m_out) {
+			sz = static_cast<size_t>(pos - m_out);
+		}
+		if (inflateSome(m_skipbuf.data(), sz) == 0) {
+			// EOF or error.
+			break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Restart decompression from the beginning of the file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzReader::restart(void)
+{
+	if (inflateReset2(&m_strm, GZ_WINDOW_BITS) != Z_OK) {
+		return -EIO;
+	}
+	m_strm.next_in = m_inbuf.data();
+	m_strm.avail_in = 0;
+	m_isRaw = false;
+	m_isEOF = false;
+	m_out = 0;
+	m_in = 0;
+	return 0;
+}
+
+/**
+ * Restart decompression from an access point.
+ * @param idx Access point index.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GzReader::restartAt(size_t idx)
+{
+	assert(idx < m_points.size());
+	const AccessPoint &pt = m_points[idx];
+
+	// Access points are always in the deflate data,
+	// so the gzip header must not be parsed.
+	if (inflateReset2(&m_strm, RAW_WINDOW_BITS) != Z_OK) {
+		return -EIO;
+	}
+	m_strm.next_in = m_inbuf.data();
+	m_strm.avail_in = 0;
+	m_isRaw = true;
+	m_isEOF = false;
+
+	m_in = pt.in;
+	if (pt.bits != 0) {
+		// The access point starts in the middle of a byte.
+		m_in--;
+		if (fillInput() == 0) {
+			return -EIO;
+		}
+		const int ch = m_strm.next_in[0];
+		m_strm.next_in++;
+		m_strm.avail_in--;
+		inflatePrime(&m_strm, pt.bits, ch >> (8 - pt.bits));
+	}
+
+	if (!pt.window.empty()) {
+		inflateSetDictionary(&m_strm, pt.window.data(), static_cast<uInt>(pt.window.size()));
+	}
+	m_out = pt.out;
+	return 0;
+}
+
+/**
+ * Read more compressed data into the input buffer.
+ * @return Number of bytes read.
+ */
+size_t GzReader::fillInput(void)
+{
+	// NOTE: Seeking every time in case something else
+	// moved the file pointer.
+	if (fseeko(m_file, m_in, SEEK_SET) != 0) {
+		m_lastError = errno;
+		return 0;
+	}
+	const size_t sz = fread(m_inbuf.data(), 1, m_inbuf.size(), m_file);
+	if (ferror(m_file)) {
+		m_lastError = errno;
+	}
+	m_in += sz;
+	m_strm.next_in = m_inbuf.data();
+	m_strm.avail_in = static_cast<uInt>(sz);
+	return sz;
+}
+
+/**
+ * Decompress data at the current position.
+ * Access points are recorded as needed.
+ * @param dest Output buffer.
+ * @param size Size of dest.
+ * @return Number of bytes decompressed, or 0 on EOF or error.
+ */
+size_t GzReader::inflateSome(uint8_t *dest, size_t size)
+{
+	if (m_isEOF)
+		return 0;
+
+	// z_stream::avail_out is uInt.
+	if (size > 0x40000000U) {
+		size = 0x40000000U;
+	}
+	m_strm.next_out = dest;
+	m_strm.avail_out = static_cast<uInt>(size);
+
+	while (m_strm.avail_out > 0) {
+		if (m_strm.avail_in == 0 && fillInput() == 0) {
+			// Unexpected end of file.
+			m_isEOF = true;
+			break;
+		}
+
+		const uInt avail_out_prev = m_strm.avail_out;
+		const int ret = inflate(&m_strm, Z_BLOCK);
+		m_out += (avail_out_prev - m_strm.avail_out);
+
+		if (ret == Z_STREAM_END) {
+			// End of this gzip member.
+			if (m_isRaw) {
+				// Raw deflate doesn't handle the gzip trailer.
+				// Skip the CRC32 and uncompressed size.
+				unsigned int skip = 8;
+				while (skip > 0) {
+					if (m_strm.avail_in == 0 && fillInput() == 0)
+						break;
+					const unsigned int n = std::min(skip, static_cast<unsigned int>(m_strm.avail_in));
+					m_strm.next_in += n;
+					m_strm.avail_in -= n;
+					skip -= n;
+				}
+			}
+
+			// Check for another gzip member.
+			// Anything else after the end of the stream is ignored,
+			// same as gzread().
+			if (m_strm.avail_in < 2) {
+				// Make sure both magic bytes are available.
+				m_in -= m_strm.avail_in;
+				if (fillInput() < 2) {
+					m_isEOF = true;
+					break;
+				}
+			}
+			if (m_strm.next_in[0] != 0x1F || m_strm.next_in[1] != 0x8B ||
+			    inflateReset2(&m_strm, GZ_WINDOW_BITS) != Z_OK)
+			{
+				m_isEOF = true;
+				break;
+			}
+			m_isRaw = false;
+			continue;
+		} else if (ret != Z_OK && !(ret == Z_BUF_ERROR && m_strm.avail_in == 0)) {
+			// Decompression error.
+			m_lastError = EIO;
+			m_isEOF = true;
+			break;
+		}
+
+		// Record an access point if we're at a deflate block boundary,
+		// the block isn't the last one, and we're far enough past the
+		// previous access point.
+		if ((m_strm.data_type & 128) && !(m_strm.data_type & 64)) {
+			const off64_t last_out = (m_points.empty() ? 0 : m_points.back().out);
+			if (m_out - last_out >= m_span) {
+				addPoint();
+			}
+		}
+	}
+
+	return size - m_strm.avail_out;
+}
+
+/**
+ * Record an access point at the current position.
+ * This must be called at a deflate block boundary.
+ */
+void GzReader::addPoint(void)
+{
+#if ZLIB_VERNUM >= 0x1271
+	if (m_points.size() >= MAX_POINTS) {
+		// Too many access points.
+		// Double the span and discard every other access point.
+		size_t j = 0;
+		for (size_t i = 1; i < m_points.size(); i += 2, j++) {
+			m_points[j] = std::move(m_points[i]);
+		}
+		m_points.resize(j);
+		m_span *= 2;
+
+		const off64_t last_out = (m_points.empty() ? 0 : m_points.back().out);
+		if (m_out - last_out < m_span) {
+			// Not far enough past the previous access point.
+			return;
+		}
+	}
+
+	AccessPoint pt;
+	pt.out = m_out;
+	pt.in = m_in - m_strm.avail_in;
+	pt.bits = (m_strm.data_type & 7);
+	pt.window.resize(WINDOW_SIZE);
+	uInt len = WINDOW_SIZE;
+	if (inflateGetDictionary(&m_strm, pt.window.data(), &len) != Z_OK) {
+		// Unable to get the history window.
+		return;
+	}
+	pt.window.resize(len);
+	m_points.push_back(std::move(pt));
+#endif /* ZLIB_VERNUM >= 0x1271 */
+}
+
+}
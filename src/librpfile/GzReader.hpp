@@ -0,0 +1,200 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpfile)                        *
+ * GzReader.hpp: gzip decompressor with random access support.             *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPFILE_GZREADER_HPP__
+#define __ROMPROPERTIES_LIBRPFILE_GZREADER_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stdint.h>
+#include <stdio.h>
+
+// C++ includes.
+#include <vector>
+
+// zlib
+#include <zlib.h>
+
+namespace LibRpFile {
+
+/**
+ * gzip decompressor with random access support.
+ *
+ * zlib's gzseek() restarts decompression from the beginning of the
+ * file when seeking backwards. To avoid this, GzReader records access
+ * points (deflate block boundaries plus the 32 KiB history window)
+ * every "span" bytes of uncompressed data while decompressing.
+ * A seek then restarts from the closest access point, so it costs at
+ * most one span of decompression once that part of the file has been
+ * read. (Based on zran.c from the zlib examples.)
+ *
+ * The number of access points is limited. If the limit is reached,
+ * the span is doubled and every other access point is discarded.
+ *
+ * NOTE: Access points require inflateGetDictionary(), which was added
+ * in zlib-1.2.7.1. With older versions, seeking backwards restarts
+ * from the beginning of the file, same as gzseek().
+ */
+class GzReader
+{
+	public:
+		/**
+		 * Create a GzReader for a gzipped file.
+		 * The FILE* must remain valid while the GzReader is in use.
+		 * @param file Gzipped file.
+		 * @param span Initial span between access points.
+		 */
+		explicit GzReader(FILE *file, unsigned int span = DEFAULT_SPAN);
+		~GzReader();
+
+	private:
+		RP_DISABLE_COPY(GzReader)
+
+	public:
+		/**
+		 * Was the decompressor initialized successfully?
+		 * @return True if it was; false if it wasn't.
+		 */
+		inline bool isOpen(void) const
+		{
+			return m_isInit;
+		}
+
+		/**
+		 * Get the last error.
+		 * @return Last POSIX error, or 0 if no error.
+		 */
+		inline int lastError(void) const
+		{
+			return m_lastError;
+		}
+
+		/**
+		 * Read uncompressed data.
+		 * @param ptr Output data buffer.
+		 * @param size Amount of data to read, in bytes.
+		 * @return Number of bytes read.
+		 */
+		size_t read(void *ptr, size_t size);
+
+		/**
+		 * Set the uncompressed position.
+		 * The actual seek is deferred until the next read().
+		 * @param pos Uncompressed position.
+		 * @return 0 on success; -1 on error.
+		 */
+		int seek(off64_t pos);
+
+		/**
+		 * Get the uncompressed position.
+		 * @return Uncompressed position.
+		 */
+		inline off64_t tell(void) const
+		{
+			return m_pos;
+		}
+
+		/**
+		 * Get the number of access points that have been recorded.
+		 * @return Number of access points.
+		 */
+		inline size_t pointCount(void) const
+		{
+			return m_points.size();
+		}
+
+		/**
+		 * Get the current span between access points.
+		 * This is doubled each time the access point limit is reached.
+		 * @return Current span.
+		 */
+		inline off64_t span(void) const
+		{
+			return m_span;
+		}
+
+	public:
+		// Default span between access points. (1 MiB)
+		static const unsigned int DEFAULT_SPAN = 1U*1024*1024;
+		// Maximum number of access points.
+		static const unsigned int MAX_POINTS = 256;
+
+	private:
+		/**
+		 * Move the decompressor to the requested position.
+		 * An access point is used if one is available.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int reposition(void);
+
+		/**
+		 * Restart decompression from the beginning of the file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int restart(void);
+
+		/**
+		 * Restart decompression from an access point.
+		 * @param idx Access point index.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int restartAt(size_t idx);
+
+		/**
+		 * Read more compressed data into the input buffer.
+		 * @return Number of bytes read.
+		 */
+		size_t fillInput(void);
+
+		/**
+		 * Decompress data at the current position.
+		 * Access points are recorded as needed.
+		 * @param dest Output buffer.
+		 * @param size Size of dest.
+		 * @return Number of bytes decompressed, or 0 on EOF or error.
+		 */
+		size_t inflateSome(uint8_t *dest, size_t size);
+
+		/**
+		 * Record an access point at the current position.
+		 * This must be called at a deflate block boundary.
+		 */
+		void addPoint(void);
+
+	private:
+		FILE *m_file;		// Gzipped file.
+		z_stream m_strm;	// zlib stream.
+		bool m_isInit;		// Was m_strm initialized?
+		bool m_isRaw;		// Is m_strm in raw deflate mode?
+		bool m_isEOF;		// Reached the end of the compressed data?
+		int m_lastError;	// Last POSIX error.
+
+		off64_t m_pos;		// Requested uncompressed position.
+		off64_t m_out;		// Current uncompressed position in m_strm.
+		off64_t m_in;		// File offset of the next byte to read into m_inbuf.
+
+		// Compressed input buffer.
+		std::vector<uint8_t> m_inbuf;
+		// Scratch buffer for skipping uncompressed data.
+		std::vector<uint8_t> m_skipbuf;
+
+		// Access point.
+		struct AccessPoint {
+			off64_t out;	// Uncompressed position.
+			off64_t in;	// Compressed position of the first complete byte.
+			int bits;	// Number of bits (1-7) from the byte at in-1, or 0.
+			std::vector<uint8_t> window;	// History window. (up to 32 KiB)
+		};
+		std::vector<AccessPoint> m_points;
+		off64_t m_span;		// Current span between access points.
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBRPFILE_GZREADER_HPP__ */
@@ -120,6 +120,28 @@ class IRpFile
 		 */
 		virtual int truncate(off64_t size = 0) = 0;
 
+		/**
+		 * Get a pointer to the file's data without copying it.
+		 *
+		 * This is only supported if the file's contents are directly
+		 * accessible in memory, e.g. memory-mapped files and RpMemFile.
+		 * If this function returns nullptr, use read() instead.
+		 *
+		 * NOTE: The file position is not changed.
+		 * The returned pointer is valid until the file is closed.
+		 *
+		 * @param pos	[in] Starting position.
+		 * @param size	[in] Number of bytes.
+		 * @return Pointer to the data, or nullptr if not available or out of range.
+		 */
+		virtual const uint8_t *dataPtr(off64_t pos, size_t size)
+		{
+			// Not supported by default.
+			RP_UNUSED(pos);
+			RP_UNUSED(size);
+			return nullptr;
+		}
+
 	public:
 		/** File properties **/
 
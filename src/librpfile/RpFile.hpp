@@ -44,6 +44,17 @@ class RpFile : public IRpFile
 			// Extras.
 			FM_GZIP_DECOMPRESS = 4,	// Transparent gzip decompression. (read-only!)
 			FM_OPEN_READ_GZ = FM_READ | FM_GZIP_DECOMPRESS,
+
+			// Memory-map the file if possible. (read-only!)
+			// Only regular files that aren't gzipped are mapped.
+			// WARNING: If the file is truncated by another process
+			// while it's mapped, reading the missing part raises SIGBUS.
+			// Only use this if that can't happen, or if crashing is
+			// acceptable, e.g. in a command-line program.
+			// NOTE: Ignored on Windows.
+			FM_MMAP = 8,
+			FM_OPEN_READ_MMAP = FM_READ | FM_MMAP,
+			FM_OPEN_READ_GZ_MMAP = FM_READ | FM_GZIP_DECOMPRESS | FM_MMAP,
 		};
 
 		/**
@@ -115,6 +126,21 @@ class RpFile : public IRpFile
 		 */
 		int truncate(off64_t size = 0) final;
 
+		/**
+		 * Get a pointer to the file's data without copying it.
+		 *
+		 * This is only supported for regular files that were opened
+		 * read-only with FM_MMAP and are memory-mapped.
+		 *
+		 * NOTE: The file position is not changed.
+		 * The returned pointer is valid until the file is closed.
+		 *
+		 * @param pos	[in] Starting position.
+		 * @param size	[in] Number of bytes.
+		 * @return Pointer to the data, or nullptr if not available or out of range.
+		 */
+		const uint8_t *dataPtr(off64_t pos, size_t size) final;
+
 	public:
 		/** File properties **/
 
@@ -32,6 +32,9 @@ using std::vector;
 # define gzclose_r(file) gzclose(file)
 # define gzclose_w(file) gzclose(file)
 #endif
+#ifndef _WIN32
+# include "GzReader.hpp"
+#endif /* !_WIN32 */
 
 #ifdef _WIN32
 // Windows SDK
@@ -75,10 +78,18 @@ class RpFilePrivate
 
 		RpFilePrivate(RpFile *q, const char *filename, RpFile::FileMode mode)
 			: q_ptr(q), file(FILE_INIT), filename(filename)
-			, mode(mode), gzfd(nullptr), gzsz(-1), devInfo(nullptr) { }
+			, mode(mode), gzfd(nullptr), gzsz(-1), devInfo(nullptr)
+#ifdef HAVE_MMAP
+			, map_data(nullptr), map_size(0), map_pos(0)
+#endif /* HAVE_MMAP */
+		{ }
 		RpFilePrivate(RpFile *q, const string &filename, RpFile::FileMode mode)
 			: q_ptr(q), file(FILE_INIT), filename(filename)
-			, mode(mode), gzfd(nullptr), gzsz(-1), devInfo(nullptr) { }
+			, mode(mode), gzfd(nullptr), gzsz(-1), devInfo(nullptr)
+#ifdef HAVE_MMAP
+			, map_data(nullptr), map_size(0), map_pos(0)
+#endif /* HAVE_MMAP */
+		{ }
 		~RpFilePrivate();
 
 	private:
@@ -90,7 +101,11 @@ class RpFilePrivate
 		string filename;	// Filename.
 		RpFile::FileMode mode;	// File mode.
 
+#ifdef _WIN32
 		gzFile gzfd;		// Used for transparent gzip decompression.
+#else /* !_WIN32 */
+		GzReader *gzfd;		// Used for transparent gzip decompression.
+#endif /* _WIN32 */
 		off64_t gzsz;		// Uncompressed file size.
 
 		// Device information struct.
@@ -169,6 +184,31 @@ class RpFilePrivate
 
 		DeviceInfo *devInfo;
 
+#ifdef HAVE_MMAP
+		// Read-only memory mapping.
+		// If set, reads are handled using the mapping
+		// instead of stdio.
+		const uint8_t *map_data;	// Mapped file data.
+		size_t map_size;		// Mapped size.
+		off64_t map_pos;		// Current position.
+
+		/**
+		 * Map the file into memory.
+		 * Only regular files opened read-only with FM_MMAP
+		 * and without gzip decompression can be mapped.
+		 *
+		 * NOTE: If mapping fails, stdio will be used.
+		 *
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int mapFile(void);
+
+		/**
+		 * Unmap the file, if it's mapped.
+		 */
+		void unmapFile(void);
+#endif /* HAVE_MMAP */
+
 	public:
 #ifdef _WIN32
 		/**
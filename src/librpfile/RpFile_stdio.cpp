@@ -20,6 +20,18 @@
 #include <fcntl.h>	// AT_EMPTY_PATH
 #include <sys/stat.h>	// stat(), statx()
 #include <unistd.h>	// ftruncate()
+#ifdef HAVE_MMAP
+# include <sys/mman.h>	// mmap()
+#endif /* HAVE_MMAP */
+
+// Maximum file size to memory-map.
+// 32-bit systems don't have much address space,
+// so only small files are mapped there.
+#if SIZE_MAX > 0xFFFFFFFFU
+# define RPFILE_MMAP_MAX_SIZE	INT64_MAX
+#else
+# define RPFILE_MMAP_MAX_SIZE	(64*1024*1024)
+#endif
 
 namespace LibRpFile {
 
@@ -27,9 +39,10 @@ namespace LibRpFile {
 
 RpFilePrivate::~RpFilePrivate()
 {
-	if (gzfd) {
-		gzclose_r(gzfd);
-	}
+#ifdef HAVE_MMAP
+	unmapFile();
+#endif /* HAVE_MMAP */
+	delete gzfd;
 	if (file) {
 		fclose(file);
 	}
@@ -196,6 +209,67 @@ int RpFilePrivate::reOpenFile(void)
 	return 0;
 }
 
+#ifdef HAVE_MMAP
+/**
+ * Map the file into memory.
+ * Only regular files opened read-only with FM_MMAP
+ * and without gzip decompression can be mapped.
+ *
+ * NOTE: If mapping fails, stdio will be used.
+ *
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpFilePrivate::mapFile(void)
+{
+	assert(file != nullptr);
+	assert(map_data == nullptr);
+	assert(!gzfd);
+	assert(!devInfo);
+	assert((mode & RpFile::FM_MODE_MASK) == RpFile::FM_OPEN_READ);
+	if (!file || map_data || gzfd || devInfo ||
+	    (mode & RpFile::FM_MODE_MASK) != RpFile::FM_OPEN_READ)
+	{
+		return -EINVAL;
+	}
+
+	const int fd = fileno(file);
+	struct stat sb;
+	if (fstat(fd, &sb) != 0) {
+		return -errno;
+	} else if (!S_ISREG(sb.st_mode)) {
+		// Only regular files can be mapped.
+		return -ENOTSUP;
+	} else if (sb.st_size <= 0 || sb.st_size > RPFILE_MMAP_MAX_SIZE) {
+		// Empty files can't be mapped, and
+		// large files are handled using stdio.
+		return -ENOTSUP;
+	}
+
+	void *const ptr = mmap(nullptr, static_cast<size_t>(sb.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (ptr == MAP_FAILED) {
+		return -errno;
+	}
+
+	map_data = static_cast<const uint8_t*>(ptr);
+	map_size = static_cast<size_t>(sb.st_size);
+	map_pos = 0;
+	return 0;
+}
+
+/**
+ * Unmap the file, if it's mapped.
+ */
+void RpFilePrivate::unmapFile(void)
+{
+	if (map_data) {
+		munmap(const_cast<uint8_t*>(map_data), map_size);
+		map_data = nullptr;
+		map_size = 0;
+		map_pos = 0;
+	}
+}
+#endif /* HAVE_MMAP */
+
 /** RpFile **/
 
 /**
@@ -248,7 +322,7 @@ void RpFile::init(void)
 	// Check if this is a gzipped file.
 	// If it is, use transparent decompression.
 	// Reference: https://www.forensicswiki.org/wiki/Gzip
-	if (d->mode == FM_OPEN_READ_GZ) {
+	if ((d->mode & (FM_MODE_MASK | FM_GZIP_DECOMPRESS)) == FM_OPEN_READ_GZ) {
 		uint16_t gzmagic;
 		size_t size = fread(&gzmagic, 1, sizeof(gzmagic), d->file);
 		if (size == sizeof(gzmagic) && gzmagic == be16_to_cpu(0x1F8B)) {
@@ -271,17 +345,19 @@ void RpFile::init(void)
 						// Make sure the CRC32 table is initialized.
 						get_crc_table();
 
-						// Open the file with gzdopen().
+						// Open the file with GzReader.
+						// NOTE: gzdopen() isn't used here because gzseek()
+						// restarts from the beginning of the file when
+						// seeking backwards. GzReader records access points
+						// so it can resume decompression close to any
+						// previously-read position.
 						::rewind(d->file);
 						::fflush(d->file);
-						int gzfd_dup = ::dup(fileno(d->file));
-						if (gzfd_dup >= 0) {
-							d->gzfd = gzdopen(gzfd_dup, "r");
-							if (!d->gzfd) {
-								// gzdopen() failed.
-								// Close the dup()'d handle to prevent a leak.
-								::close(gzfd_dup);
-							}
+						d->gzfd = new GzReader(d->file);
+						if (!d->gzfd->isOpen()) {
+							// Unable to initialize the decompressor.
+							delete d->gzfd;
+							d->gzfd = nullptr;
 						}
 					}
 				}
@@ -295,6 +371,19 @@ void RpFile::init(void)
 			::fflush(d->file);
 		}
 	}
+
+#ifdef HAVE_MMAP
+	// If requested, and this is a read-only regular file, map it into memory.
+	// This avoids a system call and a buffer copy for every read,
+	// which helps parsers that do a lot of small reads.
+	// NOTE: Mapping is opt-in, since reading a mapped file
+	// that was truncated by another process raises SIGBUS.
+	if ((d->mode & FM_MMAP) && (d->mode & FM_MODE_MASK) == FM_OPEN_READ &&
+	    !d->gzfd && !d->devInfo)
+	{
+		d->mapFile();
+	}
+#endif /* HAVE_MMAP */
 }
 
 RpFile::~RpFile()
@@ -328,8 +417,11 @@ void RpFile::close(void)
 		d->devInfo->close();
 	}
 
+#ifdef HAVE_MMAP
+	d->unmapFile();
+#endif /* HAVE_MMAP */
 	if (d->gzfd) {
-		gzclose_r(d->gzfd);
+		delete d->gzfd;
 		d->gzfd = nullptr;
 	}
 	if (d->file) {
@@ -357,15 +449,29 @@ size_t RpFile::read(void *ptr, size_t size)
 		return d->readUsingBlocks(ptr, size);
 	}
 
+#ifdef HAVE_MMAP
+	if (d->map_data) {
+		// Memory-mapped file.
+		if (d->map_pos >= static_cast<off64_t>(d->map_size)) {
+			// End of file.
+			return 0;
+		}
+		const size_t avail = d->map_size - static_cast<size_t>(d->map_pos);
+		if (size > avail) {
+			size = avail;
+		}
+		memcpy(ptr, &d->map_data[d->map_pos], size);
+		d->map_pos += size;
+		return size;
+	}
+#endif /* HAVE_MMAP */
+
 	size_t ret;
 	if (d->gzfd) {
-		int iret = gzread(d->gzfd, ptr, size);
-		if (iret >= 0) {
-			ret = (size_t)iret;
-		} else {
+		ret = d->gzfd->read(ptr, size);
+		if (ret != size && d->gzfd->lastError() != 0) {
 			// An error occurred.
-			ret = 0;
-			m_lastError = errno;
+			m_lastError = d->gzfd->lastError();
 		}
 	} else {
 		ret = fread(ptr, 1, size, d->file);
@@ -428,15 +534,25 @@ int RpFile::seek(off64_t pos)
 		return 0;
 	}
 
+#ifdef HAVE_MMAP
+	if (d->map_data) {
+		// Memory-mapped file.
+		// NOTE: Seeking past the end of the file is allowed,
+		// same as fseeko().
+		if (pos < 0) {
+			m_lastError = EINVAL;
+			return -1;
+		}
+		d->map_pos = pos;
+		return 0;
+	}
+#endif /* HAVE_MMAP */
+
 	int ret;
 	if (d->gzfd) {
-		z_off_t zret = gzseek(d->gzfd, pos, SEEK_SET);
-		if (zret >= 0) {
-			ret = 0;
-		} else {
-			// TODO: Does gzseek() set errno?
-			ret = -1;
-			m_lastError = -EIO;
+		ret = d->gzfd->seek(pos);
+		if (ret != 0) {
+			m_lastError = d->gzfd->lastError();
 		}
 	} else {
 		ret = fseeko(d->file, pos, SEEK_SET);
@@ -460,8 +576,13 @@ off64_t RpFile::tell(void)
 		return -1;
 	}
 
+#ifdef HAVE_MMAP
+	if (d->map_data) {
+		return d->map_pos;
+	}
+#endif /* HAVE_MMAP */
 	if (d->gzfd) {
-		return (off64_t)gztell(d->gzfd);
+		return d->gzfd->tell();
 	}
 	return ftello(d->file);
 }
@@ -513,6 +634,42 @@ int RpFile::truncate(off64_t size)
 	return 0;
 }
 
+/**
+ * Get a pointer to the file's data without copying it.
+ *
+ * This is only supported for regular files that were opened
+ * read-only with FM_MMAP and are memory-mapped.
+ *
+ * NOTE: The file position is not changed.
+ * The returned pointer is valid until the file is closed.
+ *
+ * @param pos	[in] Starting position.
+ * @param size	[in] Number of bytes.
+ * @return Pointer to the data, or nullptr if not available or out of range.
+ */
+const uint8_t *RpFile::dataPtr(off64_t pos, size_t size)
+{
+#ifdef HAVE_MMAP
+	RP_D(const RpFile);
+	if (!d->map_data) {
+		// File is not memory-mapped.
+		return nullptr;
+	}
+
+	// Check if the range is in bounds.
+	if (pos < 0 || static_cast<uint64_t>(pos) > d->map_size ||
+	    size > d->map_size - static_cast<size_t>(pos))
+	{
+		return nullptr;
+	}
+	return &d->map_data[pos];
+#else /* !HAVE_MMAP */
+	RP_UNUSED(pos);
+	RP_UNUSED(size);
+	return nullptr;
+#endif /* HAVE_MMAP */
+}
+
 /** File properties **/
 
 /**
@@ -537,6 +694,12 @@ off64_t RpFile::size(void)
 		// at the end of the stream.
 		return d->gzsz;
 	}
+#ifdef HAVE_MMAP
+	if (d->map_data) {
+		// Memory-mapped file. Use the mapped size.
+		return static_cast<off64_t>(d->map_size);
+	}
+#endif /* HAVE_MMAP */
 
 	// Save the current position.
 	off64_t cur_pos = ftello(d->file);
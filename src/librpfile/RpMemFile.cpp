@@ -172,6 +172,27 @@ int RpMemFile::truncate(off64_t size)
 	return -1;
 }
 
+/**
+ * Get a pointer to the file's data without copying it.
+ * NOTE: The file position is not changed.
+ * @param pos	[in] Starting position.
+ * @param size	[in] Number of bytes.
+ * @return Pointer to the data, or nullptr if out of range.
+ */
+const uint8_t *RpMemFile::dataPtr(off64_t pos, size_t size)
+{
+	if (!m_buf) {
+		m_lastError = EBADF;
+		return nullptr;
+	}
+
+	// Check if the range is in bounds.
+	if (pos < 0 || static_cast<uint64_t>(pos) > m_size || size > m_size - static_cast<size_t>(pos)) {
+		return nullptr;
+	}
+	return static_cast<const uint8_t*>(m_buf) + pos;
+}
+
 /** File properties **/
 
 /**
@@ -91,6 +91,15 @@ class RpMemFile : public IRpFile
 		 */
 		int truncate(off64_t size = 0) final;
 
+		/**
+		 * Get a pointer to the file's data without copying it.
+		 * NOTE: The file position is not changed.
+		 * @param pos	[in] Starting position.
+		 * @param size	[in] Number of bytes.
+		 * @return Pointer to the data, or nullptr if out of range.
+		 */
+		const uint8_t *dataPtr(off64_t pos, size_t size) final;
+
 	public:
 		/** File properties **/
 
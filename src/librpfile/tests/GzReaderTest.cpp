@@ -0,0 +1,387 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpfile/tests)                  *
+ * GzReaderTest.cpp: GzReader test.                                        *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpfile
+#include "../GzReader.hpp"
+
+// zlib
+#include <zlib.h>
+
+// C includes.
+#ifdef _WIN32
+# include <io.h>
+#else /* !_WIN32 */
+# include <unistd.h>
+#endif /* _WIN32 */
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRpFile { namespace Tests {
+
+class GzReaderTest : public ::testing::Test
+{
+	protected:
+		GzReaderTest()
+			: m_file(nullptr)
+		{ }
+
+		void TearDown(void) final
+		{
+			if (m_file) {
+				fclose(m_file);
+				m_file = nullptr;
+			}
+		}
+
+	public:
+		/**
+		 * Create compressible test data.
+		 * @param size Size of the data.
+		 * @param seed Random seed.
+		 * @return Test data.
+		 */
+		static vector<uint8_t> makeData(size_t size, uint32_t seed = 0x12345678)
+		{
+			static const char *const words[] = {
+				"Mega Drive ", "Saturn ", "Dreamcast ", "GameCube ",
+				"Wii ", "Nintendo DS ", "PlayStation ", "Game Boy ",
+			};
+
+			vector<uint8_t> data;
+			data.reserve(size + 16);
+			while (data.size() < size) {
+				seed = seed * 1103515245 + 12345;
+				const char *const word = words[(seed >> 16) & 7];
+				data.insert(data.end(), word, word + strlen(word));
+				// Add some noise so the data isn't too compressible.
+				data.push_back(static_cast<uint8_t>(seed >> 24));
+			}
+			data.resize(size);
+			return data;
+		}
+
+		/**
+		 * Compress data as a single gzip member.
+		 * @param data Data.
+		 * @param flushInterval If non-zero, do a Z_SYNC_FLUSH every flushInterval bytes.
+		 * @return gzip member.
+		 */
+		static vector<uint8_t> gzipMember(const vector<uint8_t> &data, size_t flushInterval = 0)
+		{
+			z_stream strm;
+			memset(&strm, 0, sizeof(strm));
+			int ret = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY);
+			EXPECT_EQ(Z_OK, ret);
+			if (ret != Z_OK) {
+				return vector<uint8_t>();
+			}
+
+			vector<uint8_t> out(deflateBound(&strm, static_cast<uLong>(data.size())) +
+				(flushInterval > 0 ? (data.size() / flushInterval + 1) * 16 : 0));
+			strm.next_out = out.data();
+			strm.avail_out = static_cast<uInt>(out.size());
+
+			size_t pos = 0;
+			do {
+				size_t sz = data.size() - pos;
+				if (flushInterval > 0 && sz > flushInterval) {
+					sz = flushInterval;
+				}
+				strm.next_in = const_cast<Bytef*>(&data[pos]);
+				strm.avail_in = static_cast<uInt>(sz);
+				pos += sz;
+				const int flush = (pos >= data.size() ? Z_FINISH : Z_SYNC_FLUSH);
+				ret = deflate(&strm, flush);
+				EXPECT_NE(Z_STREAM_ERROR, ret);
+			} while (pos < data.size());
+			EXPECT_EQ(Z_STREAM_END, ret);
+
+			out.resize(strm.total_out);
+			deflateEnd(&strm);
+			return out;
+		}
+
+		/**
+		 * Write compressed data to a temporary file.
+		 * @param gz Compressed data.
+		 * @return FILE*, or nullptr on error. (owned by the test fixture)
+		 */
+		FILE *writeTempFile(const vector<uint8_t> &gz)
+		{
+			m_file = tmpfile();
+			EXPECT_TRUE(m_file != nullptr);
+			if (!m_file) {
+				return nullptr;
+			}
+			EXPECT_EQ(gz.size(), fwrite(gz.data(), 1, gz.size(), m_file));
+			fflush(m_file);
+			rewind(m_file);
+			return m_file;
+		}
+
+		/**
+		 * Decompress a file using zlib's gzread().
+		 * @param file FILE*.
+		 * @return Decompressed data.
+		 */
+		static vector<uint8_t> gzreadAll(FILE *file)
+		{
+			vector<uint8_t> data;
+			rewind(file);
+			gzFile gzfd = gzdopen(dup(fileno(file)), "rb");
+			EXPECT_TRUE(gzfd != nullptr);
+			if (!gzfd) {
+				return data;
+			}
+
+			uint8_t buf[65536];
+			int sz;
+			while ((sz = gzread(gzfd, buf, sizeof(buf))) > 0) {
+				data.insert(data.end(), buf, buf + sz);
+			}
+			gzclose_r(gzfd);
+			return data;
+		}
+
+		/**
+		 * Decompress a file using GzReader.
+		 * @param gzr GzReader.
+		 * @return Decompressed data.
+		 */
+		static vector<uint8_t> readAll(GzReader &gzr)
+		{
+			vector<uint8_t> data;
+			EXPECT_EQ(0, gzr.seek(0));
+
+			uint8_t buf[50000];	// not a power of two
+			size_t sz;
+			while ((sz = gzr.read(buf, sizeof(buf))) > 0) {
+				data.insert(data.end(), buf, buf + sz);
+			}
+			return data;
+		}
+
+		/**
+		 * Read data at a specific position and compare it to the original data.
+		 * @param gzr GzReader.
+		 * @param data Original data.
+		 * @param pos Position.
+		 * @param size Size.
+		 */
+		static void checkRead(GzReader &gzr, const vector<uint8_t> &data, size_t pos, size_t size)
+		{
+			vector<uint8_t> buf(size);
+			ASSERT_EQ(0, gzr.seek(pos));
+			const size_t expected = (pos < data.size() ? std::min(size, data.size() - pos) : 0);
+			ASSERT_EQ(expected, gzr.read(buf.data(), size)) << "pos == " << pos;
+			EXPECT_EQ(0, memcmp(data.data() + pos, buf.data(), expected)) << "pos == " << pos;
+			EXPECT_EQ(static_cast<off64_t>(pos + expected), gzr.tell());
+		}
+
+	public:
+		FILE *m_file;
+};
+
+/**
+ * Sequential read of a single gzip member.
+ * The output must match gzread().
+ */
+TEST_F(GzReaderTest, sequentialRead)
+{
+	const vector<uint8_t> data = makeData(3*1024*1024 + 17);
+	FILE *const file = writeTempFile(gzipMember(data));
+	ASSERT_TRUE(file != nullptr);
+
+	GzReader gzr(file);
+	ASSERT_TRUE(gzr.isOpen());
+	const vector<uint8_t> out = readAll(gzr);
+	EXPECT_EQ(0, gzr.lastError());
+	ASSERT_EQ(data.size(), out.size());
+	EXPECT_TRUE(data == out);
+	EXPECT_TRUE(gzreadAll(file) == out);
+}
+
+/**
+ * Seek backwards after reading the entire file.
+ * Access points should be used instead of restarting.
+ */
+TEST_F(GzReaderTest, seekBackwards)
+{
+	const vector<uint8_t> data = makeData(4*1024*1024);
+	FILE *const file = writeTempFile(gzipMember(data, 16384));
+	ASSERT_TRUE(file != nullptr);
+
+	GzReader gzr(file, 256*1024);
+	ASSERT_TRUE(gzr.isOpen());
+	ASSERT_EQ(data.size(), readAll(gzr).size());
+	EXPECT_GT(gzr.pointCount(), 0U);
+
+	// Read backwards from the end of the file.
+	for (size_t pos = data.size() - 1000; pos > 333333; pos -= 333333) {
+		checkRead(gzr, data, pos, 10000);
+	}
+
+	// Reads that span access points.
+	checkRead(gzr, data, 256*1024 - 100, 300*1024);
+	checkRead(gzr, data, 0, 100);
+	checkRead(gzr, data, 3*1024*1024 + 5, 1024*1024);
+
+	// Past the end of the file.
+	checkRead(gzr, data, data.size() - 10, 100);
+	checkRead(gzr, data, data.size(), 100);
+	checkRead(gzr, data, 1000, 1000);
+
+	// Negative seek is an error.
+	EXPECT_EQ(-1, gzr.seek(-1));
+	EXPECT_EQ(EINVAL, gzr.lastError());
+}
+
+/**
+ * Reaching the access point limit should double the span
+ * and discard every other access point.
+ */
+TEST_F(GzReaderTest, accessPointThinning)
+{
+	static const unsigned int span = 4096;
+	const vector<uint8_t> data = makeData(4*1024*1024 + 1234);
+	FILE *const file = writeTempFile(gzipMember(data, span));
+	ASSERT_TRUE(file != nullptr);
+
+	GzReader gzr(file, span);
+	ASSERT_TRUE(gzr.isOpen());
+	ASSERT_EQ(data.size(), readAll(gzr).size());
+
+	// 4 MiB with a 4 KiB span would need 1,024 access points.
+	EXPECT_LE(gzr.pointCount(), static_cast<size_t>(GzReader::MAX_POINTS));
+	EXPECT_GE(gzr.pointCount(), static_cast<size_t>(GzReader::MAX_POINTS / 2));
+	EXPECT_GT(gzr.span(), static_cast<off64_t>(span));
+
+	// Access points must still be usable after thinning.
+	uint32_t seed = 0xABCDEF01;
+	for (unsigned int i = 0; i < 64; i++) {
+		seed = seed * 1103515245 + 12345;
+		const size_t pos = seed % data.size();
+		checkRead(gzr, data, pos, 5000);
+	}
+}
+
+/**
+ * Multiple concatenated gzip members.
+ * The output must match gzread().
+ */
+TEST_F(GzReaderTest, multipleMembers)
+{
+	const vector<uint8_t> data1 = makeData(1536*1024, 1);
+	const vector<uint8_t> data2 = makeData(1024*1024 + 3, 2);
+	const vector<uint8_t> data3 = makeData(777, 3);
+	vector<uint8_t> gz = gzipMember(data1, 32768);
+	const vector<uint8_t> gz2 = gzipMember(data2, 32768);
+	const vector<uint8_t> gz3 = gzipMember(data3);
+	gz.insert(gz.end(), gz2.begin(), gz2.end());
+	gz.insert(gz.end(), gz3.begin(), gz3.end());
+	FILE *const file = writeTempFile(gz);
+	ASSERT_TRUE(file != nullptr);
+
+	vector<uint8_t> data = data1;
+	data.insert(data.end(), data2.begin(), data2.end());
+	data.insert(data.end(), data3.begin(), data3.end());
+
+	GzReader gzr(file, 128*1024);
+	ASSERT_TRUE(gzr.isOpen());
+	const vector<uint8_t> out = readAll(gzr);
+	EXPECT_EQ(0, gzr.lastError());
+	ASSERT_EQ(data.size(), out.size());
+	EXPECT_TRUE(data == out);
+	EXPECT_TRUE(gzreadAll(file) == out);
+
+	// Seek backwards into each member, and across member boundaries.
+	checkRead(gzr, data, data1.size() + data2.size() - 500, 1000);
+	checkRead(gzr, data, data1.size() + 100000, 10000);
+	checkRead(gzr, data, data1.size() - 1000, 2000);
+	checkRead(gzr, data, 500000, 10000);
+	checkRead(gzr, data, data1.size() + data2.size() + 10, 1000);
+}
+
+/**
+ * Trailing garbage after the last gzip member is ignored,
+ * same as gzread().
+ */
+TEST_F(GzReaderTest, trailingGarbage)
+{
+	static const uint8_t garbage[][8] = {
+		{'J','U','N','K','D','A','T','A'},
+		{0x1F,0x00,'J','U','N','K','!','!'},	// first magic byte only
+		{0x1F,0x8B,0x08,0x00,0x00,0x00,0x00,0x00},	// truncated header
+	};
+
+	const vector<uint8_t> data = makeData(200000);
+	const vector<uint8_t> member = gzipMember(data);
+	for (size_t i = 0; i < sizeof(garbage)/sizeof(garbage[0]); i++) {
+		vector<uint8_t> gz = member;
+		gz.insert(gz.end(), garbage[i], garbage[i] + sizeof(garbage[i]));
+		FILE *const file = writeTempFile(gz);
+		ASSERT_TRUE(file != nullptr);
+
+		GzReader gzr(file);
+		ASSERT_TRUE(gzr.isOpen());
+		const vector<uint8_t> out = readAll(gzr);
+		EXPECT_EQ(0, gzr.lastError()) << "garbage " << i;
+		EXPECT_TRUE(data == out) << "garbage " << i;
+		EXPECT_TRUE(gzreadAll(file) == out) << "garbage " << i;
+
+		fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+/**
+ * Truncated gzip member.
+ * The data that could be decompressed is returned.
+ */
+TEST_F(GzReaderTest, truncatedFile)
+{
+	const vector<uint8_t> data = makeData(1024*1024);
+	vector<uint8_t> gz = gzipMember(data);
+	gz.resize(gz.size() / 2);
+	FILE *const file = writeTempFile(gz);
+	ASSERT_TRUE(file != nullptr);
+
+	GzReader gzr(file);
+	ASSERT_TRUE(gzr.isOpen());
+	const vector<uint8_t> out = readAll(gzr);
+	EXPECT_GT(out.size(), 0U);
+	EXPECT_LT(out.size(), data.size());
+	EXPECT_EQ(0, memcmp(data.data(), out.data(), out.size()));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpFile test suite: GzReader tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,309 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpfile/tests)                  *
+ * RpFileTest.cpp: RpFile memory mapping test.                             *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+
+// librpfile
+#include "librpfile/config.librpfile.h"
+#include "../RpFile.hpp"
+
+// zlib
+#include <zlib.h>
+
+// C includes.
+#include <stdint.h>
+#ifdef _WIN32
+# include <io.h>
+#else /* !_WIN32 */
+# include <unistd.h>
+#endif /* _WIN32 */
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRpFile { namespace Tests {
+
+class RpFileTest : public ::testing::Test
+{
+	protected:
+		RpFileTest()
+			: m_file(nullptr)
+		{ }
+
+		void SetUp(void) final
+		{
+			// Create compressible test data.
+			m_data.resize(TEST_FILE_SIZE);
+			uint32_t seed = 0x12345678;
+			for (size_t i = 0; i < m_data.size(); i++) {
+				seed = seed * 1103515245 + 12345;
+				m_data[i] = static_cast<uint8_t>((seed >> 24) & 0x0F);
+			}
+
+			m_filename = makeTempFilename();
+			ASSERT_FALSE(m_filename.empty());
+		}
+
+		void TearDown(void) final
+		{
+			if (m_file) {
+				m_file->unref();
+				m_file = nullptr;
+			}
+			if (!m_filename.empty()) {
+				remove(m_filename.c_str());
+			}
+		}
+
+	public:
+		// Test file size. (not a multiple of the page size)
+		static const size_t TEST_FILE_SIZE = 256*1024 + 123;
+
+		/**
+		 * Get a temporary filename.
+		 * The file is created, but it's empty.
+		 * @return Temporary filename, or empty string on error.
+		 */
+		static string makeTempFilename(void)
+		{
+#ifdef _WIN32
+			char *const name = _tempnam(nullptr, "rpf");
+			if (!name)
+				return string();
+			string filename(name);
+			free(name);
+			FILE *const f = fopen(filename.c_str(), "wb");
+			if (!f)
+				return string();
+			fclose(f);
+			return filename;
+#else /* !_WIN32 */
+			char buf[] = "/tmp/RpFileTest.XXXXXX";
+			const int fd = mkstemp(buf);
+			if (fd < 0)
+				return string();
+			close(fd);
+			return string(buf);
+#endif /* _WIN32 */
+		}
+
+		/**
+		 * Write data to the temporary file.
+		 * @param data Data.
+		 */
+		void writeFile(const vector<uint8_t> &data)
+		{
+			FILE *const f = fopen(m_filename.c_str(), "wb");
+			ASSERT_TRUE(f != nullptr);
+			if (!data.empty()) {
+				EXPECT_EQ(1U, fwrite(data.data(), data.size(), 1, f));
+			}
+			fclose(f);
+		}
+
+		/**
+		 * Write gzipped data to the temporary file.
+		 * @param data Uncompressed data.
+		 */
+		void writeGzFile(const vector<uint8_t> &data)
+		{
+			gzFile gzf = gzopen(m_filename.c_str(), "wb");
+			ASSERT_TRUE(gzf != nullptr);
+			EXPECT_EQ(static_cast<int>(data.size()),
+				gzwrite(gzf, data.data(), static_cast<unsigned int>(data.size())));
+			gzclose(gzf);
+		}
+
+		/**
+		 * Open the temporary file.
+		 * @param mode File mode.
+		 */
+		void openFile(RpFile::FileMode mode)
+		{
+			ASSERT_TRUE(m_file == nullptr);
+			m_file = new RpFile(m_filename, mode);
+			ASSERT_TRUE(m_file->isOpen());
+		}
+
+		/**
+		 * Read the file at various positions and compare it to the test data.
+		 */
+		void checkReads(void)
+		{
+			ASSERT_EQ(static_cast<off64_t>(m_data.size()), m_file->size());
+
+			// Sequential reads of odd sizes.
+			vector<uint8_t> buf(4099);
+			ASSERT_EQ(0, m_file->seek(0));
+			size_t pos = 0;
+			while (pos < m_data.size()) {
+				const size_t expected = std::min(buf.size(), m_data.size() - pos);
+				ASSERT_EQ(expected, m_file->read(buf.data(), buf.size())) << "pos == " << pos;
+				ASSERT_EQ(0, memcmp(buf.data(), m_data.data() + pos, expected)) << "pos == " << pos;
+				pos += expected;
+				ASSERT_EQ(static_cast<off64_t>(pos), m_file->tell());
+			}
+
+			// Reading at EOF returns 0 bytes.
+			EXPECT_EQ(0U, m_file->read(buf.data(), buf.size()));
+
+			// Random access, including backwards seeks.
+			static const size_t offsets[] = {
+				200*1024, 5, 4095, 4096, 128*1024, TEST_FILE_SIZE - 10, 0,
+			};
+			for (size_t offset : offsets) {
+				uint8_t small[16];
+				const size_t expected = std::min(sizeof(small), m_data.size() - offset);
+				ASSERT_EQ(expected, m_file->seekAndRead(static_cast<off64_t>(offset), small, sizeof(small)))
+					<< "offset == " << offset;
+				EXPECT_EQ(0, memcmp(small, m_data.data() + offset, expected)) << "offset == " << offset;
+			}
+		}
+
+	public:
+		vector<uint8_t> m_data;	// Test data.
+		string m_filename;	// Temporary filename.
+		RpFile *m_file;		// Open file.
+};
+
+#ifdef HAVE_MMAP
+/**
+ * Read a memory-mapped file.
+ */
+TEST_F(RpFileTest, mappedRead)
+{
+	writeFile(m_data);
+	openFile(RpFile::FM_OPEN_READ_MMAP);
+
+	// The whole file should be available.
+	const uint8_t *const p = m_file->dataPtr(0, m_data.size());
+	ASSERT_TRUE(p != nullptr) << "File was not memory-mapped.";
+	EXPECT_EQ(0, memcmp(p, m_data.data(), m_data.size()));
+
+	// dataPtr() doesn't change the file position.
+	EXPECT_EQ(0, m_file->tell());
+
+	checkReads();
+}
+
+/**
+ * dataPtr() bounds checking.
+ */
+TEST_F(RpFileTest, mappedDataPtrBounds)
+{
+	writeFile(m_data);
+	openFile(RpFile::FM_OPEN_READ_MMAP);
+	const off64_t fileSize = static_cast<off64_t>(m_data.size());
+
+	const uint8_t *const p = m_file->dataPtr(0, 1);
+	ASSERT_TRUE(p != nullptr) << "File was not memory-mapped.";
+
+	// Ranges inside of the file.
+	EXPECT_EQ(p + 100, m_file->dataPtr(100, 200));
+	EXPECT_EQ(p + m_data.size() - 1, m_file->dataPtr(fileSize - 1, 1));
+	EXPECT_EQ(p + m_data.size(), m_file->dataPtr(fileSize, 0));
+
+	// Ranges outside of the file.
+	EXPECT_TRUE(m_file->dataPtr(fileSize - 1, 2) == nullptr);
+	EXPECT_TRUE(m_file->dataPtr(fileSize, 1) == nullptr);
+	EXPECT_TRUE(m_file->dataPtr(fileSize + 1, 0) == nullptr);
+	EXPECT_TRUE(m_file->dataPtr(-1, 1) == nullptr);
+	EXPECT_TRUE(m_file->dataPtr(1, SIZE_MAX) == nullptr);
+	EXPECT_TRUE(m_file->dataPtr(INT64_MAX, 1) == nullptr);
+
+	// Closing the file unmaps it.
+	m_file->close();
+	EXPECT_TRUE(m_file->dataPtr(0, 1) == nullptr);
+}
+
+/**
+ * Gzipped files are decompressed instead of being mapped.
+ */
+TEST_F(RpFileTest, mappedGzip)
+{
+	writeGzFile(m_data);
+	openFile(RpFile::FM_OPEN_READ_GZ_MMAP);
+	EXPECT_TRUE(m_file->dataPtr(0, 1) == nullptr);
+	checkReads();
+}
+
+/**
+ * Empty files can't be mapped.
+ */
+TEST_F(RpFileTest, mappedEmptyFile)
+{
+	writeFile(vector<uint8_t>());
+	openFile(RpFile::FM_OPEN_READ_MMAP);
+	EXPECT_TRUE(m_file->dataPtr(0, 0) == nullptr);
+	EXPECT_EQ(0, m_file->size());
+
+	uint8_t buf[16];
+	EXPECT_EQ(0U, m_file->read(buf, sizeof(buf)));
+}
+#endif /* HAVE_MMAP */
+
+/**
+ * Files are only mapped if FM_MMAP is specified.
+ * Otherwise, stdio is used.
+ */
+TEST_F(RpFileTest, stdioRead)
+{
+	writeFile(m_data);
+	openFile(RpFile::FM_OPEN_READ);
+	EXPECT_TRUE(m_file->dataPtr(0, 1) == nullptr);
+	checkReads();
+}
+
+/**
+ * Gzipped files without FM_MMAP.
+ */
+TEST_F(RpFileTest, stdioGzip)
+{
+	writeGzFile(m_data);
+	openFile(RpFile::FM_OPEN_READ_GZ);
+	EXPECT_TRUE(m_file->dataPtr(0, 1) == nullptr);
+	checkReads();
+}
+
+/**
+ * Writable files are never mapped.
+ */
+TEST_F(RpFileTest, stdioWritable)
+{
+	writeFile(m_data);
+	openFile(static_cast<RpFile::FileMode>(RpFile::FM_OPEN_WRITE | RpFile::FM_MMAP));
+	EXPECT_TRUE(m_file->dataPtr(0, 1) == nullptr);
+	checkReads();
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpFile test suite: RpFile tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -315,7 +315,7 @@ void RpFile::init(void)
 	// Check if this is a gzipped file.
 	// If it is, use transparent decompression.
 	// Reference: https://www.forensicswiki.org/wiki/Gzip
-	if (!d->devInfo && d->mode == FM_OPEN_READ_GZ) {
+	if (!d->devInfo && (d->mode & (FM_MODE_MASK | FM_GZIP_DECOMPRESS)) == FM_OPEN_READ_GZ) {
 #if defined(_MSC_VER) && defined(ZLIB_IS_DLL)
 		// Delay load verification.
 		// TODO: Only if linked with /DELAYLOAD?
@@ -661,6 +661,28 @@ int RpFile::truncate(off64_t size)
 	return 0;
 }
 
+/**
+ * Get a pointer to the file's data without copying it.
+ *
+ * This is only supported for regular files that were opened
+ * read-only and are memory-mapped.
+ *
+ * NOTE: The file position is not changed.
+ * The returned pointer is valid until the file is closed.
+ *
+ * @param pos	[in] Starting position.
+ * @param size	[in] Number of bytes.
+ * @return Pointer to the data, or nullptr if not available or out of range.
+ */
+const uint8_t *RpFile::dataPtr(off64_t pos, size_t size)
+{
+	// NOTE: Memory mapping is not implemented on Windows.
+	// FM_MMAP is ignored, so files are never mapped.
+	RP_UNUSED(pos);
+	RP_UNUSED(size);
+	return nullptr;
+}
+
 /** File properties **/
 
 /**
@@ -86,6 +86,17 @@ int rp_secure_enable(rp_secure_param_t param)
 	seccomp_rule_add_array(ctx, SCMP_ACT_ALLOW, SCMP_SYS(tgkill), 0, NULL);
 #endif /* NDEBUG */
 
+	// Thread support. glibc uses these syscalls when creating
+	// and destroying threads, so they're allowed in all filters.
+	// NOTE: clone() must be allowed by the whitelist. (see below)
+	seccomp_rule_add_array(ctx, SCMP_ACT_ALLOW, SCMP_SYS(madvise), 0, NULL);	// freeing thread stacks
+	seccomp_rule_add_array(ctx, SCMP_ACT_ALLOW, SCMP_SYS(set_robust_list), 0, NULL);
+#if defined(__SNR_rseq)
+	seccomp_rule_add_array(ctx, SCMP_ACT_ALLOW, SCMP_SYS(rseq), 0, NULL);	// glibc-2.35
+#elif defined(__NR_rseq)
+	seccomp_rule_add_array(ctx, SCMP_ACT_ALLOW, __NR_rseq, 0, NULL);	// glibc-2.35
+#endif /* __SNR_rseq || __NR_rseq */
+
 	// NOTE: If clone() is wanted, it should be the first syscall in the list.
 	const int *p = param.syscall_wl;
 	if (*p == SCMP_SYS(clone)) {
@@ -100,6 +111,16 @@ int rp_secure_enable(rp_secure_param_t param)
 		p++;
 	}
 
+	// clone3() syscall. The flags are passed in a struct, so they
+	// can't be checked here. Return ENOSYS so glibc-2.34 and later
+	// will fall back to clone(), which is either restricted to
+	// threads above or allowed by the whitelist.
+#if defined(__SNR_clone3)
+	seccomp_rule_add_array(ctx, SCMP_ACT_ERRNO(ENOSYS), SCMP_SYS(clone3), 0, NULL);
+#elif defined(__NR_clone3)
+	seccomp_rule_add_array(ctx, SCMP_ACT_ERRNO(ENOSYS), __NR_clone3, 0, NULL);
+#endif /* __SNR_clone3 || __NR_clone3 */
+
 	// Add syscalls from the whitelist.
 	// TODO: More extensive syscall parameters?
 	for (; *p != -1; p++) {
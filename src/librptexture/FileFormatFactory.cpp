@@ -197,6 +197,78 @@ FileFormat *FileFormatFactory::create(IRpFile *file)
 	return nullptr;
 }
 
+/**
+ * Detect a texture file's format using its header,
+ * without creating a FileFormat object.
+ *
+ * NOTE: Only the magic number is checked, so a texture
+ * detected here may still be rejected by create().
+ *
+ * @param pHeader	[in] File header, starting at address 0.
+ * @param size		[in] Size of pHeader.
+ * @param pMimeTypes	[out,opt] MIME types supported by the matching FileFormat subclass.
+ * @param pExts		[out,opt] File extensions supported by the matching FileFormat subclass.
+ * @return True if a FileFormat subclass has a matching magic number; false if not.
+ */
+bool FileFormatFactory::detect(const uint8_t *pHeader, size_t size,
+	const char *const **pMimeTypes, const char *const **pExts)
+{
+	assert(pHeader != nullptr);
+	if (!pHeader || size < sizeof(uint32_t)*2) {
+		// Header is too small.
+		return false;
+	}
+
+	uint32_t magic[2];
+	memcpy(magic, pHeader, sizeof(magic));
+
+	const char *const *mimeTypes = nullptr;
+	const char *const *exts = nullptr;
+
+	// Special check for Khronos KTX, which has the same
+	// 32-bit magic number for two completely different versions.
+	if (magic[0] == cpu_to_be32('\xABKTX')) {
+		if (magic[1] == cpu_to_be32(' 11\xBB')) {
+			// KTX 1.1
+			mimeTypes = KhronosKTX::supportedMimeTypes_static();
+			exts = KhronosKTX::supportedFileExtensions_static();
+		} else if (magic[1] == cpu_to_be32(' 20\xBB')) {
+			// KTX 2.0
+			mimeTypes = KhronosKTX2::supportedMimeTypes_static();
+			exts = KhronosKTX2::supportedFileExtensions_static();
+		}
+	}
+
+	if (!exts) {
+		// Check FileFormat subclasses that take a header at 0
+		// and definitely have a 32-bit magic number at address 0.
+		const uint32_t magic0 = be32_to_cpu(magic[0]);
+		const FileFormatFactoryPrivate::FileFormatFns *fns =
+			&FileFormatFactoryPrivate::FileFormatFns_magic[0];
+		for (; fns->supportedFileExtensions != nullptr; fns++) {
+			if (magic0 == fns->magic) {
+				// Found a matching magic number.
+				mimeTypes = fns->supportedMimeTypes();
+				exts = fns->supportedFileExtensions();
+				break;
+			}
+		}
+	}
+
+	if (!exts) {
+		// Not supported.
+		return false;
+	}
+
+	if (pMimeTypes) {
+		*pMimeTypes = mimeTypes;
+	}
+	if (pExts) {
+		*pExts = exts;
+	}
+	return true;
+}
+
 /**
  * Get all supported file extensions.
  * Used for Win32 COM registration.
@@ -47,6 +47,22 @@ class FileFormatFactory
 		 */
 		static LibRpTexture::FileFormat *create(LibRpFile::IRpFile *file);
 
+		/**
+		 * Detect a texture file's format using its header,
+		 * without creating a FileFormat object.
+		 *
+		 * NOTE: Only the magic number is checked, so a texture
+		 * detected here may still be rejected by create().
+		 *
+		 * @param pHeader	[in] File header, starting at address 0.
+		 * @param size		[in] Size of pHeader.
+		 * @param pMimeTypes	[out,opt] MIME types supported by the matching FileFormat subclass.
+		 * @param pExts		[out,opt] File extensions supported by the matching FileFormat subclass.
+		 * @return True if a FileFormat subclass has a matching magic number; false if not.
+		 */
+		static bool detect(const uint8_t *pHeader, size_t size,
+			const char *const **pMimeTypes, const char *const **pExts);
+
 		/**
 		 * Get all supported file extensions.
 		 * Used for Win32 COM registration.
@@ -134,6 +134,19 @@ enum PixelFormat {
 #endif
 };
 
+/**
+ * Shut down the shared decoder thread pool.
+ *
+ * The worker threads are stopped and joined. If an image is
+ * decoded afterwards, a new thread pool will be started.
+ *
+ * This must NOT be called from a global destructor or from
+ * DllMain(), since joining threads there may deadlock.
+ *
+ * @return True if the pool was shut down or wasn't running; false if it's in use.
+ */
+bool shutdownThreadPool(void);
+
 /**
  * Convert a linear CI4 image to rp_image with a little-endian 16-bit palette.
  * @param px_format Palette pixel format.
@@ -440,6 +453,22 @@ rp_image *fromDXT1_GCN(int width, int height,
 /**
  * Convert a DXT1 image to rp_image.
  * S3TC palette index 3 will be interpreted as black.
+ * Standard version using regular C++ code.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT1_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as black.
+ * SSSE3-optimized version.
  *
  * @param width Image width.
  * @param height Image height.
@@ -447,12 +476,27 @@ rp_image *fromDXT1_GCN(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT1(int width, int height,
+rp_image *fromDXT1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as black.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *fromDXT1(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
 /**
  * Convert a DXT1 image to rp_image.
  * S3TC palette index 3 will be interpreted as fully transparent.
+ * Standard version using regular C++ code.
  *
  * @param width Image width.
  * @param height Image height.
@@ -460,7 +504,36 @@ rp_image *fromDXT1(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT1_A1(int width, int height,
+rp_image *fromDXT1_A1_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as fully transparent.
+ * SSSE3-optimized version.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT1_A1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as fully transparent.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *fromDXT1_A1(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
 /**
@@ -476,13 +549,39 @@ rp_image *fromDXT2(int width, int height,
 
 /**
  * Convert a DXT3 image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf DXT3 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT3(int width, int height,
+rp_image *fromDXT3_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a DXT3 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT3 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT3_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Convert a DXT3 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT3 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *fromDXT3(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
 /**
@@ -496,6 +595,32 @@ rp_image *fromDXT3(int width, int height,
 rp_image *fromDXT4(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
+/**
+ * Convert a DXT5 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT5 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT5_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a DXT5 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT5 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT5_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
 /**
  * Convert a DXT5 image to rp_image.
  * @param width Image width.
@@ -504,12 +629,13 @@ rp_image *fromDXT4(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT5(int width, int height,
+IFUNC_STATIC_INLINE rp_image *fromDXT5(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
 /**
  * Convert a BC4 (ATI1) image to rp_image.
  * Color component is Red.
+ * Standard version using regular C++ code.
  *
  * @param width Image width.
  * @param height Image height.
@@ -517,9 +643,68 @@ rp_image *fromDXT5(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC4(int width, int height,
+rp_image *fromBC4_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a BC4 (ATI1) image to rp_image.
+ * Color component is Red.
+ * SSSE3-optimized version.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC4 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC4_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Convert a BC4 (ATI1) image to rp_image.
+ * Color component is Red.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC4 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *fromBC4(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert a BC5 (ATI2) image to rp_image.
+ * Color components are Red and Green.
+ * Standard version using regular C++ code.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC4 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC5_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert a BC5 (ATI2) image to rp_image.
+ * Color components are Red and Green.
+ * SSSE3-optimized version.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC4 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC5_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
 /**
  * Convert a BC5 (ATI2) image to rp_image.
  * Color components are Red and Green.
@@ -530,7 +715,7 @@ rp_image *fromBC4(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC5(int width, int height,
+IFUNC_STATIC_INLINE rp_image *fromBC5(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
 /**
@@ -625,6 +810,32 @@ static inline int calcDreamcastSmallVQPaletteEntries_WithMipmaps(int width)
 
 /* ETC1 */
 
+/**
+ * Convert an ETC1 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC1_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert an ETC1 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
 /**
  * Convert an ETC1 image to rp_image.
  * @param width Image width.
@@ -633,40 +844,118 @@ static inline int calcDreamcastSmallVQPaletteEntries_WithMipmaps(int width)
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromETC1(int width, int height,
+IFUNC_STATIC_INLINE rp_image *fromETC1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGB_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
+#ifdef IMAGEDECODER_HAS_SSSE3
 /**
  * Convert an ETC2 RGB image to rp_image.
+ * SSSE3-optimized version.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf ETC2 RGB image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromETC2_RGB(int width, int height,
+rp_image *fromETC2_RGB_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *fromETC2_RGB(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGBA_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
+#ifdef IMAGEDECODER_HAS_SSSE3
 /**
  * Convert an ETC2 RGBA image to rp_image.
+ * SSSE3-optimized version.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf ETC2 RGBA image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromETC2_RGBA(int width, int height,
+rp_image *fromETC2_RGBA_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *fromETC2_RGBA(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
 /**
  * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf ETC2 RGB+A1 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromETC2_RGB_A1(int width, int height,
+rp_image *fromETC2_RGB_A1_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGB_A1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *fromETC2_RGB_A1(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
 #ifdef ENABLE_PVRTC
@@ -713,6 +1002,32 @@ rp_image *fromPVRTCII(int width, int height,
 
 /* BC7 */
 
+/**
+ * Convert a BC7 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_cpp(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSE2
+/**
+ * Convert a BC7 image to rp_image.
+ * SSE2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_sse2(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
 /**
  * Convert a BC7 image to rp_image.
  * @param width Image width.
@@ -721,7 +1036,7 @@ rp_image *fromPVRTCII(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC7(int width, int height,
+IFUNC_SSE2_STATIC_INLINE rp_image *fromBC7(int width, int height,
 	const uint8_t *img_buf, int img_siz);
 
 /*************************
@@ -751,6 +1066,21 @@ static inline rp_image *fromLinear16(PixelFormat px_format,
 	return fromLinear16_sse2(px_format, width, height, img_buf, img_siz, stride);
 }
 
+/**
+ * Convert a BC7 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromBC7(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+	// amd64 always has SSE2.
+	return fromBC7_sse2(width, height, img_buf, img_siz);
+}
+
 #endif /* defined(RP_HAS_IFUNC) && defined(IMAGEDECODER_ALWAYS_HAS_SSE2) */
 
 #if !defined(RP_HAS_IFUNC) || (!defined(RP_CPU_I386) && !defined(RP_CPU_AMD64))
@@ -835,6 +1165,250 @@ static rp_image *fromLinear32(PixelFormat px_format,
 	}
 }
 
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as black.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromDXT1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromDXT1_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromDXT1_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as fully transparent.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromDXT1_A1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromDXT1_A1_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromDXT1_A1_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert a DXT3 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT3 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromDXT3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromDXT3_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromDXT3_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert a DXT5 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT5 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromDXT5(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromDXT5_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromDXT5_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert a BC4 (ATI1) image to rp_image.
+ * Color component is Red.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC4 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromBC4(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromBC4_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromBC4_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert a BC5 (ATI2) image to rp_image.
+ * Color components are Red and Green.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC4 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromBC5(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromBC5_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromBC5_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an ETC1 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromETC1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromETC1_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromETC1_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromETC2_RGB(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromETC2_RGB_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromETC2_RGB_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromETC2_RGBA(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromETC2_RGBA_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromETC2_RGBA_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromETC2_RGB_A1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return fromETC2_RGB_A1_ssse3(width, height, img_buf, img_siz);
+	} else
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+	{
+		return fromETC2_RGB_A1_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert a BC7 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+static inline rp_image *fromBC7(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+#ifdef IMAGEDECODER_ALWAYS_HAS_SSE2
+	// amd64 always has SSE2.
+	return fromBC7_sse2(width, height, img_buf, img_siz);
+#else /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
+# ifdef IMAGEDECODER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return fromBC7_sse2(width, height, img_buf, img_siz);
+	} else
+# endif /* IMAGEDECODER_HAS_SSE2 */
+	{
+		return fromBC7_cpp(width, height, img_buf, img_siz);
+	}
+#endif /* IMAGEDECODER_ALWAYS_HAS_SSE2 */
+}
+
 #endif /* !defined(RP_HAS_IFUNC) || (!defined(RP_CPU_I386) && !defined(RP_CPU_AMD64)) */
 
 } }
@@ -0,0 +1,47 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_BC7_p.hpp: Image decoding functions. (BC7) (PRIVATE)       *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__
+
+#include "common.h"
+#include "../img/rp_image.hpp"
+
+// C includes.
+#include <stdint.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Decoded BC7 block.
+ *
+ * Each texel has its own pair of endpoints and interpolation weights,
+ * with the partition subsets, index selection, and component rotation
+ * already applied. Each component is calculated as:
+ *
+ *   ((64 - wt) * ep0 + (wt * ep1) + 32) >> 6
+ *
+ * This allows the interpolation step to be done with SIMD.
+ */
+struct bc7_texels {
+	argb32_t ep0[16];	// Endpoint 0
+	argb32_t ep1[16];	// Endpoint 1
+	argb32_t wt[16];	// Interpolation weights [0,64]
+};
+
+/**
+ * Decode a BC7 block's endpoints and weights.
+ * @param texels	[out] Decoded block.
+ * @param bc7_src	[in] BC7 block. (128-bit little-endian)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int decodeBlock_BC7(bc7_texels *RESTRICT texels, const uint64_t *RESTRICT bc7_src);
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__ */
@@ -0,0 +1,155 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_BC7.cpp: Image decoding functions. (BC7)                   *
+ * SSE2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
+#include "ImageDecoder_BC7_p.hpp"
+
+// SSE2 headers.
+#include <emmintrin.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Interpolate four ARGB32 texels.
+ * @param ep0 Endpoint 0.
+ * @param ep1 Endpoint 1.
+ * @param wt Interpolation weights. [0,64]
+ * @return Interpolated texels.
+ */
+static FORCEINLINE __m128i interpolate_texels_sse2(__m128i ep0, __m128i ep1, __m128i wt)
+{
+	// ((64 - wt) * ep0 + (wt * ep1) + 32) >> 6
+	// Maximum intermediate value is 255*64 + 32, which fits in 16 bits.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c64 = _mm_set1_epi16(64);
+	const __m128i c32 = _mm_set1_epi16(32);
+
+	const __m128i wt_lo = _mm_unpacklo_epi8(wt, zero);
+	const __m128i wt_hi = _mm_unpackhi_epi8(wt, zero);
+
+	__m128i lo = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpacklo_epi8(ep0, zero), _mm_sub_epi16(c64, wt_lo)),
+		_mm_mullo_epi16(_mm_unpacklo_epi8(ep1, zero), wt_lo));
+	__m128i hi = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpackhi_epi8(ep0, zero), _mm_sub_epi16(c64, wt_hi)),
+		_mm_mullo_epi16(_mm_unpackhi_epi8(ep1, zero), wt_hi));
+	lo = _mm_srli_epi16(_mm_add_epi16(lo, c32), 6);
+	hi = _mm_srli_epi16(_mm_add_epi16(hi, c32), 6);
+	return _mm_packus_epi16(lo, hi);
+}
+
+/**
+ * Convert a BC7 image to rp_image.
+ * SSE2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_sse2(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+	// Verify parameters.
+	assert(img_buf != nullptr);
+	assert(width > 0);
+	assert(height > 0);
+
+	// BC7 uses 4x4 tiles, but some container formats allow
+	// the last tile to be cut off, so round up for the
+	// physical tile size.
+	const int physWidth = ALIGN_BYTES(4, width);
+	const int physHeight = ALIGN_BYTES(4, height);
+
+	assert(img_siz >= (width * height));
+	if (!img_buf || width <= 0 || height <= 0 ||
+	    img_siz < (physWidth * physHeight))
+	{
+		return nullptr;
+	}
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
+
+	// Create an rp_image.
+	// NOTE: Using the physical size, since entire tiles are written.
+	// The image will be shrunk afterwards if necessary.
+	rp_image *const img = new rp_image(physWidth, physHeight, rp_image::FORMAT_ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		delete img;
+		return nullptr;
+	}
+
+	// sBIT metadata.
+	// TODO: Dynamically determine if we have alpha?
+	// Rotation bits makes this difficult...
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,8};
+
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	// Set if an invalid block is found.
+	volatile bool invalidBlock = false;
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=, &invalidBlock](unsigned int y_start, unsigned int y_end)
+	{
+		const uint64_t *bc7_src = reinterpret_cast<const uint64_t*>(img_buf) + (y_start * tilesX * 2);
+		bc7_texels texels;
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, bc7_src += 2, dest += 4) {
+				if (decodeBlock_BC7(&texels, bc7_src) != 0) {
+					// Invalid block.
+					invalidBlock = true;
+					return;
+				}
+
+				// Interpolate the components, one tile row at a time.
+				// NOTE: rp_image rows are 16-byte aligned, and each tile
+				// row is 16 bytes, so aligned stores can be used here.
+				const __m128i *const ep0 = reinterpret_cast<const __m128i*>(texels.ep0);
+				const __m128i *const ep1 = reinterpret_cast<const __m128i*>(texels.ep1);
+				const __m128i *const wt  = reinterpret_cast<const __m128i*>(texels.wt);
+				uint32_t *px = dest;
+				for (unsigned int row = 0; row < 4; row++, px += stride_px) {
+					const __m128i argb = interpolate_texels_sse2(
+						_mm_loadu_si128(&ep0[row]),
+						_mm_loadu_si128(&ep1[row]),
+						_mm_loadu_si128(&wt[row]));
+					_mm_store_si128(reinterpret_cast<__m128i*>(px), argb);
+				}
+			}
+		}
+	});
+
+	if (invalidBlock) {
+		// Invalid block.
+		delete img;
+		return nullptr;
+	}
+
+	if (width < physWidth || height < physHeight) {
+		// Shrink the image.
+		img->shrink(width, height);
+	}
+
+	// Set the sBIT metadata.
+	img->set_sBIT(&sBIT);
+
+	// Image has been converted.
+	return img;
+}
+
+} }
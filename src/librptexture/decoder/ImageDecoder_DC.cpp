@@ -98,18 +98,25 @@ rp_image *fromDreamcastSquareTwiddled16(PixelFormat px_format,
 	}
 
 	// Convert one line at a time. (16-bit -> ARGB32)
-	uint32_t *px_dest = static_cast<uint32_t*>(img->bits());
-	const int dest_stride_adj = (img->stride() / sizeof(uint32_t)) - img->width();
+	// NOTE: Each line can be converted independently,
+	// so lines are used as the "tile rows" here.
+	const int stride_px = img->stride() / sizeof(uint32_t);
+	const int dest_stride_adj = stride_px - img->width();
 	switch (px_format) {
 		case PXF_ARGB1555: {
-			for (unsigned int y = 0; y < static_cast<unsigned int>(height); y++) {
-				for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
-					const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
-					*px_dest = ARGB1555_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
-					px_dest++;
+			ImageDecoderPrivate::decodeTileRows(height, width * height,
+				[=](unsigned int y_start, unsigned int y_end)
+			{
+				uint32_t *px_dest = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px);
+				for (unsigned int y = y_start; y < y_end; y++) {
+					for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
+						const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
+						*px_dest = ARGB1555_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
+						px_dest++;
+					}
+					px_dest += dest_stride_adj;
 				}
-				px_dest += dest_stride_adj;
-			}
+			});
 			// Set the sBIT metadata.
 			static const rp_image::sBIT_t sBIT = {5,5,5,0,1};
 			img->set_sBIT(&sBIT);
@@ -117,14 +124,19 @@ rp_image *fromDreamcastSquareTwiddled16(PixelFormat px_format,
 		}
 
 		case PXF_RGB565: {
-			for (unsigned int y = 0; y < static_cast<unsigned int>(height); y++) {
-				for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
-					const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
-					*px_dest = RGB565_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
-					px_dest++;
+			ImageDecoderPrivate::decodeTileRows(height, width * height,
+				[=](unsigned int y_start, unsigned int y_end)
+			{
+				uint32_t *px_dest = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px);
+				for (unsigned int y = y_start; y < y_end; y++) {
+					for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
+						const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
+						*px_dest = RGB565_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
+						px_dest++;
+					}
+					px_dest += dest_stride_adj;
 				}
-				px_dest += dest_stride_adj;
-			}
+			});
 			// Set the sBIT metadata.
 			static const rp_image::sBIT_t sBIT = {5,6,5,0,0};
 			img->set_sBIT(&sBIT);
@@ -132,14 +144,19 @@ rp_image *fromDreamcastSquareTwiddled16(PixelFormat px_format,
 		}
 
 		case PXF_ARGB4444: {
-			for (unsigned int y = 0; y < static_cast<unsigned int>(height); y++) {
-				for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
-					const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
-					*px_dest = ARGB4444_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
-					px_dest++;
+			ImageDecoderPrivate::decodeTileRows(height, width * height,
+				[=](unsigned int y_start, unsigned int y_end)
+			{
+				uint32_t *px_dest = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px);
+				for (unsigned int y = y_start; y < y_end; y++) {
+					for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
+						const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
+						*px_dest = ARGB4444_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
+						px_dest++;
+					}
+					px_dest += dest_stride_adj;
 				}
-				px_dest += dest_stride_adj;
-			}
+			});
 			// Set the sBIT metadata.
 			static const rp_image::sBIT_t sBIT = {4,4,4,0,4};
 			img->set_sBIT(&sBIT);
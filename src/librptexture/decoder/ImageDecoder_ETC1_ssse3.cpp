@@ -0,0 +1,441 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_ETC1.cpp: Image decoding functions. (ETC1)                 *
+ * SSSE3-optimized version.                                                *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
+#include "ImageDecoder_ETC1_p.hpp"
+
+// SSSE3 headers.
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+// ETC1 individual and differential blocks are decoded by building
+// a 4-color palette for each subblock using saturated arithmetic,
+// then looking up each row of pixels using pshufb.
+// ETC2 'T', 'H', and 'Planar' blocks use the standard C++ code.
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Build an ETC1 subblock palette.
+ * @param xrgb	[in] Base color. (xRGB32, alpha == 0xFF)
+ * @param a	[in] Small intensity modifier.
+ * @param b	[in] Large intensity modifier.
+ * @return Four ARGB32 colors: base+a, base+b, base-a, base-b (clamped)
+ */
+static FORCEINLINE __m128i etc1_subblock_palette(uint32_t xrgb, unsigned int a, unsigned int b)
+{
+	const __m128i ab = _mm_cvtsi32_si128(static_cast<int>(a | (b << 8)));
+	const __m128i add = _mm_shuffle_epi8(ab, _mm_setr_epi8(
+		0,0,0,-128, 1,1,1,-128, -128,-128,-128,-128, -128,-128,-128,-128));
+	const __m128i sub = _mm_shuffle_epi8(ab, _mm_setr_epi8(
+		-128,-128,-128,-128, -128,-128,-128,-128, 0,0,0,-128, 1,1,1,-128));
+	const __m128i base = _mm_set1_epi32(static_cast<int>(xrgb));
+	return _mm_subs_epu8(_mm_adds_epu8(base, add), sub);
+}
+
+/**
+ * Get the ETC1 pixel indexes in row-major order.
+ * @param etc1_src ETC1 block.
+ * @return 16 bytes: pixel i == index * 4
+ */
+static FORCEINLINE __m128i decode_ETC1_indexes_ssse3(const etc1_block *RESTRICT etc1_src)
+{
+	const __m128i blk = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(etc1_src));
+
+	// ETC1 arranges pixels by column, then by row.
+	// Row-major pixel (4*y + x) is ETC1 pixel (4*x + y).
+	// The index bitfields are big-endian, so pixels 0-7 are in
+	// the second byte, and pixels 8-15 are in the first byte.
+	const __m128i msb_shuf = _mm_setr_epi8(5,5,4,4, 5,5,4,4, 5,5,4,4, 5,5,4,4);
+	const __m128i lsb_shuf = _mm_setr_epi8(7,7,6,6, 7,7,6,6, 7,7,6,6, 7,7,6,6);
+	const __m128i bitsel = _mm_setr_epi8(
+		1, 16, 1, 16,
+		2, 32, 2, 32,
+		4, 64, 4, 64,
+		8, -128, 8, -128);
+
+	const __m128i msb = _mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(blk, msb_shuf), bitsel), bitsel);
+	const __m128i lsb = _mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(blk, lsb_shuf), bitsel), bitsel);
+
+	// Index == (msb << 1) | lsb; multiplied by 4 for the palette lookup.
+	return _mm_or_si128(
+		_mm_and_si128(msb, _mm_set1_epi8(8)),
+		_mm_and_si128(lsb, _mm_set1_epi8(4)));
+}
+
+/**
+ * Get the palette shuffle mask for a row of four ARGB32 pixels.
+ * @tparam row Row number.
+ * @param idx Palette byte offsets from decode_ETC1_indexes_ssse3().
+ * @return Shuffle mask.
+ */
+template<unsigned int row>
+static FORCEINLINE __m128i row_shuffle_mask(__m128i idx)
+{
+	const __m128i shuf = _mm_setr_epi8(
+		row*4+0, row*4+0, row*4+0, row*4+0,
+		row*4+1, row*4+1, row*4+1, row*4+1,
+		row*4+2, row*4+2, row*4+2, row*4+2,
+		row*4+3, row*4+3, row*4+3, row*4+3);
+	return _mm_or_si128(_mm_shuffle_epi8(idx, shuf), _mm_set1_epi32(0x03020100));
+}
+
+/**
+ * Decode an ETC1/ETC2 RGB block. (SSSE3 version)
+ * @tparam mode		[in] Mode flags.
+ * @param rows		[out] Tile rows.
+ * @param etc1_src	[in] Source RGB block.
+ */
+template</* ETC_Decoding_Mode */ unsigned int mode>
+static FORCEINLINE void decodeBlock_ETC_RGB_ssse3(__m128i rows[4], const etc1_block *RESTRICT etc1_src)
+{
+	// Base colors for the two subblocks. (xRGB32)
+	uint32_t base_color[2];
+
+	// control, bit 1: diffbit
+	// NOTE: If using punchthrough alpha, this is repurposed as the opaque bit.
+	// Hence, individual mode is unavailable.
+	if (!(mode & ETC2_DM_A1) && !(etc1_src->control & 0x02)) {
+		// Individual mode.
+		base_color[0] = 0xFF000000 |
+			(extend_4to8bits(etc1_src->id.R >> 4) << 16) |
+			(extend_4to8bits(etc1_src->id.G >> 4) <<  8) |
+			 extend_4to8bits(etc1_src->id.B >> 4);
+		base_color[1] = 0xFF000000 |
+			(extend_4to8bits(etc1_src->id.R & 0x0F) << 16) |
+			(extend_4to8bits(etc1_src->id.G & 0x0F) <<  8) |
+			 extend_4to8bits(etc1_src->id.B & 0x0F);
+	} else {
+		// Differential colors are 3-bit two's complement.
+		const int sR = (etc1_src->id.R >> 3) + etc1_3bit_diff_tbl[etc1_src->id.R & 0x07];
+		const int sG = (etc1_src->id.G >> 3) + etc1_3bit_diff_tbl[etc1_src->id.G & 0x07];
+		const int sB = (etc1_src->id.B >> 3) + etc1_3bit_diff_tbl[etc1_src->id.B & 0x07];
+
+		if ((mode & ETC_DM_MASK12) == ETC_DM_ETC2 && ((sR | sG | sB) & ~0x1F) != 0) {
+			// ETC2 'T', 'H', or 'Planar' mode.
+			// These modes are uncommon, so use the standard code.
+			ALIGNED_VAR(16, uint32_t tileBuf[4*4]);
+			decodeBlock_ETC_RGB<mode>(tileBuf, etc1_src);
+			const __m128i *const pTile = reinterpret_cast<const __m128i*>(tileBuf);
+			rows[0] = _mm_load_si128(&pTile[0]);
+			rows[1] = _mm_load_si128(&pTile[1]);
+			rows[2] = _mm_load_si128(&pTile[2]);
+			rows[3] = _mm_load_si128(&pTile[3]);
+			return;
+		}
+
+		// ETC1 differential mode.
+		base_color[0] = 0xFF000000 |
+			(extend_5to8bits(etc1_src->id.R >> 3) << 16) |
+			(extend_5to8bits(etc1_src->id.G >> 3) <<  8) |
+			 extend_5to8bits(etc1_src->id.B >> 3);
+		base_color[1] = 0xFF000000 |
+			(extend_5to8bits(sR) << 16) |
+			(extend_5to8bits(sG) <<  8) |
+			 extend_5to8bits(sB);
+	}
+
+	// Subblock palettes.
+	const int16_t *const tbl0 = etc1_intensity[ etc1_src->control >> 5];
+	const int16_t *const tbl1 = etc1_intensity[(etc1_src->control >> 2) & 0x07];
+	__m128i pal0, pal1;
+	if ((mode & ETC2_DM_A1) && !(etc1_src->control & 0x02)) {
+		// ETC2 punchthrough alpha: opaque bit is 0.
+		// Index 0 uses the base color, and index 2 is transparent.
+		const __m128i a1_mask = _mm_setr_epi32(-1, -1, 0, -1);
+		pal0 = _mm_and_si128(etc1_subblock_palette(base_color[0], 0, tbl0[1]), a1_mask);
+		pal1 = _mm_and_si128(etc1_subblock_palette(base_color[1], 0, tbl1[1]), a1_mask);
+	} else {
+		pal0 = etc1_subblock_palette(base_color[0], tbl0[0], tbl0[1]);
+		pal1 = etc1_subblock_palette(base_color[1], tbl1[0], tbl1[1]);
+	}
+
+	// Tile arrangement:
+	// flip == 0        flip == 1
+	// a e | i m        a e   i m
+	// b f | j n        b f   j n
+	//     |            ---------
+	// c g | k o        c g   k o
+	// d h | l p        d h   l p
+	const __m128i idx = decode_ETC1_indexes_ssse3(etc1_src);
+	if (etc1_src->control & 0x01) {
+		// flip == 1: Top two rows are subblock 0.
+		rows[0] = _mm_shuffle_epi8(pal0, row_shuffle_mask<0>(idx));
+		rows[1] = _mm_shuffle_epi8(pal0, row_shuffle_mask<1>(idx));
+		rows[2] = _mm_shuffle_epi8(pal1, row_shuffle_mask<2>(idx));
+		rows[3] = _mm_shuffle_epi8(pal1, row_shuffle_mask<3>(idx));
+	} else {
+		// flip == 0: Left two columns are subblock 0.
+		// Setting the high bit in the shuffle mask zeroes the byte,
+		// so each lookup only fills in its own half of the row.
+		const __m128i zero_right = _mm_setr_epi32(0, 0, -1, -1);
+		const __m128i zero_left  = _mm_setr_epi32(-1, -1, 0, 0);
+#define ETC1_ROW(row) do { \
+			const __m128i ctrl = row_shuffle_mask<row>(idx); \
+			rows[row] = _mm_or_si128( \
+				_mm_shuffle_epi8(pal0, _mm_or_si128(ctrl, zero_right)), \
+				_mm_shuffle_epi8(pal1, _mm_or_si128(ctrl, zero_left))); \
+		} while (0)
+		ETC1_ROW(0); ETC1_ROW(1); ETC1_ROW(2); ETC1_ROW(3);
+#undef ETC1_ROW
+	}
+}
+
+/**
+ * Decode an ETC2 alpha block. (SSSE3 version)
+ * @param alpha	[in] Source alpha block.
+ * @return 16 alpha values in row-major order.
+ */
+static FORCEINLINE __m128i decodeBlock_ETC2_alpha_ssse3(const etc2_alpha *RESTRICT alpha)
+{
+	// Alpha palette: base + (tbl * mult), clamped to [0,255].
+	// NOTE: mult == 0 is not allowed to be used by the encoder,
+	// but the specification requires decoders to handle it.
+	const __m128i tbl8 = _mm_loadl_epi64(
+		reinterpret_cast<const __m128i*>(etc2_alpha_tbl[alpha->mult_tbl_idx & 0x0F]));
+	const __m128i tbl16 = _mm_srai_epi16(_mm_unpacklo_epi8(tbl8, tbl8), 8);
+	__m128i pal = _mm_add_epi16(_mm_set1_epi16(alpha->base_codeword),
+		_mm_mullo_epi16(tbl16, _mm_set1_epi16(alpha->mult_tbl_idx >> 4)));
+	pal = _mm_packus_epi16(pal, pal);
+
+	// Get the 3-bit pixel indexes.
+	// The 48-bit index value is big-endian, and the first pixel is
+	// stored in the most significant bits. Each pixel's index is
+	// contained within a 16-bit window, which is then shifted
+	// into place using pmullw as a per-lane variable left shift.
+	// NOTE: Row-major pixel order, like decode_ETC1_indexes_ssse3().
+	const __m128i blk = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(alpha));
+	const __m128i shuf_lo = _mm_setr_epi8(2,1, 3,2, 5,4, 6,5, 2,1, 4,3, 5,4, 7,6);
+	const __m128i shuf_hi = _mm_setr_epi8(3,2, 4,3, 6,5, 7,6, 3,2, 4,3, 6,5, 7,6);
+	const __m128i mult_lo = _mm_setr_epi16(1<<8, 1<<12, 1<<8, 1<<12, 1<<11, 1<<7, 1<<11, 1<<7);
+	const __m128i mult_hi = _mm_setr_epi16(1<<6, 1<<10, 1<<6, 1<<10, 1<<9, 1<<13, 1<<9, 1<<13);
+	const __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(blk, shuf_lo), mult_lo), 13);
+	const __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(blk, shuf_hi), mult_hi), 13);
+
+	return _mm_shuffle_epi8(pal, _mm_packus_epi16(lo, hi));
+}
+
+/**
+ * Replace the alpha channel in a row of four ARGB32 pixels.
+ * @tparam row Row number.
+ * @param px Four ARGB32 pixels.
+ * @param alpha 16 alpha values in row-major order.
+ * @return Four ARGB32 pixels.
+ */
+template<unsigned int row>
+static FORCEINLINE __m128i apply_row_alpha(__m128i px, __m128i alpha)
+{
+	const __m128i shuf = _mm_setr_epi8(
+		-128, -128, -128, row*4+0,
+		-128, -128, -128, row*4+1,
+		-128, -128, -128, row*4+2,
+		-128, -128, -128, row*4+3);
+	return _mm_or_si128(_mm_and_si128(px, _mm_set1_epi32(0x00FFFFFF)),
+		_mm_shuffle_epi8(alpha, shuf));
+}
+
+/**
+ * Convert an ETC1/ETC2 RGB image to rp_image.
+ * @tparam mode Mode flags.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @param sBIT sBIT metadata.
+ * @return rp_image, or nullptr on error.
+ */
+template</* ETC_Decoding_Mode */ unsigned int mode>
+static rp_image *T_fromETC_RGB_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz,
+	const rp_image::sBIT_t *sBIT)
+{
+	// Verify parameters.
+	assert(img_buf != nullptr);
+	assert(width > 0);
+	assert(height > 0);
+	assert(img_siz >= ((width * height) / 2));
+	if (!img_buf || width <= 0 || height <= 0 ||
+	    img_siz < ((width * height) / 2))
+	{
+		return nullptr;
+	}
+
+	// ETC uses 4x4 tiles.
+	assert(width % 4 == 0);
+	assert(height % 4 == 0);
+	if (width % 4 != 0 || height % 4 != 0)
+		return nullptr;
+
+	// Create an rp_image.
+	rp_image *img = new rp_image(width, height, rp_image::FORMAT_ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		delete img;
+		return nullptr;
+	}
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const etc1_block *etc1_src = reinterpret_cast<const etc1_block*>(img_buf) + (y_start * tilesX);
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, etc1_src++, dest += 4) {
+				__m128i rows[4];
+				decodeBlock_ETC_RGB_ssse3<mode>(rows, etc1_src);
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest), rows[0]);
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px), rows[1]);
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px*2), rows[2]);
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px*3), rows[3]);
+			}
+		}
+	});
+
+	// Set the sBIT metadata.
+	img->set_sBIT(sBIT);
+
+	// Image has been converted.
+	return img;
+}
+
+/**
+ * Convert an ETC1 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,0};
+	return T_fromETC_RGB_ssse3<ETC_DM_ETC1>(width, height, img_buf, img_siz, &sBIT);
+}
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGB_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,0};
+	return T_fromETC_RGB_ssse3<ETC_DM_ETC2>(width, height, img_buf, img_siz, &sBIT);
+}
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGBA_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	// Verify parameters.
+	assert(img_buf != nullptr);
+	assert(width > 0);
+	assert(height > 0);
+	assert(img_siz >= (width * height));
+	if (!img_buf || width <= 0 || height <= 0 ||
+	    img_siz < (width * height))
+	{
+		return nullptr;
+	}
+
+	// ETC2 uses 4x4 tiles.
+	assert(width % 4 == 0);
+	assert(height % 4 == 0);
+	if (width % 4 != 0 || height % 4 != 0)
+		return nullptr;
+
+	// Create an rp_image.
+	rp_image *img = new rp_image(width, height, rp_image::FORMAT_ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		delete img;
+		return nullptr;
+	}
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const etc2_rgba_block *etc2_src = reinterpret_cast<const etc2_rgba_block*>(img_buf) + (y_start * tilesX);
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, etc2_src++, dest += 4) {
+				// Decode the ETC2 RGB block.
+				__m128i rows[4];
+				decodeBlock_ETC_RGB_ssse3<ETC_DM_ETC2>(rows, &etc2_src->etc1);
+
+				// Decode the ETC2 alpha block.
+				const __m128i alpha = decodeBlock_ETC2_alpha_ssse3(&etc2_src->alpha);
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest),
+					apply_row_alpha<0>(rows[0], alpha));
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px),
+					apply_row_alpha<1>(rows[1], alpha));
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px*2),
+					apply_row_alpha<2>(rows[2], alpha));
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px*3),
+					apply_row_alpha<3>(rows[3], alpha));
+			}
+		}
+	});
+
+	// Set the sBIT metadata.
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,8};
+	img->set_sBIT(&sBIT);
+
+	// Image has been converted.
+	return img;
+}
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGB_A1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,1};
+	return T_fromETC_RGB_ssse3<ETC_DM_ETC2 | ETC2_DM_A1>(width, height, img_buf, img_siz, &sBIT);
+}
+
+} }
@@ -57,24 +57,30 @@ rp_image *fromGcn16(PixelFormat px_format,
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
 	switch (px_format) {
 		case PXF_RGB5A3: {
-			for (unsigned int y = 0; y < tilesY; y++) {
-				for (unsigned int x = 0; x < tilesX; x++) {
-					// Convert each tile to ARGB32 manually.
-					// TODO: Optimize using pointers instead of indexes?
-					for (unsigned int i = 0; i < 4*4; i += 2, img_buf += 2) {
-						tileBuf[i+0] = RGB5A3_to_ARGB32(be16_to_cpu(img_buf[0]));
-						tileBuf[i+1] = RGB5A3_to_ARGB32(be16_to_cpu(img_buf[1]));
+			ImageDecoderPrivate::decodeTileRows(tilesY, width * height,
+				[=](unsigned int y_start, unsigned int y_end)
+			{
+				const uint16_t *src = img_buf + (y_start * tilesX * 4*4);
+
+				// Temporary tile buffer.
+				uint32_t tileBuf[4*4];
+
+				for (unsigned int y = y_start; y < y_end; y++) {
+					for (unsigned int x = 0; x < tilesX; x++) {
+						// Convert each tile to ARGB32 manually.
+						// TODO: Optimize using pointers instead of indexes?
+						for (unsigned int i = 0; i < 4*4; i += 2, src += 2) {
+							tileBuf[i+0] = RGB5A3_to_ARGB32(be16_to_cpu(src[0]));
+							tileBuf[i+1] = RGB5A3_to_ARGB32(be16_to_cpu(src[1]));
+						}
+
+						// Blit the tile to the main image buffer.
+						ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
 					}
-
-					// Blit the tile to the main image buffer.
-					ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
 				}
-			}
+			});
 			// Set the sBIT metadata.
 			// NOTE: Pixels may be RGB555 or ARGB4444.
 			// We'll use 555 for RGB, and 4 for alpha.
@@ -85,19 +91,28 @@ rp_image *fromGcn16(PixelFormat px_format,
 		}
 
 		case PXF_RGB565: {
-			for (unsigned int y = 0; y < tilesY; y++) {
-				for (unsigned int x = 0; x < tilesX; x++) {
-					// Convert each tile to ARGB32 manually.
-					// TODO: Optimize using pointers instead of indexes?
-					for (unsigned int i = 0; i < 4*4; i += 2, img_buf += 2) {
-						tileBuf[i+0] = RGB565_to_ARGB32(be16_to_cpu(img_buf[0]));
-						tileBuf[i+1] = RGB565_to_ARGB32(be16_to_cpu(img_buf[1]));
+			ImageDecoderPrivate::decodeTileRows(tilesY, width * height,
+				[=](unsigned int y_start, unsigned int y_end)
+			{
+				const uint16_t *src = img_buf + (y_start * tilesX * 4*4);
+
+				// Temporary tile buffer.
+				uint32_t tileBuf[4*4];
+
+				for (unsigned int y = y_start; y < y_end; y++) {
+					for (unsigned int x = 0; x < tilesX; x++) {
+						// Convert each tile to ARGB32 manually.
+						// TODO: Optimize using pointers instead of indexes?
+						for (unsigned int i = 0; i < 4*4; i += 2, src += 2) {
+							tileBuf[i+0] = RGB565_to_ARGB32(be16_to_cpu(src[0]));
+							tileBuf[i+1] = RGB565_to_ARGB32(be16_to_cpu(src[1]));
+						}
+
+						// Blit the tile to the main image buffer.
+						ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
 					}
-
-					// Blit the tile to the main image buffer.
-					ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
 				}
-			}
+			});
 			// Set the sBIT metadata.
 			static const rp_image::sBIT_t sBIT = {5,6,5,0,0};
 			img->set_sBIT(&sBIT);
@@ -105,19 +120,28 @@ rp_image *fromGcn16(PixelFormat px_format,
 		}
 
 		case PXF_IA8: {
-			for (unsigned int y = 0; y < tilesY; y++) {
-				for (unsigned int x = 0; x < tilesX; x++) {
-					// Convert each tile to ARGB32 manually.
-					// TODO: Optimize using pointers instead of indexes?
-					for (unsigned int i = 0; i < 4*4; i += 2, img_buf += 2) {
-						tileBuf[i+0] = IA8_to_ARGB32(be16_to_cpu(img_buf[0]));
-						tileBuf[i+1] = IA8_to_ARGB32(be16_to_cpu(img_buf[1]));
+			ImageDecoderPrivate::decodeTileRows(tilesY, width * height,
+				[=](unsigned int y_start, unsigned int y_end)
+			{
+				const uint16_t *src = img_buf + (y_start * tilesX * 4*4);
+
+				// Temporary tile buffer.
+				uint32_t tileBuf[4*4];
+
+				for (unsigned int y = y_start; y < y_end; y++) {
+					for (unsigned int x = 0; x < tilesX; x++) {
+						// Convert each tile to ARGB32 manually.
+						// TODO: Optimize using pointers instead of indexes?
+						for (unsigned int i = 0; i < 4*4; i += 2, src += 2) {
+							tileBuf[i+0] = IA8_to_ARGB32(be16_to_cpu(src[0]));
+							tileBuf[i+1] = IA8_to_ARGB32(be16_to_cpu(src[1]));
+						}
+
+						// Blit the tile to the main image buffer.
+						ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
 					}
-
-					// Blit the tile to the main image buffer.
-					ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
 				}
-			}
+			});
 			// Set the sBIT metadata.
 			// NOTE: Setting the grayscale value, though we're
 			// not saving grayscale PNGs at the moment.
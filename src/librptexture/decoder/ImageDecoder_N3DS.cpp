@@ -66,22 +66,28 @@ rp_image *fromN3DSTiledRGB565(int width, int height,
 	const unsigned int tilesX = static_cast<unsigned int>(width / 8);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 8);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[8*8];
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-		for (unsigned int x = 0; x < tilesX; x++) {
-			// Convert each tile to ARGB32 manually.
-			// TODO: Optimize using pointers instead of indexes?
-			for (unsigned int i = 0; i < 8*8; i += 2, img_buf += 2) {
-				tileBuf[N3DS_tile_order[i+0]] = RGB565_to_ARGB32(le16_to_cpu(img_buf[0]));
-				tileBuf[N3DS_tile_order[i+1]] = RGB565_to_ARGB32(le16_to_cpu(img_buf[1]));
+	ImageDecoderPrivate::decodeTileRows(tilesY, width * height,
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const uint16_t *src = img_buf + (y_start * tilesX * 8*8);
+
+		// Temporary tile buffer.
+		uint32_t tileBuf[8*8];
+
+		for (unsigned int y = y_start; y < y_end; y++) {
+			for (unsigned int x = 0; x < tilesX; x++) {
+				// Convert each tile to ARGB32 manually.
+				// TODO: Optimize using pointers instead of indexes?
+				for (unsigned int i = 0; i < 8*8; i += 2, src += 2) {
+					tileBuf[N3DS_tile_order[i+0]] = RGB565_to_ARGB32(le16_to_cpu(src[0]));
+					tileBuf[N3DS_tile_order[i+1]] = RGB565_to_ARGB32(le16_to_cpu(src[1]));
+				}
+
+				// Blit the tile to the main image buffer.
+				ImageDecoderPrivate::BlitTile<uint32_t, 8, 8>(img, tileBuf, x, y);
 			}
-
-			// Blit the tile to the main image buffer.
-			ImageDecoderPrivate::BlitTile<uint32_t, 8, 8>(img, tileBuf, x, y);
 		}
-	}
+	});
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {5,6,5,0,0};
@@ -137,26 +143,33 @@ rp_image *fromN3DSTiledRGB565_A4(int width, int height,
 		return nullptr;
 	}
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[8*8];
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-		for (unsigned int x = 0; x < tilesX; x++) {
-			// Convert each tile to ARGB32 manually.
-			// TODO: Optimize using pointers instead of indexes?
-			// FIXME: Nybble ordering for A4?
-			// Assuming LeftLSN, same as NDS CI4.
-			for (unsigned int i = 0; i < 8*8; i += 2, img_buf += 2, alpha_buf++) {
-				tileBuf[N3DS_tile_order[i+0]] = RGB565_A4_to_ARGB32(
-					le16_to_cpu(img_buf[0]), *alpha_buf & 0x0F);
-				tileBuf[N3DS_tile_order[i+1]] = RGB565_A4_to_ARGB32(
-					le16_to_cpu(img_buf[1]), *alpha_buf >> 4);
+	ImageDecoderPrivate::decodeTileRows(tilesY, width * height,
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const uint16_t *src = img_buf + (y_start * tilesX * 8*8);
+		const uint8_t *alpha_src = alpha_buf + (y_start * tilesX * 8*8/2);
+
+		// Temporary tile buffer.
+		uint32_t tileBuf[8*8];
+
+		for (unsigned int y = y_start; y < y_end; y++) {
+			for (unsigned int x = 0; x < tilesX; x++) {
+				// Convert each tile to ARGB32 manually.
+				// TODO: Optimize using pointers instead of indexes?
+				// FIXME: Nybble ordering for A4?
+				// Assuming LeftLSN, same as NDS CI4.
+				for (unsigned int i = 0; i < 8*8; i += 2, src += 2, alpha_src++) {
+					tileBuf[N3DS_tile_order[i+0]] = RGB565_A4_to_ARGB32(
+						le16_to_cpu(src[0]), *alpha_src & 0x0F);
+					tileBuf[N3DS_tile_order[i+1]] = RGB565_A4_to_ARGB32(
+						le16_to_cpu(src[1]), *alpha_src >> 4);
+				}
+
+				// Blit the tile to the main image buffer.
+				ImageDecoderPrivate::BlitTile<uint32_t, 8, 8>(img, tileBuf, x, y);
 			}
-
-			// Blit the tile to the main image buffer.
-			ImageDecoderPrivate::BlitTile<uint32_t, 8, 8>(img, tileBuf, x, y);
 		}
-	}
+	});
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {5,6,5,0,4};
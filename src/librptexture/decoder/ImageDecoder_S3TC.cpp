@@ -10,6 +10,7 @@
 
 #include "ImageDecoder.hpp"
 #include "ImageDecoder_p.hpp"
+#include "ImageDecoder_S3TC_p.hpp"
 
 #include "PixelConversion.hpp"
 using namespace LibRpTexture::PixelConversion;
@@ -28,23 +29,6 @@ using namespace LibRpTexture::PixelConversion;
 
 namespace LibRpTexture { namespace ImageDecoder {
 
-// DXT1 block format.
-struct dxt1_block {
-	uint16_t color[2];	// Colors 0 and 1, in RGB565 format.
-	uint32_t indexes;	// Two-bit color indexes.
-};
-ASSERT_STRUCT(dxt1_block, 8);
-
-// DXT5 alpha+codes struct.
-// Also used by BC4/BC5 for color channels.
-union dxt5_alpha {
-	struct {
-		uint8_t values[2];	// Alpha values.
-		uint8_t codes[6];	// Alpha operation codes. (48-bit unsigned; 3-bit per pixel)
-	};
-	uint64_t u64;	// Access the 48-bit code value directly. (Requires shifting.)
-};
-
 /**
  * Extract the 48-bit code value from dxt5_alpha.
  * @param data dxt5_alpha.
@@ -58,13 +42,6 @@ static FORCEINLINE uint64_t extract48(const dxt5_alpha *RESTRICT data)
 	return le64_to_cpu(data->u64) >> 16;
 }
 
-// decode_DXTn_tile_color_palette flags.
-enum DXTn_Palette_Flags {
-	DXTn_PALETTE_BIG_ENDIAN		= (1U << 0),
-	DXTn_PALETTE_COLOR3_ALPHA	= (1U << 1),	// GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
-	DXTn_PALETTE_COLOR0_LE_COLOR1	= (1U << 2),	// Assume color0 <= color1. (DXT2/DXT3)
-};
-
 /**
  * Decode a DXTn tile color palette. (S3TC version)
  * @tparam flags Flags. (See DXTn_Palette_Flags)
@@ -219,44 +196,49 @@ rp_image *fromDXT1_GCN(int width, int height,
 		return nullptr;
 	}
 
-	const dxt1_block *dxt1_src = reinterpret_cast<const dxt1_block*>(img_buf);
-
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary 4-tile buffer.
-	uint32_t tileBuf[4][4*4];
-
 	// Tiles are arranged in 2x2 blocks.
+	// Each band row is a row of 2x2 blocks.
 	// Reference: https://github.com/nickworonekin/puyotools/blob/80f11884f6cae34c4a56c5b1968600fe7c34628b/Libraries/VrSharp/GvrTexture/GvrDataCodec.cs#L712
-	for (unsigned int y = 0; y < tilesY; y += 2) {
-	for (unsigned int x = 0; x < tilesX; x += 2) {
-		// Decode 4 tiles at once.
-		for (unsigned int tile = 0; tile < 4; tile++, dxt1_src++) {
-			// Decode the DXT1 tile palette.
-			// TODO: Color 3 may be either black or transparent.
-			// Figure out if there's a way to specify that in GVR.
-			// Assuming transparent for now, since most GVR DXT1
-			// textures use transparency.
-			argb32_t pal[4];
-			decode_DXTn_tile_color_palette_S3TC<DXTn_PALETTE_BIG_ENDIAN | DXTn_PALETTE_COLOR3_ALPHA>(pal, dxt1_src);
-
-			// Process the 16 color indexes.
-			// NOTE: The tile indexes are stored "backwards" due to
-			// big-endian shenanigans.
-			uint32_t indexes = be32_to_cpu(dxt1_src->indexes);
-			for (int i = 16-1; i >= 0; i--, indexes >>= 2) {
-				tileBuf[tile][i] = pal[indexes & 3].u32;
+	ImageDecoderPrivate::decodeTileRows(tilesY / 2, width * height,
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const dxt1_block *dxt1_src = reinterpret_cast<const dxt1_block*>(img_buf) + (y_start * tilesX * 2);
+
+		// Temporary 4-tile buffer.
+		uint32_t tileBuf[4][4*4];
+
+		for (unsigned int y = y_start * 2; y < y_end * 2; y += 2) {
+		for (unsigned int x = 0; x < tilesX; x += 2) {
+			// Decode 4 tiles at once.
+			for (unsigned int tile = 0; tile < 4; tile++, dxt1_src++) {
+				// Decode the DXT1 tile palette.
+				// TODO: Color 3 may be either black or transparent.
+				// Figure out if there's a way to specify that in GVR.
+				// Assuming transparent for now, since most GVR DXT1
+				// textures use transparency.
+				argb32_t pal[4];
+				decode_DXTn_tile_color_palette_S3TC<DXTn_PALETTE_BIG_ENDIAN | DXTn_PALETTE_COLOR3_ALPHA>(pal, dxt1_src);
+
+				// Process the 16 color indexes.
+				// NOTE: The tile indexes are stored "backwards" due to
+				// big-endian shenanigans.
+				uint32_t indexes = be32_to_cpu(dxt1_src->indexes);
+				for (int i = 16-1; i >= 0; i--, indexes >>= 2) {
+					tileBuf[tile][i] = pal[indexes & 3].u32;
+				}
 			}
-		}
 
-		// Blit the tiles to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[0], x+0, y+0);
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[1], x+1, y+0);
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[2], x+0, y+1);
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[3], x+1, y+1);
-	} }
+			// Blit the tiles to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[0], x+0, y+0);
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[1], x+1, y+0);
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[2], x+0, y+1);
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf[3], x+1, y+1);
+		} }
+	});
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {8,8,8,0,1};
@@ -305,30 +287,34 @@ static rp_image *T_fromDXT1(int width, int height,
 		return nullptr;
 	}
 
-	const dxt1_block *dxt1_src = reinterpret_cast<const dxt1_block*>(img_buf);
-
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const dxt1_block *dxt1_src = reinterpret_cast<const dxt1_block*>(img_buf) + (y_start * tilesX);
 
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, dxt1_src++) {
-		// Decode the DXT1 tile palette.
-		argb32_t pal[4];
-		decode_DXTn_tile_color_palette_S3TC<palflags>(pal, dxt1_src);
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-		// Process the 16 color indexes.
-		uint32_t indexes = le32_to_cpu(dxt1_src->indexes);
-		for (unsigned int i = 0; i < 16; i++, indexes >>= 2) {
-			tileBuf[i] = pal[indexes & 3].u32;
-		}
+		for (unsigned int y = y_start; y < y_end; y++) {
+		for (unsigned int x = 0; x < tilesX; x++, dxt1_src++) {
+			// Decode the DXT1 tile palette.
+			argb32_t pal[4];
+			decode_DXTn_tile_color_palette_S3TC<palflags>(pal, dxt1_src);
+
+			// Process the 16 color indexes.
+			uint32_t indexes = le32_to_cpu(dxt1_src->indexes);
+			for (unsigned int i = 0; i < 16; i++, indexes >>= 2) {
+				tileBuf[i] = pal[indexes & 3].u32;
+			}
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		} }
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -346,6 +332,7 @@ static rp_image *T_fromDXT1(int width, int height,
 /**
  * Convert a DXT1 image to rp_image.
  * S3TC palette index 3 will be interpreted as black.
+ * Standard version using regular C++ code.
  *
  * @param width Image width.
  * @param height Image height.
@@ -353,7 +340,7 @@ static rp_image *T_fromDXT1(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT1(int width, int height,
+rp_image *fromDXT1_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz)
 {
 	return T_fromDXT1<0>(width, height, img_buf, img_siz);
@@ -362,6 +349,7 @@ rp_image *fromDXT1(int width, int height,
 /**
  * Convert a DXT1 image to rp_image.
  * S3TC palette index 3 will be interpreted as fully transparent.
+ * Standard version using regular C++ code.
  *
  * @param width Image width.
  * @param height Image height.
@@ -369,7 +357,7 @@ rp_image *fromDXT1(int width, int height,
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT1_A1(int width, int height,
+rp_image *fromDXT1_A1_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz)
 {
 	return T_fromDXT1<DXTn_PALETTE_COLOR3_ALPHA>(width, height, img_buf, img_siz);
@@ -406,13 +394,14 @@ rp_image *fromDXT2(int width, int height,
 
 /**
  * Convert a DXT3 image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf DXT3 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT3(int width, int height,
+rp_image *fromDXT3_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz)
 {
 	// Verify parameters.
@@ -441,43 +430,41 @@ rp_image *fromDXT3(int width, int height,
 		return nullptr;
 	}
 
-	// DXT3 block format.
-	struct dxt3_block {
-		uint64_t alpha;		// Alpha values. (4-bit per pixel)
-		dxt1_block colors;	// DXT1-style color block.
-	};
-	ASSERT_STRUCT(dxt3_block, 16);
-	const dxt3_block *dxt3_src = reinterpret_cast<const dxt3_block*>(img_buf);
-
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, dxt3_src++) {
-		// Decode the DXT3 tile palette.
-		argb32_t pal[4];
-		// FIXME: DXTn_PALETTE_COLOR0_LE_COLOR1 seems to result in garbage pixels.
-		// https://github.com/kchapelier/decode-dxt/tree/master/lib has similar code
-		// but handles DXT3 like both DXT1 and DXT5, so disable this for now.
-		decode_DXTn_tile_color_palette_S3TC<0/*DXTn_PALETTE_COLOR0_LE_COLOR1*/>(pal, &dxt3_src->colors);
-
-		// Process the 16 color indexes and apply alpha.
-		uint32_t indexes = le32_to_cpu(dxt3_src->colors.indexes);
-		uint64_t alpha = le64_to_cpu(dxt3_src->alpha);
-		for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha >>= 4) {
-			argb32_t color = pal[indexes & 3];
-			// TODO: Verify alpha value handling for DXT3.
-			color.a = (alpha & 0xF) | ((alpha & 0xF) << 4);
-			tileBuf[i] = color.u32;
-		}
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const dxt3_block *dxt3_src = reinterpret_cast<const dxt3_block*>(img_buf) + (y_start * tilesX);
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
+
+		for (unsigned int y = y_start; y < y_end; y++) {
+		for (unsigned int x = 0; x < tilesX; x++, dxt3_src++) {
+			// Decode the DXT3 tile palette.
+			argb32_t pal[4];
+			// FIXME: DXTn_PALETTE_COLOR0_LE_COLOR1 seems to result in garbage pixels.
+			// https://github.com/kchapelier/decode-dxt/tree/master/lib has similar code
+			// but handles DXT3 like both DXT1 and DXT5, so disable this for now.
+			decode_DXTn_tile_color_palette_S3TC<0/*DXTn_PALETTE_COLOR0_LE_COLOR1*/>(pal, &dxt3_src->colors);
+
+			// Process the 16 color indexes and apply alpha.
+			uint32_t indexes = le32_to_cpu(dxt3_src->colors.indexes);
+			uint64_t alpha = le64_to_cpu(dxt3_src->alpha);
+			for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha >>= 4) {
+				argb32_t color = pal[indexes & 3];
+				// TODO: Verify alpha value handling for DXT3.
+				color.a = (alpha & 0xF) | ((alpha & 0xF) << 4);
+				tileBuf[i] = color.u32;
+			}
+
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		} }
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -523,13 +510,14 @@ rp_image *fromDXT4(int width, int height,
 
 /**
  * Convert a DXT5 image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf DXT5 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromDXT5(int width, int height,
+rp_image *fromDXT5_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz)
 {
 	// Verify parameters.
@@ -558,42 +546,40 @@ rp_image *fromDXT5(int width, int height,
 		return nullptr;
 	}
 
-	// DXT5 block format.
-	struct dxt5_block {
-		dxt5_alpha alpha;
-		dxt1_block colors;	// DXT1-style color block.
-	};
-	ASSERT_STRUCT(dxt5_block, 16);
-	const dxt5_block *dxt5_src = reinterpret_cast<const dxt5_block*>(img_buf);
-
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, dxt5_src++) {
-		// Decode the DXT5 tile palette.
-		argb32_t pal[4];
-		decode_DXTn_tile_color_palette_S3TC<0>(pal, &dxt5_src->colors);
-
-		// Get the DXT5 alpha codes.
-		uint64_t alpha48 = extract48(&dxt5_src->alpha);
-
-		// Process the 16 color and alpha indexes.
-		uint32_t indexes = le32_to_cpu(dxt5_src->colors.indexes);
-		for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha48 >>= 3) {
-			argb32_t color = pal[indexes & 3];
-			// Decode the alpha channel value.
-			color.a = decode_DXT5_alpha_S3TC(alpha48 & 7, dxt5_src->alpha.values);
-			tileBuf[i] = color.u32;
-		}
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const dxt5_block *dxt5_src = reinterpret_cast<const dxt5_block*>(img_buf) + (y_start * tilesX);
+
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+		for (unsigned int y = y_start; y < y_end; y++) {
+		for (unsigned int x = 0; x < tilesX; x++, dxt5_src++) {
+			// Decode the DXT5 tile palette.
+			argb32_t pal[4];
+			decode_DXTn_tile_color_palette_S3TC<0>(pal, &dxt5_src->colors);
+
+			// Get the DXT5 alpha codes.
+			uint64_t alpha48 = extract48(&dxt5_src->alpha);
+
+			// Process the 16 color and alpha indexes.
+			uint32_t indexes = le32_to_cpu(dxt5_src->colors.indexes);
+			for (unsigned int i = 0; i < 16; i++, indexes >>= 2, alpha48 >>= 3) {
+				argb32_t color = pal[indexes & 3];
+				// Decode the alpha channel value.
+				color.a = decode_DXT5_alpha_S3TC(alpha48 & 7, dxt5_src->alpha.values);
+				tileBuf[i] = color.u32;
+			}
+
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		} }
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -610,13 +596,14 @@ rp_image *fromDXT5(int width, int height,
 
 /**
  * Convert a BC4 (ATI1) image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf BC4 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)/2]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC4(int width, int height,
+rp_image *fromBC4_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz)
 {
 	// Verify parameters.
@@ -645,41 +632,40 @@ rp_image *fromBC4(int width, int height,
 		return nullptr;
 	}
 
-	// BC4 block format.
-	struct bc4_block {
-		dxt5_alpha red;
-	};
-	ASSERT_STRUCT(bc4_block, 8);
-	const bc4_block *bc4_src = reinterpret_cast<const bc4_block*>(img_buf);
-
 	// Calculate the total number of tiles.
 	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
-	// S3TC version.
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, bc4_src++) {
-		// BC4 colors are determined using DXT5-style alpha interpolation.
-
-		// Get the BC4 color codes.
-		uint64_t red48 = extract48(&bc4_src->red);
-
-		// Process the 16 color indexes.
-		// NOTE: Using red instead of grayscale here.
-		argb32_t color;
-		color.u32 = 0xFF000000;	// opaque black
-		for (unsigned int i = 0; i < 16; i++, red48 >>= 3) {
-			// Decode the red channel value.
-			color.r = decode_DXT5_alpha_S3TC(red48 & 7, bc4_src->red.values);
-			tileBuf[i] = color.u32;
-		}
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const bc4_block *bc4_src = reinterpret_cast<const bc4_block*>(img_buf) + (y_start * tilesX);
+
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
+
+		// S3TC version.
+		for (unsigned int y = y_start; y < y_end; y++) {
+		for (unsigned int x = 0; x < tilesX; x++, bc4_src++) {
+			// BC4 colors are determined using DXT5-style alpha interpolation.
+
+			// Get the BC4 color codes.
+			uint64_t red48 = extract48(&bc4_src->red);
+
+			// Process the 16 color indexes.
+			// NOTE: Using red instead of grayscale here.
+			argb32_t color;
+			color.u32 = 0xFF000000;	// opaque black
+			for (unsigned int i = 0; i < 16; i++, red48 >>= 3) {
+				// Decode the red channel value.
+				color.r = decode_DXT5_alpha_S3TC(red48 & 7, bc4_src->red.values);
+				tileBuf[i] = color.u32;
+			}
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		} }
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
@@ -698,13 +684,14 @@ rp_image *fromBC4(int width, int height,
 
 /**
  * Convert a BC5 (ATI2) image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf BC5 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC5(int width, int height,
+rp_image *fromBC5_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz)
 {
 	// Verify parameters.
@@ -733,43 +720,41 @@ rp_image *fromBC5(int width, int height,
 		return nullptr;
 	}
 
-	// BC5 block format.
-	struct bc5_block {
-		dxt5_alpha red;
-		dxt5_alpha green;
-	};
-	ASSERT_STRUCT(bc5_block, 16);
-	const bc5_block *bc5_src = reinterpret_cast<const bc5_block*>(img_buf);
-
 	// Calculate the total number of tiles.
-	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
-	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
+	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
-	// S3TC version.
-	for (unsigned int y = 0; y < tilesY; y++) {
-	for (unsigned int x = 0; x < tilesX; x++, bc5_src++) {
-		// BC5 colors are determined using DXT5-style alpha interpolation.
-
-		// Get the BC5 color codes.
-		uint64_t red48   = extract48(&bc5_src->red);
-		uint64_t green48 = extract48(&bc5_src->green);
-
-		// Process the 16 color indexes.
-		argb32_t color;
-		color.u32 = 0xFF000000;	// opaque black
-		for (unsigned int i = 0; i < 16; i++, red48 >>= 3, green48 >>= 3) {
-			// Decode the red and green channel values.
-			color.r = decode_DXT5_alpha_S3TC(red48   & 7, bc5_src->red.values);
-			color.g = decode_DXT5_alpha_S3TC(green48 & 7, bc5_src->green.values);
-			tileBuf[i] = color.u32;
-		}
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const bc5_block *bc5_src = reinterpret_cast<const bc5_block*>(img_buf) + (y_start * tilesX);
+
+		// Temporary tile buffer.
+		uint32_t tileBuf[4*4];
+
+		// S3TC version.
+		for (unsigned int y = y_start; y < y_end; y++) {
+		for (unsigned int x = 0; x < tilesX; x++, bc5_src++) {
+			// BC5 colors are determined using DXT5-style alpha interpolation.
+
+			// Get the BC5 color codes.
+			uint64_t red48   = extract48(&bc5_src->red);
+			uint64_t green48 = extract48(&bc5_src->green);
+
+			// Process the 16 color indexes.
+			argb32_t color;
+			color.u32 = 0xFF000000;	// opaque black
+			for (unsigned int i = 0; i < 16; i++, red48 >>= 3, green48 >>= 3) {
+				// Decode the red and green channel values.
+				color.r = decode_DXT5_alpha_S3TC(red48   & 7, bc5_src->red.values);
+				color.g = decode_DXT5_alpha_S3TC(green48 & 7, bc5_src->green.values);
+				tileBuf[i] = color.u32;
+			}
 
-		// Blit the tile to the main image buffer.
-		ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-	} }
+			// Blit the tile to the main image buffer.
+			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+		} }
+	});
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
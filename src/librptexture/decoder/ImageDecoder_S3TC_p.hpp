@@ -0,0 +1,73 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_S3TC_p.hpp: Image decoding functions. (S3TC) (PRIVATE)     *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_S3TC_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_S3TC_P_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stdint.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+// DXT1 block format.
+struct dxt1_block {
+	uint16_t color[2];	// Colors 0 and 1, in RGB565 format.
+	uint32_t indexes;	// Two-bit color indexes.
+};
+ASSERT_STRUCT(dxt1_block, 8);
+
+// DXT5 alpha+codes struct.
+// Also used by BC4/BC5 for color channels.
+union dxt5_alpha {
+	struct {
+		uint8_t values[2];	// Alpha values.
+		uint8_t codes[6];	// Alpha operation codes. (48-bit unsigned; 3-bit per pixel)
+	};
+	uint64_t u64;	// Access the 48-bit code value directly. (Requires shifting.)
+};
+ASSERT_STRUCT(dxt5_alpha, 8);
+
+// DXT3 block format.
+struct dxt3_block {
+	uint64_t alpha;		// Alpha values. (4-bit per pixel)
+	dxt1_block colors;	// DXT1-style color block.
+};
+ASSERT_STRUCT(dxt3_block, 16);
+
+// DXT5 block format.
+struct dxt5_block {
+	dxt5_alpha alpha;
+	dxt1_block colors;	// DXT1-style color block.
+};
+ASSERT_STRUCT(dxt5_block, 16);
+
+// BC4 block format.
+struct bc4_block {
+	dxt5_alpha red;
+};
+ASSERT_STRUCT(bc4_block, 8);
+
+// BC5 block format.
+struct bc5_block {
+	dxt5_alpha red;
+	dxt5_alpha green;
+};
+ASSERT_STRUCT(bc5_block, 16);
+
+// decode_DXTn_tile_color_palette flags.
+enum DXTn_Palette_Flags {
+	DXTn_PALETTE_BIG_ENDIAN		= (1U << 0),
+	DXTn_PALETTE_COLOR3_ALPHA	= (1U << 1),	// GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+	DXTn_PALETTE_COLOR0_LE_COLOR1	= (1U << 2),	// Assume color0 <= color1. (DXT2/DXT3)
+};
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_S3TC_P_HPP__ */
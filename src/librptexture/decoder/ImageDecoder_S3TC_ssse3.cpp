@@ -0,0 +1,585 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_S3TC.cpp: Image decoding functions. (S3TC)                 *
+ * SSSE3-optimized version.                                                *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
+#include "ImageDecoder_S3TC_p.hpp"
+
+#include "PixelConversion.hpp"
+using namespace LibRpTexture::PixelConversion;
+
+// SSSE3 headers.
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+// Each 4x4 tile is decoded directly into the image, one row per
+// SSE register. Palette lookups are done using pshufb:
+// - DXT1 colors: 4-entry ARGB32 palette; the shuffle mask selects
+//   the four bytes of the palette entry for each pixel.
+// - DXT5 alpha, BC4/BC5 colors: 8-entry 8-bit palette.
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Decode a DXTn tile color palette. (SSSE3 version)
+ * @tparam flags Flags. (See DXTn_Palette_Flags)
+ * @param dxt1_src	[in] DXT1 block.
+ * @return Four ARGB32 palette entries.
+ */
+template<unsigned int flags>
+static FORCEINLINE __m128i decode_DXTn_tile_color_palette_ssse3(const dxt1_block *RESTRICT dxt1_src)
+{
+	static_assert(!(flags & DXTn_PALETTE_BIG_ENDIAN), "Big-endian palettes are not supported here.");
+
+	// Convert the first two colors from RGB565.
+	const uint16_t c0 = le16_to_cpu(dxt1_src->color[0]);
+	const uint16_t c1 = le16_to_cpu(dxt1_src->color[1]);
+	const __m128i pal01 = _mm_setr_epi32(
+		static_cast<int>(RGB565_to_ARGB32(c0)),
+		static_cast<int>(RGB565_to_ARGB32(c1)), 0, 0);
+
+	// 16-bit components: [color0, color1] and [color1, color0]
+	const __m128i w = _mm_unpacklo_epi8(pal01, _mm_setzero_si128());
+	const __m128i ws = _mm_shuffle_epi32(w, _MM_SHUFFLE(1,0,3,2));
+
+	// Calculate the second two colors.
+	__m128i pal23;
+	if (!(flags & DXTn_PALETTE_COLOR0_LE_COLOR1) && (c0 > c1)) {
+		// color0 > color1
+		// (2*c0 + c1) / 3, (2*c1 + c0) / 3
+		// NOTE: x/3 == (x * 0x5556) >> 16 for all x <= 765.
+		// Alpha is 255 for both colors, so it stays 255.
+		__m128i t = _mm_add_epi16(_mm_add_epi16(w, w), ws);
+		t = _mm_mulhi_epu16(t, _mm_set1_epi16(0x5556));
+		pal23 = _mm_packus_epi16(t, t);
+	} else {
+		// color0 <= color1
+		// (c0 + c1) / 2, then black and/or transparent.
+		__m128i t = _mm_srli_epi16(_mm_add_epi16(w, ws), 1);
+		pal23 = _mm_packus_epi16(t, t);
+		pal23 = _mm_and_si128(pal23, _mm_setr_epi32(-1, 0, 0, 0));
+		if (!(flags & DXTn_PALETTE_COLOR3_ALPHA)) {
+			pal23 = _mm_or_si128(pal23, _mm_setr_epi32(0, static_cast<int>(0xFF000000), 0, 0));
+		}
+	}
+
+	return _mm_unpacklo_epi64(pal01, pal23);
+}
+
+/**
+ * Expand DXT1 2-bit color indexes to palette byte offsets.
+ * @param indexes Two-bit color indexes. (host-endian)
+ * @return 16 bytes: pixel i == index * 4
+ */
+static FORCEINLINE __m128i decode_DXTn_indexes_ssse3(uint32_t indexes)
+{
+	// Copy each row's index byte to all four pixels in the row.
+	__m128i b = _mm_cvtsi32_si128(static_cast<int>(indexes));
+	b = _mm_shuffle_epi8(b, _mm_setr_epi8(0,0,0,0, 1,1,1,1, 2,2,2,2, 3,3,3,3));
+
+	// Shift each pixel's index to bits 2-3.
+	// 16-bit shifts are fine here, since the bits that cross
+	// into the adjacent byte are masked out.
+	const __m128i k0 = _mm_set1_epi32(0x0000000C);
+	const __m128i k1 = _mm_set1_epi32(0x00000C00);
+	const __m128i k2 = _mm_set1_epi32(0x000C0000);
+	const __m128i k3 = _mm_set1_epi32(0x0C000000);
+	__m128i idx = _mm_and_si128(_mm_slli_epi16(b, 2), k0);
+	idx = _mm_or_si128(idx, _mm_and_si128(b, k1));
+	idx = _mm_or_si128(idx, _mm_and_si128(_mm_srli_epi16(b, 2), k2));
+	idx = _mm_or_si128(idx, _mm_and_si128(_mm_srli_epi16(b, 4), k3));
+	return idx;
+}
+
+/**
+ * Look up a row of four ARGB32 pixels in a 4-entry palette.
+ * @tparam row Row number.
+ * @param pal Four ARGB32 palette entries.
+ * @param idx Palette byte offsets from decode_DXTn_indexes_ssse3().
+ * @return Four ARGB32 pixels.
+ */
+template<unsigned int row>
+static FORCEINLINE __m128i lookup_row_ARGB32(__m128i pal, __m128i idx)
+{
+	const __m128i shuf = _mm_setr_epi8(
+		row*4+0, row*4+0, row*4+0, row*4+0,
+		row*4+1, row*4+1, row*4+1, row*4+1,
+		row*4+2, row*4+2, row*4+2, row*4+2,
+		row*4+3, row*4+3, row*4+3, row*4+3);
+	const __m128i ctrl = _mm_or_si128(_mm_shuffle_epi8(idx, shuf),
+		_mm_set1_epi32(0x03020100));
+	return _mm_shuffle_epi8(pal, ctrl);
+}
+
+/**
+ * Move a row of four 8-bit values into one ARGB32 channel.
+ * Other channels are set to 0.
+ * @tparam row Row number.
+ * @tparam ch Channel byte number. (0 == B, 1 == G, 2 == R, 3 == A)
+ * @param vals 16 8-bit values.
+ * @return Four ARGB32 pixels.
+ */
+template<unsigned int row, unsigned int ch>
+static FORCEINLINE __m128i expand_row_channel(__m128i vals)
+{
+#define C(px, i) static_cast<char>((i) == ch ? (row*4+(px)) : 0x80)
+	const __m128i shuf = _mm_setr_epi8(
+		C(0,0), C(0,1), C(0,2), C(0,3),
+		C(1,0), C(1,1), C(1,2), C(1,3),
+		C(2,0), C(2,1), C(2,2), C(2,3),
+		C(3,0), C(3,1), C(3,2), C(3,3));
+#undef C
+	return _mm_shuffle_epi8(vals, shuf);
+}
+
+/**
+ * Get the 3-bit DXT5 alpha codes.
+ * @param data dxt5_alpha.
+ * @return 16 bytes: pixel i == 3-bit code
+ */
+static FORCEINLINE __m128i decode_DXT5_codes_ssse3(const dxt5_alpha *RESTRICT data)
+{
+	const __m128i blk = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+
+	// Each pixel's 3-bit code is contained within a 16-bit window.
+	// The code starts at bit (16 + 3*i) within the 64-bit block.
+	const __m128i shuf_lo = _mm_setr_epi8(2,3, 2,3, 2,3, 3,4, 3,4, 3,4, 4,5, 4,5);
+	const __m128i shuf_hi = _mm_setr_epi8(5,6, 5,6, 5,6, 6,7, 6,7, 6,7, 7,-128, 7,-128);
+
+	// Shift each code to the top of its window, then down to bits 0-2.
+	// (pmullw is used as a per-lane variable left shift.)
+	const __m128i mult = _mm_setr_epi16(1<<13, 1<<10, 1<<7, 1<<12, 1<<9, 1<<6, 1<<11, 1<<8);
+	const __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(blk, shuf_lo), mult), 13);
+	const __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(blk, shuf_hi), mult), 13);
+	return _mm_packus_epi16(lo, hi);
+}
+
+// DXT5 alpha palette parameters.
+// Index: 1 if alpha[0] > alpha[1]; 0 otherwise.
+// - w0, w1: Weights for alpha[0] and alpha[1].
+// - div: Reciprocal for pmulhuw. (x/7 or x/5; exact for all possible values)
+// - fill: Value to OR in afterwards. (255 for code 7 in 6-alpha mode)
+static const ALIGNED_VAR(16, uint16_t dxt5_alpha_pal_params[2][4][8]) = {
+	// alpha[0] <= alpha[1]: 6 alpha values, plus 0 and 255.
+	{
+		{5, 0, 4, 3, 2, 1, 0, 0},
+		{0, 5, 1, 2, 3, 4, 0, 0},
+		{0x3334, 0x3334, 0x3334, 0x3334, 0x3334, 0x3334, 0x3334, 0x3334},
+		{0, 0, 0, 0, 0, 0, 0, 255},
+	},
+
+	// alpha[0] > alpha[1]: 8 alpha values.
+	{
+		{7, 0, 6, 5, 4, 3, 2, 1},
+		{0, 7, 1, 2, 3, 4, 5, 6},
+		{0x2493, 0x2493, 0x2493, 0x2493, 0x2493, 0x2493, 0x2493, 0x2493},
+		{0, 0, 0, 0, 0, 0, 0, 0},
+	},
+};
+
+/**
+ * Decode the DXT5 alpha palette. (SSSE3 version)
+ * Also used for BC4/BC5 color channels.
+ * @param data dxt5_alpha.
+ * @return 8 alpha values in the low 64 bits.
+ */
+static FORCEINLINE __m128i decode_DXT5_alpha_palette_ssse3(const dxt5_alpha *RESTRICT data)
+{
+	const uint8_t a0 = data->values[0];
+	const uint8_t a1 = data->values[1];
+	const __m128i *const params =
+		reinterpret_cast<const __m128i*>(dxt5_alpha_pal_params[a0 > a1]);
+
+	__m128i t = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_load_si128(&params[0]), _mm_set1_epi16(a0)),
+		_mm_mullo_epi16(_mm_load_si128(&params[1]), _mm_set1_epi16(a1)));
+	t = _mm_mulhi_epu16(t, _mm_load_si128(&params[2]));
+	t = _mm_or_si128(t, _mm_load_si128(&params[3]));
+	return _mm_packus_epi16(t, t);
+}
+
+/**
+ * Decode DXT5-style 8-bit values for all 16 pixels.
+ * @param data dxt5_alpha.
+ * @return 16 bytes: pixel i == value
+ */
+static FORCEINLINE __m128i decode_DXT5_values_ssse3(const dxt5_alpha *RESTRICT data)
+{
+	return _mm_shuffle_epi8(decode_DXT5_alpha_palette_ssse3(data),
+		decode_DXT5_codes_ssse3(data));
+}
+
+/**
+ * Store a decoded 4x4 tile.
+ * @param dest		[out] First pixel of the tile in the image.
+ * @param stride_px	[in] Image stride, in pixels.
+ * @param r0..r3	[in] Tile rows.
+ */
+static FORCEINLINE void store_tile(uint32_t *dest, int stride_px,
+	__m128i r0, __m128i r1, __m128i r2, __m128i r3)
+{
+	_mm_store_si128(reinterpret_cast<__m128i*>(dest), r0);
+	_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px), r1);
+	_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px*2), r2);
+	_mm_store_si128(reinterpret_cast<__m128i*>(dest + stride_px*3), r3);
+}
+
+/**
+ * Create an rp_image for a 4x4-tiled S3TC texture.
+ * @param width		[in] Image width.
+ * @param height	[in] Image height.
+ * @param img_buf	[in] Image buffer.
+ * @param img_siz	[in] Size of image data.
+ * @param bytesPerTile	[in] Bytes per 4x4 tile. (8 or 16)
+ * @return rp_image with the physical tile size, or nullptr on error.
+ */
+static rp_image *createTiledImage(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz, int bytesPerTile)
+{
+	// Verify parameters.
+	assert(img_buf != nullptr);
+	assert(width > 0);
+	assert(height > 0);
+
+	// S3TC uses 4x4 tiles, but some container formats allow
+	// the last tile to be cut off, so round up for the
+	// physical tile size.
+	const int physWidth = ALIGN_BYTES(4, width);
+	const int physHeight = ALIGN_BYTES(4, height);
+
+	if (!img_buf || width <= 0 || height <= 0 ||
+	    img_siz < ((physWidth * physHeight) / 16 * bytesPerTile))
+	{
+		return nullptr;
+	}
+
+	// Create an rp_image.
+	rp_image *const img = new rp_image(physWidth, physHeight, rp_image::FORMAT_ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		delete img;
+		return nullptr;
+	}
+	return img;
+}
+
+/**
+ * Finish decoding an S3TC texture.
+ * @param img		[in/out] rp_image.
+ * @param width		[in] Image width.
+ * @param height	[in] Image height.
+ * @param sBIT		[in] sBIT metadata.
+ */
+static inline void finishTiledImage(rp_image *img, int width, int height, const rp_image::sBIT_t *sBIT)
+{
+	if (width < img->width() || height < img->height()) {
+		// Shrink the image.
+		img->shrink(width, height);
+	}
+
+	// Set the sBIT metadata.
+	img->set_sBIT(sBIT);
+}
+
+/**
+ * Convert a DXT1 image to rp_image.
+ * SSSE3-optimized version.
+ * @param palflags decode_DXTn_tile_color_palette_ssse3<>() flags.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+template<unsigned int palflags>
+static rp_image *T_fromDXT1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	rp_image *const img = createTiledImage(width, height, img_buf, img_siz, 8);
+	if (!img)
+		return nullptr;
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(img->width() / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(img->height() / 4);
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const dxt1_block *dxt1_src = reinterpret_cast<const dxt1_block*>(img_buf) + (y_start * tilesX);
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, dxt1_src++, dest += 4) {
+				const __m128i pal = decode_DXTn_tile_color_palette_ssse3<palflags>(dxt1_src);
+				const __m128i idx = decode_DXTn_indexes_ssse3(le32_to_cpu(dxt1_src->indexes));
+				store_tile(dest, stride_px,
+					lookup_row_ARGB32<0>(pal, idx), lookup_row_ARGB32<1>(pal, idx),
+					lookup_row_ARGB32<2>(pal, idx), lookup_row_ARGB32<3>(pal, idx));
+			}
+		}
+	});
+
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,1};
+	finishTiledImage(img, width, height, &sBIT);
+	return img;
+}
+
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as black.
+ * SSSE3-optimized version.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return T_fromDXT1_ssse3<0>(width, height, img_buf, img_siz);
+}
+
+/**
+ * Convert a DXT1 image to rp_image.
+ * S3TC palette index 3 will be interpreted as fully transparent.
+ * SSSE3-optimized version.
+ *
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT1_A1_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return T_fromDXT1_ssse3<DXTn_PALETTE_COLOR3_ALPHA>(width, height, img_buf, img_siz);
+}
+
+/**
+ * Convert a DXT3 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT3 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT3_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	rp_image *const img = createTiledImage(width, height, img_buf, img_siz, 16);
+	if (!img)
+		return nullptr;
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(img->width() / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(img->height() / 4);
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const dxt3_block *dxt3_src = reinterpret_cast<const dxt3_block*>(img_buf) + (y_start * tilesX);
+
+		const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+		const __m128i nybble_mask = _mm_set1_epi8(0x0F);
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, dxt3_src++, dest += 4) {
+				// Decode the DXT3 tile palette.
+				// NOTE: See fromDXT3_cpp() regarding DXTn_PALETTE_COLOR0_LE_COLOR1.
+				__m128i pal = decode_DXTn_tile_color_palette_ssse3<0>(&dxt3_src->colors);
+				pal = _mm_and_si128(pal, rgb_mask);
+				const __m128i idx = decode_DXTn_indexes_ssse3(le32_to_cpu(dxt3_src->colors.indexes));
+
+				// Expand the 4-bit alpha values to 8-bit.
+				// Low nybble is the first pixel.
+				const __m128i a4 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&dxt3_src->alpha));
+				__m128i alpha = _mm_unpacklo_epi8(
+					_mm_and_si128(a4, nybble_mask),
+					_mm_and_si128(_mm_srli_epi16(a4, 4), nybble_mask));
+				alpha = _mm_or_si128(alpha, _mm_slli_epi16(alpha, 4));
+
+	#define DXT3_ROW(row) _mm_or_si128(lookup_row_ARGB32<row>(pal, idx), expand_row_channel<row, 3>(alpha))
+				store_tile(dest, stride_px, DXT3_ROW(0), DXT3_ROW(1), DXT3_ROW(2), DXT3_ROW(3));
+	#undef DXT3_ROW
+			}
+		}
+	});
+
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,4};
+	finishTiledImage(img, width, height, &sBIT);
+	return img;
+}
+
+/**
+ * Convert a DXT5 image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf DXT5 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromDXT5_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	rp_image *const img = createTiledImage(width, height, img_buf, img_siz, 16);
+	if (!img)
+		return nullptr;
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(img->width() / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(img->height() / 4);
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const dxt5_block *dxt5_src = reinterpret_cast<const dxt5_block*>(img_buf) + (y_start * tilesX);
+
+		const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, dxt5_src++, dest += 4) {
+				// Decode the DXT5 tile palette.
+				__m128i pal = decode_DXTn_tile_color_palette_ssse3<0>(&dxt5_src->colors);
+				pal = _mm_and_si128(pal, rgb_mask);
+				const __m128i idx = decode_DXTn_indexes_ssse3(le32_to_cpu(dxt5_src->colors.indexes));
+
+				// Decode the alpha channel values.
+				const __m128i alpha = decode_DXT5_values_ssse3(&dxt5_src->alpha);
+
+	#define DXT5_ROW(row) _mm_or_si128(lookup_row_ARGB32<row>(pal, idx), expand_row_channel<row, 3>(alpha))
+				store_tile(dest, stride_px, DXT5_ROW(0), DXT5_ROW(1), DXT5_ROW(2), DXT5_ROW(3));
+	#undef DXT5_ROW
+			}
+		}
+	});
+
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,8};
+	finishTiledImage(img, width, height, &sBIT);
+	return img;
+}
+
+/**
+ * Convert a BC4 (ATI1) image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC4 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC4_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	rp_image *const img = createTiledImage(width, height, img_buf, img_siz, 8);
+	if (!img)
+		return nullptr;
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(img->width() / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(img->height() / 4);
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const bc4_block *bc4_src = reinterpret_cast<const bc4_block*>(img_buf) + (y_start * tilesX);
+
+		// NOTE: Using red instead of grayscale here.
+		const __m128i opaque_black = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, bc4_src++, dest += 4) {
+				// BC4 colors are determined using DXT5-style alpha interpolation.
+				const __m128i red = decode_DXT5_values_ssse3(&bc4_src->red);
+
+	#define BC4_ROW(row) _mm_or_si128(expand_row_channel<row, 2>(red), opaque_black)
+				store_tile(dest, stride_px, BC4_ROW(0), BC4_ROW(1), BC4_ROW(2), BC4_ROW(3));
+	#undef BC4_ROW
+			}
+		}
+	});
+
+	// NOTE: We have to set '1' for the empty Green and Blue channels,
+	// since libpng complains if it's set to '0'.
+	static const rp_image::sBIT_t sBIT = {8,1,1,0,0};
+	finishTiledImage(img, width, height, &sBIT);
+	return img;
+}
+
+/**
+ * Convert a BC5 (ATI2) image to rp_image.
+ * SSSE3-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC5 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC5_ssse3(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	rp_image *const img = createTiledImage(width, height, img_buf, img_siz, 16);
+	if (!img)
+		return nullptr;
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(img->width() / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(img->height() / 4);
+	const int stride_px = img->stride() / sizeof(uint32_t);
+
+	ImageDecoderPrivate::decodeTileRows(tilesY, img->width() * img->height(),
+		[=](unsigned int y_start, unsigned int y_end)
+	{
+		const bc5_block *bc5_src = reinterpret_cast<const bc5_block*>(img_buf) + (y_start * tilesX);
+
+		const __m128i opaque_black = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		uint32_t *dest_row = static_cast<uint32_t*>(img->bits()) + (y_start * stride_px * 4);
+		for (unsigned int y = y_start; y < y_end; y++, dest_row += stride_px*4) {
+			uint32_t *dest = dest_row;
+			for (unsigned int x = 0; x < tilesX; x++, bc5_src++, dest += 4) {
+				// BC5 colors are determined using DXT5-style alpha interpolation.
+				const __m128i red   = decode_DXT5_values_ssse3(&bc5_src->red);
+				const __m128i green = decode_DXT5_values_ssse3(&bc5_src->green);
+
+	#define BC5_ROW(row) _mm_or_si128(_mm_or_si128( \
+					expand_row_channel<row, 2>(red), \
+					expand_row_channel<row, 1>(green)), opaque_black)
+				store_tile(dest, stride_px, BC5_ROW(0), BC5_ROW(1), BC5_ROW(2), BC5_ROW(3));
+	#undef BC5_ROW
+			}
+		}
+	});
+
+	// NOTE: We have to set '1' for the empty Blue channel,
+	// since libpng complains if it's set to '0'.
+	static const rp_image::sBIT_t sBIT = {8,8,1,0,0};
+	finishTiledImage(img, width, height, &sBIT);
+	return img;
+}
+
+} }
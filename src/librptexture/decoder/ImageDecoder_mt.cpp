@@ -0,0 +1,309 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_mt.cpp: Image decoding functions. (Multi-threading)        *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
+
+// librpthreads
+#include "librpthreads/Atomics.h"
+#include "librpthreads/Semaphore.hpp"
+#include "librpthreads/Thread.hpp"
+using LibRpBase::Semaphore;
+using LibRpBase::Thread;
+
+namespace LibRpTexture {
+
+/**
+ * Thread pool for decoding large textures.
+ *
+ * The shared pool is allocated on first use and is never destroyed
+ * by a global destructor, since joining threads during static
+ * destruction can deadlock. (On Windows, DLL_PROCESS_DETACH holds
+ * the loader lock, which exiting threads also need.)
+ * Call ImageDecoder::shutdownThreadPool() to stop the threads.
+ */
+class DecoderThreadPool
+{
+	public:
+		/**
+		 * Create a thread pool and start the worker threads.
+		 * If no threads can be started, the pool is still valid,
+		 * but run() will always return false.
+		 */
+		DecoderThreadPool();
+
+		/**
+		 * Stop the worker threads and delete the thread pool.
+		 * The pool must not be in use.
+		 */
+		~DecoderThreadPool();
+
+	private:
+		RP_DISABLE_COPY(DecoderThreadPool)
+
+	public:
+		/**
+		 * Maximum number of threads, including the calling thread.
+		 */
+		static const unsigned int MAX_THREADS = 8;
+
+		/**
+		 * Number of bands per thread.
+		 * Using more than one band per thread helps with load balancing,
+		 * since some tile rows may take longer to decode than others.
+		 */
+		static const unsigned int BANDS_PER_THREAD = 4;
+
+		/**
+		 * Decode tile rows using the thread pool.
+		 * Only one thread may call this function at a time.
+		 * @param tilesY	[in] Number of tile rows.
+		 * @param func		[in] Tile row decoding function.
+		 * @param param		[in] User parameter.
+		 * @return True if decoded; false if the pool has no worker threads.
+		 */
+		bool run(unsigned int tilesY, ImageDecoderPrivate::TileRowFunc func, void *param);
+
+	private:
+		/**
+		 * Worker thread function.
+		 * @param param DecoderThreadPool.
+		 */
+		static void workerProc(void *param);
+
+		/**
+		 * Decode bands until there are no bands left.
+		 */
+		void decodeBands(void);
+
+	private:
+		Thread *m_threads;
+		unsigned int m_threadCount;	// Number of worker threads.
+
+		Semaphore m_semStart;		// Released once per worker to start a job.
+		Semaphore m_semDone;		// Released by each worker when it's done.
+		volatile bool m_quit;		// Set to stop the worker threads.
+
+		// Current job.
+		ImageDecoderPrivate::TileRowFunc m_func;
+		void *m_param;
+		unsigned int m_tilesY;
+		unsigned int m_bandRows;
+		unsigned int m_bandCount;
+		volatile int m_nextBand;
+};
+
+// Shared thread pool.
+// Only one image can be decoded by the pool at a time.
+// If another thread tries to use the pool while it's busy,
+// the image is decoded on that thread instead. This prevents
+// oversubscription when multiple thumbnails are being created
+// at the same time.
+// NOTE: The pool isn't allocated until it's used.
+static DecoderThreadPool *decoderThreadPool = nullptr;
+static volatile int decoderThreadPoolBusy = 0;	// Non-zero if the pool is in use.
+
+/**
+ * Create a thread pool and start the worker threads.
+ * If no threads can be started, the pool is still valid,
+ * but run() will always return false.
+ */
+DecoderThreadPool::DecoderThreadPool()
+	: m_threads(nullptr)
+	, m_threadCount(0)
+	, m_semStart(0)
+	, m_semDone(0)
+	, m_quit(false)
+	, m_func(nullptr)
+	, m_param(nullptr)
+	, m_tilesY(0)
+	, m_bandRows(0)
+	, m_bandCount(0)
+	, m_nextBand(0)
+{
+	// The calling thread also decodes bands,
+	// so we need one less worker thread than
+	// the number of CPUs.
+	unsigned int count = Thread::cpuCount();
+	if (count > MAX_THREADS) {
+		count = MAX_THREADS;
+	}
+	count--;
+	if (count == 0) {
+		// Only one CPU. Don't bother with threads.
+		return;
+	}
+
+	m_threads = new Thread[count];
+	for (unsigned int i = 0; i < count; i++) {
+		if (m_threads[i].start(workerProc, this) != 0) {
+			// Unable to start the thread.
+			// Use the threads that were started.
+			break;
+		}
+		m_threadCount++;
+	}
+}
+
+/**
+ * Stop the worker threads and delete the thread pool.
+ * The pool must not be in use.
+ */
+DecoderThreadPool::~DecoderThreadPool()
+{
+	// Stop the worker threads.
+	m_quit = true;
+	for (unsigned int i = 0; i < m_threadCount; i++) {
+		m_semStart.release();
+	}
+	for (unsigned int i = 0; i < m_threadCount; i++) {
+		m_threads[i].join();
+	}
+	delete[] m_threads;
+}
+
+/**
+ * Worker thread function.
+ * @param param DecoderThreadPool.
+ */
+void DecoderThreadPool::workerProc(void *param)
+{
+	DecoderThreadPool *const pool = static_cast<DecoderThreadPool*>(param);
+	while (true) {
+		pool->m_semStart.obtain();
+		if (pool->m_quit)
+			break;
+
+		pool->decodeBands();
+		pool->m_semDone.release();
+	}
+}
+
+/**
+ * Decode bands until there are no bands left.
+ */
+void DecoderThreadPool::decodeBands(void)
+{
+	while (true) {
+		const unsigned int band = static_cast<unsigned int>(ATOMIC_INC_FETCH(&m_nextBand) - 1);
+		if (band >= m_bandCount)
+			break;
+
+		const unsigned int y_start = band * m_bandRows;
+		unsigned int y_end = y_start + m_bandRows;
+		if (y_end > m_tilesY) {
+			y_end = m_tilesY;
+		}
+		m_func(m_param, y_start, y_end);
+	}
+}
+
+/**
+ * Decode tile rows using the thread pool.
+ * Only one thread may call this function at a time.
+ * @param tilesY	[in] Number of tile rows.
+ * @param func		[in] Tile row decoding function.
+ * @param param		[in] User parameter.
+ * @return True if decoded; false if the pool has no worker threads.
+ */
+bool DecoderThreadPool::run(unsigned int tilesY, ImageDecoderPrivate::TileRowFunc func, void *param)
+{
+	if (m_threadCount == 0) {
+		// No worker threads.
+		return false;
+	}
+
+	// Split the tile rows into bands.
+	unsigned int bandCount = (m_threadCount + 1) * BANDS_PER_THREAD;
+	if (bandCount > tilesY) {
+		bandCount = tilesY;
+	}
+	m_func = func;
+	m_param = param;
+	m_tilesY = tilesY;
+	m_bandRows = (tilesY + bandCount - 1) / bandCount;
+	m_bandCount = (tilesY + m_bandRows - 1) / m_bandRows;
+	m_nextBand = 0;
+
+	// Start the workers, then help out.
+	for (unsigned int i = 0; i < m_threadCount; i++) {
+		m_semStart.release();
+	}
+	decodeBands();
+
+	// Wait for the workers to finish.
+	for (unsigned int i = 0; i < m_threadCount; i++) {
+		m_semDone.obtain();
+	}
+	return true;
+}
+
+/**
+ * Decode tile rows using the shared decoder thread pool.
+ *
+ * The tile rows are split into bands, which are decoded
+ * by the worker threads and the calling thread. If the
+ * pool is already in use, or if the system only has one
+ * CPU, all tile rows are decoded on the calling thread.
+ *
+ * Each band must be independent of the other bands,
+ * i.e. the source data for tile row y must be located
+ * without decoding tile rows [0, y).
+ *
+ * @param tilesY	[in] Number of tile rows.
+ * @param func		[in] Tile row decoding function.
+ * @param param		[in] User parameter.
+ */
+void ImageDecoderPrivate::decodeTileRows_mt(unsigned int tilesY, TileRowFunc func, void *param)
+{
+	if (ATOMIC_CMPXCHG(&decoderThreadPoolBusy, 0, 1) != 0) {
+		// Pool is busy. Decode everything on this thread.
+		func(param, 0, tilesY);
+		return;
+	}
+
+	if (!decoderThreadPool) {
+		decoderThreadPool = new DecoderThreadPool();
+	}
+	if (!decoderThreadPool->run(tilesY, func, param)) {
+		// Pool is unavailable. Decode everything on this thread.
+		func(param, 0, tilesY);
+	}
+
+	ATOMIC_EXCHANGE(&decoderThreadPoolBusy, 0);
+}
+
+/** Thread pool management **/
+
+/**
+ * Shut down the shared decoder thread pool.
+ *
+ * The worker threads are stopped and joined. If an image is
+ * decoded afterwards, a new thread pool will be started.
+ *
+ * This must NOT be called from a global destructor or from
+ * DllMain(), since joining threads there may deadlock.
+ *
+ * @return True if the pool was shut down or wasn't running; false if it's in use.
+ */
+bool ImageDecoder::shutdownThreadPool(void)
+{
+	if (ATOMIC_CMPXCHG(&decoderThreadPoolBusy, 0, 1) != 0) {
+		// Pool is in use.
+		return false;
+	}
+
+	delete decoderThreadPool;
+	decoderThreadPool = nullptr;
+
+	ATOMIC_EXCHANGE(&decoderThreadPoolBusy, 0);
+	return true;
+}
+
+}
@@ -59,6 +59,72 @@ class ImageDecoderPrivate
 		static inline void BlitTile_CI4_LeftLSN(
 			rp_image *RESTRICT img, const uint8_t *RESTRICT tileBuf,
 			unsigned int tileX, unsigned int tileY);
+
+	public:
+		/**
+		 * Minimum number of pixels in an image before
+		 * tile rows are decoded using multiple threads.
+		 */
+		static const unsigned int MT_MIN_PIXELS = 512*512;
+
+		/**
+		 * Tile row decoding function.
+		 * @param param		[in] User parameter.
+		 * @param y_start	[in] First tile row to decode.
+		 * @param y_end		[in] One past the last tile row to decode.
+		 */
+		typedef void (*TileRowFunc)(void *param, unsigned int y_start, unsigned int y_end);
+
+		/**
+		 * Decode tile rows using the shared decoder thread pool.
+		 *
+		 * The tile rows are split into bands, which are decoded
+		 * by the worker threads and the calling thread. If the
+		 * pool is already in use, or if the system only has one
+		 * CPU, all tile rows are decoded on the calling thread.
+		 *
+		 * Each band must be independent of the other bands,
+		 * i.e. the source data for tile row y must be located
+		 * without decoding tile rows [0, y).
+		 *
+		 * @param tilesY	[in] Number of tile rows.
+		 * @param func		[in] Tile row decoding function.
+		 * @param param		[in] User parameter.
+		 */
+		static void decodeTileRows_mt(unsigned int tilesY, TileRowFunc func, void *param);
+
+		/**
+		 * Decode tile rows, using multiple threads if the image is large enough.
+		 * @tparam Func		[in] Functor type: void(unsigned int y_start, unsigned int y_end)
+		 * @param tilesY	[in] Number of tile rows.
+		 * @param pixels	[in] Total number of pixels in the image.
+		 * @param func		[in] Tile row decoding functor.
+		 */
+		template<typename Func>
+		static inline void decodeTileRows(unsigned int tilesY, unsigned int pixels, const Func &func)
+		{
+			if (pixels < MT_MIN_PIXELS || tilesY < 2) {
+				// Image is too small to benefit from threading.
+				func(0, tilesY);
+				return;
+			}
+			decodeTileRows_mt(tilesY, tileRowTrampoline<Func>,
+				const_cast<void*>(static_cast<const void*>(&func)));
+		}
+
+	private:
+		/**
+		 * TileRowFunc trampoline for decodeTileRows().
+		 * @tparam Func		[in] Functor type.
+		 * @param param		[in] Functor.
+		 * @param y_start	[in] First tile row to decode.
+		 * @param y_end		[in] One past the last tile row to decode.
+		 */
+		template<typename Func>
+		static void tileRowTrampoline(void *param, unsigned int y_start, unsigned int y_end)
+		{
+			(*static_cast<const Func*>(param))(y_start, y_end);
+		}
 };
 
 /**
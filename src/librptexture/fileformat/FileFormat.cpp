@@ -169,4 +169,41 @@ int FileFormat::getDimensions(int pBuf[3]) const
 	return 0;
 }
 
+/**
+ * Get the smallest mipmap that's at least the requested size.
+ * This can be used for thumbnails to avoid decoding the full
+ * image if a smaller mipmap is available.
+ * If that mipmap can't be decoded, the full image is returned.
+ * @param req_size Requested size. (single dimension; assuming square image)
+ * @return Image, or nullptr on error.
+ */
+const rp_image *FileFormat::mipmapForSize(int req_size) const
+{
+	RP_D(const FileFormat);
+	const int mipmapCount = this->mipmapCount();
+	if (req_size <= 0 || mipmapCount <= 1 ||
+	    d->dimensions[0] <= 0 || d->dimensions[1] <= 0)
+	{
+		// No mipmaps, or the full image was requested.
+		return this->image();
+	}
+
+	// Thumbnails are scaled to fit within req_size x req_size,
+	// so only the larger dimension needs to be checked.
+	// Each mipmap is half the size of the previous one.
+	const int largest = std::max(d->dimensions[0], d->dimensions[1]);
+	int mip = 0;
+	while (mip + 1 < mipmapCount && mip + 1 < 32 && (largest >> (mip + 1)) >= req_size) {
+		mip++;
+	}
+
+	if (mip > 0) {
+		const rp_image *const img = this->mipmap(mip);
+		if (img) {
+			return img;
+		}
+	}
+	return this->image();
+}
+
 }
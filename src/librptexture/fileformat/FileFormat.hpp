@@ -200,6 +200,16 @@ class FileFormat
 		 * @return Image, or nullptr on error.
 		 */
 		virtual const rp_image *mipmap(int mip) const = 0;
+
+		/**
+		 * Get the smallest mipmap that's at least the requested size.
+		 * This can be used for thumbnails to avoid decoding the full
+		 * image if a smaller mipmap is available.
+		 * If that mipmap can't be decoded, the full image is returned.
+		 * @param req_size Requested size. (single dimension; assuming square image)
+		 * @return Image, or nullptr on error.
+		 */
+		const rp_image *mipmapForSize(int req_size) const;
 };
 
 }
@@ -407,8 +407,9 @@ const rp_image *PowerVR3Private::loadImage(int mip)
 
 	// If we're requesting a mipmap level higher than 0 (full image),
 	// adjust the start address, expected size, and dimensions.
+	// NOTE: Don't modify mip here; it's needed to cache the image.
 	unsigned int start_addr = texDataStartAddr;
-	for (; mip > 0; mip--) {
+	for (int i = mip; i > 0; i--) {
 		width /= 2;
 		height /= 2;
 
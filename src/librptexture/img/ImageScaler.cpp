@@ -0,0 +1,329 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageScaler.cpp: Image scaling functions.                               *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageScaler.hpp"
+#include "ImageScaler_p.hpp"
+#include "rp_image.hpp"
+
+// C++ STL classes.
+using std::unique_ptr;
+
+namespace LibRpTexture { namespace ImageScaler {
+
+/**
+ * Calculate the contributions for area averaging.
+ * @param src_size Source size.
+ * @param dest_size Destination size. (must be <= src_size)
+ */
+void Contribs::init(int src_size, int dest_size)
+{
+	assert(src_size > 0);
+	assert(dest_size > 0);
+	assert(dest_size <= src_size);
+
+	// Each destination pixel covers src_size/dest_size source pixels,
+	// which may start and end in the middle of a source pixel.
+	max_count = ((src_size + dest_size - 1) / dest_size) + 1;
+	start.resize(dest_size);
+	count.resize(dest_size);
+	weights.assign(static_cast<size_t>(dest_size) * max_count, 0.0f);
+
+	// Positions are measured in units of 1/dest_size source pixels,
+	// so destination pixel i covers [i*src_size, (i+1)*src_size),
+	// and source pixel j covers [j*dest_size, (j+1)*dest_size).
+	const float inv_src_size = 1.0f / static_cast<float>(src_size);
+	for (int i = 0; i < dest_size; i++) {
+		const int64_t lo = static_cast<int64_t>(i) * src_size;
+		const int64_t hi = lo + src_size;
+		const int j0 = static_cast<int>(lo / dest_size);
+		int j1 = static_cast<int>((hi + dest_size - 1) / dest_size);
+		if (j1 > src_size) {
+			j1 = src_size;
+		}
+		assert(j1 - j0 <= max_count);
+
+		start[i] = j0;
+		count[i] = j1 - j0;
+		float *const w = &weights[static_cast<size_t>(i) * max_count];
+		for (int j = j0; j < j1; j++) {
+			const int64_t px_lo = std::max(lo, static_cast<int64_t>(j) * dest_size);
+			const int64_t px_hi = std::min(hi, static_cast<int64_t>(j + 1) * dest_size);
+			w[j - j0] = static_cast<float>(px_hi - px_lo) * inv_src_size;
+		}
+	}
+}
+
+/**
+ * Downscale an image using area averaging.
+ * Internal function used by the CPU-specific versions.
+ * @param img		[in] Source image. (ARGB32 or CI8)
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @param accum_row	[in] Row accumulation function.
+ * @param reduce_row	[in] Row reduction function.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_int(const rp_image *img, int width, int height,
+	pfn_accum_row_t accum_row, pfn_reduce_row_t reduce_row)
+{
+	assert(img != nullptr);
+	assert(img->isValid());
+	assert(width > 0);
+	assert(height > 0);
+	if (!img || !img->isValid() || width <= 0 || height <= 0) {
+		// Invalid parameters.
+		return nullptr;
+	}
+
+	const int src_width = img->width();
+	const int src_height = img->height();
+	assert(width <= src_width);
+	assert(height <= src_height);
+	if (width > src_width || height > src_height) {
+		// Upscaling is not supported.
+		return nullptr;
+	}
+
+	// Convert CI8 to ARGB32 first.
+	unique_ptr<rp_image> tmp_img;
+	switch (img->format()) {
+		case rp_image::FORMAT_ARGB32:
+			break;
+		case rp_image::FORMAT_CI8:
+			tmp_img.reset(img->dup_ARGB32());
+			if (!tmp_img) {
+				// Unable to convert the image.
+				return nullptr;
+			}
+			img = tmp_img.get();
+			break;
+		default:
+			assert(!"Unsupported rp_image format.");
+			return nullptr;
+	}
+
+	rp_image *const dest_img = new rp_image(width, height, rp_image::FORMAT_ARGB32);
+	if (!dest_img->isValid()) {
+		// Could not allocate the image.
+		delete dest_img;
+		return nullptr;
+	}
+
+	Contribs h_contribs, v_contribs;
+	h_contribs.init(src_width, width);
+	v_contribs.init(src_height, height);
+
+	// Row buffer. (4 floats per pixel)
+	std::vector<float> accum(static_cast<size_t>(src_width) * 4);
+
+	for (int y = 0; y < height; y++) {
+		// Average the source rows vertically.
+		std::fill(accum.begin(), accum.end(), 0.0f);
+		const int y0 = v_contribs.start[y];
+		const float *const w = &v_contribs.weights[static_cast<size_t>(y) * v_contribs.max_count];
+		for (int k = 0; k < v_contribs.count[y]; k++) {
+			accum_row(accum.data(),
+				static_cast<const uint32_t*>(img->scanLine(y0 + k)),
+				src_width, w[k]);
+		}
+
+		// Average the row buffer horizontally.
+		reduce_row(static_cast<uint32_t*>(dest_img->scanLine(y)), accum.data(), h_contribs);
+	}
+
+	// Copy sBIT if it's set.
+	rp_image::sBIT_t sBIT;
+	if (img->get_sBIT(&sBIT) == 0) {
+		dest_img->set_sBIT(&sBIT);
+	}
+
+	return dest_img;
+}
+
+/**
+ * Accumulate a source row into the row buffer.
+ * Source pixels are converted to premultiplied alpha.
+ * @param accum		[in/out] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param src		[in] Source row. (ARGB32)
+ * @param width		[in] Row width, in pixels.
+ * @param weight	[in] Row weight.
+ */
+static void accum_row_cpp(float *RESTRICT accum, const uint32_t *RESTRICT src, int width, float weight)
+{
+	const float alpha_scale = weight * (1.0f / 255.0f);
+	for (; width > 0; width--, src++, accum += 4) {
+		argb32_t px;
+		px.u32 = *src;
+		const float wa = static_cast<float>(px.a) * alpha_scale;
+		accum[0] += static_cast<float>(px.b) * wa;
+		accum[1] += static_cast<float>(px.g) * wa;
+		accum[2] += static_cast<float>(px.r) * wa;
+		accum[3] += static_cast<float>(px.a) * weight;
+	}
+}
+
+/**
+ * Convert a float channel value to uint8_t.
+ * @param f Channel value.
+ * @return uint8_t channel value. (rounded and clamped)
+ */
+static inline uint8_t float_to_u8(float f)
+{
+	const int i = static_cast<int>(f + 0.5f);
+	return static_cast<uint8_t>(i > 255 ? 255 : (i < 0 ? 0 : i));
+}
+
+/**
+ * Average the row buffer horizontally and store ARGB32 pixels.
+ * Pixels are converted from premultiplied alpha.
+ * @param dest		[out] Destination row. (ARGB32)
+ * @param accum		[in] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param contribs	[in] Horizontal contributions.
+ */
+static void reduce_row_cpp(uint32_t *RESTRICT dest, const float *RESTRICT accum, const Contribs &contribs)
+{
+	const int dest_width = static_cast<int>(contribs.start.size());
+	const float *w = contribs.weights.data();
+	for (int x = 0; x < dest_width; x++, dest++, w += contribs.max_count) {
+		const float *px = &accum[contribs.start[x] * 4];
+		float b = 0.0f, g = 0.0f, r = 0.0f, a = 0.0f;
+		for (int k = 0; k < contribs.count[x]; k++, px += 4) {
+			b += px[0] * w[k];
+			g += px[1] * w[k];
+			r += px[2] * w[k];
+			a += px[3] * w[k];
+		}
+
+		if (a < 0.5f) {
+			// Fully transparent.
+			*dest = 0;
+			continue;
+		}
+
+		// Un-premultiply the color channels.
+		const float factor = 255.0f / a;
+		argb32_t out;
+		out.b = float_to_u8(b * factor);
+		out.g = float_to_u8(g * factor);
+		out.r = float_to_u8(r * factor);
+		out.a = float_to_u8(a);
+		*dest = out.u32;
+	}
+}
+
+/**
+ * Downscale an image using area averaging.
+ * Standard version using regular C++ code.
+ *
+ * Each destination pixel is the average of the source pixels
+ * it covers, weighted by coverage. Color channels are averaged
+ * using premultiplied alpha, so fully transparent pixels don't
+ * affect the color of the result.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_cpp(const rp_image *img, int width, int height)
+{
+	return downscale_int(img, width, height, accum_row_cpp, reduce_row_cpp);
+}
+
+/**
+ * Downscale an image using nearest-neighbor sampling.
+ *
+ * This is used for pixel art, which shouldn't be blurred.
+ * Each destination pixel is the source pixel at its center.
+ *
+ * The source image must be ARGB32 or CI8. The returned image
+ * has the same format and palette as the source image.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_nearest(const rp_image *img, int width, int height)
+{
+	assert(img != nullptr);
+	assert(img->isValid());
+	assert(width > 0);
+	assert(height > 0);
+	if (!img || !img->isValid() || width <= 0 || height <= 0) {
+		// Invalid parameters.
+		return nullptr;
+	}
+
+	const int src_width = img->width();
+	const int src_height = img->height();
+	assert(width <= src_width);
+	assert(height <= src_height);
+	if (width > src_width || height > src_height) {
+		// Upscaling is not supported.
+		return nullptr;
+	}
+
+	const rp_image::Format format = img->format();
+	if (format != rp_image::FORMAT_ARGB32 && format != rp_image::FORMAT_CI8) {
+		assert(!"Unsupported rp_image format.");
+		return nullptr;
+	}
+
+	rp_image *const dest_img = new rp_image(width, height, format);
+	if (!dest_img->isValid()) {
+		// Could not allocate the image.
+		delete dest_img;
+		return nullptr;
+	}
+
+	// Source column for each destination column.
+	std::vector<int> src_x(width);
+	for (int x = 0; x < width; x++) {
+		src_x[x] = static_cast<int>(((static_cast<int64_t>(x) * 2 + 1) * src_width) / (static_cast<int64_t>(width) * 2));
+	}
+
+	for (int y = 0; y < height; y++) {
+		const int sy = static_cast<int>(((static_cast<int64_t>(y) * 2 + 1) * src_height) / (static_cast<int64_t>(height) * 2));
+		if (format == rp_image::FORMAT_ARGB32) {
+			const uint32_t *const src = static_cast<const uint32_t*>(img->scanLine(sy));
+			uint32_t *dest = static_cast<uint32_t*>(dest_img->scanLine(y));
+			for (int x = 0; x < width; x++, dest++) {
+				*dest = src[src_x[x]];
+			}
+		} else {
+			const uint8_t *const src = static_cast<const uint8_t*>(img->scanLine(sy));
+			uint8_t *dest = static_cast<uint8_t*>(dest_img->scanLine(y));
+			for (int x = 0; x < width; x++, dest++) {
+				*dest = src[src_x[x]];
+			}
+		}
+	}
+
+	if (format == rp_image::FORMAT_CI8) {
+		// Copy the palette.
+		const int palette_len = std::min(img->palette_len(), dest_img->palette_len());
+		memcpy(dest_img->palette(), img->palette(), palette_len * sizeof(uint32_t));
+		dest_img->set_tr_idx(img->tr_idx());
+	}
+
+	// Copy sBIT if it's set.
+	rp_image::sBIT_t sBIT;
+	if (img->get_sBIT(&sBIT) == 0) {
+		dest_img->set_sBIT(&sBIT);
+	}
+
+	return dest_img;
+}
+
+} }
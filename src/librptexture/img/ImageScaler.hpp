@@ -0,0 +1,165 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageScaler.hpp: Image scaling functions.                               *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_IMG_IMAGESCALER_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_IMG_IMAGESCALER_HPP__
+
+#include "common.h"
+#include "librpcpu/cpu_dispatch.h"
+
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+# include "librpcpu/cpuflags_x86.h"
+# define IMAGESCALER_HAS_SSE2 1
+# define IMAGESCALER_HAS_AVX2 1
+#endif
+#ifdef RP_CPU_AMD64
+# define IMAGESCALER_ALWAYS_HAS_SSE2 1
+#endif
+
+namespace LibRpTexture {
+	class rp_image;
+}
+
+namespace LibRpTexture { namespace ImageScaler {
+
+/**
+ * Downscale an image using area averaging.
+ * Standard version using regular C++ code.
+ *
+ * Each destination pixel is the average of the source pixels
+ * it covers, weighted by coverage. Color channels are averaged
+ * using premultiplied alpha, so fully transparent pixels don't
+ * affect the color of the result.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_cpp(const rp_image *img, int width, int height);
+
+/**
+ * Downscale an image using nearest-neighbor sampling.
+ *
+ * This is used for pixel art, which shouldn't be blurred.
+ * Each destination pixel is the source pixel at its center.
+ *
+ * The source image must be ARGB32 or CI8. The returned image
+ * has the same format and palette as the source image.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_nearest(const rp_image *img, int width, int height);
+
+#ifdef IMAGESCALER_HAS_SSE2
+/**
+ * Downscale an image using area averaging.
+ * SSE2-optimized version.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_sse2(const rp_image *img, int width, int height);
+#endif /* IMAGESCALER_HAS_SSE2 */
+
+#ifdef IMAGESCALER_HAS_AVX2
+/**
+ * Downscale an image using area averaging.
+ * AVX2-optimized version.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_avx2(const rp_image *img, int width, int height);
+#endif /* IMAGESCALER_HAS_AVX2 */
+
+/**
+ * Downscale an image using area averaging.
+ *
+ * Each destination pixel is the average of the source pixels
+ * it covers, weighted by coverage. Color channels are averaged
+ * using premultiplied alpha, so fully transparent pixels don't
+ * affect the color of the result.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+IFUNC_STATIC_INLINE rp_image *downscale(const rp_image *img, int width, int height);
+
+#if !defined(RP_HAS_IFUNC) || (!defined(RP_CPU_I386) && !defined(RP_CPU_AMD64))
+
+// System does not support IFUNC, or we aren't guaranteed to have
+// optimizations for these CPUs. Use standard inline dispatch.
+
+/**
+ * Downscale an image using area averaging.
+ *
+ * Each destination pixel is the average of the source pixels
+ * it covers, weighted by coverage. Color channels are averaged
+ * using premultiplied alpha, so fully transparent pixels don't
+ * affect the color of the result.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+static inline rp_image *downscale(const rp_image *img, int width, int height)
+{
+#ifdef IMAGESCALER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return downscale_avx2(img, width, height);
+	} else
+#endif /* IMAGESCALER_HAS_AVX2 */
+#ifdef IMAGESCALER_ALWAYS_HAS_SSE2
+	{
+		// amd64 always has SSE2.
+		return downscale_sse2(img, width, height);
+	}
+#else /* !IMAGESCALER_ALWAYS_HAS_SSE2 */
+# ifdef IMAGESCALER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return downscale_sse2(img, width, height);
+	} else
+# endif /* IMAGESCALER_HAS_SSE2 */
+	{
+		return downscale_cpp(img, width, height);
+	}
+#endif /* IMAGESCALER_ALWAYS_HAS_SSE2 */
+}
+
+#endif /* !defined(RP_HAS_IFUNC) || (!defined(RP_CPU_I386) && !defined(RP_CPU_AMD64)) */
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_IMG_IMAGESCALER_HPP__ */
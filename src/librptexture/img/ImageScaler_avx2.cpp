@@ -0,0 +1,96 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageScaler_avx2.cpp: Image scaling functions.                          *
+ * AVX2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageScaler.hpp"
+#include "ImageScaler_p.hpp"
+
+// AVX2 intrinsics.
+#include <immintrin.h>
+
+namespace LibRpTexture { namespace ImageScaler {
+
+/**
+ * Premultiply two pixels and multiply them by a weight.
+ * @param px		[in] Pixels. (B, G, R, A as floats; one pixel per 128-bit lane)
+ * @param weight	[in] Weight. (all lanes)
+ * @return Premultiplied, weighted pixels.
+ */
+static FORCEINLINE __m256 premultiply_weight_avx2(__m256 px, __m256 weight)
+{
+	// Color channels are multiplied by A/255; alpha by 1.0.
+	const __m256 inv255 = _mm256_set1_ps(1.0f / 255.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	__m256 scale = _mm256_shuffle_ps(px, px, _MM_SHUFFLE(3,3,3,3));
+	scale = _mm256_blend_ps(_mm256_mul_ps(scale, inv255), one, 0x88);
+	return _mm256_mul_ps(px, _mm256_mul_ps(scale, weight));
+}
+
+/**
+ * Accumulate a source row into the row buffer.
+ * Source pixels are converted to premultiplied alpha.
+ * AVX2-optimized version.
+ * @param accum		[in/out] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param src		[in] Source row. (ARGB32)
+ * @param width		[in] Row width, in pixels.
+ * @param weight	[in] Row weight.
+ */
+static void accum_row_avx2(float *RESTRICT accum, const uint32_t *RESTRICT src, int width, float weight)
+{
+	const __m256 vweight = _mm256_set1_ps(weight);
+
+	// Process 4 pixels per iteration.
+	for (; width > 3; width -= 4, src += 4, accum += 16) {
+		const __m128i px8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m256 px01 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(px8));
+		const __m256 px23 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(px8, 8)));
+
+		_mm256_storeu_ps(&accum[0], _mm256_add_ps(_mm256_loadu_ps(&accum[0]), premultiply_weight_avx2(px01, vweight)));
+		_mm256_storeu_ps(&accum[8], _mm256_add_ps(_mm256_loadu_ps(&accum[8]), premultiply_weight_avx2(px23, vweight)));
+	}
+
+	// Remaining pixels.
+	for (; width > 1; width -= 2, src += 2, accum += 8) {
+		const __m128i px8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+		const __m256 px01 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(px8));
+		_mm256_storeu_ps(accum, _mm256_add_ps(_mm256_loadu_ps(accum), premultiply_weight_avx2(px01, vweight)));
+	}
+	if (width > 0) {
+		// Last pixel. Use the low 128-bit lane only.
+		const __m128i px8 = _mm_cvtsi32_si128(static_cast<int>(*src));
+		const __m256 px = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(px8));
+		const __m128 px_w = _mm256_castps256_ps128(premultiply_weight_avx2(px, vweight));
+		_mm_storeu_ps(accum, _mm_add_ps(_mm_loadu_ps(accum), px_w));
+	}
+
+	// Avoid AVX-SSE transition penalties.
+	_mm256_zeroupper();
+}
+
+/**
+ * Downscale an image using area averaging.
+ * AVX2-optimized version.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_avx2(const rp_image *img, int width, int height)
+{
+	// NOTE: The horizontal pass works on one pixel (4 floats)
+	// at a time, so the SSE2 version is used for that.
+	return downscale_int(img, width, height, accum_row_avx2, reduce_row_sse2);
+}
+
+} }
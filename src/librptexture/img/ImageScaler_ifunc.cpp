@@ -0,0 +1,52 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageScaler_ifunc.cpp: ImageScaler IFUNC resolution functions.          *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "librpcpu/cpu_dispatch.h"
+
+#ifdef RP_HAS_IFUNC
+
+#include "ImageScaler.hpp"
+using namespace LibRpTexture;
+
+// IFUNC attribute doesn't support C++ name mangling.
+extern "C" {
+
+/**
+ * IFUNC resolver function for downscale().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageScaler::downscale_cpp) downscale_resolve(void)
+{
+#ifdef IMAGESCALER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageScaler::downscale_avx2;
+	} else
+#endif /* IMAGESCALER_HAS_AVX2 */
+#ifdef IMAGESCALER_ALWAYS_HAS_SSE2
+	{
+		return &ImageScaler::downscale_sse2;
+	}
+#else /* !IMAGESCALER_ALWAYS_HAS_SSE2 */
+# ifdef IMAGESCALER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return &ImageScaler::downscale_sse2;
+	} else
+# endif /* IMAGESCALER_HAS_SSE2 */
+	{
+		return &ImageScaler::downscale_cpp;
+	}
+#endif /* IMAGESCALER_ALWAYS_HAS_SSE2 */
+}
+
+}
+
+rp_image *ImageScaler::downscale(const rp_image *img, int width, int height)
+	IFUNC_ATTR(downscale_resolve);
+
+#endif /* RP_HAS_IFUNC */
@@ -0,0 +1,88 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageScaler_p.hpp: Image scaling functions. (PRIVATE NAMESPACE)         *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_IMG_IMAGESCALER_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_IMG_IMAGESCALER_P_HPP__
+
+#include "ImageScaler.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <vector>
+
+namespace LibRpTexture { namespace ImageScaler {
+
+/**
+ * Source pixel contributions for one dimension.
+ *
+ * Destination pixel i is the weighted sum of count[i] source pixels,
+ * starting at start[i]. The weights for destination pixel i are stored
+ * at weights[i * max_count], and they add up to 1.0.
+ */
+struct Contribs {
+	std::vector<int> start;
+	std::vector<int> count;
+	std::vector<float> weights;
+	int max_count;
+
+	/**
+	 * Calculate the contributions for area averaging.
+	 * @param src_size Source size.
+	 * @param dest_size Destination size. (must be <= src_size)
+	 */
+	void init(int src_size, int dest_size);
+};
+
+/**
+ * Accumulate a source row into the row buffer.
+ * Source pixels are converted to premultiplied alpha.
+ * @param accum		[in/out] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param src		[in] Source row. (ARGB32)
+ * @param width		[in] Row width, in pixels.
+ * @param weight	[in] Row weight.
+ */
+typedef void (*pfn_accum_row_t)(float *RESTRICT accum, const uint32_t *RESTRICT src, int width, float weight);
+
+/**
+ * Average the row buffer horizontally and store ARGB32 pixels.
+ * Pixels are converted from premultiplied alpha.
+ * @param dest		[out] Destination row. (ARGB32)
+ * @param accum		[in] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param contribs	[in] Horizontal contributions.
+ */
+typedef void (*pfn_reduce_row_t)(uint32_t *RESTRICT dest, const float *RESTRICT accum, const Contribs &contribs);
+
+/**
+ * Downscale an image using area averaging.
+ * Internal function used by the CPU-specific versions.
+ * @param img		[in] Source image. (ARGB32 or CI8)
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @param accum_row	[in] Row accumulation function.
+ * @param reduce_row	[in] Row reduction function.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_int(const rp_image *img, int width, int height,
+	pfn_accum_row_t accum_row, pfn_reduce_row_t reduce_row);
+
+#ifdef IMAGESCALER_HAS_SSE2
+/**
+ * Average the row buffer horizontally and store ARGB32 pixels.
+ * SSE2-optimized version.
+ * @param dest		[out] Destination row. (ARGB32)
+ * @param accum		[in] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param contribs	[in] Horizontal contributions.
+ */
+void reduce_row_sse2(uint32_t *RESTRICT dest, const float *RESTRICT accum, const Contribs &contribs);
+#endif /* IMAGESCALER_HAS_SSE2 */
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_IMG_IMAGESCALER_P_HPP__ */
@@ -0,0 +1,138 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageScaler_sse2.cpp: Image scaling functions.                          *
+ * SSE2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageScaler.hpp"
+#include "ImageScaler_p.hpp"
+
+// SSE2 intrinsics.
+#include <emmintrin.h>
+
+namespace LibRpTexture { namespace ImageScaler {
+
+/**
+ * Premultiply a pixel and multiply it by a weight.
+ * @param px		[in] Pixel. (B, G, R, A as floats)
+ * @param weight	[in] Weight. (all lanes)
+ * @return Premultiplied, weighted pixel.
+ */
+static FORCEINLINE __m128 premultiply_weight_sse2(__m128 px, __m128 weight)
+{
+	// Lanes 0-2 (color) are multiplied by A/255; lane 3 (alpha) by 1.0.
+	const __m128 color_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	const __m128 alpha_one = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+
+	__m128 scale = _mm_shuffle_ps(px, px, _MM_SHUFFLE(3,3,3,3));
+	scale = _mm_or_ps(_mm_and_ps(_mm_mul_ps(scale, inv255), color_mask), alpha_one);
+	return _mm_mul_ps(px, _mm_mul_ps(scale, weight));
+}
+
+/**
+ * Accumulate a source row into the row buffer.
+ * Source pixels are converted to premultiplied alpha.
+ * SSE2-optimized version.
+ * @param accum		[in/out] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param src		[in] Source row. (ARGB32)
+ * @param width		[in] Row width, in pixels.
+ * @param weight	[in] Row weight.
+ */
+static void accum_row_sse2(float *RESTRICT accum, const uint32_t *RESTRICT src, int width, float weight)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 vweight = _mm_set1_ps(weight);
+
+	// Process 4 pixels per iteration.
+	for (; width > 3; width -= 4, src += 4, accum += 16) {
+		const __m128i px8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i px16_lo = _mm_unpacklo_epi8(px8, zero);
+		const __m128i px16_hi = _mm_unpackhi_epi8(px8, zero);
+
+		const __m128 px0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(px16_lo, zero));
+		const __m128 px1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(px16_lo, zero));
+		const __m128 px2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(px16_hi, zero));
+		const __m128 px3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(px16_hi, zero));
+
+		_mm_storeu_ps(&accum[ 0], _mm_add_ps(_mm_loadu_ps(&accum[ 0]), premultiply_weight_sse2(px0, vweight)));
+		_mm_storeu_ps(&accum[ 4], _mm_add_ps(_mm_loadu_ps(&accum[ 4]), premultiply_weight_sse2(px1, vweight)));
+		_mm_storeu_ps(&accum[ 8], _mm_add_ps(_mm_loadu_ps(&accum[ 8]), premultiply_weight_sse2(px2, vweight)));
+		_mm_storeu_ps(&accum[12], _mm_add_ps(_mm_loadu_ps(&accum[12]), premultiply_weight_sse2(px3, vweight)));
+	}
+
+	// Remaining pixels.
+	for (; width > 0; width--, src++, accum += 4) {
+		__m128i px32 = _mm_cvtsi32_si128(static_cast<int>(*src));
+		px32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(px32, zero), zero);
+		const __m128 px = _mm_cvtepi32_ps(px32);
+		_mm_storeu_ps(accum, _mm_add_ps(_mm_loadu_ps(accum), premultiply_weight_sse2(px, vweight)));
+	}
+}
+
+/**
+ * Average the row buffer horizontally and store ARGB32 pixels.
+ * Pixels are converted from premultiplied alpha.
+ * SSE2-optimized version.
+ * @param dest		[out] Destination row. (ARGB32)
+ * @param accum		[in] Row buffer. (4 floats per pixel: B, G, R, A)
+ * @param contribs	[in] Horizontal contributions.
+ */
+void reduce_row_sse2(uint32_t *RESTRICT dest, const float *RESTRICT accum, const Contribs &contribs)
+{
+	const __m128 color_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	const __m128 alpha_one = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	const __m128 v255 = _mm_set1_ps(255.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	const int dest_width = static_cast<int>(contribs.start.size());
+	const float *w = contribs.weights.data();
+	for (int x = 0; x < dest_width; x++, dest++, w += contribs.max_count) {
+		const float *px = &accum[contribs.start[x] * 4];
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < contribs.count[x]; k++, px += 4) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(px), _mm_set1_ps(w[k])));
+		}
+
+		const __m128 alpha = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3,3,3,3));
+		if (_mm_cvtss_f32(alpha) < 0.5f) {
+			// Fully transparent.
+			*dest = 0;
+			continue;
+		}
+
+		// Un-premultiply the color channels.
+		__m128 factor = _mm_div_ps(v255, alpha);
+		factor = _mm_or_ps(_mm_and_ps(factor, color_mask), alpha_one);
+		sum = _mm_add_ps(_mm_mul_ps(sum, factor), half);
+
+		// Convert to ARGB32. (saturated)
+		__m128i px32 = _mm_cvttps_epi32(sum);
+		px32 = _mm_packs_epi32(px32, px32);
+		px32 = _mm_packus_epi16(px32, px32);
+		*dest = static_cast<uint32_t>(_mm_cvtsi128_si32(px32));
+	}
+}
+
+/**
+ * Downscale an image using area averaging.
+ * SSE2-optimized version.
+ *
+ * The source image must be ARGB32 or CI8. The returned image is ARGB32.
+ * The new dimensions must not be larger than the original dimensions.
+ *
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @return Downscaled image, or nullptr on error.
+ */
+rp_image *downscale_sse2(const rp_image *img, int width, int height)
+{
+	return downscale_int(img, width, height, accum_row_sse2, reduce_row_sse2);
+}
+
+} }
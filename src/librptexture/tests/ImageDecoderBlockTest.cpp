@@ -0,0 +1,377 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * ImageDecoderBlockTest.cpp: ImageDecoder block-compressed format tests.  *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librptexture, librpcpu
+#include "librptexture/img/rp_image.hpp"
+#include "librptexture/decoder/ImageDecoder.hpp"
+#include "librpcpu/cpu_dispatch.h"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// The SIMD block decoders are compared against the standard
+// versions using pseudo-random block data, since every block
+// is valid for these formats. (BC7 blocks get a valid mode bit.)
+
+namespace LibRpTexture { namespace Tests {
+
+typedef rp_image *(*pfnBlockDecoder_t)(int width, int height, const uint8_t *img_buf, int img_siz);
+
+struct ImageDecoderBlockTest_mode
+{
+	const char *name;		// Format name.
+	pfnBlockDecoder_t fn_cpp;	// Standard version.
+	pfnBlockDecoder_t fn_simd;	// SIMD-optimized version.
+	bool (*hasSIMD)(void);		// CPU check for fn_simd.
+	uint8_t bytesPerBlock;		// Bytes per 4x4 block.
+	bool isBC7;			// Set a valid BC7 mode bit in each block.
+	int width;			// Image width.
+	int height;			// Image height.
+
+	ImageDecoderBlockTest_mode(
+		const char *name,
+		pfnBlockDecoder_t fn_cpp,
+		pfnBlockDecoder_t fn_simd,
+		bool (*hasSIMD)(void),
+		uint8_t bytesPerBlock,
+		bool isBC7,
+		int width, int height)
+		: name(name)
+		, fn_cpp(fn_cpp)
+		, fn_simd(fn_simd)
+		, hasSIMD(hasSIMD)
+		, bytesPerBlock(bytesPerBlock)
+		, isBC7(isBC7)
+		, width(width)
+		, height(height)
+	{ }
+};
+
+class ImageDecoderBlockTest : public ::testing::TestWithParam<ImageDecoderBlockTest_mode>
+{
+	protected:
+		ImageDecoderBlockTest()
+			: ::testing::TestWithParam<ImageDecoderBlockTest_mode>()
+		{ }
+
+		void SetUp(void) final;
+
+	public:
+		/**
+		 * Compare two rp_images.
+		 * @param pImgExpected	[in] Expected image.
+		 * @param pImgActual	[in] Actual image.
+		 */
+		static void Compare_RpImage(
+			const rp_image *pImgExpected,
+			const rp_image *pImgActual);
+
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000;
+
+	public:
+		// Block-compressed image data.
+		vector<uint8_t> m_img_buf;
+
+	public:
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<ImageDecoderBlockTest_mode> &info);
+};
+
+/**
+ * Formatting function for ImageDecoderBlockTest.
+ */
+inline ::std::ostream& operator<<(::std::ostream& os, const ImageDecoderBlockTest_mode& mode) {
+	return os << mode.name << '_' << mode.width << 'x' << mode.height;
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void ImageDecoderBlockTest::SetUp(void)
+{
+	const ImageDecoderBlockTest_mode &mode = GetParam();
+
+	const unsigned int tilesX = (mode.width + 3) / 4;
+	const unsigned int tilesY = (mode.height + 3) / 4;
+	m_img_buf.resize(tilesX * tilesY * mode.bytesPerBlock);
+
+	// Fill the buffer with pseudo-random data.
+	// NOTE: Using a fixed xorshift32 seed for reproducibility.
+	uint32_t x = 0x2545F491;
+	for (auto iter = m_img_buf.begin(); iter != m_img_buf.end(); ++iter) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		*iter = static_cast<uint8_t>(x >> 24);
+	}
+
+	if (mode.isBC7) {
+		// The lowest set bit in the first byte is the BC7 mode.
+		// Make sure every block has a mode, and that all modes are used.
+		unsigned int bc7_mode = 0;
+		for (size_t i = 0; i < m_img_buf.size(); i += mode.bytesPerBlock, bc7_mode++) {
+			const uint8_t bit = (1U << (bc7_mode & 7));
+			m_img_buf[i] = (m_img_buf[i] & ~(bit - 1)) | bit;
+		}
+	}
+}
+
+/**
+ * Compare two rp_images.
+ * @param pImgExpected	[in] Expected image.
+ * @param pImgActual	[in] Actual image.
+ */
+void ImageDecoderBlockTest::Compare_RpImage(
+	const rp_image *pImgExpected,
+	const rp_image *pImgActual)
+{
+	ASSERT_EQ(pImgExpected->format(), pImgActual->format());
+	ASSERT_EQ(pImgExpected->width(), pImgActual->width());
+	ASSERT_EQ(pImgExpected->height(), pImgActual->height());
+
+	rp_image::sBIT_t sBIT_expected, sBIT_actual;
+	ASSERT_EQ(0, pImgExpected->get_sBIT(&sBIT_expected));
+	ASSERT_EQ(0, pImgActual->get_sBIT(&sBIT_actual));
+	EXPECT_EQ(0, memcmp(&sBIT_expected, &sBIT_actual, sizeof(sBIT_expected)));
+
+	const int width = pImgExpected->width();
+	const int height = pImgExpected->height();
+	for (int y = 0; y < height; y++) {
+		const uint32_t *pExpected = static_cast<const uint32_t*>(pImgExpected->scanLine(y));
+		const uint32_t *pActual = static_cast<const uint32_t*>(pImgActual->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			ASSERT_EQ(pExpected[x], pActual[x]) <<
+				"ARGB32 pixel mismatch at (" << x << "," << y << ")";
+		}
+	}
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string ImageDecoderBlockTest::test_case_suffix_generator(const ::testing::TestParamInfo<ImageDecoderBlockTest_mode> &info)
+{
+	char suffix[64];
+	snprintf(suffix, sizeof(suffix), "%s_%dx%d",
+		info.param.name, info.param.width, info.param.height);
+	return string(suffix);
+}
+
+/**
+ * Compare the SIMD-optimized decoder with the standard version.
+ */
+TEST_P(ImageDecoderBlockTest, decode_simd_test)
+{
+	const ImageDecoderBlockTest_mode &mode = GetParam();
+	if (!mode.hasSIMD()) {
+		fprintf(stderr, "*** %s SIMD decoder is not supported on this CPU. Skipping test.\n", mode.name);
+		return;
+	}
+
+	const int img_siz = static_cast<int>(m_img_buf.size());
+	unique_ptr<rp_image> pImgExpected(mode.fn_cpp(mode.width, mode.height, m_img_buf.data(), img_siz));
+	ASSERT_TRUE(pImgExpected.get() != nullptr);
+	unique_ptr<rp_image> pImgActual(mode.fn_simd(mode.width, mode.height, m_img_buf.data(), img_siz));
+	ASSERT_TRUE(pImgActual.get() != nullptr);
+
+	ASSERT_NO_FATAL_FAILURE(Compare_RpImage(pImgExpected.get(), pImgActual.get()));
+}
+
+/**
+ * Decode the image in horizontal strips and compare
+ * the strips to the full image.
+ *
+ * Large images are decoded using multiple threads, while
+ * the strips are small enough to be decoded on one thread.
+ *
+ * @param fn		[in] Block decoder.
+ * @param width		[in] Image width.
+ * @param height	[in] Image height.
+ * @param img_buf	[in] Block-compressed image data.
+ * @param bytesPerBlock	[in] Bytes per 4x4 block.
+ */
+static void checkStrips(pfnBlockDecoder_t fn, int width, int height,
+	const vector<uint8_t> &img_buf, unsigned int bytesPerBlock)
+{
+	// Strip height, in pixels. Must be a multiple of 4.
+	static const int STRIP_HEIGHT = 64;
+
+	const int img_siz = static_cast<int>(img_buf.size());
+	unique_ptr<rp_image> pImgFull(fn(width, height, img_buf.data(), img_siz));
+	ASSERT_TRUE(pImgFull.get() != nullptr);
+
+	const unsigned int tilesX = (width + 3) / 4;
+	const size_t strip_siz = tilesX * (STRIP_HEIGHT / 4) * bytesPerBlock;
+	for (int y = 0; y < height; y += STRIP_HEIGHT) {
+		const int strip_h = std::min(STRIP_HEIGHT, height - y);
+		const size_t strip_offset = (y / 4) * tilesX * bytesPerBlock;
+		const int cur_siz = static_cast<int>(std::min(strip_siz, img_buf.size() - strip_offset));
+
+		unique_ptr<rp_image> pImgStrip(fn(width, strip_h, &img_buf[strip_offset], cur_siz));
+		ASSERT_TRUE(pImgStrip.get() != nullptr);
+		ASSERT_EQ(width, pImgStrip->width());
+		ASSERT_EQ(strip_h, pImgStrip->height());
+
+		for (int sy = 0; sy < strip_h; sy++) {
+			ASSERT_EQ(0, memcmp(pImgFull->scanLine(y + sy), pImgStrip->scanLine(sy),
+				width * sizeof(uint32_t))) << "ARGB32 row mismatch at y=" << (y + sy);
+		}
+	}
+}
+
+/**
+ * Make sure multi-threaded decoding of large images
+ * matches single-threaded decoding.
+ */
+TEST_P(ImageDecoderBlockTest, decode_strip_test)
+{
+	const ImageDecoderBlockTest_mode &mode = GetParam();
+	ASSERT_NO_FATAL_FAILURE(checkStrips(mode.fn_cpp,
+		mode.width, mode.height, m_img_buf, mode.bytesPerBlock));
+	if (mode.hasSIMD()) {
+		ASSERT_NO_FATAL_FAILURE(checkStrips(mode.fn_simd,
+			mode.width, mode.height, m_img_buf, mode.bytesPerBlock));
+	}
+}
+
+/**
+ * Benchmark the standard decoder.
+ */
+TEST_P(ImageDecoderBlockTest, decode_cpp_benchmark)
+{
+	const ImageDecoderBlockTest_mode &mode = GetParam();
+	const int img_siz = static_cast<int>(m_img_buf.size());
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		unique_ptr<rp_image> pImg(mode.fn_cpp(mode.width, mode.height, m_img_buf.data(), img_siz));
+		ASSERT_TRUE(pImg.get() != nullptr);
+	}
+}
+
+/**
+ * Benchmark the SIMD-optimized decoder.
+ */
+TEST_P(ImageDecoderBlockTest, decode_simd_benchmark)
+{
+	const ImageDecoderBlockTest_mode &mode = GetParam();
+	if (!mode.hasSIMD()) {
+		fprintf(stderr, "*** %s SIMD decoder is not supported on this CPU. Skipping test.\n", mode.name);
+		return;
+	}
+
+	const int img_siz = static_cast<int>(m_img_buf.size());
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		unique_ptr<rp_image> pImg(mode.fn_simd(mode.width, mode.height, m_img_buf.data(), img_siz));
+		ASSERT_TRUE(pImg.get() != nullptr);
+	}
+}
+
+// Test cases.
+
+#ifdef IMAGEDECODER_HAS_SSSE3
+static bool hasSSSE3(void)
+{
+	return RP_CPU_HasSSSE3();
+}
+
+#define SSSE3_BLOCK_TEST(name, bytesPerBlock, width, height) \
+	ImageDecoderBlockTest_mode(#name, \
+		ImageDecoder::name##_cpp, ImageDecoder::name##_ssse3, \
+		hasSSSE3, bytesPerBlock, false, width, height)
+
+// S3TC formats allow partial tiles at the image edges.
+INSTANTIATE_TEST_CASE_P(S3TC, ImageDecoderBlockTest,
+	::testing::Values(
+		SSSE3_BLOCK_TEST(fromDXT1, 8, 256, 256),
+		SSSE3_BLOCK_TEST(fromDXT1_A1, 8, 256, 256),
+		SSSE3_BLOCK_TEST(fromDXT3, 16, 256, 256),
+		SSSE3_BLOCK_TEST(fromDXT5, 16, 256, 256),
+		SSSE3_BLOCK_TEST(fromBC4, 8, 256, 256),
+		SSSE3_BLOCK_TEST(fromBC5, 16, 256, 256),
+		SSSE3_BLOCK_TEST(fromDXT1, 8, 254, 130),
+		SSSE3_BLOCK_TEST(fromDXT5, 16, 254, 130),
+		SSSE3_BLOCK_TEST(fromBC5, 16, 254, 130),
+		SSSE3_BLOCK_TEST(fromDXT1, 8, 1024, 1024),
+		SSSE3_BLOCK_TEST(fromDXT5, 16, 1022, 1030))
+	, ImageDecoderBlockTest::test_case_suffix_generator);
+
+// ETC formats require multiples of 4.
+INSTANTIATE_TEST_CASE_P(ETC, ImageDecoderBlockTest,
+	::testing::Values(
+		SSSE3_BLOCK_TEST(fromETC1, 8, 256, 256),
+		SSSE3_BLOCK_TEST(fromETC2_RGB, 8, 256, 256),
+		SSSE3_BLOCK_TEST(fromETC2_RGBA, 16, 256, 256),
+		SSSE3_BLOCK_TEST(fromETC2_RGB_A1, 8, 256, 256),
+		SSSE3_BLOCK_TEST(fromETC2_RGBA, 16, 132, 68),
+		SSSE3_BLOCK_TEST(fromETC2_RGBA, 16, 1024, 1024))
+	, ImageDecoderBlockTest::test_case_suffix_generator);
+#endif /* IMAGEDECODER_HAS_SSSE3 */
+
+#ifdef IMAGEDECODER_HAS_SSE2
+static bool hasSSE2(void)
+{
+	return RP_CPU_HasSSE2();
+}
+
+INSTANTIATE_TEST_CASE_P(BC7, ImageDecoderBlockTest,
+	::testing::Values(
+		ImageDecoderBlockTest_mode("fromBC7",
+			ImageDecoder::fromBC7_cpp, ImageDecoder::fromBC7_sse2,
+			hasSSE2, 16, true, 256, 256),
+		ImageDecoderBlockTest_mode("fromBC7",
+			ImageDecoder::fromBC7_cpp, ImageDecoder::fromBC7_sse2,
+			hasSSE2, 16, true, 254, 130),
+		ImageDecoderBlockTest_mode("fromBC7",
+			ImageDecoder::fromBC7_cpp, ImageDecoder::fromBC7_sse2,
+			hasSSE2, 16, true, 1024, 1024))
+	, ImageDecoderBlockTest::test_case_suffix_generator);
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: ImageDecoder block-compressed format tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::ImageDecoderBlockTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,339 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * ImageScalerTest.cpp: ImageScaler tests.                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+#include "librptexture/img/ImageScaler.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+namespace LibRpTexture { namespace Tests {
+
+class ImageScalerTest : public ::testing::Test
+{
+	public:
+		// Downscale function.
+		typedef rp_image* (*pfn_downscale_t)(const rp_image *img, int width, int height);
+
+		/**
+		 * Create an ARGB32 image with pseudo-random pixels.
+		 * Some pixels are fully transparent, and some are opaque.
+		 * @param width Width.
+		 * @param height Height.
+		 * @return Image.
+		 */
+		static rp_image *makeImage(int width, int height)
+		{
+			rp_image *const img = new rp_image(width, height, rp_image::FORMAT_ARGB32);
+			uint32_t seed = 0x12345678 ^ (width << 16) ^ height;
+			for (int y = 0; y < height; y++) {
+				uint32_t *px = static_cast<uint32_t*>(img->scanLine(y));
+				for (int x = 0; x < width; x++, px++) {
+					seed = seed * 1103515245 + 12345;
+					uint32_t argb = seed ^ (seed >> 13);
+					switch ((seed >> 28) & 3) {
+						case 0:
+							argb &= 0x00FFFFFF;	// transparent
+							break;
+						case 1:
+							argb |= 0xFF000000;	// opaque
+							break;
+						default:
+							break;
+					}
+					*px = argb;
+				}
+			}
+			return img;
+		}
+
+		/**
+		 * Compare two ARGB32 images.
+		 * @param expected Expected image.
+		 * @param actual Actual image.
+		 * @param tolerance Maximum difference per channel.
+		 */
+		static void compareImages(const rp_image *expected, const rp_image *actual, int tolerance)
+		{
+			ASSERT_TRUE(expected != nullptr);
+			ASSERT_TRUE(actual != nullptr);
+			ASSERT_EQ(rp_image::FORMAT_ARGB32, actual->format());
+			ASSERT_EQ(expected->width(), actual->width());
+			ASSERT_EQ(expected->height(), actual->height());
+
+			for (int y = 0; y < expected->height(); y++) {
+				const uint8_t *const pe = static_cast<const uint8_t*>(expected->scanLine(y));
+				const uint8_t *const pa = static_cast<const uint8_t*>(actual->scanLine(y));
+				for (int i = 0; i < expected->width() * 4; i++) {
+					ASSERT_LE(abs(pe[i] - pa[i]), tolerance) <<
+						"x == " << (i / 4) << ", y == " << y << ", channel == " << (i % 4);
+				}
+			}
+		}
+
+		/**
+		 * Compare an optimized downscaler with the standard version.
+		 * @param fn Optimized downscaler.
+		 */
+		static void compareWithCpp(pfn_downscale_t fn)
+		{
+			static const struct {
+				int src_w, src_h;
+				int dest_w, dest_h;
+			} sizes[] = {
+				{512, 512, 256, 256},	// 2:1
+				{640, 480, 256, 192},	// 2.5:1
+				{333, 217, 37, 29},	// uneven
+				{1024, 64, 255, 15},	// odd widths (remainder pixels)
+				{257, 257, 256, 256},	// almost 1:1
+				{100, 100, 100, 100},	// 1:1
+				{100, 100, 1, 1},	// single pixel
+				{7, 300, 3, 7},		// narrow
+			};
+
+			for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+				unique_ptr<rp_image> src(makeImage(sizes[i].src_w, sizes[i].src_h));
+				unique_ptr<rp_image> expected(ImageScaler::downscale_cpp(src.get(), sizes[i].dest_w, sizes[i].dest_h));
+				unique_ptr<rp_image> actual(fn(src.get(), sizes[i].dest_w, sizes[i].dest_h));
+				SCOPED_TRACE(testing::Message() << sizes[i].src_w << 'x' << sizes[i].src_h <<
+					" -> " << sizes[i].dest_w << 'x' << sizes[i].dest_h);
+				// Allow for float rounding differences.
+				compareImages(expected.get(), actual.get(), 1);
+			}
+		}
+};
+
+/**
+ * Downscaling a solid color image must not change the color.
+ */
+TEST_F(ImageScalerTest, downscale_cpp_solidColor)
+{
+	unique_ptr<rp_image> src(new rp_image(300, 200, rp_image::FORMAT_ARGB32));
+	for (int y = 0; y < src->height(); y++) {
+		uint32_t *px = static_cast<uint32_t*>(src->scanLine(y));
+		for (int x = 0; x < src->width(); x++) {
+			px[x] = 0x80336699;
+		}
+	}
+
+	unique_ptr<rp_image> dest(ImageScaler::downscale_cpp(src.get(), 97, 61));
+	ASSERT_TRUE(dest != nullptr);
+	EXPECT_EQ(97, dest->width());
+	EXPECT_EQ(61, dest->height());
+	for (int y = 0; y < dest->height(); y++) {
+		const uint32_t *px = static_cast<const uint32_t*>(dest->scanLine(y));
+		for (int x = 0; x < dest->width(); x++) {
+			ASSERT_EQ(0x80336699U, px[x]) << "x == " << x << ", y == " << y;
+		}
+	}
+}
+
+/**
+ * Fully transparent pixels must not affect the color of the result.
+ */
+TEST_F(ImageScalerTest, downscale_cpp_transparency)
+{
+	// 2x1 -> 1x1: opaque red + transparent green
+	unique_ptr<rp_image> src(new rp_image(2, 1, rp_image::FORMAT_ARGB32));
+	uint32_t *const px = static_cast<uint32_t*>(src->bits());
+	px[0] = 0xFFFF0000;
+	px[1] = 0x0000FF00;
+
+	unique_ptr<rp_image> dest(ImageScaler::downscale_cpp(src.get(), 1, 1));
+	ASSERT_TRUE(dest != nullptr);
+	EXPECT_EQ(0x80FF0000U, *static_cast<const uint32_t*>(dest->bits()));
+
+	// 2x2 -> 1x1: all transparent
+	src.reset(new rp_image(2, 2, rp_image::FORMAT_ARGB32));
+	for (int y = 0; y < 2; y++) {
+		uint32_t *const row = static_cast<uint32_t*>(src->scanLine(y));
+		row[0] = 0x00FFFFFF;
+		row[1] = 0x00123456;
+	}
+	dest.reset(ImageScaler::downscale_cpp(src.get(), 1, 1));
+	ASSERT_TRUE(dest != nullptr);
+	EXPECT_EQ(0U, *static_cast<const uint32_t*>(dest->bits()));
+}
+
+/**
+ * CI8 images are converted to ARGB32.
+ */
+TEST_F(ImageScalerTest, downscale_cpp_CI8)
+{
+	unique_ptr<rp_image> src(new rp_image(64, 64, rp_image::FORMAT_CI8));
+	uint32_t *const palette = src->palette();
+	ASSERT_TRUE(palette != nullptr);
+	palette[0] = 0xFF0000FF;
+	palette[1] = 0xFFFF0000;
+	for (int y = 0; y < src->height(); y++) {
+		uint8_t *const row = static_cast<uint8_t*>(src->scanLine(y));
+		for (int x = 0; x < src->width(); x++) {
+			row[x] = (y < 32 ? 0 : 1);
+		}
+	}
+
+	unique_ptr<rp_image> dest(ImageScaler::downscale(src.get(), 2, 2));
+	ASSERT_TRUE(dest != nullptr);
+	ASSERT_EQ(rp_image::FORMAT_ARGB32, dest->format());
+	EXPECT_EQ(0xFF0000FFU, static_cast<const uint32_t*>(dest->scanLine(0))[1]);
+	EXPECT_EQ(0xFFFF0000U, static_cast<const uint32_t*>(dest->scanLine(1))[0]);
+}
+
+/**
+ * Upscaling is not supported.
+ */
+TEST_F(ImageScalerTest, downscale_upscaleFails)
+{
+	unique_ptr<rp_image> src(makeImage(16, 16));
+	unique_ptr<rp_image> dest(ImageScaler::downscale_cpp(src.get(), 32, 8));
+	EXPECT_TRUE(dest == nullptr);
+	dest.reset(ImageScaler::downscale_nearest(src.get(), 8, 32));
+	EXPECT_TRUE(dest == nullptr);
+}
+
+#ifdef IMAGESCALER_HAS_SSE2
+/**
+ * Compare the SSE2 version with the standard version.
+ */
+TEST_F(ImageScalerTest, downscale_sse2)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+	compareWithCpp(ImageScaler::downscale_sse2);
+}
+#endif /* IMAGESCALER_HAS_SSE2 */
+
+#ifdef IMAGESCALER_HAS_AVX2
+/**
+ * Compare the AVX2 version with the standard version.
+ */
+TEST_F(ImageScalerTest, downscale_avx2)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+	compareWithCpp(ImageScaler::downscale_avx2);
+}
+#endif /* IMAGESCALER_HAS_AVX2 */
+
+/**
+ * Compare the dispatch function with the standard version.
+ */
+TEST_F(ImageScalerTest, downscale_dispatch)
+{
+	compareWithCpp(ImageScaler::downscale);
+}
+
+/**
+ * Nearest-neighbor downscaling of an ARGB32 image.
+ * Pixels must not be blended.
+ */
+TEST_F(ImageScalerTest, downscale_nearest_ARGB32)
+{
+	// 4x4 checkerboard of 2x2 blocks -> 2x2
+	unique_ptr<rp_image> src(new rp_image(4, 4, rp_image::FORMAT_ARGB32));
+	for (int y = 0; y < 4; y++) {
+		uint32_t *const row = static_cast<uint32_t*>(src->scanLine(y));
+		for (int x = 0; x < 4; x++) {
+			row[x] = (((x / 2) ^ (y / 2)) & 1) ? 0xFFFFFFFF : 0xFF000000;
+		}
+	}
+
+	unique_ptr<rp_image> dest(ImageScaler::downscale_nearest(src.get(), 2, 2));
+	ASSERT_TRUE(dest != nullptr);
+	ASSERT_EQ(rp_image::FORMAT_ARGB32, dest->format());
+	const uint32_t *row0 = static_cast<const uint32_t*>(dest->scanLine(0));
+	const uint32_t *row1 = static_cast<const uint32_t*>(dest->scanLine(1));
+	EXPECT_EQ(0xFF000000U, row0[0]);
+	EXPECT_EQ(0xFFFFFFFFU, row0[1]);
+	EXPECT_EQ(0xFFFFFFFFU, row1[0]);
+	EXPECT_EQ(0xFF000000U, row1[1]);
+
+	// Uneven downscale: Every output pixel must be one of the input pixels.
+	src.reset(makeImage(97, 53));
+	dest.reset(ImageScaler::downscale_nearest(src.get(), 40, 21));
+	ASSERT_TRUE(dest != nullptr);
+	for (int y = 0; y < dest->height(); y++) {
+		const int sy = ((y * 2 + 1) * 53) / (21 * 2);
+		const uint32_t *const dest_row = static_cast<const uint32_t*>(dest->scanLine(y));
+		const uint32_t *const src_row = static_cast<const uint32_t*>(src->scanLine(sy));
+		for (int x = 0; x < dest->width(); x++) {
+			const int sx = ((x * 2 + 1) * 97) / (40 * 2);
+			ASSERT_EQ(src_row[sx], dest_row[x]) << "x == " << x << ", y == " << y;
+		}
+	}
+}
+
+/**
+ * Nearest-neighbor downscaling of a CI8 image.
+ * The format, palette, and transparent color index must be kept.
+ */
+TEST_F(ImageScalerTest, downscale_nearest_CI8)
+{
+	unique_ptr<rp_image> src(new rp_image(32, 32, rp_image::FORMAT_CI8));
+	uint32_t *const palette = src->palette();
+	ASSERT_TRUE(palette != nullptr);
+	for (int i = 0; i < src->palette_len(); i++) {
+		palette[i] = 0xFF000000 | (i * 0x010101);
+	}
+	palette[0] = 0;
+	src->set_tr_idx(0);
+	for (int y = 0; y < src->height(); y++) {
+		uint8_t *const row = static_cast<uint8_t*>(src->scanLine(y));
+		for (int x = 0; x < src->width(); x++) {
+			row[x] = static_cast<uint8_t>((y / 4) * 8 + (x / 4));
+		}
+	}
+
+	unique_ptr<rp_image> dest(ImageScaler::downscale_nearest(src.get(), 8, 8));
+	ASSERT_TRUE(dest != nullptr);
+	ASSERT_EQ(rp_image::FORMAT_CI8, dest->format());
+	EXPECT_EQ(0, dest->tr_idx());
+	ASSERT_EQ(src->palette_len(), dest->palette_len());
+	EXPECT_EQ(0, memcmp(src->palette(), dest->palette(), src->palette_len() * sizeof(uint32_t)));
+	for (int y = 0; y < 8; y++) {
+		const uint8_t *const row = static_cast<const uint8_t*>(dest->scanLine(y));
+		for (int x = 0; x < 8; x++) {
+			ASSERT_EQ(y * 8 + x, row[x]) << "x == " << x << ", y == " << y;
+		}
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: ImageScaler tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
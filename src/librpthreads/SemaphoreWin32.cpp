@@ -66,7 +66,10 @@ class Semaphore
  */
 inline Semaphore::Semaphore(int count)
 {
-	m_sem = CreateSemaphore(nullptr, count, count, nullptr);
+	// NOTE: The maximum count is not the initial count.
+	// Semaphore(0) is used as a job counter, which must be
+	// releasable, as with the POSIX and Mac implementations.
+	m_sem = CreateSemaphore(nullptr, count, LONG_MAX, nullptr);
 	assert(m_sem != nullptr);
 	if (!m_sem) {
 		// FIXME: Do something if an error occurred here...
@@ -0,0 +1,211 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpthreads)                     *
+ * ThreadPosix.cpp: POSIX thread implementation.                           *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+
+namespace LibRpBase {
+
+class Thread
+{
+	public:
+		/**
+		 * Thread function.
+		 * @param param User-specified parameter.
+		 */
+		typedef void (*ThreadFunc)(void *param);
+
+		/**
+		 * Create a thread object.
+		 * The thread isn't started until start() is called.
+		 */
+		inline explicit Thread();
+
+		/**
+		 * Delete the thread object.
+		 * If the thread is still running, it will be joined.
+		 */
+		inline ~Thread();
+
+	private:
+#if __cplusplus >= 201103L
+		Thread(const Thread &) = delete; \
+		Thread &operator=(const Thread &) = delete;
+#else /* __cplusplus < 201103L */
+		Thread(const Thread &); \
+		Thread &operator=(const Thread &);
+#endif /* __cplusplus */
+
+	public:
+		/**
+		 * Start the thread.
+		 * @param func Thread function.
+		 * @param param Parameter for the thread function.
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int start(ThreadFunc func, void *param);
+
+		/**
+		 * Wait for the thread to exit.
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int join(void);
+
+		/**
+		 * Detach the thread.
+		 * The thread keeps running, and its resources are
+		 * released when it exits. It can't be joined afterwards.
+		 * NOTE: The Thread object must remain valid until
+		 * the thread function returns.
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int detach(void);
+
+		/**
+		 * Is the thread running?
+		 * NOTE: This returns true until join() is called,
+		 * even if the thread function has returned.
+		 * @return True if the thread was started and hasn't been joined.
+		 */
+		inline bool isRunning(void) const
+		{
+			return m_isRunning;
+		}
+
+		/**
+		 * Get the number of logical CPUs available to this process.
+		 * @return Number of logical CPUs. (always at least 1)
+		 */
+		static inline unsigned int cpuCount(void);
+
+	private:
+		/**
+		 * pthread_create() trampoline.
+		 * @param arg Thread object.
+		 * @return nullptr
+		 */
+		static inline void *threadProc(void *arg);
+
+	private:
+		pthread_t m_thread;
+		ThreadFunc m_func;
+		void *m_param;
+		bool m_isRunning;
+};
+
+/**
+ * Create a thread object.
+ * The thread isn't started until start() is called.
+ */
+inline Thread::Thread()
+	: m_func(nullptr)
+	, m_param(nullptr)
+	, m_isRunning(false)
+{ }
+
+/**
+ * Delete the thread object.
+ * If the thread is still running, it will be joined.
+ */
+inline Thread::~Thread()
+{
+	if (m_isRunning) {
+		join();
+	}
+}
+
+/**
+ * pthread_create() trampoline.
+ * @param arg Thread object.
+ * @return nullptr
+ */
+inline void *Thread::threadProc(void *arg)
+{
+	Thread *const thread = static_cast<Thread*>(arg);
+	thread->m_func(thread->m_param);
+	return nullptr;
+}
+
+/**
+ * Start the thread.
+ * @param func Thread function.
+ * @param param Parameter for the thread function.
+ * @return 0 on success; non-zero on error.
+ */
+inline int Thread::start(ThreadFunc func, void *param)
+{
+	assert(func != nullptr);
+	assert(!m_isRunning);
+	if (!func)
+		return -EINVAL;
+	else if (m_isRunning)
+		return -EBUSY;
+
+	m_func = func;
+	m_param = param;
+	int ret = pthread_create(&m_thread, nullptr, threadProc, this);
+	if (ret != 0) {
+		// pthread_create() returns a positive error code.
+		return -ret;
+	}
+	m_isRunning = true;
+	return 0;
+}
+
+/**
+ * Wait for the thread to exit.
+ * @return 0 on success; non-zero on error.
+ */
+inline int Thread::join(void)
+{
+	if (!m_isRunning)
+		return -EBADF;
+
+	int ret = pthread_join(m_thread, nullptr);
+	m_isRunning = false;
+	return -ret;
+}
+
+/**
+ * Detach the thread.
+ * The thread keeps running, and its resources are
+ * released when it exits. It can't be joined afterwards.
+ * NOTE: The Thread object must remain valid until
+ * the thread function returns.
+ * @return 0 on success; non-zero on error.
+ */
+inline int Thread::detach(void)
+{
+	if (!m_isRunning)
+		return -EBADF;
+
+	int ret = pthread_detach(m_thread);
+	m_isRunning = false;
+	return -ret;
+}
+
+/**
+ * Get the number of logical CPUs available to this process.
+ * @return Number of logical CPUs. (always at least 1)
+ */
+inline unsigned int Thread::cpuCount(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count > 0) {
+		return static_cast<unsigned int>(count);
+	}
+#endif /* _SC_NPROCESSORS_ONLN */
+	return 1;
+}
+
+}
@@ -0,0 +1,212 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpthreads)                     *
+ * ThreadWin32.cpp: Win32 thread implementation.                           *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef WIN32_LEAN_AND_MEAN
+# define WIN32_LEAN_AND_MEAN 1
+#endif
+#include <windows.h>
+#include <process.h>
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+
+namespace LibRpBase {
+
+class Thread
+{
+	public:
+		/**
+		 * Thread function.
+		 * @param param User-specified parameter.
+		 */
+		typedef void (*ThreadFunc)(void *param);
+
+		/**
+		 * Create a thread object.
+		 * The thread isn't started until start() is called.
+		 */
+		inline explicit Thread();
+
+		/**
+		 * Delete the thread object.
+		 * If the thread is still running, it will be joined.
+		 */
+		inline ~Thread();
+
+	private:
+#if __cplusplus >= 201103L
+		Thread(const Thread &) = delete; \
+		Thread &operator=(const Thread &) = delete;
+#else /* __cplusplus < 201103L */
+		Thread(const Thread &); \
+		Thread &operator=(const Thread &);
+#endif /* __cplusplus */
+
+	public:
+		/**
+		 * Start the thread.
+		 * @param func Thread function.
+		 * @param param Parameter for the thread function.
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int start(ThreadFunc func, void *param);
+
+		/**
+		 * Wait for the thread to exit.
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int join(void);
+
+		/**
+		 * Detach the thread.
+		 * The thread keeps running, and its resources are
+		 * released when it exits. It can't be joined afterwards.
+		 * NOTE: The Thread object must remain valid until
+		 * the thread function returns.
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int detach(void);
+
+		/**
+		 * Is the thread running?
+		 * NOTE: This returns true until join() is called,
+		 * even if the thread function has returned.
+		 * @return True if the thread was started and hasn't been joined.
+		 */
+		inline bool isRunning(void) const
+		{
+			return (m_hThread != nullptr);
+		}
+
+		/**
+		 * Get the number of logical CPUs available to this process.
+		 * @return Number of logical CPUs. (always at least 1)
+		 */
+		static inline unsigned int cpuCount(void);
+
+	private:
+		/**
+		 * _beginthreadex() trampoline.
+		 * @param arg Thread object.
+		 * @return 0
+		 */
+		static inline unsigned int __stdcall threadProc(void *arg);
+
+	private:
+		HANDLE m_hThread;
+		ThreadFunc m_func;
+		void *m_param;
+};
+
+/**
+ * Create a thread object.
+ * The thread isn't started until start() is called.
+ */
+inline Thread::Thread()
+	: m_hThread(nullptr)
+	, m_func(nullptr)
+	, m_param(nullptr)
+{ }
+
+/**
+ * Delete the thread object.
+ * If the thread is still running, it will be joined.
+ */
+inline Thread::~Thread()
+{
+	if (m_hThread) {
+		join();
+	}
+}
+
+/**
+ * _beginthreadex() trampoline.
+ * @param arg Thread object.
+ * @return 0
+ */
+inline unsigned int __stdcall Thread::threadProc(void *arg)
+{
+	Thread *const thread = static_cast<Thread*>(arg);
+	thread->m_func(thread->m_param);
+	return 0;
+}
+
+/**
+ * Start the thread.
+ * @param func Thread function.
+ * @param param Parameter for the thread function.
+ * @return 0 on success; non-zero on error.
+ */
+inline int Thread::start(ThreadFunc func, void *param)
+{
+	assert(func != nullptr);
+	assert(m_hThread == nullptr);
+	if (!func)
+		return -EINVAL;
+	else if (m_hThread)
+		return -EBUSY;
+
+	m_func = func;
+	m_param = param;
+
+	// NOTE: Using _beginthreadex() instead of CreateThread()
+	// in order to properly initialize the CRT.
+	m_hThread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, 0, threadProc, this, 0, nullptr));
+	if (!m_hThread) {
+		// TODO: Convert the error code?
+		return -EAGAIN;
+	}
+	return 0;
+}
+
+/**
+ * Wait for the thread to exit.
+ * @return 0 on success; non-zero on error.
+ */
+inline int Thread::join(void)
+{
+	if (!m_hThread)
+		return -EBADF;
+
+	DWORD dwRet = WaitForSingleObject(m_hThread, INFINITE);
+	CloseHandle(m_hThread);
+	m_hThread = nullptr;
+	return (dwRet == WAIT_OBJECT_0 ? 0 : -EINVAL);
+}
+
+/**
+ * Detach the thread.
+ * The thread keeps running, and its resources are
+ * released when it exits. It can't be joined afterwards.
+ * NOTE: The Thread object must remain valid until
+ * the thread function returns.
+ * @return 0 on success; non-zero on error.
+ */
+inline int Thread::detach(void)
+{
+	if (!m_hThread)
+		return -EBADF;
+
+	CloseHandle(m_hThread);
+	m_hThread = nullptr;
+	return 0;
+}
+
+/**
+ * Get the number of logical CPUs available to this process.
+ * @return Number of logical CPUs. (always at least 1)
+ */
+inline unsigned int Thread::cpuCount(void)
+{
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (si.dwNumberOfProcessors > 0 ? si.dwNumberOfProcessors : 1);
+}
+
+}
@@ -19,16 +19,26 @@ namespace RpDownload {
 
 CurlDownloader::CurlDownloader()
 	: super()
+	, m_curl(nullptr)
 { }
 
 CurlDownloader::CurlDownloader(const TCHAR *url)
 	: super(url)
+	, m_curl(nullptr)
 { }
 
 CurlDownloader::CurlDownloader(const tstring &url)
 	: super(url)
+	, m_curl(nullptr)
 { }
 
+CurlDownloader::~CurlDownloader()
+{
+	if (m_curl) {
+		curl_easy_cleanup(static_cast<CURL*>(m_curl));
+	}
+}
+
 /**
  * Internal cURL data write function.
  * @param ptr Data to write.
@@ -151,22 +161,22 @@ size_t CurlDownloader::parse_header(char *ptr, size_t size, size_t nitems, void
 }
 
 /**
- * Download the file.
- * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ * Initialize the cURL handle.
+ * @return 0 on success; negative POSIX error code on error.
  */
-int CurlDownloader::download(void)
+int CurlDownloader::initCurl(void)
 {
 	// References:
 	// - http://stackoverflow.com/questions/1636333/download-file-using-libcurl-in-c-c
 	// - http://stackoverflow.com/a/1636415
 	// - https://curl.haxx.se/libcurl/c/curl_easy_setopt.html
-
-	// Clear the previous download.
-	m_data.clear();
-	m_mtime = -1;
+	if (m_curl) {
+		// Already initialized.
+		return 0;
+	}
 
 	// Initialize cURL.
-	CURL *curl = curl_easy_init();
+	CURL *const curl = curl_easy_init();
 	if (!curl) {
 		// Could not initialize cURL.
 		return -ENOMEM;	// TODO: Better error?
@@ -178,7 +188,6 @@ int CurlDownloader::download(void)
 	// TODO: Send a HEAD request first?
 
 	// Set options for curl's "easy" mode.
-	curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
 	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, true);
 	// Fail on HTTP errors. (>= 400)
 	curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
@@ -206,9 +215,28 @@ int CurlDownloader::download(void)
 	// Set the User-Agent.
 	curl_easy_setopt(curl, CURLOPT_USERAGENT, m_userAgent.c_str());
 
-	// TODO: Set the User-Agent?
+	m_curl = curl;
+	return 0;
+}
+
+/**
+ * Download the file.
+ * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+int CurlDownloader::download(void)
+{
+	// Clear the previous download.
+	m_data.clear();
+	m_mtime = -1;
+
+	int ret = initCurl();
+	if (ret != 0) {
+		return ret;
+	}
+	CURL *const curl = static_cast<CURL*>(m_curl);
+	curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+
 	CURLcode res = curl_easy_perform(curl);
-	curl_easy_cleanup(curl);
 	if (res != CURLE_OK) {
 		// Error downloading the file.
 		// Check if we have an HTTP response code.
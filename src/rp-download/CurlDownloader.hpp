@@ -19,6 +19,7 @@ class CurlDownloader : public IDownloader
 		CurlDownloader();
 		explicit CurlDownloader(const TCHAR *url);
 		explicit CurlDownloader(const std::tstring &url);
+		~CurlDownloader() final;
 
 	private:
 		typedef IDownloader super;
@@ -51,6 +52,19 @@ class CurlDownloader : public IDownloader
 		 * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
 		 */
 		int download(void) final;
+
+	private:
+		/**
+		 * Initialize the cURL handle.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int initCurl(void);
+
+	private:
+		// cURL handle. (CURL*)
+		// The handle is reused for all downloads, so connections
+		// and TLS sessions can be reused if the server allows it.
+		void *m_curl;
 };
 
 }
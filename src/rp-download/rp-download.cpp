@@ -75,12 +75,22 @@ using namespace RpDownload;
 static const TCHAR *argv0 = nullptr;
 static bool verbose = false;
 
+#ifdef RP_DOWNLOAD_TEST_HOOKS
+// URL base override for testing. (RP_DOWNLOAD_URL_BASE)
+// If set, this is used for all cache key prefixes.
+// NOTE: Only available in the rp-download-test executable.
+static const TCHAR *url_base = nullptr;
+#endif /* RP_DOWNLOAD_TEST_HOOKS */
+
 /**
  * Show command usage.
  */
 static void show_usage(void)
 {
 	_ftprintf(stderr, _T("Syntax: %s [-v] cache_key\n"), argv0);
+#ifndef _WIN32
+	_ftprintf(stderr, _T("        %s [-v] --server\n"), argv0);
+#endif /* !_WIN32 */
 }
 
 /**
@@ -262,145 +272,13 @@ int rmkdir(const tstring &path)
 }
 
 /**
- * rp-download: Download an image from a supported online database.
- * @param cache_key Cache key, e.g. "ds/cover/US/ADAE.png"
- * @return 0 on success; non-zero on error.
- *
- * TODO:
- * - More error codes based on the error.
+ * Download a single file into the cache.
+ * @param downloader	[in] Downloader.
+ * @param cache_key	[in] Cache key, e.g. "ds/cover/US/ADAE.png"
+ * @return EXIT_SUCCESS on success; EXIT_FAILURE on error.
  */
-int RP_C_API _tmain(int argc, TCHAR *argv[])
+static int download_cache_key(IDownloader *downloader, const TCHAR *cache_key)
 {
-	// Create a downloader based on OS:
-	// - Linux: CurlDownloader
-	// - Windows: WinInetDownloader
-
-	// Syntax: rp-download cache_key
-	// Example: rp-download ds/coverM/US/ADAE.png
-
-	// If http_proxy or https_proxy are set, they will be used
-	// by the downloader code if supported.
-
-	// Reduce process integrity, if available.
-	rp_secure_reduce_integrity();
-
-	// Set OS-specific security options.
-	rp_secure_param_t param;
-#if defined(_WIN32)
-	param.bHighSec = FALSE;
-#elif defined(HAVE_SECCOMP)
-	static const int syscall_wl[] = {
-		// Syscalls used by rp-download.
-		// TODO: Add more syscalls.
-		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
-		// defined in earlier versions, including Ubuntu 14.04.
-
-		// NOTE: Special case for clone(). If it's the first syscall
-		// in the list, it has a parameter restriction added that
-		// ensures it can only be used to create threads.
-		SCMP_SYS(clone),
-		// Other multi-threading syscalls
-		SCMP_SYS(set_robust_list),
-
-		SCMP_SYS(access), SCMP_SYS(clock_gettime),
-#if defined(__SNR_clock_gettime64) || defined(__NR_clock_gettime64)
-		SCMP_SYS(clock_gettime64),
-#endif /* __SNR_clock_gettime64 || __NR_clock_gettime64 */
-		SCMP_SYS(close),
-		SCMP_SYS(fcntl), SCMP_SYS(fcntl64),
-		SCMP_SYS(fsetxattr),
-		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
-		SCMP_SYS(fstatat64), SCMP_SYS(newfstatat),	// Ubuntu 19.10 (32-bit)
-		SCMP_SYS(futex),
-		SCMP_SYS(getdents), SCMP_SYS(getdents64),
-		SCMP_SYS(getrusage),
-		SCMP_SYS(gettimeofday),	// 32-bit only?
-		SCMP_SYS(getuid),
-		SCMP_SYS(lseek), SCMP_SYS(_llseek),
-		//SCMP_SYS(lstat), SCMP_SYS(lstat64),	// Not sure if used?
-		SCMP_SYS(mkdir), SCMP_SYS(mmap), SCMP_SYS(mmap2),
-		SCMP_SYS(munmap),
-		SCMP_SYS(open),		// Ubuntu 16.04
-		SCMP_SYS(openat),	// glibc-2.31
-#if defined(__SNR_openat2)
-		SCMP_SYS(openat2),	// Linux 5.6
-#elif defined(__NR_openat2)
-		__NR_openat2,		// Linux 5.6
-#endif /* __SNR_openat2 || __NR_openat2 */
-		SCMP_SYS(poll), SCMP_SYS(select),
-		SCMP_SYS(stat), SCMP_SYS(stat64),
-		SCMP_SYS(utimensat),
-
-#if defined(__SNR_statx) || defined(__NR_statx)
-		SCMP_SYS(getcwd),	// called by glibc's statx()
-		SCMP_SYS(statx),
-#endif /* __SNR_statx || __NR_statx */
-
-		// glibc ncsd
-		// TODO: Restrict connect() to AF_UNIX.
-		SCMP_SYS(connect), SCMP_SYS(recvmsg), SCMP_SYS(sendto),
-		SCMP_SYS(sendmmsg),	// getaddrinfo() (32-bit only?)
-		SCMP_SYS(ioctl),	// getaddrinfo() (32-bit only?) [FIXME: Filter for FIONREAD]
-		SCMP_SYS(recvfrom),	// getaddrinfo() (32-bit only?)
-
-		// cURL and OpenSSL
-		SCMP_SYS(bind),		// getaddrinfo() [curl_thread_create_thunk(), curl-7.68.0]
-#ifdef __SNR_getrandom
-		SCMP_SYS(getrandom),
-#endif /* __SNR_getrandom */
-		SCMP_SYS(getpeername), SCMP_SYS(getsockname),
-		SCMP_SYS(getsockopt), SCMP_SYS(madvise), SCMP_SYS(mprotect),
-		SCMP_SYS(setsockopt), SCMP_SYS(socket),
-		SCMP_SYS(socketcall),	// FIXME: Enhanced filtering? [cURL+GnuTLS only?]
-		SCMP_SYS(socketpair), SCMP_SYS(sysinfo),
-
-		-1	// End of whitelist
-	};
-	param.syscall_wl = syscall_wl;
-#elif defined(HAVE_PLEDGE)
-	// Promises:
-	// - stdio: General stdio functionality.
-	// - rpath: Read from ~/.config/rom-properties/ and ~/.cache/rom-properties/
-	// - wpath: Write to ~/.cache/rom-properties/
-	// - cpath: Create ~/.cache/rom-properties/ if it doesn't exist.
-	// - inet: Internet access.
-	// - fattr: Modify file attributes, e.g. mtime.
-	// - dns: Resolve hostnames.
-	// - getpw: Get user's home directory if HOME is empty.
-	param.promises = "stdio rpath wpath cpath inet fattr dns getpw";
-#elif defined(HAVE_TAME)
-	// NOTE: stdio includes fattr, e.g. utimes().
-	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH |
-	                   TAME_INET | TAME_DNS | TAME_GETPW;
-#else
-	param.dummy = 0;
-#endif
-	rp_secure_enable(param);
-
-	// Store argv[0] globally.
-	argv0 = argv[0];
-
-	const TCHAR *cache_key = argv[1];
-	if (argc < 2) {
-		// TODO: Add a verbose option to print messages.
-		// Normally, the only output is a return value.
-		show_usage();
-		return EXIT_FAILURE;
-	}
-
-	// Check for "-v" or "--verbose".
-	if (!_tcscmp(argv[1], _T("-v")) || !_tcscmp(argv[1], _T("--verbose"))) {
-		// Verbose mode is enabled.
-		verbose = true;
-		// We need at least three parameters now.
-		if (argc < 3) {
-			show_error(_T("No cache key specified."));
-			show_usage();
-			return EXIT_FAILURE;
-		}
-		cache_key = argv[2];
-	}
-
 	// Check the cache key prefix. The prefix indicates the system
 	// and identifies the online database used.
 	// [key] indicates the cache key without the prefix.
@@ -446,6 +324,13 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 
 	// Determine the full URL based on the cache key.
 	TCHAR full_url[256];
+#ifdef RP_DOWNLOAD_TEST_HOOKS
+	if (url_base) {
+		// Testing: Use the specified URL base for all prefixes.
+		_sntprintf(full_url, _countof(full_url),
+			_T("%s/%s"), url_base, cache_key);
+	} else
+#endif /* RP_DOWNLOAD_TEST_HOOKS */
 	if ((prefix_len == 3 && !_tcsncmp(cache_key, _T("wii"), 3)) ||
 	    (prefix_len == 4 && !_tcsncmp(cache_key, _T("wiiu"), 4)) ||
 	    (prefix_len == 3 && !_tcsncmp(cache_key, _T("3ds"), 3)) ||
@@ -548,13 +433,6 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 	}
 
 	// Attempt to download the file.
-	// TODO: IDownloaderFactory?
-#ifdef _WIN32
-	unique_ptr<IDownloader> m_downloader(new WinInetDownloader());
-#else /* !_WIN32 */
-	unique_ptr<IDownloader> m_downloader(new CurlDownloader());
-#endif /* _WIN32 */
-
 	// Open the cache file now so we can use it as a negative hit
 	// if the download fails.
 	FILE *f_out = _tfopen(cache_filename.c_str(), _T("wb"));
@@ -564,11 +442,8 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		return EXIT_FAILURE;
 	}
 
-	// TODO: Configure this somewhere?
-	m_downloader->setMaxSize(4*1024*1024);
-
-	m_downloader->setUrl(full_url);
-	ret = m_downloader->download();
+	downloader->setUrl(full_url);
+	ret = downloader->download();
 	if (ret != 0) {
 		// Error downloading the file.
 		if (verbose) {
@@ -589,7 +464,7 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		return EXIT_FAILURE;
 	}
 
-	if (m_downloader->dataSize() <= 0) {
+	if (downloader->dataSize() <= 0) {
 		// No data downloaded...
 		SHOW_ERROR(_T("Error downloading file: 0 bytes received"));
 		fclose(f_out);
@@ -598,18 +473,279 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 
 	// Write the file to the cache.
 	// TODO: Verify the size.
-	size_t size = fwrite(m_downloader->data(), 1, m_downloader->dataSize(), f_out);
+	size_t size = fwrite(downloader->data(), 1, downloader->dataSize(), f_out);
 
 	// Save the file origin information.
 #ifdef _WIN32
 	// TODO: Figure out how to setFileOriginInfo() on Windows
 	// using an open file handle.
-	setFileOriginInfo(f_out, cache_filename.c_str(), full_url, m_downloader->mtime());
+	setFileOriginInfo(f_out, cache_filename.c_str(), full_url, downloader->mtime());
 #else /* !_WIN32 */
-	setFileOriginInfo(f_out, full_url, m_downloader->mtime());
+	setFileOriginInfo(f_out, full_url, downloader->mtime());
 #endif /* _WIN32 */
 	fclose(f_out);
 
 	// Success.
 	return EXIT_SUCCESS;
 }
+
+#ifndef _WIN32
+/**
+ * Write an entire buffer to a file descriptor.
+ * @param fd File descriptor.
+ * @param buf Buffer.
+ * @param size Size of buf.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+static int write_all(int fd, const char *buf, size_t size)
+{
+	while (size > 0) {
+		const ssize_t n = write(fd, buf, size);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			const int err = errno;
+			return (err != 0 ? -err : -EIO);
+		}
+		buf += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/**
+ * Server mode: Download files requested on stdin.
+ *
+ * Each request is a cache key terminated by '\n'. When a request
+ * has been processed, the exit status that would have been returned
+ * in single-file mode is written to stdout as a decimal number,
+ * terminated by '\n'.
+ *
+ * The same downloader is used for all requests, so HTTP keep-alive
+ * connections and TLS sessions are reused if the server allows it.
+ *
+ * @param downloader Downloader.
+ * @return EXIT_SUCCESS when stdin is closed; EXIT_FAILURE on error.
+ */
+static int server_loop(IDownloader *downloader)
+{
+	char buf[1024];
+	size_t len = 0;
+	bool discard = false;	// Set if the current request is too long.
+
+	while (true) {
+		// Process all complete requests in the buffer.
+		char *const nl = static_cast<char*>(memchr(buf, '\n', len));
+		if (nl) {
+			*nl = '\0';
+			int status = EXIT_FAILURE;
+			if (!discard) {
+				status = download_cache_key(downloader, buf);
+			}
+			discard = false;
+
+			char resp[16];
+			const int resp_len = snprintf(resp, sizeof(resp), "%d\n", status);
+			if (write_all(STDOUT_FILENO, resp, resp_len) != 0) {
+				// Parent process went away.
+				return EXIT_FAILURE;
+			}
+
+			// Remove the request from the buffer.
+			const size_t used = static_cast<size_t>(nl - buf) + 1;
+			len -= used;
+			memmove(buf, nl + 1, len);
+			continue;
+		}
+
+		if (len == sizeof(buf)) {
+			// Request is too long. Discard it.
+			SHOW_ERROR(_T("Cache key is too long."));
+			discard = true;
+			len = 0;
+		}
+
+		const ssize_t n = read(STDIN_FILENO, &buf[len], sizeof(buf) - len);
+		if (n == 0) {
+			// stdin was closed.
+			break;
+		} else if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			SHOW_ERROR(_T("Error reading from stdin: %s"), _tcserror(errno));
+			return EXIT_FAILURE;
+		}
+		len += n;
+	}
+
+	return EXIT_SUCCESS;
+}
+#endif /* !_WIN32 */
+
+/**
+ * rp-download: Download an image from a supported online database.
+ * @param cache_key Cache key, e.g. "ds/cover/US/ADAE.png", or "--server" for server mode.
+ * @return 0 on success; non-zero on error.
+ *
+ * TODO:
+ * - More error codes based on the error.
+ */
+int RP_C_API _tmain(int argc, TCHAR *argv[])
+{
+	// Create a downloader based on OS:
+	// - Linux: CurlDownloader
+	// - Windows: WinInetDownloader
+
+	// Syntax: rp-download cache_key
+	// Example: rp-download ds/coverM/US/ADAE.png
+
+	// If http_proxy or https_proxy are set, they will be used
+	// by the downloader code if supported.
+
+	// Reduce process integrity, if available.
+	rp_secure_reduce_integrity();
+
+	// Set OS-specific security options.
+	rp_secure_param_t param;
+#if defined(_WIN32)
+	param.bHighSec = FALSE;
+#elif defined(HAVE_SECCOMP)
+	static const int syscall_wl[] = {
+		// Syscalls used by rp-download.
+		// TODO: Add more syscalls.
+		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
+		// defined in earlier versions, including Ubuntu 14.04.
+
+		// NOTE: Special case for clone(). If it's the first syscall
+		// in the list, it has a parameter restriction added that
+		// ensures it can only be used to create threads.
+		// NOTE: Other thread syscalls are allowed by rp_secure_enable().
+		SCMP_SYS(clone),
+
+		SCMP_SYS(access), SCMP_SYS(clock_gettime),
+#if defined(__SNR_clock_gettime64) || defined(__NR_clock_gettime64)
+		SCMP_SYS(clock_gettime64),
+#endif /* __SNR_clock_gettime64 || __NR_clock_gettime64 */
+		SCMP_SYS(close),
+		SCMP_SYS(fcntl), SCMP_SYS(fcntl64),
+		SCMP_SYS(fsetxattr),
+		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
+		SCMP_SYS(fstatat64), SCMP_SYS(newfstatat),	// Ubuntu 19.10 (32-bit)
+		SCMP_SYS(futex),
+		SCMP_SYS(getdents), SCMP_SYS(getdents64),
+		SCMP_SYS(getrusage),
+		SCMP_SYS(gettimeofday),	// 32-bit only?
+		SCMP_SYS(getuid),
+		SCMP_SYS(lseek), SCMP_SYS(_llseek),
+		//SCMP_SYS(lstat), SCMP_SYS(lstat64),	// Not sure if used?
+		SCMP_SYS(mkdir), SCMP_SYS(mmap), SCMP_SYS(mmap2),
+		SCMP_SYS(munmap),
+		SCMP_SYS(open),		// Ubuntu 16.04
+		SCMP_SYS(openat),	// glibc-2.31
+#if defined(__SNR_openat2)
+		SCMP_SYS(openat2),	// Linux 5.6
+#elif defined(__NR_openat2)
+		__NR_openat2,		// Linux 5.6
+#endif /* __SNR_openat2 || __NR_openat2 */
+		SCMP_SYS(poll), SCMP_SYS(select),
+		SCMP_SYS(stat), SCMP_SYS(stat64),
+		SCMP_SYS(utimensat),
+
+#if defined(__SNR_statx) || defined(__NR_statx)
+		SCMP_SYS(getcwd),	// called by glibc's statx()
+		SCMP_SYS(statx),
+#endif /* __SNR_statx || __NR_statx */
+
+		// glibc ncsd
+		// TODO: Restrict connect() to AF_UNIX.
+		SCMP_SYS(connect), SCMP_SYS(recvmsg), SCMP_SYS(sendto),
+		SCMP_SYS(sendmmsg),	// getaddrinfo() (32-bit only?)
+		SCMP_SYS(ioctl),	// getaddrinfo() (32-bit only?) [FIXME: Filter for FIONREAD]
+		SCMP_SYS(recvfrom),	// getaddrinfo() (32-bit only?)
+
+		// cURL and OpenSSL
+		SCMP_SYS(bind),		// getaddrinfo() [curl_thread_create_thunk(), curl-7.68.0]
+#ifdef __SNR_getrandom
+		SCMP_SYS(getrandom),
+#endif /* __SNR_getrandom */
+		SCMP_SYS(getpeername), SCMP_SYS(getsockname),
+		SCMP_SYS(getsockopt), SCMP_SYS(mprotect),
+		SCMP_SYS(setsockopt), SCMP_SYS(socket),
+		SCMP_SYS(socketcall),	// FIXME: Enhanced filtering? [cURL+GnuTLS only?]
+		SCMP_SYS(socketpair), SCMP_SYS(sysinfo),
+
+		-1	// End of whitelist
+	};
+	param.syscall_wl = syscall_wl;
+#elif defined(HAVE_PLEDGE)
+	// Promises:
+	// - stdio: General stdio functionality.
+	// - rpath: Read from ~/.config/rom-properties/ and ~/.cache/rom-properties/
+	// - wpath: Write to ~/.cache/rom-properties/
+	// - cpath: Create ~/.cache/rom-properties/ if it doesn't exist.
+	// - inet: Internet access.
+	// - fattr: Modify file attributes, e.g. mtime.
+	// - dns: Resolve hostnames.
+	// - getpw: Get user's home directory if HOME is empty.
+	param.promises = "stdio rpath wpath cpath inet fattr dns getpw";
+#elif defined(HAVE_TAME)
+	// NOTE: stdio includes fattr, e.g. utimes().
+	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH |
+	                   TAME_INET | TAME_DNS | TAME_GETPW;
+#else
+	param.dummy = 0;
+#endif
+	rp_secure_enable(param);
+
+	// Store argv[0] globally.
+	argv0 = argv[0];
+
+	const TCHAR *cache_key = argv[1];
+	if (argc < 2) {
+		// TODO: Add a verbose option to print messages.
+		// Normally, the only output is a return value.
+		show_usage();
+		return EXIT_FAILURE;
+	}
+
+	// Check for "-v" or "--verbose".
+	if (!_tcscmp(argv[1], _T("-v")) || !_tcscmp(argv[1], _T("--verbose"))) {
+		// Verbose mode is enabled.
+		verbose = true;
+		// We need at least three parameters now.
+		if (argc < 3) {
+			show_error(_T("No cache key specified."));
+			show_usage();
+			return EXIT_FAILURE;
+		}
+		cache_key = argv[2];
+	}
+
+#ifdef RP_DOWNLOAD_TEST_HOOKS
+	// Testing: Override the URL base.
+	url_base = getenv("RP_DOWNLOAD_URL_BASE");
+	if (url_base && url_base[0] == '\0') {
+		url_base = nullptr;
+	}
+#endif /* RP_DOWNLOAD_TEST_HOOKS */
+
+	// Create the downloader.
+	// TODO: IDownloaderFactory?
+#ifdef _WIN32
+	unique_ptr<IDownloader> downloader(new WinInetDownloader());
+#else /* !_WIN32 */
+	unique_ptr<IDownloader> downloader(new CurlDownloader());
+#endif /* _WIN32 */
+
+	// TODO: Configure this somewhere?
+	downloader->setMaxSize(4*1024*1024);
+
+#ifndef _WIN32
+	if (!_tcscmp(cache_key, _T("--server"))) {
+		// Server mode: Download files requested on stdin.
+		return server_loop(downloader.get());
+	}
+#endif /* !_WIN32 */
+
+	return download_cache_key(downloader.get(), cache_key);
+}
@@ -0,0 +1,416 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download/tests)                *
+ * RpDownloadServerTest.cpp: rp-download server mode test.                 *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librpthreads
+#include "librpthreads/Thread.hpp"
+using LibRpBase::Thread;
+
+// C includes.
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+using std::string;
+
+namespace RpDownload { namespace Tests {
+
+// rp-download executable. (specified on the command line)
+static const char *rp_download_exe = nullptr;
+
+/**
+ * Minimal HTTP/1.1 server with keep-alive support.
+ * Paths containing "missing" return 404; all other paths
+ * return 200 with the path as the response body.
+ */
+class LocalHttpServer
+{
+	public:
+		LocalHttpServer()
+			: listen_fd(-1)
+			, port(0)
+			, connections(0)
+			, requests(0)
+		{ }
+
+		~LocalHttpServer()
+		{
+			stop();
+		}
+
+	private:
+		RP_DISABLE_COPY(LocalHttpServer)
+
+	public:
+		/**
+		 * Start the server on a random port on 127.0.0.1.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int start(void)
+		{
+			listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (listen_fd < 0)
+				return -errno;
+
+			struct sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			addr.sin_port = 0;
+			if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+				return -errno;
+			if (listen(listen_fd, 4) != 0)
+				return -errno;
+
+			socklen_t addrlen = sizeof(addr);
+			if (getsockname(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) != 0)
+				return -errno;
+			port = ntohs(addr.sin_port);
+
+			return thread.start(serverProc, this);
+		}
+
+		/**
+		 * Stop the server.
+		 */
+		void stop(void)
+		{
+			if (listen_fd >= 0) {
+				// Unblock accept().
+				shutdown(listen_fd, SHUT_RDWR);
+				thread.join();
+				close(listen_fd);
+				listen_fd = -1;
+			}
+		}
+
+	private:
+		/**
+		 * Server thread.
+		 * @param param LocalHttpServer.
+		 */
+		static void serverProc(void *param)
+		{
+			LocalHttpServer *const server = static_cast<LocalHttpServer*>(param);
+			while (true) {
+				const int fd = accept(server->listen_fd, nullptr, nullptr);
+				if (fd < 0)
+					break;
+				server->connections++;
+				server->handleConnection(fd);
+				close(fd);
+			}
+		}
+
+		/**
+		 * Handle requests on a connection until it's closed.
+		 * @param fd Connection.
+		 */
+		void handleConnection(int fd)
+		{
+			string buf;
+			char tmp[1024];
+			while (true) {
+				// Read the request headers.
+				size_t hdr_end;
+				while ((hdr_end = buf.find("\r\n\r\n")) == string::npos) {
+					const ssize_t n = read(fd, tmp, sizeof(tmp));
+					if (n <= 0)
+						return;
+					buf.append(tmp, n);
+				}
+				const string req = buf.substr(0, hdr_end);
+				buf.erase(0, hdr_end + 4);
+				requests++;
+
+				// Request line: "GET /path HTTP/1.1"
+				string path;
+				const size_t sp1 = req.find(' ');
+				if (sp1 != string::npos) {
+					const size_t sp2 = req.find(' ', sp1 + 1);
+					if (sp2 != string::npos) {
+						path = req.substr(sp1 + 1, sp2 - sp1 - 1);
+					}
+				}
+
+				string resp;
+				if (path.find("missing") != string::npos) {
+					resp = "HTTP/1.1 404 Not Found\r\n"
+					       "Content-Type: text/plain\r\n"
+					       "Content-Length: 9\r\n"
+					       "\r\n"
+					       "Not Found";
+				} else {
+					resp = "HTTP/1.1 200 OK\r\n"
+					       "Content-Type: image/png\r\n"
+					       "Last-Modified: Wed, 15 Nov 1995 04:58:08 GMT\r\n"
+					       "Content-Length: " + std::to_string(path.size()) + "\r\n"
+					       "\r\n" + path;
+				}
+				if (write(fd, resp.data(), resp.size()) != static_cast<ssize_t>(resp.size()))
+					return;
+			}
+		}
+
+	public:
+		int listen_fd;
+		uint16_t port;
+		volatile int connections;	// Number of accepted connections.
+		volatile int requests;		// Number of HTTP requests.
+
+	private:
+		Thread thread;
+};
+
+class RpDownloadServerTest : public ::testing::Test
+{
+	protected:
+		RpDownloadServerTest()
+			: pid(-1)
+			, fd(-1)
+		{ }
+
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+		/**
+		 * Send a request to rp-download and get the response.
+		 * @param cache_key Cache key.
+		 * @return Response line, without the trailing newline.
+		 */
+		string request(const char *cache_key);
+
+		/**
+		 * Stop rp-download by closing its stdin.
+		 * @return rp-download's exit status.
+		 */
+		int stopRpDownload(void);
+
+		/**
+		 * Get the cache filename for a cache key.
+		 * @param cache_key Cache key.
+		 * @return Cache filename.
+		 */
+		string cacheFilename(const char *cache_key) const
+		{
+			return tmpdir + "/rom-properties/" + cache_key;
+		}
+
+		/**
+		 * nftw() callback to remove files and directories.
+		 */
+		static int rm_callback(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+		{
+			RP_UNUSED(sb);
+			RP_UNUSED(typeflag);
+			RP_UNUSED(ftwbuf);
+			return remove(fpath);
+		}
+
+	protected:
+		LocalHttpServer server;
+		string tmpdir;
+		pid_t pid;	// rp-download process
+		int fd;		// Socket connected to rp-download's stdin and stdout
+};
+
+void RpDownloadServerTest::SetUp(void)
+{
+	ASSERT_TRUE(rp_download_exe != nullptr) << "rp-download path was not specified.";
+
+	char tmpl[] = "/tmp/rp-download-test.XXXXXX";
+	ASSERT_TRUE(mkdtemp(tmpl) != nullptr);
+	tmpdir = tmpl;
+
+	ASSERT_EQ(0, server.start());
+
+	// Environment for rp-download.
+	const string env_home = "HOME=" + tmpdir;
+	const string env_xdg = "XDG_CACHE_HOME=" + tmpdir;
+	const string env_url = "RP_DOWNLOAD_URL_BASE=http://127.0.0.1:" + std::to_string(server.port);
+	const char *const envp[4] = {env_home.c_str(), env_xdg.c_str(), env_url.c_str(), nullptr};
+	const char *const argv[3] = {rp_download_exe, "--server", nullptr};
+
+	int fds[2];
+	ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds));
+
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	posix_spawn_file_actions_adddup2(&file_actions, fds[1], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&file_actions, fds[1], STDOUT_FILENO);
+	const int ret = posix_spawn(&pid, rp_download_exe, &file_actions, nullptr,
+		(char *const *)argv, (char *const *)envp);
+	posix_spawn_file_actions_destroy(&file_actions);
+	close(fds[1]);
+	if (ret != 0) {
+		close(fds[0]);
+		pid = -1;
+	}
+	ASSERT_EQ(0, ret);
+	fd = fds[0];
+}
+
+void RpDownloadServerTest::TearDown(void)
+{
+	if (pid > 0) {
+		kill(pid, SIGTERM);
+		stopRpDownload();
+	}
+	server.stop();
+	if (!tmpdir.empty()) {
+		nftw(tmpdir.c_str(), rm_callback, 16, FTW_DEPTH | FTW_PHYS);
+	}
+}
+
+/**
+ * Send a request to rp-download and get the response.
+ * @param cache_key Cache key.
+ * @return Response line, without the trailing newline.
+ */
+string RpDownloadServerTest::request(const char *cache_key)
+{
+	const string req = string(cache_key) + '\n';
+	if (send(fd, req.data(), req.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(req.size()))
+		return "(send error)";
+
+	string resp;
+	char chr;
+	while (read(fd, &chr, 1) == 1) {
+		if (chr == '\n')
+			return resp;
+		resp += chr;
+	}
+	return "(read error)";
+}
+
+/**
+ * Stop rp-download by closing its stdin.
+ * @return rp-download's exit status.
+ */
+int RpDownloadServerTest::stopRpDownload(void)
+{
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+	int wstatus = 0;
+	if (pid > 0) {
+		waitpid(pid, &wstatus, 0);
+		pid = -1;
+	}
+	return (WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1);
+}
+
+/**
+ * Download multiple files using a single rp-download process.
+ * All downloads should use the same HTTP connection.
+ */
+TEST_F(RpDownloadServerTest, keepAliveTest)
+{
+	static const char *const cache_keys[] = {
+		"wii/cover/US/RMGE01.png",
+		"wii/cover/US/SMNE01.png",
+		"ds/cover/US/ADAE.png",
+	};
+
+	for (const char *cache_key : cache_keys) {
+		EXPECT_EQ("0", request(cache_key)) << "cache key: " << cache_key;
+
+		// The cache file should contain the URL path.
+		const string filename = cacheFilename(cache_key);
+		FILE *f = fopen(filename.c_str(), "rb");
+		ASSERT_TRUE(f != nullptr) << "cache file not found: " << filename;
+		char buf[256];
+		const size_t size = fread(buf, 1, sizeof(buf), f);
+		fclose(f);
+		EXPECT_EQ('/' + string(cache_key), string(buf, size));
+	}
+
+	// Already-cached files should not be downloaded again.
+	EXPECT_EQ("0", request(cache_keys[0]));
+
+	EXPECT_EQ(0, stopRpDownload());
+	EXPECT_EQ(3, server.requests);
+	EXPECT_EQ(1, server.connections);
+}
+
+/**
+ * A file that isn't on the server should leave a negative cache entry,
+ * and rp-download should continue handling requests afterwards.
+ */
+TEST_F(RpDownloadServerTest, notFoundTest)
+{
+	static const char cache_key_missing[] = "wii/cover/US/missing.png";
+	EXPECT_EQ("1", request(cache_key_missing));
+
+	struct stat sb;
+	ASSERT_EQ(0, stat(cacheFilename(cache_key_missing).c_str(), &sb));
+	EXPECT_EQ(0, sb.st_size);
+
+	// Negative cache entry hasn't expired, so the server shouldn't be contacted.
+	EXPECT_EQ("1", request(cache_key_missing));
+	EXPECT_EQ(1, server.requests);
+
+	EXPECT_EQ("0", request("gba/title/AGBJ.png"));
+	EXPECT_EQ(0, stopRpDownload());
+	EXPECT_EQ(2, server.requests);
+}
+
+/**
+ * Invalid cache keys should fail without contacting the server.
+ */
+TEST_F(RpDownloadServerTest, invalidKeyTest)
+{
+	EXPECT_EQ("1", request(""));
+	EXPECT_EQ("1", request("no-slash.png"));
+	EXPECT_EQ("1", request("wii/cover/US/RMGE01.gif"));
+	EXPECT_EQ("1", request(string(2000, 'x').c_str()));
+
+	// rp-download should still be usable.
+	EXPECT_EQ("0", request("wii/cover/US/RMGE01.png"));
+	EXPECT_EQ(0, stopRpDownload());
+	EXPECT_EQ(1, server.requests);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "rp-download test suite: Server mode tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	if (argc < 2) {
+		fprintf(stderr, "Syntax: %s /path/to/rp-download\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	RpDownload::Tests::rp_download_exe = argv[1];
+	return RUN_ALL_TESTS();
+}
@@ -20,6 +20,10 @@ int rp_stub_do_security_options(bool config)
 	// exec()'d by us inherits the seccomp filter, which *will* break
 	// things, since child processes cannot enable syscalls if they
 	// weren't enabled here.
+	// NOTE: The thumbnailer starts worker threads for image decoding
+	// and ExtImageFetcher. clone() is in the whitelist below, and the
+	// other thread syscalls are allowed by rp_secure_enable(), so the
+	// threads will work if this filter is re-enabled.
 	((void)config);
 	return 0;
 
@@ -74,7 +78,7 @@ int rp_stub_do_security_options(bool config)
 #if defined(__SNR_getrlimit64) || defined(__NR_getrlimit64)
 		SCMP_SYS(getrlimit64),
 #endif /* __SNR_getrlimit64 || __NR_getrlimit64 */
-		SCMP_SYS(set_tid_address), SCMP_SYS(set_robust_list),
+		SCMP_SYS(set_tid_address),
 
 		SCMP_SYS(getppid),	// dll-search.c: walk_proc_tree()
 
@@ -97,10 +101,14 @@ int rp_stub_do_security_options(bool config)
 		SCMP_SYS(lstat), SCMP_SYS(lstat64),	// realpath() [LibRpBase::FileSystem::resolve_symlink()]
 		SCMP_SYS(readlink),	// realpath() [LibRpBase::FileSystem::resolve_symlink()]
 
-		// ExecRpDownload_posix.cpp
-		// FIXME: Need to fix the clone() check in librpsecure/os-secure_linux.c.
+		// ExecRpDownload_posix.cpp, image decoder and ExtImageFetcher worker threads
+		// NOTE: clone() isn't first, so it isn't restricted to threads,
+		// since fork() and posix_spawn() also use clone().
+		// clone3() returns ENOSYS so glibc falls back to clone().
 		SCMP_SYS(clock_nanosleep), SCMP_SYS(clone), SCMP_SYS(fork),
 		SCMP_SYS(execve), SCMP_SYS(wait4),
+		SCMP_SYS(dup2), SCMP_SYS(dup3), SCMP_SYS(kill),
+		SCMP_SYS(poll), SCMP_SYS(ppoll), SCMP_SYS(socketpair),
 
 		// FIXME: Child process inherits the seccomp filter...
 		// rp-download child process
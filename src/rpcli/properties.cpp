@@ -40,6 +40,9 @@ using namespace LibRpBase;
 #include "librptexture/img/rp_image.hpp"
 using LibRpTexture::rp_image;
 
+// libromdata
+using LibRomData::RomDataFactory;
+
 class StreamStateSaver {
 	std::ios &stream;	// Stream being adjusted.
 	std::ios state;		// Copy of original flags.
@@ -628,16 +631,31 @@ public:
 	}
 };
 
+/**
+ * Should a field be printed?
+ * @param romField ROM field.
+ * @param tabMask Bitfield of tab indexes to print. (0 for all tabs)
+ * @return True if the field should be printed; false if not.
+ */
+static inline bool isTabSelected(const RomFields::Field &romField, uint32_t tabMask)
+{
+	return (tabMask == 0 ||
+		(romField.tabIdx < 32 && (tabMask & (1U << romField.tabIdx))));
+}
+
 class FieldsOutput {
 	const RomFields& fields;
 	uint32_t lc;
+	uint32_t tabMask;
 public:
-	explicit FieldsOutput(const RomFields& fields, uint32_t lc = 0)
-		: fields(fields), lc(lc) { }
+	explicit FieldsOutput(const RomFields& fields, uint32_t lc = 0, uint32_t tabMask = 0)
+		: fields(fields), lc(lc), tabMask(tabMask) { }
 	friend std::ostream& operator<<(std::ostream& os, const FieldsOutput& fo) {
 		size_t maxWidth = 0;
 		const auto iter_end = fo.fields.cend();
 		for (auto iter = fo.fields.cbegin(); iter != iter_end; ++iter) {
+			if (!isTabSelected(*iter, fo.tabMask))
+				continue;
 			maxWidth = max(maxWidth, iter->name.size());
 		}
 		maxWidth += 2;
@@ -652,7 +670,7 @@ public:
 		bool printed_first = false;
 		for (auto iter = fo.fields.cbegin(); iter != iter_end; ++iter) {
 			const auto &romField = *iter;
-			if (!romField.isValid)
+			if (!romField.isValid || !isTabSelected(romField, fo.tabMask))
 				continue;
 
 			if (printed_first)
@@ -660,8 +678,9 @@ public:
 
 			// New tab?
 			if (tabCount > 1 && tabIdx != romField.tabIdx) {
-				// Tab indexes must be consecutive.
-				assert(tabIdx + 1 == romField.tabIdx);
+				// Tab indexes must be consecutive,
+				// unless only some tabs are being printed.
+				assert(fo.tabMask != 0 || tabIdx + 1 == romField.tabIdx);
 				tabIdx = romField.tabIdx;
 
 				// TODO: Better formatting?
@@ -723,68 +742,65 @@ public:
 	}
 };
 
-class JSONString {
-	const char* str;
-public:
-	explicit JSONString(const char* str) :str(str) {}
-	friend ostream& operator<<(ostream& os, const JSONString& js) {
-		if (!js.str) {
-			// NULL string.
-			// Treat this like an empty string.
-			return os << "\"\"";
-		}
+std::ostream& operator<<(std::ostream& os, const JSONString& js) {
+	if (!js.str) {
+		// NULL string.
+		// Treat this like an empty string.
+		return os << "\"\"";
+	}
 
-		// Certain characters need to be escaped.
-		const char *str = js.str;
-		os << '"';
-		for (; *str != 0; str++) {
-			const uint8_t chr = static_cast<uint8_t>(*str);
-			if (chr < 0x20) { 
-				// Control characters need to be escaped.
-				static const char ctrl_escape_letters[0x20] = {
-					  0,   0,   0,   0,   0,   0,   0,   0,	// 0x00-0x07
-					'b', 't', 'n',   0, 'f', 'r',   0,   0,	// 0x08-0x0F
-					  0,   0,   0,   0,   0,   0,   0,   0,	// 0x10-0x17
-					  0,   0,   0,   0,   0,   0,   0,   0,	// 0x18-0x1F
-				};
-				const char letter = ctrl_escape_letters[chr];
-				if (letter != 0) {
-					// Escape character is available.
-					os << '\\' << letter;
-				} else {
-					// No escape character. Use a Unicode escape.
-					char buf[16];
-					snprintf(buf, sizeof(buf), "\\u%04X", chr);
-					os << buf;
-				}
+	// Certain characters need to be escaped.
+	const char *str = js.str;
+	os << '"';
+	for (; *str != 0; str++) {
+		const uint8_t chr = static_cast<uint8_t>(*str);
+		if (chr < 0x20) { 
+			// Control characters need to be escaped.
+			static const char ctrl_escape_letters[0x20] = {
+				  0,   0,   0,   0,   0,   0,   0,   0,	// 0x00-0x07
+				'b', 't', 'n',   0, 'f', 'r',   0,   0,	// 0x08-0x0F
+				  0,   0,   0,   0,   0,   0,   0,   0,	// 0x10-0x17
+				  0,   0,   0,   0,   0,   0,   0,   0,	// 0x18-0x1F
+			};
+			const char letter = ctrl_escape_letters[chr];
+			if (letter != 0) {
+				// Escape character is available.
+				os << '\\' << letter;
 			} else {
-				// Check for backslash and double-quotes.
-				if (chr == '\\') {
-					os << "\\\\";
-				} else if (chr == '"') {
-					os << "\\\"";
-				} else {
-					// Normal character.
-					os << static_cast<char>(chr);
-				}
+				// No escape character. Use a Unicode escape.
+				char buf[16];
+				snprintf(buf, sizeof(buf), "\\u%04X", chr);
+				os << buf;
+			}
+		} else {
+			// Check for backslash and double-quotes.
+			if (chr == '\\') {
+				os << "\\\\";
+			} else if (chr == '"') {
+				os << "\\\"";
+			} else {
+				// Normal character.
+				os << static_cast<char>(chr);
 			}
 		}
-
-		return os << '"';
 	}
-};
+
+	return os << '"';
+}
 
 class JSONFieldsOutput {
 	const RomFields& fields;
+	uint32_t tabMask;
 public:
-	explicit JSONFieldsOutput(const RomFields& fields) :fields(fields) {}
+	explicit JSONFieldsOutput(const RomFields& fields, uint32_t tabMask = 0)
+		: fields(fields), tabMask(tabMask) {}
 	friend std::ostream& operator<<(std::ostream& os, const JSONFieldsOutput& fo) {
 		os << "[\n";
 		bool printed_first = false;
 		const auto iter_end = fo.fields.cend();
 		for (auto iter = fo.fields.cbegin(); iter != iter_end; ++iter) {
 			const auto &romField = *iter;
-			if (!romField.isValid)
+			if (!romField.isValid || !isTabSelected(romField, fo.tabMask))
 				continue;
 
 			if (printed_first)
@@ -1049,9 +1065,10 @@ public:
 
 
 
-ROMOutput::ROMOutput(const RomData *romdata, uint32_t lc)
+ROMOutput::ROMOutput(const RomData *romdata, uint32_t lc, uint32_t tabMask)
 	: romdata(romdata)
-	, lc(lc) { }
+	, lc(lc)
+	, tabMask(tabMask) { }
 std::ostream& operator<<(std::ostream& os, const ROMOutput& fo) {
 	auto romdata = fo.romdata;
 	const char *const systemName = romdata->systemName(RomData::SYSNAME_TYPE_LONG | RomData::SYSNAME_REGION_ROM_LOCAL);
@@ -1062,10 +1079,14 @@ std::ostream& operator<<(std::ostream& os, const ROMOutput& fo) {
 	os << "-- " << (systemName ? systemName : "(unknown system)") <<
 	      ' ' << (fileType ? fileType : "(unknown filetype)") <<
 	      " detected" << endl;
-	const RomFields *const fields = romdata->fields();
+	// NOTE: If only some tabs are being printed,
+	// don't load the other tabs.
+	const RomFields *const fields = (fo.tabMask != 0
+		? romdata->fields(fo.tabMask)
+		: romdata->fields());
 	assert(fields != nullptr);
 	if (fields) {
-		os << FieldsOutput(*fields, fo.lc) << endl;
+		os << FieldsOutput(*fields, fo.lc, fo.tabMask) << endl;
 	}
 
 	const int supported = romdata->supportedImageTypes();
@@ -1111,9 +1132,10 @@ std::ostream& operator<<(std::ostream& os, const ROMOutput& fo) {
 	return os;
 }
 
-JSONROMOutput::JSONROMOutput(const RomData *romdata, uint32_t lc)
+JSONROMOutput::JSONROMOutput(const RomData *romdata, uint32_t lc, uint32_t tabMask)
 	: romdata(romdata)
-	, lc(lc) { }
+	, lc(lc)
+	, tabMask(tabMask) { }
 std::ostream& operator<<(std::ostream& os, const JSONROMOutput& fo) {
 	auto romdata = fo.romdata;
 	assert(romdata && romdata->isValid());
@@ -1135,10 +1157,14 @@ std::ostream& operator<<(std::ostream& os, const JSONROMOutput& fo) {
 	} else {
 		os << "\"unknown\"";
 	}
-	const RomFields *const fields = romdata->fields();
+	// NOTE: If only some tabs are being printed,
+	// don't load the other tabs.
+	const RomFields *const fields = (fo.tabMask != 0
+		? romdata->fields(fo.tabMask)
+		: romdata->fields());
 	assert(fields != nullptr);
 	if (fields) {
-		os << ",\"fields\":" << JSONFieldsOutput(*fields);
+		os << ",\"fields\":" << JSONFieldsOutput(*fields, fo.tabMask);
 	}
 
 	const int supported = romdata->supportedImageTypes();
@@ -1235,3 +1261,56 @@ std::ostream& operator<<(std::ostream& os, const JSONROMOutput& fo) {
 
 	return os << '}';
 }
+
+DetectOutput::DetectOutput(const RomDataFactory::DetectResult &result)
+	: result(result) { }
+std::ostream& operator<<(std::ostream& os, const DetectOutput& fo) {
+	const RomDataFactory::DetectResult &result = fo.result;
+	const char *const yes = "Yes";
+	const char *const no = "No";
+
+	os << "MIME type: ";
+	if (result.mimeTypes && result.mimeTypes[0]) {
+		os << result.mimeTypes[0];
+	} else {
+		os << "(unknown)";
+	}
+	os << endl;
+	os << "Extension: ";
+	if (result.fileExtensions && result.fileExtensions[0]) {
+		os << result.fileExtensions[0];
+	} else {
+		os << "(unknown)";
+	}
+	os << endl;
+	os << "Thumbnail: " <<
+		((result.attrs & RomDataFactory::RDA_HAS_THUMBNAIL) ? yes : no) << endl;
+	os << "Metadata: " <<
+		((result.attrs & RomDataFactory::RDA_HAS_METADATA) ? yes : no) << endl;
+	os << "Dangerous permissions overlay: " <<
+		((result.attrs & RomDataFactory::RDA_HAS_DPOVERLAY) ? yes : no);
+	return os;
+}
+
+JSONDetectOutput::JSONDetectOutput(const RomDataFactory::DetectResult &result)
+	: result(result) { }
+std::ostream& operator<<(std::ostream& os, const JSONDetectOutput& fo) {
+	const RomDataFactory::DetectResult &result = fo.result;
+
+	os << "{\"mimetype\":";
+	if (result.mimeTypes && result.mimeTypes[0]) {
+		os << JSONString(result.mimeTypes[0]);
+	} else {
+		os << "null";
+	}
+	os << ",\"ext\":";
+	if (result.fileExtensions && result.fileExtensions[0]) {
+		os << JSONString(result.fileExtensions[0]);
+	} else {
+		os << "null";
+	}
+	os << ",\"thumbnail\":" << ((result.attrs & RomDataFactory::RDA_HAS_THUMBNAIL) ? "true" : "false");
+	os << ",\"metadata\":" << ((result.attrs & RomDataFactory::RDA_HAS_METADATA) ? "true" : "false");
+	os << ",\"dpoverlay\":" << ((result.attrs & RomDataFactory::RDA_HAS_DPOVERLAY) ? "true" : "false");
+	return os << '}';
+}
@@ -12,6 +12,9 @@
 #include <string.h>
 #include <ostream>
 
+// libromdata
+#include "libromdata/RomDataFactory.hpp"
+
 namespace LibRpBase {
 	class RomData;
 }
@@ -19,17 +22,40 @@ namespace LibRpBase {
 class ROMOutput {
 	const LibRpBase::RomData *const romdata;
 	uint32_t lc;
+	uint32_t tabMask;
 public:
-	explicit ROMOutput(const LibRpBase::RomData *romdata, uint32_t lc = 0);
+	explicit ROMOutput(const LibRpBase::RomData *romdata, uint32_t lc = 0, uint32_t tabMask = 0);
 	friend std::ostream& operator<<(std::ostream& os, const ROMOutput& fo);
 };
 
+class JSONString {
+	const char *const str;
+public:
+	explicit JSONString(const char *str) : str(str) { }
+	friend std::ostream& operator<<(std::ostream& os, const JSONString& js);
+};
+
 class JSONROMOutput {
 	const LibRpBase::RomData *const romdata;
 	uint32_t lc;
+	uint32_t tabMask;
 public:
-	explicit JSONROMOutput(const LibRpBase::RomData *romdata, uint32_t lc = 0);
+	explicit JSONROMOutput(const LibRpBase::RomData *romdata, uint32_t lc = 0, uint32_t tabMask = 0);
 	friend std::ostream& operator<<(std::ostream& os, const JSONROMOutput& fo);
 };
 
+class DetectOutput {
+	const LibRomData::RomDataFactory::DetectResult &result;
+public:
+	explicit DetectOutput(const LibRomData::RomDataFactory::DetectResult &result);
+	friend std::ostream& operator<<(std::ostream& os, const DetectOutput& fo);
+};
+
+class JSONDetectOutput {
+	const LibRomData::RomDataFactory::DetectResult &result;
+public:
+	explicit JSONDetectOutput(const LibRomData::RomDataFactory::DetectResult &result);
+	friend std::ostream& operator<<(std::ostream& os, const JSONDetectOutput& fo);
+};
+
 #endif /* __ROMPROPERTIES_RPCLI_PROPERTIES_HPP__ */
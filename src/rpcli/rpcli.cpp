@@ -48,6 +48,7 @@ using LibRpTexture::rp_image;
 # include "verifykeys.hpp"
 #endif /* ENABLE_DECRYPTION */
 #include "device.hpp"
+#include "scan.hpp"
 
 // OS-specific userdirs
 #ifdef _WIN32
@@ -169,19 +170,25 @@ static void ExtractImages(const RomData *romData, vector<ExtractParam>& extract)
  * @param json Is program running in json mode?
  * @param extract Vector of image extraction parameters
  * @param languageCode Language code. (0 for default)
+ * @param tabMask Bitfield of tab indexes to print. (0 for all tabs)
+ * @param hash If true, add the "Hashes" tab.
  */
-static void DoFile(const char *filename, bool json, vector<ExtractParam>& extract, uint32_t languageCode = 0)
+static void DoFile(const char *filename, bool json, vector<ExtractParam>& extract, uint32_t languageCode = 0, uint32_t tabMask = 0, bool hash = false)
 {
 	cerr << "== " << rp_sprintf(C_("rpcli", "Reading file '%s'..."), filename) << endl;
 	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
 	if (file->isOpen()) {
 		RomData *romData = RomDataFactory::create(file);
 		if (romData && romData->isValid()) {
+			if (hash) {
+				cerr << "-- " << C_("rpcli", "Calculating hashes") << endl;
+				romData->enableHashesTab();
+			}
 			if (json) {
 				cerr << "-- " << C_("rpcli", "Outputting JSON data") << endl;
-				cout << JSONROMOutput(romData, languageCode) << endl;
+				cout << JSONROMOutput(romData, languageCode, tabMask) << endl;
 			} else {
-				cout << ROMOutput(romData, languageCode) << endl;
+				cout << ROMOutput(romData, languageCode, tabMask) << endl;
 			}
 
 			ExtractImages(romData, extract);
@@ -200,6 +207,35 @@ static void DoFile(const char *filename, bool json, vector<ExtractParam>& extrac
 	file->unref();
 }
 
+/**
+ * Detect a file's type without fully loading it.
+ * @param filename ROM filename
+ * @param json Is program running in json mode?
+ */
+static void DoDetect(const char *filename, bool json)
+{
+	cerr << "== " << rp_sprintf(C_("rpcli", "Reading file '%s'..."), filename) << endl;
+	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
+	if (file->isOpen()) {
+		RomDataFactory::DetectResult result;
+		if (RomDataFactory::detect(file, result)) {
+			if (json) {
+				cerr << "-- " << C_("rpcli", "Outputting JSON data") << endl;
+				cout << JSONDetectOutput(result) << endl;
+			} else {
+				cout << DetectOutput(result) << endl;
+			}
+		} else {
+			cerr << "-- " << C_("rpcli", "ROM is not supported") << endl;
+			if (json) cout << "{\"error\":\"rom is not supported\"}" << endl;
+		}
+	} else {
+		cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't open file: %s"), strerror(file->lastError())) << endl;
+		if (json) cout << "{\"error\":\"couldn't open file\",\"code\":" << file->lastError() << "}" << endl;
+	}
+	file->unref();
+}
+
 /**
  * Print the system region information.
  */
@@ -355,6 +391,16 @@ int RP_C_API main(int argc, char *argv[])
 		cerr << "  -l:   " << C_("rpcli", "Retrieve the specified language from the ROM image.") << endl;
 		cerr << "  -xN:  " << C_("rpcli", "Extract image N to outfile in PNG format.") << endl;
 		cerr << "  -a:   " << C_("rpcli", "Extract the animated icon to outfile in APNG format.") << endl;
+		cerr << "  --tab=N:  " << C_("rpcli", "Only print fields from tab N. (may be specified multiple times)") << endl;
+		cerr << endl;
+		cerr << C_("rpcli", "Directory scanning:") << endl;
+		cerr << "  --scan:     " << C_("rpcli", "Recursively scan the next directory and output NDJSON.") << endl;
+		cerr << "  --jobs=N:   " << C_("rpcli", "Use N worker threads for --scan. (default is one per CPU)") << endl;
+		cerr << "  --sorted:   " << C_("rpcli", "Output --scan results in path order instead of completion order.") << endl;
+		cerr << "  --detect:   " << C_("rpcli", "Only detect the file type from the header. (also applies to --scan)") << endl;
+		cerr << endl;
+		cerr << C_("rpcli", "Verification:") << endl;
+		cerr << "  --hash:     " << C_("rpcli", "Calculate the CRC32, MD5, and SHA-1 of subsequent files.") << endl;
 		cerr << endl;
 #ifdef RP_OS_SCSI_SUPPORTED
 		cerr << "Special options for devices:" << endl;
@@ -367,6 +413,10 @@ int RP_C_API main(int argc, char *argv[])
 		cerr << "\t " << C_("rpcli", "displays info about s3.gen") << endl;
 		cerr << "* rpcli -x0 icon.png pokeb2.nds" << endl;
 		cerr << "\t " << C_("rpcli", "extracts icon from pokeb2.nds") << endl;
+		cerr << "* rpcli --scan --jobs=8 roms/" << endl;
+		cerr << "\t " << C_("rpcli", "outputs info about every file in roms/ using 8 threads") << endl;
+		cerr << "* rpcli --hash game.wbfs" << endl;
+		cerr << "\t " << C_("rpcli", "displays info about game.wbfs, plus hashes of the uncompressed disc image") << endl;
 	}
 	
 	assert(RomData::IMG_INT_MIN == 0);
@@ -385,7 +435,13 @@ int RP_C_API main(int argc, char *argv[])
 	bool inq_scsi = false;
 	bool inq_ata = false;
 #endif /* RP_OS_SCSI_SUPPORTED */
+	bool scan = false;
+	bool scan_sorted = false;
+	bool detect = false;
+	bool hash = false;
+	unsigned int scan_jobs = 0;
 	uint32_t languageCode = 0;
+	uint32_t tabMask = 0;
 	bool first = true;
 	int ret = 0;
 	for (int i = 1; i < argc; i++){
@@ -457,6 +513,61 @@ int RP_C_API main(int argc, char *argv[])
 				break;
 			case 'j': // do nothing
 				break;
+			case '-': {
+				// Long options.
+				const char *const opt = &argv[i][2];
+				if (!strcmp(opt, "scan")) {
+					// Scan the next directory.
+					scan = true;
+				} else if (!strcmp(opt, "sorted")) {
+					scan_sorted = true;
+				} else if (!strcmp(opt, "detect")) {
+					// Only detect the file type for all subsequent files.
+					detect = true;
+				} else if (!strcmp(opt, "hash")) {
+					// Calculate hashes for all subsequent files.
+					hash = true;
+				} else if (!strncmp(opt, "jobs", 4) && (opt[4] == '=' || opt[4] == '\0')) {
+					// Number of worker threads.
+					// NOTE: May be "--jobs=N" or "--jobs N".
+					const char *s_jobs;
+					if (opt[4] == '=') {
+						s_jobs = &opt[5];
+					} else if (i+1 < argc) {
+						s_jobs = argv[++i];
+					} else {
+						s_jobs = "";
+					}
+					char *endptr = nullptr;
+					long jobs = strtol(s_jobs, &endptr, 10);
+					if (s_jobs[0] == '\0' || *endptr != '\0' || jobs < 0 || jobs > 1024) {
+						cerr << rp_sprintf(C_("rpcli", "Warning: ignoring invalid job count '%s'"), s_jobs) << endl;
+						break;
+					}
+					scan_jobs = static_cast<unsigned int>(jobs);
+				} else if (!strncmp(opt, "tab", 3) && (opt[3] == '=' || opt[3] == '\0')) {
+					// Only print fields from the specified tab.
+					// NOTE: May be "--tab=N" or "--tab N".
+					const char *s_tab;
+					if (opt[3] == '=') {
+						s_tab = &opt[4];
+					} else if (i+1 < argc) {
+						s_tab = argv[++i];
+					} else {
+						s_tab = "";
+					}
+					char *endptr = nullptr;
+					long tab = strtol(s_tab, &endptr, 10);
+					if (s_tab[0] == '\0' || *endptr != '\0' || tab < 0 || tab >= 32) {
+						cerr << rp_sprintf(C_("rpcli", "Warning: ignoring invalid tab index '%s'"), s_tab) << endl;
+						break;
+					}
+					tabMask |= (1U << tab);
+				} else {
+					cerr << rp_sprintf(C_("rpcli", "Warning: skipping unknown switch '%s'"), argv[i]) << endl;
+				}
+				break;
+			}
 #ifdef RP_OS_SCSI_SUPPORTED
 			case 'i':
 				// TODO: Check if a SCSI implementation is available for this OS?
@@ -474,6 +585,11 @@ int RP_C_API main(int argc, char *argv[])
 				cerr << rp_sprintf(C_("rpcli", "Warning: skipping unknown switch '%c'"), argv[i][1]) << endl;
 				break;
 			}
+		} else if (scan) {
+			// Directory scan. Output is always NDJSON,
+			// independent of the -j option.
+			DoScan(argv[i], scan_jobs, scan_sorted, detect, languageCode, tabMask, hash);
+			scan = false;
 		} else {
 			if (first) first = false;
 			else if (json) cout << "," << endl;
@@ -488,9 +604,12 @@ int RP_C_API main(int argc, char *argv[])
 				DoAtaIdentifyDevice(argv[i], json);
 			} else
 #endif /* RP_OS_SCSI_SUPPORTED */
-			{
+			if (detect) {
+				// Detect the file type only.
+				DoDetect(argv[i], json);
+			} else {
 				// Regular file.
-				DoFile(argv[i], json, extract, languageCode);
+				DoFile(argv[i], json, extract, languageCode, tabMask, hash);
 			}
 
 #ifdef RP_OS_SCSI_SUPPORTED
@@ -26,6 +26,14 @@ int rpcli_do_security_options(void)
 		// TODO: Add more syscalls.
 		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
 		// defined in earlier versions, including Ubuntu 14.04.
+
+		// NOTE: Special case for clone(). If it's the first syscall
+		// in the list, it has a parameter restriction added that
+		// ensures it can only be used to create threads.
+		// NOTE: Other thread syscalls are allowed by rp_secure_enable().
+		// clone3() returns ENOSYS so glibc falls back to clone().
+		SCMP_SYS(clone),	// --scan worker threads
+
 		SCMP_SYS(close),
 		SCMP_SYS(dup),		// gzdopen()
 		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
@@ -33,6 +41,7 @@ int rpcli_do_security_options(void)
 		SCMP_SYS(ftruncate),	// LibRpBase::RpFile::truncate() [from LibRpBase::RpPngWriterPrivate::init()]
 		SCMP_SYS(ftruncate64),
 		SCMP_SYS(futex),
+		SCMP_SYS(getdents), SCMP_SYS(getdents64),	// readdir() [--scan]
 		SCMP_SYS(gettimeofday),	// 32-bit only?
 		SCMP_SYS(ioctl),	// for devices; also afl-fuzz
 		SCMP_SYS(lseek), SCMP_SYS(_llseek),
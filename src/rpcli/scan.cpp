@@ -0,0 +1,651 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * scan.cpp: Parallel directory scanning.                                  *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "scan.hpp"
+#include "properties.hpp"
+
+// librpbase
+#include "librpbase/RomData.hpp"
+#include "librpbase/TextFuncs.hpp"
+#include "libi18n/i18n.h"
+using namespace LibRpBase;
+
+// librpfile
+#include "librpfile/RpFile.hpp"
+using LibRpFile::RpFile;
+
+// libromdata
+#include "libromdata/RomDataFactory.hpp"
+using LibRomData::RomDataFactory;
+
+// librpthreads
+#include "librpthreads/Mutex.hpp"
+#include "librpthreads/Semaphore.hpp"
+#include "librpthreads/Thread.hpp"
+
+#ifdef _WIN32
+# include "libwin32common/RpWin32_sdk.h"
+# include "librpbase/TextFuncs_wchar.hpp"
+#else /* !_WIN32 */
+# include <dirent.h>
+# include <sys/stat.h>
+#endif /* _WIN32 */
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+
+// C++ includes.
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+using std::cerr;
+using std::cout;
+using std::deque;
+using std::endl;
+using std::map;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+#ifdef _WIN32
+# define DIR_SEP_CHR '\\'
+#else /* !_WIN32 */
+# define DIR_SEP_CHR '/'
+#endif /* _WIN32 */
+
+namespace {
+
+/**
+ * A single file to process.
+ */
+struct ScanJob {
+	string filename;
+	size_t index;		// Sequence number. (used for sorted output)
+};
+
+/**
+ * Directory entry, used while walking the tree.
+ */
+struct ScanDirEntry {
+	string name;
+	bool isDir;
+
+	inline bool operator<(const ScanDirEntry &other) const
+	{
+		return (name < other.name);
+	}
+};
+
+class ScanContext;
+
+/**
+ * Worker thread.
+ * Each worker owns a job queue. When its own queue is empty,
+ * it steals jobs from the other workers' queues.
+ */
+struct ScanWorker {
+	ScanContext *ctx;
+	unsigned int id;
+	Thread thread;
+
+	Mutex mutex;		// Protects jobs.
+	deque<ScanJob> jobs;
+};
+
+class ScanContext
+{
+	public:
+		ScanContext(unsigned int jobs, bool sorted, bool detectOnly, uint32_t lc, uint32_t tabMask, bool hash);
+		~ScanContext();
+
+	private:
+		RP_DISABLE_COPY(ScanContext)
+
+	public:
+		/**
+		 * Start the worker threads, walk a directory,
+		 * and wait for the worker threads to finish.
+		 * @param path Directory path.
+		 */
+		void run(const string &path);
+
+		/**
+		 * Number of files queued.
+		 * @return Number of files queued.
+		 */
+		inline size_t fileCount(void) const
+		{
+			return m_fileCount;
+		}
+
+		/**
+		 * Number of supported files processed.
+		 * @return Number of supported files processed.
+		 */
+		inline size_t supportedCount(void) const
+		{
+			return m_supportedCount;
+		}
+
+		/**
+		 * Number of threads that processed files.
+		 * This may be less than the requested number of
+		 * worker threads if some threads couldn't be started.
+		 * @return Number of threads that processed files.
+		 */
+		inline unsigned int threadCount(void) const
+		{
+			return m_threadCount;
+		}
+
+	private:
+		/**
+		 * Read all entries in a single directory.
+		 * @param path		[in] Directory path.
+		 * @param entries	[out] Directory entries, excluding "." and "..".
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int readDirectory(const string &path, vector<ScanDirEntry> &entries);
+
+		/**
+		 * Recursively walk a directory and queue all files.
+		 * Files are handed to the worker threads as they're found.
+		 * @param path Directory path.
+		 */
+		void walk(const string &path);
+
+		/**
+		 * Get the next job for a worker.
+		 * @param worker	[in] Worker.
+		 * @param job		[out] Job.
+		 * @return True if a job was retrieved; false if no jobs are left.
+		 */
+		bool getJob(ScanWorker *worker, ScanJob &job);
+
+		/**
+		 * Wait for the next job for a worker.
+		 * @param worker	[in] Worker.
+		 * @param job		[out] Job.
+		 * @return True if a job was retrieved; false if the walk is done and no jobs are left.
+		 */
+		bool waitForJob(ScanWorker *worker, ScanJob &job);
+
+		/**
+		 * Process a single file.
+		 *
+		 * NOTE: This is called on all worker threads at once.
+		 * RomDataFactory's lookup tables, SystemRegion, and the
+		 * CRC32 tables are initialized using pthread_once(); Config
+		 * and KeyManager lock a mutex while loading; and the iconv
+		 * cache is thread-local. Each RomData object is only used
+		 * by the thread that created it.
+		 *
+		 * @param filename Filename.
+		 * @param supported [out] Set to true if the file is supported.
+		 * @return Single-line JSON object.
+		 */
+		string processFile(const string &filename, bool &supported) const;
+
+		/**
+		 * Write a result to stdout.
+		 * @param index Sequence number.
+		 * @param line Single-line JSON object.
+		 */
+		void output(size_t index, const string &line);
+
+		/**
+		 * Worker thread function.
+		 * @param param ScanWorker.
+		 */
+		static void workerProc(void *param);
+
+	private:
+		ScanWorker *m_workers;
+		unsigned int m_workerCount;
+		unsigned int m_threadCount;	// Number of workers that are running.
+		unsigned int m_nextWorker;	// Round-robin index for walk().
+		size_t m_fileCount;
+
+		// Released once for each queued job, and once per worker
+		// when the walk is finished.
+		Semaphore m_semJobs;
+		bool m_sorted;
+		bool m_detectOnly;
+		bool m_hash;
+		uint32_t m_lc;
+		uint32_t m_tabMask;
+
+		Mutex m_outputMutex;		// Protects everything below.
+		size_t m_supportedCount;
+		size_t m_nextIndex;		// Next index to output. (sorted mode)
+		map<size_t, string> m_pending;	// Out-of-order results. (sorted mode)
+};
+
+ScanContext::ScanContext(unsigned int jobs, bool sorted, bool detectOnly, uint32_t lc, uint32_t tabMask, bool hash)
+	: m_workers(nullptr)
+	, m_workerCount(jobs)
+	, m_threadCount(0)
+	, m_nextWorker(0)
+	, m_fileCount(0)
+	, m_semJobs(0)
+	, m_sorted(sorted)
+	, m_detectOnly(detectOnly)
+	, m_hash(hash)
+	, m_lc(lc)
+	, m_tabMask(tabMask)
+	, m_supportedCount(0)
+	, m_nextIndex(0)
+{
+	if (m_workerCount == 0) {
+		m_workerCount = Thread::cpuCount();
+	}
+
+	m_workers = new ScanWorker[m_workerCount];
+	for (unsigned int i = 0; i < m_workerCount; i++) {
+		m_workers[i].ctx = this;
+		m_workers[i].id = i;
+	}
+}
+
+ScanContext::~ScanContext()
+{
+	// ScanWorker's Thread destructor joins any running threads.
+	delete[] m_workers;
+}
+
+/**
+ * Read all entries in a single directory.
+ * @param path		[in] Directory path.
+ * @param entries	[out] Directory entries, excluding "." and "..".
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int ScanContext::readDirectory(const string &path, vector<ScanDirEntry> &entries)
+{
+#ifdef _WIN32
+	string pattern = path;
+	if (pattern.empty() || (pattern[pattern.size()-1] != '\\' && pattern[pattern.size()-1] != '/')) {
+		pattern += '\\';
+	}
+	pattern += '*';
+
+	WIN32_FIND_DATA ffd;
+	HANDLE hFind = FindFirstFile(U82T_s(pattern), &ffd);
+	if (!hFind || hFind == INVALID_HANDLE_VALUE) {
+		return -ENOENT;
+	}
+
+	do {
+		if (!_tcscmp(ffd.cFileName, _T(".")) || !_tcscmp(ffd.cFileName, _T(".."))) {
+			continue;
+		}
+
+		ScanDirEntry entry;
+		entry.name = T2U8(ffd.cFileName);
+		entry.isDir = !!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+		if (entry.isDir && (ffd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+			// Don't follow junctions or directory symlinks.
+			continue;
+		}
+		entries.emplace_back(std::move(entry));
+	} while (FindNextFile(hFind, &ffd));
+	FindClose(hFind);
+#else /* !_WIN32 */
+	DIR *const dir = opendir(path.c_str());
+	if (!dir) {
+		return -errno;
+	}
+
+	struct dirent *d;
+	while ((d = readdir(dir)) != nullptr) {
+		if (!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..")) {
+			continue;
+		}
+
+		ScanDirEntry entry;
+		entry.name = d->d_name;
+#ifdef DT_UNKNOWN
+		if (d->d_type == DT_DIR) {
+			entry.isDir = true;
+		} else if (d->d_type == DT_REG) {
+			entry.isDir = false;
+		} else
+#endif /* DT_UNKNOWN */
+		{
+			// Unknown type or symlink. Check the file itself.
+			// NOTE: Symlinks to directories are not followed
+			// in order to prevent infinite loops.
+			string fullpath = path;
+			if (fullpath.empty() || fullpath[fullpath.size()-1] != '/') {
+				fullpath += '/';
+			}
+			fullpath += d->d_name;
+
+			struct stat sb;
+			if (lstat(fullpath.c_str(), &sb) != 0) {
+				continue;
+			}
+			if (S_ISLNK(sb.st_mode)) {
+				if (stat(fullpath.c_str(), &sb) != 0 || !S_ISREG(sb.st_mode)) {
+					continue;
+				}
+			}
+
+			if (S_ISDIR(sb.st_mode)) {
+				entry.isDir = true;
+			} else if (S_ISREG(sb.st_mode)) {
+				entry.isDir = false;
+			} else {
+				// Not a regular file or directory.
+				continue;
+			}
+		}
+		entries.emplace_back(std::move(entry));
+	}
+	closedir(dir);
+#endif /* _WIN32 */
+
+	return 0;
+}
+
+/**
+ * Recursively walk a directory and queue all files.
+ * Files are handed to the worker threads as they're found.
+ * @param path Directory path.
+ */
+void ScanContext::walk(const string &path)
+{
+	vector<ScanDirEntry> entries;
+	int ret = readDirectory(path, entries);
+	if (ret != 0) {
+		cerr << "-- " << rp_sprintf_p(C_("rpcli", "Couldn't open directory '%1$s': %2$s"),
+			path.c_str(), strerror(-ret)) << endl;
+		return;
+	}
+
+	if (m_sorted) {
+		std::sort(entries.begin(), entries.end());
+	}
+
+	string prefix = path;
+	if (prefix.empty() || prefix[prefix.size()-1] != DIR_SEP_CHR) {
+		prefix += DIR_SEP_CHR;
+	}
+
+	for (auto iter = entries.cbegin(); iter != entries.cend(); ++iter) {
+		if (iter->isDir) {
+			walk(prefix + iter->name);
+			continue;
+		}
+
+		// Distribute files round-robin across the running workers.
+		// Idle workers will steal them if the queues are uneven.
+		ScanJob job;
+		job.filename = prefix + iter->name;
+		job.index = m_fileCount++;
+		ScanWorker *const worker = &m_workers[m_nextWorker];
+		{
+			MutexLocker locker(worker->mutex);
+			worker->jobs.emplace_back(std::move(job));
+		}
+		m_semJobs.release();
+
+		if (++m_nextWorker >= m_threadCount) {
+			m_nextWorker = 0;
+		}
+	}
+}
+
+/**
+ * Get the next job for a worker.
+ * @param worker	[in] Worker.
+ * @param job		[out] Job.
+ * @return True if a job was retrieved; false if no jobs are left.
+ */
+bool ScanContext::getJob(ScanWorker *worker, ScanJob &job)
+{
+	// Check the worker's own queue first.
+	// Jobs are taken from the front in order to keep
+	// the output close to the original order.
+	{
+		MutexLocker locker(worker->mutex);
+		if (!worker->jobs.empty()) {
+			job = std::move(worker->jobs.front());
+			worker->jobs.pop_front();
+			return true;
+		}
+	}
+
+	// Steal a job from another worker.
+	// Jobs are stolen from the back to reduce contention
+	// with the owning worker.
+	for (unsigned int i = 1; i < m_workerCount; i++) {
+		ScanWorker *const victim = &m_workers[(worker->id + i) % m_workerCount];
+		MutexLocker locker(victim->mutex);
+		if (!victim->jobs.empty()) {
+			job = std::move(victim->jobs.back());
+			victim->jobs.pop_back();
+			return true;
+		}
+	}
+
+	// All queues are empty.
+	return false;
+}
+
+/**
+ * Wait for the next job for a worker.
+ * @param worker	[in] Worker.
+ * @param job		[out] Job.
+ * @return True if a job was retrieved; false if the walk is done and no jobs are left.
+ */
+bool ScanContext::waitForJob(ScanWorker *worker, ScanJob &job)
+{
+	// Each job is queued before the semaphore is released, and each
+	// worker takes at most one job per obtain(). While the walk is
+	// still running, the semaphore is only released for jobs, so
+	// getJob() will always find one. Once the walk is finished,
+	// the semaphore is released once more per worker, so each worker
+	// will eventually find the queues empty and exit.
+	m_semJobs.obtain();
+	return getJob(worker, job);
+}
+
+/**
+ * Process a single file.
+ * @param filename Filename.
+ * @param supported [out] Set to true if the file is supported.
+ * @return Single-line JSON object.
+ */
+string ScanContext::processFile(const string &filename, bool &supported) const
+{
+	ostringstream oss;
+	oss << "{\"file\":" << JSONString(filename.c_str());
+
+	supported = false;
+	// NOTE: Files are not memory-mapped here. A scan may run over
+	// directories that are being modified, and a file that's truncated
+	// while mapped would crash the whole scan with SIGBUS.
+	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
+	if (file->isOpen() && m_detectOnly) {
+		RomDataFactory::DetectResult result;
+		if (RomDataFactory::detect(file, result)) {
+			supported = true;
+			oss << ",\"detect\":" << JSONDetectOutput(result);
+		} else {
+			oss << ",\"error\":\"rom is not supported\"";
+		}
+	} else if (file->isOpen()) {
+		RomData *const romData = RomDataFactory::create(file);
+		if (romData && romData->isValid()) {
+			supported = true;
+			if (m_hash) {
+				romData->enableHashesTab();
+			}
+			oss << ",\"rom\":" << JSONROMOutput(romData, m_lc, m_tabMask);
+		} else {
+			oss << ",\"error\":\"rom is not supported\"";
+		}
+
+		if (romData) {
+			romData->unref();
+		}
+	} else {
+		oss << ",\"error\":\"couldn't open file\",\"code\":" << file->lastError();
+	}
+	file->unref();
+	oss << '}';
+
+	// NDJSON requires one object per line.
+	// JSONString escapes all control characters, so any
+	// remaining newlines are formatting and can be removed.
+	string line = oss.str();
+	line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
+	return line;
+}
+
+/**
+ * Write a result to stdout.
+ * @param index Sequence number.
+ * @param line Single-line JSON object.
+ */
+void ScanContext::output(size_t index, const string &line)
+{
+	MutexLocker locker(m_outputMutex);
+	if (!m_sorted) {
+		// Completion order.
+		cout << line << endl;
+		return;
+	}
+
+	// Sorted order: Hold results until all previous results
+	// have been written.
+	if (index != m_nextIndex) {
+		m_pending.insert(std::make_pair(index, line));
+		return;
+	}
+
+	cout << line << '\n';
+	m_nextIndex++;
+	for (auto iter = m_pending.begin();
+	     iter != m_pending.end() && iter->first == m_nextIndex;
+	     iter = m_pending.erase(iter))
+	{
+		cout << iter->second << '\n';
+		m_nextIndex++;
+	}
+	cout.flush();
+}
+
+/**
+ * Worker thread function.
+ * @param param ScanWorker.
+ */
+void ScanContext::workerProc(void *param)
+{
+	ScanWorker *const worker = static_cast<ScanWorker*>(param);
+	ScanContext *const ctx = worker->ctx;
+
+	ScanJob job;
+	while (ctx->waitForJob(worker, job)) {
+		bool supported;
+		const string line = ctx->processFile(job.filename, supported);
+		if (supported) {
+			MutexLocker locker(ctx->m_outputMutex);
+			ctx->m_supportedCount++;
+		}
+		ctx->output(job.index, line);
+	}
+}
+
+/**
+ * Start the worker threads, walk a directory,
+ * and wait for the worker threads to finish.
+ * @param path Directory path.
+ */
+void ScanContext::run(const string &path)
+{
+	// Start the worker threads first so files are
+	// processed while the tree is still being walked.
+	for (unsigned int i = 0; i < m_workerCount; i++) {
+		int ret = m_workers[i].thread.start(workerProc, &m_workers[i]);
+		if (ret != 0) {
+			// Couldn't start the thread. Use the
+			// threads that were already started.
+			cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't start worker thread: %s"),
+				strerror(-ret)) << endl;
+			break;
+		}
+		m_threadCount++;
+	}
+
+	// If no threads could be started, the files will be
+	// processed on the calling thread after walking.
+	const bool noThreads = (m_threadCount == 0);
+	if (noThreads) {
+		m_threadCount = 1;
+	}
+
+	walk(path);
+
+	// Walk is finished. Wake up each worker one more time
+	// so it can exit once the queues are empty.
+	for (unsigned int i = 0; i < m_threadCount; i++) {
+		m_semJobs.release();
+	}
+
+	if (noThreads) {
+		workerProc(&m_workers[0]);
+		return;
+	}
+	for (unsigned int i = 0; i < m_threadCount; i++) {
+		m_workers[i].thread.join();
+	}
+}
+
+}
+
+/**
+ * Recursively scan a directory and output JSON data for each file.
+ *
+ * Output is NDJSON: one JSON object per line, written to stdout
+ * as soon as each file has been processed.
+ *
+ * @param dirname Directory to scan.
+ * @param jobs Number of worker threads. (0 for one per CPU)
+ * @param sorted If true, output files in sorted path order instead of completion order.
+ * @param detectOnly If true, only detect the file type using RomDataFactory::detect().
+ * @param languageCode Language code. (0 for default)
+ * @param tabMask Bitfield of tab indexes to print. (0 for all tabs)
+ * @param hash If true, add the "Hashes" tab.
+ * @return 0 on success; non-zero on error.
+ */
+int DoScan(const char *dirname, unsigned int jobs, bool sorted, bool detectOnly,
+	uint32_t languageCode, uint32_t tabMask, bool hash)
+{
+	assert(dirname != nullptr);
+	if (!dirname || dirname[0] == '\0') {
+		return -EINVAL;
+	}
+
+	cerr << "== " << rp_sprintf(C_("rpcli", "Scanning directory '%s'..."), dirname) << endl;
+
+	ScanContext ctx(jobs, sorted, detectOnly, languageCode, tabMask, hash);
+	ctx.run(dirname);
+
+	cerr << "-- " << rp_sprintf_p(C_("rpcli", "Scanned %1$u file(s) using %2$u thread(s); %3$u supported"),
+		static_cast<unsigned int>(ctx.fileCount()),
+		ctx.threadCount(),
+		static_cast<unsigned int>(ctx.supportedCount())) << endl;
+	return 0;
+}
@@ -0,0 +1,32 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * scan.hpp: Parallel directory scanning.                                  *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RPCLI_SCAN_HPP__
+#define __ROMPROPERTIES_RPCLI_SCAN_HPP__
+
+#include <stdint.h>
+
+/**
+ * Recursively scan a directory and output JSON data for each file.
+ *
+ * Output is NDJSON: one JSON object per line, written to stdout
+ * as soon as each file has been processed.
+ *
+ * @param dirname Directory to scan.
+ * @param jobs Number of worker threads. (0 for one per CPU)
+ * @param sorted If true, output files in sorted path order instead of completion order.
+ * @param detectOnly If true, only detect the file type using RomDataFactory::detect().
+ * @param languageCode Language code. (0 for default)
+ * @param tabMask Bitfield of tab indexes to print. (0 for all tabs)
+ * @param hash If true, add the "Hashes" tab.
+ * @return 0 on success; non-zero on error.
+ */
+int DoScan(const char *dirname, unsigned int jobs, bool sorted, bool detectOnly,
+	uint32_t languageCode = 0, uint32_t tabMask = 0, bool hash = false);
+
+#endif /* __ROMPROPERTIES_RPCLI_SCAN_HPP__ */
@@ -0,0 +1,353 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli/tests)                      *
+ * RpcliScanTest.cpp: rpcli --scan test.                                   *
+ *                                                                         *
+ * Copyright (c) 2016-2020 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librpcpu, libromdata
+#include "librpcpu/byteswap.h"
+#include "libromdata/Audio/sid_structs.h"
+
+// C includes.
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace Rpcli { namespace Tests {
+
+// rpcli executable. (specified on the command line)
+static const char *rpcli_exe = nullptr;
+
+class RpcliScanTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) final
+		{
+			ASSERT_TRUE(rpcli_exe != nullptr) << "rpcli path was not specified.";
+			ASSERT_FALSE(tmpDir.empty()) << "Unable to create the temporary directory.";
+		}
+
+	public:
+		/**
+		 * Create the temporary directory tree.
+		 *
+		 * Layout:
+		 * - a/1.sid
+		 * - a/b/2.bin
+		 * - a/c.sid
+		 * - m/00.sid - m/31.sid
+		 * - z.bin
+		 *
+		 * Files are created out of order so that readdir()
+		 * is unlikely to return them sorted.
+		 */
+		static void SetUpTestCase(void)
+		{
+			char buf[] = "/tmp/RpcliScanTest.XXXXXX";
+			if (!mkdtemp(buf)) {
+				return;
+			}
+			tmpDir = buf;
+
+			// Don't let the user's configuration affect the output.
+			setenv("HOME", buf, 1);
+			setenv("XDG_CONFIG_HOME", buf, 1);
+			setenv("XDG_CACHE_HOME", buf, 1);
+
+			mkdir((tmpDir + "/a").c_str(), 0755);
+			mkdir((tmpDir + "/a/b").c_str(), 0755);
+			mkdir((tmpDir + "/m").c_str(), 0755);
+
+			writeFile("z.bin", "This is not a ROM image.");
+			writeSID("a/c.sid", "Title C");
+			for (int i = 31; i >= 0; i--) {
+				char name[16];
+				snprintf(name, sizeof(name), "m/%02d.sid", i);
+				writeSID(name, name);
+			}
+			writeFile("a/b/2.bin", "This is also not a ROM image.");
+			writeSID("a/1.sid", "Title 1");
+		}
+
+		/**
+		 * Delete the temporary directory tree.
+		 */
+		static void TearDownTestCase(void)
+		{
+			if (tmpDir.empty())
+				return;
+			nftw(tmpDir.c_str(), rm_callback, 8, FTW_DEPTH | FTW_PHYS);
+		}
+
+		/**
+		 * Write a file.
+		 * @param name Filename, relative to tmpDir.
+		 * @param data File contents.
+		 */
+		static void writeFile(const char *name, const char *data)
+		{
+			FILE *const f = fopen((tmpDir + '/' + name).c_str(), "wb");
+			if (f) {
+				fwrite(data, 1, strlen(data), f);
+				fclose(f);
+			}
+		}
+
+		/**
+		 * Write a minimal PSID file.
+		 * @param name Filename, relative to tmpDir.
+		 * @param title Title.
+		 */
+		static void writeSID(const char *name, const char *title)
+		{
+			SID_Header sidHeader;
+			memset(&sidHeader, 0, sizeof(sidHeader));
+			sidHeader.magic = cpu_to_be32(PSID_MAGIC);
+			sidHeader.version = cpu_to_be16(2);
+			sidHeader.dataOffset = cpu_to_be16(sizeof(sidHeader));
+			sidHeader.songs = cpu_to_be16(1);
+			sidHeader.startSong = cpu_to_be16(1);
+			strncpy(sidHeader.name, title, sizeof(sidHeader.name) - 1);
+
+			FILE *const f = fopen((tmpDir + '/' + name).c_str(), "wb");
+			if (f) {
+				fwrite(&sidHeader, sizeof(sidHeader), 1, f);
+				fclose(f);
+			}
+		}
+
+		/**
+		 * nftw() callback to remove files and directories.
+		 */
+		static int rm_callback(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+		{
+			RP_UNUSED(sb);
+			RP_UNUSED(typeflag);
+			RP_UNUSED(ftwbuf);
+			return remove(fpath);
+		}
+
+		/**
+		 * Run rpcli --scan on the temporary directory.
+		 * @param args	[in] Additional arguments, placed before --scan.
+		 * @param lines	[out] NDJSON output lines.
+		 * @param err	[out] stderr output.
+		 * @return rpcli's exit status.
+		 */
+		static int runScan(const char *args, vector<string> &lines, string &err)
+		{
+			const string errFile = tmpDir + ".stderr";
+			const string cmd = string("'") + rpcli_exe + "' " + args +
+				" --scan '" + tmpDir + "' 2>'" + errFile + '\'';
+
+			lines.clear();
+			FILE *const p = popen(cmd.c_str(), "r");
+			if (!p)
+				return -1;
+			string line;
+			char buf[4096];
+			while (fgets(buf, sizeof(buf), p)) {
+				line += buf;
+				if (!line.empty() && line[line.size()-1] == '\n') {
+					line.resize(line.size()-1);
+					lines.emplace_back(std::move(line));
+					line.clear();
+				}
+			}
+			const int status = pclose(p);
+
+			err.clear();
+			FILE *const f = fopen(errFile.c_str(), "r");
+			if (f) {
+				size_t n;
+				while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+					err.append(buf, n);
+				}
+				fclose(f);
+			}
+			unlink(errFile.c_str());
+			return status;
+		}
+
+		/**
+		 * Get the "file" value from an NDJSON line.
+		 * @param line NDJSON line.
+		 * @return Filename, or empty string if not found.
+		 */
+		static string getFile(const string &line)
+		{
+			static const char prefix[] = "{\"file\":\"";
+			if (line.compare(0, sizeof(prefix)-1, prefix) != 0)
+				return string();
+			const size_t end = line.find('"', sizeof(prefix)-1);
+			if (end == string::npos)
+				return string();
+			return line.substr(sizeof(prefix)-1, end - (sizeof(prefix)-1));
+		}
+
+		/**
+		 * Find the NDJSON line for a file.
+		 * @param lines NDJSON lines.
+		 * @param name Filename, relative to tmpDir.
+		 * @return NDJSON line, or empty string if not found.
+		 */
+		static string findLine(const vector<string> &lines, const char *name)
+		{
+			const string filename = tmpDir + '/' + name;
+			for (const string &line : lines) {
+				if (getFile(line) == filename)
+					return line;
+			}
+			return string();
+		}
+
+	public:
+		static string tmpDir;
+};
+
+string RpcliScanTest::tmpDir;
+
+/**
+ * --sorted outputs files in path order, with
+ * each directory's contents sorted by name.
+ */
+TEST_F(RpcliScanTest, sortedOrder)
+{
+	vector<string> expected;
+	expected.emplace_back(tmpDir + "/a/1.sid");
+	expected.emplace_back(tmpDir + "/a/b/2.bin");
+	expected.emplace_back(tmpDir + "/a/c.sid");
+	for (int i = 0; i < 32; i++) {
+		char name[16];
+		snprintf(name, sizeof(name), "/m/%02d.sid", i);
+		expected.emplace_back(tmpDir + name);
+	}
+	expected.emplace_back(tmpDir + "/z.bin");
+
+	vector<string> lines;
+	string err;
+	ASSERT_EQ(0, runScan("--jobs=4 --sorted", lines, err)) << err;
+
+	vector<string> files;
+	for (const string &line : lines) {
+		files.emplace_back(getFile(line));
+	}
+	EXPECT_EQ(expected, files);
+}
+
+/**
+ * --jobs=N uses N worker threads, and the results
+ * don't depend on the number of threads.
+ */
+TEST_F(RpcliScanTest, jobCount)
+{
+	vector<string> lines1, linesN;
+	string err;
+	ASSERT_EQ(0, runScan("--jobs=1 --sorted", lines1, err)) << err;
+	EXPECT_NE(string::npos, err.find("Scanned 36 file(s) using 1 thread(s); 34 supported")) << err;
+
+	ASSERT_EQ(0, runScan("--jobs=8", linesN, err)) << err;
+	EXPECT_NE(string::npos, err.find("Scanned 36 file(s) using 8 thread(s); 34 supported")) << err;
+
+	// Unsorted output is in completion order, but the
+	// lines themselves must be identical.
+	ASSERT_EQ(36U, lines1.size());
+	std::sort(linesN.begin(), linesN.end());
+	EXPECT_EQ(lines1, linesN);
+}
+
+/**
+ * Files that can't be opened or aren't supported
+ * still get a row, with an error.
+ */
+TEST_F(RpcliScanTest, errorRows)
+{
+	// Make a file unreadable. (root can still read it)
+	const bool isRoot = (geteuid() == 0);
+	const string unreadable = tmpDir + "/a/c.sid";
+	ASSERT_EQ(0, chmod(unreadable.c_str(), 0));
+
+	vector<string> lines;
+	string err;
+	const int ret = runScan("--jobs=2", lines, err);
+	chmod(unreadable.c_str(), 0644);
+	ASSERT_EQ(0, ret) << err;
+	ASSERT_EQ(36U, lines.size());
+
+	EXPECT_EQ("{\"file\":\"" + tmpDir + "/z.bin\",\"error\":\"rom is not supported\"}",
+		findLine(lines, "z.bin"));
+	EXPECT_EQ("{\"file\":\"" + tmpDir + "/a/b/2.bin\",\"error\":\"rom is not supported\"}",
+		findLine(lines, "a/b/2.bin"));
+	if (!isRoot) {
+		EXPECT_EQ("{\"file\":\"" + tmpDir + "/a/c.sid\",\"error\":\"couldn't open file\",\"code\":13}",
+			findLine(lines, "a/c.sid"));
+	}
+
+	const string line = findLine(lines, "a/1.sid");
+	EXPECT_NE(string::npos, line.find(",\"rom\":")) << line;
+	EXPECT_EQ(string::npos, line.find("\"error\"")) << line;
+}
+
+/**
+ * --hash adds the "Hashes" tab, and --tab=N
+ * restricts the output to the specified tabs.
+ */
+TEST_F(RpcliScanTest, hashAndTab)
+{
+	vector<string> lines;
+	string err;
+	ASSERT_EQ(0, runScan("--jobs=2", lines, err)) << err;
+	string line = findLine(lines, "a/1.sid");
+	EXPECT_NE(string::npos, line.find("Title 1")) << line;
+	EXPECT_EQ(string::npos, line.find("CRC32")) << line;
+
+	ASSERT_EQ(0, runScan("--jobs=2 --hash", lines, err)) << err;
+	line = findLine(lines, "a/1.sid");
+	EXPECT_NE(string::npos, line.find("Title 1")) << line;
+	EXPECT_NE(string::npos, line.find("CRC32")) << line;
+
+	// The "Hashes" tab is after the SID's own tab.
+	ASSERT_EQ(0, runScan("--jobs=2 --hash --tab=0", lines, err)) << err;
+	line = findLine(lines, "a/1.sid");
+	EXPECT_NE(string::npos, line.find("Title 1")) << line;
+	EXPECT_EQ(string::npos, line.find("CRC32")) << line;
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "rpcli test suite: Directory scanning tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	if (argc < 2) {
+		fprintf(stderr, "Syntax: %s /path/to/rpcli\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	Rpcli::Tests::rpcli_exe = argv[1];
+	return RUN_ALL_TESTS();
+}
@@ -43,6 +43,9 @@ using LibWin32Common::RegKey;
 using LibRpTexture::RpGdiplusBackend;
 using LibRpTexture::rp_image;
 
+// Image decoder thread pool.
+#include "librptexture/decoder/ImageDecoder.hpp"
+
 // For file extensions.
 #include "libromdata/RomDataFactory.hpp"
 using LibRomData::RomDataFactory;
@@ -129,6 +132,13 @@ STDAPI DllCanUnloadNow(void)
 {
 	if (!LibWin32Common::ComBase_isReferenced()) {
 		// Not referenced anywhere.
+		// Stop the image decoder's worker threads before the
+		// DLL is unloaded. This can't be done in DllMain(),
+		// since joining threads under the loader lock deadlocks.
+		if (!LibRpTexture::ImageDecoder::shutdownThreadPool()) {
+			// Still decoding an image.
+			return S_FALSE;
+		}
 		return S_OK;
 	}
 